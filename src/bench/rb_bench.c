@@ -0,0 +1,1881 @@
+#define _POSIX_C_SOURCE 200112L /* clock_gettime. */
+
+#include "common/rb_shader_variant.h"
+#include "rbi/rbi.h"
+#include "rbu/rbu_bvh.h"
+#include "rbu/rbu_cull.h"
+#include "soft/rb_soft.h"
+#include <snlsys/math.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/snlsys.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define FB_SIZE 1024 /* Width and height of the benchmark framebuffer. */
+#define GRID_SIZE 256
+#define MAX_VERTICES (3 * GRID_SIZE * GRID_SIZE)
+#define MAX_BUFFER_SIZE (4 * 1024 * 1024)
+#define SCALING_VERTICES (3 * 1024) /* Vertices drawn per scaling frame. */
+#define WORLD_SIZE 2000.f /* Width of the cube of the culled objects. */
+#define FRAME_ALLOCS 256 /* Transient allocations per benchmark frame. */
+#define RECORDED_CMDS 256 /* Commands recorded before resetting a buffer. */
+#define MAX_DRAW_RANGES 1024
+
+/* Objects shared by the benchmarks. Most of them are duplicated in order to
+ * alternate the bound resources and thus defeat the state caching. */
+struct fixture {
+  struct rbi rbi;
+  struct rb_context* ctxt;
+  struct rb_buffer* vbuf[2];
+  struct rb_buffer* ibuf;
+  struct rb_buffer* dynbuf;
+  struct rb_vertex_array* varray[2];
+  struct rb_shader* vshader[2];
+  struct rb_shader* fshader[2];
+  struct rb_program* prog[2];
+  struct rb_uniform* transform;
+  struct rb_attrib* color;
+  struct rb_sampler* sampler[2];
+  struct rb_tex2d* tex[2];
+  struct rb_tex2d* rt;
+  struct rb_framebuffer* fb;
+  struct rb_command_buffer* cmd;
+  unsigned char* data; /* Scratch memory of MAX_BUFFER_SIZE bytes. */
+};
+
+/* Run `nops' operations of a benchmark on data of dimension `size'. Return
+ * the overall number of bytes that were transfered. */
+typedef int
+(*run_bench_T)
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes);
+
+struct bench {
+  const char* name; /* Name of the benchmarked rb function. */
+  run_bench_T run;
+  const size_t* sizes; /* Zero terminated. NULL <=> size independent. */
+};
+
+static const char* vs_source =
+  "#version 330\n"
+  "layout(location = 0) in vec3 pos;\n"
+  "layout(location = 1) in vec4 color;\n"
+  "uniform mat4 transform;\n"
+  "smooth out vec4 vcolor;\n"
+  "void main()\n"
+  "{\n"
+  "  vcolor = color;\n"
+  "  gl_Position = transform * vec4(pos, 1.0);\n"
+  "}\n";
+
+static const char* fs_source =
+  "#version 330\n"
+  "smooth in vec4 vcolor;\n"
+  "out vec4 frag_color;\n"
+  "void main()\n"
+  "{\n"
+  "  frag_color = vcolor;\n"
+  "}\n";
+
+/* Fragment shader whose variants are preprocessed with an include. */
+static const char* fs_variant_source =
+  "#version 330\n"
+  "#include \"shade.glsl\"\n"
+  "smooth in vec4 vcolor;\n"
+  "out vec4 frag_color;\n"
+  "void main()\n"
+  "{\n"
+  "  frag_color = shade(vcolor);\n"
+  "}\n";
+
+static const char* shade_source =
+  "vec4 shade(vec4 color)\n"
+  "{\n"
+  "#ifdef BENCH_VARIANT\n"
+  "  return color.bgra;\n"
+  "#else\n"
+  "  return color;\n"
+  "#endif\n"
+  "}\n";
+
+static const float identity[16] = {
+  1.f, 0.f, 0.f, 0.f,
+  0.f, 1.f, 0.f, 0.f,
+  0.f, 0.f, 1.f, 0.f,
+  0.f, 0.f, 0.f, 1.f
+};
+
+static const size_t buffer_sizes[] = { 64, 4096, 262144, MAX_BUFFER_SIZE, 0 };
+static const size_t tex_sizes[] = { 16, 256, FB_SIZE, 0 };
+static const size_t vertex_counts[] = { 3, 3 * 1024, MAX_VERTICES, 0 };
+static const size_t alloc_sizes[] = { 16, 256, 4096, 0 };
+static const size_t cmd_counts[] = { 1, 64, 1024, 0 };
+static const size_t range_counts[] = { 1, 64, MAX_DRAW_RANGES, 0 };
+
+/* Distinct descriptors since the samplers may be shared by descriptor. */
+static const struct rb_sampler_desc sampler_desc[2] = {
+  { RB_MIN_LINEAR_MAG_LINEAR_MIP_LINEAR,
+    RB_ADDRESS_WRAP, RB_ADDRESS_WRAP, RB_ADDRESS_WRAP,
+    0.f, 0.f, 1000.f, 1 },
+  { RB_MIN_POINT_MAG_POINT_MIP_POINT,
+    RB_ADDRESS_CLAMP, RB_ADDRESS_CLAMP, RB_ADDRESS_CLAMP,
+    0.f, 0.f, 1000.f, 1 }
+};
+static const struct rb_buffer_desc buffer_desc = {
+  4096, RB_BIND_VERTEX_BUFFER, RB_USAGE_DEFAULT
+};
+static const struct rb_framebuffer_desc framebuffer_desc = { 64, 64, 1, 1 };
+static const struct rb_error_check_desc error_check_desc[2] = {
+  { RB_ERROR_CHECK_NONE, 0 }, { RB_ERROR_CHECK_CALLBACK, 0 }
+};
+static const struct rb_compile_desc compile_desc[2] = {
+  { RB_COMPILE_SYNC, 0 }, { RB_COMPILE_ASYNC, 0 }
+};
+
+/*******************************************************************************
+ *
+ * Software shaders. The rb-soft backend runs C functions registered under the
+ * name of the GLSL sources, or of the preprocessed sources of their variants.
+ *
+ ******************************************************************************/
+typedef int
+(*register_shader_T)
+  (struct rb_context* ctxt,
+   const char* name,
+   const struct rb_soft_shader_desc* desc);
+
+static const struct rb_soft_attrib_decl soft_vs_attrib_list[] = {
+  { "pos", RB_FLOAT3, 0 },
+  { "color", RB_FLOAT4, 1 }
+};
+
+static const struct rb_soft_uniform_decl soft_vs_uniform_list[] = {
+  { "transform", RB_FLOAT4x4, 0 }
+};
+
+static void
+soft_vs_main
+  (const struct rb_soft_shader_env* env,
+   const float* const attribs[],
+   float position[4],
+   float varyings[])
+{
+  const float* transform = env->uniforms[0];
+  int i = 0;
+  for(i = 0; i < 4; ++i) { /* Column major matrix. */
+    position[i] =
+      transform[i] * attribs[0][0]
+    + transform[4 + i] * attribs[0][1]
+    + transform[8 + i] * attribs[0][2]
+    + transform[12 + i] * attribs[0][3];
+  }
+  memcpy(varyings, attribs[1], 4 * sizeof(float));
+}
+
+static int
+soft_fs_main
+  (const struct rb_soft_shader_env* env,
+   const float varyings[],
+   float colors[][4])
+{
+  (void)env;
+  memcpy(colors[0], varyings, 4 * sizeof(float));
+  return 1;
+}
+
+/* Variant of fs_variant_source with the BENCH_VARIANT define. */
+static int
+soft_fs_bgra_main
+  (const struct rb_soft_shader_env* env,
+   const float varyings[],
+   float colors[][4])
+{
+  (void)env;
+  colors[0][0] = varyings[2];
+  colors[0][1] = varyings[1];
+  colors[0][2] = varyings[0];
+  colors[0][3] = varyings[3];
+  return 1;
+}
+
+static const struct rb_soft_shader_desc soft_vs_desc = {
+  RB_VERTEX_SHADER, soft_vs_uniform_list, 1, soft_vs_attrib_list, 2, 4, 0,
+  soft_vs_main, NULL
+};
+
+static const struct rb_soft_shader_desc soft_fs_desc = {
+  RB_FRAGMENT_SHADER, NULL, 0, NULL, 0, 4, 1, NULL, soft_fs_main
+};
+
+static const struct rb_soft_shader_desc soft_fs_bgra_desc = {
+  RB_FRAGMENT_SHADER, NULL, 0, NULL, 0, 4, 1, NULL, soft_fs_bgra_main
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static int
+resolve_include
+  (void* data,
+   const char* path,
+   const char** out_source,
+   size_t* out_length)
+{
+  (void)data;
+  if(strcmp(path, "shade.glsl"))
+    return -1;
+  *out_source = shade_source;
+  *out_length = strlen(shade_source);
+  return 0;
+}
+
+/* Register the software shader `desc' under the name of the variant `vdesc'
+ * preprocessed as the backends do. */
+static int
+register_soft_variant
+  (struct rb_context* ctxt,
+   register_shader_T register_shader,
+   const struct rb_shader_variant_desc* vdesc,
+   const struct rb_soft_shader_desc* desc)
+{
+  char* source = NULL;
+  size_t length = 0;
+  int err = 0;
+
+  if(0 != rb_preprocess_shader_variant
+     (&mem_default_allocator, vdesc, &source, &length))
+    return -1;
+  /* The backend copies the name. */
+  err = register_shader(ctxt, source, desc);
+  MEM_FREE(&mem_default_allocator, source);
+  return err;
+}
+
+/* Register the software shaders of the fixture and of the variant benchmarks
+ * if the backend is rb-soft, i.e. if it exports rb_soft_register_shader. */
+static int
+register_soft_shaders(struct fixture* fix)
+{
+  const struct rb_shader_define define = { "BENCH_VARIANT", "1" };
+  struct rb_shader_variant_desc vdesc;
+  register_shader_T register_shader = NULL;
+
+  register_shader = (register_shader_T)(intptr_t)
+    dlsym(fix->rbi.handle, "rb_soft_register_shader");
+  if(!register_shader)
+    return 0;
+
+  if(0 != register_shader(fix->ctxt, vs_source, &soft_vs_desc)
+  || 0 != register_shader(fix->ctxt, fs_source, &soft_fs_desc))
+    return -1;
+
+  memset(&vdesc, 0, sizeof(struct rb_shader_variant_desc));
+  vdesc.type = RB_FRAGMENT_SHADER;
+  vdesc.source = fs_source;
+  vdesc.length = strlen(fs_source);
+  vdesc.define_list = &define;
+  vdesc.nb_defines = 1;
+  if(0 != register_soft_variant
+     (fix->ctxt, register_shader, &vdesc, &soft_fs_desc))
+    return -1;
+
+  vdesc.source = fs_variant_source;
+  vdesc.length = strlen(fs_variant_source);
+  vdesc.include = resolve_include;
+  return register_soft_variant
+    (fix->ctxt, register_shader, &vdesc, &soft_fs_bgra_desc);
+}
+
+static FINLINE double
+elapsed_ns(const struct timespec* t0, const struct timespec* t1)
+{
+  return (double)(t1->tv_sec - t0->tv_sec) * 1.0e9
+       + (double)(t1->tv_nsec - t0->tv_nsec);
+}
+
+/* Wait for the completion of the submitted commands by reading back one
+ * pixel of the benchmark framebuffer. */
+static int
+sync_fixture(struct fixture* fix)
+{
+  unsigned char pixel[16];
+  return fix->rbi.read_back_framebuffer(fix->fb, 0, 0, 0, 1, 1, NULL, pixel);
+}
+
+/* Restore the states expected by the benchmarks. Error checking is disabled
+ * in order to time the call paths rather than the driver validation. */
+static int
+reset_fixture(struct fixture* fix)
+{
+  const struct rb_viewport_desc viewport = {0, 0, FB_SIZE, FB_SIZE, 0.f, 1.f};
+  const struct rbi* rbi = &fix->rbi;
+
+  if(0 != rbi->error_check(fix->ctxt, &error_check_desc[0])
+  || 0 != rbi->viewport(fix->ctxt, &viewport)
+  || 0 != rbi->bind_framebuffer(fix->ctxt, fix->fb)
+  || 0 != rbi->bind_program(fix->ctxt, fix->prog[0])
+  || 0 != rbi->bind_vertex_array(fix->ctxt, fix->varray[0]))
+    return -1;
+  return 0;
+}
+
+static void
+release_fixture(struct fixture* fix)
+{
+  const struct rbi* rbi = &fix->rbi;
+  int i = 0;
+
+  #define RELEASE(type, obj) if(obj) RBI(rbi, type##_ref_put(obj))
+  RELEASE(command_buffer, fix->cmd);
+  RELEASE(framebuffer, fix->fb);
+  RELEASE(tex2d, fix->rt);
+  RELEASE(attrib, fix->color);
+  RELEASE(uniform, fix->transform);
+  RELEASE(buffer, fix->ibuf);
+  RELEASE(buffer, fix->dynbuf);
+  for(i = 0; i < 2; ++i) {
+    RELEASE(tex2d, fix->tex[i]);
+    RELEASE(sampler, fix->sampler[i]);
+    RELEASE(program, fix->prog[i]);
+    RELEASE(shader, fix->vshader[i]);
+    RELEASE(shader, fix->fshader[i]);
+    RELEASE(vertex_array, fix->varray[i]);
+    RELEASE(buffer, fix->vbuf[i]);
+  }
+  RELEASE(context, fix->ctxt);
+  #undef RELEASE
+  free(fix->data);
+}
+
+static int
+setup_fixture(struct fixture* fix)
+{
+  const struct rbi* rbi = &fix->rbi;
+  struct rb_buffer_desc buf_desc;
+  struct rb_buffer_attrib attr;
+  struct rb_tex2d_desc tex_desc;
+  struct rb_framebuffer_desc fb_desc;
+  struct rb_render_target rt;
+  const struct rb_headless_desc headless_desc = { FB_SIZE, FB_SIZE };
+  const void* mip_data[1] = { NULL };
+  float* pos = NULL;
+  unsigned int* ids = NULL;
+  const float color[4] = { 1.f, 0.5f, 0.25f, 1.f };
+  size_t i = 0;
+
+  #define CALL(func) if(0 != rbi->func) goto error
+  fix->data = calloc(1, MAX_BUFFER_SIZE);
+  if(!fix->data)
+    goto error;
+  CALL(create_headless_context(NULL, &headless_desc, &fix->ctxt));
+  if(0 != register_soft_shaders(fix))
+    goto error;
+
+  /* Vertex data: one small triangle per cell of a GRID_SIZE^2 grid covering
+   * the viewport, in order to time the vertex processing rather than the
+   * fill rate. */
+  pos = (float*)fix->data;
+  for(i = 0; i < MAX_VERTICES / 3; ++i) {
+    const float cell = 2.f / (float)GRID_SIZE;
+    const float x = (float)(i % GRID_SIZE) * cell - 1.f;
+    const float y = (float)(i / GRID_SIZE) * cell - 1.f;
+    float* tri = pos + i * 9;
+    tri[0] = x; tri[1] = y; tri[2] = 0.f;
+    tri[3] = x + cell; tri[4] = y; tri[5] = 0.f;
+    tri[6] = x; tri[7] = y + cell; tri[8] = 0.f;
+  }
+  buf_desc.size = MAX_VERTICES * 3 * sizeof(float);
+  buf_desc.target = RB_BIND_VERTEX_BUFFER;
+  buf_desc.usage = RB_USAGE_IMMUTABLE;
+  CALL(create_buffer(fix->ctxt, &buf_desc, fix->data, &fix->vbuf[0]));
+  CALL(create_buffer(fix->ctxt, &buf_desc, fix->data, &fix->vbuf[1]));
+  ids = (unsigned int*)fix->data;
+  for(i = 0; i < MAX_VERTICES; ++i)
+    ids[i] = (unsigned int)i;
+  buf_desc.size = MAX_VERTICES * sizeof(unsigned int);
+  buf_desc.target = RB_BIND_INDEX_BUFFER;
+  CALL(create_buffer(fix->ctxt, &buf_desc, fix->data, &fix->ibuf));
+  buf_desc.size = MAX_BUFFER_SIZE;
+  buf_desc.target = RB_BIND_VERTEX_BUFFER;
+  buf_desc.usage = RB_USAGE_DYNAMIC;
+  CALL(create_buffer(fix->ctxt, &buf_desc, NULL, &fix->dynbuf));
+
+  attr.index = 0;
+  attr.stride = 3 * sizeof(float);
+  attr.offset = 0;
+  attr.type = RB_FLOAT3;
+  for(i = 0; i < 2; ++i) {
+    CALL(create_vertex_array(fix->ctxt, &fix->varray[i]));
+    CALL(vertex_attrib_array(fix->varray[i], fix->vbuf[i], 1, &attr));
+    CALL(vertex_index_array(fix->varray[i], fix->ibuf));
+  }
+
+  /* Programs. */
+  for(i = 0; i < 2; ++i) {
+    CALL(create_shader(fix->ctxt, RB_VERTEX_SHADER, vs_source,
+      strlen(vs_source), &fix->vshader[i]));
+    CALL(create_shader(fix->ctxt, RB_FRAGMENT_SHADER, fs_source,
+      strlen(fs_source), &fix->fshader[i]));
+    CALL(create_program(fix->ctxt, &fix->prog[i]));
+    CALL(attach_shader(fix->prog[i], fix->vshader[i]));
+    CALL(attach_shader(fix->prog[i], fix->fshader[i]));
+    CALL(link_program(fix->prog[i]));
+  }
+  CALL(get_named_uniform(fix->ctxt, fix->prog[0], "transform",&fix->transform));
+  CALL(uniform_data(fix->transform, 1, identity));
+  CALL(get_named_attrib(fix->ctxt, fix->prog[0], "color", &fix->color));
+  CALL(attrib_data(fix->color, color));
+
+  /* Textures and samplers. */
+  tex_desc.width = FB_SIZE;
+  tex_desc.height = FB_SIZE;
+  tex_desc.mip_count = 1;
+  tex_desc.format = RB_RGBA;
+  tex_desc.usage = RB_USAGE_DEFAULT;
+  tex_desc.compress = 0;
+  for(i = 0; i < 2; ++i) {
+    CALL(create_sampler(fix->ctxt, &sampler_desc[i], &fix->sampler[i]));
+    CALL(create_tex2d(fix->ctxt, &tex_desc, mip_data, &fix->tex[i]));
+  }
+  CALL(create_tex2d(fix->ctxt, &tex_desc, mip_data, &fix->rt));
+
+  /* Framebuffer. */
+  fb_desc.width = FB_SIZE;
+  fb_desc.height = FB_SIZE;
+  fb_desc.sample_count = 1;
+  fb_desc.buffer_count = 1;
+  CALL(create_framebuffer(fix->ctxt, &fb_desc, &fix->fb));
+  memset(&rt, 0, sizeof(rt));
+  rt.type = RB_RENDER_TARGET_TEXTURE2D;
+  rt.resource = fix->rt;
+  rt.desc.tex2d.mip_level = 0;
+  CALL(framebuffer_render_targets(fix->fb, 1, &rt, NULL));
+
+  CALL(create_command_buffer(fix->ctxt, &fix->cmd));
+  #undef CALL
+  return reset_fixture(fix);
+error:
+  return -1;
+}
+
+/*******************************************************************************
+ *
+ * Benchmarks.
+ *
+ ******************************************************************************/
+#define FOR_EACH_OP(fix, call) {                                               \
+  size_t iop = 0;                                                              \
+  for(iop = 0; iop < nops; ++iop) {                                            \
+    if(0 != (fix)->rbi.call)                                                   \
+      return -1;                                                               \
+  }                                                                            \
+} (void)0
+
+/* Benchmark the creation and the release of an object. */
+#define BENCH_CREATE(type, create_call)                                        \
+  static int                                                                   \
+  bench_create_##type                                                          \
+    (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)            \
+  {                                                                            \
+    size_t iop = 0;                                                            \
+    (void)size;                                                                \
+    for(iop = 0; iop < nops; ++iop) {                                          \
+      struct rb_##type* obj = NULL;                                            \
+      if(0 != fix->rbi.create_call || 0 != fix->rbi.type##_ref_put(obj))       \
+        return -1;                                                             \
+    }                                                                          \
+    *nbytes = 0;                                                               \
+    return 0;                                                                  \
+  }
+
+/* Benchmark the retain/release of a reference on an existing object. */
+#define BENCH_REF(type, obj)                                                   \
+  static int                                                                   \
+  bench_##type##_ref                                                           \
+    (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)            \
+  {                                                                            \
+    (void)size;                                                                \
+    FOR_EACH_OP(fix, type##_ref_get(obj));                                     \
+    FOR_EACH_OP(fix, type##_ref_put(obj));                                     \
+    *nbytes = 0;                                                               \
+    return 0;                                                                  \
+  }
+
+/* Benchmark a call whose parameters do not depend on the benchmark size. */
+#define BENCH_CALL(name, call)                                                 \
+  static int                                                                   \
+  bench_##name                                                                 \
+    (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)            \
+  {                                                                            \
+    (void)size;                                                                \
+    FOR_EACH_OP(fix, call);                                                    \
+    *nbytes = 0;                                                               \
+    return 0;                                                                  \
+  }
+
+BENCH_CREATE(context, create_context(NULL, &obj))
+BENCH_CREATE(sampler, create_sampler(fix->ctxt, &sampler_desc[0], &obj))
+BENCH_CREATE(vertex_array, create_vertex_array(fix->ctxt, &obj))
+BENCH_CREATE(program, create_program(fix->ctxt, &obj))
+BENCH_CREATE(framebuffer,
+  create_framebuffer(fix->ctxt, &framebuffer_desc, &obj))
+BENCH_CREATE(command_buffer, create_command_buffer(fix->ctxt, &obj))
+
+BENCH_REF(context, fix->ctxt)
+BENCH_REF(tex2d, fix->tex[0])
+BENCH_REF(sampler, fix->sampler[0])
+BENCH_REF(buffer, fix->vbuf[0])
+BENCH_REF(vertex_array, fix->varray[0])
+BENCH_REF(shader, fix->vshader[0])
+BENCH_REF(program, fix->prog[0])
+BENCH_REF(uniform, fix->transform)
+BENCH_REF(attrib, fix->color)
+BENCH_REF(framebuffer, fix->fb)
+BENCH_REF(command_buffer, fix->cmd)
+
+BENCH_CALL(bind_tex2d, bind_tex2d(fix->ctxt, fix->tex[iop & 1], 0))
+BENCH_CALL(bind_sampler, bind_sampler(fix->ctxt, fix->sampler[iop & 1], 0))
+BENCH_CALL(sampler_parameters,
+  sampler_parameters(fix->sampler[0], &sampler_desc[0]))
+BENCH_CALL(bind_buffer,
+  bind_buffer(fix->ctxt, fix->vbuf[iop & 1], RB_BIND_VERTEX_BUFFER))
+BENCH_CALL(bind_vertex_array,
+  bind_vertex_array(fix->ctxt, fix->varray[iop & 1]))
+BENCH_CALL(get_shader_log, get_shader_log(fix->vshader[0], &(const char*){0}))
+BENCH_CALL(is_shader_attached, is_shader_attached(fix->vshader[0], &(int){0}))
+BENCH_CALL(bind_program, bind_program(fix->ctxt, fix->prog[iop & 1]))
+BENCH_CALL(get_program_log, get_program_log(fix->prog[0], &(const char*){0}))
+BENCH_CALL(program_is_ready, program_is_ready(fix->prog[0], &(int){0}))
+BENCH_CALL(get_uniform_desc,
+  get_uniform_desc(fix->transform, &(struct rb_uniform_desc){0, 0}))
+BENCH_CALL(get_attrib_desc,
+  get_attrib_desc(fix->color, &(struct rb_attrib_desc){0, 0, 0}))
+BENCH_CALL(uniform_data, uniform_data(fix->transform, 1, identity))
+BENCH_CALL(attrib_data, attrib_data(fix->color, identity))
+BENCH_CALL(bind_framebuffer,
+  bind_framebuffer(fix->ctxt, (iop & 1) ? NULL : fix->fb))
+BENCH_CALL(flush, flush(fix->ctxt))
+BENCH_CALL(get_config, get_config(fix->ctxt, &(struct rb_config){0, 0}))
+
+static int
+bench_create_tex2d
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  struct rb_tex2d_desc desc;
+  const void* mip_data[1];
+  size_t iop = 0;
+
+  desc.width = desc.height = (unsigned int)size;
+  desc.mip_count = 1;
+  desc.format = RB_RGBA;
+  desc.usage = RB_USAGE_DEFAULT;
+  desc.compress = 0;
+  mip_data[0] = fix->data;
+  for(iop = 0; iop < nops; ++iop) {
+    struct rb_tex2d* tex = NULL;
+    if(0 != fix->rbi.create_tex2d(fix->ctxt, &desc, mip_data, &tex)
+    || 0 != fix->rbi.tex2d_ref_put(tex))
+      return -1;
+  }
+  *nbytes = nops * size * size * 4;
+  return 0;
+}
+
+static int
+bench_tex2d_data
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  struct rb_tex2d_desc desc;
+  struct rb_tex2d* tex = NULL;
+  const void* mip_data[1] = { NULL };
+  int err = 0;
+
+  desc.width = desc.height = (unsigned int)size;
+  desc.mip_count = 1;
+  desc.format = RB_RGBA;
+  desc.usage = RB_USAGE_DYNAMIC;
+  desc.compress = 0;
+  if(0 != fix->rbi.create_tex2d(fix->ctxt, &desc, mip_data, &tex))
+    return -1;
+  {
+    size_t iop = 0;
+    for(iop = 0; !err && iop < nops; ++iop)
+      err = fix->rbi.tex2d_data(tex, 0, fix->data);
+  }
+  if(0 != fix->rbi.tex2d_ref_put(tex))
+    return -1;
+  *nbytes = nops * size * size * 4;
+  return err;
+}
+
+static int
+bench_create_buffer
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  struct rb_buffer_desc desc = buffer_desc;
+  size_t iop = 0;
+
+  desc.size = size;
+  for(iop = 0; iop < nops; ++iop) {
+    struct rb_buffer* buf = NULL;
+    if(0 != fix->rbi.create_buffer(fix->ctxt, &desc, fix->data, &buf)
+    || 0 != fix->rbi.buffer_ref_put(buf))
+      return -1;
+  }
+  *nbytes = nops * size;
+  return 0;
+}
+
+static int
+bench_buffer_data
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  FOR_EACH_OP(fix, buffer_data(fix->dynbuf, 0, (int)size, fix->data));
+  *nbytes = nops * size;
+  return 0;
+}
+
+static int
+bench_vertex_attrib_array
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  const struct rb_buffer_attrib attr = { 0, 3 * sizeof(float), 0, RB_FLOAT3 };
+  const int index = 0;
+  (void)size;
+  FOR_EACH_OP(fix, vertex_attrib_array(fix->varray[1], fix->vbuf[1], 1, &attr));
+  FOR_EACH_OP(fix, remove_vertex_attrib(fix->varray[1], 1, &index));
+  if(0 != fix->rbi.vertex_attrib_array(fix->varray[1], fix->vbuf[1], 1, &attr))
+    return -1;
+  *nbytes = 0;
+  return 0;
+}
+
+static int
+bench_vertex_index_array
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  (void)size;
+  FOR_EACH_OP(fix, vertex_index_array(fix->varray[1], fix->ibuf));
+  *nbytes = 0;
+  return 0;
+}
+
+static int
+bench_create_shader
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  const size_t len = strlen(fs_source);
+  size_t iop = 0;
+  (void)size;
+
+  for(iop = 0; iop < nops; ++iop) {
+    struct rb_shader* shader = NULL;
+    if(0 != fix->rbi.create_shader
+        (fix->ctxt, RB_FRAGMENT_SHADER, fs_source, len, &shader)
+    || 0 != fix->rbi.shader_ref_put(shader))
+      return -1;
+  }
+  *nbytes = nops * len;
+  return 0;
+}
+
+/* Measure the variant lookup: the variant is compiled once and then shared
+ * by the subsequent calls. */
+static int
+bench_create_shader_variant
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  const struct rb_shader_define define = { "BENCH_VARIANT", "1" };
+  struct rb_shader_variant_desc desc;
+  struct rb_shader* variant = NULL;
+  size_t iop = 0;
+  int err = 0;
+  (void)size;
+
+  memset(&desc, 0, sizeof(struct rb_shader_variant_desc));
+  desc.type = RB_FRAGMENT_SHADER;
+  desc.source = fs_source;
+  desc.length = strlen(fs_source);
+  desc.define_list = &define;
+  desc.nb_defines = 1;
+  if(0 != fix->rbi.create_shader_variant(fix->ctxt, &desc, &variant))
+    return -1;
+  for(iop = 0; !err && iop < nops; ++iop) {
+    struct rb_shader* shader = NULL;
+    err = fix->rbi.create_shader_variant(fix->ctxt, &desc, &shader);
+    if(!err)
+      err = fix->rbi.shader_ref_put(shader);
+  }
+  if(0 != fix->rbi.shader_ref_put(variant))
+    err = -1;
+  *nbytes = nops * desc.length;
+  return err;
+}
+
+/* Measure the variant creation: the variant is released by each call and
+ * is thus preprocessed and compiled again by the next one. */
+static int
+bench_create_shader_variant_miss
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  const struct rb_shader_define define = { "BENCH_VARIANT", "1" };
+  struct rb_shader_variant_desc desc;
+  size_t iop = 0;
+  (void)size;
+
+  memset(&desc, 0, sizeof(struct rb_shader_variant_desc));
+  desc.type = RB_FRAGMENT_SHADER;
+  desc.source = fs_variant_source;
+  desc.length = strlen(fs_variant_source);
+  desc.define_list = &define;
+  desc.nb_defines = 1;
+  desc.include = resolve_include;
+  for(iop = 0; iop < nops; ++iop) {
+    struct rb_shader* shader = NULL;
+    if(0 != fix->rbi.create_shader_variant(fix->ctxt, &desc, &shader)
+    || 0 != fix->rbi.shader_ref_put(shader))
+      return -1;
+  }
+  *nbytes = nops * (desc.length + strlen(shade_source));
+  return 0;
+}
+
+static int
+bench_shader_source
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  const size_t len = strlen(vs_source);
+  (void)size;
+  FOR_EACH_OP(fix, shader_source(fix->vshader[1], vs_source, len));
+  *nbytes = nops * len;
+  return 0;
+}
+
+static int
+bench_link_program
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  (void)size;
+  FOR_EACH_OP(fix, link_program(fix->prog[1]));
+  *nbytes = 0;
+  return 0;
+}
+
+static int
+bench_attach_shader
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  struct rb_program* prog = NULL;
+  struct rb_shader* shader = NULL;
+  size_t iop = 0;
+  int err = 0;
+  (void)size;
+
+  if(0 != fix->rbi.create_program(fix->ctxt, &prog))
+    return -1;
+  err = fix->rbi.create_shader
+    (fix->ctxt, RB_FRAGMENT_SHADER, fs_source, strlen(fs_source), &shader);
+  for(iop = 0; !err && iop < nops; ++iop) {
+    err = fix->rbi.attach_shader(prog, shader);
+    if(!err)
+      err = fix->rbi.detach_shader(prog, shader);
+  }
+  if(shader && 0 != fix->rbi.shader_ref_put(shader))
+    err = -1;
+  if(0 != fix->rbi.program_ref_put(prog))
+    err = -1;
+  *nbytes = 0;
+  return err;
+}
+
+static int
+bench_get_named_uniform
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  size_t iop = 0;
+  (void)size;
+
+  for(iop = 0; iop < nops; ++iop) {
+    struct rb_uniform* uniform = NULL;
+    if(0 != fix->rbi.get_named_uniform
+        (fix->ctxt, fix->prog[0], "transform", &uniform)
+    || 0 != fix->rbi.uniform_ref_put(uniform))
+      return -1;
+  }
+  *nbytes = 0;
+  return 0;
+}
+
+static int
+bench_get_uniforms
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  size_t iop = 0;
+  (void)size;
+
+  for(iop = 0; iop < nops; ++iop) {
+    struct rb_uniform* list[8];
+    size_t nb = 0;
+    size_t i = 0;
+    if(0 != fix->rbi.get_uniforms(fix->ctxt, fix->prog[0], &nb, NULL)
+    || nb > sizeof(list) / sizeof(list[0])
+    || 0 != fix->rbi.get_uniforms(fix->ctxt, fix->prog[0], &nb, list))
+      return -1;
+    for(i = 0; i < nb; ++i)
+      if(0 != fix->rbi.uniform_ref_put(list[i]))
+        return -1;
+  }
+  *nbytes = 0;
+  return 0;
+}
+
+static int
+bench_get_named_attrib
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  size_t iop = 0;
+  (void)size;
+
+  for(iop = 0; iop < nops; ++iop) {
+    struct rb_attrib* attr = NULL;
+    if(0 != fix->rbi.get_named_attrib(fix->ctxt, fix->prog[0], "color", &attr)
+    || 0 != fix->rbi.attrib_ref_put(attr))
+      return -1;
+  }
+  *nbytes = 0;
+  return 0;
+}
+
+static int
+bench_get_attribs
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  size_t iop = 0;
+  (void)size;
+
+  for(iop = 0; iop < nops; ++iop) {
+    struct rb_attrib* list[8];
+    size_t nb = 0;
+    size_t i = 0;
+    if(0 != fix->rbi.get_attribs(fix->ctxt, fix->prog[0], &nb, NULL)
+    || nb > sizeof(list) / sizeof(list[0])
+    || 0 != fix->rbi.get_attribs(fix->ctxt, fix->prog[0], &nb, list))
+      return -1;
+    for(i = 0; i < nb; ++i)
+      if(0 != fix->rbi.attrib_ref_put(list[i]))
+        return -1;
+  }
+  *nbytes = 0;
+  return 0;
+}
+
+static int
+bench_framebuffer_render_targets
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  struct rb_render_target rt;
+  (void)size;
+
+  memset(&rt, 0, sizeof(rt));
+  rt.type = RB_RENDER_TARGET_TEXTURE2D;
+  rt.resource = fix->rt;
+  FOR_EACH_OP(fix, framebuffer_render_targets(fix->fb, 1, &rt, NULL));
+  *nbytes = 0;
+  return 0;
+}
+
+static int
+bench_clear_framebuffer_render_targets
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  struct rb_clear_framebuffer_color_desc color;
+  (void)size;
+
+  memset(&color, 0, sizeof(color));
+  FOR_EACH_OP(fix, clear_framebuffer_render_targets
+    (fix->fb, RB_CLEAR_COLOR_BIT, 1, &color, 1.f, 0));
+  *nbytes = 0;
+  return 0;
+}
+
+static int
+bench_read_back_framebuffer
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  FOR_EACH_OP(fix, read_back_framebuffer
+    (fix->fb, 0, 0, 0, size, size, NULL, fix->data));
+  *nbytes = nops * size * size * 4;
+  return 0;
+}
+
+static int
+bench_blend
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  struct rb_blend_desc desc[2];
+  (void)size;
+
+  memset(desc, 0, sizeof(desc));
+  desc[1].enable = 1;
+  desc[1].src_blend_RGB = desc[1].src_blend_Alpha = RB_BLEND_SRC_ALPHA;
+  desc[1].dst_blend_RGB = RB_BLEND_ONE_MINUS_SRC_ALPHA;
+  desc[1].dst_blend_Alpha = RB_BLEND_ONE_MINUS_SRC_ALPHA;
+  FOR_EACH_OP(fix, blend(fix->ctxt, &desc[iop & 1]));
+  if(0 != fix->rbi.blend(fix->ctxt, &desc[0]))
+    return -1;
+  *nbytes = 0;
+  return 0;
+}
+
+static int
+bench_depth_stencil
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  struct rb_depth_stencil_desc desc[2];
+  (void)size;
+
+  memset(desc, 0, sizeof(desc));
+  desc[0].depth_func = desc[1].depth_func = RB_COMPARISON_LESS;
+  desc[1].enable_depth_test = 1;
+  desc[1].enable_depth_write = 1;
+  FOR_EACH_OP(fix, depth_stencil(fix->ctxt, &desc[iop & 1]));
+  if(0 != fix->rbi.depth_stencil(fix->ctxt, &desc[0]))
+    return -1;
+  *nbytes = 0;
+  return 0;
+}
+
+static int
+bench_rasterizer
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  const struct rb_rasterizer_desc desc[2] = {
+    { RB_FILL_SOLID, RB_CULL_NONE, RB_ORIENTATION_CCW },
+    { RB_FILL_SOLID, RB_CULL_BACK, RB_ORIENTATION_CCW }
+  };
+  (void)size;
+  FOR_EACH_OP(fix, rasterizer(fix->ctxt, &desc[iop & 1]));
+  if(0 != fix->rbi.rasterizer(fix->ctxt, &desc[0]))
+    return -1;
+  *nbytes = 0;
+  return 0;
+}
+
+static int
+bench_viewport
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  const struct rb_viewport_desc desc[2] = {
+    { 0, 0, FB_SIZE, FB_SIZE, 0.f, 1.f },
+    { 0, 0, FB_SIZE / 2, FB_SIZE / 2, 0.f, 1.f }
+  };
+  (void)size;
+  FOR_EACH_OP(fix, viewport(fix->ctxt, &desc[iop & 1]));
+  if(0 != fix->rbi.viewport(fix->ctxt, &desc[0]))
+    return -1;
+  *nbytes = 0;
+  return 0;
+}
+
+static int
+bench_error_check
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  (void)size;
+  FOR_EACH_OP(fix, error_check(fix->ctxt, &error_check_desc[iop & 1]));
+  if(0 != fix->rbi.error_check(fix->ctxt, &error_check_desc[0]))
+    return -1;
+  *nbytes = 0;
+  return 0;
+}
+
+static int
+bench_compile_mode
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  (void)size;
+  FOR_EACH_OP(fix, compile_mode(fix->ctxt, &compile_desc[iop & 1]));
+  if(0 != fix->rbi.compile_mode(fix->ctxt, &compile_desc[0]))
+    return -1;
+  *nbytes = 0;
+  return 0;
+}
+
+/* Record a draw of `nvertices' with the program and the uniform it uses. */
+static int
+record_draw(struct fixture* fix, size_t iop, unsigned int nvertices)
+{
+  if(0 != fix->rbi.cmd_bind_program(fix->cmd, fix->prog[iop & 1])
+  || 0 != fix->rbi.cmd_uniform_data(fix->cmd, fix->transform, 1, identity)
+  || 0 != fix->rbi.cmd_draw(fix->cmd, RB_TRIANGLE_LIST, nvertices))
+    return -1;
+  return 0;
+}
+
+/* The command buffer is reset every RECORDED_CMDS recorded draws in order to
+ * bound its memory. */
+static int
+bench_cmd_draw
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  size_t iop = 0;
+  (void)size;
+
+  for(iop = 0; iop < nops; ++iop) {
+    if(0 != record_draw(fix, iop, 3))
+      return -1;
+    if((iop + 1) % RECORDED_CMDS == 0
+    && 0 != fix->rbi.reset_command_buffer(fix->cmd))
+      return -1;
+  }
+  if(0 != fix->rbi.reset_command_buffer(fix->cmd))
+    return -1;
+  *nbytes = 0;
+  return 0;
+}
+
+/* Submit a command buffer of `size' recorded draws. */
+static int
+bench_submit_command_buffers
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  size_t i = 0;
+  int err = 0;
+
+  for(i = 0; !err && i < size; ++i)
+    err = record_draw(fix, i, 3);
+  for(i = 0; !err && i < nops; ++i)
+    err = fix->rbi.submit_command_buffers(fix->ctxt, 1, &fix->cmd);
+  if(0 != fix->rbi.reset_command_buffer(fix->cmd))
+    err = -1;
+  *nbytes = 0;
+  return err;
+}
+
+/* Bake a bundle from `ndraws' recorded draws. */
+static int
+bake_bundle(struct fixture* fix, size_t ndraws, struct rb_bundle** bundle)
+{
+  size_t i = 0;
+  int err = 0;
+
+  for(i = 0; !err && i < ndraws; ++i)
+    err = record_draw(fix, i, 3);
+  if(!err)
+    err = fix->rbi.create_bundle(fix->ctxt, fix->cmd, bundle);
+  if(0 != fix->rbi.reset_command_buffer(fix->cmd))
+    err = -1;
+  return err;
+}
+
+/* Bake a bundle from `size' recorded draws. */
+static int
+bench_create_bundle
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  size_t iop = 0;
+  int err = 0;
+
+  for(iop = 0; !err && iop < size; ++iop)
+    err = record_draw(fix, iop, 3);
+  for(iop = 0; !err && iop < nops; ++iop) {
+    struct rb_bundle* bundle = NULL;
+    err = fix->rbi.create_bundle(fix->ctxt, fix->cmd, &bundle);
+    if(!err)
+      err = fix->rbi.bundle_ref_put(bundle);
+  }
+  if(0 != fix->rbi.reset_command_buffer(fix->cmd))
+    err = -1;
+  *nbytes = 0;
+  return err;
+}
+
+static int
+bench_bundle_ref
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  struct rb_bundle* bundle = NULL;
+  size_t iop = 0;
+  int err = 0;
+  (void)size;
+
+  if(0 != bake_bundle(fix, 1, &bundle))
+    return -1;
+  for(iop = 0; !err && iop < nops; ++iop)
+    err = fix->rbi.bundle_ref_get(bundle);
+  for(iop = 0; !err && iop < nops; ++iop)
+    err = fix->rbi.bundle_ref_put(bundle);
+  if(0 != fix->rbi.bundle_ref_put(bundle))
+    err = -1;
+  *nbytes = 0;
+  return err;
+}
+
+static int
+bench_bundle_uniform_data
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  struct rb_bundle* bundle = NULL;
+  size_t iop = 0;
+  int err = 0;
+  (void)size;
+
+  if(0 != bake_bundle(fix, 1, &bundle))
+    return -1;
+  for(iop = 0; !err && iop < nops; ++iop)
+    err = fix->rbi.bundle_uniform_data(bundle, fix->transform, 1, identity);
+  if(0 != fix->rbi.bundle_ref_put(bundle))
+    err = -1;
+  *nbytes = 0;
+  return err;
+}
+
+/* Replay a bundle baked from `size' recorded draws. */
+static int
+bench_execute_bundle
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  struct rb_bundle* bundle = NULL;
+  size_t iop = 0;
+  int err = 0;
+
+  if(0 != bake_bundle(fix, size, &bundle))
+    return -1;
+  for(iop = 0; !err && iop < nops; ++iop)
+    err = fix->rbi.execute_bundle(fix->ctxt, bundle);
+  if(0 != fix->rbi.bundle_ref_put(bundle))
+    err = -1;
+  *nbytes = 0;
+  return err;
+}
+
+static int
+bench_create_fence
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  size_t iop = 0;
+  int err = 0;
+  (void)size;
+
+  for(iop = 0; !err && iop < nops; ++iop) {
+    struct rb_fence* fence = NULL;
+    err = fix->rbi.create_fence(fix->ctxt, &fence);
+    if(!err)
+      err = fix->rbi.fence_ref_put(fence);
+  }
+  *nbytes = 0;
+  return err;
+}
+
+static int
+bench_fence_ref
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  struct rb_fence* fence = NULL;
+  size_t iop = 0;
+  int err = 0;
+  (void)size;
+
+  if(0 != fix->rbi.create_fence(fix->ctxt, &fence))
+    return -1;
+  for(iop = 0; !err && iop < nops; ++iop)
+    err = fix->rbi.fence_ref_get(fence);
+  for(iop = 0; !err && iop < nops; ++iop)
+    err = fix->rbi.fence_ref_put(fence);
+  if(0 != fix->rbi.fence_ref_put(fence))
+    err = -1;
+  *nbytes = 0;
+  return err;
+}
+
+static int
+bench_wait_fence
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  struct rb_fence* fence = NULL;
+  size_t iop = 0;
+  int err = 0;
+  (void)size;
+
+  if(0 != fix->rbi.create_fence(fix->ctxt, &fence))
+    return -1;
+  for(iop = 0; !err && iop < nops; ++iop)
+    err = fix->rbi.wait_fence(fix->ctxt, fence);
+  if(0 != fix->rbi.fence_ref_put(fence))
+    err = -1;
+  *nbytes = 0;
+  return err;
+}
+
+static int
+bench_poll_fence
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  struct rb_fence* fence = NULL;
+  size_t iop = 0;
+  int is_signaled = 0;
+  int err = 0;
+  (void)size;
+
+  if(0 != fix->rbi.create_fence(fix->ctxt, &fence))
+    return -1;
+  for(iop = 0; !err && iop < nops; ++iop)
+    err = fix->rbi.poll_fence(fix->ctxt, fence, &is_signaled);
+  if(0 != fix->rbi.fence_ref_put(fence))
+    err = -1;
+  *nbytes = 0;
+  return err;
+}
+
+static int
+bench_begin_end_frame
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  size_t iop = 0;
+  (void)size;
+  for(iop = 0; iop < nops; ++iop) {
+    if(0 != fix->rbi.begin_frame(fix->ctxt)
+    || 0 != fix->rbi.end_frame(fix->ctxt))
+      return -1;
+  }
+  *nbytes = 0;
+  return 0;
+}
+
+/* The frame is ended every FRAME_ALLOCS allocations in order to bound the
+ * transient memory, as a steady frame would do. */
+static int
+bench_frame_alloc
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  size_t iop = 0;
+  int err = 0;
+
+  if(0 != fix->rbi.begin_frame(fix->ctxt))
+    return -1;
+  for(iop = 0; !err && iop < nops; ++iop) {
+    void* mem = NULL;
+    err = fix->rbi.frame_alloc(fix->ctxt, size, &mem);
+    if(!err && (iop + 1) % FRAME_ALLOCS == 0) {
+      err = fix->rbi.end_frame(fix->ctxt);
+      if(!err)
+        err = fix->rbi.begin_frame(fix->ctxt);
+    }
+  }
+  if(0 != fix->rbi.end_frame(fix->ctxt))
+    err = -1;
+  *nbytes = nops * size;
+  return err;
+}
+
+static int
+bench_get_pool_stats
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  struct rb_pool_stats stats;
+  (void)size;
+  FOR_EACH_OP(fix, get_pool_stats(fix->ctxt, &stats));
+  *nbytes = 0;
+  return 0;
+}
+
+static int
+bench_clear
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  const float color[4] = { 0.f, 0.f, 0.f, 1.f };
+  (void)size;
+  FOR_EACH_OP(fix, clear(fix->ctxt, RB_CLEAR_COLOR_BIT, color, 1.f, 0));
+  *nbytes = 0;
+  return 0;
+}
+
+static int
+bench_draw
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  FOR_EACH_OP(fix, draw(fix->ctxt, RB_TRIANGLE_LIST, (unsigned int)size));
+  *nbytes = nops * size * 3 * sizeof(float);
+  return 0;
+}
+
+static int
+bench_draw_indexed
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  FOR_EACH_OP
+    (fix, draw_indexed(fix->ctxt, RB_TRIANGLE_LIST, (unsigned int)size));
+  *nbytes = nops * size * (3 * sizeof(float) + sizeof(unsigned int));
+  return 0;
+}
+
+/* Draw `size' ranges of one triangle each. */
+static int
+bench_multi_draw_indexed
+  (struct fixture* fix, size_t size, size_t nops, size_t* nbytes)
+{
+  struct rb_draw_range range_list[MAX_DRAW_RANGES];
+  size_t i = 0;
+  ASSERT(size <= MAX_DRAW_RANGES && 3 * MAX_DRAW_RANGES <= MAX_VERTICES);
+
+  for(i = 0; i < size; ++i) {
+    range_list[i].first_index = (unsigned int)(3 * i);
+    range_list[i].count = 3;
+    range_list[i].base_vertex = 0;
+  }
+  FOR_EACH_OP(fix, multi_draw_indexed
+    (fix->ctxt, RB_TRIANGLE_LIST, (unsigned int)size, range_list));
+  *nbytes = nops * size * 3 * (3 * sizeof(float) + sizeof(unsigned int));
+  return 0;
+}
+
+static const struct bench bench_list[] = {
+  /* Context. */
+  { "create_context", bench_create_context, NULL },
+  { "context_ref_get/put", bench_context_ref, NULL },
+  /* Texture 2d. */
+  { "bind_tex2d", bench_bind_tex2d, NULL },
+  { "create_tex2d", bench_create_tex2d, tex_sizes },
+  { "tex2d_ref_get/put", bench_tex2d_ref, NULL },
+  { "tex2d_data", bench_tex2d_data, tex_sizes },
+  /* Sampler. */
+  { "create_sampler", bench_create_sampler, NULL },
+  { "sampler_ref_get/put", bench_sampler_ref, NULL },
+  { "sampler_parameters", bench_sampler_parameters, NULL },
+  { "bind_sampler", bench_bind_sampler, NULL },
+  /* Buffers. */
+  { "bind_buffer", bench_bind_buffer, NULL },
+  { "buffer_data", bench_buffer_data, buffer_sizes },
+  { "create_buffer", bench_create_buffer, buffer_sizes },
+  { "buffer_ref_get/put", bench_buffer_ref, NULL },
+  /* Vertex array. */
+  { "bind_vertex_array", bench_bind_vertex_array, NULL },
+  { "create_vertex_array", bench_create_vertex_array, NULL },
+  { "vertex_array_ref_get/put", bench_vertex_array_ref, NULL },
+  { "vertex_attrib_array/remove", bench_vertex_attrib_array, NULL },
+  { "vertex_index_array", bench_vertex_index_array, NULL },
+  /* Shaders. */
+  { "create_shader", bench_create_shader, NULL },
+  { "create_shader_variant", bench_create_shader_variant, NULL },
+  { "create_shader_variant/miss", bench_create_shader_variant_miss, NULL },
+  { "shader_ref_get/put", bench_shader_ref, NULL },
+  { "get_shader_log", bench_get_shader_log, NULL },
+  { "is_shader_attached", bench_is_shader_attached, NULL },
+  { "shader_source", bench_shader_source, NULL },
+  /* Programs. */
+  { "attach/detach_shader", bench_attach_shader, NULL },
+  { "bind_program", bench_bind_program, NULL },
+  { "create_program", bench_create_program, NULL },
+  { "program_ref_get/put", bench_program_ref, NULL },
+  { "get_program_log", bench_get_program_log, NULL },
+  { "link_program", bench_link_program, NULL },
+  { "program_is_ready", bench_program_is_ready, NULL },
+  { "compile_mode", bench_compile_mode, NULL },
+  /* Uniforms. */
+  { "get_named_uniform", bench_get_named_uniform, NULL },
+  { "get_uniforms", bench_get_uniforms, NULL },
+  { "get_uniform_desc", bench_get_uniform_desc, NULL },
+  { "uniform_data", bench_uniform_data, NULL },
+  { "uniform_ref_get/put", bench_uniform_ref, NULL },
+  /* Attributes. */
+  { "get_attribs", bench_get_attribs, NULL },
+  { "get_named_attrib", bench_get_named_attrib, NULL },
+  { "attrib_data", bench_attrib_data, NULL },
+  { "get_attrib_desc", bench_get_attrib_desc, NULL },
+  { "attrib_ref_get/put", bench_attrib_ref, NULL },
+  /* Framebuffer. */
+  { "create_framebuffer", bench_create_framebuffer, NULL },
+  { "framebuffer_ref_get/put", bench_framebuffer_ref, NULL },
+  { "bind_framebuffer", bench_bind_framebuffer, NULL },
+  { "framebuffer_render_targets", bench_framebuffer_render_targets, NULL },
+  { "clear_framebuffer_render_targets",
+    bench_clear_framebuffer_render_targets, NULL },
+  { "read_back_framebuffer", bench_read_back_framebuffer, tex_sizes },
+  /* Command buffers. */
+  { "create_command_buffer", bench_create_command_buffer, NULL },
+  { "command_buffer_ref_get/put", bench_command_buffer_ref, NULL },
+  { "cmd_bind_program/uniform_data/draw", bench_cmd_draw, NULL },
+  { "submit_command_buffers", bench_submit_command_buffers, cmd_counts },
+  /* Bundles. */
+  { "create_bundle", bench_create_bundle, cmd_counts },
+  { "bundle_ref_get/put", bench_bundle_ref, NULL },
+  { "bundle_uniform_data", bench_bundle_uniform_data, NULL },
+  { "execute_bundle", bench_execute_bundle, cmd_counts },
+  /* Fences. */
+  { "create_fence", bench_create_fence, NULL },
+  { "fence_ref_get/put", bench_fence_ref, NULL },
+  { "wait_fence", bench_wait_fence, NULL },
+  { "poll_fence", bench_poll_fence, NULL },
+  /* Miscellaneous. */
+  { "blend", bench_blend, NULL },
+  { "clear", bench_clear, NULL },
+  { "depth_stencil", bench_depth_stencil, NULL },
+  { "draw", bench_draw, vertex_counts },
+  { "draw_indexed", bench_draw_indexed, vertex_counts },
+  { "multi_draw_indexed", bench_multi_draw_indexed, range_counts },
+  { "error_check", bench_error_check, NULL },
+  { "flush", bench_flush, NULL },
+  { "begin/end_frame", bench_begin_end_frame, NULL },
+  { "frame_alloc", bench_frame_alloc, alloc_sizes },
+  { "rasterizer", bench_rasterizer, NULL },
+  { "viewport", bench_viewport, NULL },
+  { "get_config", bench_get_config, NULL },
+  { "get_pool_stats", bench_get_pool_stats, NULL }
+};
+
+/* Run the benchmark at least `min_time' nanoseconds and print its results. */
+static int
+run_bench
+  (struct fixture* fix,
+   const struct bench* bench,
+   size_t size,
+   double min_time)
+{
+  struct timespec t0, t1;
+  double time = 0.0;
+  size_t nbytes = 0;
+  size_t nops = 1;
+
+  /* Warm up. */
+  if(0 != bench->run(fix, size, 1, &nbytes)
+  || 0 != sync_fixture(fix)
+  || 0 != reset_fixture(fix))
+    goto error;
+
+  for(;;) {
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if(0 != bench->run(fix, size, nops, &nbytes) || 0 != sync_fixture(fix))
+      goto error;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if(0 != reset_fixture(fix))
+      goto error;
+    time = elapsed_ns(&t0, &t1);
+    if(time >= min_time)
+      break;
+    /* Extrapolate the number of operations required to reach min_time. */
+    nops = time <= 0.0
+      ? nops * 16
+      : MAX((size_t)((double)nops * min_time * 1.2 / time), nops * 2);
+  }
+
+  printf("%-34s %10lu %14.1f", bench->name, (unsigned long)size,
+    time / (double)nops);
+  if(nbytes)
+    printf(" %12.1f\n", (double)nbytes / (time * 1.0e-9) / 1.0e6);
+  else
+    printf(" %12s\n", "-");
+  return 0;
+error:
+  fprintf(stderr, "%s: benchmark error.\n", bench->name);
+  return -1;
+}
+
+/*******************************************************************************
+ *
+ * Context scaling.
+ *
+ ******************************************************************************/
+/* Start line of the scaling threads. */
+struct scaling_start {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  size_t nready; /* Number of threads whose fixture is set up. */
+  int is_started;
+};
+
+/* Thread rendering frames onto its own context. */
+struct scaling_thread {
+  struct fixture fix;
+  struct scaling_start* start;
+  pthread_t thread;
+  double min_time; /* In nanoseconds. */
+  double time; /* In nanoseconds. */
+  size_t nframes;
+  int err;
+};
+
+/* Set up the fixture of the thread, and thus create its context, concurrently
+ * to the other threads. Then render frames, i.e. a clear, a draw and a read
+ * back, at least `min_time' nanoseconds once all the threads are ready. */
+static void*
+scaling_thread_func(void* arg)
+{
+  struct scaling_thread* thread = arg;
+  struct fixture* fix = &thread->fix;
+  struct scaling_start* start = thread->start;
+  const float color[4] = { 0.f, 0.f, 0.f, 1.f };
+  struct timespec t0, t1;
+  int err = 0;
+
+  err = setup_fixture(fix);
+  pthread_mutex_lock(&start->mutex);
+  ++start->nready;
+  pthread_cond_broadcast(&start->cond);
+  while(!start->is_started)
+    pthread_cond_wait(&start->cond, &start->mutex);
+  pthread_mutex_unlock(&start->mutex);
+  if(0 != err)
+    goto error;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  do {
+    if(0 != fix->rbi.clear(fix->ctxt, RB_CLEAR_COLOR_BIT, color, 1.f, 0)
+    || 0 != fix->rbi.draw(fix->ctxt, RB_TRIANGLE_LIST, SCALING_VERTICES)
+    || 0 != sync_fixture(fix))
+      goto error;
+    ++thread->nframes;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    thread->time = elapsed_ns(&t0, &t1);
+  } while(thread->time < thread->min_time);
+
+exit:
+  release_fixture(fix);
+  return NULL;
+error:
+  thread->err = -1;
+  goto exit;
+}
+
+/* Render with 1 to `max_contexts' contexts, each one being created and used by
+ * its own thread, and print the overall frame rate. */
+static int
+run_scaling(const struct rbi* rbi, size_t max_contexts, double min_time)
+{
+  struct scaling_start start;
+  struct scaling_thread* threads = NULL;
+  double rate_1 = 0.0;
+  size_t ncontexts = 0;
+  size_t i = 0;
+  int err = 0;
+
+  threads = calloc(max_contexts, sizeof(struct scaling_thread));
+  if(!threads)
+    return -1;
+  pthread_mutex_init(&start.mutex, NULL);
+  pthread_cond_init(&start.cond, NULL);
+
+  printf("%-34s %10s %14s %12s\n", "contexts", "frames", "frames/s",
+    "speedup");
+  for(ncontexts = 1; !err && ncontexts <= max_contexts; ++ncontexts) {
+    double rate = 0.0;
+    size_t nframes = 0;
+    size_t nthreads = 0;
+
+    start.nready = 0;
+    start.is_started = 0;
+    for(i = 0; i < ncontexts; ++i) {
+      memset(&threads[i], 0, sizeof(struct scaling_thread));
+      threads[i].fix.rbi = *rbi;
+      threads[i].start = &start;
+      threads[i].min_time = min_time;
+      if(0 != pthread_create
+         (&threads[i].thread, NULL, scaling_thread_func, threads + i)) {
+        err = -1;
+        break;
+      }
+      ++nthreads;
+    }
+    /* Start the threads even though one of them was not created, in order
+     * to join them. */
+    pthread_mutex_lock(&start.mutex);
+    while(start.nready < nthreads)
+      pthread_cond_wait(&start.cond, &start.mutex);
+    start.is_started = 1;
+    pthread_cond_broadcast(&start.cond);
+    pthread_mutex_unlock(&start.mutex);
+    for(i = 0; i < nthreads; ++i) {
+      pthread_join(threads[i].thread, NULL);
+      if(threads[i].err || threads[i].time <= 0.0) {
+        err = -1;
+      } else {
+        nframes += threads[i].nframes;
+        rate += (double)threads[i].nframes / (threads[i].time * 1.0e-9);
+      }
+    }
+    if(err)
+      break;
+    if(ncontexts == 1)
+      rate_1 = rate;
+    printf("%-34lu %10lu %14.1f %12.2f\n", (unsigned long)ncontexts,
+      (unsigned long)nframes, rate, rate / rate_1);
+  }
+
+  pthread_cond_destroy(&start.cond);
+  pthread_mutex_destroy(&start.mutex);
+  free(threads);
+  if(err)
+    fprintf(stderr, "Context scaling error.\n");
+  return err;
+}
+
+/*******************************************************************************
+ *
+ * Culling.
+ *
+ ******************************************************************************/
+/* Culling structures queried by the culling benchmarks. */
+struct culling {
+  struct rbu_cull_set* set;
+  struct rbu_bvh* bvh;
+  struct rbu_frustum frustum;
+  float* bounds; /* Lower and upper bounds of each object. */
+  unsigned int* visible_list;
+  size_t nb_objects;
+  unsigned int nb_visible;
+};
+
+/* Run `nops' operations of a culling benchmark. */
+typedef int
+(*run_culling_T)
+  (struct culling* cull, size_t nops);
+
+static int
+run_cull_set(struct culling* cull, size_t nops)
+{
+  size_t i = 0;
+  for(i = 0; i < nops; ++i) {
+    if(0 != rbu_cull_set_cull(cull->set, &cull->frustum, cull->visible_list,
+         &cull->nb_visible))
+      return -1;
+  }
+  return 0;
+}
+
+static int
+run_bvh_cull(struct culling* cull, size_t nops)
+{
+  size_t i = 0;
+  for(i = 0; i < nops; ++i) {
+    if(0 != rbu_bvh_cull(cull->bvh, &cull->frustum, cull->visible_list,
+         &cull->nb_visible))
+      return -1;
+  }
+  return 0;
+}
+
+/* Move 1% of the objects back and forth and refit the BVH. */
+static int
+run_bvh_refit(struct culling* cull, size_t nops)
+{
+  size_t i = 0;
+  size_t j = 0;
+  int k = 0;
+  for(i = 0; i < nops; ++i) {
+    const float offset = (i & 1) ? -1.f : 1.f;
+    for(j = i % 100; j < cull->nb_objects; j += 100) {
+      float* bounds = cull->bounds + j * 6;
+      for(k = 0; k < 6; ++k)
+        bounds[k] += offset;
+      if(0 != rbu_bvh_update
+         (cull->bvh, (unsigned int)j, bounds, bounds + 3))
+        return -1;
+    }
+    if(0 != rbu_bvh_commit(cull->bvh, NULL))
+      return -1;
+  }
+  return 0;
+}
+
+static int
+run_culling_bench
+  (struct culling* cull,
+   const char* name,
+   run_culling_T run,
+   double min_time)
+{
+  struct timespec t0, t1;
+  double time = 0.0;
+  size_t nops = 1;
+
+  for(;;) {
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if(0 != run(cull, nops))
+      goto error;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    time = elapsed_ns(&t0, &t1);
+    if(time >= min_time)
+      break;
+    nops = time <= 0.0
+      ? nops * 16
+      : MAX((size_t)((double)nops * min_time * 1.2 / time), nops * 2);
+  }
+  printf("%-34s %10lu %14.1f %12u\n", name, (unsigned long)cull->nb_objects,
+    time / (double)nops, cull->nb_visible);
+  return 0;
+error:
+  fprintf(stderr, "%s: culling benchmark error.\n", name);
+  return -1;
+}
+
+/* Cull `nb_objects' random boxes with a frustum seeing about 1/30 of them,
+ * by brute force and with a BVH, and refit the BVH after moving some of
+ * them. */
+static int
+run_culling(size_t nb_objects, double min_time)
+{
+  const struct rbu_bvh_desc bvh_desc = { 1.5f };
+  /* Perspective of vertical field of view of 60 degrees looking down -z,
+   * the depth being in [1, 1000]. */
+  const float proj[16] = {
+    1.732f, 0.f, 0.f, 0.f,
+    0.f, 1.732f, 0.f, 0.f,
+    0.f, 0.f, -1001.f / 999.f, -1.f,
+    0.f, 0.f, -2000.f / 999.f, 0.f
+  };
+  struct culling cull;
+  struct timespec t0, t1;
+  size_t i = 0;
+  int k = 0;
+  int err = 0;
+
+  memset(&cull, 0, sizeof(cull));
+  cull.nb_objects = nb_objects;
+  cull.bounds = malloc(nb_objects * 6 * sizeof(float));
+  cull.visible_list = malloc(nb_objects * sizeof(unsigned int));
+  if(!cull.bounds
+  || !cull.visible_list
+  || 0 != rbu_frustum_setup(&cull.frustum, proj)
+  || 0 != rbu_create_cull_set(NULL, 1, &cull.set)
+  || 0 != rbu_create_bvh(NULL, &bvh_desc, &cull.bvh))
+    goto error;
+
+  srand(0);
+  for(i = 0; i < nb_objects; ++i) {
+    float* bounds = cull.bounds + i * 6;
+    for(k = 0; k < 3; ++k) {
+      const float center = ((float)rand() / (float)RAND_MAX - 0.5f)
+        * WORLD_SIZE;
+      const float extent = 0.1f + 2.f * (float)rand() / (float)RAND_MAX;
+      bounds[k] = center - extent;
+      bounds[k + 3] = center + extent;
+    }
+    if(0 != rbu_cull_set_add
+       (cull.set, bounds, bounds + 3, 0.f, (unsigned int)i, NULL)
+    || 0 != rbu_bvh_add
+       (cull.bvh, bounds, bounds + 3, (unsigned int)i, NULL))
+      goto error;
+  }
+
+  printf("%-34s %10s %14s %12s\n", "culling", "objects", "ns/op",
+    "visible");
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  if(0 != rbu_bvh_commit(cull.bvh, NULL))
+    goto error;
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  printf("%-34s %10lu %14.1f %12s\n", "rbu_bvh_commit (build)",
+    (unsigned long)nb_objects, elapsed_ns(&t0, &t1), "-");
+
+  if(0 != run_culling_bench(&cull, "rbu_cull_set_cull", run_cull_set,
+       min_time)
+  || 0 != run_culling_bench(&cull, "rbu_bvh_cull", run_bvh_cull, min_time)
+  || 0 != run_culling_bench(&cull, "rbu_bvh_commit (refit 1%)",
+       run_bvh_refit, min_time)
+  || 0 != run_culling_bench(&cull, "rbu_bvh_cull (refitted)", run_bvh_cull,
+       min_time))
+    goto error;
+
+exit:
+  if(cull.set)
+    rbu_cull_set_ref_put(cull.set);
+  if(cull.bvh)
+    rbu_bvh_ref_put(cull.bvh);
+  free(cull.bounds);
+  free(cull.visible_list);
+  return err;
+error:
+  fprintf(stderr, "Culling error.\n");
+  err = -1;
+  goto exit;
+}
+
+/*******************************************************************************
+ *
+ * Program entry point.
+ *
+ ******************************************************************************/
+int
+main(int argc, char** argv)
+{
+  struct fixture fix;
+  const char* filter = NULL;
+  double min_time = 100.0; /* In milliseconds. */
+  long max_contexts = 0;
+  long nb_objects = 0;
+  size_t i = 0;
+  int is_rbi_init = 0;
+  int iarg = 1;
+  int err = 0;
+
+  memset(&fix, 0, sizeof(fix));
+
+  for(iarg = 1; iarg < argc - 1; iarg += 2) {
+    if(!strcmp(argv[iarg], "-f")) {
+      filter = argv[iarg + 1];
+    } else if(!strcmp(argv[iarg], "-t")) {
+      min_time = atof(argv[iarg + 1]);
+    } else if(!strcmp(argv[iarg], "-n")) {
+      max_contexts = atol(argv[iarg + 1]);
+    } else if(!strcmp(argv[iarg], "-c")) {
+      nb_objects = atol(argv[iarg + 1]);
+    } else {
+      break;
+    }
+  }
+  if(iarg != argc - 1
+  || min_time <= 0.0
+  || max_contexts < 0
+  || nb_objects < 0) {
+    printf("usage: %s [-f FILTER] [-t MIN_TIME_MS] [-n MAX_CONTEXTS] "
+      "[-c NB_OBJECTS] RB_DRIVER\n", argv[0]);
+    return -1;
+  }
+  /* The culling does not rely on the driver. */
+  if(nb_objects)
+    return run_culling((size_t)nb_objects, min_time * 1.0e6);
+
+  if(0 != rbi_init(argv[iarg], &fix.rbi))
+    goto error;
+  is_rbi_init = 1;
+  /* The context scaling replaces the benchmarks of the functions. */
+  if(max_contexts) {
+    if(0 != run_scaling(&fix.rbi, (size_t)max_contexts, min_time * 1.0e6))
+      goto error;
+    goto exit;
+  }
+  if(0 != setup_fixture(&fix)) {
+    fprintf(stderr, "Cannot setup the benchmark fixture.\n");
+    goto error;
+  }
+
+  printf("%-34s %10s %14s %12s\n", "function", "size", "ns/op", "MB/s");
+  for(i = 0; i < sizeof(bench_list) / sizeof(bench_list[0]); ++i) {
+    const struct bench* bench = bench_list + i;
+    if(filter && !strstr(bench->name, filter))
+      continue;
+    if(!bench->sizes) {
+      if(0 != run_bench(&fix, bench, 0, min_time * 1.0e6))
+        err = -1;
+    } else {
+      const size_t* size = NULL;
+      for(size = bench->sizes; *size; ++size) {
+        if(0 != run_bench(&fix, bench, *size, min_time * 1.0e6))
+          err = -1;
+      }
+    }
+  }
+
+exit:
+  release_fixture(&fix);
+  if(is_rbi_init)
+    rbi_shutdown(&fix.rbi);
+  return err;
+error:
+  err = -1;
+  goto exit;
+}
@@ -0,0 +1,764 @@
+#include "common/rb_command_list.h"
+#include "rb.h"
+#include <snlsys/math.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/snlsys.h>
+#include <string.h>
+
+/* Alignment of the encoded commands. */
+#define COMMAND_ALIGNMENT 8
+/* Minimum size in bytes of the command stream. */
+#define STREAM_MIN_SIZE 1024
+
+enum command_type {
+  CMD_BIND_PROGRAM,
+  CMD_BIND_VERTEX_ARRAY,
+  CMD_BIND_TEX2D,
+  CMD_BIND_SAMPLER,
+  CMD_BIND_FRAMEBUFFER,
+  CMD_BLEND,
+  CMD_DEPTH_STENCIL,
+  CMD_RASTERIZER,
+  CMD_VIEWPORT,
+  CMD_CLEAR,
+  CMD_UNIFORM_DATA,
+  CMD_BUFFER_DATA,
+  CMD_DRAW,
+  CMD_DRAW_INDEXED,
+  COMMAND_TYPES_COUNT
+};
+
+/* The encoded commands begin with their type. */
+struct cmd_bind {
+  enum command_type type;
+  unsigned int tex_unit;
+  void* object;
+};
+
+struct cmd_blend {
+  enum command_type type;
+  struct rb_blend_desc desc;
+};
+
+struct cmd_depth_stencil {
+  enum command_type type;
+  struct rb_depth_stencil_desc desc;
+};
+
+struct cmd_rasterizer {
+  enum command_type type;
+  struct rb_rasterizer_desc desc;
+};
+
+struct cmd_viewport {
+  enum command_type type;
+  struct rb_viewport_desc desc;
+};
+
+struct cmd_clear {
+  enum command_type type;
+  int flag;
+  int has_color;
+  float color[4];
+  float depth;
+  char stencil;
+};
+
+struct cmd_uniform_data {
+  enum command_type type;
+  int count;
+  size_t size; /* Size in bytes of the data. */
+  struct rb_uniform* uniform;
+  const void* data; /* Lies in the payloads. */
+};
+
+struct cmd_buffer_data {
+  enum command_type type;
+  int offset;
+  int size;
+  struct rb_buffer* buffer;
+  const void* data; /* Lies in the payloads. NULL if size is 0. */
+};
+
+struct cmd_draw {
+  enum command_type type;
+  enum rb_primitive_type prim_type;
+  unsigned int count;
+};
+
+static const size_t command_sizes[COMMAND_TYPES_COUNT] = {
+  [CMD_BIND_PROGRAM] = sizeof(struct cmd_bind),
+  [CMD_BIND_VERTEX_ARRAY] = sizeof(struct cmd_bind),
+  [CMD_BIND_TEX2D] = sizeof(struct cmd_bind),
+  [CMD_BIND_SAMPLER] = sizeof(struct cmd_bind),
+  [CMD_BIND_FRAMEBUFFER] = sizeof(struct cmd_bind),
+  [CMD_BLEND] = sizeof(struct cmd_blend),
+  [CMD_DEPTH_STENCIL] = sizeof(struct cmd_depth_stencil),
+  [CMD_RASTERIZER] = sizeof(struct cmd_rasterizer),
+  [CMD_VIEWPORT] = sizeof(struct cmd_viewport),
+  [CMD_CLEAR] = sizeof(struct cmd_clear),
+  [CMD_UNIFORM_DATA] = sizeof(struct cmd_uniform_data),
+  [CMD_BUFFER_DATA] = sizeof(struct cmd_buffer_data),
+  [CMD_DRAW] = sizeof(struct cmd_draw),
+  [CMD_DRAW_INDEXED] = sizeof(struct cmd_draw)
+};
+
+/* Maximum number of texture units whose bindings are tracked by the bake. */
+#define BAKE_MAX_TEX_UNITS 32
+
+/* Pipeline states tracked by the bake. They are emitted in this order, the
+ * framebuffer first, since the rb states do not depend on each other. */
+enum bake_slot {
+  SLOT_FRAMEBUFFER,
+  SLOT_VIEWPORT,
+  SLOT_RASTERIZER,
+  SLOT_DEPTH_STENCIL,
+  SLOT_BLEND,
+  SLOT_PROGRAM,
+  SLOT_VERTEX_ARRAY,
+  SLOT_TEX2D,
+  SLOT_SAMPLER = SLOT_TEX2D + BAKE_MAX_TEX_UNITS,
+  SLOTS_COUNT = SLOT_SAMPLER + BAKE_MAX_TEX_UNITS
+};
+
+/* Last recorded and last emitted command of each state. The commands lie in
+ * the source list and are compared on their encoding, zeroed padding
+ * included. A NULL emitted command means that the state is unknown at the
+ * beginning of the execution and must be thus emitted once. */
+struct bake_state {
+  const void* pending[SLOTS_COUNT];
+  const void* emitted[SLOTS_COUNT];
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static FINLINE size_t
+sizeof_command(enum command_type type)
+{
+  ASSERT(type < COMMAND_TYPES_COUNT);
+  return (command_sizes[type] + COMMAND_ALIGNMENT - 1)
+    & ~((size_t)COMMAND_ALIGNMENT - 1);
+}
+
+/* Append a zeroed command of `type' to the stream. Return NULL on allocation
+ * failure. */
+static void*
+push_command(struct rb_command_list* list, enum command_type type)
+{
+  const size_t size = sizeof_command(type);
+  void* cmd = NULL;
+  ASSERT(list);
+
+  if(list->size + size > list->capacity) {
+    const size_t capacity = MAX
+      (MAX(list->capacity * 2, list->size + size), STREAM_MIN_SIZE);
+    unsigned char* stream = MEM_REALLOC(list->allocator, list->stream,capacity);
+    if(!stream)
+      return NULL;
+    list->stream = stream;
+    list->capacity = capacity;
+  }
+  cmd = list->stream + list->size;
+  memset(cmd, 0, size);
+  *(enum command_type*)cmd = type;
+  list->size += size;
+  ++list->nb_commands;
+  return cmd;
+}
+
+static int
+encode_bind
+  (struct rb_command_list* list,
+   enum command_type type,
+   void* object,
+   unsigned int tex_unit)
+{
+  struct cmd_bind* cmd = NULL;
+  ASSERT(list);
+
+  cmd = push_command(list, type);
+  if(!cmd)
+    return -1;
+  cmd->object = object;
+  cmd->tex_unit = tex_unit;
+  return 0;
+}
+
+/* Copy `size' bytes of `data' into the payloads of the list. */
+static const void*
+copy_payload(struct rb_command_list* list, const void* data, size_t size)
+{
+  void* mem = NULL;
+  ASSERT(list && data && size);
+
+  mem = rb_arena_alloc(&list->payloads, size);
+  if(mem)
+    memcpy(mem, data, size);
+  return mem;
+}
+
+/* Copy the command `src' and its payload at the end of `list'. */
+static int
+copy_command(struct rb_command_list* list, const void* src)
+{
+  struct rb_arena_mark mark;
+  const enum command_type type = *(const enum command_type*)src;
+  const void* payload = NULL;
+  void* cmd = NULL;
+  ASSERT(list && src);
+
+  rb_arena_mark(&list->payloads, &mark);
+  if(type == CMD_UNIFORM_DATA) {
+    const struct cmd_uniform_data* uniform_data = src;
+    payload = copy_payload(list, uniform_data->data, uniform_data->size);
+    if(!payload)
+      return -1;
+  } else if(type == CMD_BUFFER_DATA) {
+    const struct cmd_buffer_data* buffer_data = src;
+    if(buffer_data->size) {
+      payload = copy_payload
+        (list, buffer_data->data, (size_t)buffer_data->size);
+      if(!payload)
+        return -1;
+    }
+  }
+  if(!(cmd = push_command(list, type))) {
+    rb_arena_restore(&list->payloads, &mark);
+    return -1;
+  }
+  memcpy(cmd, src, command_sizes[type]);
+  if(type == CMD_UNIFORM_DATA)
+    ((struct cmd_uniform_data*)cmd)->data = payload;
+  else if(type == CMD_BUFFER_DATA)
+    ((struct cmd_buffer_data*)cmd)->data = payload;
+  return 0;
+}
+
+/* Return the state set by the command `cmd' or SLOTS_COUNT if it is not a
+ * state command. */
+static size_t
+command_slot(const void* cmd)
+{
+  const struct cmd_bind* bind = cmd;
+  ASSERT(cmd);
+
+  switch(bind->type) {
+    case CMD_BIND_PROGRAM: return SLOT_PROGRAM;
+    case CMD_BIND_VERTEX_ARRAY: return SLOT_VERTEX_ARRAY;
+    case CMD_BIND_TEX2D: return SLOT_TEX2D + bind->tex_unit;
+    case CMD_BIND_SAMPLER: return SLOT_SAMPLER + bind->tex_unit;
+    case CMD_BIND_FRAMEBUFFER: return SLOT_FRAMEBUFFER;
+    case CMD_BLEND: return SLOT_BLEND;
+    case CMD_DEPTH_STENCIL: return SLOT_DEPTH_STENCIL;
+    case CMD_RASTERIZER: return SLOT_RASTERIZER;
+    case CMD_VIEWPORT: return SLOT_VIEWPORT;
+    default: return SLOTS_COUNT;
+  }
+}
+
+/* Emit the recorded states that differ from the emitted ones. */
+static int
+flush_states(struct rb_command_list* list, struct bake_state* state)
+{
+  size_t i = 0;
+  ASSERT(list && state);
+
+  for(i = 0; i < SLOTS_COUNT; ++i) {
+    const void* cmd = state->pending[i];
+    if(!cmd)
+      continue;
+    state->pending[i] = NULL;
+    if(state->emitted[i] && !memcmp(cmd, state->emitted[i],
+       command_sizes[*(const enum command_type*)cmd]))
+      continue;
+    if(copy_command(list, cmd) != 0)
+      return -1;
+    state->emitted[i] = cmd;
+  }
+  return 0;
+}
+
+/* Invoke the ref_get or the ref_put function of the objects referenced by the
+ * commands of `list'. */
+static void
+ref_objects(const struct rb_command_list* list, int is_get)
+{
+  size_t offset = 0;
+  ASSERT(list);
+
+  #define REF(Type, Object) \
+    if(Object) { \
+      if(is_get) \
+        rb_##Type##_ref_get(Object); \
+      else \
+        rb_##Type##_ref_put(Object); \
+    } (void)0
+  while(offset < list->size) {
+    const void* cmd = list->stream + offset;
+    const enum command_type type = *(const enum command_type*)cmd;
+    const struct cmd_bind* bind = cmd;
+
+    switch(type) {
+      case CMD_BIND_PROGRAM: REF(program, bind->object); break;
+      case CMD_BIND_VERTEX_ARRAY: REF(vertex_array, bind->object); break;
+      case CMD_BIND_TEX2D: REF(tex2d, bind->object); break;
+      case CMD_BIND_SAMPLER: REF(sampler, bind->object); break;
+      case CMD_BIND_FRAMEBUFFER: REF(framebuffer, bind->object); break;
+      case CMD_UNIFORM_DATA:
+        REF(uniform, ((const struct cmd_uniform_data*)cmd)->uniform);
+        break;
+      case CMD_BUFFER_DATA:
+        REF(buffer, ((const struct cmd_buffer_data*)cmd)->buffer);
+        break;
+      default: /* No object. */ break;
+    }
+    offset += sizeof_command(type);
+  }
+  #undef REF
+}
+
+/*******************************************************************************
+ *
+ * Command list functions.
+ *
+ ******************************************************************************/
+void
+rb_init_command_list
+  (struct mem_allocator* allocator,
+   struct rb_command_list* list)
+{
+  ASSERT(allocator && list);
+  memset(list, 0, sizeof(struct rb_command_list));
+  list->allocator = allocator;
+  rb_init_arena(allocator, &list->payloads);
+}
+
+void
+rb_release_command_list(struct rb_command_list* list)
+{
+  ASSERT(list);
+  if(list->stream)
+    MEM_FREE(list->allocator, list->stream);
+  rb_release_arena(&list->payloads);
+  memset(list, 0, sizeof(struct rb_command_list));
+}
+
+void
+rb_clear_command_list(struct rb_command_list* list)
+{
+  ASSERT(list);
+  list->size = 0;
+  list->nb_commands = 0;
+  rb_reset_arena(&list->payloads);
+}
+
+int
+rb_encode_bind_program
+  (struct rb_command_list* list,
+   struct rb_program* prog)
+{
+  return encode_bind(list, CMD_BIND_PROGRAM, prog, 0);
+}
+
+int
+rb_encode_bind_vertex_array
+  (struct rb_command_list* list,
+   struct rb_vertex_array* varray)
+{
+  return encode_bind(list, CMD_BIND_VERTEX_ARRAY, varray, 0);
+}
+
+int
+rb_encode_bind_tex2d
+  (struct rb_command_list* list,
+   struct rb_tex2d* tex,
+   unsigned int tex_unit)
+{
+  return encode_bind(list, CMD_BIND_TEX2D, tex, tex_unit);
+}
+
+int
+rb_encode_bind_sampler
+  (struct rb_command_list* list,
+   struct rb_sampler* sampler,
+   unsigned int tex_unit)
+{
+  return encode_bind(list, CMD_BIND_SAMPLER, sampler, tex_unit);
+}
+
+int
+rb_encode_bind_framebuffer
+  (struct rb_command_list* list,
+   struct rb_framebuffer* buffer)
+{
+  return encode_bind(list, CMD_BIND_FRAMEBUFFER, buffer, 0);
+}
+
+int
+rb_encode_blend
+  (struct rb_command_list* list,
+   const struct rb_blend_desc* desc)
+{
+  struct cmd_blend* cmd = NULL;
+  ASSERT(list);
+
+  if(!desc || !(cmd = push_command(list, CMD_BLEND)))
+    return -1;
+  cmd->desc = *desc;
+  return 0;
+}
+
+int
+rb_encode_depth_stencil
+  (struct rb_command_list* list,
+   const struct rb_depth_stencil_desc* desc)
+{
+  struct cmd_depth_stencil* cmd = NULL;
+  ASSERT(list);
+
+  if(!desc || !(cmd = push_command(list, CMD_DEPTH_STENCIL)))
+    return -1;
+  cmd->desc = *desc;
+  return 0;
+}
+
+int
+rb_encode_rasterizer
+  (struct rb_command_list* list,
+   const struct rb_rasterizer_desc* desc)
+{
+  struct cmd_rasterizer* cmd = NULL;
+  ASSERT(list);
+
+  if(!desc || !(cmd = push_command(list, CMD_RASTERIZER)))
+    return -1;
+  cmd->desc = *desc;
+  return 0;
+}
+
+int
+rb_encode_viewport
+  (struct rb_command_list* list,
+   const struct rb_viewport_desc* desc)
+{
+  struct cmd_viewport* cmd = NULL;
+  ASSERT(list);
+
+  if(!desc || !(cmd = push_command(list, CMD_VIEWPORT)))
+    return -1;
+  cmd->desc = *desc;
+  return 0;
+}
+
+int
+rb_encode_clear
+  (struct rb_command_list* list,
+   int clear_flag,
+   const float color_val[4],
+   float depth_val,
+   char stencil_val)
+{
+  struct cmd_clear* cmd = NULL;
+  ASSERT(list);
+
+  if(((clear_flag & RB_CLEAR_COLOR_BIT) && !color_val)
+  || !(cmd = push_command(list, CMD_CLEAR)))
+    return -1;
+  cmd->flag = clear_flag;
+  cmd->has_color = color_val != NULL;
+  if(color_val)
+    memcpy(cmd->color, color_val, sizeof(cmd->color));
+  cmd->depth = depth_val;
+  cmd->stencil = stencil_val;
+  return 0;
+}
+
+int
+rb_encode_uniform_data
+  (struct rb_command_list* list,
+   struct rb_uniform* uniform,
+   int count,
+   size_t size,
+   const void* data)
+{
+  struct rb_arena_mark mark;
+  struct cmd_uniform_data* cmd = NULL;
+  const void* payload = NULL;
+  ASSERT(list);
+
+  if(!uniform || count <= 0 || !size || !data)
+    return -1;
+
+  rb_arena_mark(&list->payloads, &mark);
+  if(!(payload = copy_payload(list, data, size))
+  || !(cmd = push_command(list, CMD_UNIFORM_DATA))) {
+    rb_arena_restore(&list->payloads, &mark);
+    return -1;
+  }
+  cmd->uniform = uniform;
+  cmd->count = count;
+  cmd->size = size;
+  cmd->data = payload;
+  return 0;
+}
+
+int
+rb_encode_buffer_data
+  (struct rb_command_list* list,
+   struct rb_buffer* buf,
+   int offset,
+   int size,
+   const void* data)
+{
+  struct rb_arena_mark mark;
+  struct cmd_buffer_data* cmd = NULL;
+  const void* payload = NULL;
+  ASSERT(list);
+
+  if(!buf || offset < 0 || size < 0 || (size != 0 && !data))
+    return -1;
+
+  rb_arena_mark(&list->payloads, &mark);
+  if((size && !(payload = copy_payload(list, data, (size_t)size)))
+  || !(cmd = push_command(list, CMD_BUFFER_DATA))) {
+    rb_arena_restore(&list->payloads, &mark);
+    return -1;
+  }
+  cmd->buffer = buf;
+  cmd->offset = offset;
+  cmd->size = size;
+  cmd->data = payload;
+  return 0;
+}
+
+int
+rb_encode_draw
+  (struct rb_command_list* list,
+   enum rb_primitive_type prim_type,
+   unsigned int count)
+{
+  struct cmd_draw* cmd = NULL;
+  ASSERT(list);
+
+  if(!(cmd = push_command(list, CMD_DRAW)))
+    return -1;
+  cmd->prim_type = prim_type;
+  cmd->count = count;
+  return 0;
+}
+
+int
+rb_encode_draw_indexed
+  (struct rb_command_list* list,
+   enum rb_primitive_type prim_type,
+   unsigned int count)
+{
+  struct cmd_draw* cmd = NULL;
+  ASSERT(list);
+
+  if(!(cmd = push_command(list, CMD_DRAW_INDEXED)))
+    return -1;
+  cmd->prim_type = prim_type;
+  cmd->count = count;
+  return 0;
+}
+
+int
+rb_execute_command_list
+  (struct rb_context* ctxt,
+   const struct rb_command_list* list)
+{
+  size_t offset = 0;
+  int err = 0;
+  ASSERT(ctxt && list);
+
+  while(offset < list->size) {
+    const void* cmd = list->stream + offset;
+    const enum command_type type = *(const enum command_type*)cmd;
+    const struct cmd_bind* bind = cmd;
+    int res = 0;
+
+    switch(type) {
+      case CMD_BIND_PROGRAM:
+        res = rb_bind_program(ctxt, bind->object);
+        break;
+      case CMD_BIND_VERTEX_ARRAY:
+        res = rb_bind_vertex_array(ctxt, bind->object);
+        break;
+      case CMD_BIND_TEX2D:
+        res = rb_bind_tex2d(ctxt, bind->object, bind->tex_unit);
+        break;
+      case CMD_BIND_SAMPLER:
+        res = rb_bind_sampler(ctxt, bind->object, bind->tex_unit);
+        break;
+      case CMD_BIND_FRAMEBUFFER:
+        res = rb_bind_framebuffer(ctxt, bind->object);
+        break;
+      case CMD_BLEND:
+        res = rb_blend(ctxt, &((const struct cmd_blend*)cmd)->desc);
+        break;
+      case CMD_DEPTH_STENCIL:
+        res = rb_depth_stencil
+          (ctxt, &((const struct cmd_depth_stencil*)cmd)->desc);
+        break;
+      case CMD_RASTERIZER:
+        res = rb_rasterizer(ctxt, &((const struct cmd_rasterizer*)cmd)->desc);
+        break;
+      case CMD_VIEWPORT:
+        res = rb_viewport(ctxt, &((const struct cmd_viewport*)cmd)->desc);
+        break;
+      case CMD_CLEAR: {
+        const struct cmd_clear* clear = cmd;
+        res = rb_clear(ctxt, clear->flag,
+          clear->has_color ? clear->color : NULL, clear->depth,
+          clear->stencil);
+      } break;
+      case CMD_UNIFORM_DATA: {
+        const struct cmd_uniform_data* uniform_data = cmd;
+        res = rb_uniform_data
+          (uniform_data->uniform, uniform_data->count, uniform_data->data);
+      } break;
+      case CMD_BUFFER_DATA: {
+        const struct cmd_buffer_data* buffer_data = cmd;
+        res = rb_buffer_data(buffer_data->buffer, buffer_data->offset,
+          buffer_data->size, buffer_data->data);
+      } break;
+      case CMD_DRAW: {
+        const struct cmd_draw* draw = cmd;
+        res = rb_draw(ctxt, draw->prim_type, draw->count);
+      } break;
+      case CMD_DRAW_INDEXED: {
+        const struct cmd_draw* draw = cmd;
+        res = rb_draw_indexed(ctxt, draw->prim_type, draw->count);
+      } break;
+      default: ASSERT(0); break;
+    }
+    if(res != 0)
+      err = -1;
+    offset += sizeof_command(type);
+  }
+  return err;
+}
+
+int
+rb_bake_command_list
+  (struct rb_command_list* dst,
+   const struct rb_command_list* src,
+   unsigned int max_tex_units)
+{
+  struct bake_state state;
+  size_t offset = 0;
+  ASSERT(dst && src && dst != src);
+
+  if(max_tex_units > BAKE_MAX_TEX_UNITS)
+    return -1;
+
+  /* Validate the commands beforehand. */
+  while(offset < src->size) {
+    const void* cmd = src->stream + offset;
+    const enum command_type type = *(const enum command_type*)cmd;
+    const struct cmd_draw* draw = cmd;
+
+    switch(type) {
+      case CMD_BIND_TEX2D:
+      case CMD_BIND_SAMPLER:
+        if(((const struct cmd_bind*)cmd)->tex_unit >= max_tex_units)
+          return -1;
+        break;
+      case CMD_DRAW:
+      case CMD_DRAW_INDEXED:
+        if(draw->prim_type != RB_LINES
+        && draw->prim_type != RB_LINE_LOOP
+        && draw->prim_type != RB_TRIANGLE_LIST
+        && draw->prim_type != RB_TRIANGLE_STRIP)
+          return -1;
+        break;
+      default: /* Validated on encoding. */ break;
+    }
+    offset += sizeof_command(type);
+  }
+
+  /* The states set between two commands that depend on them are merged: only
+   * the last one is kept and only if it changes the emitted state. The
+   * uniform and buffer updates do not depend on the bound states. */
+  memset(&state, 0, sizeof(state));
+  for(offset = 0; offset < src->size;) {
+    const void* cmd = src->stream + offset;
+    const enum command_type type = *(const enum command_type*)cmd;
+    const size_t slot = command_slot(cmd);
+
+    if(slot != SLOTS_COUNT) {
+      state.pending[slot] = cmd;
+    } else {
+      if((type == CMD_CLEAR || type == CMD_DRAW || type == CMD_DRAW_INDEXED)
+      && flush_states(dst, &state) != 0)
+        return -1;
+      if(copy_command(dst, cmd) != 0)
+        return -1;
+    }
+    offset += sizeof_command(type);
+  }
+  /* The bundle leaves the context in its last recorded states. */
+  return flush_states(dst, &state);
+}
+
+int
+rb_patch_uniform_data
+  (struct rb_command_list* list,
+   struct rb_uniform* uniform,
+   int count,
+   size_t size,
+   const void* data)
+{
+  size_t offset = 0;
+  int nb_patches = 0;
+  ASSERT(list);
+
+  if(!uniform || count <= 0 || !size || !data)
+    return -1;
+
+  /* Check all the commands before patching anything. */
+  for(offset = 0; offset < list->size; ) {
+    const void* cmd = list->stream + offset;
+    const enum command_type type = *(const enum command_type*)cmd;
+    const struct cmd_uniform_data* uniform_data = cmd;
+
+    if(type == CMD_UNIFORM_DATA && uniform_data->uniform == uniform) {
+      if(size > uniform_data->size)
+        return -1;
+      ++nb_patches;
+    }
+    offset += sizeof_command(type);
+  }
+  if(!nb_patches)
+    return -1;
+
+  for(offset = 0; offset < list->size; ) {
+    void* cmd = list->stream + offset;
+    const enum command_type type = *(const enum command_type*)cmd;
+    struct cmd_uniform_data* uniform_data = cmd;
+
+    if(type == CMD_UNIFORM_DATA && uniform_data->uniform == uniform) {
+      /* The payload of the command is owned by the list. */
+      memcpy((void*)uniform_data->data, data, size);
+      uniform_data->count = count;
+    }
+    offset += sizeof_command(type);
+  }
+  return 0;
+}
+
+void
+rb_command_list_ref_get_objects(const struct rb_command_list* list)
+{
+  ref_objects(list, 1);
+}
+
+void
+rb_command_list_ref_put_objects(const struct rb_command_list* list)
+{
+  ref_objects(list, 0);
+}
@@ -0,0 +1,166 @@
+#ifndef RB_COMMAND_LIST_H
+#define RB_COMMAND_LIST_H
+
+#include "common/rb_pool.h"
+#include "rb_types.h"
+#include <snlsys/snlsys.h>
+#include <stddef.h>
+
+/*******************************************************************************
+ *
+ * Linear encoding of the rb commands recorded by the command buffers. The
+ * commands are packed into one stream as compact records whose data, e.g. the
+ * uniform values, are copied into an arena. A list is recorded by one thread
+ * at a time and is executed by the thread of its context.
+ *
+ ******************************************************************************/
+struct mem_allocator;
+
+struct rb_command_list {
+  struct mem_allocator* allocator;
+  unsigned char* stream; /* Encoded commands. */
+  size_t size; /* Used bytes of the stream. */
+  size_t capacity; /* Allocated bytes of the stream. */
+  size_t nb_commands;
+  struct rb_arena payloads; /* Data referenced by the commands. */
+};
+
+LOCAL_SYM void
+rb_init_command_list
+  (struct mem_allocator* allocator,
+   struct rb_command_list* list);
+
+LOCAL_SYM void
+rb_release_command_list
+  (struct rb_command_list* list);
+
+/* Remove the commands and keep the memory for the subsequent recording. */
+LOCAL_SYM void
+rb_clear_command_list
+  (struct rb_command_list* list);
+
+/* Encode a command. The arguments are validated as far as they do not depend
+ * on the execution state. Return -1 without encoding anything on error. */
+LOCAL_SYM int
+rb_encode_bind_program
+  (struct rb_command_list* list,
+   struct rb_program* prog);
+
+LOCAL_SYM int
+rb_encode_bind_vertex_array
+  (struct rb_command_list* list,
+   struct rb_vertex_array* varray);
+
+LOCAL_SYM int
+rb_encode_bind_tex2d
+  (struct rb_command_list* list,
+   struct rb_tex2d* tex,
+   unsigned int tex_unit);
+
+LOCAL_SYM int
+rb_encode_bind_sampler
+  (struct rb_command_list* list,
+   struct rb_sampler* sampler,
+   unsigned int tex_unit);
+
+LOCAL_SYM int
+rb_encode_bind_framebuffer
+  (struct rb_command_list* list,
+   struct rb_framebuffer* buffer);
+
+LOCAL_SYM int
+rb_encode_blend
+  (struct rb_command_list* list,
+   const struct rb_blend_desc* desc);
+
+LOCAL_SYM int
+rb_encode_depth_stencil
+  (struct rb_command_list* list,
+   const struct rb_depth_stencil_desc* desc);
+
+LOCAL_SYM int
+rb_encode_rasterizer
+  (struct rb_command_list* list,
+   const struct rb_rasterizer_desc* desc);
+
+LOCAL_SYM int
+rb_encode_viewport
+  (struct rb_command_list* list,
+   const struct rb_viewport_desc* desc);
+
+LOCAL_SYM int
+rb_encode_clear
+  (struct rb_command_list* list,
+   int clear_flag,
+   const float color_val[4],
+   float depth_val,
+   char stencil_val);
+
+/* The `size' bytes of `data' are the values of the `count' first elements of
+ * the uniform as defined by the backend. */
+LOCAL_SYM int
+rb_encode_uniform_data
+  (struct rb_command_list* list,
+   struct rb_uniform* uniform,
+   int count,
+   size_t size,
+   const void* data);
+
+LOCAL_SYM int
+rb_encode_buffer_data
+  (struct rb_command_list* list,
+   struct rb_buffer* buf,
+   int offset,
+   int size,
+   const void* data);
+
+LOCAL_SYM int
+rb_encode_draw
+  (struct rb_command_list* list,
+   enum rb_primitive_type prim_type,
+   unsigned int count);
+
+LOCAL_SYM int
+rb_encode_draw_indexed
+  (struct rb_command_list* list,
+   enum rb_primitive_type prim_type,
+   unsigned int count);
+
+/* Invoke the rb functions of the commands in their recording order. The
+ * execution goes on after a failed command whose error is then returned. */
+LOCAL_SYM int
+rb_execute_command_list
+  (struct rb_context* ctxt,
+   const struct rb_command_list* list);
+
+/* Append to `dst' the commands of `src' validated and optimized for their
+ * replay. The redundant state commands are removed and the successive state
+ * commands are merged. The texture units must be less than `max_tex_units'.
+ * Return -1 if a command is invalid; `dst' may be then partially filled. */
+LOCAL_SYM int
+rb_bake_command_list
+  (struct rb_command_list* dst,
+   const struct rb_command_list* src,
+   unsigned int max_tex_units);
+
+/* Overwrite the values of the uniform data commands of `uniform'. Return -1
+ * without patching anything if no command sets `uniform' or if one of them
+ * was recorded with less than `size' bytes. */
+LOCAL_SYM int
+rb_patch_uniform_data
+  (struct rb_command_list* list,
+   struct rb_uniform* uniform,
+   int count,
+   size_t size,
+   const void* data);
+
+/* Get or put a reference onto each object recorded by the commands. */
+LOCAL_SYM void
+rb_command_list_ref_get_objects
+  (const struct rb_command_list* list);
+
+LOCAL_SYM void
+rb_command_list_ref_put_objects
+  (const struct rb_command_list* list);
+
+#endif /* RB_COMMAND_LIST_H */
@@ -0,0 +1,31 @@
+#ifndef RB_HASH_H
+#define RB_HASH_H
+
+#include <snlsys/snlsys.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************
+ *
+ * 64-bits FNV-1a hash shared by the backends and the rbu library. A hash is
+ * started from RB_HASH_SEED and each rb_hash call continues it with the next
+ * `size' bytes.
+ *
+ ******************************************************************************/
+#define RB_HASH_SEED 0xCBF29CE484222325ull
+
+static FINLINE uint64_t
+rb_hash(uint64_t hash, const void* data, size_t size)
+{
+  const unsigned char* bytes = data;
+  size_t i = 0;
+  ASSERT(data || !size);
+
+  for(i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001B3ull;
+  }
+  return hash;
+}
+
+#endif /* RB_HASH_H */
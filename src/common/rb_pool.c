@@ -0,0 +1,391 @@
+#include "common/rb_hash.h"
+#include "common/rb_pool.h"
+#include <snlsys/math.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/snlsys.h>
+#include <string.h>
+
+/* Alignment of the slots, large enough for any object member. */
+#define SLOT_ALIGNMENT 16
+#define PAGE_SIZE 4096
+#define MIN_SLOTS_PER_PAGE 8
+#define CHUNK_SIZE 4096
+#define BLOCK_SIZE 16384
+
+/* The slots of a page follow its header. */
+struct rb_slab_page {
+  struct rb_slab_page* next;
+};
+
+#define ALIGN_SLOT(size) \
+  (((size) + SLOT_ALIGNMENT - 1) & ~(size_t)(SLOT_ALIGNMENT - 1))
+#define PAGE_HEADER_SIZE ALIGN_SLOT(sizeof(struct rb_slab_page))
+
+/* The strings of a chunk follow its header. */
+struct rb_string_chunk {
+  struct rb_string_chunk* next;
+  size_t size;
+};
+
+/* The memory of a block follows its header. */
+struct rb_arena_block {
+  struct rb_arena_block* next;
+  size_t size;
+};
+
+#define BLOCK_HEADER_SIZE ALIGN_SLOT(sizeof(struct rb_arena_block))
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static FINLINE void*
+next_free_slot(void* slot)
+{
+  return *(void**)slot;
+}
+
+static struct rb_string_entry*
+find_string_entry
+  (struct rb_string_arena* arena,
+   uint64_t hash,
+   const char* str,
+   size_t len)
+{
+  size_t i = 0;
+  ASSERT(arena && arena->capacity);
+
+  i = (size_t)hash & (arena->capacity - 1);
+  while(arena->entry_list[i].str) {
+    const struct rb_string_entry* entry = arena->entry_list + i;
+    if(entry->hash == hash
+    && strncmp(entry->str, str, len) == 0
+    && entry->str[len] == '\0')
+      break;
+    i = (i + 1) & (arena->capacity - 1);
+  }
+  return arena->entry_list + i;
+}
+
+static int
+grow_string_index(struct rb_string_arena* arena)
+{
+  struct rb_string_entry* entry_list = NULL;
+  const size_t capacity = arena->capacity ? arena->capacity * 2 : 64;
+  size_t i = 0;
+  ASSERT(arena);
+
+  entry_list = MEM_CALLOC
+    (arena->allocator, capacity, sizeof(struct rb_string_entry));
+  if(!entry_list)
+    return -1;
+  for(i = 0; i < arena->capacity; ++i) {
+    const struct rb_string_entry* entry = arena->entry_list + i;
+    size_t j = 0;
+    if(!entry->str)
+      continue;
+    for(j = (size_t)entry->hash & (capacity - 1);
+        entry_list[j].str;
+        j = (j + 1) & (capacity - 1));
+    entry_list[j] = *entry;
+  }
+  MEM_FREE(arena->allocator, arena->entry_list);
+  arena->entry_list = entry_list;
+  arena->capacity = capacity;
+  return 0;
+}
+
+/* Return a copy of the string stored into the chunks of the arena. */
+static char*
+store_string(struct rb_string_arena* arena, const char* str, size_t len)
+{
+  struct rb_string_chunk* chunk = arena->chunk_list;
+  char* dst = NULL;
+  ASSERT(arena && str);
+
+  if(!chunk || arena->chunk_offset + len + 1 > chunk->size) {
+    const size_t size = MAX(CHUNK_SIZE, len + 1);
+
+    chunk = MEM_ALLOC
+      (arena->allocator, sizeof(struct rb_string_chunk) + size);
+    if(!chunk)
+      return NULL;
+    chunk->size = size;
+    arena->size += size;
+    /* A string larger than a chunk gets its own chunk that does not replace
+     * the chunk being filled. */
+    if(size > CHUNK_SIZE && arena->chunk_list) {
+      chunk->next = arena->chunk_list->next;
+      arena->chunk_list->next = chunk;
+      dst = (char*)(chunk + 1);
+      memcpy(dst, str, len);
+      dst[len] = '\0';
+      return dst;
+    }
+    chunk->next = arena->chunk_list;
+    arena->chunk_list = chunk;
+    arena->chunk_offset = 0;
+  }
+  dst = (char*)(chunk + 1) + arena->chunk_offset;
+  memcpy(dst, str, len);
+  dst[len] = '\0';
+  arena->chunk_offset += len + 1;
+  return dst;
+}
+
+static struct rb_arena_block*
+create_arena_block(struct rb_arena* arena, size_t size)
+{
+  struct rb_arena_block* block = NULL;
+  ASSERT(arena && size);
+
+  block = MEM_ALLOC(arena->allocator, BLOCK_HEADER_SIZE + size);
+  if(block) {
+    block->next = NULL;
+    block->size = size;
+    arena->size += size;
+  }
+  return block;
+}
+
+static void
+free_arena_blocks(struct rb_arena* arena)
+{
+  ASSERT(arena);
+  while(arena->block_list) {
+    struct rb_arena_block* block = arena->block_list;
+    arena->block_list = block->next;
+    MEM_FREE(arena->allocator, block);
+  }
+  arena->block = NULL;
+  arena->offset = 0;
+  arena->size = 0;
+}
+
+/*******************************************************************************
+ *
+ * Slab functions.
+ *
+ ******************************************************************************/
+void
+rb_init_slab
+  (struct mem_allocator* allocator,
+   size_t slot_size,
+   struct rb_slab* slab)
+{
+  ASSERT(allocator && slab && slot_size);
+
+  memset(slab, 0, sizeof(struct rb_slab));
+  slab->allocator = allocator;
+  slab->slot_size = ALIGN_SLOT(MAX(slot_size, sizeof(void*)));
+  slab->nb_slots_per_page = MAX
+    ((PAGE_SIZE - PAGE_HEADER_SIZE) / slab->slot_size, MIN_SLOTS_PER_PAGE);
+}
+
+void
+rb_release_slab(struct rb_slab* slab)
+{
+  ASSERT(slab && slab->nb_objects == 0);
+
+  while(slab->page_list) {
+    struct rb_slab_page* page = slab->page_list;
+    slab->page_list = page->next;
+    MEM_FREE(slab->allocator, page);
+  }
+  slab->free_list = NULL;
+  slab->nb_slots = 0;
+}
+
+void*
+rb_slab_alloc(struct rb_slab* slab)
+{
+  void* slot = NULL;
+  ASSERT(slab);
+
+  if(!slab->free_list) {
+    struct rb_slab_page* page = NULL;
+    char* slot_list = NULL;
+    size_t i = 0;
+
+    page = MEM_ALLOC
+      (slab->allocator,
+       PAGE_HEADER_SIZE + slab->nb_slots_per_page * slab->slot_size);
+    if(!page)
+      return NULL;
+    page->next = slab->page_list;
+    slab->page_list = page;
+    slot_list = (char*)page + PAGE_HEADER_SIZE;
+    for(i = slab->nb_slots_per_page; i-- > 0; ) {
+      void** free_slot = (void**)(slot_list + i * slab->slot_size);
+      *free_slot = slab->free_list;
+      slab->free_list = free_slot;
+    }
+    slab->nb_slots += slab->nb_slots_per_page;
+  }
+  slot = slab->free_list;
+  slab->free_list = next_free_slot(slot);
+  ++slab->nb_objects;
+  memset(slot, 0, slab->slot_size);
+  return slot;
+}
+
+void
+rb_slab_free(struct rb_slab* slab, void* object)
+{
+  ASSERT(slab && object && slab->nb_objects);
+
+  *(void**)object = slab->free_list;
+  slab->free_list = object;
+  --slab->nb_objects;
+}
+
+void
+rb_slab_stats(const struct rb_slab* slab, struct rb_object_pool_stats* stats)
+{
+  ASSERT(slab && stats);
+  stats->nb_objects = slab->nb_objects;
+  stats->nb_slots = slab->nb_slots;
+  stats->slot_size = slab->slot_size;
+}
+
+/*******************************************************************************
+ *
+ * String arena functions.
+ *
+ ******************************************************************************/
+void
+rb_init_string_arena
+  (struct mem_allocator* allocator,
+   struct rb_string_arena* arena)
+{
+  ASSERT(allocator && arena);
+  memset(arena, 0, sizeof(struct rb_string_arena));
+  arena->allocator = allocator;
+}
+
+void
+rb_release_string_arena(struct rb_string_arena* arena)
+{
+  ASSERT(arena);
+
+  while(arena->chunk_list) {
+    struct rb_string_chunk* chunk = arena->chunk_list;
+    arena->chunk_list = chunk->next;
+    MEM_FREE(arena->allocator, chunk);
+  }
+  MEM_FREE(arena->allocator, arena->entry_list);
+  memset(arena, 0, sizeof(struct rb_string_arena));
+}
+
+const char*
+rb_intern_string(struct rb_string_arena* arena, const char* str, size_t len)
+{
+  struct rb_string_entry* entry = NULL;
+  uint64_t hash = 0;
+  ASSERT(arena && str);
+
+  /* Keep the load factor lower than 1/2. */
+  if((arena->nb_strings + 1) * 2 > arena->capacity
+  && grow_string_index(arena) != 0)
+    return NULL;
+
+  hash = rb_hash(RB_HASH_SEED, str, len);
+  entry = find_string_entry(arena, hash, str, len);
+  if(entry->str)
+    return entry->str;
+
+  entry->str = store_string(arena, str, len);
+  if(!entry->str)
+    return NULL;
+  entry->hash = hash;
+  ++arena->nb_strings;
+  return entry->str;
+}
+
+/*******************************************************************************
+ *
+ * Arena functions.
+ *
+ ******************************************************************************/
+void
+rb_init_arena(struct mem_allocator* allocator, struct rb_arena* arena)
+{
+  ASSERT(allocator && arena);
+  memset(arena, 0, sizeof(struct rb_arena));
+  arena->allocator = allocator;
+}
+
+void
+rb_release_arena(struct rb_arena* arena)
+{
+  ASSERT(arena);
+  free_arena_blocks(arena);
+}
+
+void*
+rb_arena_alloc(struct rb_arena* arena, size_t size)
+{
+  void* mem = NULL;
+  ASSERT(arena);
+
+  size = ALIGN_SLOT(MAX(size, 1));
+  if(!arena->block && arena->block_list) {
+    arena->block = arena->block_list;
+    arena->offset = 0;
+  }
+  /* Look for room in the blocks that are not used yet. */
+  while(arena->block
+     && arena->offset + size > arena->block->size
+     && arena->block->next) {
+    arena->block = arena->block->next;
+    arena->offset = 0;
+  }
+  if(!arena->block || arena->offset + size > arena->block->size) {
+    /* The reserved memory grows geometrically. */
+    struct rb_arena_block* block = create_arena_block
+      (arena, MAX(MAX(BLOCK_SIZE, arena->size), size));
+    if(!block)
+      return NULL;
+    if(arena->block)
+      arena->block->next = block;
+    else
+      arena->block_list = block;
+    arena->block = block;
+    arena->offset = 0;
+  }
+  mem = (char*)arena->block + BLOCK_HEADER_SIZE + arena->offset;
+  arena->offset += size;
+  return mem;
+}
+
+void
+rb_arena_mark(const struct rb_arena* arena, struct rb_arena_mark* mark)
+{
+  ASSERT(arena && mark);
+  mark->block = arena->block;
+  mark->offset = arena->offset;
+}
+
+void
+rb_arena_restore(struct rb_arena* arena, const struct rb_arena_mark* mark)
+{
+  ASSERT(arena && mark);
+  arena->block = mark->block;
+  arena->offset = mark->offset;
+}
+
+void
+rb_reset_arena(struct rb_arena* arena)
+{
+  ASSERT(arena);
+
+  if(arena->block_list && arena->block_list->next) {
+    const size_t size = arena->size;
+    free_arena_blocks(arena);
+    /* On allocation failure the arena simply starts empty again. */
+    arena->block_list = create_arena_block(arena, size);
+  }
+  arena->block = arena->block_list;
+  arena->offset = 0;
+}
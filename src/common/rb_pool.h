@@ -0,0 +1,144 @@
+#ifndef RB_POOL_H
+#define RB_POOL_H
+
+#include "rb_types.h"
+#include <snlsys/snlsys.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************
+ *
+ * Memory pools of the backend contexts. The objects of a given type are
+ * allocated from a slab of fixed size slots, the names are interned into a
+ * string arena and the transient data are allocated from a linear arena.
+ * None of them is thread safe.
+ *
+ ******************************************************************************/
+struct mem_allocator;
+struct rb_arena_block;
+struct rb_slab_page;
+struct rb_string_chunk;
+
+/* Slots of `slot_size' bytes grouped in pages. The released slots are
+ * recycled by the subsequent allocations and the pages are freed with the
+ * slab. */
+struct rb_slab {
+  struct mem_allocator* allocator;
+  void* free_list;
+  struct rb_slab_page* page_list;
+  size_t slot_size;
+  size_t nb_slots_per_page;
+  size_t nb_slots;
+  size_t nb_objects;
+};
+
+struct rb_string_entry {
+  uint64_t hash;
+  const char* str; /* NULL <=> free entry. */
+};
+
+/* Unique copies of strings that live as long as the arena. */
+struct rb_string_arena {
+  struct mem_allocator* allocator;
+  struct rb_string_chunk* chunk_list; /* The first one is being filled. */
+  size_t chunk_offset; /* Used bytes of the first chunk. */
+  size_t size; /* Bytes reserved by the chunks. */
+  struct rb_string_entry* entry_list;
+  size_t capacity; /* Power of 2. */
+  size_t nb_strings;
+};
+
+/* Linear allocator whose memory is released wholesale. Its blocks are kept
+ * from one reset to the next so that a steady usage does not allocate. */
+struct rb_arena {
+  struct mem_allocator* allocator;
+  struct rb_arena_block* block_list;
+  struct rb_arena_block* block; /* Block being filled. May be NULL. */
+  size_t offset; /* Used bytes of the block being filled. */
+  size_t size; /* Bytes reserved by the blocks. */
+};
+
+/* State of an arena to which it can be rolled back. */
+struct rb_arena_mark {
+  struct rb_arena_block* block;
+  size_t offset;
+};
+
+LOCAL_SYM void
+rb_init_slab
+  (struct mem_allocator* allocator,
+   size_t slot_size,
+   struct rb_slab* slab);
+
+/* Free the pages of the slab whose objects must be all released. */
+LOCAL_SYM void
+rb_release_slab
+  (struct rb_slab* slab);
+
+/* Return a zeroed slot or NULL on allocation failure. */
+LOCAL_SYM void*
+rb_slab_alloc
+  (struct rb_slab* slab);
+
+LOCAL_SYM void
+rb_slab_free
+  (struct rb_slab* slab,
+   void* object);
+
+LOCAL_SYM void
+rb_slab_stats
+  (const struct rb_slab* slab,
+   struct rb_object_pool_stats* stats);
+
+LOCAL_SYM void
+rb_init_string_arena
+  (struct mem_allocator* allocator,
+   struct rb_string_arena* arena);
+
+LOCAL_SYM void
+rb_release_string_arena
+  (struct rb_string_arena* arena);
+
+/* Return the interned copy of the `len' first characters of `str' or NULL on
+ * allocation failure. */
+LOCAL_SYM const char*
+rb_intern_string
+  (struct rb_string_arena* arena,
+   const char* str,
+   size_t len);
+
+LOCAL_SYM void
+rb_init_arena
+  (struct mem_allocator* allocator,
+   struct rb_arena* arena);
+
+LOCAL_SYM void
+rb_release_arena
+  (struct rb_arena* arena);
+
+/* Return `size' uninitialised bytes aligned on 16 bytes or NULL on allocation
+ * failure. The memory is valid up to the next reset of the arena or up to the
+ * restoration of a previous mark. */
+LOCAL_SYM void*
+rb_arena_alloc
+  (struct rb_arena* arena,
+   size_t size);
+
+LOCAL_SYM void
+rb_arena_mark
+  (const struct rb_arena* arena,
+   struct rb_arena_mark* mark);
+
+/* Release the memory allocated since `mark' was set. */
+LOCAL_SYM void
+rb_arena_restore
+  (struct rb_arena* arena,
+   const struct rb_arena_mark* mark);
+
+/* Release the whole memory of the arena. Its blocks are merged into a single
+ * one as large as all of them. */
+LOCAL_SYM void
+rb_reset_arena
+  (struct rb_arena* arena);
+
+#endif /* RB_POOL_H */
@@ -0,0 +1,508 @@
+#include "common/rb_hash.h"
+#include "common/rb_shader_variant.h"
+#include <snlsys/mem_allocator.h>
+#include <snlsys/snlsys.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Bound the nesting of the includes in order to stop on recursive ones. */
+#define MAX_INCLUDE_DEPTH 32
+
+struct preprocessor {
+  struct mem_allocator* allocator;
+  const struct rb_shader_variant_desc* desc;
+  char* text;
+  size_t length;
+  size_t capacity;
+  unsigned int nb_sources; /* Source string numbers used by #line. */
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static int
+append(struct preprocessor* pp, const char* str, size_t len)
+{
+  ASSERT(pp && (str || !len));
+
+  if(pp->length + len + 1/*'\0'*/ > pp->capacity) {
+    size_t capacity = pp->capacity ? pp->capacity : 256;
+    char* text = NULL;
+
+    while(pp->length + len + 1 > capacity)
+      capacity *= 2;
+    text = MEM_REALLOC(pp->allocator, pp->text, capacity);
+    if(!text)
+      return -1;
+    pp->text = text;
+    pp->capacity = capacity;
+  }
+  memcpy(pp->text + pp->length, str, len);
+  pp->length += len;
+  pp->text[pp->length] = '\0';
+  return 0;
+}
+
+static FINLINE int
+append_string(struct preprocessor* pp, const char* str)
+{
+  return append(pp, str, strlen(str));
+}
+
+static int
+append_line_directive(struct preprocessor* pp, size_t line, unsigned int src)
+{
+  char buf[64];
+  snprintf(buf, sizeof(buf), "#line %lu %u\n", (unsigned long)line, src);
+  return append_string(pp, buf);
+}
+
+static FINLINE const char*
+skip_blanks(const char* c, const char* end)
+{
+  while(c < end && (*c == ' ' || *c == '\t'))
+    ++c;
+  return c;
+}
+
+/* Return the end of the comments and white spaces that may precede the
+ * #version directive. */
+static const char*
+skip_preamble(const char* c, const char* end)
+{
+  while(c < end) {
+    if(*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n') {
+      ++c;
+    } else if(end - c > 1 && c[0] == '/' && c[1] == '/') {
+      while(c < end && *c != '\n')
+        ++c;
+    } else if(end - c > 1 && c[0] == '/' && c[1] == '*') {
+      for(c += 2; end - c > 1 && !(c[0] == '*' && c[1] == '/'); ++c);
+      c = end - c > 1 ? c + 2 : end;
+    } else {
+      break;
+    }
+  }
+  return c;
+}
+
+/* Return the end of the source lines up to the #version directive included
+ * or `src' if there is no such directive. */
+static const char*
+find_version_end(const char* src, const char* end)
+{
+  const char* c = skip_preamble(src, end);
+
+  if(c == end || *c != '#')
+    return src;
+  c = skip_blanks(c + 1, end);
+  if(end - c < 7 || strncmp(c, "version", 7))
+    return src;
+  while(c < end && *c != '\n')
+    ++c;
+  return c < end ? c + 1 : end;
+}
+
+/* Return 1 if the line is an #include directive and setup its path. */
+static int
+parse_include
+  (const char* line,
+   const char* eol,
+   const char** out_path,
+   size_t* out_path_len)
+{
+  const char* c = skip_blanks(line, eol);
+  char delimiter = 0;
+
+  if(c == eol || *c != '#')
+    return 0;
+  c = skip_blanks(c + 1, eol);
+  if(eol - c < 7 || strncmp(c, "include", 7))
+    return 0;
+  c = skip_blanks(c + 7, eol);
+  if(c == eol || (*c != '"' && *c != '<'))
+    return 0;
+  delimiter = *c == '"' ? '"' : '>';
+  *out_path = ++c;
+  while(c < eol && *c != delimiter)
+    ++c;
+  if(c == eol) /* Let the compiler report the malformed directive. */
+    return 0;
+  *out_path_len = (size_t)(c - *out_path);
+  return 1;
+}
+
+static int
+expand
+  (struct preprocessor* pp,
+   const char* src,
+   size_t length,
+   unsigned int src_id,
+   size_t first_line,
+   int depth);
+
+static int
+include
+  (struct preprocessor* pp,
+   const char* path,
+   size_t path_len,
+   int depth)
+{
+  const char* source = NULL;
+  char* str = NULL;
+  size_t length = 0;
+  unsigned int src_id = 0;
+  int err = 0;
+  ASSERT(pp && path);
+
+  str = MEM_ALLOC(pp->allocator, path_len + 1);
+  if(!str)
+    goto error;
+  memcpy(str, path, path_len);
+  str[path_len] = '\0';
+
+  if(depth >= MAX_INCLUDE_DEPTH) {
+    fprintf(stderr, "%s: too many nested includes\n", str);
+    goto error;
+  }
+  if(!pp->desc->include
+  || pp->desc->include(pp->desc->include_data, str, &source, &length) != 0
+  || (length && !source)) {
+    fprintf(stderr, "%s: cannot resolve the include\n", str);
+    goto error;
+  }
+  src_id = pp->nb_sources++;
+  if(append_line_directive(pp, 1, src_id) != 0
+  || expand(pp, source, length, src_id, 1, depth + 1) != 0)
+    goto error;
+  /* The included source may not end with a new line. */
+  if(pp->text[pp->length - 1] != '\n' && append(pp, "\n", 1) != 0)
+    goto error;
+
+exit:
+  if(str)
+    MEM_FREE(pp->allocator, str);
+  return err;
+
+error:
+  err = -1;
+  goto exit;
+}
+
+/* Copy the source lines and replace the #include directives by the included
+ * sources, framed by #line directives that keep the compile errors located.
+ * A source without include is copied as is. */
+static int
+expand
+  (struct preprocessor* pp,
+   const char* src,
+   size_t length,
+   unsigned int src_id,
+   size_t first_line,
+   int depth)
+{
+  const char* end = src + length;
+  const char* line = src;
+  size_t line_num = first_line;
+  ASSERT(pp && (src || !length));
+
+  while(line < end) {
+    const char* eol = memchr(line, '\n', (size_t)(end - line));
+    const char* path = NULL;
+    size_t path_len = 0;
+
+    eol = eol ? eol : end;
+    if(parse_include(line, eol, &path, &path_len)) {
+      if(include(pp, path, path_len, depth) != 0
+      || append_line_directive(pp, line_num + 1, src_id) != 0)
+        return -1;
+    } else if(append(pp, line, (size_t)(eol - line + (eol < end))) != 0) {
+      return -1;
+    }
+    line = eol < end ? eol + 1 : end;
+    ++line_num;
+  }
+  return 0;
+}
+
+static FINLINE int
+is_entry_of
+  (const struct rb_variant_entry* entry,
+   uint64_t key,
+   enum rb_shader_type type,
+   const char* source,
+   size_t length)
+{
+  ASSERT(entry && entry->shader);
+  return entry->key == key
+      && entry->type == type
+      && entry->length == length
+      && memcmp(entry->source, source, length) == 0;
+}
+
+/* Return the entry of the variant or the free entry where it is inserted. */
+static struct rb_variant_entry*
+find_entry
+  (struct rb_variant_cache* cache,
+   uint64_t key,
+   enum rb_shader_type type,
+   const char* source,
+   size_t length)
+{
+  struct rb_variant_entry* list = NULL;
+  size_t i = 0;
+  ASSERT(cache && cache->capacity && (source || !length));
+
+  list = cache->entry_list;
+  for(i = (size_t)key & (cache->capacity - 1);
+      list[i].shader && !is_entry_of(list + i, key, type, source, length);
+      i = (i + 1) & (cache->capacity - 1));
+  return list + i;
+}
+
+/* Return the entry of the shader or a free entry if it is not cached. */
+static struct rb_variant_entry*
+find_shader_entry(struct rb_variant_cache* cache, uint64_t key, void* shader)
+{
+  struct rb_variant_entry* list = NULL;
+  size_t i = 0;
+  ASSERT(cache && cache->capacity && shader);
+
+  list = cache->entry_list;
+  for(i = (size_t)key & (cache->capacity - 1);
+      list[i].shader && list[i].shader != shader;
+      i = (i + 1) & (cache->capacity - 1));
+  return list + i;
+}
+
+/* Return the free entry where an entry of the key is moved on rehash. */
+static struct rb_variant_entry*
+find_free_entry(struct rb_variant_cache* cache, uint64_t key)
+{
+  size_t i = 0;
+  ASSERT(cache && cache->capacity);
+
+  for(i = (size_t)key & (cache->capacity - 1);
+      cache->entry_list[i].shader;
+      i = (i + 1) & (cache->capacity - 1));
+  return cache->entry_list + i;
+}
+
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+int
+rb_preprocess_shader_variant
+  (struct mem_allocator* allocator,
+   const struct rb_shader_variant_desc* desc,
+   char** out_source,
+   size_t* out_length)
+{
+  struct preprocessor pp;
+  const char* version_end = NULL;
+  size_t nb_header_lines = 0;
+  size_t i = 0;
+  int err = 0;
+  ASSERT(allocator && out_source && out_length);
+
+  memset(&pp, 0, sizeof(struct preprocessor));
+  pp.allocator = allocator;
+  pp.desc = desc;
+  pp.nb_sources = 1;
+
+  if(!desc || (desc->length && !desc->source)
+  || (desc->nb_defines && !desc->define_list))
+    goto error;
+  for(i = 0; i < desc->nb_defines; ++i) {
+    if(!desc->define_list[i].name)
+      goto error;
+  }
+
+  /* The defines must follow the #version directive. */
+  version_end = find_version_end(desc->source, desc->source + desc->length);
+  for(i = 0; desc->source + i < version_end; ++i)
+    nb_header_lines += desc->source[i] == '\n';
+  if(append(&pp, desc->source, (size_t)(version_end - desc->source)) != 0)
+    goto error;
+  if(pp.length && pp.text[pp.length - 1] != '\n') {
+    if(append(&pp, "\n", 1) != 0)
+      goto error;
+    ++nb_header_lines;
+  }
+  for(i = 0; i < desc->nb_defines; ++i) {
+    const struct rb_shader_define* def = desc->define_list + i;
+    if(append_string(&pp, "#define ") != 0
+    || append_string(&pp, def->name) != 0
+    || (def->value && append(&pp, " ", 1) != 0)
+    || (def->value && append_string(&pp, def->value) != 0)
+    || append(&pp, "\n", 1) != 0)
+      goto error;
+  }
+  if(desc->nb_defines
+  && append_line_directive(&pp, nb_header_lines + 1, 0) != 0)
+    goto error;
+
+  if(expand(&pp, version_end,
+     desc->length - (size_t)(version_end - desc->source), 0,
+     nb_header_lines + 1, 0) != 0)
+    goto error;
+  if(!pp.text && append(&pp, "", 0) != 0)
+    goto error;
+
+exit:
+  *out_source = pp.text;
+  *out_length = pp.length;
+  return err;
+
+error:
+  if(pp.text) {
+    MEM_FREE(allocator, pp.text);
+    pp.text = NULL;
+    pp.length = 0;
+  }
+  err = -1;
+  goto exit;
+}
+
+uint64_t
+rb_shader_variant_key
+  (enum rb_shader_type type,
+   const char* source,
+   size_t length)
+{
+  const uint64_t type64 = (uint64_t)type;
+  return rb_hash
+    (rb_hash(RB_HASH_SEED, &type64, sizeof(type64)), source, length);
+}
+
+void
+rb_init_variant_cache
+  (struct mem_allocator* allocator,
+   struct rb_variant_cache* cache)
+{
+  ASSERT(allocator && cache);
+  memset(cache, 0, sizeof(struct rb_variant_cache));
+  cache->allocator = allocator;
+}
+
+void
+rb_release_variant_cache(struct rb_variant_cache* cache)
+{
+  size_t i = 0;
+  ASSERT(cache);
+
+  for(i = 0; i < cache->capacity; ++i) {
+    if(cache->entry_list[i].shader)
+      MEM_FREE(cache->allocator, cache->entry_list[i].source);
+  }
+  if(cache->entry_list)
+    MEM_FREE(cache->allocator, cache->entry_list);
+  rb_init_variant_cache(cache->allocator, cache);
+}
+
+void*
+rb_find_shader_variant
+  (struct rb_variant_cache* cache,
+   uint64_t key,
+   enum rb_shader_type type,
+   const char* source,
+   size_t length)
+{
+  ASSERT(cache);
+  if(!cache->capacity)
+    return NULL;
+  return find_entry(cache, key, type, source, length)->shader;
+}
+
+int
+rb_add_shader_variant
+  (struct rb_variant_cache* cache,
+   uint64_t key,
+   enum rb_shader_type type,
+   const char* source,
+   size_t length,
+   void* shader)
+{
+  struct rb_variant_entry* entry = NULL;
+  char* copy = NULL;
+  ASSERT(cache && (source || !length) && shader);
+
+  if((cache->nb_entries + 1) * 2 > cache->capacity) {
+    struct rb_variant_entry* old_list = cache->entry_list;
+    const size_t old_capacity = cache->capacity;
+    size_t i = 0;
+
+    cache->capacity = old_capacity ? old_capacity * 2 : 64;
+    cache->entry_list = MEM_CALLOC
+      (cache->allocator, cache->capacity, sizeof(struct rb_variant_entry));
+    if(!cache->entry_list) {
+      cache->entry_list = old_list;
+      cache->capacity = old_capacity;
+      return -1;
+    }
+    for(i = 0; i < old_capacity; ++i) {
+      if(old_list[i].shader)
+        *find_free_entry(cache, old_list[i].key) = old_list[i];
+    }
+    if(old_list)
+      MEM_FREE(cache->allocator, old_list);
+  }
+  entry = find_entry(cache, key, type, source, length);
+  if(entry->shader) { /* Replace the shader of the variant. */
+    entry->shader = shader;
+    return 0;
+  }
+  /* At least one byte in order to distinguish an empty source from a failed
+   * allocation. */
+  copy = MEM_ALLOC(cache->allocator, length ? length : 1);
+  if(!copy)
+    return -1;
+  if(length)
+    memcpy(copy, source, length);
+  entry->key = key;
+  entry->type = type;
+  entry->source = copy;
+  entry->length = length;
+  entry->shader = shader;
+  ++cache->nb_entries;
+  return 0;
+}
+
+void
+rb_remove_shader_variant
+  (struct rb_variant_cache* cache,
+   uint64_t key,
+   void* shader)
+{
+  struct rb_variant_entry* list = NULL;
+  size_t mask = 0;
+  size_t i = 0;
+  size_t j = 0;
+  ASSERT(cache && shader);
+
+  if(!cache->capacity || !find_shader_entry(cache, key, shader)->shader)
+    return;
+
+  /* Shift back the following entries of the probe sequence rather than
+   * leaving a tombstone. */
+  list = cache->entry_list;
+  mask = cache->capacity - 1;
+  i = (size_t)(find_shader_entry(cache, key, shader) - list);
+  MEM_FREE(cache->allocator, list[i].source);
+  for(j = (i + 1) & mask; list[j].shader; j = (j + 1) & mask) {
+    const size_t home = (size_t)list[j].key & mask;
+    const int is_movable = i <= j
+      ? (home <= i || home > j)
+      : (home <= i && home > j);
+    if(is_movable) {
+      list[i] = list[j];
+      i = j;
+    }
+  }
+  list[i].shader = NULL;
+  --cache->nb_entries;
+}
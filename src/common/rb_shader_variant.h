@@ -0,0 +1,88 @@
+#ifndef RB_SHADER_VARIANT_H
+#define RB_SHADER_VARIANT_H
+
+#include "rb_types.h"
+#include <snlsys/snlsys.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************
+ *
+ * Shader variant helpers shared by the backends. A variant is created from the
+ * source preprocessed by the rb_shader_variant_desc, i.e. with its includes
+ * expanded and its defines injected after the #version directive. The
+ * variants are then identified by the key of this preprocessed source.
+ *
+ ******************************************************************************/
+struct mem_allocator;
+
+/* The key is only a hash of the preprocessed source: the entry keeps a copy
+ * of the source in order to tell apart the variants whose keys collide. */
+struct rb_variant_entry {
+  uint64_t key;
+  enum rb_shader_type type;
+  char* source;
+  size_t length;
+  void* shader; /* NULL <=> free entry. */
+};
+
+/* Open addressing table of the shader variants of a context. The shaders are
+ * not referenced by the cache: they remove themselves on their release. */
+struct rb_variant_cache {
+  struct mem_allocator* allocator;
+  struct rb_variant_entry* entry_list;
+  size_t capacity; /* Power of 2. */
+  size_t nb_entries;
+};
+
+/* Allocate the preprocessed source of the variant. It is null terminated and
+ * must be freed with `allocator'. */
+LOCAL_SYM int
+rb_preprocess_shader_variant
+  (struct mem_allocator* allocator,
+   const struct rb_shader_variant_desc* desc,
+   char** out_source,
+   size_t* out_length);
+
+LOCAL_SYM uint64_t
+rb_shader_variant_key
+  (enum rb_shader_type type,
+   const char* source,
+   size_t length);
+
+LOCAL_SYM void
+rb_init_variant_cache
+  (struct mem_allocator* allocator,
+   struct rb_variant_cache* cache);
+
+LOCAL_SYM void
+rb_release_variant_cache
+  (struct rb_variant_cache* cache);
+
+/* Return the shader of the variant or NULL if it is not cached. The `key'
+ * is the rb_shader_variant_key of the preprocessed `source'. */
+LOCAL_SYM void*
+rb_find_shader_variant
+  (struct rb_variant_cache* cache,
+   uint64_t key,
+   enum rb_shader_type type,
+   const char* source,
+   size_t length);
+
+/* The preprocessed `source' is copied into the cache. */
+LOCAL_SYM int
+rb_add_shader_variant
+  (struct rb_variant_cache* cache,
+   uint64_t key,
+   enum rb_shader_type type,
+   const char* source,
+   size_t length,
+   void* shader);
+
+LOCAL_SYM void
+rb_remove_shader_variant
+  (struct rb_variant_cache* cache,
+   uint64_t key,
+   void* shader);
+
+#endif /* RB_SHADER_VARIANT_H */
@@ -0,0 +1,198 @@
+#define _POSIX_C_SOURCE 200112L /* pthread */
+
+#include "common/rb_thread_pool.h"
+#include <snlsys/mem_allocator.h>
+#include <snlsys/snlsys.h>
+#include <pthread.h>
+
+struct rb_thread_pool {
+  struct mem_allocator* allocator;
+  pthread_t* thread_list;
+  unsigned int nb_workers;
+  unsigned int nb_started_workers;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t cond_job; /* Signaled when a job is submitted. */
+  pthread_cond_t cond_done; /* Signaled when the last worker ends the job. */
+  unsigned int job_id;
+  unsigned int nb_busy_workers;
+  int quit;
+
+  /* Current job. */
+  void (*func)(void* data, size_t task, unsigned int thread_id);
+  void* data;
+  size_t nb_tasks;
+  size_t next_task; /* Atomically incremented. */
+};
+
+struct worker {
+  struct rb_thread_pool* pool;
+  unsigned int id;
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static void
+process_tasks(struct rb_thread_pool* pool, unsigned int thread_id)
+{
+  size_t task = 0;
+  ASSERT(pool);
+  for(;;) {
+    task = __sync_fetch_and_add(&pool->next_task, 1);
+    if(task >= pool->nb_tasks)
+      break;
+    pool->func(pool->data, task, thread_id);
+  }
+}
+
+static void*
+worker_main(void* arg)
+{
+  const struct worker* worker = arg;
+  struct rb_thread_pool* pool = NULL;
+  unsigned int thread_id = 0;
+  unsigned int job_id = 0; /* No job is submitted before the worker creation */
+  ASSERT(arg);
+
+  pool = worker->pool;
+  thread_id = worker->id;
+
+  pthread_mutex_lock(&pool->mutex);
+  for(;;) {
+    while(!pool->quit && pool->job_id == job_id)
+      pthread_cond_wait(&pool->cond_job, &pool->mutex);
+    if(pool->quit)
+      break;
+    job_id = pool->job_id;
+    pthread_mutex_unlock(&pool->mutex);
+
+    process_tasks(pool, thread_id);
+
+    pthread_mutex_lock(&pool->mutex);
+    if(--pool->nb_busy_workers == 0)
+      pthread_cond_signal(&pool->cond_done);
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  return NULL;
+}
+
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+int
+rb_create_thread_pool
+  (struct mem_allocator* allocator,
+   unsigned int nb_threads,
+   struct rb_thread_pool** out_pool)
+{
+  /* The worker arguments are stored after the pool in order to outlive the
+   * stack of the creating thread. */
+  struct worker* worker_list = NULL;
+  struct rb_thread_pool* pool = NULL;
+  unsigned int i = 0;
+  int err = 0;
+
+  if(!allocator || !nb_threads || !out_pool)
+    goto error;
+
+  pool = MEM_CALLOC
+    (allocator, 1,
+     sizeof(struct rb_thread_pool)
+     + (nb_threads - 1) * (sizeof(pthread_t) + sizeof(struct worker)));
+  if(!pool)
+    goto error;
+  pool->allocator = allocator;
+  pool->nb_workers = nb_threads - 1;
+  pool->thread_list = (pthread_t*)(pool + 1);
+  worker_list = (struct worker*)(pool->thread_list + pool->nb_workers);
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->cond_job, NULL);
+  pthread_cond_init(&pool->cond_done, NULL);
+
+  for(i = 0; i < pool->nb_workers; ++i) {
+    worker_list[i].pool = pool;
+    worker_list[i].id = i;
+    if(pthread_create(pool->thread_list + i, NULL, worker_main, worker_list+i))
+      goto error;
+    ++pool->nb_started_workers;
+  }
+
+exit:
+  if(out_pool)
+    *out_pool = pool;
+  return err;
+
+error:
+  if(pool) {
+    rb_release_thread_pool(pool);
+    pool = NULL;
+  }
+  err = -1;
+  goto exit;
+}
+
+void
+rb_release_thread_pool(struct rb_thread_pool* pool)
+{
+  unsigned int i = 0;
+  ASSERT(pool);
+
+  pthread_mutex_lock(&pool->mutex);
+  pool->quit = 1;
+  pthread_cond_broadcast(&pool->cond_job);
+  pthread_mutex_unlock(&pool->mutex);
+  for(i = 0; i < pool->nb_started_workers; ++i)
+    pthread_join(pool->thread_list[i], NULL);
+
+  pthread_cond_destroy(&pool->cond_done);
+  pthread_cond_destroy(&pool->cond_job);
+  pthread_mutex_destroy(&pool->mutex);
+  MEM_FREE(pool->allocator, pool);
+}
+
+unsigned int
+rb_thread_pool_nb_threads(const struct rb_thread_pool* pool)
+{
+  ASSERT(pool);
+  return pool->nb_workers + 1;
+}
+
+void
+rb_thread_pool_run
+  (struct rb_thread_pool* pool,
+   size_t nb_tasks,
+   void (*func)(void* data, size_t task, unsigned int thread_id),
+   void* data)
+{
+  size_t task = 0;
+  ASSERT(pool && func);
+
+  /* Do not wake up the workers for a single task. */
+  if(nb_tasks <= 1 || !pool->nb_workers) {
+    for(task = 0; task < nb_tasks; ++task)
+      func(data, task, pool->nb_workers);
+    return;
+  }
+
+  pthread_mutex_lock(&pool->mutex);
+  pool->func = func;
+  pool->data = data;
+  pool->nb_tasks = nb_tasks;
+  pool->next_task = 0;
+  pool->nb_busy_workers = pool->nb_workers;
+  ++pool->job_id;
+  pthread_cond_broadcast(&pool->cond_job);
+  pthread_mutex_unlock(&pool->mutex);
+
+  process_tasks(pool, pool->nb_workers);
+
+  pthread_mutex_lock(&pool->mutex);
+  while(pool->nb_busy_workers)
+    pthread_cond_wait(&pool->cond_done, &pool->mutex);
+  pthread_mutex_unlock(&pool->mutex);
+}
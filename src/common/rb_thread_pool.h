@@ -0,0 +1,36 @@
+#ifndef RB_THREAD_POOL_H
+#define RB_THREAD_POOL_H
+
+#include <snlsys/snlsys.h>
+#include <stddef.h>
+
+struct mem_allocator;
+struct rb_thread_pool;
+
+/* Create a pool of `nb_threads' - 1 worker threads. The calling thread is the
+ * last thread of the pool. */
+LOCAL_SYM int
+rb_create_thread_pool
+  (struct mem_allocator* allocator,
+   unsigned int nb_threads,
+   struct rb_thread_pool** out_pool);
+
+LOCAL_SYM void
+rb_release_thread_pool
+  (struct rb_thread_pool* pool);
+
+/* Number of threads of the pool, including the calling thread. */
+LOCAL_SYM unsigned int
+rb_thread_pool_nb_threads
+  (const struct rb_thread_pool* pool);
+
+/* Invoke `func' on the tasks [0, nb_tasks) in parallel and wait for their
+ * completion. The thread id is in [0, rb_thread_pool_nb_threads). */
+LOCAL_SYM void
+rb_thread_pool_run
+  (struct rb_thread_pool* pool,
+   size_t nb_tasks,
+   void (*func)(void* data, size_t task, unsigned int thread_id),
+   void* data);
+
+#endif /* RB_THREAD_POOL_H */
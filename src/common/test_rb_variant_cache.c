@@ -0,0 +1,94 @@
+#include "common/rb_shader_variant.h"
+#include <snlsys/mem_allocator.h>
+#include <snlsys/snlsys.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Enough variants to grow the cache several times. */
+#define NB_VARIANTS 300
+#define KEY 7 /* Key shared by all the variants in order to force collisions. */
+
+/* Fake shader handles; the cache only compares them. */
+#define HANDLE(i) ((void*)(size_t)(16 * ((i) + 1)))
+
+static char source_list[NB_VARIANTS][32];
+
+/*******************************************************************************
+ *
+ * Variant cache test.
+ *
+ ******************************************************************************/
+int
+main(int argc, char** argv)
+{
+  struct rb_variant_cache cache;
+  const char* vs_source = "void main() {}";
+  const size_t vs_length = strlen(vs_source);
+  size_t i = 0;
+  (void)argc, (void)argv;
+
+  rb_init_variant_cache(&mem_default_allocator, &cache);
+  CHECK(rb_find_shader_variant
+    (&cache, KEY, RB_VERTEX_SHADER, vs_source, vs_length), NULL);
+  rb_remove_shader_variant(&cache, KEY, HANDLE(0));
+
+  /* Variants whose keys collide are told apart by their source. */
+  for(i = 0; i < NB_VARIANTS; ++i) {
+    const int len = sprintf(source_list[i], "#define V%lu\n", (unsigned long)i);
+    CHECK(rb_add_shader_variant(&cache, KEY, RB_FRAGMENT_SHADER,
+      source_list[i], (size_t)len, HANDLE(i)), 0);
+  }
+  CHECK(cache.nb_entries, NB_VARIANTS);
+  for(i = 0; i < NB_VARIANTS; ++i) {
+    CHECK(rb_find_shader_variant(&cache, KEY, RB_FRAGMENT_SHADER,
+      source_list[i], strlen(source_list[i])), HANDLE(i));
+  }
+  /* Same key and length but another source. */
+  CHECK(rb_find_shader_variant
+    (&cache, KEY, RB_FRAGMENT_SHADER, "#define W0\n", 11), NULL);
+  /* Prefix of a cached source. */
+  CHECK(rb_find_shader_variant
+    (&cache, KEY, RB_FRAGMENT_SHADER, source_list[0], 9), NULL);
+  /* And by their type. */
+  CHECK(rb_find_shader_variant(&cache, KEY, RB_VERTEX_SHADER,
+    source_list[0], strlen(source_list[0])), NULL);
+
+  /* The source is copied by the cache. */
+  strcpy(source_list[0], "#define XX\n");
+  CHECK(rb_find_shader_variant(&cache, KEY, RB_FRAGMENT_SHADER,
+    "#define V0\n", 11), HANDLE(0));
+  CHECK(rb_find_shader_variant(&cache, KEY, RB_FRAGMENT_SHADER,
+    source_list[0], strlen(source_list[0])), NULL);
+
+  /* An empty source is a valid variant. */
+  CHECK(rb_add_shader_variant
+    (&cache, KEY, RB_VERTEX_SHADER, "", 0, HANDLE(NB_VARIANTS)), 0);
+  CHECK(rb_find_shader_variant(&cache, KEY, RB_VERTEX_SHADER, "", 0),
+    HANDLE(NB_VARIANTS));
+
+  /* Adding a cached variant replaces its shader. The former shader no longer
+   * removes the variant. */
+  CHECK(rb_add_shader_variant
+    (&cache, KEY, RB_VERTEX_SHADER, "", 0, HANDLE(NB_VARIANTS + 1)), 0);
+  CHECK(cache.nb_entries, NB_VARIANTS + 1);
+  rb_remove_shader_variant(&cache, KEY, HANDLE(NB_VARIANTS));
+  CHECK(cache.nb_entries, NB_VARIANTS + 1);
+  CHECK(rb_find_shader_variant(&cache, KEY, RB_VERTEX_SHADER, "", 0),
+    HANDLE(NB_VARIANTS + 1));
+
+  /* A variant is removed by its shader and the other variants of its key are
+   * still found. */
+  for(i = 1; i < NB_VARIANTS; i += 2)
+    rb_remove_shader_variant(&cache, KEY, HANDLE(i));
+  CHECK(cache.nb_entries, NB_VARIANTS / 2 + 1);
+  for(i = 1; i < NB_VARIANTS; ++i) {
+    CHECK(rb_find_shader_variant(&cache, KEY, RB_FRAGMENT_SHADER,
+      source_list[i], strlen(source_list[i])), i % 2 ? NULL : HANDLE(i));
+  }
+
+  /* The release frees the copied sources. */
+  rb_release_variant_cache(&cache);
+  CHECK(cache.nb_entries, 0);
+  CHECK(rb_find_shader_variant(&cache, KEY, RB_VERTEX_SHADER, "", 0), NULL);
+  return 0;
+}
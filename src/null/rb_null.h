@@ -0,0 +1,55 @@
+#ifndef RB_NULL_H
+#define RB_NULL_H
+
+#include "rb.h"
+#include <stddef.h>
+
+/* Identifier of the recorded functions. */
+enum rb_null_func {
+  #define RB_FUNC(func_name, ...) RB_NULL_##func_name,
+  #include "rb_func.h"
+  #undef RB_FUNC
+  RB_NULL_FUNCS_COUNT
+};
+
+struct rb_null_func_stats {
+  size_t nb_calls;
+  size_t nb_errors; /* Number of calls that returned an error. */
+  /* Number of bytes of client data submitted to or read from the backend,
+   * e.g. buffer or texture data, uniform values, shader sources. */
+  size_t nb_bytes;
+};
+
+/* Statistics of the calls recorded by a context. The calls invoked on NULL
+ * objects cannot be attributed to a context and are thus not recorded. */
+struct rb_null_stats {
+  struct rb_null_func_stats func_list[RB_NULL_FUNCS_COUNT];
+  /* Totals of the object pools detailed by rb_get_pool_stats. */
+  size_t nb_objects; /* Number of live objects. */
+  size_t nb_pooled_objects; /* Number of object slots owned by the pools. */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+RB_API int
+rb_null_get_stats
+  (struct rb_context* ctxt,
+   struct rb_null_stats* stats);
+
+/* Reset the per function statistics. */
+RB_API int
+rb_null_clear_stats
+  (struct rb_context* ctxt);
+
+/* Return the name of the function without its rb_ prefix. */
+RB_API const char*
+rb_null_func_name
+  (enum rb_null_func func);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* RB_NULL_H */
@@ -0,0 +1,164 @@
+#include "null/rb_null_context.h"
+#include "null/rb_null_program.h"
+#include "rb.h"
+#include <snlsys/mem_allocator.h>
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+#include <string.h>
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static void
+release_attrib(struct ref* ref)
+{
+  struct rb_attrib* attr = NULL;
+  struct rb_context* ctxt = NULL;
+  ASSERT(ref);
+
+  attr = CONTAINER_OF(ref, struct rb_attrib, ref);
+  ctxt = attr->ctxt;
+  rb_null_program_unref(attr->program);
+  rb_null_free_object(ctxt, RB_OBJECT_ATTRIB, attr);
+  rb_null_context_unref(ctxt);
+}
+
+static int
+create_attrib
+  (struct rb_context* ctxt,
+   struct rb_program* prog,
+   const struct rb_null_decl* decl,
+   struct rb_attrib** out_attrib)
+{
+  struct rb_attrib* attr = NULL;
+  ASSERT(ctxt && prog && decl && out_attrib);
+
+  attr = rb_null_alloc_object(ctxt, RB_OBJECT_ATTRIB);
+  if(!attr)
+    return -1;
+  ref_init(&attr->ref);
+  ref_get(&ctxt->ref);
+  attr->ctxt = ctxt;
+  ref_get(&prog->ref);
+  attr->program = prog;
+  attr->decl = *decl;
+  *out_attrib = attr;
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Attrib functions.
+ *
+ ******************************************************************************/
+int
+rb_get_attribs
+  (struct rb_context* ctxt,
+   struct rb_program* prog,
+   size_t* out_nb_attribs,
+   struct rb_attrib* dst_attrib_list[])
+{
+  size_t i = 0;
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!prog || !out_nb_attribs || !prog->is_linked) {
+    err = -1;
+  } else {
+    if(dst_attrib_list) {
+      for(i = 0; i < prog->nb_attribs; ++i) {
+        err = create_attrib
+          (ctxt, prog, prog->attrib_list + i, dst_attrib_list + i);
+        if(err)
+          break;
+      }
+      if(err) {
+        while(i) {
+          --i;
+          ref_put(&dst_attrib_list[i]->ref, release_attrib);
+          dst_attrib_list[i] = NULL;
+        }
+      }
+    }
+    *out_nb_attribs = err ? 0 : prog->nb_attribs;
+  }
+  return RECORD(ctxt, get_attribs, 0, err);
+}
+
+int
+rb_get_named_attrib
+  (struct rb_context* ctxt,
+   struct rb_program* prog,
+   const char* name,
+   struct rb_attrib** out_attrib)
+{
+  size_t i = 0;
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!prog || !name || !out_attrib || !prog->is_linked) {
+    err = -1;
+  } else {
+    for(i = 0; i < prog->nb_attribs; ++i) {
+      if(!strcmp(prog->attrib_list[i].name, name))
+        break;
+    }
+    err = i < prog->nb_attribs
+      ? create_attrib(ctxt, prog, prog->attrib_list + i, out_attrib)
+      : -1;
+  }
+  return RECORD(ctxt, get_named_attrib, 0, err);
+}
+
+int
+rb_attrib_ref_get(struct rb_attrib* attr)
+{
+  if(!attr)
+    return -1;
+  ref_get(&attr->ref);
+  return RECORD(attr->ctxt, attrib_ref_get, 0, 0);
+}
+
+int
+rb_attrib_ref_put(struct rb_attrib* attr)
+{
+  if(!attr)
+    return -1;
+  RECORD(attr->ctxt, attrib_ref_put, 0, 0);
+  ref_put(&attr->ref, release_attrib);
+  return 0;
+}
+
+int
+rb_attrib_data(struct rb_attrib* attr, const void* data)
+{
+  int err = 0;
+
+  if(!attr)
+    return -1;
+  if(!data || attr->decl.type < RB_FLOAT || attr->decl.type > RB_FLOAT4)
+    err = -1;
+  return RECORD
+    (attr->ctxt, attrib_data, rb_null_sizeof_type(attr->decl.type), err);
+}
+
+int
+rb_get_attrib_desc(const struct rb_attrib* attr, struct rb_attrib_desc* desc)
+{
+  int err = 0;
+
+  if(!attr)
+    return -1;
+  if(!desc) {
+    err = -1;
+  } else {
+    desc->name = attr->decl.name;
+    desc->index = attr->decl.location;
+    desc->type = attr->decl.type;
+  }
+  return RECORD(attr->ctxt, get_attrib_desc, 0, err);
+}
@@ -0,0 +1,358 @@
+#include "common/rb_command_list.h"
+#include "null/rb_null_context.h"
+#include "null/rb_null_program.h"
+#include "null/rb_null_resources.h"
+#include "rb.h"
+#include <snlsys/math.h>
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+
+/* The recording functions may be invoked by any thread and are thus not
+ * recorded into the statistics of the context. The submitted commands are
+ * recorded by the functions that execute them. */
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static void
+release_command_buffer(struct ref* ref)
+{
+  struct rb_command_buffer* cmd = NULL;
+  struct rb_context* ctxt = NULL;
+  ASSERT(ref);
+
+  cmd = CONTAINER_OF(ref, struct rb_command_buffer, ref);
+  ctxt = cmd->ctxt;
+  rb_release_command_list(&cmd->list);
+  rb_null_free_object(ctxt, RB_OBJECT_COMMAND_BUFFER, cmd);
+  rb_null_context_unref(ctxt);
+}
+
+static void
+release_bundle(struct ref* ref)
+{
+  struct rb_bundle* bundle = NULL;
+  struct rb_context* ctxt = NULL;
+  ASSERT(ref);
+
+  bundle = CONTAINER_OF(ref, struct rb_bundle, ref);
+  ctxt = bundle->ctxt;
+  rb_command_list_ref_put_objects(&bundle->list);
+  rb_release_command_list(&bundle->list);
+  rb_null_free_object(ctxt, RB_OBJECT_BUNDLE, bundle);
+  rb_null_context_unref(ctxt);
+}
+
+/* The uniform owns a copy of its declaration. The values out of the uniform
+ * array are ignored. */
+static FINLINE size_t
+sizeof_uniform_data(const struct rb_uniform* uniform, int count)
+{
+  ASSERT(uniform && count > 0);
+  return rb_null_sizeof_type(uniform->decl.type)
+    * MIN((unsigned int)count, uniform->decl.count);
+}
+
+/*******************************************************************************
+ *
+ * Command buffer functions.
+ *
+ ******************************************************************************/
+int
+rb_create_command_buffer
+  (struct rb_context* ctxt,
+   struct rb_command_buffer** out_cmd)
+{
+  struct rb_command_buffer* cmd = NULL;
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!out_cmd) {
+    err = -1;
+  } else if(!(cmd = rb_null_alloc_object(ctxt, RB_OBJECT_COMMAND_BUFFER))) {
+    err = -1;
+  } else {
+    ref_init(&cmd->ref);
+    ref_get(&ctxt->ref);
+    cmd->ctxt = ctxt;
+    rb_init_command_list(ctxt->allocator, &cmd->list);
+    *out_cmd = cmd;
+  }
+  return RECORD(ctxt, create_command_buffer, 0, err);
+}
+
+int
+rb_command_buffer_ref_get(struct rb_command_buffer* cmd)
+{
+  if(!cmd)
+    return -1;
+  ref_get(&cmd->ref);
+  return RECORD(cmd->ctxt, command_buffer_ref_get, 0, 0);
+}
+
+int
+rb_command_buffer_ref_put(struct rb_command_buffer* cmd)
+{
+  if(!cmd)
+    return -1;
+  RECORD(cmd->ctxt, command_buffer_ref_put, 0, 0);
+  ref_put(&cmd->ref, release_command_buffer);
+  return 0;
+}
+
+int
+rb_reset_command_buffer(struct rb_command_buffer* cmd)
+{
+  if(!cmd)
+    return -1;
+  rb_clear_command_list(&cmd->list);
+  return RECORD(cmd->ctxt, reset_command_buffer, 0, 0);
+}
+
+int
+rb_cmd_bind_program(struct rb_command_buffer* cmd, struct rb_program* prog)
+{
+  return cmd ? rb_encode_bind_program(&cmd->list, prog) : -1;
+}
+
+int
+rb_cmd_bind_vertex_array
+  (struct rb_command_buffer* cmd,
+   struct rb_vertex_array* varray)
+{
+  return cmd ? rb_encode_bind_vertex_array(&cmd->list, varray) : -1;
+}
+
+int
+rb_cmd_bind_tex2d
+  (struct rb_command_buffer* cmd,
+   struct rb_tex2d* tex,
+   unsigned int tex_unit)
+{
+  return cmd ? rb_encode_bind_tex2d(&cmd->list, tex, tex_unit) : -1;
+}
+
+int
+rb_cmd_bind_sampler
+  (struct rb_command_buffer* cmd,
+   struct rb_sampler* sampler,
+   unsigned int tex_unit)
+{
+  return cmd ? rb_encode_bind_sampler(&cmd->list, sampler, tex_unit) : -1;
+}
+
+int
+rb_cmd_bind_framebuffer
+  (struct rb_command_buffer* cmd,
+   struct rb_framebuffer* buffer)
+{
+  return cmd ? rb_encode_bind_framebuffer(&cmd->list, buffer) : -1;
+}
+
+int
+rb_cmd_blend
+  (struct rb_command_buffer* cmd,
+   const struct rb_blend_desc* desc)
+{
+  return cmd ? rb_encode_blend(&cmd->list, desc) : -1;
+}
+
+int
+rb_cmd_depth_stencil
+  (struct rb_command_buffer* cmd,
+   const struct rb_depth_stencil_desc* desc)
+{
+  return cmd ? rb_encode_depth_stencil(&cmd->list, desc) : -1;
+}
+
+int
+rb_cmd_rasterizer
+  (struct rb_command_buffer* cmd,
+   const struct rb_rasterizer_desc* desc)
+{
+  return cmd ? rb_encode_rasterizer(&cmd->list, desc) : -1;
+}
+
+int
+rb_cmd_viewport
+  (struct rb_command_buffer* cmd,
+   const struct rb_viewport_desc* desc)
+{
+  return cmd ? rb_encode_viewport(&cmd->list, desc) : -1;
+}
+
+int
+rb_cmd_clear
+  (struct rb_command_buffer* cmd,
+   int clear_flag,
+   const float color_val[4],
+   float depth_val,
+   char stencil_val)
+{
+  if(!cmd)
+    return -1;
+  return rb_encode_clear
+    (&cmd->list, clear_flag, color_val, depth_val, stencil_val);
+}
+
+int
+rb_cmd_uniform_data
+  (struct rb_command_buffer* cmd,
+   struct rb_uniform* uniform,
+   int count,
+   const void* data)
+{
+  size_t size = 0;
+
+  if(!cmd || !uniform || count <= 0)
+    return -1;
+  size = sizeof_uniform_data(uniform, count);
+  return rb_encode_uniform_data(&cmd->list, uniform, count, size, data);
+}
+
+int
+rb_cmd_buffer_data
+  (struct rb_command_buffer* cmd,
+   struct rb_buffer* buf,
+   int offset,
+   int size,
+   const void* data)
+{
+  return cmd ? rb_encode_buffer_data(&cmd->list, buf, offset, size, data) : -1;
+}
+
+int
+rb_cmd_draw
+  (struct rb_command_buffer* cmd,
+   enum rb_primitive_type prim_type,
+   unsigned int count)
+{
+  return cmd ? rb_encode_draw(&cmd->list, prim_type, count) : -1;
+}
+
+int
+rb_cmd_draw_indexed
+  (struct rb_command_buffer* cmd,
+   enum rb_primitive_type prim_type,
+   unsigned int count)
+{
+  return cmd ? rb_encode_draw_indexed(&cmd->list, prim_type, count) : -1;
+}
+
+int
+rb_submit_command_buffers
+  (struct rb_context* ctxt,
+   size_t count,
+   struct rb_command_buffer* const cmd_list[])
+{
+  size_t nb_bytes = 0;
+  size_t i = 0;
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(count && !cmd_list)
+    return RECORD(ctxt, submit_command_buffers, 0, -1);
+  for(i = 0; i < count; ++i) {
+    if(!cmd_list[i] || cmd_list[i]->ctxt != ctxt)
+      return RECORD(ctxt, submit_command_buffers, 0, -1);
+  }
+  for(i = 0; i < count; ++i) {
+    if(rb_execute_command_list(ctxt, &cmd_list[i]->list) != 0)
+      err = -1;
+    nb_bytes += cmd_list[i]->list.size;
+  }
+  return RECORD(ctxt, submit_command_buffers, nb_bytes, err);
+}
+
+/*******************************************************************************
+ *
+ * Bundle functions.
+ *
+ ******************************************************************************/
+int
+rb_create_bundle
+  (struct rb_context* ctxt,
+   struct rb_command_buffer* cmd,
+   struct rb_bundle** out_bundle)
+{
+  struct rb_bundle* bundle = NULL;
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!cmd || cmd->ctxt != ctxt || !out_bundle)
+    return RECORD(ctxt, create_bundle, 0, -1);
+  if(!(bundle = rb_null_alloc_object(ctxt, RB_OBJECT_BUNDLE)))
+    return RECORD(ctxt, create_bundle, 0, -1);
+  rb_init_command_list(ctxt->allocator, &bundle->list);
+  if(rb_bake_command_list
+     (&bundle->list, &cmd->list, RB_NULL_MAX_TEXTURE_UNITS) != 0) {
+    rb_release_command_list(&bundle->list);
+    rb_null_free_object(ctxt, RB_OBJECT_BUNDLE, bundle);
+    err = -1;
+  } else {
+    ref_init(&bundle->ref);
+    ref_get(&ctxt->ref);
+    bundle->ctxt = ctxt;
+    rb_command_list_ref_get_objects(&bundle->list);
+    *out_bundle = bundle;
+  }
+  return RECORD(ctxt, create_bundle, 0, err);
+}
+
+int
+rb_bundle_ref_get(struct rb_bundle* bundle)
+{
+  if(!bundle)
+    return -1;
+  ref_get(&bundle->ref);
+  return RECORD(bundle->ctxt, bundle_ref_get, 0, 0);
+}
+
+int
+rb_bundle_ref_put(struct rb_bundle* bundle)
+{
+  if(!bundle)
+    return -1;
+  RECORD(bundle->ctxt, bundle_ref_put, 0, 0);
+  ref_put(&bundle->ref, release_bundle);
+  return 0;
+}
+
+int
+rb_bundle_uniform_data
+  (struct rb_bundle* bundle,
+   struct rb_uniform* uniform,
+   int count,
+   const void* data)
+{
+  size_t size = 0;
+  int err = 0;
+
+  if(!bundle)
+    return -1;
+  if(!uniform || count <= 0) {
+    err = -1;
+  } else {
+    size = sizeof_uniform_data(uniform, count);
+    err = rb_patch_uniform_data(&bundle->list, uniform, count, size, data);
+  }
+  return RECORD(bundle->ctxt, bundle_uniform_data, err ? 0 : size, err);
+}
+
+int
+rb_execute_bundle(struct rb_context* ctxt, struct rb_bundle* bundle)
+{
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!bundle || bundle->ctxt != ctxt)
+    return RECORD(ctxt, execute_bundle, 0, -1);
+  err = rb_execute_command_list(ctxt, &bundle->list);
+  return RECORD(ctxt, execute_bundle, bundle->list.size, err);
+}
@@ -0,0 +1,270 @@
+#include "null/rb_null_context.h"
+#include "null/rb_null_program.h"
+#include "null/rb_null_resources.h"
+#include "rb.h"
+#include <snlsys/mem_allocator.h>
+#include <snlsys/snlsys.h>
+#include <stdint.h>
+#include <string.h>
+
+static const size_t object_sizes[RB_OBJECT_TYPES_COUNT] = {
+  [RB_OBJECT_ATTRIB] = sizeof(struct rb_attrib),
+  [RB_OBJECT_BUFFER] = sizeof(struct rb_buffer),
+  [RB_OBJECT_BUNDLE] = sizeof(struct rb_bundle),
+  [RB_OBJECT_COMMAND_BUFFER] = sizeof(struct rb_command_buffer),
+  [RB_OBJECT_FENCE] = sizeof(struct rb_fence),
+  [RB_OBJECT_FRAMEBUFFER] = sizeof(struct rb_framebuffer),
+  [RB_OBJECT_PROGRAM] = sizeof(struct rb_program),
+  [RB_OBJECT_SAMPLER] = sizeof(struct rb_sampler),
+  [RB_OBJECT_SHADER] = sizeof(struct rb_shader),
+  [RB_OBJECT_TEX2D] = sizeof(struct rb_tex2d),
+  [RB_OBJECT_UNIFORM] = sizeof(struct rb_uniform),
+  [RB_OBJECT_VERTEX_ARRAY] = sizeof(struct rb_vertex_array)
+};
+
+static const char* func_names[RB_NULL_FUNCS_COUNT] = {
+  #define RB_FUNC(func_name, ...) STR(func_name),
+  #include "rb_func.h"
+  #undef RB_FUNC
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static void
+setup_default_state(struct rb_context* ctxt)
+{
+  const struct rb_stencil_op_desc stencil_op = {
+    .stencil_fail = RB_STENCIL_OP_KEEP,
+    .depth_fail = RB_STENCIL_OP_KEEP,
+    .depth_pass = RB_STENCIL_OP_KEEP,
+    .stencil_func = RB_COMPARISON_ALWAYS,
+    .write_mask = ~0u
+  };
+  ASSERT(ctxt);
+
+  /* Default state of an OpenGL context. */
+  memset(&ctxt->state, 0, sizeof(struct state));
+  ctxt->state.viewport.max_depth = 1.f;
+  ctxt->state.blend.src_blend_RGB = RB_BLEND_ONE;
+  ctxt->state.blend.src_blend_Alpha = RB_BLEND_ONE;
+  ctxt->state.blend.dst_blend_RGB = RB_BLEND_ZERO;
+  ctxt->state.blend.dst_blend_Alpha = RB_BLEND_ZERO;
+  ctxt->state.blend.blend_op_RGB = RB_BLEND_OP_ADD;
+  ctxt->state.blend.blend_op_Alpha = RB_BLEND_OP_ADD;
+  ctxt->state.depth_stencil.enable_depth_write = 1;
+  ctxt->state.depth_stencil.depth_func = RB_COMPARISON_LESS;
+  ctxt->state.depth_stencil.front_face_op = stencil_op;
+  ctxt->state.depth_stencil.back_face_op = stencil_op;
+  ctxt->state.rasterizer.fill_mode = RB_FILL_SOLID;
+  ctxt->state.rasterizer.cull_mode = RB_CULL_NONE;
+  ctxt->state.rasterizer.front_facing = RB_ORIENTATION_CCW;
+  ctxt->state.error_check.mode = RB_ERROR_CHECK_NONE;
+}
+
+static void
+release_context(struct ref* ref)
+{
+  struct rb_context* ctxt = NULL;
+  int i = 0;
+  ASSERT(ref);
+
+  ctxt = CONTAINER_OF(ref, struct rb_context, ref);
+  rb_release_variant_cache(&ctxt->variant_cache);
+  /* The objects reference their context and are thus already released. */
+  for(i = 0; i < RB_OBJECT_TYPES_COUNT; ++i)
+    rb_release_slab(ctxt->pool_list + i);
+  rb_release_string_arena(&ctxt->names);
+  rb_release_arena(&ctxt->frame);
+  if(ctxt->share != ctxt)
+    rb_null_context_unref(ctxt->share);
+  MEM_FREE(ctxt->allocator, ctxt);
+}
+
+static int
+create_context
+  (struct mem_allocator* specific_allocator,
+   struct rb_context** out_ctxt)
+{
+  struct mem_allocator* allocator = NULL;
+  struct rb_context* ctxt = NULL;
+  int i = 0;
+  ASSERT(out_ctxt);
+
+  allocator = specific_allocator ? specific_allocator : &mem_default_allocator;
+  ctxt = MEM_CALLOC(allocator, 1, sizeof(struct rb_context));
+  if(!ctxt)
+    return -1;
+  ctxt->allocator = allocator;
+  ctxt->share = ctxt;
+  ref_init(&ctxt->ref);
+  rb_init_variant_cache(allocator, &ctxt->variant_cache);
+  for(i = 0; i < RB_OBJECT_TYPES_COUNT; ++i)
+    rb_init_slab(allocator, object_sizes[i], ctxt->pool_list + i);
+  rb_init_string_arena(allocator, &ctxt->names);
+  rb_init_arena(allocator, &ctxt->frame);
+  setup_default_state(ctxt);
+  *out_ctxt = ctxt;
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Render backend context functions.
+ *
+ ******************************************************************************/
+int
+rb_create_context
+  (struct mem_allocator* allocator,
+   struct rb_context** out_ctxt)
+{
+  if(!out_ctxt || create_context(allocator, out_ctxt) != 0)
+    return -1;
+  return RECORD(*out_ctxt, create_context, 0, 0);
+}
+
+int
+rb_create_headless_context
+  (struct mem_allocator* allocator,
+   const struct rb_headless_desc* desc,
+   struct rb_context** out_ctxt)
+{
+  struct rb_context* ctxt = NULL;
+
+  if(!desc || !desc->width || !desc->height || !out_ctxt)
+    return -1;
+  if(desc->width > INT32_MAX || desc->height > INT32_MAX)
+    return -1;
+  if(create_context(allocator, &ctxt) != 0)
+    return -1;
+
+  /* The default framebuffer is simulated by its size. */
+  ctxt->default_width = desc->width;
+  ctxt->default_height = desc->height;
+  ctxt->state.viewport.width = (int)desc->width;
+  ctxt->state.viewport.height = (int)desc->height;
+  *out_ctxt = ctxt;
+  return RECORD(ctxt, create_headless_context, 0, 0);
+}
+
+int
+rb_create_loader_context
+  (struct rb_context* ctxt,
+   struct rb_context** out_loader)
+{
+  struct rb_context* loader = NULL;
+
+  if(!ctxt || !out_loader)
+    return -1;
+  if(create_context(ctxt->allocator, &loader) != 0)
+    return -1;
+  /* The loader keeps alive the context whose objects it shares. The call is
+   * recorded by the loader since it is issued by its thread. */
+  ref_get(&ctxt->share->ref);
+  loader->share = ctxt->share;
+  *out_loader = loader;
+  return RECORD(loader, create_loader_context, 0, 0);
+}
+
+int
+rb_context_ref_get(struct rb_context* ctxt)
+{
+  if(!ctxt)
+    return -1;
+  ref_get(&ctxt->ref);
+  return RECORD(ctxt, context_ref_get, 0, 0);
+}
+
+int
+rb_context_ref_put(struct rb_context* ctxt)
+{
+  if(!ctxt)
+    return -1;
+  RECORD(ctxt, context_ref_put, 0, 0);
+  ref_put(&ctxt->ref, release_context);
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Statistics functions.
+ *
+ ******************************************************************************/
+int
+rb_get_pool_stats(struct rb_context* ctxt, struct rb_pool_stats* stats)
+{
+  int i = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!stats)
+    return RECORD(ctxt, get_pool_stats, 0, -1);
+  for(i = 0; i < RB_OBJECT_TYPES_COUNT; ++i)
+    rb_slab_stats(ctxt->pool_list + i, stats->object_list + i);
+  stats->nb_strings = ctxt->names.nb_strings;
+  stats->string_size = ctxt->names.size;
+  stats->frame_size = ctxt->frame.size;
+  return RECORD(ctxt, get_pool_stats, 0, 0);
+}
+
+int
+rb_null_get_stats(struct rb_context* ctxt, struct rb_null_stats* stats)
+{
+  int i = 0;
+
+  if(!ctxt || !stats)
+    return -1;
+  memcpy(stats->func_list, ctxt->func_stats, sizeof(ctxt->func_stats));
+  stats->nb_objects = 0;
+  stats->nb_pooled_objects = 0;
+  for(i = 0; i < RB_OBJECT_TYPES_COUNT; ++i) {
+    stats->nb_objects += ctxt->pool_list[i].nb_objects;
+    stats->nb_pooled_objects += ctxt->pool_list[i].nb_slots;
+  }
+  return 0;
+}
+
+int
+rb_null_clear_stats(struct rb_context* ctxt)
+{
+  if(!ctxt)
+    return -1;
+  memset(ctxt->func_stats, 0, sizeof(ctxt->func_stats));
+  return 0;
+}
+
+const char*
+rb_null_func_name(enum rb_null_func func)
+{
+  if((unsigned int)func >= RB_NULL_FUNCS_COUNT)
+    return NULL;
+  return func_names[func];
+}
+
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+void
+rb_null_context_unref(struct rb_context* ctxt)
+{
+  ASSERT(ctxt);
+  ref_put(&ctxt->ref, release_context);
+}
+
+char*
+rb_null_strdup(struct rb_context* ctxt, const char* str, size_t len)
+{
+  char* dst = NULL;
+  ASSERT(ctxt && str);
+
+  dst = MEM_ALLOC(ctxt->allocator, len + 1);
+  if(dst) {
+    memcpy(dst, str, len);
+    dst[len] = '\0';
+  }
+  return dst;
+}
@@ -0,0 +1,111 @@
+#ifndef RB_NULL_CONTEXT_H
+#define RB_NULL_CONTEXT_H
+
+#include "common/rb_pool.h"
+#include "common/rb_shader_variant.h"
+#include "null/rb_null.h"
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+#include <stddef.h>
+
+#define RB_NULL_MAX_ATTRIBS 16
+#define RB_NULL_MAX_COLOR_ATTACHMENTS 8
+#define RB_NULL_MAX_TEXTURE_UNITS 16
+#define RB_NULL_NB_BUFFER_TARGETS 2
+
+struct mem_allocator;
+
+struct rb_context {
+  struct ref ref;
+  struct mem_allocator* allocator;
+  /* Context whose buffers and textures are shared, i.e. the context from
+   * which a loader context is created, or the context itself. */
+  struct rb_context* share;
+  struct rb_slab pool_list[RB_OBJECT_TYPES_COUNT]; /* Per object type. */
+  struct rb_string_arena names; /* Names of the declarations. */
+  struct rb_arena frame; /* Transient data released at the end of frame. */
+  int is_in_frame;
+  struct rb_variant_cache variant_cache; /* Shared shader variants. */
+  struct rb_null_func_stats func_stats[RB_NULL_FUNCS_COUNT];
+  /* Size of the default framebuffer. Null if the context was not created by
+   * the rb_create_headless_context function. */
+  unsigned int default_width;
+  unsigned int default_height;
+  /* Simulated pipeline state. The bound objects are not referenced: they are
+   * unbound on their release. */
+  struct state {
+    struct rb_viewport_desc viewport;
+    struct rb_blend_desc blend;
+    struct rb_depth_stencil_desc depth_stencil;
+    struct rb_rasterizer_desc rasterizer;
+    struct rb_error_check_desc error_check;
+    struct rb_compile_desc compile;
+    struct rb_program* program;
+    struct rb_vertex_array* vertex_array;
+    struct rb_framebuffer* framebuffer;
+    struct rb_buffer* buffer_binding[RB_NULL_NB_BUFFER_TARGETS];
+    struct rb_tex2d* tex2d_binding[RB_NULL_MAX_TEXTURE_UNITS];
+    struct rb_sampler* sampler_binding[RB_NULL_MAX_TEXTURE_UNITS];
+  } state;
+};
+
+/* Record a call of `func' and return its error code. */
+static FINLINE int
+rb_null_record
+  (struct rb_context* ctxt,
+   enum rb_null_func func,
+   size_t nb_bytes,
+   int err)
+{
+  struct rb_null_func_stats* stats = NULL;
+  ASSERT(ctxt && func < RB_NULL_FUNCS_COUNT);
+  stats = ctxt->func_stats + func;
+  ++stats->nb_calls;
+  stats->nb_errors += err != 0;
+  stats->nb_bytes += err != 0 ? 0 : nb_bytes;
+  return err;
+}
+
+#define RECORD(ctxt, func, nb_bytes, err) \
+  rb_null_record((ctxt), RB_NULL_##func, (nb_bytes), (err))
+
+/* Release a reference onto the context without recording the call. The
+ * objects use it to release the context they reference. */
+LOCAL_SYM void
+rb_null_context_unref
+  (struct rb_context* ctxt);
+
+/* Check whether the buffers and textures of `a' may be used by `b'. */
+static FINLINE int
+rb_null_is_shared(const struct rb_context* a, const struct rb_context* b)
+{
+  ASSERT(a && b);
+  return a->share == b->share;
+}
+
+/* Return a zeroed object slot. */
+static FINLINE void*
+rb_null_alloc_object(struct rb_context* ctxt, enum rb_object_type type)
+{
+  ASSERT(ctxt && type < RB_OBJECT_TYPES_COUNT);
+  return rb_slab_alloc(ctxt->pool_list + type);
+}
+
+static FINLINE void
+rb_null_free_object
+  (struct rb_context* ctxt,
+   enum rb_object_type type,
+   void* object)
+{
+  ASSERT(ctxt && type < RB_OBJECT_TYPES_COUNT);
+  rb_slab_free(ctxt->pool_list + type, object);
+}
+
+/* Allocate a copy of the `len' first characters of `str'. */
+LOCAL_SYM char*
+rb_null_strdup
+  (struct rb_context* ctxt,
+   const char* str,
+   size_t len);
+
+#endif /* RB_NULL_CONTEXT_H */
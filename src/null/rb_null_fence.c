@@ -0,0 +1,89 @@
+#include "null/rb_null_context.h"
+#include "null/rb_null_resources.h"
+#include "rb.h"
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+
+/* Nothing is executed: a fence is signaled as soon as it is created. */
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static void
+release_fence(struct ref* ref)
+{
+  struct rb_fence* fence = NULL;
+  struct rb_context* ctxt = NULL;
+  ASSERT(ref);
+
+  fence = CONTAINER_OF(ref, struct rb_fence, ref);
+  ctxt = fence->ctxt;
+  rb_null_free_object(ctxt, RB_OBJECT_FENCE, fence);
+  rb_null_context_unref(ctxt);
+}
+
+/*******************************************************************************
+ *
+ * Fence functions.
+ *
+ ******************************************************************************/
+int
+rb_create_fence(struct rb_context* ctxt, struct rb_fence** out_fence)
+{
+  struct rb_fence* fence = NULL;
+
+  if(!ctxt)
+    return -1;
+  if(!out_fence || !(fence = rb_null_alloc_object(ctxt, RB_OBJECT_FENCE)))
+    return RECORD(ctxt, create_fence, 0, -1);
+  ref_init(&fence->ref);
+  ref_get(&ctxt->ref);
+  fence->ctxt = ctxt;
+  *out_fence = fence;
+  return RECORD(ctxt, create_fence, 0, 0);
+}
+
+int
+rb_fence_ref_get(struct rb_fence* fence)
+{
+  if(!fence)
+    return -1;
+  ref_get(&fence->ref);
+  return RECORD(fence->ctxt, fence_ref_get, 0, 0);
+}
+
+int
+rb_fence_ref_put(struct rb_fence* fence)
+{
+  if(!fence)
+    return -1;
+  RECORD(fence->ctxt, fence_ref_put, 0, 0);
+  ref_put(&fence->ref, release_fence);
+  return 0;
+}
+
+int
+rb_wait_fence(struct rb_context* ctxt, struct rb_fence* fence)
+{
+  if(!ctxt)
+    return -1;
+  if(!fence || !rb_null_is_shared(fence->ctxt, ctxt))
+    return RECORD(ctxt, wait_fence, 0, -1);
+  return RECORD(ctxt, wait_fence, 0, 0);
+}
+
+int
+rb_poll_fence
+  (struct rb_context* ctxt,
+   struct rb_fence* fence,
+   int* is_signaled)
+{
+  if(!ctxt)
+    return -1;
+  if(!fence || !is_signaled || !rb_null_is_shared(fence->ctxt, ctxt))
+    return RECORD(ctxt, poll_fence, 0, -1);
+  *is_signaled = 1;
+  return RECORD(ctxt, poll_fence, 0, 0);
+}
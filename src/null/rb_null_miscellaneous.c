@@ -0,0 +1,270 @@
+#include "null/rb_null_context.h"
+#include "null/rb_null_program.h"
+#include "null/rb_null_resources.h"
+#include "rb.h"
+#include <snlsys/snlsys.h>
+#include <stdint.h>
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static int
+is_draw_valid(const struct rb_context* ctxt, enum rb_primitive_type prim_type)
+{
+  ASSERT(ctxt);
+  if((unsigned int)prim_type > RB_TRIANGLE_STRIP)
+    return 0;
+  /* A failed link unbinds the program. A bound program is thus linked. */
+  if(!ctxt->state.program)
+    return 0;
+  ASSERT(ctxt->state.program->is_linked);
+  /* Draw into the bound framebuffer or into the headless default one. */
+  return ctxt->state.framebuffer || ctxt->default_width;
+}
+
+static int
+is_stencil_op_valid(const struct rb_stencil_op_desc* op)
+{
+  ASSERT(op);
+  return (unsigned int)op->stencil_fail <= RB_STENCIL_OP_INVERT
+      && (unsigned int)op->depth_fail <= RB_STENCIL_OP_INVERT
+      && (unsigned int)op->depth_pass <= RB_STENCIL_OP_INVERT
+      && (unsigned int)op->stencil_func <= RB_COMPARISON_GREATER_EQUAL;
+}
+
+/*******************************************************************************
+ *
+ * Miscellaneous functions.
+ *
+ ******************************************************************************/
+int
+rb_draw_indexed
+  (struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int count)
+{
+  const struct rb_vertex_array* varray = NULL;
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  varray = ctxt->state.vertex_array;
+  /* The indices are 32-bits unsigned integers. */
+  if(!is_draw_valid(ctxt, prim_type)
+  || !varray
+  || !varray->index_buffer
+  || (size_t)count * sizeof(uint32_t) > varray->index_buffer->desc.size)
+    err = -1;
+  return RECORD(ctxt, draw_indexed, 0, err);
+}
+
+int
+rb_multi_draw_indexed
+  (struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int nb_ranges,
+   const struct rb_draw_range* range_list)
+{
+  const struct rb_vertex_array* varray = NULL;
+  unsigned int i = 0;
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  varray = ctxt->state.vertex_array;
+  if(!is_draw_valid(ctxt, prim_type)
+  || (nb_ranges && !range_list)
+  || !varray
+  || !varray->index_buffer) {
+    err = -1;
+  } else {
+    for(i = 0; i < nb_ranges; ++i) {
+      const size_t end = (size_t)range_list[i].first_index+range_list[i].count;
+      if(end * sizeof(uint32_t) > varray->index_buffer->desc.size)
+        err = -1;
+    }
+  }
+  return RECORD(ctxt, multi_draw_indexed, 0, err);
+}
+
+int
+rb_draw
+  (struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int count)
+{
+  (void)count;
+  if(!ctxt)
+    return -1;
+  return RECORD(ctxt, draw, 0, is_draw_valid(ctxt, prim_type) ? 0 : -1);
+}
+
+int
+rb_clear
+  (struct rb_context* ctxt,
+   int flag,
+   const float color[4],
+   float depth,
+   char stencil)
+{
+  int err = 0;
+  (void)depth;
+  (void)stencil;
+
+  if(!ctxt)
+    return -1;
+  if(((flag & RB_CLEAR_COLOR_BIT) != 0 && !color)
+  || (!ctxt->state.framebuffer && !ctxt->default_width))
+    err = -1;
+  return RECORD(ctxt, clear, 0, err);
+}
+
+/* Nothing is submitted and thus there is nothing to flush. */
+int
+rb_flush(struct rb_context* ctxt)
+{
+  if(!ctxt)
+    return -1;
+  return RECORD(ctxt, flush, 0, 0);
+}
+
+int
+rb_begin_frame(struct rb_context* ctxt)
+{
+  if(!ctxt)
+    return -1;
+  if(ctxt->is_in_frame)
+    return RECORD(ctxt, begin_frame, 0, -1);
+  ctxt->is_in_frame = 1;
+  return RECORD(ctxt, begin_frame, 0, 0);
+}
+
+int
+rb_end_frame(struct rb_context* ctxt)
+{
+  if(!ctxt)
+    return -1;
+  if(!ctxt->is_in_frame)
+    return RECORD(ctxt, end_frame, 0, -1);
+  rb_reset_arena(&ctxt->frame);
+  ctxt->is_in_frame = 0;
+  return RECORD(ctxt, end_frame, 0, 0);
+}
+
+int
+rb_frame_alloc(struct rb_context* ctxt, size_t size, void** out_mem)
+{
+  void* mem = NULL;
+
+  if(!ctxt)
+    return -1;
+  if(!out_mem
+  || !size
+  || !ctxt->is_in_frame
+  || !(mem = rb_arena_alloc(&ctxt->frame, size)))
+    return RECORD(ctxt, frame_alloc, 0, -1);
+  *out_mem = mem;
+  return RECORD(ctxt, frame_alloc, size, 0);
+}
+
+int
+rb_viewport(struct rb_context* ctxt, const struct rb_viewport_desc* vp)
+{
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!vp || vp->width < 0 || vp->height < 0)
+    err = -1;
+  else
+    ctxt->state.viewport = *vp;
+  return RECORD(ctxt, viewport, 0, err);
+}
+
+int
+rb_blend(struct rb_context* ctxt, const struct rb_blend_desc* blend)
+{
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!blend
+  || (unsigned int)blend->src_blend_RGB > RB_BLEND_CONSTANT
+  || (unsigned int)blend->src_blend_Alpha > RB_BLEND_CONSTANT
+  || (unsigned int)blend->dst_blend_RGB > RB_BLEND_CONSTANT
+  || (unsigned int)blend->dst_blend_Alpha > RB_BLEND_CONSTANT
+  || (unsigned int)blend->blend_op_RGB > RB_BLEND_OP_MAX
+  || (unsigned int)blend->blend_op_Alpha > RB_BLEND_OP_MAX)
+    err = -1;
+  else
+    ctxt->state.blend = *blend;
+  return RECORD(ctxt, blend, 0, err);
+}
+
+int
+rb_depth_stencil
+  (struct rb_context* ctxt, const struct rb_depth_stencil_desc* desc)
+{
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!desc
+  || (unsigned int)desc->depth_func > RB_COMPARISON_GREATER_EQUAL
+  || !is_stencil_op_valid(&desc->front_face_op)
+  || !is_stencil_op_valid(&desc->back_face_op))
+    err = -1;
+  else
+    ctxt->state.depth_stencil = *desc;
+  return RECORD(ctxt, depth_stencil, 0, err);
+}
+
+int
+rb_rasterizer(struct rb_context* ctxt, const struct rb_rasterizer_desc* desc)
+{
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!desc
+  || (unsigned int)desc->fill_mode > RB_FILL_SOLID
+  || (unsigned int)desc->cull_mode > RB_CULL_BACK
+  || (unsigned int)desc->front_facing > RB_ORIENTATION_CCW)
+    err = -1;
+  else
+    ctxt->state.rasterizer = *desc;
+  return RECORD(ctxt, rasterizer, 0, err);
+}
+
+int
+rb_get_config(struct rb_context* ctxt, struct rb_config* cfg)
+{
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!cfg) {
+    err = -1;
+  } else {
+    cfg->max_tex_max_anisotropy = SIZE_MAX;
+    cfg->max_tex_size = SIZE_MAX;
+  }
+  return RECORD(ctxt, get_config, 0, err);
+}
+
+/* There is no underlying API whose errors are checked. */
+int
+rb_error_check(struct rb_context* ctxt, const struct rb_error_check_desc* desc)
+{
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!desc || (unsigned int)desc->mode > RB_ERROR_CHECK_STRICT)
+    err = -1;
+  else
+    ctxt->state.error_check = *desc;
+  return RECORD(ctxt, error_check, 0, err);
+}
@@ -0,0 +1,598 @@
+#include "null/rb_null_context.h"
+#include "null/rb_null_program.h"
+#include "rb.h"
+#include <snlsys/list.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/snlsys.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_STATEMENT_TOKENS 64
+
+struct token {
+  const char* str;
+  size_t len; /* 0 <=> end of the source. */
+};
+
+struct decl_list {
+  struct rb_null_decl* buffer;
+  size_t nb;
+  size_t capacity;
+};
+
+/*******************************************************************************
+ *
+ * GLSL declaration scanner. The shaders are not compiled: their sources are
+ * only scanned for the global uniform and vertex input declarations in order
+ * to expose the program uniforms and attribs as a driver would.
+ *
+ ******************************************************************************/
+static FINLINE int
+is_token(const struct token* tok, const char* str)
+{
+  ASSERT(tok && str);
+  return tok->len == strlen(str) && !strncmp(tok->str, str, tok->len);
+}
+
+static void
+next_token(const char** cur, const char* end, struct token* tok)
+{
+  const char* ptr = NULL;
+  ASSERT(cur && end && tok);
+
+  ptr = *cur;
+  for(;;) {
+    while(ptr < end && isspace((unsigned char)*ptr))
+      ++ptr;
+    if(ptr + 1 < end && ptr[0] == '/' && ptr[1] == '/') {
+      while(ptr < end && *ptr != '\n')
+        ++ptr;
+    } else if(ptr + 1 < end && ptr[0] == '/' && ptr[1] == '*') {
+      for(ptr += 2; ptr < end; ++ptr) {
+        if(ptr + 1 < end && ptr[0] == '*' && ptr[1] == '/') {
+          ptr += 2;
+          break;
+        }
+      }
+    } else if(ptr < end && *ptr == '#') { /* Preprocessor directive. */
+      while(ptr < end && *ptr != '\n')
+        ptr += (*ptr == '\\' && ptr + 1 < end) ? 2 : 1;
+    } else {
+      break;
+    }
+  }
+
+  tok->str = ptr;
+  if(ptr >= end) {
+    tok->len = 0;
+  } else if(isalnum((unsigned char)*ptr) || *ptr == '_') {
+    while(ptr < end && (isalnum((unsigned char)*ptr) || *ptr == '_'))
+      ++ptr;
+    tok->len = (size_t)(ptr - tok->str);
+  } else {
+    ++ptr;
+    tok->len = 1;
+  }
+  *cur = ptr;
+}
+
+static FINLINE int
+is_skipped_qualifier(const struct token* tok)
+{
+  return is_token(tok, "lowp")
+      || is_token(tok, "mediump")
+      || is_token(tok, "highp")
+      || is_token(tok, "flat")
+      || is_token(tok, "smooth")
+      || is_token(tok, "noperspective")
+      || is_token(tok, "centroid")
+      || is_token(tok, "invariant");
+}
+
+static enum rb_type
+glsl_type(const struct token* tok)
+{
+  if(is_token(tok, "float")) return RB_FLOAT;
+  if(is_token(tok, "vec2")) return RB_FLOAT2;
+  if(is_token(tok, "vec3")) return RB_FLOAT3;
+  if(is_token(tok, "vec4")) return RB_FLOAT4;
+  if(is_token(tok, "mat4")) return RB_FLOAT4x4;
+  /* Samplers and the types without a rb_type counterpart. */
+  return RB_UNKNOWN_TYPE;
+}
+
+/* Add a declaration or check its consistency with a previous declaration of
+ * the same name. Return -1 on allocation error and -2 if the declarations
+ * are inconsistent. */
+static int
+add_decl
+  (struct rb_context* ctxt,
+   struct decl_list* list,
+   const struct token* name,
+   enum rb_type type,
+   unsigned int count,
+   int location)
+{
+  struct rb_null_decl* decl = NULL;
+  size_t i = 0;
+  ASSERT(ctxt && list && name && name->len);
+
+  for(i = 0; i < list->nb; ++i) {
+    decl = list->buffer + i;
+    if(is_token(name, decl->name))
+      return decl->type == type && decl->count == count ? 0 : -2;
+  }
+  if(list->nb == list->capacity) {
+    const size_t capacity = list->capacity ? list->capacity * 2 : 8;
+    decl = MEM_REALLOC
+      (ctxt->allocator, list->buffer, capacity * sizeof(struct rb_null_decl));
+    if(!decl)
+      return -1;
+    list->buffer = decl;
+    list->capacity = capacity;
+  }
+  decl = list->buffer + list->nb;
+  decl->name = rb_intern_string(&ctxt->names, name->str, name->len);
+  if(!decl->name)
+    return -1;
+  decl->type = type;
+  decl->count = count;
+  decl->location = location;
+  ++list->nb;
+  return 0;
+}
+
+/* Scan a global statement, i.e. the tokens preceding a `;'. */
+static int
+scan_statement
+  (struct rb_context* ctxt,
+   enum rb_shader_type shader_type,
+   const struct token* tok,
+   size_t nb_toks,
+   struct decl_list* uniforms,
+   struct decl_list* attribs)
+{
+  struct decl_list* dst = NULL;
+  enum rb_type type = RB_UNKNOWN_TYPE;
+  int location = -1;
+  size_t i = 0;
+  int err = 0;
+  ASSERT(tok && uniforms && attribs);
+
+  if(i < nb_toks && is_token(tok + i, "layout")) {
+    for(++i; i < nb_toks && !is_token(tok + i, ")"); ++i) {
+      if(is_token(tok + i, "location")
+      && i + 2 < nb_toks
+      && is_token(tok + i + 1, "="))
+        location = atoi(tok[i + 2].str);
+    }
+    ++i;
+  }
+  while(i < nb_toks && is_skipped_qualifier(tok + i))
+    ++i;
+  if(i >= nb_toks)
+    return 0;
+  if(is_token(tok + i, "uniform")) {
+    dst = uniforms;
+  } else if(shader_type == RB_VERTEX_SHADER
+  && (is_token(tok + i, "in") || is_token(tok + i, "attribute"))) {
+    dst = attribs;
+  } else {
+    return 0;
+  }
+  for(++i; i < nb_toks && is_skipped_qualifier(tok + i); ++i);
+  if(i >= nb_toks)
+    return 0;
+  type = glsl_type(tok + i);
+
+  /* List of declarators. */
+  for(++i; !err && i < nb_toks; ++i) {
+    const struct token* name = tok + i;
+    unsigned int count = 1;
+
+    if(!isalpha((unsigned char)*name->str) && *name->str != '_')
+      break;
+    if(++i < nb_toks && is_token(tok + i, "[")) {
+      if(i + 1 < nb_toks && isdigit((unsigned char)*tok[i + 1].str))
+        count = (unsigned int)strtoul(tok[i + 1].str, NULL, 10);
+      while(i < nb_toks && !is_token(tok + i, "]"))
+        ++i;
+      ++i;
+    }
+    err = add_decl(ctxt, dst, name, type, count, location);
+    if(location >= 0)
+      location += (int)count;
+    /* Skip the initializer. */
+    while(i < nb_toks && !is_token(tok + i, ","))
+      ++i;
+  }
+  return err;
+}
+
+static int
+scan_shader
+  (struct rb_shader* shader,
+   struct decl_list* uniforms,
+   struct decl_list* attribs)
+{
+  struct token tok_list[MAX_STATEMENT_TOKENS];
+  struct token tok;
+  const char* cur = NULL;
+  const char* end = NULL;
+  size_t nb_toks = 0;
+  int depth = 0;
+  int err = 0;
+  ASSERT(shader && uniforms && attribs);
+
+  cur = shader->source;
+  end = shader->source + shader->length;
+  next_token(&cur, end, &tok);
+  for(; !err && tok.len; next_token(&cur, end, &tok)) {
+    if(is_token(&tok, "{")) {
+      ++depth;
+      nb_toks = 0; /* Function body or interface block. */
+    } else if(is_token(&tok, "}")) {
+      depth -= depth > 0;
+    } else if(depth == 0) {
+      if(is_token(&tok, ";")) {
+        err = scan_statement(shader->ctxt, shader->type, tok_list, nb_toks,
+          uniforms, attribs);
+        nb_toks = 0;
+      } else if(nb_toks < MAX_STATEMENT_TOKENS) {
+        tok_list[nb_toks++] = tok;
+      }
+    }
+  }
+  return err;
+}
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static void
+clear_linked_data(struct rb_program* prog)
+{
+  ASSERT(prog);
+  /* The declaration names are interned into the context. */
+  MEM_FREE(prog->ctxt->allocator, prog->uniform_list);
+  MEM_FREE(prog->ctxt->allocator, prog->attrib_list);
+  prog->uniform_list = NULL;
+  prog->nb_uniforms = 0;
+  prog->attrib_list = NULL;
+  prog->nb_attribs = 0;
+  prog->is_linked = 0;
+}
+
+static void
+set_log(struct rb_program* prog, const char* msg)
+{
+  char* log = NULL;
+  ASSERT(prog && msg);
+
+  log = rb_null_strdup(prog->ctxt, msg, strlen(msg));
+  if(prog->log)
+    MEM_FREE(prog->ctxt->allocator, prog->log);
+  prog->log = log;
+}
+
+/* Assign the first free indices to the attribs without explicit location. */
+static void
+assign_attrib_locations(struct decl_list* attribs)
+{
+  size_t i = 0;
+  size_t j = 0;
+  int location = 0;
+  ASSERT(attribs);
+
+  for(i = 0; i < attribs->nb; ++i) {
+    if(attribs->buffer[i].location >= 0)
+      continue;
+    for(j = 0; j < attribs->nb; ) {
+      if(attribs->buffer[j].location == location) {
+        ++location;
+        j = 0;
+      } else {
+        ++j;
+      }
+    }
+    attribs->buffer[i].location = location++;
+  }
+}
+
+static int
+link(struct rb_program* prog)
+{
+  char msg[128];
+  struct decl_list uniforms = { NULL, 0, 0 };
+  struct decl_list attribs = { NULL, 0, 0 };
+  struct list_node* node = NULL;
+  int shader_mask = 0;
+  int err = 0;
+  ASSERT(prog);
+
+  LIST_FOR_EACH(node, &prog->attached_shader_list) {
+    struct rb_shader* shader = CONTAINER_OF
+      (node, struct rb_null_attachment, node)->shader;
+    if(shader_mask & BIT(shader->type)) {
+      set_log(prog, "several shaders of the same type are attached");
+      goto error;
+    }
+    shader_mask |= BIT(shader->type);
+    err = scan_shader(shader, &uniforms, &attribs);
+    if(err == -2) {
+      snprintf(msg, sizeof(msg), "a uniform of the %s shader is differently "
+        "declared by another shader",
+        shader->type == RB_FRAGMENT_SHADER ? "fragment" : "geometry");
+      set_log(prog, msg);
+      goto error;
+    } else if(err != 0) {
+      set_log(prog, "out of memory");
+      goto error;
+    }
+  }
+  if(!(shader_mask & BIT(RB_VERTEX_SHADER))
+  || !(shader_mask & BIT(RB_FRAGMENT_SHADER))) {
+    set_log(prog, "a vertex and a fragment shader must be attached");
+    goto error;
+  }
+  assign_attrib_locations(&attribs);
+
+exit:
+  prog->uniform_list = uniforms.buffer;
+  prog->nb_uniforms = uniforms.nb;
+  prog->attrib_list = attribs.buffer;
+  prog->nb_attribs = attribs.nb;
+  return err;
+error:
+  err = -1;
+  goto exit;
+}
+
+static struct rb_null_attachment*
+find_attachment(struct rb_program* prog, struct rb_shader* shader)
+{
+  struct list_node* node = NULL;
+  ASSERT(prog && shader);
+
+  LIST_FOR_EACH(node, &prog->attached_shader_list) {
+    struct rb_null_attachment* attachment = CONTAINER_OF
+      (node, struct rb_null_attachment, node);
+    if(attachment->shader == shader)
+      return attachment;
+  }
+  return NULL;
+}
+
+static void
+detach(struct rb_program* prog, struct rb_null_attachment* attachment)
+{
+  struct rb_shader* shader = NULL;
+  ASSERT(prog && attachment);
+
+  shader = attachment->shader;
+  list_del(&attachment->node);
+  MEM_FREE(prog->ctxt->allocator, attachment);
+  ASSERT(shader->nb_attachments);
+  --shader->nb_attachments;
+  rb_null_shader_unref(shader);
+}
+
+static void
+release_program(struct ref* ref)
+{
+  struct list_node* node = NULL;
+  struct list_node* tmp = NULL;
+  struct rb_context* ctxt = NULL;
+  struct rb_program* prog = NULL;
+  ASSERT(ref);
+
+  prog = CONTAINER_OF(ref, struct rb_program, ref);
+  ctxt = prog->ctxt;
+  if(ctxt->state.program == prog)
+    ctxt->state.program = NULL;
+  LIST_FOR_EACH_SAFE(node, tmp, &prog->attached_shader_list) {
+    detach(prog, CONTAINER_OF(node, struct rb_null_attachment, node));
+  }
+  clear_linked_data(prog);
+  if(prog->log)
+    MEM_FREE(ctxt->allocator, prog->log);
+  rb_null_free_object(ctxt, RB_OBJECT_PROGRAM, prog);
+  rb_null_context_unref(ctxt);
+}
+
+/*******************************************************************************
+ *
+ * Program functions.
+ *
+ ******************************************************************************/
+int
+rb_create_program(struct rb_context* ctxt, struct rb_program** out_prog)
+{
+  struct rb_program* prog = NULL;
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!out_prog || !(prog = rb_null_alloc_object(ctxt, RB_OBJECT_PROGRAM))) {
+    err = -1;
+  } else {
+    ref_init(&prog->ref);
+    list_init(&prog->attached_shader_list);
+    ref_get(&ctxt->ref);
+    prog->ctxt = ctxt;
+    *out_prog = prog;
+  }
+  return RECORD(ctxt, create_program, 0, err);
+}
+
+int
+rb_program_ref_get(struct rb_program* prog)
+{
+  if(!prog)
+    return -1;
+  ref_get(&prog->ref);
+  return RECORD(prog->ctxt, program_ref_get, 0, 0);
+}
+
+int
+rb_program_ref_put(struct rb_program* prog)
+{
+  if(!prog)
+    return -1;
+  RECORD(prog->ctxt, program_ref_put, 0, 0);
+  ref_put(&prog->ref, release_program);
+  return 0;
+}
+
+int
+rb_attach_shader(struct rb_program* prog, struct rb_shader* shader)
+{
+  struct rb_null_attachment* attachment = NULL;
+  int err = 0;
+
+  if(!prog)
+    return -1;
+  if(!shader
+  || shader->ctxt != prog->ctxt
+  || find_attachment(prog, shader)
+  || !(attachment = MEM_ALLOC
+        (prog->ctxt->allocator, sizeof(struct rb_null_attachment)))) {
+    err = -1;
+  } else {
+    attachment->shader = shader;
+    list_add(&prog->attached_shader_list, &attachment->node);
+    ++shader->nb_attachments;
+    ref_get(&shader->ref);
+  }
+  return RECORD(prog->ctxt, attach_shader, 0, err);
+}
+
+int
+rb_detach_shader(struct rb_program* prog, struct rb_shader* shader)
+{
+  struct rb_null_attachment* attachment = NULL;
+  int err = 0;
+
+  if(!prog)
+    return -1;
+  if(!shader || !(attachment = find_attachment(prog, shader)))
+    err = -1;
+  else
+    detach(prog, attachment);
+  return RECORD(prog->ctxt, detach_shader, 0, err);
+}
+
+int
+rb_link_program(struct rb_program* prog)
+{
+  int err = 0;
+
+  if(!prog)
+    return -1;
+  clear_linked_data(prog);
+  if(link(prog) != 0) {
+    clear_linked_data(prog);
+    if(prog->ctxt->state.program == prog)
+      prog->ctxt->state.program = NULL;
+    err = -1;
+  } else {
+    prog->is_linked = 1;
+    if(prog->log) {
+      MEM_FREE(prog->ctxt->allocator, prog->log);
+      prog->log = NULL;
+    }
+  }
+  return RECORD(prog->ctxt, link_program, 0, err);
+}
+
+/* The link completes before rb_link_program returns. */
+int
+rb_program_is_ready(struct rb_program* prog, int* out_is_ready)
+{
+  int err = 0;
+
+  if(!prog)
+    return -1;
+  if(!out_is_ready) {
+    err = -1;
+  } else {
+    *out_is_ready = 1;
+    err = prog->is_linked ? 0 : -1;
+  }
+  return RECORD(prog->ctxt, program_is_ready, 0, err);
+}
+
+/* The mode is only stored since there is no compilation to defer. */
+int
+rb_compile_mode(struct rb_context* ctxt, const struct rb_compile_desc* desc)
+{
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!desc || (unsigned int)desc->mode > RB_COMPILE_ASYNC)
+    err = -1;
+  else
+    ctxt->state.compile = *desc;
+  return RECORD(ctxt, compile_mode, 0, err);
+}
+
+int
+rb_get_program_log(struct rb_program* prog, const char** out_log)
+{
+  int err = 0;
+
+  if(!prog)
+    return -1;
+  if(!out_log)
+    err = -1;
+  else
+    *out_log = prog->log;
+  return RECORD(prog->ctxt, get_program_log, 0, err);
+}
+
+int
+rb_bind_program(struct rb_context* ctxt, struct rb_program* prog)
+{
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(prog && (!prog->is_linked || prog->ctxt != ctxt))
+    err = -1;
+  else
+    ctxt->state.program = prog;
+  return RECORD(ctxt, bind_program, 0, err);
+}
+
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+void
+rb_null_program_unref(struct rb_program* prog)
+{
+  ASSERT(prog);
+  ref_put(&prog->ref, release_program);
+}
+
+size_t
+rb_null_sizeof_type(enum rb_type type)
+{
+  size_t size = 0;
+  switch(type) {
+    case RB_UNKNOWN_TYPE: size = sizeof(int); break; /* Sampler. */
+    case RB_FLOAT: size = sizeof(float); break;
+    case RB_FLOAT2: size = 2 * sizeof(float); break;
+    case RB_FLOAT3: size = 3 * sizeof(float); break;
+    case RB_FLOAT4: size = 4 * sizeof(float); break;
+    case RB_FLOAT4x4: size = 16 * sizeof(float); break;
+    default: ASSERT(0); break;
+  }
+  return size;
+}
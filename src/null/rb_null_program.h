@@ -0,0 +1,83 @@
+#ifndef RB_NULL_PROGRAM_H
+#define RB_NULL_PROGRAM_H
+
+#include "rb_types.h"
+#include <snlsys/list.h>
+#include <snlsys/ref_count.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct rb_context;
+
+/* Uniform or attrib declared by the GLSL sources. */
+struct rb_null_decl {
+  const char* name; /* Interned into the context. */
+  enum rb_type type;
+  unsigned int count; /* Number of array elements. */
+  int location; /* Index of an attrib. */
+};
+
+struct rb_shader {
+  struct ref ref;
+  struct rb_context* ctxt;
+  enum rb_shader_type type;
+  unsigned int nb_attachments; /* Number of programs it is attached to. */
+  char* source;
+  size_t length;
+  uint64_t variant_key; /* Key into the variant cache if it is shared. */
+  int is_variant;
+};
+
+/* Link between a program and one of its shaders that may be attached to
+ * several programs. */
+struct rb_null_attachment {
+  struct list_node node;
+  struct rb_shader* shader;
+};
+
+struct rb_program {
+  struct ref ref;
+  struct list_node attached_shader_list;
+  struct rb_context* ctxt;
+  int is_linked;
+  char* log;
+  /* Declarations of the linked shaders. */
+  struct rb_null_decl* uniform_list;
+  size_t nb_uniforms;
+  struct rb_null_decl* attrib_list;
+  size_t nb_attribs;
+};
+
+/* The uniforms and the attribs own a copy of their declaration in order to
+ * remain valid if their program is linked again. Its name is interned and
+ * thus outlives the program declarations. */
+struct rb_uniform {
+  struct ref ref;
+  struct rb_context* ctxt;
+  struct rb_program* program;
+  struct rb_null_decl decl;
+};
+
+struct rb_attrib {
+  struct ref ref;
+  struct rb_context* ctxt;
+  struct rb_program* program;
+  struct rb_null_decl decl;
+};
+
+/* Release a reference without recording the call. */
+LOCAL_SYM void
+rb_null_shader_unref
+  (struct rb_shader* shader);
+
+LOCAL_SYM void
+rb_null_program_unref
+  (struct rb_program* prog);
+
+/* Size in bytes of a value of the type. The samplers, i.e. the
+ * RB_UNKNOWN_TYPE, are set from an int. */
+LOCAL_SYM size_t
+rb_null_sizeof_type
+  (enum rb_type type);
+
+#endif /* RB_NULL_PROGRAM_H */
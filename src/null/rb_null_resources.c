@@ -0,0 +1,823 @@
+#include "null/rb_null_context.h"
+#include "null/rb_null_resources.h"
+#include "rb.h"
+#include <snlsys/math.h>
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+#include <limits.h>
+#include <string.h>
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static FINLINE int
+is_format_compressible(enum rb_tex_format fmt)
+{
+  return
+     fmt == RB_R
+  || fmt == RB_RGB
+  || fmt == RB_RGBA
+  || fmt == RB_SRGB
+  || fmt == RB_SRGBA;
+}
+
+static FINLINE int
+is_depth_format(enum rb_tex_format fmt)
+{
+  return fmt == RB_DEPTH_COMPONENT || fmt == RB_DEPTH_STENCIL;
+}
+
+static size_t
+sizeof_mip_level(const struct rb_tex2d_desc* desc, unsigned int level)
+{
+  const size_t width = MAX(desc->width >> level, 1u);
+  const size_t height = MAX(desc->height >> level, 1u);
+  ASSERT(desc && level < desc->mip_count && level < sizeof(unsigned int)*8);
+  return width * height * rb_null_sizeof_pixel(desc->format);
+}
+
+static void
+unbind_tex2d(struct rb_context* ctxt, struct rb_tex2d* tex)
+{
+  unsigned int i = 0;
+  ASSERT(ctxt && tex);
+
+  for(i = 0; i < RB_NULL_MAX_TEXTURE_UNITS; ++i) {
+    if(ctxt->state.tex2d_binding[i] == tex)
+      ctxt->state.tex2d_binding[i] = NULL;
+  }
+}
+
+static void
+unbind_buffer(struct rb_context* ctxt, struct rb_buffer* buffer)
+{
+  ASSERT(ctxt && buffer);
+  if(ctxt->state.buffer_binding[buffer->desc.target] == buffer)
+    ctxt->state.buffer_binding[buffer->desc.target] = NULL;
+}
+
+/* The textures and the buffers of a loader context may be bound to the
+ * context that it shares. */
+static void
+release_tex2d(struct ref* ref)
+{
+  struct rb_tex2d* tex = CONTAINER_OF(ref, struct rb_tex2d, ref);
+  struct rb_context* ctxt = tex->ctxt;
+
+  unbind_tex2d(ctxt, tex);
+  if(ctxt->share != ctxt)
+    unbind_tex2d(ctxt->share, tex);
+  rb_null_free_object(ctxt, RB_OBJECT_TEX2D, tex);
+  rb_null_context_unref(ctxt);
+}
+
+static void
+release_sampler(struct ref* ref)
+{
+  struct rb_sampler* sampler = CONTAINER_OF(ref, struct rb_sampler, ref);
+  struct rb_context* ctxt = sampler->ctxt;
+  unsigned int i = 0;
+
+  for(i = 0; i < RB_NULL_MAX_TEXTURE_UNITS; ++i) {
+    if(ctxt->state.sampler_binding[i] == sampler)
+      ctxt->state.sampler_binding[i] = NULL;
+  }
+  rb_null_free_object(ctxt, RB_OBJECT_SAMPLER, sampler);
+  rb_null_context_unref(ctxt);
+}
+
+static void
+release_buffer(struct ref* ref)
+{
+  struct rb_buffer* buffer = CONTAINER_OF(ref, struct rb_buffer, ref);
+  struct rb_context* ctxt = buffer->ctxt;
+
+  unbind_buffer(ctxt, buffer);
+  if(ctxt->share != ctxt)
+    unbind_buffer(ctxt->share, buffer);
+  rb_null_free_object(ctxt, RB_OBJECT_BUFFER, buffer);
+  rb_null_context_unref(ctxt);
+}
+
+static void
+release_vertex_array(struct ref* ref)
+{
+  struct rb_vertex_array* varray = NULL;
+  struct rb_context* ctxt = NULL;
+  int i = 0;
+
+  varray = CONTAINER_OF(ref, struct rb_vertex_array, ref);
+  ctxt = varray->ctxt;
+  if(ctxt->state.vertex_array == varray)
+    ctxt->state.vertex_array = NULL;
+  for(i = 0; i < RB_NULL_MAX_ATTRIBS; ++i) {
+    if(varray->attrib_buffer_list[i])
+      ref_put(&varray->attrib_buffer_list[i]->ref, release_buffer);
+  }
+  if(varray->index_buffer)
+    ref_put(&varray->index_buffer->ref, release_buffer);
+  rb_null_free_object(ctxt, RB_OBJECT_VERTEX_ARRAY, varray);
+  rb_null_context_unref(ctxt);
+}
+
+static void
+detach_render_target(struct rb_render_target* rt)
+{
+  ASSERT(rt);
+  if(rt->resource) {
+    ASSERT(rt->type == RB_RENDER_TARGET_TEXTURE2D);
+    ref_put(&((struct rb_tex2d*)rt->resource)->ref, release_tex2d);
+  }
+  memset(rt, 0, sizeof(struct rb_render_target));
+}
+
+static void
+release_framebuffer(struct ref* ref)
+{
+  struct rb_framebuffer* buffer = NULL;
+  struct rb_context* ctxt = NULL;
+  unsigned int i = 0;
+
+  buffer = CONTAINER_OF(ref, struct rb_framebuffer, ref);
+  ctxt = buffer->ctxt;
+  if(ctxt->state.framebuffer == buffer)
+    ctxt->state.framebuffer = NULL;
+  for(i = 0; i < buffer->desc.buffer_count; ++i)
+    detach_render_target(buffer->render_target_list + i);
+  detach_render_target(&buffer->depth_stencil);
+  rb_null_free_object(ctxt, RB_OBJECT_FRAMEBUFFER, buffer);
+  rb_null_context_unref(ctxt);
+}
+
+static int
+is_render_target_valid
+  (const struct rb_framebuffer* buffer,
+   int is_depth_stencil,
+   const struct rb_render_target* rt)
+{
+  const struct rb_tex2d* tex = NULL;
+  unsigned int level = 0;
+  ASSERT(buffer && rt);
+
+  if(rt->type != RB_RENDER_TARGET_TEXTURE2D)
+    return 0;
+  tex = rt->resource;
+  if(!tex) /* Detach the render target. */
+    return 1;
+  level = rt->desc.tex2d.mip_level;
+  return rb_null_is_shared(tex->ctxt, buffer->ctxt)
+      && level < tex->desc.mip_count
+      && MAX(tex->desc.width >> level, 1u) == buffer->desc.width
+      && MAX(tex->desc.height >> level, 1u) == buffer->desc.height
+      && is_depth_stencil == is_depth_format(tex->desc.format);
+}
+
+static void
+attach_render_target
+  (struct rb_render_target* dst,
+   const struct rb_render_target* src)
+{
+  ASSERT(dst && src);
+  if(src->resource)
+    ref_get(&((struct rb_tex2d*)src->resource)->ref);
+  detach_render_target(dst);
+  memcpy(dst, src, sizeof(struct rb_render_target));
+}
+
+/*******************************************************************************
+ *
+ * Texture 2d functions.
+ *
+ ******************************************************************************/
+int
+rb_create_tex2d
+  (struct rb_context* ctxt,
+   const struct rb_tex2d_desc* desc,
+   const void* init_data[],
+   struct rb_tex2d** out_tex)
+{
+  struct rb_tex2d* tex = NULL;
+  size_t nb_bytes = 0;
+  unsigned int i = 0;
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!desc
+  || !init_data
+  || !out_tex
+  || !desc->mip_count
+  || desc->mip_count > sizeof(unsigned int) * 8
+  || !desc->width
+  || !desc->height
+  || (unsigned int)desc->format > RB_DEPTH_STENCIL
+  || (desc->compress && !is_format_compressible(desc->format))) {
+    err = -1;
+  } else if(!(tex = rb_null_alloc_object(ctxt, RB_OBJECT_TEX2D))) {
+    err = -1;
+  } else {
+    ref_init(&tex->ref);
+    ref_get(&ctxt->ref);
+    tex->ctxt = ctxt;
+    tex->desc = *desc;
+    for(i = 0; i < desc->mip_count; ++i) {
+      if(init_data[i])
+        nb_bytes += sizeof_mip_level(desc, i);
+    }
+    *out_tex = tex;
+  }
+  return RECORD(ctxt, create_tex2d, nb_bytes, err);
+}
+
+int
+rb_tex2d_ref_get(struct rb_tex2d* tex)
+{
+  if(!tex)
+    return -1;
+  ref_get(&tex->ref);
+  return RECORD(tex->ctxt, tex2d_ref_get, 0, 0);
+}
+
+int
+rb_tex2d_ref_put(struct rb_tex2d* tex)
+{
+  if(!tex)
+    return -1;
+  RECORD(tex->ctxt, tex2d_ref_put, 0, 0);
+  ref_put(&tex->ref, release_tex2d);
+  return 0;
+}
+
+int
+rb_bind_tex2d
+  (struct rb_context* ctxt,
+   struct rb_tex2d* tex,
+   unsigned int tex_unit)
+{
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(tex_unit >= RB_NULL_MAX_TEXTURE_UNITS
+  || (tex && !rb_null_is_shared(tex->ctxt, ctxt)))
+    err = -1;
+  else
+    ctxt->state.tex2d_binding[tex_unit] = tex;
+  return RECORD(ctxt, bind_tex2d, 0, err);
+}
+
+int
+rb_tex2d_data(struct rb_tex2d* tex, unsigned int level, const void* data)
+{
+  size_t nb_bytes = 0;
+  int err = 0;
+
+  if(!tex)
+    return -1;
+  if(level >= tex->desc.mip_count)
+    err = -1;
+  else if(data)
+    nb_bytes = sizeof_mip_level(&tex->desc, level);
+  return RECORD(tex->ctxt, tex2d_data, nb_bytes, err);
+}
+
+/*******************************************************************************
+ *
+ * Sampler functions.
+ *
+ ******************************************************************************/
+int
+rb_create_sampler
+  (struct rb_context* ctxt,
+   const struct rb_sampler_desc* desc,
+   struct rb_sampler** out_sampler)
+{
+  struct rb_sampler* sampler = NULL;
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!desc
+  || !out_sampler
+  || (unsigned int)desc->filter > RB_MIN_LINEAR_MAG_LINEAR_MIP_LINEAR
+  || (unsigned int)desc->address_u > RB_ADDRESS_CLAMP
+  || (unsigned int)desc->address_v > RB_ADDRESS_CLAMP
+  || (unsigned int)desc->address_w > RB_ADDRESS_CLAMP
+  || desc->min_lod > desc->max_lod) {
+    err = -1;
+  } else if(!(sampler = rb_null_alloc_object(ctxt, RB_OBJECT_SAMPLER))) {
+    err = -1;
+  } else {
+    ref_init(&sampler->ref);
+    ref_get(&ctxt->ref);
+    sampler->ctxt = ctxt;
+    sampler->desc = *desc;
+    *out_sampler = sampler;
+  }
+  return RECORD(ctxt, create_sampler, 0, err);
+}
+
+int
+rb_sampler_ref_get(struct rb_sampler* sampler)
+{
+  if(!sampler)
+    return -1;
+  ref_get(&sampler->ref);
+  return RECORD(sampler->ctxt, sampler_ref_get, 0, 0);
+}
+
+int
+rb_sampler_ref_put(struct rb_sampler* sampler)
+{
+  if(!sampler)
+    return -1;
+  RECORD(sampler->ctxt, sampler_ref_put, 0, 0);
+  ref_put(&sampler->ref, release_sampler);
+  return 0;
+}
+
+int
+rb_sampler_parameters
+  (struct rb_sampler* sampler,
+   const struct rb_sampler_desc* desc)
+{
+  int err = 0;
+
+  if(!sampler)
+    return -1;
+  if(!desc
+  || (unsigned int)desc->filter > RB_MIN_LINEAR_MAG_LINEAR_MIP_LINEAR
+  || (unsigned int)desc->address_u > RB_ADDRESS_CLAMP
+  || (unsigned int)desc->address_v > RB_ADDRESS_CLAMP
+  || (unsigned int)desc->address_w > RB_ADDRESS_CLAMP
+  || desc->min_lod > desc->max_lod)
+    err = -1;
+  else
+    sampler->desc = *desc;
+  return RECORD(sampler->ctxt, sampler_parameters, 0, err);
+}
+
+int
+rb_bind_sampler
+  (struct rb_context* ctxt,
+   struct rb_sampler* sampler,
+   unsigned int tex_unit)
+{
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(tex_unit >= RB_NULL_MAX_TEXTURE_UNITS
+  || (sampler && sampler->ctxt != ctxt))
+    err = -1;
+  else
+    ctxt->state.sampler_binding[tex_unit] = sampler;
+  return RECORD(ctxt, bind_sampler, 0, err);
+}
+
+/*******************************************************************************
+ *
+ * Buffer functions.
+ *
+ ******************************************************************************/
+int
+rb_create_buffer
+  (struct rb_context* ctxt,
+   const struct rb_buffer_desc* desc,
+   const void* init_data,
+   struct rb_buffer** out_buffer)
+{
+  struct rb_buffer* buffer = NULL;
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!desc
+  || !out_buffer
+  || desc->size > INT_MAX
+  || (desc->target != RB_BIND_VERTEX_BUFFER
+   && desc->target != RB_BIND_INDEX_BUFFER)
+  || (unsigned int)desc->usage > RB_USAGE_DYNAMIC
+  || (desc->usage == RB_USAGE_IMMUTABLE && init_data == NULL)) {
+    err = -1;
+  } else if(!(buffer = rb_null_alloc_object(ctxt, RB_OBJECT_BUFFER))) {
+    err = -1;
+  } else {
+    ref_init(&buffer->ref);
+    ref_get(&ctxt->ref);
+    buffer->ctxt = ctxt;
+    buffer->desc = *desc;
+    *out_buffer = buffer;
+  }
+  return RECORD(ctxt, create_buffer, init_data ? desc->size : 0, err);
+}
+
+int
+rb_buffer_ref_get(struct rb_buffer* buffer)
+{
+  if(!buffer)
+    return -1;
+  ref_get(&buffer->ref);
+  return RECORD(buffer->ctxt, buffer_ref_get, 0, 0);
+}
+
+int
+rb_buffer_ref_put(struct rb_buffer* buffer)
+{
+  if(!buffer)
+    return -1;
+  RECORD(buffer->ctxt, buffer_ref_put, 0, 0);
+  ref_put(&buffer->ref, release_buffer);
+  return 0;
+}
+
+int
+rb_bind_buffer
+  (struct rb_context* ctxt,
+   struct rb_buffer* buffer,
+   enum rb_buffer_target target)
+{
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if((target != RB_BIND_VERTEX_BUFFER && target != RB_BIND_INDEX_BUFFER)
+  || (buffer
+   && (buffer->desc.target != target
+    || !rb_null_is_shared(buffer->ctxt, ctxt))))
+    err = -1;
+  else
+    ctxt->state.buffer_binding[target] = buffer;
+  return RECORD(ctxt, bind_buffer, 0, err);
+}
+
+int
+rb_buffer_data
+  (struct rb_buffer* buffer,
+   int offset,
+   int size,
+   const void* data)
+{
+  int err = 0;
+
+  if(!buffer)
+    return -1;
+  if(offset < 0
+  || size < 0
+  || (size != 0 && !data)
+  || buffer->desc.usage == RB_USAGE_IMMUTABLE
+  || buffer->desc.size < (size_t)offset + (size_t)size)
+    err = -1;
+  return RECORD(buffer->ctxt, buffer_data, (size_t)MAX(size, 0), err);
+}
+
+/*******************************************************************************
+ *
+ * Vertex array functions.
+ *
+ ******************************************************************************/
+int
+rb_create_vertex_array
+  (struct rb_context* ctxt,
+   struct rb_vertex_array** out_varray)
+{
+  struct rb_vertex_array* varray = NULL;
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!out_varray
+  || !(varray = rb_null_alloc_object(ctxt, RB_OBJECT_VERTEX_ARRAY))) {
+    err = -1;
+  } else {
+    ref_init(&varray->ref);
+    ref_get(&ctxt->ref);
+    varray->ctxt = ctxt;
+    *out_varray = varray;
+  }
+  return RECORD(ctxt, create_vertex_array, 0, err);
+}
+
+int
+rb_vertex_array_ref_get(struct rb_vertex_array* varray)
+{
+  if(!varray)
+    return -1;
+  ref_get(&varray->ref);
+  return RECORD(varray->ctxt, vertex_array_ref_get, 0, 0);
+}
+
+int
+rb_vertex_array_ref_put(struct rb_vertex_array* varray)
+{
+  if(!varray)
+    return -1;
+  RECORD(varray->ctxt, vertex_array_ref_put, 0, 0);
+  ref_put(&varray->ref, release_vertex_array);
+  return 0;
+}
+
+int
+rb_bind_vertex_array
+  (struct rb_context* ctxt,
+   struct rb_vertex_array* varray)
+{
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(varray && varray->ctxt != ctxt)
+    err = -1;
+  else
+    ctxt->state.vertex_array = varray;
+  return RECORD(ctxt, bind_vertex_array, 0, err);
+}
+
+int
+rb_vertex_attrib_array
+  (struct rb_vertex_array* varray,
+   struct rb_buffer* buffer,
+   int count,
+   const struct rb_buffer_attrib* attrib)
+{
+  int err = 0;
+  int i = 0;
+
+  if(!varray)
+    return -1;
+  if(!buffer
+  || !attrib
+  || count < 0
+  || !rb_null_is_shared(buffer->ctxt, varray->ctxt)
+  || buffer->desc.target != RB_BIND_VERTEX_BUFFER) {
+    err = -1;
+  } else {
+    /* As the ogl3 backend, the attribs preceding an invalid one are set. */
+    for(i = 0; i < count && !err; ++i) {
+      struct rb_buffer** dst = NULL;
+      if(attrib[i].index < 0
+      || attrib[i].index >= RB_NULL_MAX_ATTRIBS
+      || attrib[i].type < RB_FLOAT
+      || attrib[i].type > RB_FLOAT4) {
+        err = -1;
+      } else {
+        dst = varray->attrib_buffer_list + attrib[i].index;
+        ref_get(&buffer->ref);
+        if(*dst)
+          ref_put(&(*dst)->ref, release_buffer);
+        *dst = buffer;
+      }
+    }
+  }
+  return RECORD(varray->ctxt, vertex_attrib_array, 0, err);
+}
+
+int
+rb_remove_vertex_attrib
+  (struct rb_vertex_array* varray,
+   int count,
+   const int* list_of_attrib_indices)
+{
+  int err = 0;
+  int i = 0;
+
+  if(!varray)
+    return -1;
+  if(count < 0 || (count > 0 && !list_of_attrib_indices)) {
+    err = -1;
+  } else {
+    for(i = 0; i < count; ++i) {
+      const int id = list_of_attrib_indices[i];
+      if(id < 0 || id >= RB_NULL_MAX_ATTRIBS) {
+        err = -1;
+      } else if(varray->attrib_buffer_list[id]) {
+        ref_put(&varray->attrib_buffer_list[id]->ref, release_buffer);
+        varray->attrib_buffer_list[id] = NULL;
+      }
+    }
+  }
+  return RECORD(varray->ctxt, remove_vertex_attrib, 0, err);
+}
+
+int
+rb_vertex_index_array
+  (struct rb_vertex_array* varray,
+   struct rb_buffer* buffer)
+{
+  int err = 0;
+
+  if(!varray)
+    return -1;
+  if(buffer
+  && (buffer->desc.target != RB_BIND_INDEX_BUFFER
+   || !rb_null_is_shared(buffer->ctxt, varray->ctxt))) {
+    err = -1;
+  } else {
+    if(buffer)
+      ref_get(&buffer->ref);
+    if(varray->index_buffer)
+      ref_put(&varray->index_buffer->ref, release_buffer);
+    varray->index_buffer = buffer;
+  }
+  return RECORD(varray->ctxt, vertex_index_array, 0, err);
+}
+
+/*******************************************************************************
+ *
+ * Framebuffer functions.
+ *
+ ******************************************************************************/
+int
+rb_create_framebuffer
+  (struct rb_context* ctxt,
+   const struct rb_framebuffer_desc* desc,
+   struct rb_framebuffer** out_buffer)
+{
+  struct rb_framebuffer* buffer = NULL;
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!desc
+  || !out_buffer
+  || desc->buffer_count > RB_NULL_MAX_COLOR_ATTACHMENTS
+  || !(buffer = rb_null_alloc_object(ctxt, RB_OBJECT_FRAMEBUFFER))) {
+    err = -1;
+  } else {
+    ref_init(&buffer->ref);
+    ref_get(&ctxt->ref);
+    buffer->ctxt = ctxt;
+    buffer->desc = *desc;
+    *out_buffer = buffer;
+  }
+  return RECORD(ctxt, create_framebuffer, 0, err);
+}
+
+int
+rb_framebuffer_ref_get(struct rb_framebuffer* buffer)
+{
+  if(!buffer)
+    return -1;
+  ref_get(&buffer->ref);
+  return RECORD(buffer->ctxt, framebuffer_ref_get, 0, 0);
+}
+
+int
+rb_framebuffer_ref_put(struct rb_framebuffer* buffer)
+{
+  if(!buffer)
+    return -1;
+  RECORD(buffer->ctxt, framebuffer_ref_put, 0, 0);
+  ref_put(&buffer->ref, release_framebuffer);
+  return 0;
+}
+
+int
+rb_bind_framebuffer
+  (struct rb_context* ctxt,
+   struct rb_framebuffer* buffer)
+{
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(buffer && buffer->ctxt != ctxt)
+    err = -1;
+  else
+    ctxt->state.framebuffer = buffer;
+  return RECORD(ctxt, bind_framebuffer, 0, err);
+}
+
+int
+rb_framebuffer_render_targets
+  (struct rb_framebuffer* buffer,
+   unsigned int count,
+   const struct rb_render_target render_target_list[],
+   const struct rb_render_target* depth_stencil)
+{
+  unsigned int i = 0;
+  int err = 0;
+
+  if(!buffer)
+    return -1;
+  if((count && !render_target_list) || count > buffer->desc.buffer_count)
+    err = -1;
+  /* Validate the render targets before their attachment in order to keep the
+   * framebuffer unchanged on error. */
+  if(!err && depth_stencil && !is_render_target_valid(buffer, 1, depth_stencil))
+    err = -1;
+  for(i = 0; !err && i < count; ++i) {
+    if(!is_render_target_valid(buffer, 0, render_target_list + i))
+      err = -1;
+  }
+  if(!err) {
+    if(depth_stencil)
+      attach_render_target(&buffer->depth_stencil, depth_stencil);
+    for(i = 0; i < count; ++i) {
+      attach_render_target
+        (buffer->render_target_list + i, render_target_list + i);
+    }
+  }
+  return RECORD(buffer->ctxt, framebuffer_render_targets, 0, err);
+}
+
+int
+rb_clear_framebuffer_render_targets
+  (struct rb_framebuffer* buffer,
+   int clear_flag,
+   unsigned int count,
+   const struct rb_clear_framebuffer_color_desc* color_vals,
+   float depth_val,
+   char stencil_val)
+{
+  unsigned int i = 0;
+  int err = 0;
+  (void)depth_val;
+  (void)stencil_val;
+
+  if(!buffer)
+    return -1;
+  if((clear_flag & RB_CLEAR_COLOR_BIT) != 0) {
+    if(count && !color_vals)
+      err = -1;
+    for(i = 0; !err && i < count; ++i) {
+      if(color_vals[i].index >= buffer->desc.buffer_count)
+        err = -1;
+    }
+  }
+  if((clear_flag & (RB_CLEAR_DEPTH_BIT|RB_CLEAR_STENCIL_BIT)) != 0
+  && !buffer->depth_stencil.resource)
+    err = -1;
+  return RECORD(buffer->ctxt, clear_framebuffer_render_targets, 0, err);
+}
+
+/* The read back data are set to zero. */
+int
+rb_read_back_framebuffer
+  (struct rb_framebuffer* buffer,
+   int rt_id,
+   size_t x,
+   size_t y,
+   size_t width,
+   size_t height,
+   size_t* read_size,
+   void* read_data)
+{
+  const struct rb_render_target* rt = NULL;
+  const struct rb_tex2d* tex = NULL;
+  size_t size = 0;
+  int err = 0;
+  (void)x;
+  (void)y;
+
+  if(!buffer)
+    return -1;
+  if(rt_id >= 0 && (unsigned int)rt_id >= buffer->desc.buffer_count) {
+    err = -1;
+  } else {
+    rt = rt_id < 0
+      ? &buffer->depth_stencil : buffer->render_target_list + rt_id;
+    tex = rt->resource;
+    if(!tex) {
+      err = -1;
+    } else {
+      size = width * height * rb_null_sizeof_pixel(tex->desc.format);
+      if(read_size)
+        *read_size = size;
+      if(read_data)
+        memset(read_data, 0, size);
+    }
+  }
+  return RECORD
+    (buffer->ctxt, read_back_framebuffer, read_data ? size : 0, err);
+}
+
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+size_t
+rb_null_sizeof_pixel(enum rb_tex_format fmt)
+{
+  switch(fmt) {
+    case RB_R: return 1;
+    case RB_RGB:
+    case RB_SRGB: return 3;
+    case RB_RGBA:
+    case RB_SRGBA: return 4;
+    case RB_R_UINT16: return 2;
+    case RB_RG_UINT16: return 4;
+    case RB_RGB_UINT16: return 6;
+    case RB_RGBA_UINT16: return 8;
+    case RB_R_UINT32: return 4;
+    case RB_RG_UINT32: return 8;
+    case RB_RGB_UINT32: return 12;
+    case RB_RGBA_UINT32: return 16;
+    case RB_DEPTH_COMPONENT:
+    case RB_DEPTH_STENCIL: return 4;
+    default: ASSERT(0); return 0;
+  }
+}
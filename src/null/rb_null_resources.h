@@ -0,0 +1,66 @@
+#ifndef RB_NULL_RESOURCES_H
+#define RB_NULL_RESOURCES_H
+
+#include "common/rb_command_list.h"
+#include "null/rb_null_context.h"
+#include "rb_types.h"
+#include <snlsys/ref_count.h>
+
+struct rb_tex2d {
+  struct ref ref;
+  struct rb_context* ctxt;
+  struct rb_tex2d_desc desc;
+};
+
+struct rb_sampler {
+  struct ref ref;
+  struct rb_context* ctxt;
+  struct rb_sampler_desc desc;
+};
+
+struct rb_buffer {
+  struct ref ref;
+  struct rb_context* ctxt;
+  struct rb_buffer_desc desc;
+};
+
+struct rb_command_buffer {
+  struct ref ref;
+  struct rb_context* ctxt;
+  struct rb_command_list list;
+};
+
+struct rb_bundle {
+  struct ref ref;
+  struct rb_context* ctxt;
+  struct rb_command_list list; /* Baked commands. */
+};
+
+struct rb_fence {
+  struct ref ref;
+  struct rb_context* ctxt;
+};
+
+/* The vertex array references its buffers as the OpenGL vertex array objects
+ * keep alive their buffers. A NULL attrib buffer means a disabled attrib. */
+struct rb_vertex_array {
+  struct ref ref;
+  struct rb_context* ctxt;
+  struct rb_buffer* attrib_buffer_list[RB_NULL_MAX_ATTRIBS];
+  struct rb_buffer* index_buffer;
+};
+
+struct rb_framebuffer {
+  struct ref ref;
+  struct rb_context* ctxt;
+  struct rb_framebuffer_desc desc;
+  struct rb_render_target render_target_list[RB_NULL_MAX_COLOR_ATTACHMENTS];
+  struct rb_render_target depth_stencil;
+};
+
+/* Size in bytes of a pixel of the texture format. */
+LOCAL_SYM size_t
+rb_null_sizeof_pixel
+  (enum rb_tex_format format);
+
+#endif /* RB_NULL_RESOURCES_H */
@@ -0,0 +1,229 @@
+#include "null/rb_null_context.h"
+#include "null/rb_null_program.h"
+#include "rb.h"
+#include <snlsys/mem_allocator.h>
+#include <snlsys/snlsys.h>
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static void
+release_shader(struct ref* ref)
+{
+  struct rb_context* ctxt = NULL;
+  struct rb_shader* shader = NULL;
+  ASSERT(ref);
+
+  shader = CONTAINER_OF(ref, struct rb_shader, ref);
+  ctxt = shader->ctxt;
+  ASSERT(shader->nb_attachments == 0);
+  if(shader->is_variant)
+    rb_remove_shader_variant(&ctxt->variant_cache, shader->variant_key, shader);
+  if(shader->source)
+    MEM_FREE(ctxt->allocator, shader->source);
+  rb_null_free_object(ctxt, RB_OBJECT_SHADER, shader);
+  rb_null_context_unref(ctxt);
+}
+
+/* The source is kept in order to scan its declarations at link time. */
+static int
+shader_source(struct rb_shader* shader, const char* source, size_t length)
+{
+  char* src = NULL;
+  ASSERT(shader);
+
+  if(length > 0 && !source)
+    return -1;
+  src = rb_null_strdup(shader->ctxt, length ? source : "", length);
+  if(!src)
+    return -1;
+  if(shader->source)
+    MEM_FREE(shader->ctxt->allocator, shader->source);
+  shader->source = src;
+  shader->length = length;
+  return 0;
+}
+
+static int
+create_shader
+  (struct rb_context* ctxt,
+   enum rb_shader_type type,
+   const char* source,
+   size_t length,
+   struct rb_shader** out_shader)
+{
+  struct rb_shader* shader = NULL;
+  ASSERT(ctxt);
+
+  if(!out_shader
+  || (type != RB_VERTEX_SHADER
+   && type != RB_GEOMETRY_SHADER
+   && type != RB_FRAGMENT_SHADER)
+  || !(shader = rb_null_alloc_object(ctxt, RB_OBJECT_SHADER)))
+    return -1;
+
+  ref_init(&shader->ref);
+  ref_get(&ctxt->ref);
+  shader->ctxt = ctxt;
+  shader->type = type;
+  if(shader_source(shader, source, length) != 0) {
+    ref_put(&shader->ref, release_shader);
+    return -1;
+  }
+  *out_shader = shader;
+  return 0;
+}
+
+/* Return the shared variant of the preprocessed source or create it. */
+static int
+create_shader_variant
+  (struct rb_context* ctxt,
+   const struct rb_shader_variant_desc* desc,
+   size_t* out_length,
+   struct rb_shader** out_shader)
+{
+  struct rb_shader* shader = NULL;
+  char* source = NULL;
+  size_t length = 0;
+  uint64_t key = 0;
+  int err = 0;
+  ASSERT(ctxt && out_length);
+
+  if(!desc || !out_shader
+  || rb_preprocess_shader_variant(ctxt->allocator, desc, &source, &length))
+    return -1;
+
+  key = rb_shader_variant_key(desc->type, source, length);
+  shader = rb_find_shader_variant
+    (&ctxt->variant_cache, key, desc->type, source, length);
+  if(shader) {
+    ref_get(&shader->ref);
+  } else {
+    err = create_shader(ctxt, desc->type, source, length, &shader);
+    /* The variant is simply not shared if it cannot be cached. */
+    if(!err && rb_add_shader_variant
+       (&ctxt->variant_cache, key, desc->type, source, length, shader) == 0) {
+      shader->variant_key = key;
+      shader->is_variant = 1;
+    }
+  }
+  MEM_FREE(ctxt->allocator, source);
+  if(!err) {
+    *out_shader = shader;
+    *out_length = length;
+  }
+  return err;
+}
+
+/*******************************************************************************
+ *
+ * Shader functions.
+ *
+ ******************************************************************************/
+int
+rb_create_shader
+  (struct rb_context* ctxt,
+   enum rb_shader_type type,
+   const char* source,
+   size_t length,
+   struct rb_shader** out_shader)
+{
+  if(!ctxt)
+    return -1;
+  return RECORD
+    (ctxt, create_shader, length,
+     create_shader(ctxt, type, source, length, out_shader));
+}
+
+int
+rb_create_shader_variant
+  (struct rb_context* ctxt,
+   const struct rb_shader_variant_desc* desc,
+   struct rb_shader** out_shader)
+{
+  size_t length = 0;
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  err = create_shader_variant(ctxt, desc, &length, out_shader);
+  return RECORD(ctxt, create_shader_variant, length, err);
+}
+
+int
+rb_shader_source(struct rb_shader* shader, const char* source, size_t length)
+{
+  if(!shader)
+    return -1;
+  /* The variant no longer matches its preprocessed source. */
+  if(shader->is_variant) {
+    rb_remove_shader_variant
+      (&shader->ctxt->variant_cache, shader->variant_key, shader);
+    shader->is_variant = 0;
+  }
+  return RECORD
+    (shader->ctxt, shader_source, length,
+     shader_source(shader, source, length));
+}
+
+int
+rb_shader_ref_get(struct rb_shader* shader)
+{
+  if(!shader)
+    return -1;
+  ref_get(&shader->ref);
+  return RECORD(shader->ctxt, shader_ref_get, 0, 0);
+}
+
+int
+rb_shader_ref_put(struct rb_shader* shader)
+{
+  if(!shader)
+    return -1;
+  RECORD(shader->ctxt, shader_ref_put, 0, 0);
+  ref_put(&shader->ref, release_shader);
+  return 0;
+}
+
+/* The shaders are not compiled and thus have no log. */
+int
+rb_get_shader_log(struct rb_shader* shader, const char** out_log)
+{
+  int err = 0;
+
+  if(!shader)
+    return -1;
+  if(!out_log)
+    err = -1;
+  else
+    *out_log = NULL;
+  return RECORD(shader->ctxt, get_shader_log, 0, err);
+}
+
+int
+rb_is_shader_attached(struct rb_shader* shader, int* out_is_attached)
+{
+  int err = 0;
+
+  if(!shader)
+    return -1;
+  if(!out_is_attached)
+    err = -1;
+  else
+    *out_is_attached = shader->nb_attachments != 0;
+  return RECORD(shader->ctxt, is_shader_attached, 0, err);
+}
+
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+void
+rb_null_shader_unref(struct rb_shader* shader)
+{
+  ASSERT(shader);
+  ref_put(&shader->ref, release_shader);
+}
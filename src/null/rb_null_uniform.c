@@ -0,0 +1,188 @@
+#include "null/rb_null_context.h"
+#include "null/rb_null_program.h"
+#include "rb.h"
+#include <snlsys/math.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+#include <string.h>
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static void
+release_uniform(struct ref* ref)
+{
+  struct rb_context* ctxt = NULL;
+  struct rb_uniform* uniform = NULL;
+  ASSERT(ref);
+
+  uniform = CONTAINER_OF(ref, struct rb_uniform, ref);
+  ctxt = uniform->ctxt;
+  rb_null_program_unref(uniform->program);
+  rb_null_free_object(ctxt, RB_OBJECT_UNIFORM, uniform);
+  rb_null_context_unref(ctxt);
+}
+
+static int
+create_uniform
+  (struct rb_context* ctxt,
+   struct rb_program* prog,
+   const struct rb_null_decl* decl,
+   struct rb_uniform** out_uniform)
+{
+  struct rb_uniform* uniform = NULL;
+  ASSERT(ctxt && prog && decl && out_uniform);
+
+  uniform = rb_null_alloc_object(ctxt, RB_OBJECT_UNIFORM);
+  if(!uniform)
+    return -1;
+  ref_init(&uniform->ref);
+  ref_get(&ctxt->ref);
+  uniform->ctxt = ctxt;
+  ref_get(&prog->ref);
+  uniform->program = prog;
+  uniform->decl = *decl;
+  *out_uniform = uniform;
+  return 0;
+}
+
+/* Return the declaration of the uniform into its program or NULL if the
+ * program was linked again without the uniform. */
+static const struct rb_null_decl*
+find_program_decl(const struct rb_uniform* uniform)
+{
+  const struct rb_program* prog = NULL;
+  size_t i = 0;
+  ASSERT(uniform);
+
+  /* The names are interned and are thus compared by address. */
+  prog = uniform->program;
+  for(i = 0; i < prog->nb_uniforms; ++i) {
+    if(prog->uniform_list[i].name == uniform->decl.name)
+      return prog->uniform_list + i;
+  }
+  return NULL;
+}
+
+/*******************************************************************************
+ *
+ * Uniform functions.
+ *
+ ******************************************************************************/
+int
+rb_get_named_uniform
+  (struct rb_context* ctxt,
+   struct rb_program* prog,
+   const char* name,
+   struct rb_uniform** out_uniform)
+{
+  size_t i = 0;
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!prog || !name || !out_uniform || !prog->is_linked) {
+    err = -1;
+  } else {
+    for(i = 0; i < prog->nb_uniforms; ++i) {
+      if(!strcmp(prog->uniform_list[i].name, name))
+        break;
+    }
+    err = i < prog->nb_uniforms
+      ? create_uniform(ctxt, prog, prog->uniform_list + i, out_uniform)
+      : -1;
+  }
+  return RECORD(ctxt, get_named_uniform, 0, err);
+}
+
+int
+rb_get_uniforms
+  (struct rb_context* ctxt,
+   struct rb_program* prog,
+   size_t* out_nb_uniforms,
+   struct rb_uniform* dst_uniform_list[])
+{
+  size_t i = 0;
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  if(!prog || !out_nb_uniforms || !prog->is_linked) {
+    err = -1;
+  } else {
+    if(dst_uniform_list) {
+      for(i = 0; i < prog->nb_uniforms; ++i) {
+        err = create_uniform
+          (ctxt, prog, prog->uniform_list + i, dst_uniform_list + i);
+        if(err)
+          break;
+      }
+      if(err) {
+        while(i) {
+          --i;
+          ref_put(&dst_uniform_list[i]->ref, release_uniform);
+          dst_uniform_list[i] = NULL;
+        }
+      }
+    }
+    *out_nb_uniforms = err ? 0 : prog->nb_uniforms;
+  }
+  return RECORD(ctxt, get_uniforms, 0, err);
+}
+
+int
+rb_uniform_ref_get(struct rb_uniform* uniform)
+{
+  if(!uniform)
+    return -1;
+  ref_get(&uniform->ref);
+  return RECORD(uniform->ctxt, uniform_ref_get, 0, 0);
+}
+
+int
+rb_uniform_ref_put(struct rb_uniform* uniform)
+{
+  if(!uniform)
+    return -1;
+  RECORD(uniform->ctxt, uniform_ref_put, 0, 0);
+  ref_put(&uniform->ref, release_uniform);
+  return 0;
+}
+
+int
+rb_uniform_data(struct rb_uniform* uniform, int nb, const void* data)
+{
+  const struct rb_null_decl* decl = NULL;
+  size_t nb_bytes = 0;
+  int err = 0;
+
+  if(!uniform)
+    return -1;
+  if(!data || nb <= 0 || !(decl = find_program_decl(uniform))) {
+    err = -1;
+  } else {
+    /* The values out of the uniform array are ignored. */
+    nb_bytes = rb_null_sizeof_type(decl->type)
+      * MIN((unsigned int)nb, decl->count);
+  }
+  return RECORD(uniform->ctxt, uniform_data, nb_bytes, err);
+}
+
+int
+rb_get_uniform_desc(struct rb_uniform* uniform, struct rb_uniform_desc* desc)
+{
+  int err = 0;
+
+  if(!uniform)
+    return -1;
+  if(!desc) {
+    err = -1;
+  } else {
+    desc->name = uniform->decl.name;
+    desc->type = uniform->decl.type;
+  }
+  return RECORD(uniform->ctxt, get_uniform_desc, 0, err);
+}
@@ -5,21 +5,40 @@
 #include <snlsys/snlsys.h>
 #include <GL/gl.h>
 #include <GL/glext.h>
+#include <stdint.h>
 
+/* Error checking state of a context read by the OGL macro. The sampling
+ * period is the number of GL calls between 2 glGetError polls; 0 disables the
+ * polling. */
+struct rb_ogl3_error_state {
+  unsigned int sampling_period;
+  unsigned int call_count;
+};
+
+/* GL entry points resolved by a context. The calls are dispatched through the
+ * table of their context with the OGL macro, e.g. OGL(ctxt, Flush()). */
+struct rb_ogl3_gl {
+  #define GL_FUNC(type, func, ...) type (*func)(__VA_ARGS__);
+  #define GL_EXT_FUNC(extension, type, func, ...) \
+    GL_FUNC(type, func, __VA_ARGS__)
+  #include "ogl3/rb_ogl3_gl_func.h"
+  #include "ogl3/rb_ogl3_gl_ext_func.h"
+  #undef GL_EXT_FUNC
+  #undef GL_FUNC
+};
+
+/* In debug the OGL macro is a single expression that samples the GL error
+ * flag after the call; its value is thus void and the result of a GL call is
+ * retrieved with OGL_ASSIGN, e.g. OGL_ASSIGN(ctxt, name, CreateShader(type)).
+ * In release both are the bare call. */
 #ifndef NDEBUG
-  #include <GL/glu.h>
-  #include <stdio.h>
-  #define OGL(func)\
-    rbgl##func;                                                                \
-    {                                                                          \
-      GLenum gl_error = rbglGetError();                                        \
-      if(gl_error != GL_NO_ERROR) {                                            \
-        fprintf(stderr, "error:opengl: %s\n", gluErrorString(gl_error));       \
-        ASSERT(gl_error == GL_NO_ERROR);                                       \
-      }                                                                        \
-    } (void) 0
+  #define OGL(ctxt, func)                                                      \
+    ((ctxt)->gl.func, rb_ogl3_sample_error((ctxt), #func))
+  #define OGL_ASSIGN(ctxt, dst, func)                                          \
+    ((dst) = (ctxt)->gl.func, rb_ogl3_sample_error((ctxt), #func))
 #else
-  #define OGL(func) rbgl##func
+  #define OGL(ctxt, func) ((ctxt)->gl.func)
+  #define OGL_ASSIGN(ctxt, dst, func) ((dst) = (ctxt)->gl.func)
 #endif
 
 #ifdef PLATFORM_UNIX
@@ -28,11 +47,6 @@
     glXGetProcAddress((const GLubyte*)(name))
 #endif
 
-/* Define rb_ogl3 function pointers */
-#define GL_FUNC(type, func, ...) type (*rbgl##func)(__VA_ARGS__);
-#include "ogl3/rb_ogl3_gl_func.h"
-#undef GL_FUNC
-
 /* OpenGL 3.3 spec */
 #define RB_OGL3_MAX_TEXTURE_UNITS 16 
 #define RB_OGL3_MAX_COLOR_ATTACHMENTS 8
@@ -58,5 +72,49 @@ ogl3_to_rb_type(GLenum attrib_type)
   }
 }
 
+/* Reference counter of the objects whose references may be put by any thread.
+ * The release of an object calls the driver and is thus run on the thread of
+ * its context: either immediately or when the deferred releases are flushed
+ * if its last reference is put by another thread. The release of a shared
+ * object, i.e. whose driver object lives in the share group of its context,
+ * may be run by the thread of any context of the group. */
+struct rb_ogl3_ref {
+  int count; /* Atomically updated. */
+  int is_shared;
+  struct rb_ogl3_ref* next; /* Next deferred release. */
+  void (*release)(struct rb_ogl3_ref*);
+};
+
+static inline void
+rb_ogl3_ref_init
+  (struct rb_ogl3_ref* ref,
+   void (*release)(struct rb_ogl3_ref*))
+{
+  ref->count = 1;
+  ref->is_shared = 0;
+  ref->next = NULL;
+  ref->release = release;
+}
+
+static inline void
+rb_ogl3_ref_get(struct rb_ogl3_ref* ref)
+{
+  __sync_add_and_fetch(&ref->count, 1);
+}
+
+/* Poll the GL error flag of `ctxt' and report the pending error, if any. The
+ * `call' string identifies the GL call that detects the error. */
+LOCAL_SYM void
+rb_ogl3_check_error
+  (struct rb_context* ctxt,
+   const char* call);
+
+/* Count the GL call `call' and check the GL error flag of `ctxt' once per
+ * sampling period of its error state. */
+LOCAL_SYM void
+rb_ogl3_sample_error
+  (struct rb_context* ctxt,
+   const char* call);
+
 #endif /* RB_OGL3_H */
 
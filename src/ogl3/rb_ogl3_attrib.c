@@ -9,13 +9,12 @@
 #include <string.h>
 
 struct rb_attrib {
-  struct ref ref;
+  struct rb_ogl3_ref ref;
   struct rb_context* ctxt;
-  GLint index;
-  GLenum type;
   struct rb_program* program;
-  char* name;
-  void (*set)(GLuint, const void* data);
+  struct rb_ogl3_reflection* reflection;
+  const struct rb_ogl3_variable* var; /* Lies in the reflection. */
+  void (*set)(struct rb_context* ctxt, GLuint, const void* data);
 };
 
 /*******************************************************************************
@@ -25,9 +24,9 @@ struct rb_attrib {
  ******************************************************************************/
 #define ATTRIB_VALUE(suffix)                                                   \
   static void                                                                  \
-  attrib_##suffix(GLuint index, const void* data)                              \
+  attrib_##suffix(struct rb_context* ctxt, GLuint index, const void* data)     \
   {                                                                            \
-    OGL(VertexAttrib##suffix(index, data));                                    \
+    OGL(ctxt, VertexAttrib##suffix(index, data));                              \
   }
 
 ATTRIB_VALUE(1fv)
@@ -36,7 +35,8 @@ ATTRIB_VALUE(3fv)
 ATTRIB_VALUE(4fv)
 
 static void
-(*get_attrib_setter(GLenum attrib_type))(GLuint, const void*)
+(*get_attrib_setter(GLenum attrib_type))
+  (struct rb_context*, GLuint, const void*)
 {
   switch(attrib_type) {
     case GL_FLOAT: return &attrib_1fv;
@@ -47,89 +47,47 @@ static void
   }
 }
 
+static void
+release_attrib(struct rb_ogl3_ref* ref)
+{
+  struct rb_attrib* attr = NULL;
+  struct rb_context* ctxt = NULL;
+  ASSERT(ref);
+
+  attr = CONTAINER_OF(ref, struct rb_attrib, ref);
+  ctxt = attr->ctxt;
+
+  RB(program_ref_put(attr->program));
+  rb_ogl3_reflection_ref_put(attr->reflection);
+  rb_ogl3_free_object(ctxt, RB_OBJECT_ATTRIB, attr);
+  RB(context_ref_put(ctxt));
+}
+
 static int
-get_active_attrib
+create_attrib
   (struct rb_context* ctxt,
    struct rb_program* program,
-   GLuint index,
-   GLsizei bufsize,
-   GLchar* buffer,
+   const struct rb_ogl3_variable* var,
    struct rb_attrib** out_attrib)
 {
   struct rb_attrib* attr = NULL;
-  GLsizei attr_namelen = 0;
-  GLint attr_size = 0;
-  GLenum attr_type;
-  int err = 0;
+  ASSERT(ctxt && program && program->reflection && var && out_attrib);
 
-  if(!ctxt
-  || !program
-  || !out_attrib
-  || bufsize < 0
-  || (bufsize > 0 && !buffer))
-    goto error;
-
-  OGL(GetActiveAttrib
-    (program->name,
-     index,
-     bufsize,
-     &attr_namelen,
-     &attr_size,
-     &attr_type,
-     buffer));
-
-  attr = MEM_CALLOC(ctxt->allocator, 1, sizeof(struct rb_attrib));
+  attr = rb_ogl3_alloc_object
+    (ctxt, RB_OBJECT_ATTRIB, sizeof(struct rb_attrib));
   if(!attr)
-    goto error;
-  ref_init(&attr->ref);
+    return -1;
+  rb_ogl3_ref_init(&attr->ref, release_attrib);
   RB(context_ref_get(ctxt));
   attr->ctxt = ctxt;
   RB(program_ref_get(program));
   attr->program = program;
-  attr->type = attr_type;
-  attr->set = get_attrib_setter(attr_type);
-
-  if(buffer) {
-    /* Add 1 to namelen <=> include the null character. */
-    ++attr_namelen;
-
-    attr->name = MEM_ALLOC(ctxt->allocator, sizeof(char)*(size_t)attr_namelen);
-    if(!attr->name)
-      goto error;
-    attr->name = strncpy(attr->name, buffer, (size_t)attr_namelen);
-    attr->index = OGL(GetAttribLocation(program->name, attr->name));
-  }
-
-exit:
-  if(out_attrib)
-    *out_attrib = attr;
-  return err;
-
-error:
-  if(attr) {
-    RB(attrib_ref_put(attr));
-    attr = NULL;
-  }
-  err = -1;
-  goto exit;
-}
-
-static void
-release_attrib(struct ref* ref)
-{
-  struct rb_attrib* attr = NULL;
-  struct rb_context* ctxt = NULL;
-  ASSERT(ref);
-
-  attr = CONTAINER_OF(ref, struct rb_attrib, ref);
-  ctxt = attr->ctxt;
-
-  if(attr->program)
-    RB(program_ref_put(attr->program));
-  if(attr->name)
-    MEM_FREE(ctxt->allocator, attr->name);
-  MEM_FREE(ctxt->allocator, attr);
-  RB(context_ref_put(ctxt));
+  rb_ogl3_reflection_ref_get(program->reflection);
+  attr->reflection = program->reflection;
+  attr->var = var;
+  attr->set = get_attrib_setter(var->type);
+  *out_attrib = attr;
+  return 0;
 }
 
 /*******************************************************************************
@@ -144,49 +102,35 @@ rb_get_attribs
    size_t* out_nb_attribs,
    struct rb_attrib* dst_attrib_list[])
 {
-  GLchar* attr_buffer = NULL;
-  int attr_buflen = 0;
-  int nb_attribs = 0;
-  int attr_id = 0;
+  size_t nb_attribs = 0;
+  size_t attr_id = 0;
   int err = 0;
 
   if(!ctxt || !prog || !out_nb_attribs)
     goto error;
 
-  if(!prog->is_linked)
+  if(rb_ogl3_sync_program(prog) != 0)
     goto error;
 
-  OGL(GetProgramiv(prog->name, GL_ACTIVE_ATTRIBUTES, &nb_attribs));
-  ASSERT(nb_attribs >= 0);
-
+  nb_attribs = prog->reflection->nb_attribs;
   if(dst_attrib_list) {
-    OGL(GetProgramiv(prog->name, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &attr_buflen));
-    attr_buffer = MEM_ALLOC(ctxt->allocator,sizeof(GLchar)*(size_t)attr_buflen);
-    if(!attr_buffer)
-      goto error;
-
     for(attr_id = 0; attr_id < nb_attribs; ++attr_id) {
-      struct rb_attrib* attr = NULL;
-
-      err = get_active_attrib
-        (ctxt, prog, (GLuint)attr_id, attr_buflen, attr_buffer, &attr);
+      err = create_attrib
+        (ctxt, prog, prog->reflection->attrib_list + attr_id,
+         dst_attrib_list + attr_id);
       if(err != 0)
         goto error;
-
-      dst_attrib_list[attr_id] = attr;
     }
   }
 
 exit:
-  if(attr_buffer)
-    MEM_FREE(ctxt->allocator, attr_buffer);
   if(out_nb_attribs)
-    *out_nb_attribs = (size_t)nb_attribs;
+    *out_nb_attribs = nb_attribs;
   return err;
 
 error:
   if(dst_attrib_list) {
-    int i = 0;
+    size_t i = 0;
     /* NOTE: attr_id <=> nb attribs in dst_attrib_list; */
     for(i = 0; i < attr_id; ++i) {
       RB(attrib_ref_put(dst_attrib_list[i]));
@@ -205,53 +149,26 @@ rb_get_named_attrib
    const char* name,
    struct rb_attrib** out_attrib)
 {
-  struct rb_attrib* attr = NULL;
-  GLint attr_id = 0;
-  size_t name_len = 0;
-  int err = 0;
+  const struct rb_ogl3_variable* var = NULL;
 
   if(!ctxt || !prog || !name || !out_attrib)
-    goto error;
-
-  if(!prog->is_linked)
-    goto error;
-
-  attr_id = OGL(GetAttribLocation(prog->name, name));
-  if(attr_id == -1)
-    goto error;
-
-  err = get_active_attrib(ctxt, prog, (GLuint)attr_id, 0, NULL, &attr);
-  if(err != 0)
-    goto error;
-
-  name_len = strlen(name) + 1;
-  attr->name = MEM_ALLOC(ctxt->allocator, sizeof(char) * name_len);
-  if(!attr->name)
-    goto error;
-
-  attr->name = strncpy(attr->name, name, name_len);
-  attr->index = OGL(GetAttribLocation(prog->name, attr->name));
+    return -1;
 
-exit:
-  *out_attrib = attr;
-  return err;
+  if(rb_ogl3_sync_program(prog) != 0)
+    return -1;
 
-error:
-  if(attr) {
-    RB(attrib_ref_put(attr));
-    attr = NULL;
-  }
-  err = -1;
-  goto exit;
+  var = rb_ogl3_find_attrib(prog->reflection, name);
+  if(!var)
+    return -1;
+  return create_attrib(ctxt, prog, var, out_attrib);
 }
 
-
 int
 rb_attrib_ref_get(struct rb_attrib* attr)
 {
   if(!attr)
     return -1;
-  ref_get(&attr->ref);
+  rb_ogl3_ref_get(&attr->ref);
   return 0;
 }
 
@@ -260,7 +177,7 @@ rb_attrib_ref_put(struct rb_attrib* attr)
 {
   if(!attr)
     return -1;
-  ref_put(&attr->ref, release_attrib);
+  rb_ogl3_ref_put(attr->ctxt, &attr->ref);
   return 0;
 }
 
@@ -271,9 +188,9 @@ rb_attrib_data(struct rb_attrib* attr, const void* data)
     return -1;
 
   ASSERT(attr->set != NULL);
-  OGL(UseProgram(attr->program->name));
-  attr->set((GLuint)attr->index, data);
-  OGL(UseProgram(attr->ctxt->state_cache.current_program));
+  OGL(attr->ctxt, UseProgram(attr->program->name));
+  attr->set(attr->ctxt, (GLuint)attr->var->location, data);
+  OGL(attr->ctxt, UseProgram(attr->ctxt->state_cache.current_program));
   return 0;
 }
 
@@ -283,9 +200,9 @@ rb_get_attrib_desc(const struct rb_attrib* attr, struct rb_attrib_desc* desc)
   if(!attr || !desc)
     return -1;
 
-  desc->name = attr->name;
-  desc->index = attr->index;
-  desc->type = ogl3_to_rb_type(attr->type);
+  desc->name = attr->var->name;
+  desc->index = attr->var->location;
+  desc->type = ogl3_to_rb_type(attr->var->type);
   return 0;
 }
 
@@ -77,20 +77,25 @@ rb_to_ogl3_usage(enum rb_usage usage)
 }
 
 static void
-release_buffer(struct ref* ref)
+release_buffer(struct rb_ogl3_ref* ref)
 {
   struct rb_buffer* buffer = NULL;
   struct rb_context* ctxt = NULL;
+  struct rb_context* current = NULL;
   ASSERT(ref);
 
   buffer = CONTAINER_OF(ref, struct rb_buffer, ref);
   ctxt = buffer->ctxt;
+  /* The buffer may be released by another context of its share group. */
+  current = rb_ogl3_current_context(ctxt);
 
-  if(buffer->name == ctxt->state_cache.buffer_binding[buffer->binding])
-    OGL(BindBuffer(buffer->target, 0));
- 
-  OGL(DeleteBuffers(1, &buffer->name));
-  MEM_FREE(ctxt->allocator, buffer);
+  if(buffer->name == current->state_cache.buffer_binding[buffer->binding]) {
+    OGL(current, BindBuffer(buffer->target, 0));
+    current->state_cache.buffer_binding[buffer->binding] = 0;
+  }
+  OGL(current, DeleteBuffers(1, &buffer->name));
+  rb_ogl3_signal_delete(ctxt);
+  rb_ogl3_free_object(ctxt, RB_OBJECT_BUFFER, buffer);
   RB(context_ref_put(ctxt));
 }
 
@@ -119,7 +124,7 @@ rb_buffer_ref_get(struct rb_buffer* buffer)
 {
   if(!buffer)
     return -1;
-  ref_get(&buffer->ref);
+  rb_ogl3_ref_get(&buffer->ref);
   return 0;
 }
 
@@ -128,7 +133,7 @@ rb_buffer_ref_put(struct rb_buffer* buffer)
 {
   if(!buffer)
     return -1;
-  ref_put(&buffer->ref, release_buffer);
+  rb_ogl3_ref_put(buffer->ctxt, &buffer->ref);
   return 0;
 }
 
@@ -161,20 +166,22 @@ rb_buffer_data
   if(size == 0)
     return 0;
 
-  OGL(BindBuffer(buffer->target, buffer->name));
+  /* The buffer is bound to the copy target rather than to its own target in
+   * order to not overwrite the index buffer of the current vertex array. */
+  OGL(buffer->ctxt, BindBuffer(GL_COPY_WRITE_BUFFER, buffer->name));
 
   if(offset == 0 && size == buffer->size) {
-    mapped_mem = OGL(MapBuffer(buffer->target, GL_WRITE_ONLY));
+    OGL_ASSIGN(buffer->ctxt, mapped_mem, MapBuffer
+      (GL_COPY_WRITE_BUFFER, GL_WRITE_ONLY));
   } else {
     const GLbitfield access = GL_MAP_WRITE_BIT;
-    mapped_mem = OGL(MapBufferRange(buffer->target, offset, size, access));
+    OGL_ASSIGN(buffer->ctxt, mapped_mem, MapBufferRange
+      (GL_COPY_WRITE_BUFFER, offset, size, access));
   }
   ASSERT(mapped_mem != NULL);
   memcpy(mapped_mem, data, (size_t)size);
-  unmap = OGL(UnmapBuffer(buffer->target));
-  OGL(BindBuffer
-    (buffer->target, 
-     buffer->ctxt->state_cache.buffer_binding[buffer->binding]));
+  OGL_ASSIGN(buffer->ctxt, unmap, UnmapBuffer(GL_COPY_WRITE_BUFFER));
+  OGL(buffer->ctxt, BindBuffer(GL_COPY_WRITE_BUFFER, 0));
 
   /* unmap == GL_FALSE must be handled by the application. TODO return a real
    * error code to differentiate this case from the error. */
@@ -202,10 +209,12 @@ rb_ogl3_create_buffer
   || (desc->usage == RB_USAGE_IMMUTABLE && init_data == NULL))
     return -1;
 
-  buffer = MEM_ALLOC(ctxt->allocator, sizeof(struct rb_buffer));
+  buffer = rb_ogl3_alloc_object
+    (ctxt, RB_OBJECT_BUFFER, sizeof(struct rb_buffer));
   if(!buffer)
     return -1;
-  ref_init(&buffer->ref);
+  rb_ogl3_ref_init(&buffer->ref, release_buffer);
+  buffer->ref.is_shared = 1;
   RB(context_ref_get(ctxt));
   buffer->ctxt = ctxt;
 
@@ -214,12 +223,13 @@ rb_ogl3_create_buffer
   buffer->size = (GLsizei)desc->size;
   buffer->binding = desc->target;
 
-  OGL(GenBuffers(1, &buffer->name));
-  OGL(BindBuffer(buffer->target, buffer->name));
-  OGL(BufferData(buffer->target, buffer->size, init_data, buffer->usage));
-  OGL(BindBuffer
-    (buffer->target, 
-     ctxt->state_cache.buffer_binding[buffer->binding]));
+  /* Bind the buffer to the copy target in order to not overwrite the index
+   * buffer of the current vertex array. */
+  OGL(ctxt, GenBuffers(1, &buffer->name));
+  OGL(ctxt, BindBuffer(GL_COPY_WRITE_BUFFER, buffer->name));
+  OGL(ctxt, BufferData
+    (GL_COPY_WRITE_BUFFER, buffer->size, init_data, buffer->usage));
+  OGL(ctxt, BindBuffer(GL_COPY_WRITE_BUFFER, 0));
 
   *out_buffer = buffer;
   return 0;
@@ -238,11 +248,12 @@ rb_ogl3_bind_buffer
   if(!ctxt || (buffer && (buffer->binding != target)))
     goto error;
 
+  rb_ogl3_sync_state_cache(ctxt);
   current_name = ctxt->state_cache.buffer_binding[target];
   name = buffer ? buffer->name : 0;
 
   if(current_name != name) {
-    OGL(BindBuffer(rb_to_ogl3_buffer_target(target), name));
+    OGL(ctxt, BindBuffer(rb_to_ogl3_buffer_target(target), name));
     ctxt->state_cache.buffer_binding[target] = name;
   }
 
@@ -3,14 +3,13 @@
 
 #include "ogl3/rb_ogl3.h"
 #include "rb_types.h"
-#include <snlsys/ref_count.h>
 #include <snlsys/snlsys.h>
 #include <GL/gl.h>
 
 struct rb_context;
 
 struct rb_buffer {
-  struct ref ref;
+  struct rb_ogl3_ref ref;
   struct rb_context* ctxt;
   GLuint name;
   GLenum target;
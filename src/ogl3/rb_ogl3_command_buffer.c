@@ -0,0 +1,349 @@
+#include "common/rb_command_list.h"
+#include "ogl3/rb_ogl3.h"
+#include "ogl3/rb_ogl3_context.h"
+#include "ogl3/rb_ogl3_program.h"
+#include "rb.h"
+#include <snlsys/snlsys.h>
+#include <pthread.h>
+
+/* The command buffers do not own GL objects. They may be thus recorded and
+ * released by any thread while their commands are executed by the thread of
+ * the context onto which the GL context is current. */
+struct rb_command_buffer {
+  struct rb_ogl3_ref ref;
+  struct rb_context* ctxt;
+  struct rb_command_list list;
+};
+
+/* The bundles do not own GL objects either but they reference the recorded
+ * objects whose last reference may be thus put by another thread. */
+struct rb_bundle {
+  struct rb_ogl3_ref ref;
+  struct rb_context* ctxt;
+  struct rb_command_list list; /* Baked commands. */
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static void
+release_command_buffer(struct rb_ogl3_ref* ref)
+{
+  struct rb_command_buffer* cmd = NULL;
+  struct rb_context* ctxt = NULL;
+  ASSERT(ref);
+
+  cmd = CONTAINER_OF(ref, struct rb_command_buffer, ref);
+  ctxt = cmd->ctxt;
+  rb_release_command_list(&cmd->list);
+  rb_ogl3_free_object(ctxt, RB_OBJECT_COMMAND_BUFFER, cmd);
+  RB(context_ref_put(ctxt));
+}
+
+static void
+release_bundle(struct rb_ogl3_ref* ref)
+{
+  struct rb_bundle* bundle = NULL;
+  struct rb_context* ctxt = NULL;
+  ASSERT(ref);
+
+  bundle = CONTAINER_OF(ref, struct rb_bundle, ref);
+  ctxt = bundle->ctxt;
+  rb_command_list_ref_put_objects(&bundle->list);
+  rb_release_command_list(&bundle->list);
+  rb_ogl3_free_object(ctxt, RB_OBJECT_BUNDLE, bundle);
+  RB(context_ref_put(ctxt));
+}
+
+/*******************************************************************************
+ *
+ * Command buffer functions.
+ *
+ ******************************************************************************/
+int
+rb_create_command_buffer
+  (struct rb_context* ctxt,
+   struct rb_command_buffer** out_cmd)
+{
+  struct rb_command_buffer* cmd = NULL;
+
+  if(!ctxt || !out_cmd)
+    return -1;
+
+  cmd = rb_ogl3_alloc_object
+    (ctxt, RB_OBJECT_COMMAND_BUFFER, sizeof(struct rb_command_buffer));
+  if(!cmd)
+    return -1;
+  rb_ogl3_ref_init(&cmd->ref, release_command_buffer);
+  RB(context_ref_get(ctxt));
+  cmd->ctxt = ctxt;
+  rb_init_command_list(ctxt->allocator, &cmd->list);
+  *out_cmd = cmd;
+  return 0;
+}
+
+int
+rb_command_buffer_ref_get(struct rb_command_buffer* cmd)
+{
+  if(!cmd)
+    return -1;
+  rb_ogl3_ref_get(&cmd->ref);
+  return 0;
+}
+
+int
+rb_command_buffer_ref_put(struct rb_command_buffer* cmd)
+{
+  if(!cmd)
+    return -1;
+  rb_ogl3_ref_put(cmd->ctxt, &cmd->ref);
+  return 0;
+}
+
+int
+rb_reset_command_buffer(struct rb_command_buffer* cmd)
+{
+  if(!cmd)
+    return -1;
+  rb_clear_command_list(&cmd->list);
+  return 0;
+}
+
+int
+rb_cmd_bind_program(struct rb_command_buffer* cmd, struct rb_program* prog)
+{
+  return cmd ? rb_encode_bind_program(&cmd->list, prog) : -1;
+}
+
+int
+rb_cmd_bind_vertex_array
+  (struct rb_command_buffer* cmd,
+   struct rb_vertex_array* varray)
+{
+  return cmd ? rb_encode_bind_vertex_array(&cmd->list, varray) : -1;
+}
+
+int
+rb_cmd_bind_tex2d
+  (struct rb_command_buffer* cmd,
+   struct rb_tex2d* tex,
+   unsigned int tex_unit)
+{
+  return cmd ? rb_encode_bind_tex2d(&cmd->list, tex, tex_unit) : -1;
+}
+
+int
+rb_cmd_bind_sampler
+  (struct rb_command_buffer* cmd,
+   struct rb_sampler* sampler,
+   unsigned int tex_unit)
+{
+  return cmd ? rb_encode_bind_sampler(&cmd->list, sampler, tex_unit) : -1;
+}
+
+int
+rb_cmd_bind_framebuffer
+  (struct rb_command_buffer* cmd,
+   struct rb_framebuffer* buffer)
+{
+  return cmd ? rb_encode_bind_framebuffer(&cmd->list, buffer) : -1;
+}
+
+int
+rb_cmd_blend
+  (struct rb_command_buffer* cmd,
+   const struct rb_blend_desc* desc)
+{
+  return cmd ? rb_encode_blend(&cmd->list, desc) : -1;
+}
+
+int
+rb_cmd_depth_stencil
+  (struct rb_command_buffer* cmd,
+   const struct rb_depth_stencil_desc* desc)
+{
+  return cmd ? rb_encode_depth_stencil(&cmd->list, desc) : -1;
+}
+
+int
+rb_cmd_rasterizer
+  (struct rb_command_buffer* cmd,
+   const struct rb_rasterizer_desc* desc)
+{
+  return cmd ? rb_encode_rasterizer(&cmd->list, desc) : -1;
+}
+
+int
+rb_cmd_viewport
+  (struct rb_command_buffer* cmd,
+   const struct rb_viewport_desc* desc)
+{
+  return cmd ? rb_encode_viewport(&cmd->list, desc) : -1;
+}
+
+int
+rb_cmd_clear
+  (struct rb_command_buffer* cmd,
+   int clear_flag,
+   const float color_val[4],
+   float depth_val,
+   char stencil_val)
+{
+  if(!cmd)
+    return -1;
+  return rb_encode_clear
+    (&cmd->list, clear_flag, color_val, depth_val, stencil_val);
+}
+
+int
+rb_cmd_uniform_data
+  (struct rb_command_buffer* cmd,
+   struct rb_uniform* uniform,
+   int count,
+   const void* data)
+{
+  size_t size = 0;
+
+  if(!cmd || !uniform || count <= 0)
+    return -1;
+  size = rb_ogl3_sizeof_uniform_data(uniform, count);
+  return rb_encode_uniform_data(&cmd->list, uniform, count, size, data);
+}
+
+int
+rb_cmd_buffer_data
+  (struct rb_command_buffer* cmd,
+   struct rb_buffer* buf,
+   int offset,
+   int size,
+   const void* data)
+{
+  return cmd ? rb_encode_buffer_data(&cmd->list, buf, offset, size, data) : -1;
+}
+
+int
+rb_cmd_draw
+  (struct rb_command_buffer* cmd,
+   enum rb_primitive_type prim_type,
+   unsigned int count)
+{
+  return cmd ? rb_encode_draw(&cmd->list, prim_type, count) : -1;
+}
+
+int
+rb_cmd_draw_indexed
+  (struct rb_command_buffer* cmd,
+   enum rb_primitive_type prim_type,
+   unsigned int count)
+{
+  return cmd ? rb_encode_draw_indexed(&cmd->list, prim_type, count) : -1;
+}
+
+int
+rb_submit_command_buffers
+  (struct rb_context* ctxt,
+   size_t count,
+   struct rb_command_buffer* const cmd_list[])
+{
+  size_t i = 0;
+  int err = 0;
+
+  if(!ctxt || (count && !cmd_list))
+    return -1;
+  /* The GL context is only current onto the thread of the context. */
+  if(!pthread_equal(pthread_self(), ctxt->thread))
+    return -1;
+  for(i = 0; i < count; ++i) {
+    if(!cmd_list[i] || cmd_list[i]->ctxt != ctxt)
+      return -1;
+  }
+  for(i = 0; i < count; ++i) {
+    if(rb_execute_command_list(ctxt, &cmd_list[i]->list) != 0)
+      err = -1;
+  }
+  return err;
+}
+
+/*******************************************************************************
+ *
+ * Bundle functions.
+ *
+ ******************************************************************************/
+int
+rb_create_bundle
+  (struct rb_context* ctxt,
+   struct rb_command_buffer* cmd,
+   struct rb_bundle** out_bundle)
+{
+  struct rb_bundle* bundle = NULL;
+
+  if(!ctxt || !cmd || cmd->ctxt != ctxt || !out_bundle)
+    return -1;
+  /* The GL context is only current onto the thread of the context. */
+  if(!pthread_equal(pthread_self(), ctxt->thread))
+    return -1;
+
+  bundle = rb_ogl3_alloc_object
+    (ctxt, RB_OBJECT_BUNDLE, sizeof(struct rb_bundle));
+  if(!bundle)
+    return -1;
+  rb_init_command_list(ctxt->allocator, &bundle->list);
+  if(rb_bake_command_list
+     (&bundle->list, &cmd->list, RB_OGL3_MAX_TEXTURE_UNITS) != 0) {
+    rb_release_command_list(&bundle->list);
+    rb_ogl3_free_object(ctxt, RB_OBJECT_BUNDLE, bundle);
+    return -1;
+  }
+  rb_ogl3_ref_init(&bundle->ref, release_bundle);
+  RB(context_ref_get(ctxt));
+  bundle->ctxt = ctxt;
+  rb_command_list_ref_get_objects(&bundle->list);
+  *out_bundle = bundle;
+  return 0;
+}
+
+int
+rb_bundle_ref_get(struct rb_bundle* bundle)
+{
+  if(!bundle)
+    return -1;
+  rb_ogl3_ref_get(&bundle->ref);
+  return 0;
+}
+
+int
+rb_bundle_ref_put(struct rb_bundle* bundle)
+{
+  if(!bundle)
+    return -1;
+  rb_ogl3_ref_put(bundle->ctxt, &bundle->ref);
+  return 0;
+}
+
+int
+rb_bundle_uniform_data
+  (struct rb_bundle* bundle,
+   struct rb_uniform* uniform,
+   int count,
+   const void* data)
+{
+  size_t size = 0;
+
+  if(!bundle || !uniform || count <= 0)
+    return -1;
+  size = rb_ogl3_sizeof_uniform_data(uniform, count);
+  return rb_patch_uniform_data(&bundle->list, uniform, count, size, data);
+}
+
+int
+rb_execute_bundle(struct rb_context* ctxt, struct rb_bundle* bundle)
+{
+  if(!ctxt || !bundle || bundle->ctxt != ctxt)
+    return -1;
+  /* The GL context is only current onto the thread of the context. */
+  if(!pthread_equal(pthread_self(), ctxt->thread))
+    return -1;
+  return rb_execute_command_list(ctxt, &bundle->list);
+}
@@ -1,3 +1,4 @@
+#include "ogl3/rb_ogl3_buffers.h"
 #include "ogl3/rb_ogl3_context.h"
 #include "rb.h"
 #include <snlsys/mem_allocator.h>
@@ -11,24 +12,93 @@
  *
  ******************************************************************************/
 static void
-setup_config(struct rb_config* cfg)
+setup_config(struct rb_context* ctxt)
 {
   int i = 0;
-  OGL(GetIntegerv(GL_MAX_TEXTURE_SIZE, &i));
+  ASSERT(ctxt);
+
+  OGL(ctxt, GetIntegerv(GL_MAX_TEXTURE_SIZE, &i));
   ASSERT(i > 0);
-  cfg->max_tex_size = (size_t)i;
-  OGL(GetIntegerv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &i));
+  ctxt->config.max_tex_size = (size_t)i;
+  OGL(ctxt, GetIntegerv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &i));
   ASSERT(i > 0);
-  cfg->max_tex_max_anisotropy = (size_t)i;
+  ctxt->config.max_tex_max_anisotropy = (size_t)i;
 }
 
 static void
-release_context(struct ref* ref)
+setup_extensions(struct rb_context* ctxt)
 {
-  struct rb_context* ctxt = NULL;
-  ASSERT(ref);
+  int nb_exts = 0;
+  int i = 0;
+  ASSERT(ctxt);
+
+  memset(&ctxt->ext, 0, sizeof(struct extensions));
+  OGL(ctxt, GetIntegerv(GL_NUM_EXTENSIONS, &nb_exts));
+  for(i = 0; i < nb_exts; ++i) {
+    const GLubyte* str = NULL;
+    const char* ext = NULL;
+    OGL_ASSIGN(ctxt, str, GetStringi(GL_EXTENSIONS, (GLuint)i));
+    ext = (const char*)str;
+    #define GL_EXT(name)                                                       \
+      if(!strcmp(ext, "GL_"#name))                                             \
+        ctxt->ext.name = 1;
+    #include "ogl3/rb_ogl3_gl_ext.h"
+    #undef GL_EXT
+  }
+}
+
+static void
+release_share_group(struct rb_ogl3_share_group* group)
+{
+  ASSERT(group);
 
-  ctxt = CONTAINER_OF(ref, struct rb_context, ref);
+  /* The deferred releases reference the contexts of the group. */
+  ASSERT(is_list_empty(&group->context_list) && !group->release_queue);
+  pthread_mutex_destroy(&group->lock);
+  MEM_FREE(group->allocator, group);
+}
+
+static void
+run_releases(struct rb_ogl3_ref** queue)
+{
+  struct rb_ogl3_ref* ref = NULL;
+  ASSERT(queue);
+
+  /* Detach the whole stack at once. The releases deferred in the meantime
+   * are run by the next flush. */
+  ref = __sync_lock_test_and_set(queue, NULL);
+  while(ref) {
+    struct rb_ogl3_ref* next = ref->next;
+    ref->release(ref);
+    ref = next;
+  }
+}
+
+static void
+release_context(struct rb_context* ctxt)
+{
+  int i = 0;
+  ASSERT(ctxt);
+
+  rb_ogl3_release_program_cache(ctxt);
+  rb_release_variant_cache(&ctxt->variant_cache);
+  /* The objects reference their context and are thus already released. */
+  for(i = 0; i < RB_OBJECT_TYPES_COUNT; ++i)
+    rb_release_slab(ctxt->pool_list + i);
+  rb_release_string_arena(&ctxt->names);
+  rb_release_arena(&ctxt->frame);
+  if(ctxt->group) {
+    pthread_mutex_lock(&ctxt->group->lock);
+    list_del(&ctxt->group_node);
+    pthread_mutex_unlock(&ctxt->group->lock);
+    __sync_sub_and_fetch(&ctxt->group->nb_contexts, 1);
+    if(__sync_sub_and_fetch(&ctxt->group->ref, 1) == 0)
+      release_share_group(ctxt->group);
+  }
+  if(ctxt->headless) {
+    rb_ogl3_release_headless(ctxt->headless);
+    MEM_FREE(ctxt->allocator, ctxt->headless);
+  }
   MEM_FREE(ctxt->allocator, ctxt);
 }
 
@@ -44,6 +114,8 @@ rb_create_context
 {
   struct mem_allocator* allocator = NULL;
   struct rb_context* ctxt = NULL;
+  struct rb_error_check_desc error_check = { RB_ERROR_CHECK_NONE, 0 };
+  unsigned int i = 0;
   int err = 0;
 
   if(!out_ctxt)
@@ -54,17 +126,47 @@ rb_create_context
   if(!ctxt)
     goto error;
   ctxt->allocator = allocator;
-  ref_init(&ctxt->ref);
+  ctxt->thread = pthread_self();
+  ctxt->ref = 1;
+  list_init(&ctxt->group_node);
+  rb_init_variant_cache(allocator, &ctxt->variant_cache);
+  for(i = 0; i < RB_OGL3_SAMPLER_CACHE_SIZE; ++i)
+    list_init(&ctxt->sampler_cache[i]);
+  rb_init_string_arena(allocator, &ctxt->names);
+  rb_init_arena(allocator, &ctxt->frame);
 
   #define GL_FUNC(type, func, ...)                                             \
-    rbgl##func = (type (*)(__VA_ARGS__))                                       \
+    ctxt->gl.func = (type (*)(__VA_ARGS__))                                    \
       RB_OGL3_GET_PROC_ADDRESS(STR(gl##func));                                 \
-    if(!rbgl##func)                                                            \
+    if(!ctxt->gl.func)                                                         \
       goto error;
   #include "ogl3/rb_ogl3_gl_func.h"
   #undef GL_FUNC
 
-  setup_config(&ctxt->config);
+  /* Disable the extensions whose entry points are not all exposed. */
+  setup_extensions(ctxt);
+  #define GL_EXT_FUNC(extension, type, func, ...)                              \
+    if(ctxt->ext.extension) {                                                  \
+      ctxt->gl.func = (type (*)(__VA_ARGS__))                                  \
+        RB_OGL3_GET_PROC_ADDRESS(STR(gl##func));                               \
+      if(!ctxt->gl.func)                                                       \
+        ctxt->ext.extension = 0;                                               \
+    }
+  #include "ogl3/rb_ogl3_gl_ext_func.h"
+  #undef GL_EXT_FUNC
+
+  #ifndef NDEBUG
+  error_check.mode = RB_ERROR_CHECK_STRICT;
+  #else
+  error_check.mode = RB_ERROR_CHECK_NONE;
+  #endif
+  if(rb_error_check(ctxt, &error_check) != 0)
+    goto error;
+
+  setup_config(ctxt);
+
+  if(rb_ogl3_setup_program_cache(ctxt) != 0)
+    goto error;
 
 exit:
   if(ctxt)
@@ -85,7 +187,7 @@ rb_context_ref_get(struct rb_context* ctxt)
 {
   if(!ctxt)
     return -1;
-  ref_get(&ctxt->ref);
+  __sync_add_and_fetch(&ctxt->ref, 1);
   return 0;
 }
 
@@ -94,7 +196,163 @@ rb_context_ref_put(struct rb_context* ctxt)
 {
   if(!ctxt)
     return -1;
-  ref_put(&ctxt->ref, release_context);
+  /* The pending releases reference the context. */
+  if(pthread_equal(pthread_self(), ctxt->thread))
+    rb_ogl3_flush_releases(ctxt);
+  if(__sync_sub_and_fetch(&ctxt->ref, 1) == 0)
+    release_context(ctxt);
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+void
+rb_ogl3_ref_put(struct rb_context* ctxt, struct rb_ogl3_ref* ref)
+{
+  struct rb_ogl3_ref** queue = NULL;
+  struct rb_ogl3_ref* head = NULL;
+  int count = 0;
+  ASSERT(ctxt && ref);
+
+  count = __sync_sub_and_fetch(&ref->count, 1);
+  ASSERT(count >= 0);
+  if(count != 0)
+    return;
+  if(pthread_equal(pthread_self(), ctxt->thread)) {
+    ref->release(ref);
+    return;
+  }
+  /* A shared object consumed by another context of the group is released by
+   * the first context that flushes, even if its own context is idle. */
+  if(ref->is_shared && ctxt->group)
+    queue = &ctxt->group->release_queue;
+  else
+    queue = &ctxt->release_queue;
+  do {
+    head = __atomic_load_n(queue, __ATOMIC_ACQUIRE);
+    ref->next = head;
+  } while(!__sync_bool_compare_and_swap(queue, head, ref));
+}
+
+int
+rb_ogl3_ref_try_get(struct rb_ogl3_ref* ref)
+{
+  int count = 0;
+  ASSERT(ref);
+
+  do {
+    count = __atomic_load_n(&ref->count, __ATOMIC_ACQUIRE);
+    if(!count)
+      return 0;
+  } while(!__sync_bool_compare_and_swap(&ref->count, count, count + 1));
+  return 1;
+}
+
+void
+rb_ogl3_flush_releases(struct rb_context* ctxt)
+{
+  ASSERT(ctxt && pthread_equal(pthread_self(), ctxt->thread));
+
+  run_releases(&ctxt->release_queue);
+  if(ctxt->group)
+    run_releases(&ctxt->group->release_queue);
+}
+
+int
+rb_ogl3_setup_share_group(struct rb_context* ctxt)
+{
+  struct rb_ogl3_share_group* group = NULL;
+  ASSERT(ctxt && !ctxt->group);
+
+  group = MEM_CALLOC(ctxt->allocator, 1, sizeof(struct rb_ogl3_share_group));
+  if(!group)
+    return -1;
+  group->ref = 1;
+  group->allocator = ctxt->allocator;
+  pthread_mutex_init(&group->lock, NULL);
+  list_init(&group->context_list);
+  list_add(&group->context_list, &ctxt->group_node);
+  group->nb_contexts = 1;
+  ctxt->group = group;
   return 0;
 }
 
+void
+rb_ogl3_join_share_group(struct rb_context* ctxt, struct rb_context* member)
+{
+  ASSERT(ctxt && ctxt->group && member && !member->group);
+
+  __sync_add_and_fetch(&ctxt->group->ref, 1);
+  pthread_mutex_lock(&ctxt->group->lock);
+  list_add(&ctxt->group->context_list, &member->group_node);
+  pthread_mutex_unlock(&ctxt->group->lock);
+  __sync_add_and_fetch(&ctxt->group->nb_contexts, 1);
+  member->group = ctxt->group;
+  member->group_delete_count =
+    __atomic_load_n(&ctxt->group->delete_count, __ATOMIC_ACQUIRE);
+}
+
+struct rb_context*
+rb_ogl3_current_context(struct rb_context* ctxt)
+{
+  struct rb_context* current = NULL;
+  struct list_node* node = NULL;
+  ASSERT(ctxt);
+
+  if(pthread_equal(pthread_self(), ctxt->thread))
+    return ctxt;
+
+  ASSERT(ctxt->group);
+  pthread_mutex_lock(&ctxt->group->lock);
+  LIST_FOR_EACH(node, &ctxt->group->context_list) {
+    struct rb_context* member =
+      CONTAINER_OF(node, struct rb_context, group_node);
+    if(pthread_equal(pthread_self(), member->thread)) {
+      current = member;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&ctxt->group->lock);
+  ASSERT(current);
+  return current;
+}
+
+void
+rb_ogl3_signal_delete(struct rb_context* ctxt)
+{
+  ASSERT(ctxt);
+  /* A context alone in its group keeps its state cache up to date. */
+  if(ctxt->group
+  && __atomic_load_n(&ctxt->group->nb_contexts, __ATOMIC_ACQUIRE) > 1)
+    __sync_add_and_fetch(&ctxt->group->delete_count, 1);
+}
+
+void
+rb_ogl3_invalidate_state_cache(struct rb_context* ctxt)
+{
+  int i = 0;
+  ASSERT(ctxt && pthread_equal(pthread_self(), ctxt->thread));
+
+  /* The index buffer binding is a state of the bound vertex array and is not
+   * thus reset. */
+  for(i = 0; i < RB_OGL3_NB_BUFFER_TARGETS; ++i) {
+    if(i == RB_OGL3_BIND_INDEX_BUFFER)
+      ctxt->state_cache.buffer_binding[i] = 0;
+    else
+      RB(ogl3_bind_buffer(ctxt, NULL, (enum rb_ogl3_buffer_target)i));
+  }
+  /* The textures are always bound and their cached names are only restored.
+   * They are kept unless they were deleted by another context. */
+  for(i = 0; i < RB_OGL3_MAX_TEXTURE_UNITS; ++i) {
+    const GLuint name = ctxt->state_cache.texture_binding_2d[i];
+    GLboolean is_texture = GL_FALSE;
+    if(name) {
+      OGL_ASSIGN(ctxt, is_texture, IsTexture(name));
+      if(is_texture == GL_FALSE)
+        ctxt->state_cache.texture_binding_2d[i] = 0;
+    }
+  }
+}
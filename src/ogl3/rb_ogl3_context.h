@@ -1,16 +1,87 @@
 #ifndef RB_OGL3_CONTEXT_H
 #define RB_OGL3_CONTEXT_H
 
+#include "common/rb_pool.h"
+#include "common/rb_shader_variant.h"
 #include "ogl3/rb_ogl3.h"
-#include <snlsys/ref_count.h>
+#include <snlsys/list.h>
 #include <GL/gl.h>
+#include <pthread.h>
+#include <stdint.h>
+
+#define RB_OGL3_SAMPLER_CACHE_SIZE 64 /* Power of 2. */
 
 struct mem_allocator;
+struct rb_ogl3_headless;
+
+/* Contexts whose driver contexts share their objects, i.e. a context and its
+ * loaders. */
+struct rb_ogl3_share_group {
+  int ref; /* Atomically updated: the group is joined by any thread. */
+  struct mem_allocator* allocator;
+  /* Protect the list of contexts and the object slabs of the contexts. */
+  pthread_mutex_t lock;
+  struct list_node context_list;
+  int nb_contexts; /* Atomically updated. */
+  /* Lock-free stack of the shared object releases deferred by the threads of
+   * the other contexts. It is run by the next flush of any context. */
+  struct rb_ogl3_ref* release_queue;
+  /* Number of shared driver objects deleted so far. The contexts compare it
+   * to the count they last saw to invalidate the names of their state cache
+   * that may have been deleted and then reused by another context. */
+  int delete_count;
+};
 
 struct rb_context {
-  struct ref ref;
+  /* Atomically updated: the objects of a loader context may be released by
+   * the thread of another context of its group. */
+  int ref;
   struct mem_allocator* allocator;
+  /* Thread that created the context and onto which the objects are
+   * released. */
+  pthread_t thread;
+  /* Lock-free stack of the object releases deferred by the other threads. */
+  struct rb_ogl3_ref* release_queue;
+  /* Share group of the context. NULL if its driver context is provided by the
+   * caller since it cannot be then shared with a loader. */
+  struct rb_ogl3_share_group* group;
+  struct list_node group_node;
+  int group_delete_count; /* Last delete count of the group seen. */
+  /* Offscreen driver context owned by the context. NULL if the driver context
+   * is provided by the caller. */
+  struct rb_ogl3_headless* headless;
+  /* Entry points of the driver context. Each context resolves its own table
+   * so that independent contexts may be created and used by distinct
+   * threads. */
+  struct rb_ogl3_gl gl;
   struct rb_config config;
+  struct rb_error_check_desc error_check;
+  struct rb_ogl3_error_state error_state;
+  struct rb_compile_desc compile;
+  /* Directory of the program binary cache. NULL if the cache is disabled. */
+  char* program_cache_path;
+  uint64_t driver_hash; /* Hash of the driver vendor, renderer and version. */
+  GLint* binary_format_list; /* Program binary formats of the driver. */
+  GLint nb_binary_formats;
+  struct rb_variant_cache variant_cache; /* Shared shader variants. */
+  /* Object slabs, initialised on the first allocation of their type. */
+  struct rb_slab pool_list[RB_OBJECT_TYPES_COUNT];
+  struct rb_string_arena names; /* Names of the program variables. */
+  /* Transient data released at the end of frame. The backend also allocates
+   * its scratch memory from it and rolls it back once done. */
+  struct rb_arena frame;
+  int is_in_frame;
+  /* Buckets of the driver samplers shared by their descriptor hash. */
+  struct list_node sampler_cache[RB_OGL3_SAMPLER_CACHE_SIZE];
+  /* Samplers last bound onto each texture unit. Several samplers may share
+   * the bound driver sampler. */
+  struct rb_sampler* bound_sampler_list[RB_OGL3_MAX_TEXTURE_UNITS];
+  /* Optional extensions supported by the driver. */
+  struct extensions {
+    #define GL_EXT(name) int name;
+    #include "ogl3/rb_ogl3_gl_ext.h"
+    #undef GL_EXT
+  } ext;
   /* Basic state cache. */
   struct state_cache {
     GLuint buffer_binding[RB_OGL3_NB_BUFFER_TARGETS];
@@ -23,5 +94,129 @@ struct rb_context {
   } state_cache;
 };
 
+/* Return a zeroed object of `size' bytes allocated from the slab of `type'. */
+static FINLINE void*
+rb_ogl3_alloc_object
+  (struct rb_context* ctxt,
+   enum rb_object_type type,
+   size_t size)
+{
+  struct rb_slab* slab = NULL;
+  void* object = NULL;
+  ASSERT(ctxt && type < RB_OBJECT_TYPES_COUNT && size);
+
+  slab = ctxt->pool_list + type;
+  if(!slab->slot_size)
+    rb_init_slab(ctxt->allocator, size, slab);
+  ASSERT(size <= slab->slot_size);
+  if(!ctxt->group)
+    return rb_slab_alloc(slab);
+
+  /* The shared objects may be freed by the other contexts of the group. */
+  pthread_mutex_lock(&ctxt->group->lock);
+  object = rb_slab_alloc(slab);
+  pthread_mutex_unlock(&ctxt->group->lock);
+  return object;
+}
+
+static FINLINE void
+rb_ogl3_free_object
+  (struct rb_context* ctxt,
+   enum rb_object_type type,
+   void* object)
+{
+  ASSERT(ctxt && type < RB_OBJECT_TYPES_COUNT);
+  if(!ctxt->group) {
+    rb_slab_free(ctxt->pool_list + type, object);
+  } else {
+    pthread_mutex_lock(&ctxt->group->lock);
+    rb_slab_free(ctxt->pool_list + type, object);
+    pthread_mutex_unlock(&ctxt->group->lock);
+  }
+}
+
+/* Put a reference onto an object of `ctxt'. Its release is deferred up to the
+ * next rb_ogl3_flush_releases if the last reference is not put by the thread
+ * of the context. The deferred release of a shared object is run by the next
+ * flush of any context of the share group. */
+LOCAL_SYM void
+rb_ogl3_ref_put
+  (struct rb_context* ctxt,
+   struct rb_ogl3_ref* ref);
+
+/* Get a reference onto an object found in a cache of the context. Return 0
+ * if its last reference was already put, i.e. if its release is pending. */
+LOCAL_SYM int
+rb_ogl3_ref_try_get
+  (struct rb_ogl3_ref* ref);
+
+/* Run the deferred releases, including the shared ones of the group. Must be
+ * called by the thread of the context. */
+LOCAL_SYM void
+rb_ogl3_flush_releases
+  (struct rb_context* ctxt);
+
+/* Create the share group of `ctxt' before it is used by several threads. */
+LOCAL_SYM int
+rb_ogl3_setup_share_group
+  (struct rb_context* ctxt);
+
+/* Add `member' to the share group of `ctxt'. */
+LOCAL_SYM void
+rb_ogl3_join_share_group
+  (struct rb_context* ctxt,
+   struct rb_context* member);
+
+/* Return the context of the share group of `ctxt' that is used by the calling
+ * thread, i.e. the context that runs the release of a shared object. */
+LOCAL_SYM struct rb_context*
+rb_ogl3_current_context
+  (struct rb_context* ctxt);
+
+/* Notify the contexts of the share group of `ctxt' that a shared driver
+ * object was deleted and that its name may be thus reused. */
+LOCAL_SYM void
+rb_ogl3_signal_delete
+  (struct rb_context* ctxt);
+
+/* Reset the buffer and texture names of the state cache, unbinding the
+ * buffers from the targets that are not part of the vertex arrays. */
+LOCAL_SYM void
+rb_ogl3_invalidate_state_cache
+  (struct rb_context* ctxt);
+
+/* Invalidate the state cache of `ctxt' if shared objects were deleted since
+ * its last check. Must be called by the thread of the context before it
+ * relies on the cached buffer or texture names. */
+static FINLINE void
+rb_ogl3_sync_state_cache(struct rb_context* ctxt)
+{
+  int count = 0;
+  ASSERT(ctxt);
+
+  if(!ctxt->group)
+    return;
+  count = __atomic_load_n(&ctxt->group->delete_count, __ATOMIC_ACQUIRE);
+  if(count != ctxt->group_delete_count) {
+    ctxt->group_delete_count = count;
+    rb_ogl3_invalidate_state_cache(ctxt);
+  }
+}
+
+LOCAL_SYM void
+rb_ogl3_release_headless
+  (struct rb_ogl3_headless* headless);
+
+/* Enable the program binary cache if the RB_OGL3_PROGRAM_CACHE environment
+ * variable names its directory and if the driver supports the program
+ * binaries. */
+LOCAL_SYM int
+rb_ogl3_setup_program_cache
+  (struct rb_context* ctxt);
+
+LOCAL_SYM void
+rb_ogl3_release_program_cache
+  (struct rb_context* ctxt);
+
 #endif /* RB_OGL3_CONTEXT_H */
 
@@ -0,0 +1,129 @@
+#include "ogl3/rb_ogl3.h"
+#include "ogl3/rb_ogl3_context.h"
+#include "rb.h"
+#include <snlsys/snlsys.h>
+#include <GL/glu.h>
+#include <stdio.h>
+
+/* Upper bound of the error flags that a driver may record simultaneously. */
+#define MAX_PENDING_ERRORS 32
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static void APIENTRY
+debug_message_callback
+  (GLenum source UNUSED,
+   GLenum type,
+   GLuint id UNUSED,
+   GLenum severity,
+   GLsizei length UNUSED,
+   const GLchar* msg,
+   const void* data UNUSED)
+{
+  /* Only report the errors. Performance hints and notifications are ignored
+   * since they are not failures of the backend. */
+  if(type == GL_DEBUG_TYPE_ERROR
+  || type == GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR
+  || severity == GL_DEBUG_SEVERITY_HIGH)
+    fprintf(stderr, "error:opengl: %s\n", msg);
+}
+
+static void
+clear_pending_errors(struct rb_context* ctxt)
+{
+  int i = 0;
+  ASSERT(ctxt);
+  for(i = 0; i < MAX_PENDING_ERRORS && ctxt->gl.GetError() != GL_NO_ERROR;++i);
+}
+
+/*******************************************************************************
+ *
+ * Error check functions.
+ *
+ ******************************************************************************/
+int
+rb_error_check(struct rb_context* ctxt, const struct rb_error_check_desc* desc)
+{
+  unsigned int sampling_period = 0;
+
+  if(!ctxt || !desc)
+    return -1;
+
+  switch(desc->mode) {
+    case RB_ERROR_CHECK_NONE:
+      sampling_period = 0;
+      break;
+    case RB_ERROR_CHECK_SAMPLED:
+      if(desc->sampling_period == 0)
+        return -1;
+      sampling_period = desc->sampling_period;
+      break;
+    case RB_ERROR_CHECK_CALLBACK:
+      if(!ctxt->ext.KHR_debug)
+        return -1;
+      sampling_period = 0;
+      break;
+    case RB_ERROR_CHECK_STRICT:
+      sampling_period = 1;
+      break;
+    default:
+      return -1;
+  }
+#ifdef NDEBUG
+  /* The OGL macro does not poll the errors in release. */
+  if(sampling_period != 0)
+    return -1;
+#endif
+
+  /* Discard the errors raised before the switch in order to not report them
+   * on a wrong call. */
+  clear_pending_errors(ctxt);
+
+  if(desc->mode == RB_ERROR_CHECK_CALLBACK) {
+    OGL(ctxt, Enable(GL_DEBUG_OUTPUT));
+    OGL(ctxt, DebugMessageCallback(debug_message_callback, NULL));
+  } else if(ctxt->error_check.mode == RB_ERROR_CHECK_CALLBACK) {
+    OGL(ctxt, DebugMessageCallback(NULL, NULL));
+    OGL(ctxt, Disable(GL_DEBUG_OUTPUT));
+  }
+  ctxt->error_state.sampling_period = sampling_period;
+  ctxt->error_state.call_count = 0;
+  ctxt->error_check = *desc;
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+void
+rb_ogl3_check_error(struct rb_context* ctxt, const char* call)
+{
+  const GLenum gl_error = ctxt->gl.GetError();
+  if(gl_error != GL_NO_ERROR) {
+    if(ctxt->error_state.sampling_period > 1) {
+      fprintf(stderr, "error:opengl: %s (detected by %s in the last %u calls)\n",
+        gluErrorString(gl_error), call, ctxt->error_state.sampling_period);
+    } else {
+      fprintf(stderr, "error:opengl: %s (%s)\n", gluErrorString(gl_error), call);
+    }
+    ASSERT(gl_error == GL_NO_ERROR);
+  }
+}
+
+void
+rb_ogl3_sample_error(struct rb_context* ctxt, const char* call)
+{
+  ASSERT(ctxt && call);
+  if(ctxt->error_state.sampling_period != 0
+  && ++ctxt->error_state.call_count >= ctxt->error_state.sampling_period) {
+    ctxt->error_state.call_count = 0;
+    rb_ogl3_check_error(ctxt, call);
+  }
+}
+
+#undef MAX_PENDING_ERRORS
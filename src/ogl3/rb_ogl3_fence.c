@@ -0,0 +1,119 @@
+#include "ogl3/rb_ogl3.h"
+#include "ogl3/rb_ogl3_context.h"
+#include "rb.h"
+#include <snlsys/snlsys.h>
+#include <pthread.h>
+
+/* The GL sync objects are shared by the contexts of a share group. The fence
+ * may be thus waited for by a context sharing the objects of its own one. */
+struct rb_fence {
+  struct rb_ogl3_ref ref;
+  struct rb_context* ctxt;
+  GLsync sync;
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static void
+release_fence(struct rb_ogl3_ref* ref)
+{
+  struct rb_fence* fence = NULL;
+  struct rb_context* ctxt = NULL;
+  struct rb_context* current = NULL;
+  ASSERT(ref);
+
+  fence = CONTAINER_OF(ref, struct rb_fence, ref);
+  ctxt = fence->ctxt;
+  /* The fence may be released by another context of its share group. */
+  current = rb_ogl3_current_context(ctxt);
+  OGL(current, DeleteSync(fence->sync));
+  rb_ogl3_free_object(ctxt, RB_OBJECT_FENCE, fence);
+  RB(context_ref_put(ctxt));
+}
+
+/*******************************************************************************
+ *
+ * Fence functions.
+ *
+ ******************************************************************************/
+int
+rb_create_fence(struct rb_context* ctxt, struct rb_fence** out_fence)
+{
+  struct rb_fence* fence = NULL;
+  GLsync sync = NULL;
+
+  if(!ctxt || !out_fence)
+    return -1;
+  /* The GL context is only current onto the thread of the context. */
+  if(!pthread_equal(pthread_self(), ctxt->thread))
+    return -1;
+
+  fence = rb_ogl3_alloc_object(ctxt, RB_OBJECT_FENCE, sizeof(struct rb_fence));
+  if(!fence)
+    return -1;
+  OGL_ASSIGN(ctxt, sync, FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+  if(!sync) {
+    rb_ogl3_free_object(ctxt, RB_OBJECT_FENCE, fence);
+    return -1;
+  }
+  /* Submit the fence so that the other contexts may wait for it. */
+  OGL(ctxt, Flush());
+  rb_ogl3_ref_init(&fence->ref, release_fence);
+  fence->ref.is_shared = 1;
+  RB(context_ref_get(ctxt));
+  fence->ctxt = ctxt;
+  fence->sync = sync;
+  *out_fence = fence;
+  return 0;
+}
+
+int
+rb_fence_ref_get(struct rb_fence* fence)
+{
+  if(!fence)
+    return -1;
+  rb_ogl3_ref_get(&fence->ref);
+  return 0;
+}
+
+int
+rb_fence_ref_put(struct rb_fence* fence)
+{
+  if(!fence)
+    return -1;
+  rb_ogl3_ref_put(fence->ctxt, &fence->ref);
+  return 0;
+}
+
+int
+rb_wait_fence(struct rb_context* ctxt, struct rb_fence* fence)
+{
+  if(!ctxt || !fence)
+    return -1;
+  if(!pthread_equal(pthread_self(), ctxt->thread))
+    return -1;
+  OGL(ctxt, WaitSync(fence->sync, 0, GL_TIMEOUT_IGNORED));
+  return 0;
+}
+
+int
+rb_poll_fence
+  (struct rb_context* ctxt,
+   struct rb_fence* fence,
+   int* is_signaled)
+{
+  GLenum status = GL_WAIT_FAILED;
+
+  if(!ctxt || !fence || !is_signaled)
+    return -1;
+  if(!pthread_equal(pthread_self(), ctxt->thread))
+    return -1;
+  OGL_ASSIGN(ctxt, status, ClientWaitSync(fence->sync, 0, 0));
+  if(status == GL_WAIT_FAILED)
+    return -1;
+  *is_signaled = status != GL_TIMEOUT_EXPIRED;
+  return 0;
+}
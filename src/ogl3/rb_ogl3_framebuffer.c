@@ -7,6 +7,7 @@
 #include <snlsys/snlsys.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <string.h>
 
 struct ogl3_render_target_desc {
@@ -16,12 +17,13 @@ struct ogl3_render_target_desc {
 };
 
 struct rb_framebuffer {
-  struct ref ref;
+  struct rb_ogl3_ref ref;
   struct rb_framebuffer_desc desc;
   struct rb_context* ctxt;
   GLuint name;
   struct rb_render_target depth_stencil;
-  struct rb_render_target render_target_list[];
+  /* Fixed size in order to allocate the framebuffers from a slab. */
+  struct rb_render_target render_target_list[RB_OGL3_MAX_COLOR_ATTACHMENTS];
 };
 
 /*******************************************************************************
@@ -84,7 +86,7 @@ attach_tex2d
   }
   if(!tex2d) {
     release_render_target_resource(rt);
-    OGL(FramebufferTexture2D
+    OGL(buffer->ctxt, FramebufferTexture2D
       (GL_FRAMEBUFFER, ogl3_attachment, GL_TEXTURE_2D, 0, (GLint)mip));
   } else {
     if(tex2d->mip_count < mip
@@ -94,7 +96,7 @@ attach_tex2d
     }
     release_render_target_resource(rt);
     RB(tex2d_ref_get(tex2d));
-    OGL(FramebufferTexture2D
+    OGL(buffer->ctxt, FramebufferTexture2D
       (GL_FRAMEBUFFER, ogl3_attachment, GL_TEXTURE_2D, tex2d->name,(GLint)mip));
   }
   memcpy(rt, render_target, sizeof(struct rb_render_target));
@@ -157,7 +159,7 @@ get_ogl3_render_target_desc
 }
 
 static void
-release_framebuffer(struct ref* ref)
+release_framebuffer(struct rb_ogl3_ref* ref)
 {
   struct rb_context* ctxt  = NULL;
   struct rb_framebuffer* buffer = NULL;
@@ -165,15 +167,15 @@ release_framebuffer(struct ref* ref)
   ASSERT(ref);
 
   buffer = CONTAINER_OF(ref, struct rb_framebuffer, ref);
-  OGL(DeleteFramebuffers(1, &buffer->name));
+  ctxt = buffer->ctxt;
+  OGL(ctxt, DeleteFramebuffers(1, &buffer->name));
 
   release_render_target_resource(&buffer->depth_stencil);
   for(i = 0; i < buffer->desc.buffer_count; ++i) {
     release_render_target_resource(buffer->render_target_list + i);
   }
 
-  ctxt = buffer->ctxt;
-  MEM_FREE(ctxt->allocator, buffer);
+  rb_ogl3_free_object(ctxt, RB_OBJECT_FRAMEBUFFER, buffer);
   RB(context_ref_put(ctxt));
 }
 
@@ -199,16 +201,14 @@ rb_create_framebuffer
   if(desc->sample_count > 1)
     goto error;
 
-  buffer = MEM_CALLOC
-    (ctxt->allocator, 1,
-     sizeof(struct rb_framebuffer)
-     + sizeof(struct rb_render_target) * desc->buffer_count);
+  buffer = rb_ogl3_alloc_object
+    (ctxt, RB_OBJECT_FRAMEBUFFER, sizeof(struct rb_framebuffer));
   if(!buffer)
     goto error;
-  ref_init(&buffer->ref);
+  rb_ogl3_ref_init(&buffer->ref, release_framebuffer);
   RB(context_ref_get(ctxt));
   buffer->ctxt = ctxt;
-  OGL(GenFramebuffers(1, &buffer->name));
+  OGL(ctxt, GenFramebuffers(1, &buffer->name));
   memcpy(&buffer->desc, desc, sizeof(struct rb_framebuffer_desc));
 
 exit:
@@ -229,7 +229,7 @@ rb_framebuffer_ref_get(struct rb_framebuffer* buffer)
 {
   if(UNLIKELY(!buffer))
     return -1;
-  ref_get(&buffer->ref);
+  rb_ogl3_ref_get(&buffer->ref);
   return 0;
 }
 
@@ -238,7 +238,7 @@ rb_framebuffer_ref_put(struct rb_framebuffer* buffer)
 {
   if(UNLIKELY(!buffer))
     return -1;
-  ref_put(&buffer->ref, release_framebuffer);
+  rb_ogl3_ref_put(buffer->ctxt, &buffer->ref);
   return 0;
 }
 
@@ -250,7 +250,8 @@ rb_bind_framebuffer
   if(UNLIKELY(!ctxt))
     return -1;
   ctxt->state_cache.framebuffer_binding = buffer ? buffer->name : 0;
-  OGL(BindFramebuffer(GL_FRAMEBUFFER, ctxt->state_cache.framebuffer_binding));
+  OGL(ctxt, BindFramebuffer
+    (GL_FRAMEBUFFER, ctxt->state_cache.framebuffer_binding));
   return 0;
 }
 
@@ -272,7 +273,7 @@ rb_framebuffer_render_targets
   || count > buffer->desc.buffer_count))
     goto error;
 
-  OGL(BindFramebuffer(GL_FRAMEBUFFER, buffer->name));
+  OGL(buffer->ctxt, BindFramebuffer(GL_FRAMEBUFFER, buffer->name));
   is_bound = true;
 
   if(depth_stencil)
@@ -282,7 +283,7 @@ rb_framebuffer_render_targets
     attach_render_target(buffer, (int)i, render_target_list+i);
   }
 
-  status = OGL(CheckFramebufferStatus(GL_FRAMEBUFFER));
+  OGL_ASSIGN(buffer->ctxt, status, CheckFramebufferStatus(GL_FRAMEBUFFER));
   if(status != GL_FRAMEBUFFER_COMPLETE) {
     #ifndef NDEBUG
     fprintf(stderr, "framebuffer:status error: ");
@@ -321,7 +322,7 @@ rb_framebuffer_render_targets
 
 exit:
   if(is_bound) {
-    OGL(BindFramebuffer
+    OGL(buffer->ctxt, BindFramebuffer
       (GL_FRAMEBUFFER, buffer->ctxt->state_cache.framebuffer_binding));
   }
   return err;
@@ -352,9 +353,9 @@ rb_read_back_framebuffer
   || (unsigned int)rt_id >= buffer->desc.buffer_count))
     goto error;
 
-  /* Map the (x, y) coordinates from 'upper left' origin to OpenGL convention
-   * (bottom left) */
-  y = buffer->desc.height < y ? 0 : buffer->desc.height - y;
+  /* Map the (x, y) coordinates of the upper left corner of the read region
+   * from 'upper left' origin to OpenGL convention (bottom left) */
+  y = buffer->desc.height < y + height ? 0 : buffer->desc.height - y - height;
 
   render_target =
     rt_id >= 0 ? buffer->render_target_list + rt_id : &buffer->depth_stencil;
@@ -364,14 +365,14 @@ rb_read_back_framebuffer
     *read_size = width * height * rb_ogl3_sizeof_pixel(desc.format, desc.type);
   }
   if(read_data) {
-    OGL(BindFramebuffer(GL_FRAMEBUFFER, buffer->name));
+    OGL(buffer->ctxt, BindFramebuffer(GL_FRAMEBUFFER, buffer->name));
     if(rt_id >= 0)
-      OGL(ReadBuffer((GLenum)(GL_COLOR_ATTACHMENT0 + rt_id)));
+      OGL(buffer->ctxt, ReadBuffer((GLenum)(GL_COLOR_ATTACHMENT0 + rt_id)));
 
-    OGL(ReadPixels
+    OGL(buffer->ctxt, ReadPixels
       ((GLint)x, (GLint)y, (GLint)width, (GLint)height, 
        desc.format, desc.type, read_data));
-    OGL(BindFramebuffer
+    OGL(buffer->ctxt, BindFramebuffer
       (GL_FRAMEBUFFER, buffer->ctxt->state_cache.framebuffer_binding));
   }
 
@@ -399,7 +400,7 @@ rb_clear_framebuffer_render_targets
   if(UNLIKELY(!buffer))
     goto error;
 
-  OGL(BindFramebuffer(GL_FRAMEBUFFER, buffer->name));
+  OGL(buffer->ctxt, BindFramebuffer(GL_FRAMEBUFFER, buffer->name));
 
   /* Clear the color render targets. */
   if((clear_flag & RB_CLEAR_COLOR_BIT) != 0) {
@@ -414,11 +415,14 @@ rb_clear_framebuffer_render_targets
 
       get_ogl3_render_target_desc(&buffer->render_target_list[rt_id], &rt_desc);
       if(rt_desc.type == GL_UNSIGNED_INT) {
-        OGL(ClearBufferuiv(GL_COLOR, rt_id, color_vals[i].val.rgba_ui32));
+        OGL(buffer->ctxt, ClearBufferuiv
+          (GL_COLOR, rt_id, color_vals[i].val.rgba_ui32));
       } else if(rt_desc.type == GL_INT) {
-        OGL(ClearBufferiv(GL_COLOR, rt_id, color_vals[i].val.rgba_i32));
+        OGL(buffer->ctxt, ClearBufferiv
+          (GL_COLOR, rt_id, color_vals[i].val.rgba_i32));
       } else { /* float type */
-        OGL(ClearBufferfv(GL_COLOR, rt_id, color_vals[i].val.rgba_f));
+        OGL(buffer->ctxt, ClearBufferfv
+          (GL_COLOR, rt_id, color_vals[i].val.rgba_f));
       }
     }
   }
@@ -431,21 +435,22 @@ rb_clear_framebuffer_render_targets
       GLfloat ogl3_depth_val = depth_val;
       if(UNLIKELY(rt_desc.format != GL_DEPTH_COMPONENT))
         goto error;
-      OGL(ClearBufferfv(GL_DEPTH, 0, &ogl3_depth_val));
+      OGL(buffer->ctxt, ClearBufferfv(GL_DEPTH, 0, &ogl3_depth_val));
     } else if(depth_stencil_flag == RB_CLEAR_STENCIL_BIT) {
       GLint ogl3_stencil_val = stencil_val;
       if(UNLIKELY(rt_desc.format != GL_DEPTH_STENCIL))
         goto error;
-      OGL(ClearBufferiv(GL_STENCIL, 0, &ogl3_stencil_val));
+      OGL(buffer->ctxt, ClearBufferiv(GL_STENCIL, 0, &ogl3_stencil_val));
     } else { /* depth_stencil_flag == RB_CLEAR_DEPTH_BIT|RB_CLEAR_STENCIL_BIT */
       if(UNLIKELY(rt_desc.format != GL_DEPTH_STENCIL))
         goto error;
-      OGL(ClearBufferfi(GL_DEPTH_STENCIL, 0, depth_val, (GLint)stencil_val));
+      OGL(buffer->ctxt, ClearBufferfi
+        (GL_DEPTH_STENCIL, 0, depth_val, (GLint)stencil_val));
     }
   }
 
 exit:
-  OGL(BindFramebuffer
+  OGL(buffer->ctxt, BindFramebuffer
     (GL_FRAMEBUFFER, buffer->ctxt->state_cache.framebuffer_binding));
   return err;
 error:
@@ -0,0 +1,9 @@
+/*******************************************************************************
+ *
+ * Optional OpenGL extensions. Their support is checked at the context creation
+ * and stored in the `ext' field of the rb_context.
+ *
+ ******************************************************************************/
+GL_EXT(ARB_get_program_binary)
+GL_EXT(KHR_debug)
+GL_EXT(KHR_parallel_shader_compile)
@@ -0,0 +1,21 @@
+/*******************************************************************************
+ *
+ * Optional entry points. They are resolved only if their extension is
+ * supported by the driver and must not be invoked otherwise.
+ *
+ ******************************************************************************/
+GL_EXT_FUNC(ARB_get_program_binary, void, GetProgramBinary,
+  GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat,
+  void* binary)
+
+GL_EXT_FUNC(ARB_get_program_binary, void, ProgramBinary,
+  GLuint program, GLenum binaryFormat, const void* binary, GLsizei length)
+
+GL_EXT_FUNC(ARB_get_program_binary, void, ProgramParameteri,
+  GLuint program, GLenum pname, GLint value)
+
+GL_EXT_FUNC(KHR_debug, void, DebugMessageCallback,
+  GLDEBUGPROC callback, const void* userParam)
+
+GL_EXT_FUNC(KHR_parallel_shader_compile, void, MaxShaderCompilerThreadsKHR,
+  GLuint count)
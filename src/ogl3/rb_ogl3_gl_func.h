@@ -136,6 +136,17 @@ GL_FUNC(void, GetActiveUniform,
   GLuint program, GLuint index, GLsizei bufSize, GLsizei *length, GLint *size,
   GLenum *type, GLchar *name)
 
+GL_FUNC(void, GetActiveUniformsiv,
+  GLuint program, GLsizei uniformCount, const GLuint *uniformIndices,
+  GLenum pname, GLint *params)
+
+GL_FUNC(void, GetActiveUniformBlockiv,
+  GLuint program, GLuint uniformBlockIndex, GLenum pname, GLint *params)
+
+GL_FUNC(void, GetActiveUniformBlockName,
+  GLuint program, GLuint uniformBlockIndex, GLsizei bufSize, GLsizei *length,
+  GLchar *uniformBlockName)
+
 GL_FUNC(void, GetProgramInfoLog,
   GLuint program, GLsizei bufSize, GLsizei *length, GLchar *infoLog)
 
@@ -201,6 +212,10 @@ GL_FUNC(void, DrawElements,
 GL_FUNC(void, DrawArrays,
   GLenum mode, GLint first, GLsizei count)
 
+GL_FUNC(void, MultiDrawElementsBaseVertex,
+  GLenum mode, const GLsizei *count, GLenum type, const GLvoid *const *indices,
+  GLsizei drawcount, const GLint *basevertex)
+
 GL_FUNC(void, EnableVertexAttribArray,
   GLuint index)
 
@@ -240,6 +255,9 @@ GL_FUNC(void, DeleteTextures,
 GL_FUNC(void, BindTexture,
   GLenum target, GLuint texture)
 
+GL_FUNC(GLboolean, IsTexture,
+  GLuint texture)
+
 GL_FUNC(void, TexImage2D,
   GLenum target, GLint level, GLint internalFormat, GLsizei width,
   GLsizei height, GLint border, GLenum format, GLenum type,
@@ -302,6 +320,23 @@ GL_FUNC(void, SamplerParameteri,
 GL_FUNC(void, SamplerParameterf,
   GLuint sampler, GLenum pname, GLfloat param)
 
+/*******************************************************************************
+ *
+ * Sync
+ *
+ ******************************************************************************/
+GL_FUNC(GLenum, ClientWaitSync,
+  GLsync sync, GLbitfield flags, GLuint64 timeout)
+
+GL_FUNC(void, DeleteSync,
+  GLsync sync)
+
+GL_FUNC(GLsync, FenceSync,
+  GLenum condition, GLbitfield flags)
+
+GL_FUNC(void, WaitSync,
+  GLsync sync, GLbitfield flags, GLuint64 timeout)
+
 /*******************************************************************************
  *
  * Miscellaneous
@@ -335,6 +370,12 @@ GL_FUNC(GLenum, GetError,
 GL_FUNC(void, GetIntegerv,
   GLenum pname, GLint *params)
 
+GL_FUNC(const GLubyte*, GetString,
+  GLenum name)
+
+GL_FUNC(const GLubyte*, GetStringi,
+  GLenum name, GLuint index)
+
 GL_FUNC(void, Viewport,
   GLint x, GLint y, GLsizei width, GLsizei height)
 
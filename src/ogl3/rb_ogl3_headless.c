@@ -0,0 +1,264 @@
+#include "ogl3/rb_ogl3_context.h"
+#include "rb.h"
+#include <snlsys/mem_allocator.h>
+#include <snlsys/snlsys.h>
+
+#ifdef RB_OGL3_USE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+/* Offscreen driver context owned by a rb_context. */
+struct rb_ogl3_headless {
+  EGLDisplay display;
+  EGLConfig config;
+  EGLContext context;
+  EGLSurface surface;
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static EGLDisplay
+get_display(void)
+{
+  PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = NULL;
+  EGLDisplay display = EGL_NO_DISPLAY;
+
+  /* Favor the Mesa surfaceless platform that does not require any display
+   * server. */
+  get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+    eglGetProcAddress("eglGetPlatformDisplayEXT");
+  if(get_platform_display) {
+    display = get_platform_display
+      (EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+  }
+  if(display == EGL_NO_DISPLAY)
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  return display;
+}
+
+/* Create the driver context and make it current. If `share' is not NULL, the
+ * driver context shares the objects of `share' and uses its configuration. */
+static int
+setup_headless
+  (struct rb_ogl3_headless* headless,
+   const struct rb_headless_desc* desc,
+   const struct rb_ogl3_headless* share)
+{
+  const EGLint config_attribs[] = {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8,
+    EGL_GREEN_SIZE, 8,
+    EGL_BLUE_SIZE, 8,
+    EGL_ALPHA_SIZE, 8,
+    EGL_DEPTH_SIZE, 24,
+    EGL_STENCIL_SIZE, 8,
+    EGL_NONE
+  };
+  const EGLint context_attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3,
+    EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+  };
+  const EGLint surface_attribs[] = {
+    EGL_WIDTH, (EGLint)desc->width,
+    EGL_HEIGHT, (EGLint)desc->height,
+    EGL_NONE
+  };
+  EGLint nb_configs = 0;
+  ASSERT(headless && desc);
+
+  if(share) {
+    headless->display = share->display;
+    headless->config = share->config;
+    if(!eglBindAPI(EGL_OPENGL_API))
+      return -1;
+  } else {
+    headless->display = get_display();
+    if(headless->display == EGL_NO_DISPLAY
+    || !eglInitialize(headless->display, NULL, NULL)
+    || !eglBindAPI(EGL_OPENGL_API))
+      return -1;
+
+    if(!eglChooseConfig
+        (headless->display, config_attribs, &headless->config, 1, &nb_configs)
+    || nb_configs == 0)
+      return -1;
+  }
+
+  headless->context = eglCreateContext
+    (headless->display, headless->config,
+     share ? share->context : EGL_NO_CONTEXT, context_attribs);
+  if(headless->context == EGL_NO_CONTEXT)
+    return -1;
+
+  /* The pbuffer is the default framebuffer of the context. */
+  headless->surface = eglCreatePbufferSurface
+    (headless->display, headless->config, surface_attribs);
+  if(headless->surface == EGL_NO_SURFACE)
+    return -1;
+
+  if(!eglMakeCurrent(headless->display, headless->surface, headless->surface,
+     headless->context))
+    return -1;
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Render backend headless functions.
+ *
+ ******************************************************************************/
+int
+rb_create_headless_context
+  (struct mem_allocator* specific_allocator,
+   const struct rb_headless_desc* desc,
+   struct rb_context** out_ctxt)
+{
+  struct mem_allocator* allocator = NULL;
+  struct rb_ogl3_headless* headless = NULL;
+  struct rb_context* ctxt = NULL;
+  int err = 0;
+
+  if(!desc || !desc->width || !desc->height || !out_ctxt)
+    goto error;
+
+  allocator = specific_allocator ? specific_allocator : &mem_default_allocator;
+  headless = MEM_CALLOC(allocator, 1, sizeof(struct rb_ogl3_headless));
+  if(!headless)
+    goto error;
+  headless->display = EGL_NO_DISPLAY;
+  headless->context = EGL_NO_CONTEXT;
+  headless->surface = EGL_NO_SURFACE;
+  if(setup_headless(headless, desc, NULL) != 0)
+    goto error;
+
+  if(rb_create_context(allocator, &ctxt) != 0)
+    goto error;
+  ctxt->headless = headless;
+  headless = NULL;
+  /* The group is created here since the loaders are created by other
+   * threads. */
+  if(rb_ogl3_setup_share_group(ctxt) != 0) {
+    RB(context_ref_put(ctxt));
+    ctxt = NULL;
+    goto error;
+  }
+
+exit:
+  if(ctxt)
+    *out_ctxt = ctxt;
+  return err;
+
+error:
+  if(headless) {
+    rb_ogl3_release_headless(headless);
+    MEM_FREE(allocator, headless);
+  }
+  err = -1;
+  goto exit;
+}
+
+int
+rb_create_loader_context
+  (struct rb_context* ctxt,
+   struct rb_context** out_loader)
+{
+  /* The loader does not render: its default framebuffer is a placeholder. */
+  const struct rb_headless_desc desc = { 1, 1 };
+  struct rb_ogl3_headless* headless = NULL;
+  struct rb_context* loader = NULL;
+  int err = 0;
+
+  /* The driver context of the caller cannot be shared since it is unknown. */
+  if(!ctxt || !ctxt->headless || !out_loader)
+    goto error;
+
+  headless = MEM_CALLOC(ctxt->allocator, 1, sizeof(struct rb_ogl3_headless));
+  if(!headless)
+    goto error;
+  headless->display = EGL_NO_DISPLAY;
+  headless->context = EGL_NO_CONTEXT;
+  headless->surface = EGL_NO_SURFACE;
+  if(setup_headless(headless, &desc, ctxt->headless) != 0)
+    goto error;
+
+  if(rb_create_context(ctxt->allocator, &loader) != 0)
+    goto error;
+  loader->headless = headless;
+  headless = NULL;
+  /* The shared objects are released by the thread of any context of the
+   * group, e.g. by the render thread once the loader thread is done. */
+  rb_ogl3_join_share_group(ctxt, loader);
+
+exit:
+  if(loader)
+    *out_loader = loader;
+  return err;
+
+error:
+  if(headless) {
+    rb_ogl3_release_headless(headless);
+    MEM_FREE(ctxt->allocator, headless);
+  }
+  err = -1;
+  goto exit;
+}
+
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+void
+rb_ogl3_release_headless(struct rb_ogl3_headless* headless)
+{
+  ASSERT(headless);
+
+  if(headless->display == EGL_NO_DISPLAY)
+    return;
+  if(eglGetCurrentContext() == headless->context) {
+    eglMakeCurrent
+      (headless->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  }
+  if(headless->surface != EGL_NO_SURFACE)
+    eglDestroySurface(headless->display, headless->surface);
+  if(headless->context != EGL_NO_CONTEXT)
+    eglDestroyContext(headless->display, headless->context);
+  /* The display is not terminated since it is shared by all the EGL clients
+   * of the process. */
+}
+
+#else /* RB_OGL3_USE_EGL */
+
+int
+rb_create_headless_context
+  (struct mem_allocator* allocator,
+   const struct rb_headless_desc* desc,
+   struct rb_context** out_ctxt)
+{
+  (void)allocator, (void)desc, (void)out_ctxt;
+  return -1; /* No offscreen context support. */
+}
+
+int
+rb_create_loader_context
+  (struct rb_context* ctxt,
+   struct rb_context** out_loader)
+{
+  (void)ctxt, (void)out_loader;
+  return -1; /* No shared offscreen context support. */
+}
+
+void
+rb_ogl3_release_headless(struct rb_ogl3_headless* headless)
+{
+  (void)headless;
+  ASSERT(0);
+}
+
+#endif /* RB_OGL3_USE_EGL */
@@ -1,10 +1,13 @@
 #include "ogl3/rb_ogl3.h"
 #include "ogl3/rb_ogl3_context.h"
 #include "rb.h"
+#include <snlsys/math.h>
 #include <snlsys/snlsys.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define MULTI_DRAW_CHUNK 64
+
 static const GLenum rb_to_ogl3_primitive_type[] = {
   [RB_LINES] = GL_LINES,
   [RB_LINE_LOOP] = GL_LINE_LOOP,
@@ -81,11 +84,44 @@ rb_draw_indexed
 {
   if(!ctxt)
     return -1;
-  OGL(DrawElements
+  OGL(ctxt, DrawElements
     (rb_to_ogl3_primitive_type[prim_type],(GLint)count, GL_UNSIGNED_INT, NULL));
   return 0;
 }
 
+int
+rb_multi_draw_indexed
+  (struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int nb_ranges,
+   const struct rb_draw_range* range_list)
+{
+  /* The ranges are converted in chunks into the arrays of the GL call. */
+  GLsizei count_list[MULTI_DRAW_CHUNK];
+  const GLvoid* offset_list[MULTI_DRAW_CHUNK];
+  GLint base_list[MULTI_DRAW_CHUNK];
+  unsigned int i = 0;
+  unsigned int j = 0;
+  unsigned int n = 0;
+
+  if(!ctxt || (nb_ranges && !range_list))
+    return -1;
+  for(i = 0; i < nb_ranges; i += n) {
+    n = MIN(nb_ranges - i, MULTI_DRAW_CHUNK);
+    for(j = 0; j < n; ++j) {
+      const struct rb_draw_range* range = range_list + i + j;
+      count_list[j] = (GLsizei)range->count;
+      offset_list[j] = (const GLvoid*)
+        ((size_t)range->first_index * sizeof(GLuint));
+      base_list[j] = (GLint)range->base_vertex;
+    }
+    OGL(ctxt, MultiDrawElementsBaseVertex
+      (rb_to_ogl3_primitive_type[prim_type], count_list, GL_UNSIGNED_INT,
+       offset_list, (GLsizei)n, base_list));
+  }
+  return 0;
+}
+
 int
 rb_draw
   (struct rb_context* ctxt,
@@ -94,7 +130,7 @@ rb_draw
 {
   if(!ctxt)
     return -1;
-  OGL(DrawArrays(rb_to_ogl3_primitive_type[prim_type], 0, (GLint)count));
+  OGL(ctxt, DrawArrays(rb_to_ogl3_primitive_type[prim_type], 0, (GLint)count));
   return 0;
 }
 
@@ -115,17 +151,17 @@ rb_clear
     if(!color)
       return -1;
     clear_flag |= GL_COLOR_BUFFER_BIT;
-    OGL(ClearColor(color[0], color[1], color[2], color[3]));
+    OGL(ctxt, ClearColor(color[0], color[1], color[2], color[3]));
   }
   if((flag & RB_CLEAR_DEPTH_BIT) != 0) {
     clear_flag |= GL_DEPTH_BUFFER_BIT;
-    OGL(ClearDepth(depth));
+    OGL(ctxt, ClearDepth(depth));
   }
   if((flag & RB_CLEAR_STENCIL_BIT) != 0) {
     clear_flag |= GL_STENCIL_BUFFER_BIT;
-    OGL(ClearStencil(stencil));
+    OGL(ctxt, ClearStencil(stencil));
   }
-  OGL(Clear(clear_flag));
+  OGL(ctxt, Clear(clear_flag));
 
   return 0;
 }
@@ -136,7 +172,42 @@ rb_flush(struct rb_context* ctxt)
   if(!ctxt)
     return -1;
 
-  OGL(Flush());
+  rb_ogl3_flush_releases(ctxt);
+  OGL(ctxt, Flush());
+  return 0;
+}
+
+int
+rb_begin_frame(struct rb_context* ctxt)
+{
+  if(!ctxt || ctxt->is_in_frame)
+    return -1;
+  ctxt->is_in_frame = 1;
+  return 0;
+}
+
+int
+rb_end_frame(struct rb_context* ctxt)
+{
+  if(!ctxt || !ctxt->is_in_frame)
+    return -1;
+  rb_ogl3_flush_releases(ctxt);
+  rb_reset_arena(&ctxt->frame);
+  ctxt->is_in_frame = 0;
+  return 0;
+}
+
+int
+rb_frame_alloc(struct rb_context* ctxt, size_t size, void** out_mem)
+{
+  void* mem = NULL;
+
+  if(!ctxt || !size || !out_mem || !ctxt->is_in_frame)
+    return -1;
+  mem = rb_arena_alloc(&ctxt->frame, size);
+  if(!mem)
+    return -1;
+  *out_mem = mem;
   return 0;
 }
 
@@ -146,8 +217,8 @@ rb_viewport(struct rb_context* ctxt, const struct rb_viewport_desc* vp)
   if(!ctxt || !vp)
     return -1;
 
-  OGL(Viewport(vp->x, vp->y, vp->width, vp->height));
-  OGL(DepthRange(vp->min_depth, vp->max_depth));
+  OGL(ctxt, Viewport(vp->x, vp->y, vp->width, vp->height));
+  OGL(ctxt, DepthRange(vp->min_depth, vp->max_depth));
   return 0;
 }
 
@@ -158,15 +229,15 @@ rb_blend(struct rb_context* ctxt, const struct rb_blend_desc* blend)
     return -1;
 
   if(blend->enable == 0) {
-    OGL(Disable(GL_BLEND));
+    OGL(ctxt, Disable(GL_BLEND));
   } else {
-    OGL(Enable(GL_BLEND));
-    OGL(BlendFuncSeparate
+    OGL(ctxt, Enable(GL_BLEND));
+    OGL(ctxt, BlendFuncSeparate
         (rb_to_ogl3_blend_func[blend->src_blend_RGB],
          rb_to_ogl3_blend_func[blend->dst_blend_RGB],
          rb_to_ogl3_blend_func[blend->src_blend_Alpha],
          rb_to_ogl3_blend_func[blend->dst_blend_Alpha]));
-    OGL(BlendEquationSeparate
+    OGL(ctxt, BlendEquationSeparate
         (rb_to_ogl3_blend_op[blend->blend_op_RGB],
          rb_to_ogl3_blend_op[blend->blend_op_Alpha]));
   }
@@ -180,36 +251,36 @@ rb_depth_stencil
   if(!ctxt || !desc)
     return -1;
 
-  OGL(DepthMask(desc->enable_depth_write ? GL_TRUE : GL_FALSE));
+  OGL(ctxt, DepthMask(desc->enable_depth_write ? GL_TRUE : GL_FALSE));
   if(desc->enable_depth_test == 0) {
-    OGL(Disable(GL_DEPTH_TEST));
+    OGL(ctxt, Disable(GL_DEPTH_TEST));
   } else {
-    OGL(Enable(GL_DEPTH_TEST));
-    OGL(DepthFunc(rb_to_ogl3_comparison[desc->depth_func]));
+    OGL(ctxt, Enable(GL_DEPTH_TEST));
+    OGL(ctxt, DepthFunc(rb_to_ogl3_comparison[desc->depth_func]));
   }
 
-  OGL(StencilMaskSeparate(GL_FRONT, desc->front_face_op.write_mask));
-  OGL(StencilMaskSeparate(GL_BACK, desc->back_face_op.write_mask));
+  OGL(ctxt, StencilMaskSeparate(GL_FRONT, desc->front_face_op.write_mask));
+  OGL(ctxt, StencilMaskSeparate(GL_BACK, desc->back_face_op.write_mask));
   if(desc->enable_stencil_test == 0) {
-    OGL(Disable(GL_STENCIL_TEST));
+    OGL(ctxt, Disable(GL_STENCIL_TEST));
   } else {
-    OGL(Enable(GL_STENCIL_TEST));
-    OGL(StencilOpSeparate
+    OGL(ctxt, Enable(GL_STENCIL_TEST));
+    OGL(ctxt, StencilOpSeparate
         (GL_FRONT,
          rb_to_ogl3_stencil_op[desc->front_face_op.stencil_fail],
          rb_to_ogl3_stencil_op[desc->front_face_op.depth_fail],
          rb_to_ogl3_stencil_op[desc->front_face_op.depth_pass]));
-    OGL(StencilOpSeparate
+    OGL(ctxt, StencilOpSeparate
         (GL_BACK,
          rb_to_ogl3_stencil_op[desc->back_face_op.stencil_fail],
          rb_to_ogl3_stencil_op[desc->back_face_op.depth_fail],
          rb_to_ogl3_stencil_op[desc->back_face_op.depth_pass]));
-    OGL(StencilFuncSeparate
+    OGL(ctxt, StencilFuncSeparate
         (GL_FRONT,
          rb_to_ogl3_comparison[desc->front_face_op.stencil_func],
          desc->stencil_ref,
          0xFFFFFFFF));
-    OGL(StencilFuncSeparate
+    OGL(ctxt, StencilFuncSeparate
         (GL_BACK,
          rb_to_ogl3_comparison[desc->back_face_op.stencil_func],
          desc->stencil_ref,
@@ -225,14 +296,15 @@ rb_rasterizer(struct rb_context* ctxt, const struct rb_rasterizer_desc* desc)
     return -1;
 
   if(desc->cull_mode == RB_CULL_NONE) {
-    OGL(Disable(GL_CULL_FACE));
+    OGL(ctxt, Disable(GL_CULL_FACE));
   } else {
-    OGL(Enable(GL_CULL_FACE));
-    OGL(CullFace(rb_to_ogl3_cull_mode[desc->cull_mode]));
+    OGL(ctxt, Enable(GL_CULL_FACE));
+    OGL(ctxt, CullFace(rb_to_ogl3_cull_mode[desc->cull_mode]));
   }
 
-  OGL(PolygonMode(GL_FRONT_AND_BACK, rb_to_ogl3_fill_mode[desc->fill_mode]));
-  OGL(FrontFace(rb_to_ogl3_face_orientation[desc->front_facing]));
+  OGL(ctxt, PolygonMode
+    (GL_FRONT_AND_BACK, rb_to_ogl3_fill_mode[desc->fill_mode]));
+  OGL(ctxt, FrontFace(rb_to_ogl3_face_orientation[desc->front_facing]));
   return 0;
 }
 
@@ -245,3 +317,18 @@ rb_get_config(struct rb_context* ctxt, struct rb_config* config)
   return 0;
 }
 
+int
+rb_get_pool_stats(struct rb_context* ctxt, struct rb_pool_stats* stats)
+{
+  int i = 0;
+
+  if(!ctxt || !stats)
+    return -1;
+  for(i = 0; i < RB_OBJECT_TYPES_COUNT; ++i)
+    rb_slab_stats(ctxt->pool_list + i, stats->object_list + i);
+  stats->nb_strings = ctxt->names.nb_strings;
+  stats->string_size = ctxt->names.size;
+  stats->frame_size = ctxt->frame.size;
+  return 0;
+}
+
@@ -6,6 +6,7 @@
 #include <snlsys/list.h>
 #include <snlsys/mem_allocator.h>
 #include <snlsys/snlsys.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -14,8 +15,23 @@
  * Helper functions.
  *
  ******************************************************************************/
+static struct rb_ogl3_attachment*
+find_attachment(struct rb_program* program, struct rb_shader* shader)
+{
+  struct list_node* node = NULL;
+  ASSERT(program && shader);
+
+  LIST_FOR_EACH(node, &program->attached_shader_list) {
+    struct rb_ogl3_attachment* attachment = CONTAINER_OF
+      (node, struct rb_ogl3_attachment, node);
+    if(attachment->shader == shader)
+      return attachment;
+  }
+  return NULL;
+}
+
 static void
-release_program(struct ref* ref)
+release_program(struct rb_ogl3_ref* ref)
 {
   struct list_node* node = NULL;
   struct list_node* tmp = NULL;
@@ -30,14 +46,17 @@ release_program(struct ref* ref)
     RB(bind_program(ctxt, NULL));
 
   LIST_FOR_EACH_SAFE(node, tmp, &prog->attached_shader_list) {
-    struct rb_shader* shader = CONTAINER_OF(node, struct rb_shader, attachment);
-    RB(detach_shader(prog, shader));
+    struct rb_ogl3_attachment* attachment = CONTAINER_OF
+      (node, struct rb_ogl3_attachment, node);
+    RB(detach_shader(prog, attachment->shader));
   }
   if(prog->name != 0)
-    OGL(DeleteProgram(prog->name));
+    OGL(ctxt, DeleteProgram(prog->name));
   if(prog->log)
     MEM_FREE(ctxt->allocator, prog->log);
-  MEM_FREE(ctxt->allocator, prog);
+  if(prog->reflection)
+    rb_ogl3_reflection_ref_put(prog->reflection);
+  rb_ogl3_free_object(ctxt, RB_OBJECT_PROGRAM, prog);
   RB(context_ref_put(ctxt));
 }
 
@@ -55,17 +74,22 @@ rb_create_program(struct rb_context* ctxt, struct rb_program** out_program)
   if(!ctxt || !out_program)
     goto error;
 
-  program = MEM_CALLOC(ctxt->allocator, 1, sizeof(struct rb_program));
+  program = rb_ogl3_alloc_object
+    (ctxt, RB_OBJECT_PROGRAM, sizeof(struct rb_program));
   if(!program)
     goto error;
-  ref_init(&program->ref);
+  rb_ogl3_ref_init(&program->ref, release_program);
   list_init(&program->attached_shader_list);
   RB(context_ref_get(ctxt));
   program->ctxt = ctxt;
 
-  program->name = OGL(CreateProgram());
+  OGL_ASSIGN(ctxt, program->name, CreateProgram());
   if(program->name == 0)
     goto error;
+  if(ctxt->program_cache_path) {
+    OGL(ctxt, ProgramParameteri
+      (program->name, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+  }
 
 exit:
   if(out_program)
@@ -86,7 +110,7 @@ rb_program_ref_get(struct rb_program* program)
 {
   if(!program)
     return -1;
-  ref_get(&program->ref);
+  rb_ogl3_ref_get(&program->ref);
   return 0;
 }
 
@@ -95,18 +119,26 @@ rb_program_ref_put(struct rb_program* program)
 {
   if(!program)
     return -1;
-  ref_put(&program->ref, release_program);
+  rb_ogl3_ref_put(program->ctxt, &program->ref);
   return 0;
 }
 
 int
 rb_attach_shader(struct rb_program* program, struct rb_shader* shader)
 {
-  if(!program || !shader || !is_list_empty(&shader->attachment))
+  struct rb_ogl3_attachment* attachment = NULL;
+
+  if(!program || !shader || find_attachment(program, shader))
     return -1;
 
-  OGL(AttachShader(program->name, shader->name));
-  list_add(&program->attached_shader_list, &shader->attachment);
+  attachment = MEM_ALLOC
+    (program->ctxt->allocator, sizeof(struct rb_ogl3_attachment));
+  if(!attachment)
+    return -1;
+  OGL(program->ctxt, AttachShader(program->name, shader->name));
+  attachment->shader = shader;
+  list_add(&program->attached_shader_list, &attachment->node);
+  ++shader->nb_attachments;
   RB(shader_ref_get(shader));
   return 0;
 }
@@ -114,25 +146,16 @@ rb_attach_shader(struct rb_program* program, struct rb_shader* shader)
 int
 rb_detach_shader(struct rb_program* program, struct rb_shader* shader)
 {
-  if(!program || !shader || is_list_empty(&shader->attachment))
+  struct rb_ogl3_attachment* attachment = NULL;
+
+  if(!program || !shader || !(attachment = find_attachment(program, shader)))
     return -1;
 
-#ifndef NDEBUG
-  {
-    struct list_node* node = NULL;
-    int found = 0;
-    LIST_FOR_EACH(node, &program->attached_shader_list) {
-      if(node == &shader->attachment) {
-        found = 1;
-        break; 
-      }
-    }
-    if(!found)
-      return -1;
-  }
-#endif
-  OGL(DetachShader(program->name, shader->name));
-  list_del(&shader->attachment);
+  OGL(program->ctxt, DetachShader(program->name, shader->name));
+  list_del(&attachment->node);
+  MEM_FREE(program->ctxt->allocator, attachment);
+  ASSERT(shader->nb_attachments);
+  --shader->nb_attachments;
   RB(shader_ref_put(shader));
   return 0;
 }
@@ -140,45 +163,77 @@ rb_detach_shader(struct rb_program* program, struct rb_shader* shader)
 int
 rb_link_program(struct rb_program* program)
 {
-  int err = 0;
-  GLint status = GL_TRUE;
-
   if(!program)
-    goto error;
+    return -1;
 
-  OGL(LinkProgram(program->name));
-  OGL(GetProgramiv(program->name, GL_LINK_STATUS, &status));
-  program->is_linked = (status == GL_TRUE);
+  program->is_linked = 0;
+  program->is_link_pending = 0;
+  if(program->reflection) {
+    rb_ogl3_reflection_ref_put(program->reflection);
+    program->reflection = NULL;
+  }
 
-  if(!program->is_linked) {
-    int log_length = 0;
+  /* Link the program from its cached binary, if any, rather than from the
+   * attached shaders. */
+  if(program->ctxt->program_cache_path
+  && rb_ogl3_load_program_binary(program) == 0) {
+    program->is_linked = 1;
+    MEM_FREE(program->ctxt->allocator, program->log);
+    program->log = NULL;
+    if(rb_ogl3_setup_reflection(program) != 0) {
+      program->is_linked = 0;
+      return -1;
+    }
+    return 0;
+  }
 
-    if(program->ctxt->state_cache.current_program == program->name)
-      rb_bind_program(program->ctxt, NULL);
+  OGL(program->ctxt, LinkProgram(program->name));
+  program->is_link_pending = 1;
 
-    OGL(GetProgramiv(program->name, GL_INFO_LOG_LENGTH, &log_length));
+  /* In the asynchronous mode, the link status is not queried in order to let
+   * the driver link the program while the caller goes on. */
+  if(program->ctxt->compile.mode == RB_COMPILE_ASYNC)
+    return 0;
+  return rb_ogl3_sync_program(program);
+}
 
-    program->log = MEM_REALLOC
-      (program->ctxt->allocator, program->log, (size_t)log_length*sizeof(char));
-    if(!program->log)
-      goto error;
+int
+rb_program_is_ready(struct rb_program* program, int* out_is_ready)
+{
+  GLint is_complete = GL_TRUE;
 
-    OGL(GetProgramInfoLog(program->name, log_length, NULL, program->log));
-    err = -1;
-#ifndef NDEBUG
-    fprintf(stderr, "%s\n", program->log);
-#endif
-  } else {
-    MEM_FREE(program->ctxt->allocator, program->log);
-    program->log = NULL;
+  if(!program || !out_is_ready)
+    return -1;
+
+  /* Without the parallel compile extension, the pending link is waited for
+   * since its completion cannot be polled. */
+  if(program->is_link_pending
+  && program->ctxt->ext.KHR_parallel_shader_compile) {
+    OGL(program->ctxt, GetProgramiv
+      (program->name, GL_COMPLETION_STATUS_KHR, &is_complete));
   }
 
-exit:
-  return err;
+  *out_is_ready = is_complete == GL_TRUE;
+  if(!*out_is_ready)
+    return 0;
+  return rb_ogl3_sync_program(program);
+}
 
-error:
-  err = -1;
-  goto exit;
+int
+rb_compile_mode(struct rb_context* ctxt, const struct rb_compile_desc* desc)
+{
+  if(!ctxt || !desc)
+    return -1;
+  if(desc->mode != RB_COMPILE_SYNC && desc->mode != RB_COMPILE_ASYNC)
+    return -1;
+
+  /* 0xFFFFFFFF lets the driver choose the number of threads. */
+  if(ctxt->ext.KHR_parallel_shader_compile) {
+    OGL(ctxt, MaxShaderCompilerThreadsKHR
+      (desc->max_threads ? desc->max_threads : 0xFFFFFFFFu));
+  }
+  ctxt->compile = *desc;
+  return 0;
 }
 
 int
@@ -186,6 +241,8 @@ rb_get_program_log(struct rb_program* program, const char** out_log)
 {
   if(!program || !out_log)
     return -1;
+  /* A link failure is not an error of the log retrieval. */
+  rb_ogl3_sync_program(program);
   *out_log = program->log;
   return 0;
 }
@@ -196,11 +253,57 @@ rb_bind_program(struct rb_context* ctxt, struct rb_program* program)
   if(!ctxt)
     return -1;
 
-  if(program && !program->is_linked)
+  if(program && rb_ogl3_sync_program(program) != 0)
     return -1;
 
   ctxt->state_cache.current_program = program ? program->name : 0;
-  OGL(UseProgram(ctxt->state_cache.current_program));
+  OGL(ctxt, UseProgram(ctxt->state_cache.current_program));
   return 0;
 }
 
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+int
+rb_ogl3_sync_program(struct rb_program* prog)
+{
+  GLint status = GL_TRUE;
+  GLint log_length = 0;
+  ASSERT(prog);
+
+  if(!prog->is_link_pending)
+    return prog->is_linked ? 0 : -1;
+
+  OGL(prog->ctxt, GetProgramiv(prog->name, GL_LINK_STATUS, &status));
+  prog->is_link_pending = 0;
+  prog->is_linked = (status == GL_TRUE);
+
+  if(prog->is_linked) {
+    MEM_FREE(prog->ctxt->allocator, prog->log);
+    prog->log = NULL;
+    /* Reflect the program once for all rather than on each query. */
+    if(rb_ogl3_setup_reflection(prog) != 0) {
+      prog->is_linked = 0;
+      return -1;
+    }
+    if(prog->ctxt->program_cache_path)
+      rb_ogl3_store_program_binary(prog);
+    return 0;
+  }
+
+  if(prog->ctxt->state_cache.current_program == prog->name)
+    rb_bind_program(prog->ctxt, NULL);
+
+  OGL(prog->ctxt, GetProgramiv(prog->name, GL_INFO_LOG_LENGTH, &log_length));
+  prog->log = MEM_REALLOC
+    (prog->ctxt->allocator, prog->log, (size_t)log_length*sizeof(char));
+  if(prog->log) {
+    OGL(prog->ctxt, GetProgramInfoLog(prog->name, log_length, NULL, prog->log));
+#ifndef NDEBUG
+    fprintf(stderr, "%s\n", prog->log);
+#endif
+  }
+  return -1;
+}
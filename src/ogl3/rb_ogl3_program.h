@@ -1,20 +1,128 @@
 #ifndef RB_OGL3_PROGRAM_H
 #define RB_OGL3_PROGRAM_H
 
+#include "ogl3/rb_ogl3.h"
 #include <snlsys/list.h>
 #include <snlsys/ref_count.h>
 #include <GL/gl.h>
+#include <stddef.h>
+#include <stdint.h>
 
+struct mem_allocator;
 struct rb_context;
+struct rb_shader;
+struct rb_uniform;
 
-struct rb_program {
+/* Link between a program and one of its shaders that may be attached to
+ * several programs. */
+struct rb_ogl3_attachment {
+  struct list_node node;
+  struct rb_shader* shader;
+};
+
+/* Active uniform or attrib of a linked program. */
+struct rb_ogl3_variable {
+  const char* name;
+  GLenum type;
+  GLint size; /* Number of array elements. */
+  GLint location; /* -1 for the members of a uniform block. */
+  GLint block; /* Index of the uniform block or -1. */
+};
+
+struct rb_ogl3_block {
+  const char* name;
+  GLint data_size;
+  GLint nb_uniforms;
+};
+
+/* Reflection of a linked program built once at link time. The variables, the
+ * blocks and their name indices lie in one allocation while their names are
+ * interned into the context. The reflection is shared with the uniforms and
+ * the attribs of the program that remain valid once the program is linked
+ * again. */
+struct rb_ogl3_reflection {
   struct ref ref;
+  struct mem_allocator* allocator;
+  struct rb_ogl3_variable* uniform_list;
+  struct rb_ogl3_variable* attrib_list;
+  struct rb_ogl3_block* block_list;
+  size_t nb_uniforms;
+  size_t nb_attribs;
+  size_t nb_blocks;
+  /* Open addressing name indices whose entries are the index of the item + 1,
+   * 0 <=> free entry. An array is also indexed by its name without "[0]". */
+  uint32_t* uniform_index;
+  uint32_t* attrib_index;
+  uint32_t* block_index;
+  size_t uniform_mask;
+  size_t attrib_mask;
+  size_t block_mask;
+};
+
+struct rb_program {
+  struct rb_ogl3_ref ref;
   struct list_node attached_shader_list;
   struct rb_context* ctxt;
   GLuint name;
   int is_linked;
+  int is_link_pending; /* The link status is not queried yet. */
   char* log;
+  struct rb_ogl3_reflection* reflection; /* NULL if the program is unlinked. */
 };
 
+/* Wait for the pending link of the program, if any. Return the link status. */
+LOCAL_SYM int
+rb_ogl3_sync_program
+  (struct rb_program* prog);
+
+/* Link the program from the binary cached for its attached shaders. Return 0
+ * if the program is successfully linked and -1 if the binary is missing or
+ * rejected by the driver. */
+LOCAL_SYM int
+rb_ogl3_load_program_binary
+  (struct rb_program* prog);
+
+/* Save the binary of the linked program into the cache. */
+LOCAL_SYM void
+rb_ogl3_store_program_binary
+  (struct rb_program* prog);
+
+/* Build the reflection of the linked program, replacing the previous one. */
+LOCAL_SYM int
+rb_ogl3_setup_reflection
+  (struct rb_program* prog);
+
+LOCAL_SYM void
+rb_ogl3_reflection_ref_get
+  (struct rb_ogl3_reflection* reflection);
+
+LOCAL_SYM void
+rb_ogl3_reflection_ref_put
+  (struct rb_ogl3_reflection* reflection);
+
+/* Return NULL if the variable is not active. */
+LOCAL_SYM const struct rb_ogl3_variable*
+rb_ogl3_find_uniform
+  (const struct rb_ogl3_reflection* reflection,
+   const char* name);
+
+LOCAL_SYM const struct rb_ogl3_variable*
+rb_ogl3_find_attrib
+  (const struct rb_ogl3_reflection* reflection,
+   const char* name);
+
+LOCAL_SYM const struct rb_ogl3_block*
+rb_ogl3_find_block
+  (const struct rb_ogl3_reflection* reflection,
+   const char* name);
+
+/* Size in bytes of the `count' first values of the uniform as read by
+ * rb_uniform_data. Return 0 if the uniform is not set through its location,
+ * i.e. if it is the member of a uniform block. */
+LOCAL_SYM size_t
+rb_ogl3_sizeof_uniform_data
+  (const struct rb_uniform* uniform,
+   int count);
+
 #endif /* RB_OGL3_PROGRAM_H */
 
@@ -0,0 +1,295 @@
+#define _POSIX_C_SOURCE 200112L /* mmap, fstat, getpid. */
+
+#include "common/rb_hash.h"
+#include "ogl3/rb_ogl3.h"
+#include "ogl3/rb_ogl3_context.h"
+#include "ogl3/rb_ogl3_program.h"
+#include "ogl3/rb_ogl3_shader.h"
+#include "rb.h"
+#include <snlsys/list.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/snlsys.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHE_MAGIC "RBPB"
+#define CACHE_VERSION 1
+
+/* Header of a cached program binary. The binary follows the header. */
+struct binary_header {
+  char magic[4];
+  uint32_t version;
+  uint64_t key;
+  uint64_t size; /* Size in bytes of the binary. */
+  uint32_t format; /* Driver specific format of the binary. */
+  uint32_t padding;
+};
+
+/* Length of the cache file names, i.e. the hexadecimal key and the suffix. */
+#define FILENAME_LEN (16 + sizeof(".rbpb"))
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+/* Compute the cache key of the program. It depends on the driver and on the
+ * sources of the attached shaders but not on their attachment order. The
+ * compile status of the shaders is not queried since it would wait for their
+ * compilation: a binary is cached only if its sources were successfully
+ * compiled and linked. Return -1 if no shader is attached. */
+static int
+program_key(const struct rb_program* prog, uint64_t* out_key)
+{
+  const struct list_node* node = NULL;
+  uint64_t sum = 0;
+  int nb_shaders = 0;
+  ASSERT(prog && out_key);
+
+  LIST_FOR_EACH(node, &prog->attached_shader_list) {
+    const struct rb_shader* shader = CONTAINER_OF
+      (node, struct rb_ogl3_attachment, node)->shader;
+    uint64_t hash = 0;
+
+    hash = rb_hash(shader->source_hash, &shader->type, sizeof(GLenum));
+    sum += hash;
+    ++nb_shaders;
+  }
+  if(!nb_shaders)
+    return -1;
+  *out_key = rb_hash(prog->ctxt->driver_hash, &sum, sizeof(uint64_t));
+  return 0;
+}
+
+/* The path is allocated from the frame arena of the context. */
+static char*
+binary_path(struct rb_context* ctxt, uint64_t key)
+{
+  char* path = NULL;
+  size_t len = 0;
+  ASSERT(ctxt && ctxt->program_cache_path);
+
+  len = strlen(ctxt->program_cache_path) + 1/*'/'*/ + FILENAME_LEN;
+  path = rb_arena_alloc(&ctxt->frame, len);
+  if(path) {
+    snprintf(path, len, "%s/%016"PRIx64".rbpb",
+      ctxt->program_cache_path, key);
+  }
+  return path;
+}
+
+static uint64_t
+hash_string(struct rb_context* ctxt, uint64_t hash, GLenum name)
+{
+  const GLubyte* str = NULL;
+  OGL_ASSIGN(ctxt, str, GetString(name));
+  return str ? rb_hash(hash, str, strlen((const char*)str) + 1) : hash;
+}
+
+/* Loading a binary of an unknown format raises a GL error: the format read
+ * from the cache is thus checked against those of the driver beforehand. */
+static int
+is_binary_format_supported(const struct rb_context* ctxt, uint32_t format)
+{
+  GLint i = 0;
+  ASSERT(ctxt);
+  for(i = 0; i < ctxt->nb_binary_formats; ++i) {
+    if((uint32_t)ctxt->binary_format_list[i] == format)
+      return 1;
+  }
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+int
+rb_ogl3_setup_program_cache(struct rb_context* ctxt)
+{
+  const char* dir = getenv("RB_OGL3_PROGRAM_CACHE");
+  size_t len = 0;
+  ASSERT(ctxt && !ctxt->program_cache_path);
+
+  if(!dir || !*dir || !ctxt->ext.ARB_get_program_binary)
+    return 0;
+
+  /* Without binary format, the cache could neither store nor load any. */
+  OGL(ctxt, GetIntegerv
+    (GL_NUM_PROGRAM_BINARY_FORMATS, &ctxt->nb_binary_formats));
+  if(ctxt->nb_binary_formats <= 0) {
+    ctxt->nb_binary_formats = 0;
+    return 0;
+  }
+  ctxt->binary_format_list = MEM_CALLOC
+    (ctxt->allocator, (size_t)ctxt->nb_binary_formats, sizeof(GLint));
+  if(!ctxt->binary_format_list)
+    goto error;
+  OGL(ctxt, GetIntegerv(GL_PROGRAM_BINARY_FORMATS, ctxt->binary_format_list));
+
+  /* A binary is valid only for the driver that produced it. */
+  ctxt->driver_hash = RB_HASH_SEED;
+  ctxt->driver_hash = hash_string(ctxt, ctxt->driver_hash, GL_VENDOR);
+  ctxt->driver_hash = hash_string(ctxt, ctxt->driver_hash, GL_RENDERER);
+  ctxt->driver_hash = hash_string(ctxt, ctxt->driver_hash, GL_VERSION);
+
+  len = strlen(dir);
+  ctxt->program_cache_path = MEM_ALLOC(ctxt->allocator, len + 1);
+  if(!ctxt->program_cache_path)
+    goto error;
+  memcpy(ctxt->program_cache_path, dir, len + 1);
+  return 0;
+
+error:
+  rb_ogl3_release_program_cache(ctxt);
+  return -1;
+}
+
+void
+rb_ogl3_release_program_cache(struct rb_context* ctxt)
+{
+  ASSERT(ctxt);
+  if(ctxt->program_cache_path) {
+    MEM_FREE(ctxt->allocator, ctxt->program_cache_path);
+    ctxt->program_cache_path = NULL;
+  }
+  if(ctxt->binary_format_list) {
+    MEM_FREE(ctxt->allocator, ctxt->binary_format_list);
+    ctxt->binary_format_list = NULL;
+  }
+  ctxt->nb_binary_formats = 0;
+}
+
+int
+rb_ogl3_load_program_binary(struct rb_program* prog)
+{
+  struct stat st;
+  struct rb_arena_mark mark;
+  const struct binary_header* header = NULL;
+  void* map = NULL;
+  char* path = NULL;
+  uint64_t key = 0;
+  GLint status = GL_FALSE;
+  int fd = -1;
+  int err = 0;
+  ASSERT(prog && prog->ctxt->program_cache_path);
+
+  rb_arena_mark(&prog->ctxt->frame, &mark);
+  if(program_key(prog, &key) != 0)
+    goto error;
+  path = binary_path(prog->ctxt, key);
+  if(!path)
+    goto error;
+
+  /* The binary is mapped rather than read in order to avoid a copy. */
+  fd = open(path, O_RDONLY);
+  if(fd < 0)
+    goto error;
+  if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct binary_header))
+    goto reject;
+  map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if(map == MAP_FAILED) {
+    map = NULL;
+    goto error;
+  }
+  header = map;
+  if(memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic))
+  || header->version != CACHE_VERSION
+  || header->key != key
+  || header->size > INT32_MAX
+  || header->size != (uint64_t)st.st_size - sizeof(struct binary_header)
+  || !is_binary_format_supported(prog->ctxt, header->format))
+    goto reject;
+
+  OGL(prog->ctxt, ProgramBinary(prog->name, (GLenum)header->format, header + 1,
+    (GLsizei)header->size));
+  OGL(prog->ctxt, GetProgramiv(prog->name, GL_LINK_STATUS, &status));
+  if(status != GL_TRUE)
+    goto reject;
+
+exit:
+  if(map)
+    munmap(map, (size_t)st.st_size);
+  if(fd >= 0)
+    close(fd);
+  rb_arena_restore(&prog->ctxt->frame, &mark);
+  return err;
+
+reject:
+  /* The binary is corrupted or outdated, e.g. by a driver update that keeps
+   * the version strings. Remove it so that it is cached again. */
+  unlink(path);
+error:
+  err = -1;
+  goto exit;
+}
+
+void
+rb_ogl3_store_program_binary(struct rb_program* prog)
+{
+  struct rb_arena_mark mark;
+  struct binary_header* header = NULL;
+  struct rb_arena* arena = NULL;
+  char* path = NULL;
+  char* tmp_path = NULL;
+  FILE* file = NULL;
+  uint64_t key = 0;
+  GLint size = 0;
+  GLsizei length = 0;
+  GLenum format = GL_NONE;
+  size_t len = 0;
+  int is_written = 0;
+  ASSERT(prog && prog->is_linked && prog->ctxt->program_cache_path);
+
+  /* The binary and its paths are transient. */
+  arena = &prog->ctxt->frame;
+  rb_arena_mark(arena, &mark);
+  if(program_key(prog, &key) != 0)
+    goto exit;
+  OGL(prog->ctxt, GetProgramiv(prog->name, GL_PROGRAM_BINARY_LENGTH, &size));
+  if(size <= 0)
+    goto exit;
+
+  header = rb_arena_alloc(arena, sizeof(struct binary_header) + (size_t)size);
+  if(!header)
+    goto exit;
+  OGL(prog->ctxt, GetProgramBinary
+    (prog->name, size, &length, &format, header + 1));
+  if(length <= 0)
+    goto exit;
+  memset(header, 0, sizeof(struct binary_header));
+  memcpy(header->magic, CACHE_MAGIC, sizeof(header->magic));
+  header->version = CACHE_VERSION;
+  header->key = key;
+  header->size = (uint64_t)length;
+  header->format = (uint32_t)format;
+
+  /* Write a temporary file that is then renamed in order to never expose a
+   * partially written binary to the other processes sharing the cache. */
+  path = binary_path(prog->ctxt, key);
+  if(!path)
+    goto exit;
+  len = strlen(path) + 32;
+  tmp_path = rb_arena_alloc(arena, len);
+  if(!tmp_path)
+    goto exit;
+  snprintf(tmp_path, len, "%s.%ld.tmp", path, (long)getpid());
+  file = fopen(tmp_path, "wb");
+  if(!file)
+    goto exit;
+  is_written =
+     1 == fwrite(header, sizeof(struct binary_header)+(size_t)length, 1, file);
+  is_written = (fclose(file) == 0) && is_written;
+  if(!is_written || rename(tmp_path, path) != 0)
+    remove(tmp_path);
+
+exit:
+  rb_arena_restore(arena, &mark);
+}
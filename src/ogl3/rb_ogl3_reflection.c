@@ -0,0 +1,292 @@
+#include "common/rb_hash.h"
+#include "ogl3/rb_ogl3.h"
+#include "ogl3/rb_ogl3_context.h"
+#include "ogl3/rb_ogl3_program.h"
+#include <snlsys/math.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+#include <string.h>
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+/* Mask of an index whose load is lower than 1/2 with both the name and the
+ * base name of the arrays. */
+static size_t
+index_mask(size_t nb_items)
+{
+  size_t capacity = 4;
+  while(capacity < nb_items * 4)
+    capacity *= 2;
+  return capacity - 1;
+}
+
+static FINLINE size_t
+name_slot(const char* name, size_t len, size_t mask)
+{
+  return (size_t)rb_hash(RB_HASH_SEED, name, len) & mask;
+}
+
+/* Does `item_name' match the `len' first characters of `name', either as is
+ * or as the first element of an array? */
+static FINLINE int
+match_name(const char* item_name, const char* name, size_t len)
+{
+  return strncmp(item_name, name, len) == 0
+    && (item_name[len] == '\0' || strcmp(item_name + len, "[0]") == 0);
+}
+
+static void
+index_name(uint32_t* index, size_t mask, const char* name, uint32_t id)
+{
+  const size_t len = strlen(name);
+  size_t i = 0;
+
+  for(i = name_slot(name, len, mask); index[i]; i = (i + 1) & mask);
+  index[i] = id + 1;
+
+  if(len > 3 && strcmp(name + len - 3, "[0]") == 0) {
+    for(i = name_slot(name, len - 3, mask); index[i]; i = (i + 1) & mask);
+    index[i] = id + 1;
+  }
+}
+
+/* Return the id + 1 of the item named `name' or 0. */
+static uint32_t
+find_name
+  (const uint32_t* index,
+   size_t mask,
+   const void* item_list,
+   size_t item_size,
+   const char* name)
+{
+  const size_t len = strlen(name);
+  size_t i = 0;
+
+  for(i = name_slot(name, len, mask); index[i]; i = (i + 1) & mask) {
+    /* The items start with their name. */
+    const char* item_name = *(const char* const*)
+      ((const char*)item_list + (index[i] - 1) * item_size);
+    if(match_name(item_name, name, len))
+      return index[i];
+  }
+  return 0;
+}
+
+static void
+release_reflection(struct ref* ref)
+{
+  struct rb_ogl3_reflection* reflection = NULL;
+  ASSERT(ref);
+
+  reflection = CONTAINER_OF(ref, struct rb_ogl3_reflection, ref);
+  MEM_FREE(reflection->allocator, reflection);
+}
+
+static int
+create_reflection
+  (struct rb_program* prog,
+   struct rb_ogl3_reflection** out_reflection)
+{
+  struct rb_ogl3_reflection* reflection = NULL;
+  struct rb_string_arena* names = NULL;
+  struct rb_arena_mark mark;
+  GLchar* buffer = NULL;
+  size_t size = 0;
+  size_t uniform_mask = 0, attrib_mask = 0, block_mask = 0;
+  GLint nb_uniforms = 0, nb_attribs = 0, nb_blocks = 0;
+  GLint uniform_len = 0, attrib_len = 0, block_len = 0;
+  GLint i = 0;
+  int err = 0;
+  ASSERT(prog && out_reflection);
+
+  OGL(prog->ctxt, GetProgramiv(prog->name, GL_ACTIVE_UNIFORMS, &nb_uniforms));
+  OGL(prog->ctxt, GetProgramiv
+    (prog->name, GL_ACTIVE_UNIFORM_MAX_LENGTH, &uniform_len));
+  OGL(prog->ctxt, GetProgramiv(prog->name, GL_ACTIVE_ATTRIBUTES, &nb_attribs));
+  OGL(prog->ctxt, GetProgramiv
+    (prog->name, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &attrib_len));
+  OGL(prog->ctxt, GetProgramiv
+    (prog->name, GL_ACTIVE_UNIFORM_BLOCKS, &nb_blocks));
+  OGL(prog->ctxt, GetProgramiv
+    (prog->name, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &block_len));
+  ASSERT(nb_uniforms >= 0 && nb_attribs >= 0 && nb_blocks >= 0);
+
+  /* The names are queried into a scratch buffer and interned into the
+   * context. The max name lengths include the null character. */
+  names = &prog->ctxt->names;
+  rb_arena_mark(&prog->ctxt->frame, &mark);
+  buffer = rb_arena_alloc
+    (&prog->ctxt->frame,
+     (size_t)MAX(MAX(MAX(uniform_len, attrib_len), block_len), 1));
+  if(!buffer)
+    goto error;
+
+  uniform_mask = index_mask((size_t)nb_uniforms);
+  attrib_mask = index_mask((size_t)nb_attribs);
+  block_mask = index_mask((size_t)nb_blocks);
+
+  /* The sizes of the items are multiples of the alignment of the next ones. */
+  size = sizeof(struct rb_ogl3_reflection)
+    + sizeof(struct rb_ogl3_variable) * (size_t)(nb_uniforms + nb_attribs)
+    + sizeof(struct rb_ogl3_block) * (size_t)nb_blocks
+    + sizeof(uint32_t) * (uniform_mask + attrib_mask + block_mask + 3);
+  reflection = MEM_CALLOC(prog->ctxt->allocator, 1, size);
+  if(!reflection)
+    goto error;
+  ref_init(&reflection->ref);
+  reflection->allocator = prog->ctxt->allocator;
+  reflection->nb_uniforms = (size_t)nb_uniforms;
+  reflection->nb_attribs = (size_t)nb_attribs;
+  reflection->nb_blocks = (size_t)nb_blocks;
+  reflection->uniform_mask = uniform_mask;
+  reflection->attrib_mask = attrib_mask;
+  reflection->block_mask = block_mask;
+  reflection->uniform_list = (struct rb_ogl3_variable*)(reflection + 1);
+  reflection->attrib_list = reflection->uniform_list + nb_uniforms;
+  reflection->block_list = (struct rb_ogl3_block*)
+    (reflection->attrib_list + nb_attribs);
+  reflection->uniform_index = (uint32_t*)
+    (reflection->block_list + nb_blocks);
+  reflection->attrib_index = reflection->uniform_index + uniform_mask + 1;
+  reflection->block_index = reflection->attrib_index + attrib_mask + 1;
+
+  for(i = 0; i < nb_uniforms; ++i) {
+    struct rb_ogl3_variable* var = reflection->uniform_list + i;
+    const GLuint id = (GLuint)i;
+    GLsizei len = 0;
+
+    OGL(prog->ctxt, GetActiveUniform
+      (prog->name, id, uniform_len, &len, &var->size, &var->type, buffer));
+    OGL(prog->ctxt, GetActiveUniformsiv
+      (prog->name, 1, &id, GL_UNIFORM_BLOCK_INDEX, &var->block));
+    var->name = rb_intern_string(names, buffer, (size_t)len);
+    if(!var->name)
+      goto error;
+    OGL_ASSIGN(prog->ctxt, var->location, GetUniformLocation
+      (prog->name, var->name));
+    index_name(reflection->uniform_index, uniform_mask, var->name, id);
+  }
+  for(i = 0; i < nb_attribs; ++i) {
+    struct rb_ogl3_variable* var = reflection->attrib_list + i;
+    GLsizei len = 0;
+
+    OGL(prog->ctxt, GetActiveAttrib
+      (prog->name, (GLuint)i, attrib_len, &len, &var->size, &var->type,
+       buffer));
+    var->name = rb_intern_string(names, buffer, (size_t)len);
+    if(!var->name)
+      goto error;
+    var->block = -1;
+    OGL_ASSIGN(prog->ctxt, var->location, GetAttribLocation
+      (prog->name, var->name));
+    index_name(reflection->attrib_index, attrib_mask, var->name, (uint32_t)i);
+  }
+  for(i = 0; i < nb_blocks; ++i) {
+    struct rb_ogl3_block* block = reflection->block_list + i;
+    GLsizei len = 0;
+
+    OGL(prog->ctxt, GetActiveUniformBlockName
+      (prog->name, (GLuint)i, block_len, &len, buffer));
+    OGL(prog->ctxt, GetActiveUniformBlockiv
+      (prog->name, (GLuint)i, GL_UNIFORM_BLOCK_DATA_SIZE, &block->data_size));
+    OGL(prog->ctxt, GetActiveUniformBlockiv
+      (prog->name, (GLuint)i, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS,
+       &block->nb_uniforms));
+    block->name = rb_intern_string(names, buffer, (size_t)len);
+    if(!block->name)
+      goto error;
+    index_name(reflection->block_index, block_mask, block->name, (uint32_t)i);
+  }
+
+exit:
+  rb_arena_restore(&prog->ctxt->frame, &mark);
+  *out_reflection = reflection;
+  return err;
+
+error:
+  if(reflection) {
+    rb_ogl3_reflection_ref_put(reflection);
+    reflection = NULL;
+  }
+  err = -1;
+  goto exit;
+}
+
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+int
+rb_ogl3_setup_reflection(struct rb_program* prog)
+{
+  struct rb_ogl3_reflection* reflection = NULL;
+  ASSERT(prog && prog->is_linked);
+
+  if(create_reflection(prog, &reflection) != 0)
+    return -1;
+  if(prog->reflection)
+    rb_ogl3_reflection_ref_put(prog->reflection);
+  prog->reflection = reflection;
+  return 0;
+}
+
+void
+rb_ogl3_reflection_ref_get(struct rb_ogl3_reflection* reflection)
+{
+  ASSERT(reflection);
+  ref_get(&reflection->ref);
+}
+
+void
+rb_ogl3_reflection_ref_put(struct rb_ogl3_reflection* reflection)
+{
+  ASSERT(reflection);
+  ref_put(&reflection->ref, release_reflection);
+}
+
+const struct rb_ogl3_variable*
+rb_ogl3_find_uniform
+  (const struct rb_ogl3_reflection* reflection,
+   const char* name)
+{
+  uint32_t id = 0;
+  ASSERT(reflection && name);
+
+  id = find_name
+    (reflection->uniform_index, reflection->uniform_mask,
+     reflection->uniform_list, sizeof(struct rb_ogl3_variable), name);
+  return id ? reflection->uniform_list + id - 1 : NULL;
+}
+
+const struct rb_ogl3_variable*
+rb_ogl3_find_attrib
+  (const struct rb_ogl3_reflection* reflection,
+   const char* name)
+{
+  uint32_t id = 0;
+  ASSERT(reflection && name);
+
+  id = find_name
+    (reflection->attrib_index, reflection->attrib_mask,
+     reflection->attrib_list, sizeof(struct rb_ogl3_variable), name);
+  return id ? reflection->attrib_list + id - 1 : NULL;
+}
+
+const struct rb_ogl3_block*
+rb_ogl3_find_block
+  (const struct rb_ogl3_reflection* reflection,
+   const char* name)
+{
+  uint32_t id = 0;
+  ASSERT(reflection && name);
+
+  id = find_name
+    (reflection->block_index, reflection->block_mask,
+     reflection->block_list, sizeof(struct rb_ogl3_block), name);
+  return id ? reflection->block_list + id - 1 : NULL;
+}
@@ -1,14 +1,26 @@
+#include "common/rb_hash.h"
 #include "ogl3/rb_ogl3_context.h"
 #include "rb.h"
+#include <snlsys/list.h>
 #include <snlsys/math.h>
 #include <snlsys/mem_allocator.h>
 #include <snlsys/ref_count.h>
 #include <snlsys/snlsys.h>
 
+/* Driver sampler shared by the rb_samplers of an identical descriptor. It is
+ * only accessed by the thread of its context. */
+struct sampler_object {
+  GLuint name;
+  int ref_count;
+  struct list_node cache_node; /* Node of the context sampler cache. */
+  struct rb_sampler_desc desc;
+  uint64_t key;
+};
+
 struct rb_sampler {
-  struct ref ref;
+  struct rb_ogl3_ref ref;
   struct rb_context* ctxt;
-  GLuint name;
+  struct sampler_object* object;
 };
 
 /*******************************************************************************
@@ -86,8 +98,172 @@ rb_to_ogl3_address(enum rb_tex_address address)
   return ogl3_address;
 }
 
+/* Hash the fields one by one since the descriptor may be padded. */
+static uint64_t
+sampler_key(const struct rb_sampler_desc* desc)
+{
+  uint64_t key = RB_HASH_SEED;
+  ASSERT(desc);
+  key = rb_hash(key, &desc->filter, sizeof(desc->filter));
+  key = rb_hash(key, &desc->address_u, sizeof(desc->address_u));
+  key = rb_hash(key, &desc->address_v, sizeof(desc->address_v));
+  key = rb_hash(key, &desc->address_w, sizeof(desc->address_w));
+  key = rb_hash(key, &desc->lod_bias, sizeof(desc->lod_bias));
+  key = rb_hash(key, &desc->min_lod, sizeof(desc->min_lod));
+  key = rb_hash(key, &desc->max_lod, sizeof(desc->max_lod));
+  key = rb_hash(key, &desc->max_anisotropy, sizeof(desc->max_anisotropy));
+  return key;
+}
+
+static FINLINE int
+sampler_desc_eq
+  (const struct rb_sampler_desc* a,
+   const struct rb_sampler_desc* b)
+{
+  ASSERT(a && b);
+  return a->filter == b->filter
+      && a->address_u == b->address_u
+      && a->address_v == b->address_v
+      && a->address_w == b->address_w
+      && a->lod_bias == b->lod_bias
+      && a->min_lod == b->min_lod
+      && a->max_lod == b->max_lod
+      && a->max_anisotropy == b->max_anisotropy;
+}
+
+static FINLINE struct list_node*
+sampler_bucket(struct rb_context* ctxt, uint64_t key)
+{
+  ASSERT(ctxt);
+  return ctxt->sampler_cache + (key & (RB_OGL3_SAMPLER_CACHE_SIZE - 1));
+}
+
+static struct sampler_object*
+find_object
+  (struct rb_context* ctxt,
+   const struct rb_sampler_desc* desc,
+   uint64_t key)
+{
+  struct list_node* node = NULL;
+  ASSERT(ctxt && desc);
+
+  LIST_FOR_EACH(node, sampler_bucket(ctxt, key)) {
+    struct sampler_object* object = CONTAINER_OF
+      (node, struct sampler_object, cache_node);
+    if(object->key == key && sampler_desc_eq(&object->desc, desc))
+      return object;
+  }
+  return NULL;
+}
+
+static int
+check_desc(struct rb_context* ctxt, const struct rb_sampler_desc* desc)
+{
+  int max_tex_max_aniso = 0;
+  ASSERT(ctxt && desc);
+
+  if(desc->min_lod > desc->max_lod)
+    return -1;
+  OGL(ctxt, GetIntegerv
+    (GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_tex_max_aniso));
+  ASSERT(max_tex_max_aniso >= 0);
+  if(desc->max_anisotropy > (size_t)max_tex_max_aniso)
+    return -1;
+  return 0;
+}
+
+/* Set the parameters of the object and index it by its new descriptor. */
+static void
+setup_object
+  (struct rb_context* ctxt,
+   struct sampler_object* object,
+   const struct rb_sampler_desc* desc,
+   uint64_t key)
+{
+  struct ogl3_tex_filter filter;
+  float min_lod = 0.f;
+  float max_lod = 0.f;
+  ASSERT(ctxt && object && desc && key == sampler_key(desc));
+
+  filter = rb_to_ogl3_tex_filter(desc->filter);
+  min_lod = MAX(MIN(min_lod, -1000.f), 1000.f);
+  max_lod = MAX(MIN(min_lod, -1000.f), 1000.f);
+
+  OGL(ctxt, SamplerParameteri
+    (object->name, GL_TEXTURE_MIN_FILTER, (GLint)filter.min));
+  OGL(ctxt, SamplerParameteri
+    (object->name, GL_TEXTURE_MAG_FILTER, (GLint)filter.mag));
+  OGL(ctxt, SamplerParameteri
+    (object->name, GL_TEXTURE_WRAP_S,
+     (GLint)rb_to_ogl3_address(desc->address_u)));
+  OGL(ctxt, SamplerParameteri
+    (object->name, GL_TEXTURE_WRAP_T,
+     (GLint)rb_to_ogl3_address(desc->address_v)));
+  OGL(ctxt, SamplerParameteri
+    (object->name, GL_TEXTURE_WRAP_R,
+     (GLint)rb_to_ogl3_address(desc->address_w)));
+  OGL(ctxt, SamplerParameterf
+    (object->name, GL_TEXTURE_LOD_BIAS, desc->lod_bias));
+  OGL(ctxt, SamplerParameterf
+    (object->name, GL_TEXTURE_MIN_LOD, min_lod));
+  OGL(ctxt, SamplerParameterf
+    (object->name, GL_TEXTURE_MAX_LOD, max_lod));
+  OGL(ctxt, SamplerParameterf
+    (object->name,
+     GL_TEXTURE_MAX_ANISOTROPY_EXT,
+     (float)desc->max_anisotropy));
+
+  list_del(&object->cache_node);
+  object->desc = *desc;
+  object->key = key;
+  list_add(sampler_bucket(ctxt, key), &object->cache_node);
+}
+
+/* Get a reference onto the object of the descriptor, created if none is
+ * cached. */
+static struct sampler_object*
+get_object(struct rb_context* ctxt, const struct rb_sampler_desc* desc)
+{
+  struct sampler_object* object = NULL;
+  const uint64_t key = sampler_key(desc);
+  ASSERT(ctxt && desc);
+
+  object = find_object(ctxt, desc, key);
+  if(object) {
+    ++object->ref_count;
+    return object;
+  }
+  object = MEM_CALLOC(ctxt->allocator, 1, sizeof(struct sampler_object));
+  if(!object)
+    return NULL;
+  object->ref_count = 1;
+  list_init(&object->cache_node);
+  OGL(ctxt, GenSamplers(1, &object->name));
+  setup_object(ctxt, object, desc, key);
+  return object;
+}
+
+static void
+put_object(struct rb_context* ctxt, struct sampler_object* object)
+{
+  unsigned int i = 0;
+  ASSERT(ctxt && object && object->ref_count > 0);
+
+  if(--object->ref_count)
+    return;
+  for(i = 0; i < RB_OGL3_MAX_TEXTURE_UNITS; ++i) {
+    if(ctxt->state_cache.sampler_binding[i] == object->name) {
+      ctxt->state_cache.sampler_binding[i] = 0;
+      OGL(ctxt, BindSampler(i, 0));
+    }
+  }
+  list_del(&object->cache_node);
+  OGL(ctxt, DeleteSamplers(1, &object->name));
+  MEM_FREE(ctxt->allocator, object);
+}
+
 static void
-release_sampler(struct ref* ref)
+release_sampler(struct rb_ogl3_ref* ref)
 {
   struct rb_context* ctxt = NULL;
   struct rb_sampler* sampler = NULL;
@@ -98,12 +274,12 @@ release_sampler(struct ref* ref)
   ctxt = sampler->ctxt;
 
   for(i = 0; i < RB_OGL3_MAX_TEXTURE_UNITS; ++i) {
-    if(ctxt->state_cache.sampler_binding[i] == sampler->name)
-      RB(bind_sampler(ctxt, NULL, i));
+    if(ctxt->bound_sampler_list[i] == sampler)
+      ctxt->bound_sampler_list[i] = NULL;
   }
-
-  OGL(DeleteSamplers(1, &sampler->name));
-  MEM_FREE(ctxt->allocator, sampler);
+  if(sampler->object)
+    put_object(ctxt, sampler->object);
+  rb_ogl3_free_object(ctxt, RB_OBJECT_SAMPLER, sampler);
   RB(context_ref_put(ctxt));
 }
 
@@ -121,19 +297,19 @@ rb_create_sampler
   struct rb_sampler* sampler = NULL;
   int err = 0;
 
-  if(!ctxt || !desc || !out_sampler)
+  if(!ctxt || !desc || !out_sampler || check_desc(ctxt, desc) != 0)
     goto error;
 
-  sampler = MEM_CALLOC(ctxt->allocator, 1, sizeof(struct rb_sampler));
+  sampler = rb_ogl3_alloc_object
+    (ctxt, RB_OBJECT_SAMPLER, sizeof(struct rb_sampler));
   if(!sampler)
     goto error;
-  ref_init(&sampler->ref);
+  rb_ogl3_ref_init(&sampler->ref, release_sampler);
   RB(context_ref_get(ctxt));
   sampler->ctxt = ctxt;
-  OGL(GenSamplers(1, &sampler->name));
-
-  err = rb_sampler_parameters(sampler, desc);
-  if(0 != err)
+  /* Share the driver sampler of an identical descriptor. */
+  sampler->object = get_object(ctxt, desc);
+  if(!sampler->object)
     goto error;
 
 exit:
@@ -155,7 +331,7 @@ rb_sampler_ref_get(struct rb_sampler* sampler)
 {
   if(!sampler)
     return -1;
-  ref_get(&sampler->ref);
+  rb_ogl3_ref_get(&sampler->ref);
   return 0;
 }
 
@@ -164,7 +340,7 @@ rb_sampler_ref_put(struct rb_sampler* sampler)
 {
   if(!sampler)
     return -1;
-  ref_put(&sampler->ref, release_sampler);
+  rb_ogl3_ref_put(sampler->ctxt, &sampler->ref);
   return 0;
 }
 
@@ -173,50 +349,36 @@ rb_sampler_parameters
   (struct rb_sampler* sampler,
    const struct rb_sampler_desc* desc)
 {
-  struct ogl3_tex_filter filter;
-  float min_lod = 0.f;
-  float max_lod = 0.f;
-  int max_tex_max_aniso = 0;
-  int err = 0;
-
-  if(!sampler || !desc || desc->min_lod > desc->max_lod)
-    goto error;
-
-  OGL(GetIntegerv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_tex_max_aniso));
-  ASSERT(max_tex_max_aniso >= 0);
-  if(desc->max_anisotropy > (size_t)max_tex_max_aniso)
-    goto error;
-
-  filter = rb_to_ogl3_tex_filter(desc->filter);
-  min_lod = MAX(MIN(min_lod, -1000.f), 1000.f);
-  max_lod = MAX(MIN(min_lod, -1000.f), 1000.f);
+  struct rb_context* ctxt = NULL;
+  struct sampler_object* object = NULL;
+  uint64_t key = 0;
+  unsigned int i = 0;
 
-  OGL(SamplerParameteri
-    (sampler->name, GL_TEXTURE_MIN_FILTER, (GLint)filter.min));
-  OGL(SamplerParameteri
-    (sampler->name, GL_TEXTURE_MAG_FILTER, (GLint)filter.mag));
-  OGL(SamplerParameteri
-    (sampler->name, GL_TEXTURE_WRAP_S, 
-     (GLint)rb_to_ogl3_address(desc->address_u)));
-  OGL(SamplerParameteri
-    (sampler->name, GL_TEXTURE_WRAP_T,
-     (GLint)rb_to_ogl3_address(desc->address_v)));
-  OGL(SamplerParameteri
-    (sampler->name, GL_TEXTURE_WRAP_R, 
-     (GLint)rb_to_ogl3_address(desc->address_w)));
-  OGL(SamplerParameterf(sampler->name, GL_TEXTURE_LOD_BIAS, desc->lod_bias));
-  OGL(SamplerParameterf(sampler->name, GL_TEXTURE_MIN_LOD, min_lod));
-  OGL(SamplerParameterf(sampler->name, GL_TEXTURE_MAX_LOD, max_lod));
-  OGL(SamplerParameterf
-    (sampler->name,
-     GL_TEXTURE_MAX_ANISOTROPY_EXT,
-     (float)desc->max_anisotropy));
+  if(!sampler || !desc || check_desc(sampler->ctxt, desc) != 0)
+    return -1;
+  ctxt = sampler->ctxt;
+  if(sampler_desc_eq(&sampler->object->desc, desc))
+    return 0;
 
-exit:
-  return err;
-error:
-  err = -1;
-  goto exit;
+  key = sampler_key(desc);
+  if(sampler->object->ref_count == 1 && !find_object(ctxt, desc, key)) {
+    setup_object(ctxt, sampler->object, desc, key);
+    return 0;
+  }
+  /* Copy on write: the other samplers keep the shared object. */
+  object = get_object(ctxt, desc);
+  if(!object)
+    return -1;
+  put_object(ctxt, sampler->object);
+  sampler->object = object;
+  /* The new parameters apply to the units onto which the sampler is bound. */
+  for(i = 0; i < RB_OGL3_MAX_TEXTURE_UNITS; ++i) {
+    if(ctxt->bound_sampler_list[i] == sampler) {
+      ctxt->bound_sampler_list[i] = NULL;
+      RB(bind_sampler(ctxt, sampler, i));
+    }
+  }
+  return 0;
 }
 
 int
@@ -225,13 +387,20 @@ rb_bind_sampler
    struct rb_sampler* sampler,
    unsigned int tex_unit)
 {
+  GLuint name = 0;
   int err = 0;
 
-  if(!ctxt || tex_unit > RB_OGL3_MAX_TEXTURE_UNITS)
+  if(!ctxt || tex_unit >= RB_OGL3_MAX_TEXTURE_UNITS)
     goto error;
 
-  ctxt->state_cache.sampler_binding[tex_unit] = sampler ? sampler->name : 0;
-  OGL(BindSampler(tex_unit, ctxt->state_cache.sampler_binding[tex_unit]));
+  /* Shared samplers make redundant bindings frequent. */
+  ctxt->bound_sampler_list[tex_unit] = sampler;
+  name = sampler ? sampler->object->name : 0;
+  if(ctxt->state_cache.sampler_binding[tex_unit] == name)
+    goto exit;
+
+  ctxt->state_cache.sampler_binding[tex_unit] = name;
+  OGL(ctxt, BindSampler(tex_unit, name));
 
 exit:
   return err;
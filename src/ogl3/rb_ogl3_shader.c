@@ -1,9 +1,11 @@
+#include "common/rb_hash.h"
 #include "ogl3/rb_ogl3.h"
 #include "ogl3/rb_ogl3_context.h"
 #include "ogl3/rb_ogl3_shader.h"
 #include "rb.h"
 #include <snlsys/mem_allocator.h>
 #include <snlsys/snlsys.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 /*******************************************************************************
@@ -33,7 +35,7 @@ rb_to_ogl3_shader_type(enum rb_shader_type type)
 }
 
 static void
-release_shader(struct ref* ref)
+release_shader(struct rb_ogl3_ref* ref)
 {
   struct rb_context* ctxt = NULL;
   struct rb_shader* shader = NULL;
@@ -42,11 +44,13 @@ release_shader(struct ref* ref)
   shader = CONTAINER_OF(ref, struct rb_shader, ref);
   ctxt = shader->ctxt;
 
+  if(shader->is_variant)
+    rb_remove_shader_variant(&ctxt->variant_cache, shader->variant_key, shader);
   if(shader->name != 0)
-    OGL(DeleteShader(shader->name));
+    OGL(ctxt, DeleteShader(shader->name));
   if(shader->log)
     MEM_FREE(ctxt->allocator, shader->log);
-  MEM_FREE(ctxt->allocator, shader);
+  rb_ogl3_free_object(ctxt, RB_OBJECT_SHADER, shader);
   RB(context_ref_put(ctxt));
 }
 
@@ -69,17 +73,22 @@ rb_create_shader
   if(!ctxt || !out_shader)
     goto error;
 
-  shader = MEM_ALLOC(ctxt->allocator, sizeof(struct rb_shader));
+  shader = rb_ogl3_alloc_object
+    (ctxt, RB_OBJECT_SHADER, sizeof(struct rb_shader));
   if(!shader)
     goto error;
-  ref_init(&shader->ref);
-  list_init(&shader->attachment);
+  rb_ogl3_ref_init(&shader->ref, release_shader);
   RB(context_ref_get(ctxt));
   shader->ctxt = ctxt;
 
   shader->log = NULL;
+  shader->nb_attachments = 0;
+  shader->source_hash = 0;
+  shader->variant_key = 0;
+  shader->is_variant = 0;
+  shader->is_compile_pending = 0;
   shader->type = rb_to_ogl3_shader_type(type);
-  shader->name = OGL(CreateShader(shader->type));
+  OGL_ASSIGN(ctxt, shader->name, CreateShader(shader->type));
   if(shader->name == 0)
     goto error;
 
@@ -102,39 +111,75 @@ error:
 int
 rb_shader_source(struct rb_shader* shader, const char* source, size_t length)
 {
-  int err = 0;
-  GLint status = GL_TRUE;
   GLint gl_length = 0;
 
   if(!shader || (length > 0 && !source))
-    goto error;
+    return -1;
+
+  /* The variant no longer matches its preprocessed source. */
+  if(shader->is_variant) {
+    rb_remove_shader_variant
+      (&shader->ctxt->variant_cache, shader->variant_key, shader);
+    shader->is_variant = 0;
+  }
 
   gl_length = (GLint)length;
-  OGL(ShaderSource(shader->name, 1, (const char**)&source, &gl_length));
-  OGL(CompileShader(shader->name));
-  OGL(GetShaderiv(shader->name, GL_COMPILE_STATUS, &status));
-  length = (size_t)gl_length;
+  OGL(shader->ctxt, ShaderSource
+    (shader->name, 1, (const char**)&source, &gl_length));
+  OGL(shader->ctxt, CompileShader(shader->name));
+  shader->source_hash = rb_hash(RB_HASH_SEED, source, length);
+  shader->is_compile_pending = 1;
 
-  if(status == GL_FALSE) {
-    GLint log_length = 0;
-    OGL(GetShaderiv(shader->name, GL_INFO_LOG_LENGTH, &log_length));
+  /* In the asynchronous mode, the compile status is not queried in order to
+   * let the driver compile the shader while the caller goes on. */
+  if(shader->ctxt->compile.mode == RB_COMPILE_ASYNC)
+    return 0;
+  return rb_ogl3_sync_shader(shader);
+}
 
-    shader->log = MEM_REALLOC
-      (shader->ctxt->allocator, shader->log, (size_t)log_length*sizeof(char));
-    if(!shader->log)
-      goto error;
+int
+rb_create_shader_variant
+  (struct rb_context* ctxt,
+   const struct rb_shader_variant_desc* desc,
+   struct rb_shader** out_shader)
+{
+  struct rb_shader* shader = NULL;
+  char* source = NULL;
+  size_t length = 0;
+  uint64_t key = 0;
+  int err = 0;
 
-    OGL(GetShaderInfoLog(shader->name, log_length, NULL, shader->log));
-    err = -1;
-#ifndef NDEBUG
-   fprintf(stderr, "%s\n", shader->log);
-#endif
-  } else {
-    MEM_FREE(shader->ctxt->allocator, shader->log);
-    shader->log = NULL;
+  if(!ctxt || !desc || !out_shader)
+    goto error;
+  if(rb_preprocess_shader_variant(ctxt->allocator, desc, &source, &length))
+    goto error;
+
+  key = rb_shader_variant_key(desc->type, source, length);
+  shader = rb_find_shader_variant
+    (&ctxt->variant_cache, key, desc->type, source, length);
+  if(shader && !rb_ogl3_ref_try_get(&shader->ref)) {
+    /* Its last reference was put by another thread and its release is
+     * pending. It can no longer be shared. */
+    rb_remove_shader_variant(&ctxt->variant_cache, key, shader);
+    shader->is_variant = 0;
+    shader = NULL;
+  }
+  if(!shader) {
+    err = rb_create_shader(ctxt, desc->type, source, length, &shader);
+    /* A shader that fails to compile is returned for its log but is not
+     * shared. The variant is simply not shared if it cannot be cached. */
+    if(!err && rb_add_shader_variant
+       (&ctxt->variant_cache, key, desc->type, source, length, shader) == 0) {
+      shader->variant_key = key;
+      shader->is_variant = 1;
+    }
   }
 
 exit:
+  if(source)
+    MEM_FREE(ctxt->allocator, source);
+  if(out_shader)
+    *out_shader = shader;
   return err;
 
 error:
@@ -147,7 +192,7 @@ rb_shader_ref_get(struct rb_shader* shader)
 {
   if(!shader)
     return -1;
-  ref_get(&shader->ref);
+  rb_ogl3_ref_get(&shader->ref);
   return 0;
 }
 
@@ -156,7 +201,7 @@ rb_shader_ref_put(struct rb_shader* shader)
 {
   if(!shader)
     return -1;
-  ref_put(&shader->ref, release_shader);
+  rb_ogl3_ref_put(shader->ctxt, &shader->ref);
   return 0;
 }
 
@@ -165,6 +210,8 @@ rb_get_shader_log(struct rb_shader* shader, const char** out_log)
 {
   if(!shader || !out_log)
     return -1;
+  /* A compilation failure is not an error of the log retrieval. */
+  rb_ogl3_sync_shader(shader);
   *out_log = shader->log;
   return 0;
 }
@@ -174,7 +221,44 @@ rb_is_shader_attached(struct rb_shader* shader, int* out_is_attached)
 {
   if(!shader || !out_is_attached)
     return -1;
-  *out_is_attached = !is_list_empty(&shader->attachment);
+  *out_is_attached = shader->nb_attachments != 0;
   return 0;
 }
 
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+int
+rb_ogl3_sync_shader(struct rb_shader* shader)
+{
+  GLint status = GL_TRUE;
+  GLint log_length = 0;
+  ASSERT(shader);
+
+  OGL(shader->ctxt, GetShaderiv(shader->name, GL_COMPILE_STATUS, &status));
+  if(!shader->is_compile_pending)
+    return status == GL_TRUE ? 0 : -1;
+
+  if(status == GL_FALSE) {
+    OGL(shader->ctxt, GetShaderiv
+      (shader->name, GL_INFO_LOG_LENGTH, &log_length));
+
+    shader->log = MEM_REALLOC
+      (shader->ctxt->allocator, shader->log, (size_t)log_length*sizeof(char));
+    if(!shader->log)
+      return -1;
+
+    OGL(shader->ctxt, GetShaderInfoLog
+      (shader->name, log_length, NULL, shader->log));
+#ifndef NDEBUG
+   fprintf(stderr, "%s\n", shader->log);
+#endif
+  } else {
+    MEM_FREE(shader->ctxt->allocator, shader->log);
+    shader->log = NULL;
+  }
+  shader->is_compile_pending = 0;
+  return status == GL_TRUE ? 0 : -1;
+}
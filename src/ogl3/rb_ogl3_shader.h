@@ -1,20 +1,30 @@
 #ifndef RB_OGL3_SHADER_H
 #define RB_OGL3_SHADER_H
 
-#include <snlsys/list.h>
-#include <snlsys/ref_count.h>
+#include "ogl3/rb_ogl3.h"
 #include <GL/gl.h>
+#include <stdint.h>
 
 struct rb_context;
 
 struct rb_shader {
-  struct ref ref;
-  struct list_node attachment;
+  struct rb_ogl3_ref ref;
   struct rb_context* ctxt;
   GLuint name;
   GLenum type;
+  unsigned int nb_attachments; /* Number of programs it is attached to. */
+  uint64_t source_hash; /* Key of the source into the program cache. */
+  uint64_t variant_key; /* Key into the variant cache if it is shared. */
+  int is_variant;
   char* log;
+  int is_compile_pending; /* The compile status is not queried yet. */
 };
 
+/* Wait for the pending compilation of the shader, if any, and setup its log.
+ * Return the compile status. */
+LOCAL_SYM int
+rb_ogl3_sync_shader
+  (struct rb_shader* shader);
+
 #endif  /* RB_OGL3_SHADER_H */
 
@@ -138,27 +138,31 @@ ogl3_type(enum rb_tex_format fmt)
 }
 
 static void
-release_tex2d(struct ref* ref)
+release_tex2d(struct rb_ogl3_ref* ref)
 {
   struct rb_context* ctxt = NULL;
+  struct rb_context* current = NULL;
   struct rb_tex2d* tex = NULL;
   unsigned int i = 0;
   ASSERT(ref);
 
   tex = CONTAINER_OF(ref, struct rb_tex2d, ref);
   ctxt = tex->ctxt;
+  /* The texture may be released by another context of its share group. */
+  current = rb_ogl3_current_context(ctxt);
 
   for(i = 0; i < RB_OGL3_MAX_TEXTURE_UNITS; ++i) {
-    if(ctxt->state_cache.texture_binding_2d[i] == tex->name)
-      RB(bind_tex2d(ctxt, NULL, i));
+    if(current->state_cache.texture_binding_2d[i] == tex->name)
+      RB(bind_tex2d(current, NULL, i));
   }
 
   if(tex->mip_list)
     MEM_FREE(ctxt->allocator, tex->mip_list);
   if(tex->pixbuf)
     RB(buffer_ref_put(tex->pixbuf));
-  OGL(DeleteTextures(1, &tex->name));
-  MEM_FREE(ctxt->allocator, tex);
+  OGL(current, DeleteTextures(1, &tex->name));
+  rb_ogl3_signal_delete(ctxt);
+  rb_ogl3_free_object(ctxt, RB_OBJECT_TEX2D, tex);
   RB(context_ref_put(ctxt));
 }
 
@@ -189,18 +193,20 @@ rb_create_tex2d
   || (desc->compress && !is_format_compressible(desc->format)))
     goto error;
 
-  tex = MEM_CALLOC(ctxt->allocator, 1, sizeof(struct rb_tex2d));
+  tex = rb_ogl3_alloc_object(ctxt, RB_OBJECT_TEX2D, sizeof(struct rb_tex2d));
   if(!tex)
     goto error;
-  ref_init(&tex->ref);
+  rb_ogl3_ref_init(&tex->ref, release_tex2d);
+  tex->ref.is_shared = 1;
   RB(context_ref_get(ctxt));
   tex->ctxt = ctxt;
-  OGL(GenTextures(1, &tex->name));
+  rb_ogl3_sync_state_cache(ctxt);
+  OGL(ctxt, GenTextures(1, &tex->name));
 
-  OGL(BindTexture(GL_TEXTURE_2D, tex->name));
-  OGL(TexParameteri
+  OGL(ctxt, BindTexture(GL_TEXTURE_2D, tex->name));
+  OGL(ctxt, TexParameteri
     (GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)(desc->mip_count - 1)));
-  OGL(BindTexture
+  OGL(ctxt, BindTexture
     (GL_TEXTURE_2D,
      ctxt->state_cache.texture_binding_2d[ctxt->state_cache.active_texture]));
 
@@ -260,7 +266,7 @@ rb_tex2d_ref_get(struct rb_tex2d* tex)
 {
   if(!tex)
     return -1;
-  ref_get(&tex->ref);
+  rb_ogl3_ref_get(&tex->ref);
   return 0;
 }
 
@@ -269,7 +275,7 @@ rb_tex2d_ref_put(struct rb_tex2d* tex)
 {
   if(!tex)
     return -1;
-  ref_put(&tex->ref, release_tex2d);
+  rb_ogl3_ref_put(tex->ctxt, &tex->ref);
   return 0;
 }
 
@@ -281,14 +287,15 @@ rb_bind_tex2d
 {
   if(!ctxt || tex_unit > RB_OGL3_MAX_TEXTURE_UNITS)
     return -1;
+  rb_ogl3_sync_state_cache(ctxt);
 
   if(tex_unit != ctxt->state_cache.active_texture) {
     ctxt->state_cache.active_texture = GL_TEXTURE0 + tex_unit;
-    OGL(ActiveTexture(ctxt->state_cache.active_texture));
+    OGL(ctxt, ActiveTexture(ctxt->state_cache.active_texture));
   }
 
   ctxt->state_cache.texture_binding_2d[tex_unit] = tex ? tex->name : 0;
-  OGL(BindTexture
+  OGL(ctxt, BindTexture
     (GL_TEXTURE_2D, ctxt->state_cache.texture_binding_2d[tex_unit]));
   return 0;
 }
@@ -303,13 +310,14 @@ rb_tex2d_data(struct rb_tex2d* tex, unsigned int level, const void* data)
 
   if(!tex || level > tex->mip_count)
     return -1;
+  rb_ogl3_sync_state_cache(tex->ctxt);
   state_cache = &tex->ctxt->state_cache;
   mip_level = tex->mip_list + level;
   pixel_size = rb_ogl3_sizeof_pixel(tex->format, tex->type);
   mip_size = mip_level->width * mip_level->height * pixel_size;
 
   #define TEX_IMAGE_2D(data)                                                   \
-    OGL(TexImage2D                                                             \
+    OGL(tex->ctxt, TexImage2D                                                  \
       (GL_TEXTURE_2D,                                                          \
        (GLint)level,                                                           \
        (GLint)tex->internal_format,                                            \
@@ -320,33 +328,33 @@ rb_tex2d_data(struct rb_tex2d* tex, unsigned int level, const void* data)
        tex->type,                                                              \
        data))
 
-  OGL(BindTexture(GL_TEXTURE_2D, tex->name));
+  OGL(tex->ctxt, BindTexture(GL_TEXTURE_2D, tex->name));
 
   /* We assume that the default pixel storage alignment is set to 4. */
   if(NULL == tex->pixbuf || NULL == data) {
     if(pixel_size == 4) {
       TEX_IMAGE_2D(data);
     } else {
-      OGL(PixelStorei(GL_UNPACK_ALIGNMENT, 1));
+      OGL(tex->ctxt, PixelStorei(GL_UNPACK_ALIGNMENT, 1));
       TEX_IMAGE_2D(data);
-      OGL(PixelStorei(GL_UNPACK_ALIGNMENT, 4));
+      OGL(tex->ctxt, PixelStorei(GL_UNPACK_ALIGNMENT, 4));
     }
   } else {
     RB(buffer_data
       (tex->pixbuf, (int)mip_level->pixbuf_offset, (int)mip_size, data));
-    OGL(BindBuffer(tex->pixbuf->target, tex->pixbuf->name));
+    OGL(tex->ctxt, BindBuffer(tex->pixbuf->target, tex->pixbuf->name));
     if(pixel_size == 4) {
       TEX_IMAGE_2D(BUFFER_OFFSET(mip_level->pixbuf_offset));
     }  else {
-      OGL(PixelStorei(GL_UNPACK_ALIGNMENT, 1));
+      OGL(tex->ctxt, PixelStorei(GL_UNPACK_ALIGNMENT, 1));
       TEX_IMAGE_2D(BUFFER_OFFSET(mip_level->pixbuf_offset));
-      OGL(PixelStorei(GL_UNPACK_ALIGNMENT, 4));
+      OGL(tex->ctxt, PixelStorei(GL_UNPACK_ALIGNMENT, 4));
     }
-    OGL(BindBuffer
+    OGL(tex->ctxt, BindBuffer
       (tex->pixbuf->target,
        state_cache->buffer_binding[tex->pixbuf->binding]));
   }
-  OGL(BindTexture
+  OGL(tex->ctxt, BindTexture
     (GL_TEXTURE_2D,
      state_cache->texture_binding_2d[state_cache->active_texture]));
 
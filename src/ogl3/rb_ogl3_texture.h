@@ -2,7 +2,6 @@
 #define RB_OGL3_TEXTURE_H
 
 #include "ogl3/rb_ogl3.h"
-#include <snlsys/ref_count.h>
 #include <snlsys/snlsys.h>
 
 struct rb_context;
@@ -14,7 +13,7 @@ struct mip_level {
 };
 
 struct rb_tex2d {
-  struct ref ref;
+  struct rb_ogl3_ref ref;
   struct rb_context* ctxt;
   struct rb_buffer* pixbuf;
   struct mip_level* mip_list;
@@ -9,14 +9,13 @@
 #include <string.h>
 
 struct rb_uniform {
-  struct ref ref;
+  struct rb_ogl3_ref ref;
   struct rb_context* ctxt;
-  GLint location;
-  GLuint index;
-  GLenum type;
   struct rb_program* program;
-  char* name;
-  void (*set)(GLint location, int nb, const void* data);
+  struct rb_ogl3_reflection* reflection;
+  const struct rb_ogl3_variable* var; /* Lies in the reflection. */
+  void (*set)
+    (struct rb_context* ctxt, GLint location, int nb, const void* data);
 };
 
 /*******************************************************************************
@@ -26,16 +25,18 @@ struct rb_uniform {
  ******************************************************************************/
 #define UNIFORM_VALUE(suffix)\
   static void\
-  uniform_##suffix(GLint location, int nb, const void* data)\
+  uniform_##suffix\
+    (struct rb_context* ctxt, GLint location, int nb, const void* data)\
   {\
-    OGL(Uniform##suffix(location, nb, data));\
+    OGL(ctxt, Uniform##suffix(location, nb, data));\
   }\
 
 #define UNIFORM_MATRIX_VALUE(suffix)\
   static void\
-  uniform_matrix_##suffix(GLint location, int nb, const void* data)\
+  uniform_matrix_##suffix\
+    (struct rb_context* ctxt, GLint location, int nb, const void* data)\
   {\
-    OGL(UniformMatrix##suffix(location, nb, GL_FALSE, data));\
+    OGL(ctxt, UniformMatrix##suffix(location, nb, GL_FALSE, data));\
   }\
 
 UNIFORM_VALUE(1fv)
@@ -49,7 +50,8 @@ UNIFORM_MATRIX_VALUE(3fv)
 UNIFORM_MATRIX_VALUE(4fv)
 
 static void
-(*get_uniform_setter(GLenum uniform_type))(GLint, int, const void*)
+(*get_uniform_setter(GLenum uniform_type))
+  (struct rb_context*, GLint, int, const void*)
 {
   switch(uniform_type) {
     case GL_FLOAT: return &uniform_1fv; break;
@@ -73,91 +75,47 @@ static void
   }
 }
 
+static void
+release_uniform(struct rb_ogl3_ref* ref)
+{
+  struct rb_context* ctxt = NULL;
+  struct rb_uniform* uniform = NULL;
+  ASSERT(ref);
+
+  uniform = CONTAINER_OF(ref, struct rb_uniform, ref);
+  ctxt = uniform->ctxt;
+
+  RB(program_ref_put(uniform->program));
+  rb_ogl3_reflection_ref_put(uniform->reflection);
+  rb_ogl3_free_object(ctxt, RB_OBJECT_UNIFORM, uniform);
+  RB(context_ref_put(ctxt));
+}
+
 static int
-get_active_uniform
+create_uniform
   (struct rb_context* ctxt,
    struct rb_program* program,
-   GLuint index,
-   GLsizei bufsize,
-   GLchar* buffer,
+   const struct rb_ogl3_variable* var,
    struct rb_uniform** out_uniform)
 {
   struct rb_uniform* uniform = NULL;
-  GLsizei uniform_namelen = 0;
-  GLint uniform_size = 0;
-  GLenum uniform_type;
-  int err = 0;
-
-  if(!ctxt
-  || !program
-  || !out_uniform
-  || bufsize < 0
-  || (bufsize && !buffer))
-    goto error;
+  ASSERT(ctxt && program && program->reflection && var && out_uniform);
 
-  OGL(GetActiveUniform
-      (program->name,
-       index,
-       bufsize,
-       &uniform_namelen,
-       &uniform_size,
-       &uniform_type,
-       buffer));
-
-  uniform = MEM_CALLOC(ctxt->allocator, 1, sizeof(struct rb_uniform));
+  uniform = rb_ogl3_alloc_object
+    (ctxt, RB_OBJECT_UNIFORM, sizeof(struct rb_uniform));
   if(!uniform)
-    goto error;
-  ref_init(&uniform->ref);
+    return -1;
+  rb_ogl3_ref_init(&uniform->ref, release_uniform);
   RB(context_ref_get(ctxt));
   uniform->ctxt = ctxt;
   RB(program_ref_get(program));
   uniform->program = program;
-  uniform->index = index;
-  uniform->type = uniform_type;
-  uniform->set = get_uniform_setter(uniform_type);
-
-  if(buffer) {
-    /* Add 1 to namelen <=> include the null character. */
-    ++uniform_namelen;
-
-    uniform->name = MEM_ALLOC
-      (ctxt->allocator, sizeof(char) * (size_t)uniform_namelen);
-    if(!uniform->name)
-      goto error;
-
-    uniform->name = strncpy(uniform->name, buffer, (size_t)uniform_namelen);
-    uniform->location = OGL(GetUniformLocation(program->name, uniform->name));
-  }
-
-exit:
+  rb_ogl3_reflection_ref_get(program->reflection);
+  uniform->reflection = program->reflection;
+  uniform->var = var;
+  uniform->set = get_uniform_setter(var->type);
   *out_uniform = uniform;
-  return err;
-
-error:
-  if(uniform) {
-    RB(uniform_ref_put(uniform));
-    uniform = NULL;
-  }
-  err = -1;
-  goto exit;
-}
-
-static void
-release_uniform(struct ref* ref)
-{
-  struct rb_context* ctxt = NULL;
-  struct rb_uniform* uniform = NULL;
-  ASSERT(ref);
-
-  uniform = CONTAINER_OF(ref, struct rb_uniform, ref);
-  ctxt = uniform->ctxt;
-
-  if(uniform->program)
-    RB(program_ref_put(uniform->program));
-  if(uniform->name)
-    MEM_FREE(ctxt->allocator, uniform->name);
-  MEM_FREE(ctxt->allocator, uniform);
-  RB(context_ref_put(ctxt));
+  return 0;
 }
 
 /*******************************************************************************
@@ -172,44 +130,18 @@ rb_get_named_uniform
    const char* name,
    struct rb_uniform** out_uniform)
 {
-  struct rb_uniform* uniform = NULL;
-  GLuint uniform_index = GL_INVALID_INDEX;
-  size_t name_len = 0;
-  int err = 0;
+  const struct rb_ogl3_variable* var = NULL;
 
   if(!ctxt || !program || !name || !out_uniform)
-    goto error;
-
-  if(!program->is_linked)
-    goto error;
-
-  OGL(GetUniformIndices(program->name, 1, &name, &uniform_index));
-  if(uniform_index == GL_INVALID_INDEX)
-    goto error;
-
-  err = get_active_uniform(ctxt, program, uniform_index, 0, NULL, &uniform);
-  if(err != 0)
-    goto error;
-
-  name_len = strlen(name) + 1;
-  uniform->name = MEM_ALLOC(ctxt->allocator, sizeof(char) * name_len);
-  if(!uniform->name)
-    goto error;
-
-  uniform->name = strncpy(uniform->name, name, name_len);
-  uniform->location = OGL(GetUniformLocation(program->name, uniform->name));
+    return -1;
 
-exit:
-  *out_uniform = uniform;
-  return err;
+  if(rb_ogl3_sync_program(program) != 0)
+    return -1;
 
-error:
-  if(uniform) {
-    RB(uniform_ref_put(uniform));
-    uniform = NULL;
-  }
-  err = -1;
-  goto exit;
+  var = rb_ogl3_find_uniform(program->reflection, name);
+  if(!var)
+    return -1;
+  return create_uniform(ctxt, program, var, out_uniform);
 }
 
 int
@@ -219,52 +151,36 @@ rb_get_uniforms
    size_t* out_nb_uniforms,
    struct rb_uniform* dst_uniform_list[])
 {
-  GLchar* uniform_buffer = NULL;
-  unsigned int uniform_id = 0;
-  int uniform_buflen = 0;
-  int nb_uniforms = 0;
+  size_t nb_uniforms = 0;
+  size_t uniform_id = 0;
   int err = 0;
 
   if(!ctxt || !prog || !out_nb_uniforms)
     goto error;
 
-  if(!prog->is_linked)
+  if(rb_ogl3_sync_program(prog) != 0)
     goto error;
 
-  OGL(GetProgramiv(prog->name, GL_ACTIVE_UNIFORMS, &nb_uniforms));
-  ASSERT(nb_uniforms >= 0);
-
+  nb_uniforms = prog->reflection->nb_uniforms;
   if(dst_uniform_list) {
-      OGL(GetProgramiv
-        (prog->name, GL_ACTIVE_UNIFORM_MAX_LENGTH, &uniform_buflen));
-    uniform_buffer = MEM_ALLOC
-      (ctxt->allocator, sizeof(GLchar) * (size_t)uniform_buflen);
-    if(!uniform_buffer)
-      goto error;
-
-    for(uniform_id = 0; uniform_id < (unsigned int)nb_uniforms; ++uniform_id) {
-      struct rb_uniform* uniform = NULL;
-
-      err = get_active_uniform
-        (ctxt, prog, uniform_id, uniform_buflen, uniform_buffer, &uniform);
+    for(uniform_id = 0; uniform_id < nb_uniforms; ++uniform_id) {
+      err = create_uniform
+        (ctxt, prog, prog->reflection->uniform_list + uniform_id,
+         dst_uniform_list + uniform_id);
       if(err != 0)
         goto error;
-
-      dst_uniform_list[uniform_id] = uniform;
     }
   }
 
 exit:
-  if(uniform_buffer)
-    MEM_FREE(ctxt->allocator, uniform_buffer);
   if(out_nb_uniforms)
-    *out_nb_uniforms = (size_t)nb_uniforms;
+    *out_nb_uniforms = nb_uniforms;
   return err;
 
 error:
   if(dst_uniform_list) {
     /* NOTE: uniform_id <=> nb uniforms in dst_uniform_list; */
-    unsigned int i = 0;
+    size_t i = 0;
     for(i = 0; i < uniform_id; ++i) {
       RB(uniform_ref_put(dst_uniform_list[i]));
       dst_uniform_list[i] = NULL;
@@ -280,7 +196,7 @@ rb_uniform_ref_get(struct rb_uniform* uniform)
 {
   if(!uniform)
     return -1;
-  ref_get(&uniform->ref);
+  rb_ogl3_ref_get(&uniform->ref);
   return 0;
 }
 
@@ -289,7 +205,7 @@ rb_uniform_ref_put(struct rb_uniform* uniform)
 {
   if(!uniform)
     return -1;
-  ref_put(&uniform->ref, release_uniform);
+  rb_ogl3_ref_put(uniform->ctxt, &uniform->ref);
   return 0;
 }
 
@@ -300,11 +216,14 @@ rb_uniform_data(struct rb_uniform* uniform, int nb, const void* data)
     return -1;
   if(nb <= 0)
     return -1;
+  /* The members of a uniform block are set through its buffer. */
+  if(uniform->var->location < 0)
+    return -1;
 
   ASSERT(uniform->set != NULL);
-  OGL(UseProgram(uniform->program->name));
-  uniform->set(uniform->location, nb, data);
-  OGL(UseProgram(uniform->ctxt->state_cache.current_program));
+  OGL(uniform->ctxt, UseProgram(uniform->program->name));
+  uniform->set(uniform->ctxt, uniform->var->location, nb, data);
+  OGL(uniform->ctxt, UseProgram(uniform->ctxt->state_cache.current_program));
   return 0;
 }
 
@@ -313,8 +232,33 @@ rb_get_uniform_desc(struct rb_uniform* uniform, struct rb_uniform_desc* desc)
 {
   if(!uniform || !desc)
     return -1;
-  desc->name = uniform->name;
-  desc->type = ogl3_to_rb_type(uniform->type);
+  desc->name = uniform->var->name;
+  desc->type = ogl3_to_rb_type(uniform->var->type);
   return 0;
 }
 
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+size_t
+rb_ogl3_sizeof_uniform_data(const struct rb_uniform* uniform, int count)
+{
+  size_t size = 0;
+  ASSERT(uniform && count > 0);
+
+  if(uniform->var->location < 0)
+    return 0;
+  switch(uniform->var->type) {
+    case GL_FLOAT: size = sizeof(GLfloat); break;
+    case GL_FLOAT_VEC2: size = 2 * sizeof(GLfloat); break;
+    case GL_FLOAT_VEC3: size = 3 * sizeof(GLfloat); break;
+    case GL_FLOAT_VEC4: size = 4 * sizeof(GLfloat); break;
+    case GL_FLOAT_MAT2: size = 4 * sizeof(GLfloat); break;
+    case GL_FLOAT_MAT3: size = 9 * sizeof(GLfloat); break;
+    case GL_FLOAT_MAT4: size = 16 * sizeof(GLfloat); break;
+    default: size = sizeof(GLint); break; /* Unsigned integer or sampler. */
+  }
+  return size * (size_t)count;
+}
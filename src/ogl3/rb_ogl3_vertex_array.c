@@ -8,7 +8,7 @@
 #include <stdlib.h>
 
 struct rb_vertex_array {
-  struct ref ref;
+  struct rb_ogl3_ref ref;
   struct rb_context* ctxt;
   GLuint name;
 };
@@ -36,7 +36,7 @@ ogl3_attrib_nb_components(enum rb_type type)
 }
 
 static void
-release_vertex_array(struct ref* ref)
+release_vertex_array(struct rb_ogl3_ref* ref)
 {
   struct rb_context* ctxt = NULL;
   struct rb_vertex_array* varray = NULL;
@@ -48,8 +48,8 @@ release_vertex_array(struct ref* ref)
   if(ctxt->state_cache.vertex_array_binding == varray->name)
     RB(bind_vertex_array(ctxt, NULL));
 
-  OGL(DeleteVertexArrays(1, &varray->name));
-  MEM_FREE(ctxt->allocator, varray);
+  OGL(ctxt, DeleteVertexArrays(1, &varray->name));
+  rb_ogl3_free_object(ctxt, RB_OBJECT_VERTEX_ARRAY, varray);
   RB(context_ref_put(ctxt));
 }
 
@@ -68,14 +68,15 @@ rb_create_vertex_array
   if(!ctxt || !out_array)
     return -1;
 
-  array = MEM_ALLOC(ctxt->allocator, sizeof(struct rb_vertex_array));
+  array = rb_ogl3_alloc_object
+    (ctxt, RB_OBJECT_VERTEX_ARRAY, sizeof(struct rb_vertex_array));
   if(!array)
     return -1;
-  ref_init(&array->ref);
+  rb_ogl3_ref_init(&array->ref, release_vertex_array);
   RB(context_ref_get(ctxt));
   array->ctxt = ctxt;
 
-  OGL(GenVertexArrays(1, &array->name));
+  OGL(ctxt, GenVertexArrays(1, &array->name));
   *out_array = array;
   return 0;
 }
@@ -85,7 +86,7 @@ rb_vertex_array_ref_get(struct rb_vertex_array* array)
 {
   if(!array)
     return -1;
-  ref_get(&array->ref);
+  rb_ogl3_ref_get(&array->ref);
   return 0;
 }
 
@@ -94,7 +95,7 @@ rb_vertex_array_ref_put(struct rb_vertex_array* array)
 {
   if(!array)
     return -1;
-  ref_put(&array->ref, release_vertex_array);
+  rb_ogl3_ref_put(array->ctxt, &array->ref);
   return 0;
 }
 
@@ -104,7 +105,7 @@ rb_bind_vertex_array(struct rb_context* ctxt, struct rb_vertex_array* array)
   if(!ctxt)
     return -1;
   ctxt->state_cache.vertex_array_binding = array ? array->name : 0;
-  OGL(BindVertexArray(ctxt->state_cache.vertex_array_binding));
+  OGL(ctxt, BindVertexArray(ctxt->state_cache.vertex_array_binding));
   return 0;
 }
 
@@ -126,21 +127,22 @@ rb_vertex_attrib_array
   || buffer->target != GL_ARRAY_BUFFER)
     goto error;
 
-  OGL(BindVertexArray(array->name));
-  OGL(BindBuffer(buffer->target, buffer->name));
+  rb_ogl3_sync_state_cache(array->ctxt);
+  OGL(array->ctxt, BindVertexArray(array->name));
+  OGL(array->ctxt, BindBuffer(buffer->target, buffer->name));
 
   for(i=0; i < count; ++i) {
 
     if(attrib[i].type == RB_UNKNOWN_TYPE) {
-      OGL(BindBuffer
+      OGL(array->ctxt, BindBuffer
         (buffer->target, 
          array->ctxt->state_cache.buffer_binding[buffer->binding]));
       goto error;
     }
 
     offset = (intptr_t)attrib[i].offset;
-    OGL(EnableVertexAttribArray((GLuint)attrib[i].index));
-    OGL(VertexAttribPointer
+    OGL(array->ctxt, EnableVertexAttribArray((GLuint)attrib[i].index));
+    OGL(array->ctxt, VertexAttribPointer
         ((GLuint)attrib[i].index,
          ogl3_attrib_nb_components(attrib[i].type),
          GL_FLOAT,
@@ -149,8 +151,9 @@ rb_vertex_attrib_array
          (void*)offset));
   }
 
-  OGL(BindVertexArray(array->ctxt->state_cache.vertex_array_binding));
-  OGL(BindBuffer
+  OGL(array->ctxt, BindVertexArray
+    (array->ctxt->state_cache.vertex_array_binding));
+  OGL(array->ctxt, BindBuffer
     (buffer->target, array->ctxt->state_cache.buffer_binding[buffer->binding]));
 
 exit:
@@ -175,16 +178,17 @@ rb_remove_vertex_attrib
   || (count > 0 && !list_of_attrib_indices))
     return -1;
 
-  OGL(BindVertexArray(array->name));
+  OGL(array->ctxt, BindVertexArray(array->name));
   for(i = 0; i < count; ++i) {
     const int current_attrib = list_of_attrib_indices[i];
     if(current_attrib < 0) {
       err = -1;
     } else {
-      OGL(DisableVertexAttribArray((GLuint)current_attrib));
+      OGL(array->ctxt, DisableVertexAttribArray((GLuint)current_attrib));
     }
   }
-  OGL(BindVertexArray(array->ctxt->state_cache.vertex_array_binding));
+  OGL(array->ctxt, BindVertexArray
+    (array->ctxt->state_cache.vertex_array_binding));
 
   return err;
 }
@@ -195,12 +199,15 @@ rb_vertex_index_array(struct rb_vertex_array* array, struct rb_buffer* buffer)
   if(!array || (buffer && buffer->target != GL_ELEMENT_ARRAY_BUFFER))
     return -1;
 
-  OGL(BindVertexArray(array->name));
-  OGL(BindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer ? buffer->name : 0));
-  OGL(BindVertexArray(array->ctxt->state_cache.vertex_array_binding));
-  OGL(BindBuffer
-    (GL_ELEMENT_ARRAY_BUFFER,
-     array->ctxt->state_cache.buffer_binding[RB_OGL3_BIND_INDEX_BUFFER]));
+  /* The element array buffer binding is a state of the vertex array object.
+   * It is thus restored by the re-binding of the current vertex array and
+   * must not be overwritten since it would modify the index buffer of the
+   * current vertex array. */
+  OGL(array->ctxt, BindVertexArray(array->name));
+  OGL(array->ctxt, BindBuffer
+    (GL_ELEMENT_ARRAY_BUFFER, buffer ? buffer->name : 0));
+  OGL(array->ctxt, BindVertexArray
+    (array->ctxt->state_cache.vertex_array_binding));
 
   return 0;
 }
@@ -0,0 +1,118 @@
+#include "rb.h"
+#include <snlsys/snlsys.h>
+#include <pthread.h>
+#include <stddef.h>
+
+#define NB_LOADERS 4
+#define NB_OBJECTS 256 /* Objects of each type created by a loader. */
+
+/* Objects of a loader thread. The render thread puts them as soon as their
+ * creation is published, and thus while the loader still creates objects. */
+struct loader {
+  pthread_t thread;
+  struct rb_context* ctxt;
+  struct rb_buffer* buffer_list[NB_OBJECTS];
+  struct rb_tex2d* tex_list[NB_OBJECTS];
+  struct rb_fence* fence_list[NB_OBJECTS];
+  int nb_created; /* Atomically updated. */
+  int nb_put; /* Accessed by the render thread only. */
+  int is_done; /* Atomically updated. */
+  int err;
+};
+
+static struct rb_context* render_ctxt = NULL;
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static void*
+loader_func(void* arg)
+{
+  const float vertices[9] = { -1.f,-1.f,0.f, 1.f,-1.f,0.f, -1.f,1.f,0.f };
+  const struct rb_buffer_desc buffer_desc =
+    { sizeof(vertices), RB_BIND_VERTEX_BUFFER, RB_USAGE_IMMUTABLE };
+  const struct rb_tex2d_desc tex_desc =
+    { 4, 4, 1, RB_RGBA, RB_USAGE_DEFAULT, 0 };
+  static const unsigned char texels[4 * 4 * 4];
+  const void* mip_data[1] = { texels };
+  struct loader* loader = arg;
+  int i = 0;
+
+  /* The loader contexts concurrently join the share group. */
+  loader->err = rb_create_loader_context(render_ctxt, &loader->ctxt);
+  for(i = 0; !loader->err && i < NB_OBJECTS; ++i) {
+    loader->err =
+       rb_create_buffer
+        (loader->ctxt, &buffer_desc, vertices, loader->buffer_list + i)
+    || rb_create_tex2d
+        (loader->ctxt, &tex_desc, mip_data, loader->tex_list + i)
+    || rb_create_fence(loader->ctxt, loader->fence_list + i);
+    if(!loader->err)
+      __atomic_store_n(&loader->nb_created, i + 1, __ATOMIC_RELEASE);
+  }
+  /* The last references onto the loader context are then put by the
+   * releases of its objects, run by the render thread. */
+  if(loader->ctxt)
+    loader->err |= rb_context_ref_put(loader->ctxt);
+  __atomic_store_n(&loader->is_done, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+/* Put the published objects of the loader. Return 1 if they are all put. */
+static int
+put_objects(struct loader* loader)
+{
+  const int is_done = __atomic_load_n(&loader->is_done, __ATOMIC_ACQUIRE);
+  const int nb_created =
+    __atomic_load_n(&loader->nb_created, __ATOMIC_ACQUIRE);
+
+  for(; loader->nb_put < nb_created; ++loader->nb_put) {
+    const int i = loader->nb_put;
+    CHECK(rb_buffer_ref_put(loader->buffer_list[i]), 0);
+    CHECK(rb_tex2d_ref_put(loader->tex_list[i]), 0);
+    CHECK(rb_fence_ref_put(loader->fence_list[i]), 0);
+  }
+  return is_done;
+}
+
+/*******************************************************************************
+ *
+ * Loader test.
+ *
+ ******************************************************************************/
+int
+main(int argc, char** argv)
+{
+  const struct rb_headless_desc headless_desc = { 64, 64 };
+  static struct loader loader_list[NB_LOADERS];
+  int nb_done = 0;
+  int i = 0;
+  (void)argc, (void)argv;
+
+  CHECK(rb_create_headless_context(NULL, &headless_desc, &render_ctxt), 0);
+  for(i = 0; i < NB_LOADERS; ++i) {
+    CHECK(pthread_create
+      (&loader_list[i].thread, NULL, loader_func, loader_list + i), 0);
+  }
+
+  /* The render thread runs the deferred releases of the loader objects, and
+   * thus puts the references of the loader contexts, while the loaders get
+   * new references on the creation of their objects. */
+  while(nb_done < NB_LOADERS) {
+    nb_done = 0;
+    for(i = 0; i < NB_LOADERS; ++i)
+      nb_done += put_objects(loader_list + i);
+    CHECK(rb_flush(render_ctxt), 0);
+  }
+  for(i = 0; i < NB_LOADERS; ++i) {
+    CHECK(pthread_join(loader_list[i].thread, NULL), 0);
+    CHECK(loader_list[i].err, 0);
+    CHECK(put_objects(loader_list + i), 1);
+    CHECK(loader_list[i].nb_put, NB_OBJECTS);
+  }
+  CHECK(rb_flush(render_ctxt), 0);
+  CHECK(rb_context_ref_put(render_ctxt), 0);
+  return 0;
+}
@@ -0,0 +1,2668 @@
+#include "proxy/rb_proxy_ring.h"
+#include "rbi/rbi.h"
+#include "rb.h"
+#include <snlsys/math.h>
+#include <snlsys/snlsys.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Default and minimum size in bytes of the call ring. */
+#define RING_SIZE (4 * 1024 * 1024)
+#define MIN_RING_SIZE (64 * 1024)
+
+/* Call executed by the render thread. The arguments of the call follow it in
+ * memory and are themselves followed by its payload, i.e. the data that are
+ * copied from the caller memory. */
+struct call {
+  int (*exec)(struct call* call);
+  void* heap; /* Payload too large for the ring. Freed once executed. */
+};
+
+/* Header of the calls recorded into the stream of a command buffer. */
+struct command {
+  size_t size; /* Size in bytes of the command, header included. */
+  size_t padding;
+};
+
+/* Header of the proxy objects returned to the caller. The backend object is
+ * created, used and released by the render thread only. */
+struct handle {
+  void* real; /* Backend object. NULL if its creation failed. */
+  int ref; /* Atomically updated. */
+  /* Release of a proxy whose last reference is put by another thread than the
+   * caller one. */
+  int (*release)(void* obj);
+  struct handle* next_release;
+};
+
+struct rb_context { struct handle handle; };
+struct rb_sampler { struct handle handle; };
+struct rb_buffer { struct handle handle; };
+struct rb_vertex_array { struct handle handle; };
+struct rb_shader { struct handle handle; };
+struct rb_program { struct handle handle; };
+struct rb_framebuffer { struct handle handle; };
+struct rb_bundle { struct handle handle; };
+struct rb_fence { struct handle handle; };
+
+/* The layout of the textures and the type of the program variables define
+ * the size of the data copied into the ring. */
+struct rb_tex2d {
+  struct handle handle;
+  struct rb_tex2d_desc desc;
+};
+
+struct rb_uniform {
+  struct handle handle;
+  enum rb_type type;
+};
+
+struct rb_attrib {
+  struct handle handle;
+  enum rb_type type;
+};
+
+/* The commands are recorded by the proxy into a stream that is moved into the
+ * ring on submission. They are thus recorded without synchronization. */
+struct rb_command_buffer {
+  struct handle handle;
+  unsigned char* stream;
+  size_t size;
+  size_t capacity;
+};
+
+/* The proxy is a process wide state since several rb functions are not bound
+ * to a context. The calls are issued by a single thread, the command buffer
+ * recording and the reference counting excepted, and are executed in order by
+ * the render thread. */
+static struct proxy {
+  struct rbi rbi; /* Proxied backend. */
+  int is_layer; /* The proxied functions are those of the next rbi layer. */
+  struct rb_proxy_ring ring;
+  pthread_t thread;
+  pthread_t caller; /* Thread that issues the calls. */
+  /* Proxies put by other threads than the caller one. Atomically updated. */
+  struct handle* release_list;
+  int is_running; /* Render thread only. */
+  size_t nb_errors; /* Failed asynchronous calls. Atomically updated. */
+  int is_init;
+} proxy;
+
+/* Backend object of a proxy. May be used by the render thread only. */
+#define REAL(obj) ((obj) ? (obj)->handle.real : NULL)
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static FINLINE size_t
+align_size(size_t size)
+{
+  return (size + RB_PROXY_RING_ALIGNMENT - 1)
+    & ~((size_t)RB_PROXY_RING_ALIGNMENT - 1);
+}
+
+static void*
+new_handle(size_t size, void* real)
+{
+  struct handle* handle = calloc(1, size);
+  if(handle) {
+    handle->real = real;
+    handle->ref = 1;
+  }
+  return handle;
+}
+
+static size_t
+sizeof_type(enum rb_type type)
+{
+  switch(type) {
+    case RB_FLOAT: return sizeof(float);
+    case RB_FLOAT2: return 2 * sizeof(float);
+    case RB_FLOAT3: return 3 * sizeof(float);
+    case RB_FLOAT4: return 4 * sizeof(float);
+    case RB_FLOAT4x4: return 16 * sizeof(float);
+    /* Samplers and scalar integers are the most common unknown types. */
+    default: return sizeof(int32_t);
+  }
+}
+
+/* Size of a pixel as read by the backends. Note that the integer formats
+ * store each component on 32-bits. */
+static size_t
+sizeof_pixel(enum rb_tex_format fmt)
+{
+  switch(fmt) {
+    case RB_R: return 1;
+    case RB_RGB: case RB_SRGB: return 3;
+    case RB_RGBA: case RB_SRGBA: return 4;
+    case RB_R_UINT16: case RB_R_UINT32: return 4;
+    case RB_RG_UINT16: case RB_RG_UINT32: return 8;
+    case RB_RGB_UINT16: case RB_RGB_UINT32: return 12;
+    case RB_RGBA_UINT16: case RB_RGBA_UINT32: return 16;
+    case RB_DEPTH_COMPONENT: case RB_DEPTH_STENCIL: return 4;
+    default: return 0;
+  }
+}
+
+static size_t
+sizeof_mip_level(const struct rb_tex2d_desc* desc, unsigned int level)
+{
+  ASSERT(desc && level < 32);
+  return
+    MAX(desc->width >> level, 1u)
+  * MAX(desc->height >> level, 1u)
+  * sizeof_pixel(desc->format);
+}
+
+/* Reserve a call of `size' bytes followed by `payload_size' bytes of payload.
+ * The payload that does not fit into the ring is allocated on the heap. */
+static struct call*
+begin_call
+  (int (*exec)(struct call*),
+   size_t size,
+   size_t payload_size,
+   void** payload)
+{
+  struct call* call = NULL;
+  void* heap = NULL;
+  ASSERT(exec && size >= sizeof(struct call));
+
+  if(UNLIKELY(!proxy.is_init))
+    return NULL;
+  size = align_size(size);
+  if(size + payload_size > rb_proxy_ring_max_record_size(&proxy.ring)) {
+    heap = malloc(payload_size);
+    if(!heap)
+      return NULL;
+    payload_size = 0;
+  }
+  call = rb_proxy_ring_reserve(&proxy.ring, size + payload_size);
+  call->exec = exec;
+  call->heap = heap;
+  if(payload)
+    *payload = heap ? heap : (unsigned char*)call + size;
+  return call;
+}
+
+/* Reserve a command of `size' bytes followed by `payload_size' bytes of
+ * payload into the stream of the command buffer. The payload of a command
+ * immediately follows its arguments since the stream is moved. */
+static struct call*
+record_command
+  (struct rb_command_buffer* cmd,
+   int (*exec)(struct call*),
+   size_t size,
+   size_t payload_size)
+{
+  struct command* command = NULL;
+  struct call* call = NULL;
+  size_t command_size = 0;
+  ASSERT(cmd && exec && size >= sizeof(struct call));
+
+  command_size =
+    sizeof(struct command) + align_size(size) + align_size(payload_size);
+  if(cmd->size + command_size > cmd->capacity) {
+    const size_t capacity =
+      MAX(MAX(cmd->capacity * 2, cmd->size + command_size), 1024);
+    unsigned char* stream = realloc(cmd->stream, capacity);
+    if(!stream)
+      return NULL;
+    cmd->stream = stream;
+    cmd->capacity = capacity;
+  }
+  command = (struct command*)(cmd->stream + cmd->size);
+  command->size = command_size;
+  cmd->size += command_size;
+  call = (struct call*)(command + 1);
+  call->exec = exec;
+  call->heap = NULL;
+  return call;
+}
+
+/* Execute the `size' bytes of commands moved from a command buffer stream. */
+static int
+replay_commands(unsigned char* stream, size_t size)
+{
+  unsigned char* end = stream + size;
+  int err = 0;
+  ASSERT(stream || !size);
+
+  while(stream < end) {
+    struct command* command = (struct command*)stream;
+    struct call* call = (struct call*)(command + 1);
+    if(call->exec(call) != 0)
+      err = -1;
+    stream += command->size;
+  }
+  return err;
+}
+
+/* Payload of a recorded command. */
+#define COMMAND_PAYLOAD(args)                                                  \
+  ((void*)((unsigned char*)(args) + align_size(sizeof(*(args)))))
+
+static void*
+render_thread(void* arg)
+{
+  struct call* call = NULL;
+  (void)arg;
+
+  while(proxy.is_running) {
+    call = rb_proxy_ring_front(&proxy.ring);
+    if(call->exec(call) != 0)
+      __atomic_add_fetch(&proxy.nb_errors, 1, __ATOMIC_RELAXED);
+    free(call->heap);
+    rb_proxy_ring_pop(&proxy.ring);
+  }
+  return NULL;
+}
+
+static int
+exec_quit(struct call* call)
+{
+  (void)call;
+  proxy.is_running = 0;
+  return 0;
+}
+
+/* A synchronous call keeps its arguments onto the caller stack. The caller
+ * waits for the render thread to execute it and its result is returned. */
+struct sync_args {
+  struct call call;
+  struct call* target;
+  int* err;
+};
+
+static int
+exec_sync(struct call* call)
+{
+  struct sync_args* args = (struct sync_args*)call;
+  *args->err = args->target->exec(args->target);
+  return 0;
+}
+
+static int
+run_sync(struct call* target)
+{
+  struct sync_args* args = NULL;
+  int err = -1;
+  ASSERT(target && target->exec);
+
+  args = (struct sync_args*)begin_call
+    (exec_sync, sizeof(struct sync_args), 0, NULL);
+  if(!args)
+    return -1;
+  args->target = target;
+  args->err = &err;
+  rb_proxy_ring_wait(&proxy.ring, rb_proxy_ring_commit(&proxy.ring));
+  return err;
+}
+
+struct release_args {
+  struct call call;
+  struct handle* handle;
+};
+
+static int
+exec_release(struct call* call)
+{
+  struct release_args* args = (struct release_args*)call;
+  return args->handle->release(args->handle);
+}
+
+/* The proxies put by another thread than the caller one cannot be released
+ * through the ring that has a single producer. They are listed up to the
+ * next rb_flush or rb_end_frame of the caller. */
+static int
+put_handle(struct handle* handle, int (*release)(void*))
+{
+  struct release_args* args = NULL;
+  ASSERT(handle && release);
+
+  if(__atomic_sub_fetch(&handle->ref, 1, __ATOMIC_ACQ_REL))
+    return 0;
+  handle->release = release;
+  if(!pthread_equal(pthread_self(), proxy.caller)) {
+    handle->next_release =
+      __atomic_load_n(&proxy.release_list, __ATOMIC_RELAXED);
+    while(!__atomic_compare_exchange_n(&proxy.release_list,
+      &handle->next_release, handle, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return 0;
+  }
+  args = (struct release_args*)begin_call
+    (exec_release, sizeof(struct release_args), 0, NULL);
+  if(!args)
+    return -1;
+  args->handle = handle;
+  rb_proxy_ring_commit(&proxy.ring);
+  return 0;
+}
+
+static int
+exec_collect_releases(struct call* call)
+{
+  struct handle* handle = NULL;
+  int err = 0;
+  (void)call;
+
+  handle = __atomic_exchange_n(&proxy.release_list, NULL, __ATOMIC_ACQUIRE);
+  while(handle) {
+    struct handle* next = handle->next_release;
+    if(handle->release(handle) != 0)
+      err = -1;
+    handle = next;
+  }
+  return err;
+}
+
+static void
+collect_releases(void)
+{
+  if(!__atomic_load_n(&proxy.release_list, __ATOMIC_RELAXED))
+    return;
+  if(begin_call(exec_collect_releases, sizeof(struct call), 0, NULL))
+    rb_proxy_ring_commit(&proxy.ring);
+}
+
+static int
+init_proxy(void)
+{
+  const char* backend = getenv("RB_PROXY_BACKEND");
+  const char* ring_size = getenv("RB_PROXY_RING_SIZE");
+  size_t size = RING_SIZE;
+
+  if(!proxy.is_layer) {
+    if(!backend) {
+      fprintf(stderr,
+        "rb-proxy: the RB_PROXY_BACKEND variable is not set.\n");
+      return -1;
+    }
+    /* The layers of RBI_LAYERS are already applied by the outer loader. */
+    if(rbi_init_layers(backend, NULL, &proxy.rbi) != 0)
+      return -1;
+  }
+  if(ring_size) {
+    const long val = strtol(ring_size, NULL, 10);
+    if(val > 0)
+      size = MAX((size_t)val, (size_t)MIN_RING_SIZE);
+  }
+  if(rb_proxy_init_ring(size, &proxy.ring) != 0) {
+    fprintf(stderr, "rb-proxy: cannot allocate the call ring.\n");
+    goto error;
+  }
+  proxy.caller = pthread_self();
+  proxy.is_running = 1;
+  if(pthread_create(&proxy.thread, NULL, render_thread, NULL) != 0) {
+    fprintf(stderr, "rb-proxy: cannot spawn the render thread.\n");
+    goto error;
+  }
+  proxy.is_init = 1;
+  return 0;
+
+error:
+  rb_proxy_release_ring(&proxy.ring);
+  if(!proxy.is_layer)
+    rbi_shutdown(&proxy.rbi);
+  return -1;
+}
+
+static void __attribute__((destructor))
+shutdown_proxy(void)
+{
+  if(!proxy.is_init)
+    return;
+  /* The pending calls are executed before the render thread exits. */
+  collect_releases();
+  begin_call(exec_quit, sizeof(struct call), 0, NULL);
+  rb_proxy_ring_commit(&proxy.ring);
+  pthread_join(proxy.thread, NULL);
+  rb_proxy_release_ring(&proxy.ring);
+  if(!proxy.is_layer)
+    rbi_shutdown(&proxy.rbi);
+  memset(&proxy, 0, sizeof(proxy));
+}
+
+/*******************************************************************************
+ *
+ * rbi layer entry point.
+ *
+ ******************************************************************************/
+/* Loaded as a rbi layer, the proxy executes the functions of the next layer
+ * rather than those of the RB_PROXY_BACKEND library. */
+EXPORT_SYM int rbi_layer_next(const struct rbi* next);
+
+int
+rbi_layer_next(const struct rbi* next)
+{
+  if(!next || proxy.is_init || proxy.is_layer)
+    return -1;
+  proxy.rbi = *next;
+  proxy.is_layer = 1;
+  return 0;
+}
+
+/* Define the prologue/epilogue of the asynchronous functions. The payload of
+ * the call is returned into `payload'. */
+#define BEGIN_CALL(func, payload_size, payload)                                \
+  (struct func##_args*)begin_call                                              \
+    (exec_##func, sizeof(struct func##_args), payload_size, payload)
+
+#define END_CALL()                                                             \
+  rb_proxy_ring_commit(&proxy.ring);                                           \
+  return 0
+
+#define RECORD_COMMAND(cmd, func, payload_size)                                \
+  (struct func##_args*)record_command                                          \
+    (cmd, exec_##func, sizeof(struct func##_args), payload_size)
+
+/* Define the reference counting of a proxy. The backend object is put by the
+ * render thread once the proxy is no more referenced. */
+#define PROXY_REF_FUNCS(name)                                                  \
+  static int                                                                   \
+  release_##name(void* obj)                                                    \
+  {                                                                            \
+    struct rb_##name* proxied = obj;                                           \
+    int err = 0;                                                               \
+    if(proxied->handle.real)                                                   \
+      err = proxy.rbi.name##_ref_put(proxied->handle.real);                    \
+    free(proxied);                                                             \
+    return err;                                                                \
+  }                                                                            \
+                                                                               \
+  int                                                                          \
+  rb_##name##_ref_get(struct rb_##name* obj)                                   \
+  {                                                                            \
+    if(!obj)                                                                   \
+      return -1;                                                               \
+    __atomic_add_fetch(&obj->handle.ref, 1, __ATOMIC_RELAXED);                 \
+    return 0;                                                                  \
+  }                                                                            \
+                                                                               \
+  int                                                                          \
+  rb_##name##_ref_put(struct rb_##name* obj)                                   \
+  {                                                                            \
+    return obj ? put_handle(&obj->handle, release_##name) : -1;                \
+  }
+
+/* Asynchronous functions whose arguments are handles. */
+#define PROXY_FUNC_1H(func, type0)                                             \
+  struct func##_args { struct call call; type0 a0; };                          \
+                                                                               \
+  static int                                                                   \
+  exec_##func(struct call* call)                                               \
+  {                                                                            \
+    struct func##_args* args = (struct func##_args*)call;                      \
+    return proxy.rbi.func(REAL(args->a0));                                     \
+  }                                                                            \
+                                                                               \
+  int                                                                          \
+  rb_##func(type0 a0)                                                          \
+  {                                                                            \
+    struct func##_args* args = NULL;                                           \
+    if(!a0 || !(args = BEGIN_CALL(func, 0, NULL)))                             \
+      return -1;                                                               \
+    args->a0 = a0;                                                             \
+    END_CALL();                                                                \
+  }
+
+#define PROXY_FUNC_2H(func, type0, type1)                                      \
+  struct func##_args { struct call call; type0 a0; type1 a1; };                \
+                                                                               \
+  static int                                                                   \
+  exec_##func(struct call* call)                                               \
+  {                                                                            \
+    struct func##_args* args = (struct func##_args*)call;                      \
+    return proxy.rbi.func(REAL(args->a0), REAL(args->a1));                     \
+  }                                                                            \
+                                                                               \
+  int                                                                          \
+  rb_##func(type0 a0, type1 a1)                                                \
+  {                                                                            \
+    struct func##_args* args = NULL;                                           \
+    if(!a0 || !(args = BEGIN_CALL(func, 0, NULL)))                             \
+      return -1;                                                               \
+    args->a0 = a0;                                                             \
+    args->a1 = a1;                                                             \
+    END_CALL();                                                                \
+  }
+
+/* Asynchronous functions that submit a descriptor to a context. */
+#define PROXY_FUNC_DESC(func, desc_type)                                       \
+  struct func##_args {                                                         \
+    struct call call;                                                          \
+    struct rb_context* ctxt;                                                   \
+    desc_type desc;                                                            \
+  };                                                                           \
+                                                                               \
+  static int                                                                   \
+  exec_##func(struct call* call)                                               \
+  {                                                                            \
+    struct func##_args* args = (struct func##_args*)call;                      \
+    return proxy.rbi.func(REAL(args->ctxt), &args->desc);                      \
+  }                                                                            \
+                                                                               \
+  int                                                                          \
+  rb_##func(struct rb_context* ctxt, const desc_type* desc)                    \
+  {                                                                            \
+    struct func##_args* args = NULL;                                           \
+    if(!ctxt || !desc || !(args = BEGIN_CALL(func, 0, NULL)))                  \
+      return -1;                                                               \
+    args->ctxt = ctxt;                                                         \
+    args->desc = *desc;                                                        \
+    END_CALL();                                                                \
+  }
+
+/* Asynchronous functions that create an object from its context only. */
+#define PROXY_FUNC_CREATE(func, name)                                          \
+  struct func##_args {                                                         \
+    struct call call;                                                          \
+    struct rb_context* ctxt;                                                   \
+    struct rb_##name* obj;                                                     \
+  };                                                                           \
+                                                                               \
+  static int                                                                   \
+  exec_##func(struct call* call)                                               \
+  {                                                                            \
+    struct func##_args* args = (struct func##_args*)call;                      \
+    struct rb_##name* real = NULL;                                             \
+    const int err = proxy.rbi.func(REAL(args->ctxt), &real);                   \
+    args->obj->handle.real = real;                                             \
+    return err;                                                                \
+  }                                                                            \
+                                                                               \
+  int                                                                          \
+  rb_##func(struct rb_context* ctxt, struct rb_##name** out_obj)               \
+  {                                                                            \
+    struct func##_args* args = NULL;                                           \
+    struct rb_##name* obj = NULL;                                              \
+    if(!ctxt || !out_obj)                                                      \
+      return -1;                                                               \
+    if(!(obj = new_handle(sizeof(struct rb_##name), NULL)))                    \
+      return -1;                                                               \
+    if(!(args = BEGIN_CALL(func, 0, NULL))) {                                  \
+      free(obj);                                                               \
+      return -1;                                                               \
+    }                                                                          \
+    args->ctxt = ctxt;                                                         \
+    args->obj = obj;                                                           \
+    *out_obj = obj;                                                            \
+    END_CALL();                                                                \
+  }
+
+/* Synchronous functions that return a value of an object. */
+#define PROXY_FUNC_GET(func, type0, type1)                                     \
+  struct func##_args { struct call call; type0 a0; type1 a1; };                \
+                                                                               \
+  static int                                                                   \
+  exec_##func(struct call* call)                                               \
+  {                                                                            \
+    struct func##_args* args = (struct func##_args*)call;                      \
+    return proxy.rbi.func(REAL(args->a0), args->a1);                           \
+  }                                                                            \
+                                                                               \
+  int                                                                          \
+  rb_##func(type0 a0, type1 a1)                                                \
+  {                                                                            \
+    struct func##_args args;                                                   \
+    if(!a0)                                                                    \
+      return -1;                                                               \
+    args.call.exec = exec_##func;                                              \
+    args.a0 = a0;                                                              \
+    args.a1 = a1;                                                              \
+    return run_sync(&args.call);                                               \
+  }
+
+/* Commands recorded into a command buffer whose arguments are handles. */
+#define PROXY_CMD_1H(func, type0)                                              \
+  struct func##_args {                                                         \
+    struct call call;                                                          \
+    struct rb_command_buffer* cmd;                                             \
+    type0 a0;                                                                  \
+  };                                                                           \
+                                                                               \
+  static int                                                                   \
+  exec_##func(struct call* call)                                               \
+  {                                                                            \
+    struct func##_args* args = (struct func##_args*)call;                      \
+    return proxy.rbi.func(REAL(args->cmd), REAL(args->a0));                   \
+  }                                                                            \
+                                                                               \
+  int                                                                          \
+  rb_##func(struct rb_command_buffer* cmd, type0 a0)                           \
+  {                                                                            \
+    struct func##_args* args = NULL;                                           \
+    if(!cmd || !(args = RECORD_COMMAND(cmd, func, 0)))                         \
+      return -1;                                                               \
+    args->cmd = cmd;                                                           \
+    args->a0 = a0;                                                             \
+    return 0;                                                                  \
+  }
+
+/* Commands recorded into a command buffer that submit a descriptor. */
+#define PROXY_CMD_DESC(func, desc_type)                                        \
+  struct func##_args {                                                         \
+    struct call call;                                                          \
+    struct rb_command_buffer* cmd;                                             \
+    desc_type desc;                                                            \
+  };                                                                           \
+                                                                               \
+  static int                                                                   \
+  exec_##func(struct call* call)                                               \
+  {                                                                            \
+    struct func##_args* args = (struct func##_args*)call;                      \
+    return proxy.rbi.func(REAL(args->cmd), &args->desc);                       \
+  }                                                                            \
+                                                                               \
+  int                                                                          \
+  rb_##func(struct rb_command_buffer* cmd, const desc_type* desc)              \
+  {                                                                            \
+    struct func##_args* args = NULL;                                           \
+    if(!cmd || !desc || !(args = RECORD_COMMAND(cmd, func, 0)))                \
+      return -1;                                                               \
+    args->cmd = cmd;                                                           \
+    args->desc = *desc;                                                        \
+    return 0;                                                                  \
+  }
+
+/* Commands recorded into a command buffer that draw primitives. */
+#define PROXY_CMD_DRAW(func)                                                   \
+  struct func##_args {                                                         \
+    struct call call;                                                          \
+    struct rb_command_buffer* cmd;                                             \
+    enum rb_primitive_type prim_type;                                          \
+    unsigned int count;                                                        \
+  };                                                                           \
+                                                                               \
+  static int                                                                   \
+  exec_##func(struct call* call)                                               \
+  {                                                                            \
+    struct func##_args* args = (struct func##_args*)call;                      \
+    return proxy.rbi.func(REAL(args->cmd), args->prim_type, args->count);      \
+  }                                                                            \
+                                                                               \
+  int                                                                          \
+  rb_##func                                                                    \
+    (struct rb_command_buffer* cmd,                                            \
+     enum rb_primitive_type prim_type,                                         \
+     unsigned int count)                                                       \
+  {                                                                            \
+    struct func##_args* args = NULL;                                           \
+    if(!cmd || !(args = RECORD_COMMAND(cmd, func, 0)))                         \
+      return -1;                                                               \
+    args->cmd = cmd;                                                           \
+    args->prim_type = prim_type;                                               \
+    args->count = count;                                                       \
+    return 0;                                                                  \
+  }
+
+/* Asynchronous functions that draw primitives. */
+#define PROXY_FUNC_DRAW(func)                                                  \
+  struct func##_args {                                                         \
+    struct call call;                                                          \
+    struct rb_context* ctxt;                                                   \
+    enum rb_primitive_type prim_type;                                          \
+    unsigned int count;                                                        \
+  };                                                                           \
+                                                                               \
+  static int                                                                   \
+  exec_##func(struct call* call)                                               \
+  {                                                                            \
+    struct func##_args* args = (struct func##_args*)call;                      \
+    return proxy.rbi.func(REAL(args->ctxt), args->prim_type, args->count);     \
+  }                                                                            \
+                                                                               \
+  int                                                                          \
+  rb_##func                                                                    \
+    (struct rb_context* ctxt,                                                  \
+     enum rb_primitive_type prim_type,                                         \
+     unsigned int count)                                                       \
+  {                                                                            \
+    struct func##_args* args = NULL;                                           \
+    if(!ctxt || !(args = BEGIN_CALL(func, 0, NULL)))                           \
+      return -1;                                                               \
+    args->ctxt = ctxt;                                                         \
+    args->prim_type = prim_type;                                               \
+    args->count = count;                                                       \
+    END_CALL();                                                                \
+  }
+
+/*******************************************************************************
+ *
+ * Render backend context.
+ *
+ ******************************************************************************/
+/* The contexts are created by the render thread on which the backend makes
+ * current its driver context, if any. */
+struct create_context_args {
+  struct call call;
+  struct mem_allocator* allocator;
+  const struct rb_headless_desc* desc;
+  struct rb_context* ctxt;
+};
+
+static int
+exec_create_context(struct call* call)
+{
+  struct create_context_args* args = (struct create_context_args*)call;
+  struct rb_context* real = NULL;
+  int err = 0;
+
+  if(args->desc) {
+    err = proxy.rbi.create_headless_context(args->allocator, args->desc, &real);
+  } else {
+    err = proxy.rbi.create_context(args->allocator, &real);
+  }
+  if(err)
+    return err;
+  args->ctxt = new_handle(sizeof(struct rb_context), real);
+  if(!args->ctxt) {
+    proxy.rbi.context_ref_put(real);
+    return -1;
+  }
+  return 0;
+}
+
+int
+rb_create_context(struct mem_allocator* allocator, struct rb_context** out)
+{
+  struct create_context_args args;
+
+  if(!proxy.is_init && init_proxy() != 0)
+    return -1;
+  if(!out)
+    return -1;
+  args.call.exec = exec_create_context;
+  args.allocator = allocator;
+  args.desc = NULL;
+  args.ctxt = NULL;
+  if(run_sync(&args.call) != 0)
+    return -1;
+  *out = args.ctxt;
+  return 0;
+}
+
+int
+rb_create_headless_context
+  (struct mem_allocator* allocator,
+   const struct rb_headless_desc* desc,
+   struct rb_context** out)
+{
+  struct create_context_args args;
+
+  if(!proxy.is_init && init_proxy() != 0)
+    return -1;
+  if(!desc || !out)
+    return -1;
+  args.call.exec = exec_create_context;
+  args.allocator = allocator;
+  args.desc = desc;
+  args.ctxt = NULL;
+  if(run_sync(&args.call) != 0)
+    return -1;
+  *out = args.ctxt;
+  return 0;
+}
+
+/* The calls are issued by a single thread while a loader context is driven by
+ * another thread. Since the uploads are already executed by the render thread,
+ * the caller does not need loader contexts to avoid stalling. */
+int
+rb_create_loader_context
+  (struct rb_context* ctxt,
+   struct rb_context** out_loader)
+{
+  (void)ctxt, (void)out_loader;
+  return -1;
+}
+
+PROXY_REF_FUNCS(context)
+
+/*******************************************************************************
+ *
+ * Texture 2d.
+ *
+ ******************************************************************************/
+struct bind_tex2d_args {
+  struct call call;
+  struct rb_context* ctxt;
+  struct rb_tex2d* tex;
+  unsigned int tex_unit;
+};
+
+static int
+exec_bind_tex2d(struct call* call)
+{
+  struct bind_tex2d_args* args = (struct bind_tex2d_args*)call;
+  return proxy.rbi.bind_tex2d
+    (REAL(args->ctxt), REAL(args->tex), args->tex_unit);
+}
+
+int
+rb_bind_tex2d
+  (struct rb_context* ctxt,
+   struct rb_tex2d* tex,
+   unsigned int tex_unit)
+{
+  struct bind_tex2d_args* args = NULL;
+  if(!ctxt || !(args = BEGIN_CALL(bind_tex2d, 0, NULL)))
+    return -1;
+  args->ctxt = ctxt;
+  args->tex = tex;
+  args->tex_unit = tex_unit;
+  END_CALL();
+}
+
+/* The initial data of the mip levels are copied after the list of their
+ * pointers. */
+struct create_tex2d_args {
+  struct call call;
+  struct rb_context* ctxt;
+  struct rb_tex2d* tex;
+  const void** init_data;
+};
+
+static int
+exec_create_tex2d(struct call* call)
+{
+  struct create_tex2d_args* args = (struct create_tex2d_args*)call;
+  struct rb_tex2d* real = NULL;
+  int err = 0;
+
+  err = proxy.rbi.create_tex2d
+    (REAL(args->ctxt), &args->tex->desc, args->init_data, &real);
+  args->tex->handle.real = real;
+  return err;
+}
+
+int
+rb_create_tex2d
+  (struct rb_context* ctxt,
+   const struct rb_tex2d_desc* desc,
+   const void* init_data[],
+   struct rb_tex2d** out_tex)
+{
+  struct create_tex2d_args* args = NULL;
+  struct rb_tex2d* tex = NULL;
+  unsigned char* payload = NULL;
+  size_t payload_size = 0;
+  unsigned int i = 0;
+
+  if(!ctxt || !desc || !out_tex || desc->mip_count > 32)
+    return -1;
+  if(init_data) {
+    payload_size = align_size(desc->mip_count * sizeof(void*));
+    for(i = 0; i < desc->mip_count; ++i) {
+      if(init_data[i])
+        payload_size += align_size(sizeof_mip_level(desc, i));
+    }
+  }
+  if(!(tex = new_handle(sizeof(struct rb_tex2d), NULL)))
+    return -1;
+  tex->desc = *desc;
+  args = BEGIN_CALL(create_tex2d, payload_size, (void**)&payload);
+  if(!args) {
+    free(tex);
+    return -1;
+  }
+  args->ctxt = ctxt;
+  args->tex = tex;
+  args->init_data = NULL;
+  if(init_data) {
+    args->init_data = (const void**)payload;
+    payload += align_size(desc->mip_count * sizeof(void*));
+    for(i = 0; i < desc->mip_count; ++i) {
+      args->init_data[i] = NULL;
+      if(init_data[i]) {
+        const size_t size = sizeof_mip_level(desc, i);
+        args->init_data[i] = memcpy(payload, init_data[i], size);
+        payload += align_size(size);
+      }
+    }
+  }
+  *out_tex = tex;
+  END_CALL();
+}
+
+PROXY_REF_FUNCS(tex2d)
+
+struct tex2d_data_args {
+  struct call call;
+  struct rb_tex2d* tex;
+  unsigned int level;
+  const void* data;
+};
+
+static int
+exec_tex2d_data(struct call* call)
+{
+  struct tex2d_data_args* args = (struct tex2d_data_args*)call;
+  return proxy.rbi.tex2d_data(REAL(args->tex), args->level, args->data);
+}
+
+int
+rb_tex2d_data(struct rb_tex2d* tex, unsigned int level, const void* data)
+{
+  struct tex2d_data_args* args = NULL;
+  void* payload = NULL;
+  size_t size = 0;
+
+  if(!tex || level >= tex->desc.mip_count)
+    return -1;
+  if(data)
+    size = sizeof_mip_level(&tex->desc, level);
+  if(!(args = BEGIN_CALL(tex2d_data, size, &payload)))
+    return -1;
+  args->tex = tex;
+  args->level = level;
+  args->data = data ? memcpy(payload, data, size) : NULL;
+  END_CALL();
+}
+
+/*******************************************************************************
+ *
+ * Sampler.
+ *
+ ******************************************************************************/
+struct create_sampler_args {
+  struct call call;
+  struct rb_context* ctxt;
+  struct rb_sampler_desc desc;
+  struct rb_sampler* sampler;
+};
+
+static int
+exec_create_sampler(struct call* call)
+{
+  struct create_sampler_args* args = (struct create_sampler_args*)call;
+  struct rb_sampler* real = NULL;
+  int err = 0;
+
+  err = proxy.rbi.create_sampler(REAL(args->ctxt), &args->desc, &real);
+  args->sampler->handle.real = real;
+  return err;
+}
+
+int
+rb_create_sampler
+  (struct rb_context* ctxt,
+   const struct rb_sampler_desc* desc,
+   struct rb_sampler** out_sampler)
+{
+  struct create_sampler_args* args = NULL;
+  struct rb_sampler* sampler = NULL;
+
+  if(!ctxt || !desc || !out_sampler)
+    return -1;
+  if(!(sampler = new_handle(sizeof(struct rb_sampler), NULL)))
+    return -1;
+  if(!(args = BEGIN_CALL(create_sampler, 0, NULL))) {
+    free(sampler);
+    return -1;
+  }
+  args->ctxt = ctxt;
+  args->desc = *desc;
+  args->sampler = sampler;
+  *out_sampler = sampler;
+  END_CALL();
+}
+
+PROXY_REF_FUNCS(sampler)
+
+struct sampler_parameters_args {
+  struct call call;
+  struct rb_sampler* sampler;
+  struct rb_sampler_desc desc;
+};
+
+static int
+exec_sampler_parameters(struct call* call)
+{
+  struct sampler_parameters_args* args = (struct sampler_parameters_args*)call;
+  return proxy.rbi.sampler_parameters(REAL(args->sampler), &args->desc);
+}
+
+int
+rb_sampler_parameters
+  (struct rb_sampler* sampler,
+   const struct rb_sampler_desc* desc)
+{
+  struct sampler_parameters_args* args = NULL;
+  if(!sampler || !desc || !(args = BEGIN_CALL(sampler_parameters, 0, NULL)))
+    return -1;
+  args->sampler = sampler;
+  args->desc = *desc;
+  END_CALL();
+}
+
+struct bind_sampler_args {
+  struct call call;
+  struct rb_context* ctxt;
+  struct rb_sampler* sampler;
+  unsigned int tex_unit;
+};
+
+static int
+exec_bind_sampler(struct call* call)
+{
+  struct bind_sampler_args* args = (struct bind_sampler_args*)call;
+  return proxy.rbi.bind_sampler
+    (REAL(args->ctxt), REAL(args->sampler), args->tex_unit);
+}
+
+int
+rb_bind_sampler
+  (struct rb_context* ctxt,
+   struct rb_sampler* sampler,
+   unsigned int tex_unit)
+{
+  struct bind_sampler_args* args = NULL;
+  if(!ctxt || !(args = BEGIN_CALL(bind_sampler, 0, NULL)))
+    return -1;
+  args->ctxt = ctxt;
+  args->sampler = sampler;
+  args->tex_unit = tex_unit;
+  END_CALL();
+}
+
+/*******************************************************************************
+ *
+ * Buffers.
+ *
+ ******************************************************************************/
+struct bind_buffer_args {
+  struct call call;
+  struct rb_context* ctxt;
+  struct rb_buffer* buf;
+  enum rb_buffer_target target;
+};
+
+static int
+exec_bind_buffer(struct call* call)
+{
+  struct bind_buffer_args* args = (struct bind_buffer_args*)call;
+  return proxy.rbi.bind_buffer(REAL(args->ctxt), REAL(args->buf), args->target);
+}
+
+int
+rb_bind_buffer
+  (struct rb_context* ctxt,
+   struct rb_buffer* buf,
+   enum rb_buffer_target target)
+{
+  struct bind_buffer_args* args = NULL;
+  if(!ctxt || !(args = BEGIN_CALL(bind_buffer, 0, NULL)))
+    return -1;
+  args->ctxt = ctxt;
+  args->buf = buf;
+  args->target = target;
+  END_CALL();
+}
+
+struct buffer_data_args {
+  struct call call;
+  struct rb_buffer* buf;
+  int offset;
+  int size;
+  const void* data;
+};
+
+static int
+exec_buffer_data(struct call* call)
+{
+  struct buffer_data_args* args = (struct buffer_data_args*)call;
+  return proxy.rbi.buffer_data
+    (REAL(args->buf), args->offset, args->size, args->data);
+}
+
+int
+rb_buffer_data(struct rb_buffer* buf, int offset, int size, const void* data)
+{
+  struct buffer_data_args* args = NULL;
+  void* payload = NULL;
+  const size_t payload_size = data && size > 0 ? (size_t)size : 0;
+
+  if(!buf || !(args = BEGIN_CALL(buffer_data, payload_size, &payload)))
+    return -1;
+  args->buf = buf;
+  args->offset = offset;
+  args->size = size;
+  args->data = data ? memcpy(payload, data, payload_size) : NULL;
+  END_CALL();
+}
+
+struct create_buffer_args {
+  struct call call;
+  struct rb_context* ctxt;
+  struct rb_buffer_desc desc;
+  const void* init_data;
+  struct rb_buffer* buf;
+};
+
+static int
+exec_create_buffer(struct call* call)
+{
+  struct create_buffer_args* args = (struct create_buffer_args*)call;
+  struct rb_buffer* real = NULL;
+  int err = 0;
+
+  err = proxy.rbi.create_buffer
+    (REAL(args->ctxt), &args->desc, args->init_data, &real);
+  args->buf->handle.real = real;
+  return err;
+}
+
+int
+rb_create_buffer
+  (struct rb_context* ctxt,
+   const struct rb_buffer_desc* desc,
+   const void* init_data,
+   struct rb_buffer** out_buf)
+{
+  struct create_buffer_args* args = NULL;
+  struct rb_buffer* buf = NULL;
+  void* payload = NULL;
+  const size_t payload_size = init_data && desc ? desc->size : 0;
+
+  if(!ctxt || !desc || !out_buf)
+    return -1;
+  if(!(buf = new_handle(sizeof(struct rb_buffer), NULL)))
+    return -1;
+  if(!(args = BEGIN_CALL(create_buffer, payload_size, &payload))) {
+    free(buf);
+    return -1;
+  }
+  args->ctxt = ctxt;
+  args->desc = *desc;
+  args->init_data = init_data ? memcpy(payload, init_data, payload_size) : NULL;
+  args->buf = buf;
+  *out_buf = buf;
+  END_CALL();
+}
+
+PROXY_REF_FUNCS(buffer)
+
+/*******************************************************************************
+ *
+ * Vertex array.
+ *
+ ******************************************************************************/
+PROXY_FUNC_2H(bind_vertex_array, struct rb_context*, struct rb_vertex_array*)
+PROXY_FUNC_CREATE(create_vertex_array, vertex_array)
+PROXY_REF_FUNCS(vertex_array)
+
+struct remove_vertex_attrib_args {
+  struct call call;
+  struct rb_vertex_array* varray;
+  int count;
+  const int* indices;
+};
+
+static int
+exec_remove_vertex_attrib(struct call* call)
+{
+  struct remove_vertex_attrib_args* args =
+    (struct remove_vertex_attrib_args*)call;
+  return proxy.rbi.remove_vertex_attrib
+    (REAL(args->varray), args->count, args->indices);
+}
+
+int
+rb_remove_vertex_attrib
+  (struct rb_vertex_array* varray,
+   int count,
+   const int* list_of_attrib_indices)
+{
+  struct remove_vertex_attrib_args* args = NULL;
+  void* payload = NULL;
+  size_t payload_size = 0;
+
+  if(list_of_attrib_indices && count > 0)
+    payload_size = (size_t)count * sizeof(int);
+  if(!varray
+  || !(args = BEGIN_CALL(remove_vertex_attrib, payload_size, &payload)))
+    return -1;
+  args->varray = varray;
+  args->count = count;
+  args->indices = list_of_attrib_indices
+    ? memcpy(payload, list_of_attrib_indices, payload_size) : NULL;
+  END_CALL();
+}
+
+struct vertex_attrib_array_args {
+  struct call call;
+  struct rb_vertex_array* varray;
+  struct rb_buffer* buf;
+  int count;
+  const struct rb_buffer_attrib* attr;
+};
+
+static int
+exec_vertex_attrib_array(struct call* call)
+{
+  struct vertex_attrib_array_args* args =
+    (struct vertex_attrib_array_args*)call;
+  return proxy.rbi.vertex_attrib_array
+    (REAL(args->varray), REAL(args->buf), args->count, args->attr);
+}
+
+int
+rb_vertex_attrib_array
+  (struct rb_vertex_array* varray,
+   struct rb_buffer* buf,
+   int count,
+   const struct rb_buffer_attrib* attr)
+{
+  struct vertex_attrib_array_args* args = NULL;
+  void* payload = NULL;
+  size_t payload_size = 0;
+
+  if(attr && count > 0)
+    payload_size = (size_t)count * sizeof(struct rb_buffer_attrib);
+  if(!varray
+  || !(args = BEGIN_CALL(vertex_attrib_array, payload_size, &payload)))
+    return -1;
+  args->varray = varray;
+  args->buf = buf;
+  args->count = count;
+  args->attr = attr ? memcpy(payload, attr, payload_size) : NULL;
+  END_CALL();
+}
+
+PROXY_FUNC_2H(vertex_index_array, struct rb_vertex_array*, struct rb_buffer*)
+
+/*******************************************************************************
+ *
+ * Shaders.
+ *
+ ******************************************************************************/
+struct create_shader_args {
+  struct call call;
+  struct rb_context* ctxt;
+  enum rb_shader_type type;
+  const char* source;
+  size_t length;
+  struct rb_shader* shader;
+};
+
+static int
+exec_create_shader(struct call* call)
+{
+  struct create_shader_args* args = (struct create_shader_args*)call;
+  struct rb_shader* real = NULL;
+  int err = 0;
+
+  err = proxy.rbi.create_shader
+    (REAL(args->ctxt), args->type, args->source, args->length, &real);
+  /* A shader that fails to compile is still returned to get its log. */
+  args->shader->handle.real = real;
+  return err;
+}
+
+int
+rb_create_shader
+  (struct rb_context* ctxt,
+   enum rb_shader_type type,
+   const char* source,
+   size_t length,
+   struct rb_shader** out_shader)
+{
+  struct create_shader_args* args = NULL;
+  struct rb_shader* shader = NULL;
+  void* payload = NULL;
+  const size_t payload_size = source ? length : 0;
+
+  if(!ctxt || !out_shader)
+    return -1;
+  if(!(shader = new_handle(sizeof(struct rb_shader), NULL)))
+    return -1;
+  if(!(args = BEGIN_CALL(create_shader, payload_size, &payload))) {
+    free(shader);
+    return -1;
+  }
+  args->ctxt = ctxt;
+  args->type = type;
+  args->source = source ? memcpy(payload, source, payload_size) : NULL;
+  args->length = length;
+  args->shader = shader;
+  *out_shader = shader;
+  END_CALL();
+}
+
+/* The variants are created synchronously since the include callback of the
+ * caller is invoked during the creation. */
+struct create_shader_variant_args {
+  struct call call;
+  struct rb_context* ctxt;
+  const struct rb_shader_variant_desc* desc;
+  struct rb_shader* shader;
+};
+
+static int
+exec_create_shader_variant(struct call* call)
+{
+  struct create_shader_variant_args* args =
+    (struct create_shader_variant_args*)call;
+  struct rb_shader* real = NULL;
+  int err = 0;
+
+  err = proxy.rbi.create_shader_variant(REAL(args->ctxt), args->desc, &real);
+  if(real) {
+    args->shader = new_handle(sizeof(struct rb_shader), real);
+    if(!args->shader) {
+      proxy.rbi.shader_ref_put(real);
+      err = -1;
+    }
+  }
+  return err;
+}
+
+int
+rb_create_shader_variant
+  (struct rb_context* ctxt,
+   const struct rb_shader_variant_desc* desc,
+   struct rb_shader** out_shader)
+{
+  struct create_shader_variant_args args;
+  int err = 0;
+
+  if(!ctxt || !out_shader)
+    return -1;
+  args.call.exec = exec_create_shader_variant;
+  args.ctxt = ctxt;
+  args.desc = desc;
+  args.shader = NULL;
+  err = run_sync(&args.call);
+  if(args.shader)
+    *out_shader = args.shader;
+  return err;
+}
+
+PROXY_REF_FUNCS(shader)
+PROXY_FUNC_GET(get_shader_log, struct rb_shader*, const char**)
+PROXY_FUNC_GET(is_shader_attached, struct rb_shader*, int*)
+
+struct shader_source_args {
+  struct call call;
+  struct rb_shader* shader;
+  const char* source;
+  size_t length;
+};
+
+static int
+exec_shader_source(struct call* call)
+{
+  struct shader_source_args* args = (struct shader_source_args*)call;
+  return proxy.rbi.shader_source
+    (REAL(args->shader), args->source, args->length);
+}
+
+int
+rb_shader_source(struct rb_shader* shader, const char* source, size_t length)
+{
+  struct shader_source_args* args = NULL;
+  void* payload = NULL;
+  const size_t payload_size = source ? length : 0;
+
+  if(!shader || !(args = BEGIN_CALL(shader_source, payload_size, &payload)))
+    return -1;
+  args->shader = shader;
+  args->source = source ? memcpy(payload, source, payload_size) : NULL;
+  args->length = length;
+  END_CALL();
+}
+
+/*******************************************************************************
+ *
+ * Programs.
+ *
+ ******************************************************************************/
+PROXY_FUNC_2H(attach_shader, struct rb_program*, struct rb_shader*)
+PROXY_FUNC_2H(bind_program, struct rb_context*, struct rb_program*)
+PROXY_FUNC_CREATE(create_program, program)
+PROXY_FUNC_2H(detach_shader, struct rb_program*, struct rb_shader*)
+PROXY_REF_FUNCS(program)
+PROXY_FUNC_GET(get_program_log, struct rb_program*, const char**)
+PROXY_FUNC_1H(link_program, struct rb_program*)
+PROXY_FUNC_GET(program_is_ready, struct rb_program*, int*)
+PROXY_FUNC_DESC(compile_mode, struct rb_compile_desc)
+
+/*******************************************************************************
+ *
+ * Program uniforms.
+ *
+ ******************************************************************************/
+/* Return the proxy of a backend uniform whose reference is put on error. */
+static struct rb_uniform*
+wrap_uniform(struct rb_uniform* real)
+{
+  struct rb_uniform_desc desc;
+  struct rb_uniform* uniform = NULL;
+  ASSERT(real);
+
+  if(proxy.rbi.get_uniform_desc(real, &desc) == 0)
+    uniform = new_handle(sizeof(struct rb_uniform), real);
+  if(!uniform) {
+    proxy.rbi.uniform_ref_put(real);
+    return NULL;
+  }
+  uniform->type = desc.type;
+  return uniform;
+}
+
+struct get_named_uniform_args {
+  struct call call;
+  struct rb_context* ctxt;
+  struct rb_program* prog;
+  const char* name;
+  struct rb_uniform* uniform;
+};
+
+static int
+exec_get_named_uniform(struct call* call)
+{
+  struct get_named_uniform_args* args = (struct get_named_uniform_args*)call;
+  struct rb_uniform* real = NULL;
+  int err = 0;
+
+  err = proxy.rbi.get_named_uniform
+    (REAL(args->ctxt), REAL(args->prog), args->name, &real);
+  if(err)
+    return err;
+  args->uniform = wrap_uniform(real);
+  return args->uniform ? 0 : -1;
+}
+
+int
+rb_get_named_uniform
+  (struct rb_context* ctxt,
+   struct rb_program* prog,
+   const char* name,
+   struct rb_uniform** out_uniform)
+{
+  struct get_named_uniform_args args;
+
+  if(!ctxt || !prog || !name || !out_uniform)
+    return -1;
+  args.call.exec = exec_get_named_uniform;
+  args.ctxt = ctxt;
+  args.prog = prog;
+  args.name = name;
+  args.uniform = NULL;
+  if(run_sync(&args.call) != 0)
+    return -1;
+  *out_uniform = args.uniform;
+  return 0;
+}
+
+/* The list of the caller is filled with the backend uniforms that are then
+ * replaced by their proxy. */
+struct get_uniforms_args {
+  struct call call;
+  struct rb_context* ctxt;
+  struct rb_program* prog;
+  size_t* nb_uniforms;
+  struct rb_uniform** list;
+};
+
+static int
+exec_get_uniforms(struct call* call)
+{
+  struct get_uniforms_args* args = (struct get_uniforms_args*)call;
+  size_t i = 0;
+  int err = 0;
+
+  err = proxy.rbi.get_uniforms
+    (REAL(args->ctxt), REAL(args->prog), args->nb_uniforms, args->list);
+  if(err || !args->list)
+    return err;
+  for(i = 0; i < *args->nb_uniforms; ++i) {
+    if(!(args->list[i] = wrap_uniform(args->list[i])))
+      break;
+  }
+  if(i < *args->nb_uniforms) {
+    size_t j = 0;
+    for(j = i + 1; j < *args->nb_uniforms; ++j)
+      proxy.rbi.uniform_ref_put(args->list[j]);
+    while(i--) {
+      proxy.rbi.uniform_ref_put(args->list[i]->handle.real);
+      free(args->list[i]);
+    }
+    *args->nb_uniforms = 0;
+    return -1;
+  }
+  return 0;
+}
+
+int
+rb_get_uniforms
+  (struct rb_context* ctxt,
+   struct rb_program* prog,
+   size_t* out_nb_uniforms,
+   struct rb_uniform* out_uniform_list[])
+{
+  struct get_uniforms_args args;
+
+  if(!ctxt || !prog || !out_nb_uniforms)
+    return -1;
+  args.call.exec = exec_get_uniforms;
+  args.ctxt = ctxt;
+  args.prog = prog;
+  args.nb_uniforms = out_nb_uniforms;
+  args.list = out_uniform_list;
+  return run_sync(&args.call);
+}
+
+PROXY_FUNC_GET(get_uniform_desc, struct rb_uniform*, struct rb_uniform_desc*)
+
+struct uniform_data_args {
+  struct call call;
+  struct rb_uniform* uniform;
+  int count;
+  const void* data;
+};
+
+static int
+exec_uniform_data(struct call* call)
+{
+  struct uniform_data_args* args = (struct uniform_data_args*)call;
+  return proxy.rbi.uniform_data(REAL(args->uniform), args->count, args->data);
+}
+
+int
+rb_uniform_data(struct rb_uniform* uniform, int count, const void* data)
+{
+  struct uniform_data_args* args = NULL;
+  void* payload = NULL;
+  size_t size = 0;
+
+  if(!uniform || count <= 0 || !data)
+    return -1;
+  size = (size_t)count * sizeof_type(uniform->type);
+  if(!(args = BEGIN_CALL(uniform_data, size, &payload)))
+    return -1;
+  args->uniform = uniform;
+  args->count = count;
+  args->data = memcpy(payload, data, size);
+  END_CALL();
+}
+
+PROXY_REF_FUNCS(uniform)
+
+/*******************************************************************************
+ *
+ * Program attributes.
+ *
+ ******************************************************************************/
+/* Return the proxy of a backend attrib whose reference is put on error. */
+static struct rb_attrib*
+wrap_attrib(struct rb_attrib* real)
+{
+  struct rb_attrib_desc desc;
+  struct rb_attrib* attr = NULL;
+  ASSERT(real);
+
+  if(proxy.rbi.get_attrib_desc(real, &desc) == 0)
+    attr = new_handle(sizeof(struct rb_attrib), real);
+  if(!attr) {
+    proxy.rbi.attrib_ref_put(real);
+    return NULL;
+  }
+  attr->type = desc.type;
+  return attr;
+}
+
+struct get_attribs_args {
+  struct call call;
+  struct rb_context* ctxt;
+  struct rb_program* prog;
+  size_t* nb_attribs;
+  struct rb_attrib** list;
+};
+
+static int
+exec_get_attribs(struct call* call)
+{
+  struct get_attribs_args* args = (struct get_attribs_args*)call;
+  size_t i = 0;
+  int err = 0;
+
+  err = proxy.rbi.get_attribs
+    (REAL(args->ctxt), REAL(args->prog), args->nb_attribs, args->list);
+  if(err || !args->list)
+    return err;
+  for(i = 0; i < *args->nb_attribs; ++i) {
+    if(!(args->list[i] = wrap_attrib(args->list[i])))
+      break;
+  }
+  if(i < *args->nb_attribs) {
+    size_t j = 0;
+    for(j = i + 1; j < *args->nb_attribs; ++j)
+      proxy.rbi.attrib_ref_put(args->list[j]);
+    while(i--) {
+      proxy.rbi.attrib_ref_put(args->list[i]->handle.real);
+      free(args->list[i]);
+    }
+    *args->nb_attribs = 0;
+    return -1;
+  }
+  return 0;
+}
+
+int
+rb_get_attribs
+  (struct rb_context* ctxt,
+   struct rb_program* prog,
+   size_t* out_nb_attribs,
+   struct rb_attrib* out_attrib_list[])
+{
+  struct get_attribs_args args;
+
+  if(!ctxt || !prog || !out_nb_attribs)
+    return -1;
+  args.call.exec = exec_get_attribs;
+  args.ctxt = ctxt;
+  args.prog = prog;
+  args.nb_attribs = out_nb_attribs;
+  args.list = out_attrib_list;
+  return run_sync(&args.call);
+}
+
+struct get_named_attrib_args {
+  struct call call;
+  struct rb_context* ctxt;
+  struct rb_program* prog;
+  const char* name;
+  struct rb_attrib* attr;
+};
+
+static int
+exec_get_named_attrib(struct call* call)
+{
+  struct get_named_attrib_args* args = (struct get_named_attrib_args*)call;
+  struct rb_attrib* real = NULL;
+  int err = 0;
+
+  err = proxy.rbi.get_named_attrib
+    (REAL(args->ctxt), REAL(args->prog), args->name, &real);
+  if(err)
+    return err;
+  args->attr = wrap_attrib(real);
+  return args->attr ? 0 : -1;
+}
+
+int
+rb_get_named_attrib
+  (struct rb_context* ctxt,
+   struct rb_program* prog,
+   const char* name,
+   struct rb_attrib** out_attrib)
+{
+  struct get_named_attrib_args args;
+
+  if(!ctxt || !prog || !name || !out_attrib)
+    return -1;
+  args.call.exec = exec_get_named_attrib;
+  args.ctxt = ctxt;
+  args.prog = prog;
+  args.name = name;
+  args.attr = NULL;
+  if(run_sync(&args.call) != 0)
+    return -1;
+  *out_attrib = args.attr;
+  return 0;
+}
+
+struct attrib_data_args {
+  struct call call;
+  struct rb_attrib* attr;
+  const void* data;
+};
+
+static int
+exec_attrib_data(struct call* call)
+{
+  struct attrib_data_args* args = (struct attrib_data_args*)call;
+  return proxy.rbi.attrib_data(REAL(args->attr), args->data);
+}
+
+int
+rb_attrib_data(struct rb_attrib* attr, const void* data)
+{
+  struct attrib_data_args* args = NULL;
+  void* payload = NULL;
+  size_t size = 0;
+
+  if(!attr || !data)
+    return -1;
+  size = sizeof_type(attr->type);
+  if(!(args = BEGIN_CALL(attrib_data, size, &payload)))
+    return -1;
+  args->attr = attr;
+  args->data = memcpy(payload, data, size);
+  END_CALL();
+}
+
+PROXY_FUNC_GET
+  (get_attrib_desc, const struct rb_attrib*, struct rb_attrib_desc*)
+PROXY_REF_FUNCS(attrib)
+
+/*******************************************************************************
+ *
+ * Framebuffer.
+ *
+ ******************************************************************************/
+struct create_framebuffer_args {
+  struct call call;
+  struct rb_context* ctxt;
+  struct rb_framebuffer_desc desc;
+  struct rb_framebuffer* buffer;
+};
+
+static int
+exec_create_framebuffer(struct call* call)
+{
+  struct create_framebuffer_args* args = (struct create_framebuffer_args*)call;
+  struct rb_framebuffer* real = NULL;
+  int err = 0;
+
+  err = proxy.rbi.create_framebuffer(REAL(args->ctxt), &args->desc, &real);
+  args->buffer->handle.real = real;
+  return err;
+}
+
+int
+rb_create_framebuffer
+  (struct rb_context* ctxt,
+   const struct rb_framebuffer_desc* desc,
+   struct rb_framebuffer** out_buffer)
+{
+  struct create_framebuffer_args* args = NULL;
+  struct rb_framebuffer* buffer = NULL;
+
+  if(!ctxt || !desc || !out_buffer)
+    return -1;
+  if(!(buffer = new_handle(sizeof(struct rb_framebuffer), NULL)))
+    return -1;
+  if(!(args = BEGIN_CALL(create_framebuffer, 0, NULL))) {
+    free(buffer);
+    return -1;
+  }
+  args->ctxt = ctxt;
+  args->desc = *desc;
+  args->buffer = buffer;
+  *out_buffer = buffer;
+  END_CALL();
+}
+
+PROXY_REF_FUNCS(framebuffer)
+PROXY_FUNC_2H(bind_framebuffer, struct rb_context*, struct rb_framebuffer*)
+
+/* The resources of the copied render targets are translated by the render
+ * thread. */
+struct framebuffer_render_targets_args {
+  struct call call;
+  struct rb_framebuffer* buffer;
+  unsigned int count;
+  struct rb_render_target* render_target_list;
+  struct rb_render_target* depth_stencil;
+};
+
+static int
+exec_framebuffer_render_targets(struct call* call)
+{
+  struct framebuffer_render_targets_args* args =
+    (struct framebuffer_render_targets_args*)call;
+  unsigned int i = 0;
+
+  for(i = 0; args->render_target_list && i < args->count; ++i) {
+    struct rb_render_target* rt = args->render_target_list + i;
+    if(rt->type == RB_RENDER_TARGET_TEXTURE2D)
+      rt->resource = REAL((struct rb_tex2d*)rt->resource);
+  }
+  if(args->depth_stencil
+  && args->depth_stencil->type == RB_RENDER_TARGET_TEXTURE2D) {
+    args->depth_stencil->resource =
+      REAL((struct rb_tex2d*)args->depth_stencil->resource);
+  }
+  return proxy.rbi.framebuffer_render_targets
+    (REAL(args->buffer), args->count, args->render_target_list,
+     args->depth_stencil);
+}
+
+int
+rb_framebuffer_render_targets
+  (struct rb_framebuffer* buffer,
+   unsigned int count,
+   const struct rb_render_target render_target_list[],
+   const struct rb_render_target* depth_stencil)
+{
+  struct framebuffer_render_targets_args* args = NULL;
+  struct rb_render_target* payload = NULL;
+  size_t nb_rts = 0;
+
+  nb_rts = (render_target_list ? count : 0) + (depth_stencil != NULL);
+  if(!buffer
+  || !(args = BEGIN_CALL(framebuffer_render_targets,
+      nb_rts * sizeof(struct rb_render_target), (void**)&payload)))
+    return -1;
+  args->buffer = buffer;
+  args->count = count;
+  args->render_target_list = NULL;
+  args->depth_stencil = NULL;
+  if(render_target_list) {
+    args->render_target_list = payload;
+    memcpy(payload, render_target_list, count*sizeof(struct rb_render_target));
+    payload += count;
+  }
+  if(depth_stencil)
+    args->depth_stencil = memcpy(payload, depth_stencil, sizeof(*payload));
+  END_CALL();
+}
+
+struct clear_framebuffer_render_targets_args {
+  struct call call;
+  struct rb_framebuffer* buffer;
+  int clear_flag;
+  unsigned int count;
+  const struct rb_clear_framebuffer_color_desc* color_vals;
+  float depth_val;
+  char stencil_val;
+};
+
+static int
+exec_clear_framebuffer_render_targets(struct call* call)
+{
+  struct clear_framebuffer_render_targets_args* args =
+    (struct clear_framebuffer_render_targets_args*)call;
+  return proxy.rbi.clear_framebuffer_render_targets
+    (REAL(args->buffer), args->clear_flag, args->count, args->color_vals,
+     args->depth_val, args->stencil_val);
+}
+
+int
+rb_clear_framebuffer_render_targets
+  (struct rb_framebuffer* buffer,
+   int clear_flag,
+   unsigned int count,
+   const struct rb_clear_framebuffer_color_desc* color_vals,
+   float depth_val,
+   char stencil_val)
+{
+  struct clear_framebuffer_render_targets_args* args = NULL;
+  void* payload = NULL;
+  size_t payload_size = 0;
+
+  if(color_vals)
+    payload_size = count * sizeof(struct rb_clear_framebuffer_color_desc);
+  if(!buffer
+  || !(args = BEGIN_CALL
+      (clear_framebuffer_render_targets, payload_size, &payload)))
+    return -1;
+  args->buffer = buffer;
+  args->clear_flag = clear_flag;
+  args->count = count;
+  args->color_vals = color_vals
+    ? memcpy(payload, color_vals, payload_size) : NULL;
+  args->depth_val = depth_val;
+  args->stencil_val = stencil_val;
+  END_CALL();
+}
+
+/* The data are read back into the caller memory while it waits. */
+struct read_back_framebuffer_args {
+  struct call call;
+  struct rb_framebuffer* buffer;
+  int rt_id;
+  size_t x, y, width, height;
+  size_t* read_size;
+  void* read_data;
+};
+
+static int
+exec_read_back_framebuffer(struct call* call)
+{
+  struct read_back_framebuffer_args* args =
+    (struct read_back_framebuffer_args*)call;
+  return proxy.rbi.read_back_framebuffer
+    (REAL(args->buffer), args->rt_id, args->x, args->y, args->width,
+     args->height, args->read_size, args->read_data);
+}
+
+int
+rb_read_back_framebuffer
+  (struct rb_framebuffer* buffer,
+   int rt_id,
+   size_t x,
+   size_t y,
+   size_t width,
+   size_t height,
+   size_t* read_size,
+   void* read_data)
+{
+  struct read_back_framebuffer_args args;
+
+  if(!buffer)
+    return -1;
+  args.call.exec = exec_read_back_framebuffer;
+  args.buffer = buffer;
+  args.rt_id = rt_id;
+  args.x = x;
+  args.y = y;
+  args.width = width;
+  args.height = height;
+  args.read_size = read_size;
+  args.read_data = read_data;
+  return run_sync(&args.call);
+}
+
+/*******************************************************************************
+ *
+ * Command buffers.
+ *
+ ******************************************************************************/
+PROXY_FUNC_CREATE(create_command_buffer, command_buffer)
+
+static int
+release_command_buffer(void* obj)
+{
+  struct rb_command_buffer* cmd = obj;
+  int err = 0;
+
+  if(cmd->handle.real)
+    err = proxy.rbi.command_buffer_ref_put(cmd->handle.real);
+  free(cmd->stream);
+  free(cmd);
+  return err;
+}
+
+int
+rb_command_buffer_ref_get(struct rb_command_buffer* cmd)
+{
+  if(!cmd)
+    return -1;
+  __atomic_add_fetch(&cmd->handle.ref, 1, __ATOMIC_RELAXED);
+  return 0;
+}
+
+int
+rb_command_buffer_ref_put(struct rb_command_buffer* cmd)
+{
+  return cmd ? put_handle(&cmd->handle, release_command_buffer) : -1;
+}
+
+struct reset_command_buffer_args {
+  struct call call;
+  struct rb_command_buffer* cmd;
+};
+
+static int
+exec_reset_command_buffer(struct call* call)
+{
+  struct reset_command_buffer_args* args =
+    (struct reset_command_buffer_args*)call;
+  return proxy.rbi.reset_command_buffer(REAL(args->cmd));
+}
+
+int
+rb_reset_command_buffer(struct rb_command_buffer* cmd)
+{
+  struct reset_command_buffer_args* args = NULL;
+
+  if(!cmd || !(args = BEGIN_CALL(reset_command_buffer, 0, NULL)))
+    return -1;
+  /* Discard the commands that are not submitted yet. */
+  cmd->size = 0;
+  args->cmd = cmd;
+  END_CALL();
+}
+
+PROXY_CMD_1H(cmd_bind_program, struct rb_program*)
+PROXY_CMD_1H(cmd_bind_vertex_array, struct rb_vertex_array*)
+
+struct cmd_bind_tex2d_args {
+  struct call call;
+  struct rb_command_buffer* cmd;
+  struct rb_tex2d* tex;
+  unsigned int tex_unit;
+};
+
+static int
+exec_cmd_bind_tex2d(struct call* call)
+{
+  struct cmd_bind_tex2d_args* args = (struct cmd_bind_tex2d_args*)call;
+  return proxy.rbi.cmd_bind_tex2d
+    (REAL(args->cmd), REAL(args->tex), args->tex_unit);
+}
+
+int
+rb_cmd_bind_tex2d
+  (struct rb_command_buffer* cmd,
+   struct rb_tex2d* tex,
+   unsigned int tex_unit)
+{
+  struct cmd_bind_tex2d_args* args = NULL;
+  if(!cmd || !(args = RECORD_COMMAND(cmd, cmd_bind_tex2d, 0)))
+    return -1;
+  args->cmd = cmd;
+  args->tex = tex;
+  args->tex_unit = tex_unit;
+  return 0;
+}
+
+struct cmd_bind_sampler_args {
+  struct call call;
+  struct rb_command_buffer* cmd;
+  struct rb_sampler* sampler;
+  unsigned int tex_unit;
+};
+
+static int
+exec_cmd_bind_sampler(struct call* call)
+{
+  struct cmd_bind_sampler_args* args = (struct cmd_bind_sampler_args*)call;
+  return proxy.rbi.cmd_bind_sampler
+    (REAL(args->cmd), REAL(args->sampler), args->tex_unit);
+}
+
+int
+rb_cmd_bind_sampler
+  (struct rb_command_buffer* cmd,
+   struct rb_sampler* sampler,
+   unsigned int tex_unit)
+{
+  struct cmd_bind_sampler_args* args = NULL;
+  if(!cmd || !(args = RECORD_COMMAND(cmd, cmd_bind_sampler, 0)))
+    return -1;
+  args->cmd = cmd;
+  args->sampler = sampler;
+  args->tex_unit = tex_unit;
+  return 0;
+}
+
+PROXY_CMD_1H(cmd_bind_framebuffer, struct rb_framebuffer*)
+PROXY_CMD_DESC(cmd_blend, struct rb_blend_desc)
+PROXY_CMD_DESC(cmd_depth_stencil, struct rb_depth_stencil_desc)
+PROXY_CMD_DESC(cmd_rasterizer, struct rb_rasterizer_desc)
+PROXY_CMD_DESC(cmd_viewport, struct rb_viewport_desc)
+
+struct cmd_clear_args {
+  struct call call;
+  struct rb_command_buffer* cmd;
+  int clear_flag;
+  int has_color;
+  float color_val[4];
+  float depth_val;
+  char stencil_val;
+};
+
+static int
+exec_cmd_clear(struct call* call)
+{
+  struct cmd_clear_args* args = (struct cmd_clear_args*)call;
+  return proxy.rbi.cmd_clear
+    (REAL(args->cmd), args->clear_flag,
+     args->has_color ? args->color_val : NULL,
+     args->depth_val, args->stencil_val);
+}
+
+int
+rb_cmd_clear
+  (struct rb_command_buffer* cmd,
+   int clear_flag,
+   const float color_val[4],
+   float depth_val,
+   char stencil_val)
+{
+  struct cmd_clear_args* args = NULL;
+  if(!cmd || !(args = RECORD_COMMAND(cmd, cmd_clear, 0)))
+    return -1;
+  args->cmd = cmd;
+  args->clear_flag = clear_flag;
+  args->has_color = color_val != NULL;
+  if(color_val)
+    memcpy(args->color_val, color_val, sizeof(args->color_val));
+  args->depth_val = depth_val;
+  args->stencil_val = stencil_val;
+  return 0;
+}
+
+struct cmd_uniform_data_args {
+  struct call call;
+  struct rb_command_buffer* cmd;
+  struct rb_uniform* uniform;
+  int count;
+};
+
+static int
+exec_cmd_uniform_data(struct call* call)
+{
+  struct cmd_uniform_data_args* args = (struct cmd_uniform_data_args*)call;
+  return proxy.rbi.cmd_uniform_data
+    (REAL(args->cmd), REAL(args->uniform), args->count,
+     COMMAND_PAYLOAD(args));
+}
+
+int
+rb_cmd_uniform_data
+  (struct rb_command_buffer* cmd,
+   struct rb_uniform* uniform,
+   int count,
+   const void* data)
+{
+  struct cmd_uniform_data_args* args = NULL;
+  size_t size = 0;
+
+  if(!cmd || !uniform || count <= 0 || !data)
+    return -1;
+  size = (size_t)count * sizeof_type(uniform->type);
+  if(!(args = RECORD_COMMAND(cmd, cmd_uniform_data, size)))
+    return -1;
+  args->cmd = cmd;
+  args->uniform = uniform;
+  args->count = count;
+  memcpy(COMMAND_PAYLOAD(args), data, size);
+  return 0;
+}
+
+struct cmd_buffer_data_args {
+  struct call call;
+  struct rb_command_buffer* cmd;
+  struct rb_buffer* buf;
+  int offset;
+  int size;
+  int has_data;
+};
+
+static int
+exec_cmd_buffer_data(struct call* call)
+{
+  struct cmd_buffer_data_args* args = (struct cmd_buffer_data_args*)call;
+  return proxy.rbi.cmd_buffer_data
+    (REAL(args->cmd), REAL(args->buf), args->offset, args->size,
+     args->has_data ? COMMAND_PAYLOAD(args) : NULL);
+}
+
+int
+rb_cmd_buffer_data
+  (struct rb_command_buffer* cmd,
+   struct rb_buffer* buf,
+   int offset,
+   int size,
+   const void* data)
+{
+  struct cmd_buffer_data_args* args = NULL;
+  const size_t payload_size = data && size > 0 ? (size_t)size : 0;
+
+  if(!cmd || !(args = RECORD_COMMAND(cmd, cmd_buffer_data, payload_size)))
+    return -1;
+  args->cmd = cmd;
+  args->buf = buf;
+  args->offset = offset;
+  args->size = size;
+  args->has_data = data != NULL;
+  if(data)
+    memcpy(COMMAND_PAYLOAD(args), data, payload_size);
+  return 0;
+}
+
+PROXY_CMD_DRAW(cmd_draw)
+PROXY_CMD_DRAW(cmd_draw_indexed)
+
+/* The commands recorded by the proxy since the previous submission are moved
+ * into the call and replayed into the backend command buffers before their
+ * submission. The payload stores the list of the submitted command buffers,
+ * the size of their streams and then the streams. */
+struct submit_command_buffers_args {
+  struct call call;
+  struct rb_context* ctxt;
+  size_t count;
+  struct rb_command_buffer** list;
+  size_t* stream_sizes;
+  unsigned char* streams;
+};
+
+static int
+exec_submit_command_buffers(struct call* call)
+{
+  struct submit_command_buffers_args* args =
+    (struct submit_command_buffers_args*)call;
+  unsigned char* stream = args->streams;
+  size_t i = 0;
+  int err = 0;
+
+  for(i = 0; args->list && i < args->count; ++i) {
+    if(replay_commands(stream, args->stream_sizes[i]) != 0)
+      err = -1;
+    stream += args->stream_sizes[i];
+    /* Translate the list in place. */
+    args->list[i] = REAL(args->list[i]);
+  }
+  if(proxy.rbi.submit_command_buffers
+     (REAL(args->ctxt), args->count, args->list) != 0)
+    err = -1;
+  return err;
+}
+
+int
+rb_submit_command_buffers
+  (struct rb_context* ctxt,
+   size_t count,
+   struct rb_command_buffer* const cmd_list[])
+{
+  struct submit_command_buffers_args* args = NULL;
+  unsigned char* payload = NULL;
+  size_t payload_size = 0;
+  size_t i = 0;
+
+  if(!ctxt)
+    return -1;
+  if(count && !cmd_list)
+    return -1;
+  for(i = 0; i < count; ++i) {
+    if(!cmd_list[i])
+      return -1;
+  }
+  if(cmd_list) {
+    payload_size = align_size(count * sizeof(struct rb_command_buffer*))
+      + align_size(count * sizeof(size_t));
+    for(i = 0; i < count; ++i)
+      payload_size += cmd_list[i]->size;
+  }
+  if(!(args = BEGIN_CALL(submit_command_buffers, payload_size,
+      (void**)&payload)))
+    return -1;
+  args->ctxt = ctxt;
+  args->count = count;
+  args->list = NULL;
+  args->stream_sizes = NULL;
+  args->streams = NULL;
+  if(cmd_list) {
+    args->list = (struct rb_command_buffer**)payload;
+    payload += align_size(count * sizeof(struct rb_command_buffer*));
+    args->stream_sizes = (size_t*)payload;
+    payload += align_size(count * sizeof(size_t));
+    args->streams = payload;
+    for(i = 0; i < count; ++i) {
+      struct rb_command_buffer* cmd = cmd_list[i];
+      args->list[i] = cmd;
+      args->stream_sizes[i] = cmd->size;
+      if(cmd->size)
+        memcpy(payload, cmd->stream, cmd->size);
+      payload += cmd->size;
+      cmd->size = 0;
+    }
+  }
+  END_CALL();
+}
+
+/*******************************************************************************
+ *
+ * Bundles.
+ *
+ ******************************************************************************/
+/* As on submission, the commands not replayed yet into the backend command
+ * buffer are moved into the payload of the call. */
+struct create_bundle_args {
+  struct call call;
+  struct rb_context* ctxt;
+  struct rb_command_buffer* cmd;
+  struct rb_bundle* bundle;
+  unsigned char* stream;
+  size_t stream_size;
+};
+
+static int
+exec_create_bundle(struct call* call)
+{
+  struct create_bundle_args* args = (struct create_bundle_args*)call;
+  struct rb_bundle* real = NULL;
+  int err = 0;
+
+  if(replay_commands(args->stream, args->stream_size) != 0)
+    err = -1;
+  if(proxy.rbi.create_bundle(REAL(args->ctxt), REAL(args->cmd), &real) != 0)
+    err = -1;
+  args->bundle->handle.real = real;
+  return err;
+}
+
+int
+rb_create_bundle
+  (struct rb_context* ctxt,
+   struct rb_command_buffer* cmd,
+   struct rb_bundle** out_bundle)
+{
+  struct create_bundle_args* args = NULL;
+  struct rb_bundle* bundle = NULL;
+  void* payload = NULL;
+
+  if(!ctxt || !cmd || !out_bundle)
+    return -1;
+  if(!(bundle = new_handle(sizeof(struct rb_bundle), NULL)))
+    return -1;
+  if(!(args = BEGIN_CALL(create_bundle, cmd->size, &payload))) {
+    free(bundle);
+    return -1;
+  }
+  args->ctxt = ctxt;
+  args->cmd = cmd;
+  args->bundle = bundle;
+  args->stream = payload;
+  args->stream_size = cmd->size;
+  if(cmd->size)
+    memcpy(payload, cmd->stream, cmd->size);
+  cmd->size = 0;
+  *out_bundle = bundle;
+  END_CALL();
+}
+
+PROXY_REF_FUNCS(bundle)
+
+struct bundle_uniform_data_args {
+  struct call call;
+  struct rb_bundle* bundle;
+  struct rb_uniform* uniform;
+  int count;
+  const void* data;
+};
+
+static int
+exec_bundle_uniform_data(struct call* call)
+{
+  struct bundle_uniform_data_args* args =
+    (struct bundle_uniform_data_args*)call;
+  return proxy.rbi.bundle_uniform_data
+    (REAL(args->bundle), REAL(args->uniform), args->count, args->data);
+}
+
+int
+rb_bundle_uniform_data
+  (struct rb_bundle* bundle,
+   struct rb_uniform* uniform,
+   int count,
+   const void* data)
+{
+  struct bundle_uniform_data_args* args = NULL;
+  void* payload = NULL;
+  size_t size = 0;
+
+  if(!bundle || !uniform || count <= 0 || !data)
+    return -1;
+  size = (size_t)count * sizeof_type(uniform->type);
+  if(!(args = BEGIN_CALL(bundle_uniform_data, size, &payload)))
+    return -1;
+  args->bundle = bundle;
+  args->uniform = uniform;
+  args->count = count;
+  args->data = memcpy(payload, data, size);
+  END_CALL();
+}
+
+PROXY_FUNC_2H(execute_bundle, struct rb_context*, struct rb_bundle*)
+
+/*******************************************************************************
+ *
+ * Fences.
+ *
+ ******************************************************************************/
+struct create_fence_args {
+  struct call call;
+  struct rb_context* ctxt;
+  struct rb_fence* fence;
+};
+
+static int
+exec_create_fence(struct call* call)
+{
+  struct create_fence_args* args = (struct create_fence_args*)call;
+  struct rb_fence* real = NULL;
+  int err = 0;
+
+  err = proxy.rbi.create_fence(REAL(args->ctxt), &real);
+  args->fence->handle.real = real;
+  return err;
+}
+
+int
+rb_create_fence(struct rb_context* ctxt, struct rb_fence** out_fence)
+{
+  struct create_fence_args* args = NULL;
+  struct rb_fence* fence = NULL;
+
+  if(!ctxt || !out_fence)
+    return -1;
+  if(!(fence = new_handle(sizeof(struct rb_fence), NULL)))
+    return -1;
+  if(!(args = BEGIN_CALL(create_fence, 0, NULL))) {
+    free(fence);
+    return -1;
+  }
+  args->ctxt = ctxt;
+  args->fence = fence;
+  *out_fence = fence;
+  END_CALL();
+}
+
+PROXY_REF_FUNCS(fence)
+PROXY_FUNC_2H(wait_fence, struct rb_context*, struct rb_fence*)
+
+struct poll_fence_args {
+  struct call call;
+  struct rb_context* ctxt;
+  struct rb_fence* fence;
+  int* is_signaled;
+};
+
+static int
+exec_poll_fence(struct call* call)
+{
+  struct poll_fence_args* args = (struct poll_fence_args*)call;
+  return proxy.rbi.poll_fence
+    (REAL(args->ctxt), REAL(args->fence), args->is_signaled);
+}
+
+int
+rb_poll_fence
+  (struct rb_context* ctxt,
+   struct rb_fence* fence,
+   int* is_signaled)
+{
+  struct poll_fence_args args;
+
+  if(!ctxt || !fence || !is_signaled)
+    return -1;
+  args.call.exec = exec_poll_fence;
+  args.ctxt = ctxt;
+  args.fence = fence;
+  args.is_signaled = is_signaled;
+  return run_sync(&args.call);
+}
+
+/*******************************************************************************
+ *
+ * Miscellaneous functions.
+ *
+ ******************************************************************************/
+PROXY_FUNC_DESC(blend, struct rb_blend_desc)
+
+struct clear_args {
+  struct call call;
+  struct rb_context* ctxt;
+  int clear_flag;
+  int has_color;
+  float color_val[4];
+  float depth_val;
+  char stencil_val;
+};
+
+static int
+exec_clear(struct call* call)
+{
+  struct clear_args* args = (struct clear_args*)call;
+  return proxy.rbi.clear
+    (REAL(args->ctxt), args->clear_flag,
+     args->has_color ? args->color_val : NULL,
+     args->depth_val, args->stencil_val);
+}
+
+int
+rb_clear
+  (struct rb_context* ctxt,
+   int clear_flag,
+   const float color_val[4],
+   float depth_val,
+   char stencil_val)
+{
+  struct clear_args* args = NULL;
+  if(!ctxt || !(args = BEGIN_CALL(clear, 0, NULL)))
+    return -1;
+  args->ctxt = ctxt;
+  args->clear_flag = clear_flag;
+  args->has_color = color_val != NULL;
+  if(color_val)
+    memcpy(args->color_val, color_val, sizeof(args->color_val));
+  args->depth_val = depth_val;
+  args->stencil_val = stencil_val;
+  END_CALL();
+}
+
+PROXY_FUNC_DESC(depth_stencil, struct rb_depth_stencil_desc)
+PROXY_FUNC_DRAW(draw)
+PROXY_FUNC_DRAW(draw_indexed)
+
+struct multi_draw_indexed_args {
+  struct call call;
+  struct rb_context* ctxt;
+  enum rb_primitive_type prim_type;
+  unsigned int nb_ranges;
+  const struct rb_draw_range* range_list;
+};
+
+static int
+exec_multi_draw_indexed(struct call* call)
+{
+  struct multi_draw_indexed_args* args = (struct multi_draw_indexed_args*)call;
+  return proxy.rbi.multi_draw_indexed
+    (REAL(args->ctxt), args->prim_type, args->nb_ranges, args->range_list);
+}
+
+int
+rb_multi_draw_indexed
+  (struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int nb_ranges,
+   const struct rb_draw_range* range_list)
+{
+  struct multi_draw_indexed_args* args = NULL;
+  void* payload = NULL;
+  size_t payload_size = 0;
+
+  if(range_list)
+    payload_size = nb_ranges * sizeof(struct rb_draw_range);
+  if(!ctxt
+  || !(args = BEGIN_CALL(multi_draw_indexed, payload_size, &payload)))
+    return -1;
+  args->ctxt = ctxt;
+  args->prim_type = prim_type;
+  args->nb_ranges = nb_ranges;
+  args->range_list = range_list
+    ? memcpy(payload, range_list, payload_size) : NULL;
+  END_CALL();
+}
+PROXY_FUNC_DESC(error_check, struct rb_error_check_desc)
+
+/* Wait for the render thread and report the asynchronous calls that failed
+ * since the previous flush. */
+struct flush_args {
+  struct call call;
+  struct rb_context* ctxt;
+};
+
+static int
+exec_flush(struct call* call)
+{
+  struct flush_args* args = (struct flush_args*)call;
+  return proxy.rbi.flush(REAL(args->ctxt));
+}
+
+int
+rb_flush(struct rb_context* ctxt)
+{
+  struct flush_args args;
+  int err = 0;
+
+  if(!ctxt)
+    return -1;
+  collect_releases();
+  args.call.exec = exec_flush;
+  args.ctxt = ctxt;
+  err = run_sync(&args.call);
+  if(__atomic_exchange_n(&proxy.nb_errors, 0, __ATOMIC_ACQ_REL))
+    err = -1;
+  return err;
+}
+
+PROXY_FUNC_1H(begin_frame, struct rb_context*)
+
+struct end_frame_args {
+  struct call call;
+  struct rb_context* ctxt;
+};
+
+static int
+exec_end_frame(struct call* call)
+{
+  struct end_frame_args* args = (struct end_frame_args*)call;
+  return proxy.rbi.end_frame(REAL(args->ctxt));
+}
+
+int
+rb_end_frame(struct rb_context* ctxt)
+{
+  struct end_frame_args* args = NULL;
+
+  if(!ctxt)
+    return -1;
+  collect_releases();
+  if(!(args = BEGIN_CALL(end_frame, 0, NULL)))
+    return -1;
+  args->ctxt = ctxt;
+  END_CALL();
+}
+
+struct frame_alloc_args {
+  struct call call;
+  struct rb_context* ctxt;
+  size_t size;
+  void** mem;
+};
+
+static int
+exec_frame_alloc(struct call* call)
+{
+  struct frame_alloc_args* args = (struct frame_alloc_args*)call;
+  return proxy.rbi.frame_alloc(REAL(args->ctxt), args->size, args->mem);
+}
+
+int
+rb_frame_alloc(struct rb_context* ctxt, size_t size, void** out_mem)
+{
+  struct frame_alloc_args args;
+
+  if(!ctxt)
+    return -1;
+  args.call.exec = exec_frame_alloc;
+  args.ctxt = ctxt;
+  args.size = size;
+  args.mem = out_mem;
+  return run_sync(&args.call);
+}
+
+PROXY_FUNC_DESC(rasterizer, struct rb_rasterizer_desc)
+PROXY_FUNC_DESC(viewport, struct rb_viewport_desc)
+PROXY_FUNC_GET(get_config, struct rb_context*, struct rb_config*)
+PROXY_FUNC_GET(get_pool_stats, struct rb_context*, struct rb_pool_stats*)
@@ -0,0 +1,212 @@
+#define _POSIX_C_SOURCE 200112L /* sched_yield support */
+
+#include "proxy/rb_proxy_ring.h"
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Number of times a thread polls the ring before it sleeps. */
+#define SPIN_COUNT 64
+
+/* Header of the records. A wrap record fills the end of the buffer when the
+ * next record does not fit into it; its payload is skipped. */
+struct record {
+  size_t size; /* Size in bytes of the record, header included. */
+  size_t is_wrap;
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static FINLINE size_t
+align_size(size_t size)
+{
+  return (size + RB_PROXY_RING_ALIGNMENT - 1)
+    & ~((size_t)RB_PROXY_RING_ALIGNMENT - 1);
+}
+
+static FINLINE struct record*
+record_at(const struct rb_proxy_ring* ring, size_t counter)
+{
+  ASSERT(ring);
+  return (struct record*)(ring->buffer + (counter & (ring->capacity - 1)));
+}
+
+/* Wait for the consumer to pop at least `tail' bytes. */
+static void
+wait_tail(struct rb_proxy_ring* ring, size_t tail)
+{
+  int i = 0;
+  ASSERT(ring);
+
+  for(i = 0; i < SPIN_COUNT; ++i) {
+    if(__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= tail)
+      return;
+    sched_yield();
+  }
+  pthread_mutex_lock(&ring->mutex);
+  __atomic_store_n(&ring->is_producer_asleep, 1, __ATOMIC_SEQ_CST);
+  while(__atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST) < tail)
+    pthread_cond_wait(&ring->producer_cond, &ring->mutex);
+  __atomic_store_n(&ring->is_producer_asleep, 0, __ATOMIC_SEQ_CST);
+  pthread_mutex_unlock(&ring->mutex);
+}
+
+/* Wait for the consumer to free `size' bytes. */
+static FINLINE void
+wait_room(struct rb_proxy_ring* ring, size_t size)
+{
+  ASSERT(ring && size <= ring->capacity);
+  if(ring->head + size > ring->capacity)
+    wait_tail(ring, ring->head + size - ring->capacity);
+}
+
+/* Wait for the producer to commit more than the read bytes. */
+static void
+wait_head(struct rb_proxy_ring* ring)
+{
+  int i = 0;
+  ASSERT(ring);
+
+  for(i = 0; i < SPIN_COUNT; ++i) {
+    if(__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) != ring->read)
+      return;
+    sched_yield();
+  }
+  pthread_mutex_lock(&ring->mutex);
+  __atomic_store_n(&ring->is_consumer_asleep, 1, __ATOMIC_SEQ_CST);
+  while(__atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) == ring->read)
+    pthread_cond_wait(&ring->consumer_cond, &ring->mutex);
+  __atomic_store_n(&ring->is_consumer_asleep, 0, __ATOMIC_SEQ_CST);
+  pthread_mutex_unlock(&ring->mutex);
+}
+
+/* The sleeping flag is set under the mutex before the counter is checked
+ * again; signaling under the mutex thus cannot be lost. */
+static void
+wake_up(struct rb_proxy_ring* ring, int* is_asleep, pthread_cond_t* cond)
+{
+  ASSERT(ring && is_asleep && cond);
+  if(__atomic_load_n(is_asleep, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock(&ring->mutex);
+    pthread_cond_signal(cond);
+    pthread_mutex_unlock(&ring->mutex);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Ring functions.
+ *
+ ******************************************************************************/
+int
+rb_proxy_init_ring(size_t capacity, struct rb_proxy_ring* ring)
+{
+  size_t size = 4 * RB_PROXY_RING_ALIGNMENT;
+
+  if(!ring)
+    return -1;
+  memset(ring, 0, sizeof(struct rb_proxy_ring));
+  while(size < capacity)
+    size *= 2;
+  ring->buffer = malloc(size);
+  if(!ring->buffer)
+    return -1;
+  ring->capacity = size;
+  pthread_mutex_init(&ring->mutex, NULL);
+  pthread_cond_init(&ring->producer_cond, NULL);
+  pthread_cond_init(&ring->consumer_cond, NULL);
+  return 0;
+}
+
+void
+rb_proxy_release_ring(struct rb_proxy_ring* ring)
+{
+  ASSERT(ring);
+  if(!ring->buffer)
+    return;
+  pthread_cond_destroy(&ring->consumer_cond);
+  pthread_cond_destroy(&ring->producer_cond);
+  pthread_mutex_destroy(&ring->mutex);
+  free(ring->buffer);
+  memset(ring, 0, sizeof(struct rb_proxy_ring));
+}
+
+void*
+rb_proxy_ring_reserve(struct rb_proxy_ring* ring, size_t size)
+{
+  struct record* record = NULL;
+  size_t record_size = 0;
+  size_t remaining = 0;
+  ASSERT(ring && !ring->pending);
+  ASSERT(size <= rb_proxy_ring_max_record_size(ring));
+
+  record_size = align_size(sizeof(struct record) + size);
+  remaining = ring->capacity - (ring->head & (ring->capacity - 1));
+  if(record_size > remaining) {
+    /* Skip the end of the buffer that is too small for the record. */
+    wait_room(ring, remaining + record_size);
+    record = record_at(ring, ring->head);
+    record->size = remaining;
+    record->is_wrap = 1;
+    ring->pending = remaining;
+  } else {
+    wait_room(ring, record_size);
+  }
+  record = record_at(ring, ring->head + ring->pending);
+  record->size = record_size;
+  record->is_wrap = 0;
+  ring->pending += record_size;
+  return record + 1;
+}
+
+size_t
+rb_proxy_ring_commit(struct rb_proxy_ring* ring)
+{
+  size_t head = 0;
+  ASSERT(ring && ring->pending);
+
+  head = ring->head + ring->pending;
+  ring->pending = 0;
+  __atomic_store_n(&ring->head, head, __ATOMIC_SEQ_CST);
+  wake_up(ring, &ring->is_consumer_asleep, &ring->consumer_cond);
+  return head;
+}
+
+void
+rb_proxy_ring_wait(struct rb_proxy_ring* ring, size_t head)
+{
+  ASSERT(ring && head <= ring->head);
+  wait_tail(ring, head);
+}
+
+void*
+rb_proxy_ring_front(struct rb_proxy_ring* ring)
+{
+  struct record* record = NULL;
+  ASSERT(ring);
+
+  for(;;) {
+    wait_head(ring);
+    record = record_at(ring, ring->read);
+    if(!record->is_wrap)
+      break;
+    ring->read += record->size;
+  }
+  return record + 1;
+}
+
+void
+rb_proxy_ring_pop(struct rb_proxy_ring* ring)
+{
+  struct record* record = NULL;
+  ASSERT(ring);
+
+  record = record_at(ring, ring->read);
+  ASSERT(!record->is_wrap);
+  ring->read += record->size;
+  __atomic_store_n(&ring->tail, ring->read, __ATOMIC_SEQ_CST);
+  wake_up(ring, &ring->is_producer_asleep, &ring->producer_cond);
+}
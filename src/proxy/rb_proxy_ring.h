@@ -0,0 +1,82 @@
+#ifndef RB_PROXY_RING_H
+#define RB_PROXY_RING_H
+
+#include <snlsys/snlsys.h>
+#include <pthread.h>
+#include <stddef.h>
+
+/*******************************************************************************
+ *
+ * Lock free single producer/single consumer ring of variable sized records.
+ * The producer reserves a contiguous record, fills it and commits it. The
+ * consumer reads the oldest committed record and pops it once it is done with
+ * it. Both spin for a while before sleeping when the ring is full or empty.
+ *
+ ******************************************************************************/
+#define RB_PROXY_RING_ALIGNMENT 16
+
+struct rb_proxy_ring {
+  unsigned char* buffer;
+  size_t capacity; /* Power of 2. */
+  /* Monotonic byte counters. The head is written by the producer and the tail
+   * by the consumer; they are atomically read by the other thread. */
+  size_t head; /* Committed bytes. */
+  size_t tail; /* Popped bytes. */
+  size_t pending; /* Reserved bytes not committed yet. Producer only. */
+  size_t read; /* Bytes read by the consumer, popped or not. */
+  /* Sleep of the producer and the consumer. */
+  pthread_mutex_t mutex;
+  pthread_cond_t producer_cond;
+  pthread_cond_t consumer_cond;
+  int is_producer_asleep;
+  int is_consumer_asleep;
+};
+
+/* The capacity is rounded up to a power of 2. */
+LOCAL_SYM int
+rb_proxy_init_ring
+  (size_t capacity,
+   struct rb_proxy_ring* ring);
+
+LOCAL_SYM void
+rb_proxy_release_ring
+  (struct rb_proxy_ring* ring);
+
+/* Maximum size in bytes of a record. */
+static FINLINE size_t
+rb_proxy_ring_max_record_size(const struct rb_proxy_ring* ring)
+{
+  ASSERT(ring);
+  return ring->capacity / 4;
+}
+
+/* Producer functions. Reserve a record of `size' bytes, aligned on
+ * RB_PROXY_RING_ALIGNMENT, waiting for the consumer to free enough room. Only
+ * one record may be reserved at a time. */
+LOCAL_SYM void*
+rb_proxy_ring_reserve
+  (struct rb_proxy_ring* ring,
+   size_t size);
+
+/* Make the reserved record visible to the consumer. Return the head once the
+ * record is committed. */
+LOCAL_SYM size_t
+rb_proxy_ring_commit
+  (struct rb_proxy_ring* ring);
+
+/* Wait for the consumer to pop the records committed before `head'. */
+LOCAL_SYM void
+rb_proxy_ring_wait
+  (struct rb_proxy_ring* ring,
+   size_t head);
+
+/* Consumer functions. Wait for the oldest record that is not popped yet. */
+LOCAL_SYM void*
+rb_proxy_ring_front
+  (struct rb_proxy_ring* ring);
+
+LOCAL_SYM void
+rb_proxy_ring_pop
+  (struct rb_proxy_ring* ring);
+
+#endif /* RB_PROXY_RING_H */
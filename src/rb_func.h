@@ -8,6 +8,26 @@ RB_FUNC( create_context,
   struct rb_context** out_ctxt
 )
 
+/* Create a context that owns an offscreen driver context rather than relying
+ * on the one made current by the caller. The driver context is made current
+ * on the calling thread. */
+RB_FUNC( create_headless_context,
+  struct mem_allocator* allocator, /* May be NULL. */
+  const struct rb_headless_desc* desc,
+  struct rb_context** out_ctxt
+)
+
+/* Create a context that shares its buffers and textures with `ctxt', e.g. to
+ * create and fill them on a worker thread rather than on the render thread.
+ * The loader context is made current on the calling thread that then issues
+ * all its calls. Its buffers and textures may be used by `ctxt' once it
+ * waited for a fence created by the loader after their upload. They may be
+ * released after the loader, by the flush of `ctxt'. */
+RB_FUNC( create_loader_context,
+  struct rb_context* ctxt,
+  struct rb_context** out_loader
+)
+
 RB_FUNC( context_ref_get,
   struct rb_context* ctxt
 )
@@ -53,6 +73,8 @@ RB_FUNC( tex2d_data,
  * Sampler
  *
  ******************************************************************************/
+/* Samplers created from identical descriptors may share their driver object.
+ * Each sampler keeps its own parameters nevertheless. */
 RB_FUNC( create_sampler,
   struct rb_context* ctxt,
   const struct rb_sampler_desc* desc,
@@ -165,6 +187,17 @@ RB_FUNC( create_shader,
   struct rb_shader** out_shader
 )
 
+/* Create the shader of the source preprocessed by the defines and the
+ * includes of `desc'. The variants of a context are identified by their
+ * preprocessed source: an existing variant is returned with a new reference
+ * rather than compiled again, and may be attached to several programs. A
+ * variant whose source is then set by rb_shader_source is no more shared. */
+RB_FUNC( create_shader_variant,
+  struct rb_context* ctxt,
+  const struct rb_shader_variant_desc* desc,
+  struct rb_shader** out_shader
+)
+
 RB_FUNC( shader_ref_get,
   struct rb_shader* shader
 )
@@ -227,10 +260,29 @@ RB_FUNC( get_program_log,
   const char** out_log
 )
 
+/* In the asynchronous compile mode, the link may be pending on return. Its
+ * failure is then reported by the functions that require the linked program,
+ * e.g. rb_bind_program or rb_program_is_ready. */
 RB_FUNC( link_program,
   struct rb_program* prog
 )
 
+/* Poll the completion of the program link without waiting for it when the
+ * driver compiles in parallel. Once the program is ready, the returned value
+ * is the link status. */
+RB_FUNC( program_is_ready,
+  struct rb_program* prog,
+  int* out_is_ready
+)
+
+/* Define whether the shader compilations and the program links are waited
+ * for. In the asynchronous mode, rb_shader_source returns before the end of
+ * the compilation whose errors are reported by the link. */
+RB_FUNC( compile_mode,
+  struct rb_context* ctxt,
+  const struct rb_compile_desc* desc
+)
+
 /*******************************************************************************
  *
  * Program uniforms.
@@ -358,6 +410,202 @@ RB_FUNC( read_back_framebuffer,
   void* read_data /* May be NULL. */
 )
 
+/*******************************************************************************
+ *
+ * Command buffers.
+ *
+ ******************************************************************************/
+/* A command buffer records rb commands that are executed in order when it is
+ * submitted to its context. Distinct command buffers may be recorded by
+ * several threads at once, provided that the allocator of the context is
+ * thread safe, while the other functions are called by the context thread.
+ * The recorded objects are not referenced and must outlive the submission. */
+RB_FUNC( create_command_buffer,
+  struct rb_context* ctxt,
+  struct rb_command_buffer** out_cmd
+)
+
+RB_FUNC( command_buffer_ref_get,
+  struct rb_command_buffer* cmd
+)
+
+RB_FUNC( command_buffer_ref_put,
+  struct rb_command_buffer* cmd
+)
+
+/* Remove the recorded commands. They are otherwise kept once submitted. */
+RB_FUNC( reset_command_buffer,
+  struct rb_command_buffer* cmd
+)
+
+RB_FUNC( cmd_bind_program,
+  struct rb_command_buffer* cmd,
+  struct rb_program* prog /* May be NULL. */
+)
+
+RB_FUNC( cmd_bind_vertex_array,
+  struct rb_command_buffer* cmd,
+  struct rb_vertex_array* varray /* May be NULL. */
+)
+
+RB_FUNC( cmd_bind_tex2d,
+  struct rb_command_buffer* cmd,
+  struct rb_tex2d* tex, /* May be NULL. */
+  unsigned int tex_unit
+)
+
+RB_FUNC( cmd_bind_sampler,
+  struct rb_command_buffer* cmd,
+  struct rb_sampler* sampler, /* May be NULL. */
+  unsigned int tex_unit
+)
+
+RB_FUNC( cmd_bind_framebuffer,
+  struct rb_command_buffer* cmd,
+  struct rb_framebuffer* buffer /* May be NULL. */
+)
+
+RB_FUNC( cmd_blend,
+  struct rb_command_buffer* cmd,
+  const struct rb_blend_desc* desc
+)
+
+RB_FUNC( cmd_depth_stencil,
+  struct rb_command_buffer* cmd,
+  const struct rb_depth_stencil_desc* desc
+)
+
+RB_FUNC( cmd_rasterizer,
+  struct rb_command_buffer* cmd,
+  const struct rb_rasterizer_desc* desc
+)
+
+RB_FUNC( cmd_viewport,
+  struct rb_command_buffer* cmd,
+  const struct rb_viewport_desc* desc
+)
+
+RB_FUNC( cmd_clear,
+  struct rb_command_buffer* cmd,
+  int clear_flag,
+  const float color_val[4],
+  float depth_val,
+  char stencil_val
+)
+
+/* The uniform values are copied into the command buffer. */
+RB_FUNC( cmd_uniform_data,
+  struct rb_command_buffer* cmd,
+  struct rb_uniform* uniform,
+  int count,
+  const void* data
+)
+
+/* The buffer data are copied into the command buffer. */
+RB_FUNC( cmd_buffer_data,
+  struct rb_command_buffer* cmd,
+  struct rb_buffer* buf,
+  int offset,
+  int size,
+  const void* data
+)
+
+RB_FUNC( cmd_draw,
+  struct rb_command_buffer* cmd,
+  enum rb_primitive_type prim_type,
+  unsigned int count
+)
+
+RB_FUNC( cmd_draw_indexed,
+  struct rb_command_buffer* cmd,
+  enum rb_primitive_type prim_type,
+  unsigned int count
+)
+
+/* Execute the commands of the command buffers in the list order. Each
+ * command buffer must be created by `ctxt'. An error is returned if a command
+ * fails, the remaining commands being still executed. */
+RB_FUNC( submit_command_buffers,
+  struct rb_context* ctxt,
+  size_t count,
+  struct rb_command_buffer* const cmd_list[]
+)
+
+/*******************************************************************************
+ *
+ * Bundles.
+ *
+ ******************************************************************************/
+/* A bundle is an immutable command sequence baked from the commands of `cmd'
+ * that are validated once: the redundant binds and states are removed and the
+ * successive states are merged. The command buffer may be then reset or
+ * released. The bundle references the recorded objects. The bundle functions
+ * are called by the context thread. */
+RB_FUNC( create_bundle,
+  struct rb_context* ctxt,
+  struct rb_command_buffer* cmd,
+  struct rb_bundle** out_bundle
+)
+
+RB_FUNC( bundle_ref_get,
+  struct rb_bundle* bundle
+)
+
+RB_FUNC( bundle_ref_put,
+  struct rb_bundle* bundle
+)
+
+/* Overwrite the recorded values of `uniform', e.g. its per frame values. The
+ * bundle must set `uniform' with at least as many values. */
+RB_FUNC( bundle_uniform_data,
+  struct rb_bundle* bundle,
+  struct rb_uniform* uniform,
+  int count,
+  const void* data
+)
+
+/* Replay the commands of the bundle. An error is returned if a command fails,
+ * the remaining commands being still executed. */
+RB_FUNC( execute_bundle,
+  struct rb_context* ctxt,
+  struct rb_bundle* bundle
+)
+
+/*******************************************************************************
+ *
+ * Fences.
+ *
+ ******************************************************************************/
+/* Insert a fence after the commands submitted to `ctxt' so far and flush
+ * them. The fence is signaled once these commands are complete. */
+RB_FUNC( create_fence,
+  struct rb_context* ctxt,
+  struct rb_fence** out_fence
+)
+
+RB_FUNC( fence_ref_get,
+  struct rb_fence* fence
+)
+
+RB_FUNC( fence_ref_put,
+  struct rb_fence* fence
+)
+
+/* The commands submitted to `ctxt' afterwards are executed once `fence' is
+ * signaled. The caller is not stalled. `ctxt' is the context of the fence or
+ * a context sharing its objects. */
+RB_FUNC( wait_fence,
+  struct rb_context* ctxt,
+  struct rb_fence* fence
+)
+
+/* Check whether `fence' is signaled without waiting for it. */
+RB_FUNC( poll_fence,
+  struct rb_context* ctxt,
+  struct rb_fence* fence,
+  int* is_signaled
+)
+
 /*******************************************************************************
  *
  * Miscellaneous functions.
@@ -393,10 +641,44 @@ RB_FUNC( draw_indexed,
   unsigned int count
 )
 
+/* Draw with one call the ranges of the index buffer of the bound vertex
+ * array. The indices of a range are offset by its base vertex. */
+RB_FUNC( multi_draw_indexed,
+  struct rb_context* ctxt,
+  enum rb_primitive_type prim_type,
+  unsigned int nb_ranges,
+  const struct rb_draw_range* range_list
+)
+
+/* Define how the backend detects the errors of the underlying API. Polling
+ * modes may be unavailable in release builds. */
+RB_FUNC( error_check,
+  struct rb_context* ctxt,
+  const struct rb_error_check_desc* desc
+)
+
 RB_FUNC( flush,
   struct rb_context* ctxt
 )
 
+/* Delimit a frame. The memory returned by rb_frame_alloc during the frame is
+ * released as a whole by rb_end_frame. Frames cannot be nested. */
+RB_FUNC( begin_frame,
+  struct rb_context* ctxt
+)
+
+RB_FUNC( end_frame,
+  struct rb_context* ctxt
+)
+
+/* Allocate `size' bytes of transient memory, aligned on 16 bytes, that are
+ * valid up to the end of the current frame. */
+RB_FUNC( frame_alloc,
+  struct rb_context* ctxt,
+  size_t size,
+  void** out_mem
+)
+
 RB_FUNC( rasterizer,
   struct rb_context* ctxt,
   const struct rb_rasterizer_desc* desc
@@ -412,3 +694,10 @@ RB_FUNC( get_config,
   struct rb_config* cfg
 )
 
+/* Usage of the pools from which the context allocates its objects and into
+ * which it interns their names. */
+RB_FUNC( get_pool_stats,
+  struct rb_context* ctxt,
+  struct rb_pool_stats* stats
+)
+
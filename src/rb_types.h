@@ -157,6 +157,35 @@ enum rb_render_target_type {
   RB_RENDER_TARGET_TEXTURE2D
 };
 
+enum rb_error_check_mode {
+  RB_ERROR_CHECK_NONE, /* No error detection. */
+  RB_ERROR_CHECK_SAMPLED, /* Poll the errors every `sampling_period' calls. */
+  RB_ERROR_CHECK_CALLBACK, /* Asynchronous error report through the driver. */
+  RB_ERROR_CHECK_STRICT /* Poll the errors after each call. */
+};
+
+enum rb_compile_mode {
+  RB_COMPILE_SYNC, /* The compilations and links complete before returning. */
+  RB_COMPILE_ASYNC /* The compilations and links may complete later. */
+};
+
+/* Types of the objects allocated from the context pools. */
+enum rb_object_type {
+  RB_OBJECT_ATTRIB,
+  RB_OBJECT_BUFFER,
+  RB_OBJECT_BUNDLE,
+  RB_OBJECT_COMMAND_BUFFER,
+  RB_OBJECT_FENCE,
+  RB_OBJECT_FRAMEBUFFER,
+  RB_OBJECT_PROGRAM,
+  RB_OBJECT_SAMPLER,
+  RB_OBJECT_SHADER,
+  RB_OBJECT_TEX2D,
+  RB_OBJECT_UNIFORM,
+  RB_OBJECT_VERTEX_ARRAY,
+  RB_OBJECT_TYPES_COUNT
+};
+
 /*******************************************************************************
  *
  * Opaque render backend data structures.
@@ -165,6 +194,9 @@ enum rb_render_target_type {
 struct rb_attrib;
 struct rb_context;
 struct rb_buffer;
+struct rb_bundle;
+struct rb_command_buffer;
+struct rb_fence;
 struct rb_framebuffer;
 struct rb_program;
 struct rb_sampler;
@@ -183,6 +215,11 @@ struct rb_config {
   size_t max_tex_max_anisotropy;
 };
 
+struct rb_headless_desc {
+  unsigned int width; /* Width of the default framebuffer. */
+  unsigned int height; /* Height of the default framebuffer. */
+};
+
 struct rb_sampler_desc {
   enum rb_tex_filter filter;
   enum rb_tex_address address_u;
@@ -227,6 +264,12 @@ struct rb_uniform_desc {
   enum rb_type type;
 };
 
+struct rb_draw_range {
+  unsigned int first_index;
+  unsigned int count; /* Number of indices. */
+  unsigned int base_vertex;
+};
+
 struct rb_viewport_desc {
   int x;
   int y;
@@ -283,6 +326,54 @@ struct rb_clear_framebuffer_color_desc {
   } val;
 };
 
+struct rb_error_check_desc {
+  enum rb_error_check_mode mode;
+  unsigned int sampling_period; /* Used by the RB_ERROR_CHECK_SAMPLED mode. */
+};
+
+struct rb_compile_desc {
+  enum rb_compile_mode mode;
+  /* Hint on the number of driver threads that compile the shaders. 0 lets
+   * the driver choose it. */
+  unsigned int max_threads;
+};
+
+struct rb_shader_define {
+  const char* name;
+  const char* value; /* May be NULL. */
+};
+
+struct rb_shader_variant_desc {
+  enum rb_shader_type type;
+  const char* source; /* Base source shared by the variants. */
+  size_t length;
+  /* Macros defined after the #version directive of the source. */
+  const struct rb_shader_define* define_list;
+  size_t nb_defines;
+  /* Resolve the path of an #include directive into the source to include. It
+   * must remain valid until the variant is created. May be NULL if the source
+   * has no include. Return 0 on success. */
+  int (*include)
+    (void* data,
+     const char* path,
+     const char** out_source,
+     size_t* out_length);
+  void* include_data;
+};
+
+struct rb_object_pool_stats {
+  size_t nb_objects; /* Number of live objects. */
+  size_t nb_slots; /* Number of object slots owned by the pool. */
+  size_t slot_size; /* Size in bytes of an object slot. */
+};
+
+struct rb_pool_stats {
+  struct rb_object_pool_stats object_list[RB_OBJECT_TYPES_COUNT];
+  size_t nb_strings; /* Number of interned names. */
+  size_t string_size; /* Size in bytes reserved for the interned names. */
+  size_t frame_size; /* Size in bytes reserved for the transient data. */
+};
+
 struct rb_render_target {
   enum rb_render_target_type type;
   void* resource;
@@ -1,6 +1,7 @@
 #include "rbi.h"
 #include <snlsys/snlsys.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <dlfcn.h>
 #include <stdint.h>
@@ -12,10 +13,119 @@ void set_rbi_to_null(struct rbi* driver)
     memset(driver, 0, sizeof(struct rbi));
 }
 
+/* Retrieve the rb functions exported by the library. */
+static int
+load_functions(void* handle, struct rbi* table)
+{
+  char* err_msg = NULL;
+  ASSERT(handle && table);
+
+  dlerror(); /* Clear the previous error. */
+
+  #define RB_FUNC(func_name, ...)\
+    table->func_name = (int (*)(__VA_ARGS__))(intptr_t) \
+      dlsym(handle, "rb_"#func_name); \
+    if((err_msg=dlerror())) \
+      goto error;
+
+  #include "rb_func.h"
+
+  #undef RB_FUNC
+
+  return 0;
+
+error:
+  fprintf(stderr, "%s\n", err_msg);
+  return -1;
+}
+
+/* Load the layer on top of the `driver' functions that it then overrides. */
+static int
+push_layer(const char* library, struct rbi* driver)
+{
+  struct rbi next;
+  int (*layer_next)(const struct rbi*) = NULL;
+  void* handle = NULL;
+  char* err_msg = NULL;
+  ASSERT(library && driver);
+
+  handle = dlopen(library, RTLD_LAZY | RTLD_LOCAL);
+  if(!handle) {
+    fprintf(stderr, "%s\n", dlerror());
+    return -1;
+  }
+  /* Register the handle first in order to close it on error. */
+  driver->layer_handle_list[driver->nb_layers++] = handle;
+
+  dlerror();
+  layer_next = (int (*)(const struct rbi*))(intptr_t)
+    dlsym(handle, RBI_LAYER_NEXT_FUNC);
+  if((err_msg = dlerror())) {
+    fprintf(stderr, "%s\n", err_msg);
+    return -1;
+  }
+  memcpy(&next, driver, sizeof(struct rbi));
+  next.handle = NULL;
+  next.layer_handle_list = NULL;
+  next.nb_layers = 0;
+  if(layer_next(&next) != 0) {
+    fprintf(stderr, "%s: cannot initialise the layer\n", library);
+    return -1;
+  }
+  return load_functions(handle, driver);
+}
+
+/*******************************************************************************
+ *
+ * rbi functions.
+ *
+ ******************************************************************************/
 int
 rbi_init(const char* library, struct rbi* driver)
 {
+  const char** layer_list = NULL;
+  const char* env = getenv("RBI_LAYERS");
+  char* layers = NULL;
+  char* str = NULL;
+  size_t len = 0;
+  size_t nb = 0;
   int err = 0;
+
+  if(!env || !*env)
+    return rbi_init_layers(library, NULL, driver);
+
+  /* Split a copy of the colon separated list of layers. */
+  len = strlen(env);
+  layers = malloc(len + 1);
+  layer_list = malloc((len / 2 + 2) * sizeof(const char*));
+  if(!layers || !layer_list)
+    goto error;
+  memcpy(layers, env, len + 1);
+  for(str = strtok(layers, ":"); str; str = strtok(NULL, ":"))
+    layer_list[nb++] = str;
+  layer_list[nb] = NULL;
+
+  err = rbi_init_layers(library, layer_list, driver);
+
+exit:
+  free(layers);
+  free(layer_list);
+  return err;
+
+error:
+  set_rbi_to_null(driver);
+  err = -1;
+  goto exit;
+}
+
+int
+rbi_init_layers
+  (const char* library,
+   const char* layer_list[],
+   struct rbi* driver)
+{
+  int err = 0;
+  size_t nb_layers = 0;
   char* err_msg = NULL;
 
   if(!library || !driver)
@@ -30,15 +140,24 @@ rbi_init(const char* library, struct rbi* driver)
     goto error;
   }
 
-  #define RB_FUNC(func_name, ...)\
-    driver->func_name = (int (*)(__VA_ARGS__))(intptr_t) \
-      dlsym(driver->handle, "rb_"#func_name); \
-    if((err_msg=dlerror())) \
-      goto error;
-
-  #include "rb_func.h"
+  if(load_functions(driver->handle, driver) != 0)
+    goto error;
 
-  #undef RB_FUNC
+  /* The layers are pushed from the backend up to the first listed one whose
+   * functions are thus the rbi functions. */
+  if(layer_list) {
+    while(layer_list[nb_layers])
+      ++nb_layers;
+  }
+  if(nb_layers) {
+    driver->layer_handle_list = malloc(nb_layers * sizeof(void*));
+    if(!driver->layer_handle_list)
+      goto error;
+    while(nb_layers) {
+      if(push_layer(layer_list[--nb_layers], driver) != 0)
+        goto error;
+    }
+  }
 
 exit:
   return err;
@@ -59,10 +178,14 @@ rbi_shutdown(struct rbi* driver)
   if(!driver)
     return -1;
 
+  /* Close the layers from the top-most one down to the backend. */
+  while(driver->nb_layers)
+    dlclose(driver->layer_handle_list[--driver->nb_layers]);
+  free(driver->layer_handle_list);
+
   if(driver->handle)
     dlclose(driver->handle);
 
   set_rbi_to_null(driver);
   return 0;
 }
-
@@ -19,8 +19,17 @@ struct rbi {
 
   /* For internal use only. */
   void* handle;
+  void** layer_handle_list;
+  size_t nb_layers;
 };
 
+/* Name of the function that a layer exports in addition to the rb_ functions:
+ *   int rbi_layer_next(const struct rbi* next);
+ * It is invoked once, when the layer is loaded, with the functions of the next
+ * layer or of the backend toward which the layer forwards its calls. The layer
+ * has to copy the `next' table and must not shut it down. */
+#define RBI_LAYER_NEXT_FUNC "rbi_layer_next"
+
 #ifndef NDEBUG
   #define RBI(rbi, func) ASSERT(0 == (rbi)->func)
 #else
@@ -31,7 +40,21 @@ struct rbi {
 extern "C" {
 #endif
 
+/* Load the backend and the layers listed in the RBI_LAYERS environment
+ * variable, if any, as rbi_init_layers does. The layers are separated by a
+ * colon. */
 RBI_API int rbi_init(const char* library, struct rbi*);
+
+/* Load the backend behind the NULL terminated list of layers. The calls
+ * traverse the layers in the order of the list before reaching the backend.
+ * Without layer, the rbi functions are those of the backend. A same library
+ * cannot be listed several times. */
+RBI_API int
+rbi_init_layers
+  (const char* library,
+   const char* layer_list[], /* May be NULL. */
+   struct rbi*);
+
 RBI_API int rbi_shutdown(struct rbi*);
 
 #ifdef __cplusplus
@@ -0,0 +1,19 @@
+#ifndef RBU_H
+#define RBU_H
+
+#include "rb_types.h"
+#include <snlsys/snlsys.h>
+
+/*******************************************************************************
+ *
+ * Render backend utilities. They are built onto the rbi functions and may be
+ * thus used with any render backend implementation.
+ *
+ ******************************************************************************/
+#if defined(RBU_SHARED_BUILD)
+  #define RBU_API EXPORT_SYM
+#else
+  #define RBU_API IMPORT_SYM
+#endif
+
+#endif /* RBU_H */
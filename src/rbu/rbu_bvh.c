@@ -0,0 +1,1156 @@
+#include "rbu/rbu_bvh.h"
+#include "rbu/rbu_cull.h"
+#include <snlsys/math.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+#ifdef __SSE2__
+  #include <emmintrin.h>
+#endif
+
+#define NODE_WIDTH 4
+#define MAX_LEAF_SIZE 4 /* Maximum number of objects per leaf. */
+#define NB_BINS 16 /* Number of bins of the surface area heuristic. */
+#define NODE_NONE UINT_MAX
+#define ALL_PLANES 0x3Fu
+
+/* Values of a child that is not an inner node. */
+enum {
+  CHILD_EMPTY = -2,
+  CHILD_LEAF = -1
+};
+
+struct box {
+  float lower[3];
+  float upper[3];
+};
+
+/* 4-wide node. The boxes of its children are stored per axis in order to be
+ * tested at once. A child covers the objects [first, first + count) of the
+ * leaf order, and an inner child is stored after its parent. */
+struct node {
+  float lower[3][NODE_WIDTH];
+  float upper[3][NODE_WIDTH];
+  int child[NODE_WIDTH]; /* Index of the inner node or CHILD_<EMPTY|LEAF>. */
+  unsigned int first[NODE_WIDTH];
+  unsigned int count[NODE_WIDTH];
+  unsigned int parent;
+  unsigned int nb_children; /* The children are packed. */
+};
+
+struct object {
+  struct box box;
+  unsigned int value;
+  unsigned int position; /* Position of the object in the leaf order. */
+  unsigned int leaf_node; /* Node whose leaf holds the object. */
+};
+
+/* Committed object, in leaf order. */
+struct prim {
+  struct box box;
+  unsigned int value;
+};
+
+/* Object being partitioned by the build. */
+struct build_prim {
+  struct box box;
+  unsigned int id;
+};
+
+struct build_range {
+  struct box box; /* Bounds of the objects. */
+  struct box centroids; /* Bounds of the centroids of the objects. */
+  unsigned int begin;
+  unsigned int end;
+};
+
+/* Inner node to build from a range of objects. */
+struct build_task {
+  struct build_range range;
+  unsigned int parent;
+  unsigned int slot;
+};
+
+struct stack_entry {
+  unsigned int node;
+  unsigned int planes; /* Frustum planes that may intersect the node. */
+  float distance; /* Distance along the ray to the node. */
+};
+
+struct rbu_bvh {
+  struct ref ref;
+  struct mem_allocator* allocator;
+  float rebuild_ratio;
+  struct object* object_list; /* Per identifier. */
+  size_t nb_objects;
+  size_t max_objects;
+  struct prim* prim_list;
+  size_t nb_prims;
+  size_t max_prims;
+  struct node* node_list;
+  size_t nb_nodes;
+  size_t max_nodes;
+  unsigned char* dirty_list; /* Per node. Set if the node must be refitted. */
+  size_t max_dirty;
+  int is_dirty;
+  double area_sum; /* Sum of the half areas of the boxes of the children. */
+  double built_cost;
+  /* Scratch data. */
+  struct build_prim* build_prim_list;
+  size_t max_build_prims;
+  struct build_task* task_list;
+  size_t max_tasks;
+  struct stack_entry* stack;
+  size_t max_stack;
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static int
+reserve
+  (struct mem_allocator* allocator,
+   void** buf,
+   size_t* capacity,
+   size_t count,
+   size_t size)
+{
+  void* mem = NULL;
+  size_t cap = 0;
+  ASSERT(allocator && buf && capacity && size);
+
+  if(count <= *capacity)
+    return 0;
+  cap = MAX(MAX(*capacity * 2, count), 16);
+  mem = MEM_REALLOC(allocator, *buf, cap * size);
+  if(!mem)
+    return -1;
+  *buf = mem;
+  *capacity = cap;
+  return 0;
+}
+
+static FINLINE void
+box_setup_empty(struct box* box)
+{
+  int i = 0;
+  ASSERT(box);
+  for(i = 0; i < 3; ++i) {
+    box->lower[i] = FLT_MAX;
+    box->upper[i] = -FLT_MAX;
+  }
+}
+
+static FINLINE void
+box_merge(struct box* dst, const struct box* box)
+{
+  int i = 0;
+  ASSERT(dst && box);
+  for(i = 0; i < 3; ++i) {
+    dst->lower[i] = MIN(dst->lower[i], box->lower[i]);
+    dst->upper[i] = MAX(dst->upper[i], box->upper[i]);
+  }
+}
+
+static FINLINE float
+box_half_area(const struct box* box)
+{
+  float size[3];
+  int i = 0;
+  ASSERT(box);
+  for(i = 0; i < 3; ++i)
+    size[i] = MAX(box->upper[i] - box->lower[i], 0.f);
+  return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+}
+
+static FINLINE float
+box_centroid(const struct box* box, int axis)
+{
+  ASSERT(box && axis >= 0 && axis < 3);
+  return (box->lower[axis] + box->upper[axis]) * 0.5f;
+}
+
+static FINLINE void
+get_child_box(const struct node* node, unsigned int i, struct box* box)
+{
+  int k = 0;
+  ASSERT(node && i < NODE_WIDTH && box);
+  for(k = 0; k < 3; ++k) {
+    box->lower[k] = node->lower[k][i];
+    box->upper[k] = node->upper[k][i];
+  }
+}
+
+static FINLINE void
+set_child_box(struct node* node, unsigned int i, const struct box* box)
+{
+  int k = 0;
+  ASSERT(node && i < NODE_WIDTH && box);
+  for(k = 0; k < 3; ++k) {
+    node->lower[k][i] = box->lower[k];
+    node->upper[k][i] = box->upper[k];
+  }
+}
+
+static FINLINE int
+bin_index(float centroid, float lower, float scale)
+{
+  const int i = (int)((centroid - lower) * scale);
+  return MIN(MAX(i, 0), NB_BINS - 1);
+}
+
+static double
+tree_cost(const struct rbu_bvh* bvh)
+{
+  struct box root;
+  struct box box;
+  float area = 0.f;
+  unsigned int i = 0;
+  ASSERT(bvh);
+
+  if(!bvh->nb_nodes)
+    return 0.0;
+  box_setup_empty(&root);
+  for(i = 0; i < bvh->node_list[0].nb_children; ++i) {
+    get_child_box(bvh->node_list, i, &box);
+    box_merge(&root, &box);
+  }
+  area = box_half_area(&root);
+  return area > 0.f ? bvh->area_sum / (double)area : 0.0;
+}
+
+static void
+setup_range
+  (const struct rbu_bvh* bvh,
+   unsigned int begin,
+   unsigned int end,
+   struct build_range* range)
+{
+  unsigned int i = 0;
+  int k = 0;
+  ASSERT(bvh && begin < end && range);
+
+  box_setup_empty(&range->box);
+  box_setup_empty(&range->centroids);
+  for(i = begin; i < end; ++i) {
+    const struct box* box = &bvh->build_prim_list[i].box;
+    box_merge(&range->box, box);
+    for(k = 0; k < 3; ++k) {
+      const float c = box_centroid(box, k);
+      range->centroids.lower[k] = MIN(range->centroids.lower[k], c);
+      range->centroids.upper[k] = MAX(range->centroids.upper[k], c);
+    }
+  }
+  range->begin = begin;
+  range->end = end;
+}
+
+/* Split the range where the binned surface area heuristic is the lowest, or
+ * at its middle if the centroids of its objects are merged. */
+static void
+split_range
+  (struct rbu_bvh* bvh,
+   const struct build_range* range,
+   struct build_range* left,
+   struct build_range* right)
+{
+  struct box bin_box[NB_BINS];
+  unsigned int bin_count[NB_BINS];
+  float right_area[NB_BINS];
+  struct build_prim* prims = NULL;
+  float best_cost = FLT_MAX;
+  float best_scale = 0.f;
+  int best_axis = -1;
+  int best_bin = 0;
+  unsigned int begin = 0;
+  unsigned int end = 0;
+  unsigned int mid = 0;
+  unsigned int i = 0;
+  int axis = 0;
+  int b = 0;
+  ASSERT(bvh && range && left && right);
+  ASSERT(range->end - range->begin > 1);
+
+  prims = bvh->build_prim_list;
+  begin = range->begin;
+  end = range->end;
+  for(axis = 0; axis < 3; ++axis) {
+    const float lower = range->centroids.lower[axis];
+    const float extent = range->centroids.upper[axis] - lower;
+    struct box acc;
+    unsigned int nb_left = 0;
+    float scale = 0.f;
+
+    if(!(extent > 0.f))
+      continue;
+    scale = (float)NB_BINS / extent;
+    for(b = 0; b < NB_BINS; ++b) {
+      box_setup_empty(bin_box + b);
+      bin_count[b] = 0;
+    }
+    for(i = begin; i < end; ++i) {
+      b = bin_index(box_centroid(&prims[i].box, axis), lower, scale);
+      box_merge(bin_box + b, &prims[i].box);
+      ++bin_count[b];
+    }
+    /* Area of the right side of each split, then cost of each split. */
+    box_setup_empty(&acc);
+    for(b = NB_BINS - 1; b > 0; --b) {
+      box_merge(&acc, bin_box + b);
+      right_area[b] = box_half_area(&acc);
+    }
+    box_setup_empty(&acc);
+    for(b = 1; b < NB_BINS; ++b) {
+      const unsigned int nb_right = end - begin - nb_left - bin_count[b-1];
+      float cost = 0.f;
+      box_merge(&acc, bin_box + b - 1);
+      nb_left += bin_count[b-1];
+      if(!nb_left || !nb_right)
+        continue;
+      cost = box_half_area(&acc) * (float)nb_left
+           + right_area[b] * (float)nb_right;
+      if(cost < best_cost) {
+        best_cost = cost;
+        best_axis = axis;
+        best_bin = b;
+        best_scale = scale;
+      }
+    }
+  }
+
+  if(best_axis < 0) {
+    mid = begin + (end - begin) / 2;
+  } else {
+    const float lower = range->centroids.lower[best_axis];
+    unsigned int j = end;
+    i = begin;
+    while(i < j) {
+      b = bin_index(box_centroid(&prims[i].box, best_axis), lower, best_scale);
+      if(b < best_bin) {
+        ++i;
+      } else {
+        const struct build_prim tmp = prims[--j];
+        prims[j] = prims[i];
+        prims[i] = tmp;
+      }
+    }
+    mid = i;
+  }
+  ASSERT(mid > begin && mid < end);
+  setup_range(bvh, begin, mid, left);
+  setup_range(bvh, mid, end, right);
+}
+
+/* Create the node of the range by splitting it into up to 4 children. The
+ * children with too many objects are pushed as tasks to be built later. */
+static int
+create_node
+  (struct rbu_bvh* bvh,
+   const struct build_task* task,
+   size_t* nb_tasks)
+{
+  struct build_range child_list[NODE_WIDTH];
+  struct node* node = NULL;
+  unsigned int nb_children = 1;
+  unsigned int id = 0;
+  unsigned int i = 0;
+  unsigned int j = 0;
+  ASSERT(bvh && task && nb_tasks);
+
+  /* Split the largest child until there are 4 of them or all are leaves. */
+  child_list[0] = task->range;
+  while(nb_children < NODE_WIDTH) {
+    struct build_range range;
+    float best_area = -1.f;
+    int best = -1;
+    for(i = 0; i < nb_children; ++i) {
+      const float area = box_half_area(&child_list[i].box);
+      if(child_list[i].end - child_list[i].begin > MAX_LEAF_SIZE
+      && area > best_area) {
+        best_area = area;
+        best = (int)i;
+      }
+    }
+    if(best < 0)
+      break;
+    range = child_list[best];
+    split_range(bvh, &range, child_list + best, child_list + nb_children);
+    ++nb_children;
+  }
+
+  if(reserve(bvh->allocator, (void**)&bvh->node_list, &bvh->max_nodes,
+       bvh->nb_nodes + 1, sizeof(struct node)) != 0
+  || reserve(bvh->allocator, (void**)&bvh->task_list, &bvh->max_tasks,
+       *nb_tasks + NODE_WIDTH, sizeof(struct build_task)) != 0)
+    return -1;
+  id = (unsigned int)bvh->nb_nodes++;
+  node = bvh->node_list + id;
+  node->parent = task->parent;
+  node->nb_children = nb_children;
+  for(i = 0; i < NODE_WIDTH; ++i) {
+    const struct build_range* range = child_list + i;
+    struct box empty;
+
+    if(i >= nb_children) {
+      box_setup_empty(&empty);
+      set_child_box(node, i, &empty);
+      node->child[i] = CHILD_EMPTY;
+      node->first[i] = node->count[i] = 0;
+      continue;
+    }
+    set_child_box(node, i, &range->box);
+    node->first[i] = range->begin;
+    node->count[i] = range->end - range->begin;
+    bvh->area_sum += (double)box_half_area(&range->box);
+    if(node->count[i] <= MAX_LEAF_SIZE) {
+      node->child[i] = CHILD_LEAF;
+      for(j = range->begin; j < range->end; ++j) {
+        const unsigned int obj = bvh->build_prim_list[j].id;
+        bvh->object_list[obj].leaf_node = id;
+      }
+    } else {
+      /* The index of the inner node is set on its creation. */
+      struct build_task* child_task = bvh->task_list + (*nb_tasks)++;
+      node->child[i] = CHILD_EMPTY;
+      child_task->range = *range;
+      child_task->parent = id;
+      child_task->slot = i;
+    }
+  }
+  if(task->parent != NODE_NONE)
+    bvh->node_list[task->parent].child[task->slot] = (int)id;
+  return 0;
+}
+
+static int
+build(struct rbu_bvh* bvh)
+{
+  size_t nb_tasks = 0;
+  size_t i = 0;
+  ASSERT(bvh);
+
+  bvh->nb_nodes = 0;
+  bvh->nb_prims = 0;
+  bvh->area_sum = 0.0;
+  bvh->built_cost = 0.0;
+  bvh->is_dirty = 0;
+  if(!bvh->nb_objects)
+    return 0;
+
+  if(reserve(bvh->allocator, (void**)&bvh->build_prim_list,
+       &bvh->max_build_prims, bvh->nb_objects, sizeof(struct build_prim)) != 0
+  || reserve(bvh->allocator, (void**)&bvh->prim_list, &bvh->max_prims,
+       bvh->nb_objects, sizeof(struct prim)) != 0
+  || reserve(bvh->allocator, (void**)&bvh->task_list, &bvh->max_tasks,
+       1, sizeof(struct build_task)) != 0)
+    return -1;
+  for(i = 0; i < bvh->nb_objects; ++i) {
+    bvh->build_prim_list[i].box = bvh->object_list[i].box;
+    bvh->build_prim_list[i].id = (unsigned int)i;
+  }
+  setup_range(bvh, 0, (unsigned int)bvh->nb_objects, &bvh->task_list[0].range);
+  bvh->task_list[0].parent = NODE_NONE;
+  bvh->task_list[0].slot = 0;
+  nb_tasks = 1;
+  while(nb_tasks) {
+    const struct build_task task = bvh->task_list[--nb_tasks];
+    if(create_node(bvh, &task, &nb_tasks) != 0) {
+      bvh->nb_nodes = 0;
+      return -1;
+    }
+  }
+  if(reserve(bvh->allocator, (void**)&bvh->dirty_list, &bvh->max_dirty,
+       bvh->nb_nodes, sizeof(unsigned char)) != 0) {
+    bvh->nb_nodes = 0;
+    return -1;
+  }
+  memset(bvh->dirty_list, 0, bvh->nb_nodes);
+
+  /* Store the objects in leaf order. */
+  for(i = 0; i < bvh->nb_objects; ++i) {
+    const unsigned int id = bvh->build_prim_list[i].id;
+    bvh->prim_list[i].box = bvh->object_list[id].box;
+    bvh->prim_list[i].value = bvh->object_list[id].value;
+    bvh->object_list[id].position = (unsigned int)i;
+  }
+  bvh->nb_prims = bvh->nb_objects;
+  bvh->built_cost = tree_cost(bvh);
+  return 0;
+}
+
+/* Recompute the boxes of the children of the dirty nodes, from the last node
+ * to the root since the children are stored after their parent. */
+static void
+refit(struct rbu_bvh* bvh)
+{
+  size_t i = 0;
+  ASSERT(bvh);
+
+  for(i = bvh->nb_nodes; i-- > 0; ) {
+    struct node* node = bvh->node_list + i;
+    unsigned int j = 0;
+    unsigned int k = 0;
+
+    if(!bvh->dirty_list[i])
+      continue;
+    bvh->dirty_list[i] = 0;
+    for(j = 0; j < node->nb_children; ++j) {
+      struct box box;
+      struct box old_box;
+
+      box_setup_empty(&box);
+      if(node->child[j] >= 0) {
+        const struct node* child = bvh->node_list + node->child[j];
+        for(k = 0; k < child->nb_children; ++k) {
+          get_child_box(child, k, &old_box);
+          box_merge(&box, &old_box);
+        }
+      } else {
+        for(k = node->first[j]; k < node->first[j] + node->count[j]; ++k)
+          box_merge(&box, &bvh->prim_list[k].box);
+      }
+      get_child_box(node, j, &old_box);
+      bvh->area_sum +=
+        (double)box_half_area(&box) - (double)box_half_area(&old_box);
+      set_child_box(node, j, &box);
+    }
+  }
+  bvh->is_dirty = 0;
+}
+
+static FINLINE unsigned int
+child_mask(const struct node* node)
+{
+  ASSERT(node && node->nb_children <= NODE_WIDTH);
+  return (1u << node->nb_children) - 1u;
+}
+
+/* Return the mask of the children intersecting the frustum and remove from
+ * the planes of each child those that fully contain it. */
+static FINLINE unsigned int
+cull_node
+  (const struct node* node,
+   const float plane_list[6][4],
+   unsigned int planes,
+   unsigned int child_planes[NODE_WIDTH])
+{
+  unsigned int mask = 0;
+  unsigned int i = 0;
+  int p = 0;
+  int k = 0;
+  ASSERT(node && plane_list && child_planes);
+
+  mask = child_mask(node);
+  for(i = 0; i < NODE_WIDTH; ++i)
+    child_planes[i] = planes;
+  for(p = 0; p < 6 && mask; ++p) {
+    const float* plane = plane_list[p];
+    /* Corners of the boxes the farthest and the nearest along the normal. */
+    const float* far[3];
+    const float* near[3];
+    unsigned int outside = 0;
+    unsigned int inside = 0;
+
+    if(!(planes & (1u << p)))
+      continue;
+    for(k = 0; k < 3; ++k) {
+      far[k] = plane[k] > 0.f ? node->upper[k] : node->lower[k];
+      near[k] = plane[k] > 0.f ? node->lower[k] : node->upper[k];
+    }
+#ifdef __SSE2__
+    {
+      const __m128 zero = _mm_setzero_ps();
+      const __m128 nx = _mm_set1_ps(plane[0]);
+      const __m128 ny = _mm_set1_ps(plane[1]);
+      const __m128 nz = _mm_set1_ps(plane[2]);
+      __m128 dfar = _mm_set1_ps(plane[3]);
+      __m128 dnear = dfar;
+      dfar = _mm_add_ps(dfar, _mm_mul_ps(nx, _mm_loadu_ps(far[0])));
+      dfar = _mm_add_ps(dfar, _mm_mul_ps(ny, _mm_loadu_ps(far[1])));
+      dfar = _mm_add_ps(dfar, _mm_mul_ps(nz, _mm_loadu_ps(far[2])));
+      dnear = _mm_add_ps(dnear, _mm_mul_ps(nx, _mm_loadu_ps(near[0])));
+      dnear = _mm_add_ps(dnear, _mm_mul_ps(ny, _mm_loadu_ps(near[1])));
+      dnear = _mm_add_ps(dnear, _mm_mul_ps(nz, _mm_loadu_ps(near[2])));
+      outside = (unsigned int)_mm_movemask_ps(_mm_cmplt_ps(dfar, zero));
+      inside = (unsigned int)_mm_movemask_ps(_mm_cmpge_ps(dnear, zero));
+    }
+#else
+    for(i = 0; i < NODE_WIDTH; ++i) {
+      const float dfar = plane[3]
+        + plane[0] * far[0][i] + plane[1] * far[1][i] + plane[2] * far[2][i];
+      const float dnear = plane[3]
+        + plane[0] * near[0][i] + plane[1] * near[1][i]
+        + plane[2] * near[2][i];
+      outside |= (unsigned int)(dfar < 0.f) << i;
+      inside |= (unsigned int)(dnear >= 0.f) << i;
+    }
+#endif
+    mask &= ~outside;
+    for(i = 0; i < NODE_WIDTH; ++i) {
+      if(inside & (1u << i))
+        child_planes[i] &= ~(1u << p);
+    }
+  }
+  return mask;
+}
+
+static FINLINE int
+is_box_culled
+  (const struct box* box,
+   const float plane_list[6][4],
+   unsigned int planes)
+{
+  int p = 0;
+  ASSERT(box && plane_list);
+
+  for(p = 0; p < 6; ++p) {
+    const float* plane = plane_list[p];
+    if((planes & (1u << p))
+    && plane[3]
+     + plane[0] * (plane[0] > 0.f ? box->upper[0] : box->lower[0])
+     + plane[1] * (plane[1] > 0.f ? box->upper[1] : box->lower[1])
+     + plane[2] * (plane[2] > 0.f ? box->upper[2] : box->lower[2]) < 0.f)
+      return 1;
+  }
+  return 0;
+}
+
+/* Return the mask of the children overlapping the box and set in `inside' the
+ * mask of those that it contains. */
+static FINLINE unsigned int
+overlap_node
+  (const struct node* node,
+   const struct box* box,
+   unsigned int* inside)
+{
+  unsigned int overlap = 0;
+  unsigned int contained = 0;
+  ASSERT(node && box && inside);
+
+#ifdef __SSE2__
+  {
+    __m128 overlap4 = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    __m128 contained4 = overlap4;
+    int k = 0;
+    for(k = 0; k < 3; ++k) {
+      const __m128 lower = _mm_loadu_ps(node->lower[k]);
+      const __m128 upper = _mm_loadu_ps(node->upper[k]);
+      const __m128 box_lower = _mm_set1_ps(box->lower[k]);
+      const __m128 box_upper = _mm_set1_ps(box->upper[k]);
+      overlap4 = _mm_and_ps(overlap4, _mm_cmple_ps(lower, box_upper));
+      overlap4 = _mm_and_ps(overlap4, _mm_cmpge_ps(upper, box_lower));
+      contained4 = _mm_and_ps(contained4, _mm_cmpge_ps(lower, box_lower));
+      contained4 = _mm_and_ps(contained4, _mm_cmple_ps(upper, box_upper));
+    }
+    overlap = (unsigned int)_mm_movemask_ps(overlap4);
+    contained = (unsigned int)_mm_movemask_ps(contained4);
+  }
+#else
+  {
+    unsigned int i = 0;
+    int k = 0;
+    overlap = contained = (1u << NODE_WIDTH) - 1u;
+    for(i = 0; i < NODE_WIDTH; ++i) {
+      for(k = 0; k < 3; ++k) {
+        if(node->lower[k][i] > box->upper[k]
+        || node->upper[k][i] < box->lower[k])
+          overlap &= ~(1u << i);
+        if(node->lower[k][i] < box->lower[k]
+        || node->upper[k][i] > box->upper[k])
+          contained &= ~(1u << i);
+      }
+    }
+  }
+#endif
+  overlap &= child_mask(node);
+  *inside = contained & overlap;
+  return overlap;
+}
+
+static FINLINE int
+is_box_overlapping(const struct box* a, const struct box* b)
+{
+  int k = 0;
+  ASSERT(a && b);
+  for(k = 0; k < 3; ++k) {
+    if(a->lower[k] > b->upper[k] || a->upper[k] < b->lower[k])
+      return 0;
+  }
+  return 1;
+}
+
+/* Return the mask of the children hit by the ray within [0, max_distance]
+ * and write into `distance' the distance to each child. */
+static FINLINE unsigned int
+intersect_node
+  (const struct node* node,
+   const float org[3],
+   const float inv_dir[3],
+   float max_distance,
+   float distance[NODE_WIDTH])
+{
+  unsigned int mask = 0;
+  ASSERT(node && org && inv_dir && distance);
+
+#ifdef __SSE2__
+  {
+    __m128 tnear = _mm_setzero_ps();
+    __m128 tfar = _mm_set1_ps(max_distance);
+    int k = 0;
+    for(k = 0; k < 3; ++k) {
+      const __m128 o = _mm_set1_ps(org[k]);
+      const __m128 inv = _mm_set1_ps(inv_dir[k]);
+      const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node->lower[k]), o),
+        inv);
+      const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node->upper[k]), o),
+        inv);
+      tnear = _mm_max_ps(tnear, _mm_min_ps(t0, t1));
+      tfar = _mm_min_ps(tfar, _mm_max_ps(t0, t1));
+    }
+    _mm_storeu_ps(distance, tnear);
+    mask = (unsigned int)_mm_movemask_ps(_mm_cmple_ps(tnear, tfar));
+  }
+#else
+  {
+    unsigned int i = 0;
+    int k = 0;
+    for(i = 0; i < NODE_WIDTH; ++i) {
+      float tnear = 0.f;
+      float tfar = max_distance;
+      for(k = 0; k < 3; ++k) {
+        const float t0 = (node->lower[k][i] - org[k]) * inv_dir[k];
+        const float t1 = (node->upper[k][i] - org[k]) * inv_dir[k];
+        tnear = MAX(tnear, MIN(t0, t1));
+        tfar = MIN(tfar, MAX(t0, t1));
+      }
+      distance[i] = tnear;
+      mask |= (unsigned int)(tnear <= tfar) << i;
+    }
+  }
+#endif
+  return mask & child_mask(node);
+}
+
+static FINLINE int
+intersect_box
+  (const struct box* box,
+   const float org[3],
+   const float inv_dir[3],
+   float max_distance,
+   float* distance)
+{
+  float tnear = 0.f;
+  float tfar = max_distance;
+  int k = 0;
+  ASSERT(box && org && inv_dir && distance);
+
+  for(k = 0; k < 3; ++k) {
+    const float t0 = (box->lower[k] - org[k]) * inv_dir[k];
+    const float t1 = (box->upper[k] - org[k]) * inv_dir[k];
+    tnear = MAX(tnear, MIN(t0, t1));
+    tfar = MIN(tfar, MAX(t0, t1));
+  }
+  *distance = tnear;
+  return tnear <= tfar;
+}
+
+static FINLINE unsigned int
+emit_child
+  (const struct rbu_bvh* bvh,
+   const struct node* node,
+   unsigned int i,
+   unsigned int* value_list)
+{
+  unsigned int j = 0;
+  ASSERT(bvh && node && i < node->nb_children && value_list);
+  for(j = 0; j < node->count[i]; ++j)
+    value_list[j] = bvh->prim_list[node->first[i] + j].value;
+  return node->count[i];
+}
+
+static void
+release_bvh(struct ref* ref)
+{
+  struct rbu_bvh* bvh = NULL;
+  ASSERT(ref);
+
+  bvh = CONTAINER_OF(ref, struct rbu_bvh, ref);
+  if(bvh->object_list)
+    MEM_FREE(bvh->allocator, bvh->object_list);
+  if(bvh->prim_list)
+    MEM_FREE(bvh->allocator, bvh->prim_list);
+  if(bvh->node_list)
+    MEM_FREE(bvh->allocator, bvh->node_list);
+  if(bvh->dirty_list)
+    MEM_FREE(bvh->allocator, bvh->dirty_list);
+  if(bvh->build_prim_list)
+    MEM_FREE(bvh->allocator, bvh->build_prim_list);
+  if(bvh->task_list)
+    MEM_FREE(bvh->allocator, bvh->task_list);
+  if(bvh->stack)
+    MEM_FREE(bvh->allocator, bvh->stack);
+  MEM_FREE(bvh->allocator, bvh);
+}
+
+/*******************************************************************************
+ *
+ * BVH functions.
+ *
+ ******************************************************************************/
+int
+rbu_create_bvh
+  (struct mem_allocator* specific_allocator,
+   const struct rbu_bvh_desc* desc,
+   struct rbu_bvh** out_bvh)
+{
+  struct mem_allocator* allocator = NULL;
+  struct rbu_bvh* bvh = NULL;
+
+  if(!desc || !out_bvh)
+    return -1;
+  allocator = specific_allocator ? specific_allocator : &mem_default_allocator;
+  bvh = MEM_CALLOC(allocator, 1, sizeof(struct rbu_bvh));
+  if(!bvh)
+    return -1;
+  ref_init(&bvh->ref);
+  bvh->allocator = allocator;
+  bvh->rebuild_ratio = desc->rebuild_ratio;
+  *out_bvh = bvh;
+  return 0;
+}
+
+int
+rbu_bvh_ref_get(struct rbu_bvh* bvh)
+{
+  if(!bvh)
+    return -1;
+  ref_get(&bvh->ref);
+  return 0;
+}
+
+int
+rbu_bvh_ref_put(struct rbu_bvh* bvh)
+{
+  if(!bvh)
+    return -1;
+  ref_put(&bvh->ref, release_bvh);
+  return 0;
+}
+
+int
+rbu_bvh_add
+  (struct rbu_bvh* bvh,
+   const float lower[3],
+   const float upper[3],
+   unsigned int value,
+   unsigned int* out_id)
+{
+  struct object* obj = NULL;
+
+  if(!bvh || !lower || !upper || bvh->nb_objects >= UINT_MAX)
+    return -1;
+  if(reserve(bvh->allocator, (void**)&bvh->object_list, &bvh->max_objects,
+       bvh->nb_objects + 1, sizeof(struct object)) != 0)
+    return -1;
+  obj = bvh->object_list + bvh->nb_objects;
+  memcpy(obj->box.lower, lower, 3 * sizeof(float));
+  memcpy(obj->box.upper, upper, 3 * sizeof(float));
+  obj->value = value;
+  obj->position = obj->leaf_node = NODE_NONE;
+  if(out_id)
+    *out_id = (unsigned int)bvh->nb_objects;
+  ++bvh->nb_objects;
+  return 0;
+}
+
+int
+rbu_bvh_update
+  (struct rbu_bvh* bvh,
+   unsigned int id,
+   const float lower[3],
+   const float upper[3])
+{
+  struct object* obj = NULL;
+  unsigned int node = 0;
+
+  if(!bvh || !lower || !upper || id >= bvh->nb_objects)
+    return -1;
+  obj = bvh->object_list + id;
+  memcpy(obj->box.lower, lower, 3 * sizeof(float));
+  memcpy(obj->box.upper, upper, 3 * sizeof(float));
+  if(id < bvh->nb_prims) {
+    bvh->prim_list[obj->position].box = obj->box;
+    /* Mark the path from the leaf up to the first dirty node. */
+    for(node = obj->leaf_node;
+        node != NODE_NONE && !bvh->dirty_list[node];
+        node = bvh->node_list[node].parent)
+      bvh->dirty_list[node] = 1;
+    bvh->is_dirty = 1;
+  }
+  return 0;
+}
+
+int
+rbu_bvh_clear(struct rbu_bvh* bvh)
+{
+  if(!bvh)
+    return -1;
+  bvh->nb_objects = 0;
+  bvh->nb_prims = 0;
+  bvh->nb_nodes = 0;
+  bvh->is_dirty = 0;
+  return 0;
+}
+
+int
+rbu_bvh_get_size(struct rbu_bvh* bvh, unsigned int* nb_objects)
+{
+  if(!bvh || !nb_objects)
+    return -1;
+  *nb_objects = (unsigned int)bvh->nb_objects;
+  return 0;
+}
+
+int
+rbu_bvh_commit(struct rbu_bvh* bvh, int* is_rebuilt)
+{
+  int rebuild = 0;
+
+  if(!bvh)
+    return -1;
+  if(bvh->nb_prims != bvh->nb_objects) {
+    rebuild = 1;
+  } else if(bvh->is_dirty) {
+    refit(bvh);
+    rebuild = bvh->built_cost > 0.0
+      && tree_cost(bvh) > bvh->built_cost * (double)bvh->rebuild_ratio;
+  }
+  if(rebuild && build(bvh) != 0)
+    return -1;
+  if(is_rebuilt)
+    *is_rebuilt = rebuild;
+  return 0;
+}
+
+int
+rbu_bvh_rebuild(struct rbu_bvh* bvh)
+{
+  if(!bvh)
+    return -1;
+  return build(bvh);
+}
+
+int
+rbu_bvh_cull
+  (struct rbu_bvh* bvh,
+   const struct rbu_frustum* frustum,
+   unsigned int* value_list,
+   unsigned int* out_nb_values)
+{
+  size_t nb_entries = 0;
+  unsigned int nb = 0;
+
+  if(!bvh
+  || !frustum
+  || (bvh->nb_prims && !value_list)
+  || !out_nb_values)
+    return -1;
+
+  if(bvh->nb_nodes) {
+    if(reserve(bvh->allocator, (void**)&bvh->stack, &bvh->max_stack,
+         1, sizeof(struct stack_entry)) != 0)
+      return -1;
+    bvh->stack[0].node = 0;
+    bvh->stack[0].planes = ALL_PLANES;
+    nb_entries = 1;
+  }
+  while(nb_entries) {
+    const struct stack_entry entry = bvh->stack[--nb_entries];
+    const struct node* node = bvh->node_list + entry.node;
+    unsigned int child_planes[NODE_WIDTH];
+    unsigned int mask = 0;
+    unsigned int i = 0;
+    unsigned int j = 0;
+
+    if(reserve(bvh->allocator, (void**)&bvh->stack, &bvh->max_stack,
+         nb_entries + NODE_WIDTH, sizeof(struct stack_entry)) != 0)
+      return -1;
+    mask = cull_node(node, frustum->plane_list, entry.planes, child_planes);
+    for(i = 0; mask; ++i, mask >>= 1) {
+      if(!(mask & 1u))
+        continue;
+      if(!child_planes[i]) {
+        /* The child is inside the frustum. */
+        nb += emit_child(bvh, node, i, value_list + nb);
+      } else if(node->child[i] == CHILD_LEAF) {
+        for(j = node->first[i]; j < node->first[i] + node->count[i]; ++j) {
+          const struct prim* prim = bvh->prim_list + j;
+          if(!is_box_culled(&prim->box, frustum->plane_list, child_planes[i]))
+            value_list[nb++] = prim->value;
+        }
+      } else {
+        struct stack_entry* child = bvh->stack + nb_entries++;
+        child->node = (unsigned int)node->child[i];
+        child->planes = child_planes[i];
+      }
+    }
+  }
+  *out_nb_values = nb;
+  return 0;
+}
+
+int
+rbu_bvh_overlap
+  (struct rbu_bvh* bvh,
+   const float lower[3],
+   const float upper[3],
+   unsigned int* value_list,
+   unsigned int* out_nb_values)
+{
+  struct box box;
+  size_t nb_entries = 0;
+  unsigned int nb = 0;
+
+  if(!bvh
+  || !lower
+  || !upper
+  || (bvh->nb_prims && !value_list)
+  || !out_nb_values)
+    return -1;
+
+  memcpy(box.lower, lower, 3 * sizeof(float));
+  memcpy(box.upper, upper, 3 * sizeof(float));
+  if(bvh->nb_nodes) {
+    if(reserve(bvh->allocator, (void**)&bvh->stack, &bvh->max_stack,
+         1, sizeof(struct stack_entry)) != 0)
+      return -1;
+    bvh->stack[0].node = 0;
+    bvh->stack[0].planes = ALL_PLANES;
+    nb_entries = 1;
+  }
+  while(nb_entries) {
+    const struct stack_entry entry = bvh->stack[--nb_entries];
+    const struct node* node = bvh->node_list + entry.node;
+    unsigned int inside = 0;
+    unsigned int mask = 0;
+    unsigned int i = 0;
+    unsigned int j = 0;
+
+    if(reserve(bvh->allocator, (void**)&bvh->stack, &bvh->max_stack,
+         nb_entries + NODE_WIDTH, sizeof(struct stack_entry)) != 0)
+      return -1;
+    mask = overlap_node(node, &box, &inside);
+    for(i = 0; mask; ++i, mask >>= 1) {
+      if(!(mask & 1u))
+        continue;
+      if(inside & (1u << i)) {
+        nb += emit_child(bvh, node, i, value_list + nb);
+      } else if(node->child[i] == CHILD_LEAF) {
+        for(j = node->first[i]; j < node->first[i] + node->count[i]; ++j) {
+          const struct prim* prim = bvh->prim_list + j;
+          if(is_box_overlapping(&prim->box, &box))
+            value_list[nb++] = prim->value;
+        }
+      } else {
+        bvh->stack[nb_entries++].node = (unsigned int)node->child[i];
+      }
+    }
+  }
+  *out_nb_values = nb;
+  return 0;
+}
+
+int
+rbu_bvh_pick
+  (struct rbu_bvh* bvh,
+   const float org[3],
+   const float dir[3],
+   float max_distance,
+   rbu_bvh_ray_filter_T filter,
+   void* filter_data,
+   struct rbu_bvh_hit* hit,
+   int* is_hit)
+{
+  float inv_dir[3];
+  float best = max_distance;
+  size_t nb_entries = 0;
+  int k = 0;
+
+  if(!bvh || !org || !dir || !(max_distance >= 0.f) || !hit || !is_hit)
+    return -1;
+
+  /* Avoid the infinite inverse directions whose product with 0 is NaN. */
+  for(k = 0; k < 3; ++k) {
+    const float d = fabsf(dir[k]) > 1.e-30f
+      ? dir[k] : (dir[k] < 0.f ? -1.e-30f : 1.e-30f);
+    inv_dir[k] = 1.f / d;
+  }
+  *is_hit = 0;
+  if(bvh->nb_nodes) {
+    if(reserve(bvh->allocator, (void**)&bvh->stack, &bvh->max_stack,
+         1, sizeof(struct stack_entry)) != 0)
+      return -1;
+    bvh->stack[0].node = 0;
+    bvh->stack[0].distance = 0.f;
+    nb_entries = 1;
+  }
+  while(nb_entries) {
+    const struct stack_entry entry = bvh->stack[--nb_entries];
+    const struct node* node = bvh->node_list + entry.node;
+    struct stack_entry child_list[NODE_WIDTH];
+    float distance[NODE_WIDTH];
+    unsigned int nb_children = 0;
+    unsigned int mask = 0;
+    unsigned int i = 0;
+    unsigned int j = 0;
+
+    if(entry.distance > best)
+      continue;
+    if(reserve(bvh->allocator, (void**)&bvh->stack, &bvh->max_stack,
+         nb_entries + NODE_WIDTH, sizeof(struct stack_entry)) != 0)
+      return -1;
+    mask = intersect_node(node, org, inv_dir, best, distance);
+    for(i = 0; mask; ++i, mask >>= 1) {
+      if(!(mask & 1u))
+        continue;
+      if(node->child[i] != CHILD_LEAF) {
+        /* Sort the inner children from the farthest to the nearest. */
+        for(j = nb_children; j && child_list[j-1].distance < distance[i]; --j)
+          child_list[j] = child_list[j-1];
+        child_list[j].node = (unsigned int)node->child[i];
+        child_list[j].planes = ALL_PLANES;
+        child_list[j].distance = distance[i];
+        ++nb_children;
+        continue;
+      }
+      for(j = node->first[i]; j < node->first[i] + node->count[i]; ++j) {
+        const struct prim* prim = bvh->prim_list + j;
+        float t = 0.f;
+        if(!intersect_box(&prim->box, org, inv_dir, best, &t))
+          continue;
+        if(filter) {
+          t = filter(prim->value, org, dir, t, filter_data);
+          if(t < 0.f || t > best)
+            continue;
+        }
+        best = t;
+        hit->value = prim->value;
+        hit->distance = t;
+        *is_hit = 1;
+      }
+    }
+    /* The nearest child is popped first. */
+    for(i = 0; i < nb_children; ++i) {
+      if(child_list[i].distance <= best)
+        bvh->stack[nb_entries++] = child_list[i];
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,143 @@
+#ifndef RBU_BVH_H
+#define RBU_BVH_H
+
+#include "rbu/rbu.h"
+
+/*******************************************************************************
+ *
+ * Bounding volume hierarchy over the axis aligned bounding boxes of the
+ * objects of a scene. The tree is built with the surface area heuristic into
+ * 4-wide nodes storing the boxes of their children in structure of arrays
+ * layout, so that the 4 children of a node are tested at once with SSE2. The
+ * moving objects only refit the boxes of the nodes above them; the tree is
+ * rebuilt when the refits degraded its cost too much or when objects were
+ * added. The values of the objects found by the queries, e.g. the mesh
+ * identifiers of a static batch, are then drawn with the rb_draw* functions
+ * through rbu_static_batch_draw_meshes or an rbu render queue.
+ *
+ ******************************************************************************/
+struct mem_allocator;
+struct rbu_bvh;
+struct rbu_frustum;
+
+struct rbu_bvh_desc {
+  /* Rebuild the tree on commit when its cost, i.e. the sum of the areas of
+   * its boxes relatively to the area of its root, exceeds `rebuild_ratio'
+   * times its cost when it was built, e.g. 1.5. */
+  float rebuild_ratio;
+};
+
+struct rbu_bvh_hit {
+  unsigned int value; /* Value of the hit object. */
+  float distance; /* Along the ray, in units of its direction. */
+};
+
+/* Return the distance along the ray of its intersection with the geometry of
+ * the object `value', or a negative value if it is missed. `distance' is the
+ * distance to the bounding box of the object. */
+typedef float
+(*rbu_bvh_ray_filter_T)
+  (unsigned int value,
+   const float org[3],
+   const float dir[3],
+   float distance,
+   void* data);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+RBU_API int
+rbu_create_bvh
+  (struct mem_allocator* allocator, /* May be NULL. */
+   const struct rbu_bvh_desc* desc,
+   struct rbu_bvh** out_bvh);
+
+RBU_API int
+rbu_bvh_ref_get
+  (struct rbu_bvh* bvh);
+
+RBU_API int
+rbu_bvh_ref_put
+  (struct rbu_bvh* bvh);
+
+/* Add an object bounded by the box [lower, upper]. It is part of the tree
+ * from the next commit. The identifier of the object is the number of
+ * objects added before it. */
+RBU_API int
+rbu_bvh_add
+  (struct rbu_bvh* bvh,
+   const float lower[3],
+   const float upper[3],
+   unsigned int value,
+   unsigned int* out_id); /* May be NULL. */
+
+/* Update the bounding box of a moving object. The tree is refitted on the
+ * next commit. */
+RBU_API int
+rbu_bvh_update
+  (struct rbu_bvh* bvh,
+   unsigned int id,
+   const float lower[3],
+   const float upper[3]);
+
+RBU_API int
+rbu_bvh_clear
+  (struct rbu_bvh* bvh);
+
+RBU_API int
+rbu_bvh_get_size
+  (struct rbu_bvh* bvh,
+   unsigned int* nb_objects);
+
+/* Make the tree reflect the added and updated objects by refitting it or, if
+ * required, by rebuilding it. `is_rebuilt' is set to 1 if the tree was
+ * rebuilt and to 0 otherwise. */
+RBU_API int
+rbu_bvh_commit
+  (struct rbu_bvh* bvh,
+   int* is_rebuilt); /* May be NULL. */
+
+/* Rebuild the tree from scratch. */
+RBU_API int
+rbu_bvh_rebuild
+  (struct rbu_bvh* bvh);
+
+/* The queries use a traversal stack of the tree and must be thus issued by one
+ * thread at a time. They ignore the objects that were not committed. The
+ * values of the found objects are written in the order of the traversal into
+ * `value_list', that must store as many values as there are objects. */
+RBU_API int
+rbu_bvh_cull
+  (struct rbu_bvh* bvh,
+   const struct rbu_frustum* frustum,
+   unsigned int* value_list,
+   unsigned int* out_nb_values);
+
+RBU_API int
+rbu_bvh_overlap
+  (struct rbu_bvh* bvh,
+   const float lower[3],
+   const float upper[3],
+   unsigned int* value_list,
+   unsigned int* out_nb_values);
+
+/* Find the closest object hit by the ray within [0, max_distance]. Without
+ * filter the objects are hit on their bounding box. `is_hit' is set to 0 if
+ * no object is hit. */
+RBU_API int
+rbu_bvh_pick
+  (struct rbu_bvh* bvh,
+   const float org[3],
+   const float dir[3],
+   float max_distance,
+   rbu_bvh_ray_filter_T filter, /* May be NULL. */
+   void* filter_data,
+   struct rbu_bvh_hit* hit,
+   int* is_hit);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* RBU_BVH_H */
@@ -0,0 +1,492 @@
+#include "common/rb_thread_pool.h"
+#include "rbu/rbu_cull.h"
+#include <snlsys/math.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+#ifdef __SSE2__
+  #include <emmintrin.h>
+#endif
+/* The AVX2 kernel is compiled for its own target and is selected at run time
+ * if the CPU supports it. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define CULL_AVX2
+  #include <immintrin.h>
+#endif
+
+/* Number of objects per task of a parallel cull. Multiple of 8. */
+#define CHUNK_SIZE 8192
+
+enum {
+  CENTER_X,
+  CENTER_Y,
+  CENTER_Z,
+  EXTENT_X,
+  EXTENT_Y,
+  EXTENT_Z,
+  RADIUS,
+  NB_ARRAYS
+};
+
+/* Write the values of the visible objects of [begin, end) into `out' and
+ * return their number. */
+typedef unsigned int
+(*cull_range_func_T)
+  (const struct rbu_cull_set* set,
+   const float plane_list[6][4],
+   size_t begin,
+   size_t end,
+   unsigned int* out);
+
+struct rbu_cull_set {
+  struct ref ref;
+  struct mem_allocator* allocator;
+  struct rb_thread_pool* pool;
+  cull_range_func_T cull_range;
+  float* array_list[NB_ARRAYS];
+  unsigned int* value_list;
+  size_t nb_objects;
+  size_t max_objects;
+  unsigned int* chunk_count_list; /* Number of visible objects per chunk. */
+  size_t max_chunks;
+};
+
+struct cull_job {
+  const struct rbu_cull_set* set;
+  const float (*plane_list)[4];
+  unsigned int* visible_list;
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static void
+normalize_plane(const float plane[4], float res[4])
+{
+  float len = 0.f;
+  int i = 0;
+  ASSERT(plane && res);
+
+  len = sqrtf(plane[0]*plane[0] + plane[1]*plane[1] + plane[2]*plane[2]);
+  for(i = 0; i < 4; ++i)
+    res[i] = len > 0.f ? plane[i] / len : plane[i];
+}
+
+static void
+set_bounds
+  (struct rbu_cull_set* set,
+   size_t id,
+   const float lower[3],
+   const float upper[3],
+   float radius)
+{
+  float extent[3];
+  int i = 0;
+  ASSERT(set && id < set->nb_objects && lower && upper);
+
+  for(i = 0; i < 3; ++i) {
+    set->array_list[CENTER_X + i][id] = (lower[i] + upper[i]) * 0.5f;
+    extent[i] = (upper[i] - lower[i]) * 0.5f;
+    set->array_list[EXTENT_X + i][id] = extent[i];
+  }
+  if(radius <= 0.f) {
+    radius = sqrtf
+      (extent[0]*extent[0] + extent[1]*extent[1] + extent[2]*extent[2]);
+  }
+  set->array_list[RADIUS][id] = radius;
+}
+
+static unsigned int
+cull_range_scalar
+  (const struct rbu_cull_set* set,
+   const float plane_list[6][4],
+   size_t begin,
+   size_t end,
+   unsigned int* out)
+{
+  const float* const* arrays = NULL;
+  unsigned int nb = 0;
+  size_t i = 0;
+  int p = 0;
+  ASSERT(set && plane_list && begin <= end && end <= set->nb_objects);
+
+  arrays = (const float* const*)set->array_list;
+  for(i = begin; i < end; ++i) {
+    for(p = 0; p < 6; ++p) {
+      const float* plane = plane_list[p];
+      const float d =
+        plane[0] * arrays[CENTER_X][i]
+      + plane[1] * arrays[CENTER_Y][i]
+      + plane[2] * arrays[CENTER_Z][i]
+      + plane[3];
+      const float r =
+        fabsf(plane[0]) * arrays[EXTENT_X][i]
+      + fabsf(plane[1]) * arrays[EXTENT_Y][i]
+      + fabsf(plane[2]) * arrays[EXTENT_Z][i];
+      if(d + MIN(r, arrays[RADIUS][i]) < 0.f)
+        break;
+    }
+    if(p == 6)
+      out[nb++] = set->value_list[i];
+  }
+  return nb;
+}
+
+/* Write the values of the objects [first, first + 8) whose bit is set in
+ * `mask'. */
+static FINLINE unsigned int
+emit_visible
+  (const struct rbu_cull_set* set,
+   size_t first,
+   int mask,
+   unsigned int* out)
+{
+  unsigned int nb = 0;
+  unsigned int bits = (unsigned int)mask;
+  while(bits) {
+    out[nb++] = set->value_list[first + (size_t)__builtin_ctz(bits)];
+    bits &= bits - 1;
+  }
+  return nb;
+}
+
+#ifdef __SSE2__
+static unsigned int
+cull_range_sse2
+  (const struct rbu_cull_set* set,
+   const float plane_list[6][4],
+   size_t begin,
+   size_t end,
+   unsigned int* out)
+{
+  const __m128 sign = _mm_set1_ps(-0.f);
+  const __m128 zero = _mm_setzero_ps();
+  const float* const* arrays = NULL;
+  unsigned int nb = 0;
+  size_t i = 0;
+  int p = 0;
+  ASSERT(set && plane_list && begin <= end && end <= set->nb_objects);
+
+  arrays = (const float* const*)set->array_list;
+  for(i = begin; i + 4 <= end; i += 4) {
+    const __m128 cx = _mm_loadu_ps(arrays[CENTER_X] + i);
+    const __m128 cy = _mm_loadu_ps(arrays[CENTER_Y] + i);
+    const __m128 cz = _mm_loadu_ps(arrays[CENTER_Z] + i);
+    const __m128 ex = _mm_loadu_ps(arrays[EXTENT_X] + i);
+    const __m128 ey = _mm_loadu_ps(arrays[EXTENT_Y] + i);
+    const __m128 ez = _mm_loadu_ps(arrays[EXTENT_Z] + i);
+    const __m128 radius = _mm_loadu_ps(arrays[RADIUS] + i);
+    int mask = 0xF;
+
+    for(p = 0; p < 6 && mask; ++p) {
+      const __m128 nx = _mm_set1_ps(plane_list[p][0]);
+      const __m128 ny = _mm_set1_ps(plane_list[p][1]);
+      const __m128 nz = _mm_set1_ps(plane_list[p][2]);
+      __m128 d = _mm_set1_ps(plane_list[p][3]);
+      __m128 r = _mm_mul_ps(_mm_andnot_ps(sign, nx), ex);
+      d = _mm_add_ps(d, _mm_mul_ps(nx, cx));
+      d = _mm_add_ps(d, _mm_mul_ps(ny, cy));
+      d = _mm_add_ps(d, _mm_mul_ps(nz, cz));
+      r = _mm_add_ps(r, _mm_mul_ps(_mm_andnot_ps(sign, ny), ey));
+      r = _mm_add_ps(r, _mm_mul_ps(_mm_andnot_ps(sign, nz), ez));
+      r = _mm_min_ps(r, radius);
+      mask &= _mm_movemask_ps(_mm_cmpge_ps(_mm_add_ps(d, r), zero));
+    }
+    nb += emit_visible(set, i, mask, out + nb);
+  }
+  return nb + cull_range_scalar(set, plane_list, i, end, out + nb);
+}
+#endif /* __SSE2__ */
+
+#ifdef CULL_AVX2
+__attribute__((target("avx2"))) static unsigned int
+cull_range_avx2
+  (const struct rbu_cull_set* set,
+   const float plane_list[6][4],
+   size_t begin,
+   size_t end,
+   unsigned int* out)
+{
+  const __m256 sign = _mm256_set1_ps(-0.f);
+  const __m256 zero = _mm256_setzero_ps();
+  const float* const* arrays = NULL;
+  unsigned int nb = 0;
+  size_t i = 0;
+  int p = 0;
+  ASSERT(set && plane_list && begin <= end && end <= set->nb_objects);
+
+  arrays = (const float* const*)set->array_list;
+  for(i = begin; i + 8 <= end; i += 8) {
+    const __m256 cx = _mm256_loadu_ps(arrays[CENTER_X] + i);
+    const __m256 cy = _mm256_loadu_ps(arrays[CENTER_Y] + i);
+    const __m256 cz = _mm256_loadu_ps(arrays[CENTER_Z] + i);
+    const __m256 ex = _mm256_loadu_ps(arrays[EXTENT_X] + i);
+    const __m256 ey = _mm256_loadu_ps(arrays[EXTENT_Y] + i);
+    const __m256 ez = _mm256_loadu_ps(arrays[EXTENT_Z] + i);
+    const __m256 radius = _mm256_loadu_ps(arrays[RADIUS] + i);
+    int mask = 0xFF;
+
+    for(p = 0; p < 6 && mask; ++p) {
+      const __m256 nx = _mm256_set1_ps(plane_list[p][0]);
+      const __m256 ny = _mm256_set1_ps(plane_list[p][1]);
+      const __m256 nz = _mm256_set1_ps(plane_list[p][2]);
+      __m256 d = _mm256_set1_ps(plane_list[p][3]);
+      __m256 r = _mm256_mul_ps(_mm256_andnot_ps(sign, nx), ex);
+      d = _mm256_add_ps(d, _mm256_mul_ps(nx, cx));
+      d = _mm256_add_ps(d, _mm256_mul_ps(ny, cy));
+      d = _mm256_add_ps(d, _mm256_mul_ps(nz, cz));
+      r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_andnot_ps(sign, ny), ey));
+      r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_andnot_ps(sign, nz), ez));
+      r = _mm256_min_ps(r, radius);
+      mask &= _mm256_movemask_ps
+        (_mm256_cmp_ps(_mm256_add_ps(d, r), zero, _CMP_GE_OQ));
+    }
+    nb += emit_visible(set, i, mask, out + nb);
+  }
+  return nb + cull_range_scalar(set, plane_list, i, end, out + nb);
+}
+#endif /* CULL_AVX2 */
+
+static void
+cull_chunk(void* data, size_t chunk, unsigned int thread_id)
+{
+  const struct cull_job* job = data;
+  const struct rbu_cull_set* set = NULL;
+  size_t begin = 0;
+  size_t end = 0;
+  ASSERT(data);
+  (void)thread_id;
+
+  set = job->set;
+  begin = chunk * CHUNK_SIZE;
+  end = MIN(begin + CHUNK_SIZE, set->nb_objects);
+  set->chunk_count_list[chunk] = set->cull_range
+    (set, job->plane_list, begin, end, job->visible_list + begin);
+}
+
+static void
+release_cull_set(struct ref* ref)
+{
+  struct rbu_cull_set* set = NULL;
+  int i = 0;
+  ASSERT(ref);
+
+  set = CONTAINER_OF(ref, struct rbu_cull_set, ref);
+  if(set->pool)
+    rb_release_thread_pool(set->pool);
+  for(i = 0; i < NB_ARRAYS; ++i) {
+    if(set->array_list[i])
+      MEM_FREE(set->allocator, set->array_list[i]);
+  }
+  if(set->value_list)
+    MEM_FREE(set->allocator, set->value_list);
+  if(set->chunk_count_list)
+    MEM_FREE(set->allocator, set->chunk_count_list);
+  MEM_FREE(set->allocator, set);
+}
+
+/*******************************************************************************
+ *
+ * Cull functions.
+ *
+ ******************************************************************************/
+int
+rbu_frustum_setup(struct rbu_frustum* frustum, const float view_proj[16])
+{
+  int i = 0;
+  int j = 0;
+
+  if(!frustum || !view_proj)
+    return -1;
+  /* Combine the 4th row of the matrix with its 1st, 2nd and 3rd rows. */
+  for(i = 0; i < 3; ++i) {
+    for(j = 0; j < 4; ++j) {
+      frustum->plane_list[2*i+0][j] = view_proj[j*4+3] + view_proj[j*4+i];
+      frustum->plane_list[2*i+1][j] = view_proj[j*4+3] - view_proj[j*4+i];
+    }
+  }
+  for(i = 0; i < 6; ++i)
+    normalize_plane(frustum->plane_list[i], frustum->plane_list[i]);
+  return 0;
+}
+
+int
+rbu_create_cull_set
+  (struct mem_allocator* specific_allocator,
+   unsigned int nb_threads,
+   struct rbu_cull_set** out_set)
+{
+  struct mem_allocator* allocator = NULL;
+  struct rbu_cull_set* set = NULL;
+
+  if(!nb_threads || !out_set)
+    return -1;
+  allocator = specific_allocator ? specific_allocator : &mem_default_allocator;
+  set = MEM_CALLOC(allocator, 1, sizeof(struct rbu_cull_set));
+  if(!set)
+    return -1;
+  ref_init(&set->ref);
+  set->allocator = allocator;
+  if(rb_create_thread_pool(allocator, nb_threads, &set->pool) != 0) {
+    rbu_cull_set_ref_put(set);
+    return -1;
+  }
+  set->cull_range = cull_range_scalar;
+#ifdef __SSE2__
+  set->cull_range = cull_range_sse2;
+#endif
+#ifdef CULL_AVX2
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2"))
+    set->cull_range = cull_range_avx2;
+#endif
+  *out_set = set;
+  return 0;
+}
+
+int
+rbu_cull_set_ref_get(struct rbu_cull_set* set)
+{
+  if(!set)
+    return -1;
+  ref_get(&set->ref);
+  return 0;
+}
+
+int
+rbu_cull_set_ref_put(struct rbu_cull_set* set)
+{
+  if(!set)
+    return -1;
+  ref_put(&set->ref, release_cull_set);
+  return 0;
+}
+
+int
+rbu_cull_set_add
+  (struct rbu_cull_set* set,
+   const float lower[3],
+   const float upper[3],
+   float radius,
+   unsigned int value,
+   unsigned int* out_id)
+{
+  int i = 0;
+
+  if(!set || !lower || !upper || set->nb_objects >= UINT_MAX)
+    return -1;
+  if(set->nb_objects == set->max_objects) {
+    const size_t max = MAX(set->max_objects * 2, 64);
+    for(i = 0; i < NB_ARRAYS; ++i) {
+      float* array = MEM_REALLOC
+        (set->allocator, set->array_list[i], max * sizeof(float));
+      if(!array)
+        return -1;
+      set->array_list[i] = array;
+    }
+    set->value_list = MEM_REALLOC
+      (set->allocator, set->value_list, max * sizeof(unsigned int));
+    if(!set->value_list)
+      return -1;
+    set->max_objects = max;
+  }
+  set->value_list[set->nb_objects] = value;
+  ++set->nb_objects;
+  set_bounds(set, set->nb_objects - 1, lower, upper, radius);
+  if(out_id)
+    *out_id = (unsigned int)(set->nb_objects - 1);
+  return 0;
+}
+
+int
+rbu_cull_set_update
+  (struct rbu_cull_set* set,
+   unsigned int id,
+   const float lower[3],
+   const float upper[3],
+   float radius)
+{
+  if(!set || !lower || !upper || id >= set->nb_objects)
+    return -1;
+  set_bounds(set, id, lower, upper, radius);
+  return 0;
+}
+
+int
+rbu_cull_set_clear(struct rbu_cull_set* set)
+{
+  if(!set)
+    return -1;
+  set->nb_objects = 0;
+  return 0;
+}
+
+int
+rbu_cull_set_get_size(struct rbu_cull_set* set, unsigned int* nb_objects)
+{
+  if(!set || !nb_objects)
+    return -1;
+  *nb_objects = (unsigned int)set->nb_objects;
+  return 0;
+}
+
+int
+rbu_cull_set_cull
+  (struct rbu_cull_set* set,
+   const struct rbu_frustum* frustum,
+   unsigned int* visible_list,
+   unsigned int* out_nb_visible)
+{
+  struct cull_job job;
+  float plane_list[6][4];
+  size_t nb_chunks = 0;
+  size_t i = 0;
+  unsigned int nb = 0;
+
+  if(!set
+  || !frustum
+  || (set->nb_objects && !visible_list)
+  || !out_nb_visible)
+    return -1;
+
+  /* Normalize the planes in order to compare their distances to the radii. */
+  for(i = 0; i < 6; ++i)
+    normalize_plane(frustum->plane_list[i], plane_list[i]);
+
+  nb_chunks = (set->nb_objects + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  if(nb_chunks <= 1 || rb_thread_pool_nb_threads(set->pool) == 1) {
+    nb = set->cull_range
+      (set, (const float (*)[4])plane_list, 0, set->nb_objects, visible_list);
+  } else {
+    if(nb_chunks > set->max_chunks) {
+      unsigned int* list = MEM_REALLOC(set->allocator, set->chunk_count_list,
+        nb_chunks * sizeof(unsigned int));
+      if(!list)
+        return -1;
+      set->chunk_count_list = list;
+      set->max_chunks = nb_chunks;
+    }
+    /* Each chunk writes its visible objects at its offset in the list. They
+     * are then packed in place. */
+    job.set = set;
+    job.plane_list = (const float (*)[4])plane_list;
+    job.visible_list = visible_list;
+    rb_thread_pool_run(set->pool, nb_chunks, cull_chunk, &job);
+    for(i = 0; i < nb_chunks; ++i) {
+      const unsigned int count = set->chunk_count_list[i];
+      if(i && count) {
+        memmove(visible_list + nb, visible_list + i * CHUNK_SIZE,
+          count * sizeof(unsigned int));
+      }
+      nb += count;
+    }
+  }
+  *out_nb_visible = nb;
+  return 0;
+}
@@ -0,0 +1,100 @@
+#ifndef RBU_CULL_H
+#define RBU_CULL_H
+
+#include "rbu/rbu.h"
+
+/*******************************************************************************
+ *
+ * Frustum culling. A cull set stores the bounding volumes of its objects in
+ * structure of arrays layout: the center and the half extents of their axis
+ * aligned bounding box and the radius of their bounding sphere, centered on
+ * the box. The volumes are tested against the 6 planes of a frustum 8 objects
+ * at a time with AVX2 when the CPU supports it, and 4 at a time with SSE2
+ * otherwise; an object is culled if the box or the sphere is outside a plane.
+ * The large sets are split in chunks tested in parallel by the threads of the
+ * set. The values of the visible objects, e.g. the mesh identifiers of a
+ * static batch, are written in their order of addition into a compact list.
+ *
+ ******************************************************************************/
+struct mem_allocator;
+struct rbu_cull_set;
+
+/* The point p is inside the plane (a, b, c, d) if a*px + b*py + c*pz + d >= 0.
+ * The planes are normalized by the cull. */
+struct rbu_frustum {
+  float plane_list[6][4];
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Extract the planes of the frustum of the column major view projection
+ * matrix `view_proj', the clip space depth being in [-w, w]. The planes are
+ * normalized. */
+RBU_API int
+rbu_frustum_setup
+  (struct rbu_frustum* frustum,
+   const float view_proj[16]);
+
+/* Create a cull set whose chunks are tested by `nb_threads' threads, the
+ * calling thread included. */
+RBU_API int
+rbu_create_cull_set
+  (struct mem_allocator* allocator, /* May be NULL. */
+   unsigned int nb_threads,
+   struct rbu_cull_set** out_set);
+
+RBU_API int
+rbu_cull_set_ref_get
+  (struct rbu_cull_set* set);
+
+RBU_API int
+rbu_cull_set_ref_put
+  (struct rbu_cull_set* set);
+
+/* Add an object bounded by the box [lower, upper] and by the sphere of radius
+ * `radius' centered on the box. A radius <= 0 means the sphere circumscribing
+ * the box. The identifier of the object is the number of objects added before
+ * it. */
+RBU_API int
+rbu_cull_set_add
+  (struct rbu_cull_set* set,
+   const float lower[3],
+   const float upper[3],
+   float radius,
+   unsigned int value,
+   unsigned int* out_id); /* May be NULL. */
+
+/* Update the bounding volumes of a moving object. */
+RBU_API int
+rbu_cull_set_update
+  (struct rbu_cull_set* set,
+   unsigned int id,
+   const float lower[3],
+   const float upper[3],
+   float radius);
+
+RBU_API int
+rbu_cull_set_clear
+  (struct rbu_cull_set* set);
+
+RBU_API int
+rbu_cull_set_get_size
+  (struct rbu_cull_set* set,
+   unsigned int* nb_objects);
+
+/* Write into `visible_list', that must store as many values as there are
+ * objects in the set, the values of the objects that may be visible. */
+RBU_API int
+rbu_cull_set_cull
+  (struct rbu_cull_set* set,
+   const struct rbu_frustum* frustum,
+   unsigned int* visible_list,
+   unsigned int* out_nb_visible);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* RBU_CULL_H */
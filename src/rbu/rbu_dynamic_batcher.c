@@ -0,0 +1,476 @@
+#include "rbi/rbi.h"
+#include "rbu/rbu_dynamic_batcher.h"
+#include <snlsys/math.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+#include <string.h>
+
+#ifdef __SSE2__
+  #include <emmintrin.h>
+#endif
+
+/* Streaming vertex and index buffers of a batch. */
+struct stream {
+  struct rb_buffer* vertex_buffer;
+  struct rb_buffer* index_buffer;
+  struct rb_vertex_array* vertex_array;
+};
+
+struct rbu_dynamic_batcher {
+  struct ref ref;
+  struct mem_allocator* allocator;
+  struct rbi rbi;
+  struct rb_context* ctxt;
+  struct rbu_dynamic_batcher_desc desc;
+  struct rb_buffer_attrib* attrib_list;
+  /* Staging batch. */
+  struct rbu_batch_state state;
+  float* vertices;
+  unsigned int* indices;
+  unsigned int nb_vertices;
+  unsigned int nb_indices;
+  /* Streams of the frame. */
+  struct stream* stream_list;
+  size_t nb_streams;
+  size_t max_streams;
+  size_t nb_used_streams;
+  struct rbu_dynamic_batcher_stats stats;
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static int
+is_state_equal(const struct rbu_batch_state* a, const struct rbu_batch_state* b)
+{
+  ASSERT(a && b);
+  return a->program == b->program
+      && a->nb_textures == b->nb_textures
+      && !memcmp(a->tex_list, b->tex_list,
+           a->nb_textures * sizeof(struct rb_tex2d*))
+      && !memcmp(a->sampler_list, b->sampler_list,
+           a->nb_textures * sizeof(struct rb_sampler*))
+      && a->blend == b->blend
+      && a->depth_stencil == b->depth_stencil
+      && a->rasterizer == b->rasterizer
+      && a->prim_type == b->prim_type;
+}
+
+/* Transform the float3 at the beginning of the `count' vertices of `stride'
+ * floats by the column major 4x4 `matrix', `w' being their 4th coordinate. */
+static void
+transform_vertices
+  (float* data,
+   size_t stride,
+   unsigned int count,
+   const float* matrix,
+   float w)
+{
+  unsigned int i = 0;
+  ASSERT((data || !count) && stride >= 3 && matrix);
+
+#ifdef __SSE2__
+  {
+    const __m128 c0 = _mm_loadu_ps(matrix + 0);
+    const __m128 c1 = _mm_loadu_ps(matrix + 4);
+    const __m128 c2 = _mm_loadu_ps(matrix + 8);
+    const __m128 c3 = _mm_mul_ps(_mm_loadu_ps(matrix + 12), _mm_set1_ps(w));
+    float res[4];
+
+    for(i = 0; i < count; ++i, data += stride) {
+      __m128 r = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(data[0])), c3);
+      r = _mm_add_ps(_mm_mul_ps(c1, _mm_set1_ps(data[1])), r);
+      r = _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(data[2])), r);
+      _mm_storeu_ps(res, r);
+      data[0] = res[0];
+      data[1] = res[1];
+      data[2] = res[2];
+    }
+  }
+#else
+  for(i = 0; i < count; ++i, data += stride) {
+    const float x = data[0];
+    const float y = data[1];
+    const float z = data[2];
+    data[0] = matrix[0]*x + matrix[4]*y + matrix[8]*z + matrix[12]*w;
+    data[1] = matrix[1]*x + matrix[5]*y + matrix[9]*z + matrix[13]*w;
+    data[2] = matrix[2]*x + matrix[6]*y + matrix[10]*z + matrix[14]*w;
+  }
+#endif
+}
+
+/* Copy the `count' indices of `src' into `dst' offset by `base'. */
+static void
+rebase_indices
+  (unsigned int* dst,
+   const unsigned int* src,
+   unsigned int count,
+   unsigned int base)
+{
+  unsigned int i = 0;
+  ASSERT((dst && src) || !count);
+
+#ifdef __SSE2__
+  {
+    const __m128i offset = _mm_set1_epi32((int)base);
+    for(; i + 4 <= count; i += 4) {
+      const __m128i ids = _mm_loadu_si128((const __m128i*)(src + i));
+      _mm_storeu_si128((__m128i*)(dst + i), _mm_add_epi32(ids, offset));
+    }
+  }
+#endif
+  for(; i < count; ++i)
+    dst[i] = src[i] + base;
+}
+
+static void
+release_stream(struct rbi* rbi, struct stream* stream)
+{
+  ASSERT(rbi && stream);
+  if(stream->vertex_array)
+    RBI(rbi, vertex_array_ref_put(stream->vertex_array));
+  if(stream->vertex_buffer)
+    RBI(rbi, buffer_ref_put(stream->vertex_buffer));
+  if(stream->index_buffer)
+    RBI(rbi, buffer_ref_put(stream->index_buffer));
+}
+
+static int
+create_stream(struct rbu_dynamic_batcher* batcher, struct stream* stream)
+{
+  struct rb_buffer_desc buf_desc;
+  struct rbi* rbi = NULL;
+  int err = 0;
+  ASSERT(batcher && stream);
+
+  rbi = &batcher->rbi;
+  memset(stream, 0, sizeof(struct stream));
+  buf_desc.size = batcher->desc.max_vertices * batcher->desc.vertex_size;
+  buf_desc.target = RB_BIND_VERTEX_BUFFER;
+  buf_desc.usage = RB_USAGE_DYNAMIC;
+  err = rbi->create_buffer
+    (batcher->ctxt, &buf_desc, NULL, &stream->vertex_buffer);
+  if(err != 0)
+    goto error;
+  buf_desc.size = batcher->desc.max_indices * sizeof(unsigned int);
+  buf_desc.target = RB_BIND_INDEX_BUFFER;
+  err = rbi->create_buffer
+    (batcher->ctxt, &buf_desc, NULL, &stream->index_buffer);
+  if(err != 0)
+    goto error;
+  err = rbi->create_vertex_array(batcher->ctxt, &stream->vertex_array);
+  if(err != 0)
+    goto error;
+  err = rbi->vertex_attrib_array
+    (stream->vertex_array, stream->vertex_buffer, batcher->desc.nb_attribs,
+     batcher->attrib_list);
+  if(err != 0)
+    goto error;
+  err = rbi->vertex_index_array(stream->vertex_array, stream->index_buffer);
+  if(err != 0)
+    goto error;
+
+exit:
+  return err;
+error:
+  release_stream(rbi, stream);
+  memset(stream, 0, sizeof(struct stream));
+  goto exit;
+}
+
+/* Return the next unused stream of the frame, creating it if necessary. */
+static struct stream*
+next_stream(struct rbu_dynamic_batcher* batcher)
+{
+  ASSERT(batcher && batcher->nb_used_streams <= batcher->nb_streams);
+
+  if(batcher->nb_used_streams == batcher->nb_streams) {
+    if(batcher->nb_streams == batcher->max_streams) {
+      const size_t max = MAX(batcher->max_streams * 2, 4);
+      struct stream* list = MEM_REALLOC
+        (batcher->allocator, batcher->stream_list, max * sizeof(struct stream));
+      if(!list)
+        return NULL;
+      batcher->stream_list = list;
+      batcher->max_streams = max;
+    }
+    if(create_stream(batcher, batcher->stream_list + batcher->nb_streams) != 0)
+      return NULL;
+    ++batcher->nb_streams;
+  }
+  return batcher->stream_list + batcher->nb_used_streams++;
+}
+
+static void
+release_dynamic_batcher(struct ref* ref)
+{
+  struct rbu_dynamic_batcher* batcher = NULL;
+  size_t i = 0;
+  ASSERT(ref);
+
+  batcher = CONTAINER_OF(ref, struct rbu_dynamic_batcher, ref);
+  for(i = 0; i < batcher->nb_streams; ++i)
+    release_stream(&batcher->rbi, batcher->stream_list + i);
+  if(batcher->stream_list)
+    MEM_FREE(batcher->allocator, batcher->stream_list);
+  if(batcher->attrib_list)
+    MEM_FREE(batcher->allocator, batcher->attrib_list);
+  if(batcher->vertices)
+    MEM_FREE(batcher->allocator, batcher->vertices);
+  if(batcher->indices)
+    MEM_FREE(batcher->allocator, batcher->indices);
+  if(batcher->ctxt)
+    RBI(&batcher->rbi, context_ref_put(batcher->ctxt));
+  MEM_FREE(batcher->allocator, batcher);
+}
+
+/*******************************************************************************
+ *
+ * Dynamic batcher functions.
+ *
+ ******************************************************************************/
+int
+rbu_create_dynamic_batcher
+  (struct mem_allocator* specific_allocator,
+   const struct rbi* rbi,
+   struct rb_context* ctxt,
+   const struct rbu_dynamic_batcher_desc* desc,
+   struct rbu_dynamic_batcher** out_batcher)
+{
+  struct mem_allocator* allocator = NULL;
+  struct rbu_dynamic_batcher* batcher = NULL;
+  int i = 0;
+  int err = 0;
+
+  if(!rbi
+  || !ctxt
+  || !desc
+  || !out_batcher
+  || desc->nb_attribs <= 0
+  || !desc->attrib_list
+  || !desc->vertex_size
+  || desc->vertex_size % sizeof(float)
+  || !desc->max_vertices
+  || !desc->max_indices) {
+    err = -1;
+    goto error;
+  }
+  #define CHECK_OFFSET(offset, size) \
+    ((offset) < 0 \
+     || ((size_t)(offset) % sizeof(float) == 0 \
+      && (size_t)(offset) + (size) <= desc->vertex_size))
+  if(!CHECK_OFFSET(desc->position_offset, 3 * sizeof(float))
+  || !CHECK_OFFSET(desc->normal_offset, 3 * sizeof(float))
+  || !CHECK_OFFSET(desc->instance_offset, sizeof(float))) {
+    err = -1;
+    goto error;
+  }
+  #undef CHECK_OFFSET
+
+  allocator = specific_allocator ? specific_allocator : &mem_default_allocator;
+  batcher = MEM_CALLOC(allocator, 1, sizeof(struct rbu_dynamic_batcher));
+  if(!batcher) {
+    err = -1;
+    goto error;
+  }
+  ref_init(&batcher->ref);
+  batcher->allocator = allocator;
+  batcher->rbi = *rbi;
+  batcher->desc = *desc;
+  batcher->attrib_list = MEM_ALLOC
+    (allocator, (size_t)desc->nb_attribs * sizeof(struct rb_buffer_attrib));
+  batcher->vertices = MEM_ALLOC
+    (allocator, desc->max_vertices * desc->vertex_size);
+  batcher->indices = MEM_ALLOC
+    (allocator, desc->max_indices * sizeof(unsigned int));
+  if(!batcher->attrib_list || !batcher->vertices || !batcher->indices) {
+    err = -1;
+    goto error;
+  }
+  for(i = 0; i < desc->nb_attribs; ++i) {
+    batcher->attrib_list[i] = desc->attrib_list[i];
+    batcher->attrib_list[i].stride = desc->vertex_size;
+  }
+  batcher->desc.attrib_list = batcher->attrib_list;
+  RBI(rbi, context_ref_get(ctxt));
+  batcher->ctxt = ctxt;
+
+exit:
+  if(out_batcher)
+    *out_batcher = batcher;
+  return err;
+error:
+  if(batcher) {
+    rbu_dynamic_batcher_ref_put(batcher);
+    batcher = NULL;
+  }
+  goto exit;
+}
+
+int
+rbu_dynamic_batcher_ref_get(struct rbu_dynamic_batcher* batcher)
+{
+  if(!batcher)
+    return -1;
+  ref_get(&batcher->ref);
+  return 0;
+}
+
+int
+rbu_dynamic_batcher_ref_put(struct rbu_dynamic_batcher* batcher)
+{
+  if(!batcher)
+    return -1;
+  ref_put(&batcher->ref, release_dynamic_batcher);
+  return 0;
+}
+
+int
+rbu_dynamic_batcher_add
+  (struct rbu_dynamic_batcher* batcher,
+   const struct rbu_batch_state* state,
+   const struct rbu_batch_mesh* mesh)
+{
+  const struct rbu_dynamic_batcher_desc* desc = NULL;
+  size_t stride = 0;
+  float* vertices = NULL;
+  unsigned int i = 0;
+
+  if(!batcher
+  || !state
+  || !mesh
+  || !state->program
+  || state->nb_textures > RBU_DYNAMIC_BATCHER_MAX_TEXTURES
+  || (state->prim_type != RB_LINES && state->prim_type != RB_TRIANGLE_LIST)
+  || !mesh->vertices
+  || !mesh->indices
+  || !mesh->nb_vertices
+  || !mesh->nb_indices
+  || mesh->nb_vertices > batcher->desc.max_vertices
+  || mesh->nb_indices > batcher->desc.max_indices)
+    return -1;
+  for(i = 0; i < mesh->nb_indices; ++i) {
+    if(mesh->indices[i] >= mesh->nb_vertices)
+      return -1;
+  }
+  desc = &batcher->desc;
+
+  if((batcher->nb_vertices || batcher->nb_indices)
+  && (!is_state_equal(&batcher->state, state)
+   || batcher->nb_vertices + mesh->nb_vertices > desc->max_vertices
+   || batcher->nb_indices + mesh->nb_indices > desc->max_indices)) {
+    if(rbu_dynamic_batcher_flush(batcher) != 0)
+      return -1;
+  }
+  batcher->state = *state;
+
+  stride = desc->vertex_size / sizeof(float);
+  vertices = batcher->vertices + batcher->nb_vertices * stride;
+  memcpy(vertices, mesh->vertices, mesh->nb_vertices * desc->vertex_size);
+  if(mesh->transform) {
+    if(desc->position_offset >= 0) {
+      transform_vertices
+        (vertices + (size_t)desc->position_offset / sizeof(float), stride,
+         mesh->nb_vertices, mesh->transform, 1.f);
+    }
+    if(desc->normal_offset >= 0) {
+      transform_vertices
+        (vertices + (size_t)desc->normal_offset / sizeof(float), stride,
+         mesh->nb_vertices, mesh->transform, 0.f);
+    }
+  }
+  if(desc->instance_offset >= 0) {
+    float* id = vertices + (size_t)desc->instance_offset / sizeof(float);
+    for(i = 0; i < mesh->nb_vertices; ++i, id += stride)
+      *id = mesh->instance_id;
+  }
+  rebase_indices(batcher->indices + batcher->nb_indices, mesh->indices,
+    mesh->nb_indices, batcher->nb_vertices);
+  batcher->nb_vertices += mesh->nb_vertices;
+  batcher->nb_indices += mesh->nb_indices;
+
+  ++batcher->stats.nb_meshes;
+  batcher->stats.nb_vertices += mesh->nb_vertices;
+  batcher->stats.nb_indices += mesh->nb_indices;
+  return 0;
+}
+
+int
+rbu_dynamic_batcher_flush(struct rbu_dynamic_batcher* batcher)
+{
+  const struct rbu_batch_state* state = NULL;
+  struct stream* stream = NULL;
+  struct rbi* rbi = NULL;
+  struct rb_context* ctxt = NULL;
+  unsigned int i = 0;
+  int err = 0;
+
+  if(!batcher)
+    return -1;
+  if(!batcher->nb_vertices && !batcher->nb_indices)
+    goto exit;
+  rbi = &batcher->rbi;
+  ctxt = batcher->ctxt;
+  state = &batcher->state;
+
+  stream = next_stream(batcher);
+  if(!stream) {
+    err = -1;
+    goto exit;
+  }
+  #define CALL(func) if(0 != rbi->func) err = -1
+  CALL(buffer_data(stream->vertex_buffer, 0,
+    (int)(batcher->nb_vertices * batcher->desc.vertex_size),
+    batcher->vertices));
+  CALL(buffer_data(stream->index_buffer, 0,
+    (int)(batcher->nb_indices * sizeof(unsigned int)), batcher->indices));
+  CALL(bind_program(ctxt, state->program));
+  CALL(bind_vertex_array(ctxt, stream->vertex_array));
+  for(i = 0; i < state->nb_textures; ++i) {
+    CALL(bind_tex2d(ctxt, state->tex_list[i], i));
+    CALL(bind_sampler(ctxt, state->sampler_list[i], i));
+  }
+  if(state->blend)
+    CALL(blend(ctxt, state->blend));
+  if(state->depth_stencil)
+    CALL(depth_stencil(ctxt, state->depth_stencil));
+  if(state->rasterizer)
+    CALL(rasterizer(ctxt, state->rasterizer));
+  CALL(draw_indexed(ctxt, state->prim_type, batcher->nb_indices));
+  #undef CALL
+  ++batcher->stats.nb_draws;
+
+exit:
+  if(batcher) {
+    batcher->nb_vertices = 0;
+    batcher->nb_indices = 0;
+  }
+  return err;
+}
+
+int
+rbu_dynamic_batcher_end_frame(struct rbu_dynamic_batcher* batcher)
+{
+  int err = 0;
+
+  if(!batcher)
+    return -1;
+  err = rbu_dynamic_batcher_flush(batcher);
+  batcher->nb_used_streams = 0;
+  memset(&batcher->stats, 0, sizeof(struct rbu_dynamic_batcher_stats));
+  return err;
+}
+
+int
+rbu_dynamic_batcher_get_stats
+  (struct rbu_dynamic_batcher* batcher,
+   struct rbu_dynamic_batcher_stats* stats)
+{
+  if(!batcher || !stats)
+    return -1;
+  *stats = batcher->stats;
+  return 0;
+}
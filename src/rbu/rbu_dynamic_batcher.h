@@ -0,0 +1,131 @@
+#ifndef RBU_DYNAMIC_BATCHER_H
+#define RBU_DYNAMIC_BATCHER_H
+
+#include "rbu/rbu.h"
+#include <stddef.h>
+
+/*******************************************************************************
+ *
+ * Dynamic batcher. The small indexed meshes successively added with the same
+ * state are appended into a staging batch that is uploaded into a streaming
+ * vertex and index buffer and drawn with one call when the state changes, the
+ * batch is full or the batcher is flushed. The vertices of a mesh are either
+ * pre-transformed on the CPU by its transform, or tagged with its instance
+ * identifier written into a float attribute from which the program fetches
+ * its transform, or both. The meshes are drawn in their submission order; add
+ * them sorted by state, e.g. in the order of a render queue, to maximize the
+ * batching.
+ *
+ * The streaming buffers are used once per frame: the batches of a frame are
+ * uploaded into distinct buffers that are recycled on the next frame.
+ *
+ ******************************************************************************/
+#define RBU_DYNAMIC_BATCHER_MAX_TEXTURES 8 /* Texture units per state. */
+
+struct mem_allocator;
+struct rbi;
+struct rbu_dynamic_batcher;
+
+struct rbu_dynamic_batcher_desc {
+  /* Vertex layout of the meshes. The stride of the attributes is ignored and
+   * their offset is relative to the beginning of a vertex. */
+  const struct rb_buffer_attrib* attrib_list;
+  int nb_attribs;
+  size_t vertex_size; /* In bytes. Multiple of sizeof(float). */
+  /* Byte offsets, multiple of sizeof(float), into a vertex of its float3
+   * position, of its float3 normal and of its float instance identifier. A
+   * negative offset means that the vertex has no such attribute. */
+  int position_offset;
+  int normal_offset;
+  int instance_offset;
+  /* Capacity of a batch. */
+  unsigned int max_vertices;
+  unsigned int max_indices;
+};
+
+/* State shared by the meshes of a batch. The objects and the descriptors are
+ * not referenced and must outlive the batch. The uniforms of the program are
+ * not touched and should be set by the caller. */
+struct rbu_batch_state {
+  struct rb_program* program;
+  struct rb_tex2d* tex_list[RBU_DYNAMIC_BATCHER_MAX_TEXTURES];
+  struct rb_sampler* sampler_list[RBU_DYNAMIC_BATCHER_MAX_TEXTURES];
+  unsigned int nb_textures;
+  const struct rb_blend_desc* blend; /* May be NULL. */
+  const struct rb_depth_stencil_desc* depth_stencil; /* May be NULL. */
+  const struct rb_rasterizer_desc* rasterizer; /* May be NULL. */
+  enum rb_primitive_type prim_type; /* RB_LINES or RB_TRIANGLE_LIST. */
+};
+
+struct rbu_batch_mesh {
+  const void* vertices; /* nb_vertices * vertex_size bytes. */
+  unsigned int nb_vertices;
+  const unsigned int* indices;
+  unsigned int nb_indices;
+  /* Column major 4x4 matrix applied to the position and, without its
+   * translation, to the normal of the vertices. The normals are thus not
+   * renormalized nor corrected for a non uniform scale. May be NULL. */
+  const float* transform;
+  float instance_id; /* Ignored if the vertices have no instance attribute. */
+};
+
+/* Counters since the last end of frame. */
+struct rbu_dynamic_batcher_stats {
+  size_t nb_meshes;
+  size_t nb_draws;
+  size_t nb_vertices;
+  size_t nb_indices;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The rbi functions are copied. The streaming buffers are created onto
+ * `ctxt', which is referenced by the batcher. */
+RBU_API int
+rbu_create_dynamic_batcher
+  (struct mem_allocator* allocator, /* May be NULL. */
+   const struct rbi* rbi,
+   struct rb_context* ctxt,
+   const struct rbu_dynamic_batcher_desc* desc,
+   struct rbu_dynamic_batcher** out_batcher);
+
+RBU_API int
+rbu_dynamic_batcher_ref_get
+  (struct rbu_dynamic_batcher* batcher);
+
+RBU_API int
+rbu_dynamic_batcher_ref_put
+  (struct rbu_dynamic_batcher* batcher);
+
+/* Append the mesh to the current batch, drawing the latter beforehand if its
+ * state differs or if it cannot store the mesh. An empty mesh, a mesh with an
+ * index out of its vertices or that exceeds the capacity of a batch is
+ * rejected. The mesh is not appended if the batch fails to be drawn. */
+RBU_API int
+rbu_dynamic_batcher_add
+  (struct rbu_dynamic_batcher* batcher,
+   const struct rbu_batch_state* state,
+   const struct rbu_batch_mesh* mesh);
+
+/* Draw the current batch. The pipeline state is left as set by the batch. */
+RBU_API int
+rbu_dynamic_batcher_flush
+  (struct rbu_dynamic_batcher* batcher);
+
+/* Flush the batcher, recycle its streaming buffers and reset its counters. */
+RBU_API int
+rbu_dynamic_batcher_end_frame
+  (struct rbu_dynamic_batcher* batcher);
+
+RBU_API int
+rbu_dynamic_batcher_get_stats
+  (struct rbu_dynamic_batcher* batcher,
+   struct rbu_dynamic_batcher_stats* stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* RBU_DYNAMIC_BATCHER_H */
@@ -0,0 +1,588 @@
+#include "common/rb_hash.h"
+#include "rbi/rbi.h"
+#include "rbu/rbu_render_queue.h"
+#include <snlsys/math.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Bit layout of the sort keys. */
+#define ID_BITS 10
+#define LAYER_SHIFT 56
+#define TRANSPARENT_BIT ((uint64_t)1 << 55)
+#define OPAQUE_DEPTH_BITS 15
+#define TRANSPARENT_DEPTH_BITS 24
+
+/* Size of the copied uniform data, keeping them aligned on 16 bytes. */
+#define DATA_SIZE(size) (((size) + 15) & ~(size_t)15)
+
+enum id_type {
+  PROGRAM_ID,
+  STATE_ID,
+  TEXTURES_ID,
+  VERTEX_ARRAY_ID,
+  ID_TYPES_COUNT
+};
+
+/* Open addressing map from the hash of a field to its identifier. A null hash
+ * marks an empty slot. */
+struct id_map {
+  uint64_t* hash_list;
+  uint16_t* id_list;
+  size_t capacity; /* Power of 2. */
+  size_t count;
+};
+
+/* Uniform value whose data is copied into the data of the queue. */
+struct uniform {
+  struct rb_uniform* uniform;
+  int count;
+  size_t offset;
+};
+
+struct item {
+  struct rbu_draw_item desc; /* Its uniform list is not used. */
+  size_t first_uniform; /* Index into the uniforms of the queue. */
+  uint64_t key;
+};
+
+struct sort_entry {
+  uint64_t key;
+  size_t item;
+};
+
+/* Emitted state. The state is unknown until its first bind. */
+struct bound {
+  const void* ptr;
+  int is_known;
+};
+
+struct rbu_render_queue {
+  struct ref ref;
+  struct mem_allocator* allocator;
+  struct rbi rbi;
+  struct item* item_list;
+  size_t nb_items;
+  size_t max_items;
+  struct uniform* uniform_list;
+  size_t nb_uniforms;
+  size_t max_uniforms;
+  unsigned char* data; /* Data of the uniform values. */
+  size_t data_size;
+  size_t data_capacity;
+  /* Sort entries and their radix sort buffer. */
+  struct sort_entry* entry_list[2];
+  size_t max_entries;
+  struct id_map id_maps[ID_TYPES_COUNT];
+  struct rbu_render_queue_stats stats;
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+/* Ensure that the array `*buf' may store `count' elements of `size' bytes. */
+static int
+reserve
+  (struct mem_allocator* allocator,
+   void** buf,
+   size_t* capacity,
+   size_t count,
+   size_t size)
+{
+  void* mem = NULL;
+  size_t cap = 0;
+  ASSERT(allocator && buf && capacity && size);
+
+  if(count <= *capacity)
+    return 0;
+  cap = MAX(MAX(*capacity * 2, count), 16);
+  mem = MEM_REALLOC(allocator, *buf, cap * size);
+  if(!mem)
+    return -1;
+  *buf = mem;
+  *capacity = cap;
+  return 0;
+}
+
+#define HASH_PTR(hash, ptr) rb_hash((hash), &(ptr), sizeof(ptr))
+
+static void
+release_id_map(struct mem_allocator* allocator, struct id_map* map)
+{
+  ASSERT(allocator && map);
+  if(map->hash_list)
+    MEM_FREE(allocator, map->hash_list);
+  if(map->id_list)
+    MEM_FREE(allocator, map->id_list);
+  memset(map, 0, sizeof(struct id_map));
+}
+
+static void
+clear_id_map(struct id_map* map)
+{
+  ASSERT(map);
+  if(map->count)
+    memset(map->hash_list, 0, map->capacity * sizeof(uint64_t));
+  map->count = 0;
+}
+
+static void
+insert_id(struct id_map* map, uint64_t hash, uint16_t id)
+{
+  size_t i = 0;
+  ASSERT(map && hash && map->count < map->capacity);
+
+  i = (size_t)hash & (map->capacity - 1);
+  while(map->hash_list[i])
+    i = (i + 1) & (map->capacity - 1);
+  map->hash_list[i] = hash;
+  map->id_list[i] = id;
+}
+
+static int
+grow_id_map(struct mem_allocator* allocator, struct id_map* map)
+{
+  struct id_map tmp;
+  size_t i = 0;
+  ASSERT(allocator && map);
+
+  memset(&tmp, 0, sizeof(tmp));
+  tmp.capacity = map->capacity ? map->capacity * 2 : 64;
+  tmp.hash_list = MEM_CALLOC(allocator, tmp.capacity, sizeof(uint64_t));
+  tmp.id_list = MEM_ALLOC(allocator, tmp.capacity * sizeof(uint16_t));
+  if(!tmp.hash_list || !tmp.id_list) {
+    release_id_map(allocator, &tmp);
+    return -1;
+  }
+  for(i = 0; i < map->capacity; ++i) {
+    if(map->hash_list[i])
+      insert_id(&tmp, map->hash_list[i], map->id_list[i]);
+  }
+  tmp.count = map->count;
+  release_id_map(allocator, map);
+  *map = tmp;
+  return 0;
+}
+
+/* Return the identifier of the field whose hash is `hash', assigning it the
+ * next identifier on its first request. */
+static int
+get_id
+  (struct mem_allocator* allocator,
+   struct id_map* map,
+   uint64_t hash,
+   uint64_t* id)
+{
+  size_t i = 0;
+  ASSERT(allocator && map && id);
+
+  hash = hash ? hash : 1;
+  if(map->capacity) {
+    i = (size_t)hash & (map->capacity - 1);
+    for(; map->hash_list[i]; i = (i + 1) & (map->capacity - 1)) {
+      if(map->hash_list[i] == hash) {
+        *id = map->id_list[i];
+        return 0;
+      }
+    }
+  }
+  if(map->count >= RBU_RENDER_QUEUE_MAX_IDS - 1) {
+    *id = RBU_RENDER_QUEUE_MAX_IDS - 1;
+    return 0;
+  }
+  /* Keep the load factor below 1/2. */
+  if(2 * (map->count + 1) > map->capacity
+  && grow_id_map(allocator, map) != 0)
+    return -1;
+  *id = map->count;
+  insert_id(map, hash, (uint16_t)map->count);
+  ++map->count;
+  return 0;
+}
+
+/* Map a float onto an unsigned integer of same order. */
+static FINLINE uint32_t
+sortable_float(float f)
+{
+  uint32_t u = 0;
+  memcpy(&u, &f, sizeof(u));
+  return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+}
+
+static int
+compute_key
+  (struct rbu_render_queue* queue,
+   const struct rbu_draw_item* item,
+   uint64_t* out_key)
+{
+  uint64_t ids[ID_TYPES_COUNT];
+  struct mem_allocator* allocator = NULL;
+  struct id_map* maps = NULL;
+  uint64_t hash = 0;
+  uint64_t key = 0;
+  uint32_t depth = 0;
+  ASSERT(queue && item && out_key);
+
+  allocator = queue->allocator;
+  maps = queue->id_maps;
+
+  hash = HASH_PTR(RB_HASH_SEED, item->program);
+  if(get_id(allocator, maps + PROGRAM_ID, hash, ids + PROGRAM_ID) != 0)
+    return -1;
+  hash = HASH_PTR(RB_HASH_SEED, item->blend);
+  hash = HASH_PTR(hash, item->depth_stencil);
+  hash = HASH_PTR(hash, item->rasterizer);
+  if(get_id(allocator, maps + STATE_ID, hash, ids + STATE_ID) != 0)
+    return -1;
+  hash = rb_hash(RB_HASH_SEED, item->tex_list,
+    item->nb_textures * sizeof(struct rb_tex2d*));
+  hash = rb_hash(hash, item->sampler_list,
+    item->nb_textures * sizeof(struct rb_sampler*));
+  if(get_id(allocator, maps + TEXTURES_ID, hash, ids + TEXTURES_ID) != 0)
+    return -1;
+  hash = HASH_PTR(RB_HASH_SEED, item->vertex_array);
+  if(get_id(allocator, maps + VERTEX_ARRAY_ID, hash, ids+VERTEX_ARRAY_ID) != 0)
+    return -1;
+
+  depth = sortable_float(item->depth);
+  key = (uint64_t)item->layer << LAYER_SHIFT;
+  if(!item->is_transparent) {
+    key |= ids[PROGRAM_ID] << (OPAQUE_DEPTH_BITS + 3 * ID_BITS);
+    key |= ids[STATE_ID] << (OPAQUE_DEPTH_BITS + 2 * ID_BITS);
+    key |= ids[TEXTURES_ID] << (OPAQUE_DEPTH_BITS + ID_BITS);
+    key |= ids[VERTEX_ARRAY_ID] << OPAQUE_DEPTH_BITS;
+    key |= depth >> (32 - OPAQUE_DEPTH_BITS); /* Front to back. */
+  } else {
+    key |= TRANSPARENT_BIT;
+    /* Back to front. */
+    key |= (uint64_t)(~depth >> (32 - TRANSPARENT_DEPTH_BITS))
+      << (1 + 3 * ID_BITS);
+    key |= ids[PROGRAM_ID] << (1 + 2 * ID_BITS);
+    key |= ids[STATE_ID] << (1 + ID_BITS);
+    key |= ids[TEXTURES_ID] << 1;
+  }
+  *out_key = key;
+  return 0;
+}
+
+/* Stable least significant digit radix sort of the `count' entries of `src'
+ * on their key, 8 bits per pass. The passes whose digit is shared by all the
+ * keys are skipped. Return the buffer of the sorted entries. */
+static struct sort_entry*
+radix_sort(struct sort_entry* src, struct sort_entry* tmp, size_t count)
+{
+  size_t histo[8][256];
+  size_t i = 0;
+  int pass = 0;
+  ASSERT(src && tmp);
+
+  memset(histo, 0, sizeof(histo));
+  for(i = 0; i < count; ++i) {
+    const uint64_t key = src[i].key;
+    for(pass = 0; pass < 8; ++pass)
+      ++histo[pass][(key >> (pass * 8)) & 0xFF];
+  }
+  for(pass = 0; pass < 8; ++pass) {
+    struct sort_entry* swap = NULL;
+    size_t offset = 0;
+    const int shift = pass * 8;
+
+    if(!count || histo[pass][(src[0].key >> shift) & 0xFF] == count)
+      continue;
+    for(i = 0; i < 256; ++i) {
+      const size_t n = histo[pass][i];
+      histo[pass][i] = offset;
+      offset += n;
+    }
+    for(i = 0; i < count; ++i)
+      tmp[histo[pass][(src[i].key >> shift) & 0xFF]++] = src[i];
+    swap = src;
+    src = tmp;
+    tmp = swap;
+  }
+  return src;
+}
+
+/* Update the bound object. Return whether it has to be bound. */
+static FINLINE int
+rebind(struct bound* bound, const void* ptr)
+{
+  ASSERT(bound);
+  if(bound->is_known && bound->ptr == ptr)
+    return 0;
+  bound->ptr = ptr;
+  bound->is_known = 1;
+  return 1;
+}
+
+/* Update the bound state descriptor of `size' bytes. Return whether it has
+ * to be set. A NULL descriptor keeps the current state. */
+static FINLINE int
+reset_state(struct bound* bound, const void* desc, size_t size)
+{
+  int is_changed = 0;
+  ASSERT(bound);
+
+  if(!desc)
+    return 0;
+  is_changed = !bound->is_known
+    || (bound->ptr != desc && memcmp(bound->ptr, desc, size) != 0);
+  bound->ptr = desc;
+  bound->is_known = 1;
+  return is_changed;
+}
+
+static void
+release_render_queue(struct ref* ref)
+{
+  struct rbu_render_queue* queue = NULL;
+  int i = 0;
+  ASSERT(ref);
+
+  queue = CONTAINER_OF(ref, struct rbu_render_queue, ref);
+  if(queue->item_list)
+    MEM_FREE(queue->allocator, queue->item_list);
+  if(queue->uniform_list)
+    MEM_FREE(queue->allocator, queue->uniform_list);
+  if(queue->data)
+    MEM_FREE(queue->allocator, queue->data);
+  for(i = 0; i < 2; ++i) {
+    if(queue->entry_list[i])
+      MEM_FREE(queue->allocator, queue->entry_list[i]);
+  }
+  for(i = 0; i < ID_TYPES_COUNT; ++i)
+    release_id_map(queue->allocator, queue->id_maps + i);
+  MEM_FREE(queue->allocator, queue);
+}
+
+/*******************************************************************************
+ *
+ * Render queue functions.
+ *
+ ******************************************************************************/
+int
+rbu_create_render_queue
+  (struct mem_allocator* specific_allocator,
+   const struct rbi* rbi,
+   struct rbu_render_queue** out_queue)
+{
+  struct mem_allocator* allocator = NULL;
+  struct rbu_render_queue* queue = NULL;
+
+  if(!rbi || !out_queue)
+    return -1;
+  allocator = specific_allocator ? specific_allocator : &mem_default_allocator;
+  queue = MEM_CALLOC(allocator, 1, sizeof(struct rbu_render_queue));
+  if(!queue)
+    return -1;
+  ref_init(&queue->ref);
+  queue->allocator = allocator;
+  queue->rbi = *rbi;
+  *out_queue = queue;
+  return 0;
+}
+
+int
+rbu_render_queue_ref_get(struct rbu_render_queue* queue)
+{
+  if(!queue)
+    return -1;
+  ref_get(&queue->ref);
+  return 0;
+}
+
+int
+rbu_render_queue_ref_put(struct rbu_render_queue* queue)
+{
+  if(!queue)
+    return -1;
+  ref_put(&queue->ref, release_render_queue);
+  return 0;
+}
+
+int
+rbu_render_queue_push
+  (struct rbu_render_queue* queue,
+   const struct rbu_draw_item* item)
+{
+  struct item* dst = NULL;
+  size_t data_size = 0;
+  unsigned int i = 0;
+
+  if(!queue
+  || !item
+  || item->nb_textures > RBU_RENDER_QUEUE_MAX_TEXTURES
+  || (item->nb_uniforms && !item->uniform_list))
+    return -1;
+  for(i = 0; i < item->nb_uniforms; ++i) {
+    const struct rbu_uniform_value* val = item->uniform_list + i;
+    if(!val->uniform || val->count <= 0 || !val->data || !val->size)
+      return -1;
+    data_size += DATA_SIZE(val->size);
+  }
+  if(reserve(queue->allocator, (void**)&queue->item_list, &queue->max_items,
+       queue->nb_items + 1, sizeof(struct item)) != 0
+  || reserve(queue->allocator, (void**)&queue->uniform_list,
+       &queue->max_uniforms, queue->nb_uniforms + item->nb_uniforms,
+       sizeof(struct uniform)) != 0
+  || reserve(queue->allocator, (void**)&queue->data, &queue->data_capacity,
+       queue->data_size + data_size, 1) != 0)
+    return -1;
+
+  dst = queue->item_list + queue->nb_items;
+  if(compute_key(queue, item, &dst->key) != 0)
+    return -1;
+  dst->desc = *item;
+  dst->desc.uniform_list = NULL;
+  dst->first_uniform = queue->nb_uniforms;
+  for(i = 0; i < item->nb_uniforms; ++i) {
+    const struct rbu_uniform_value* val = item->uniform_list + i;
+    struct uniform* uniform = queue->uniform_list + queue->nb_uniforms++;
+    uniform->uniform = val->uniform;
+    uniform->count = val->count;
+    uniform->offset = queue->data_size;
+    memcpy(queue->data + queue->data_size, val->data, val->size);
+    queue->data_size += DATA_SIZE(val->size);
+  }
+  ++queue->nb_items;
+  return 0;
+}
+
+int
+rbu_render_queue_flush
+  (struct rbu_render_queue* queue,
+   struct rb_context* ctxt)
+{
+  struct bound program, vertex_array, blend, depth_stencil, rasterizer;
+  struct bound tex[RBU_RENDER_QUEUE_MAX_TEXTURES];
+  struct bound sampler[RBU_RENDER_QUEUE_MAX_TEXTURES];
+  struct rbu_render_queue_stats* stats = NULL;
+  struct sort_entry* entries = NULL;
+  const struct rbi* rbi = NULL;
+  size_t i = 0;
+  int err = 0;
+
+  if(!queue || !ctxt)
+    return -1;
+  rbi = &queue->rbi;
+  stats = &queue->stats;
+  memset(stats, 0, sizeof(struct rbu_render_queue_stats));
+  stats->nb_items = queue->nb_items;
+  if(!queue->nb_items)
+    goto exit;
+
+  if(queue->nb_items > queue->max_entries) {
+    for(i = 0; i < 2; ++i) {
+      if(queue->entry_list[i])
+        MEM_FREE(queue->allocator, queue->entry_list[i]);
+      queue->entry_list[i] = MEM_ALLOC
+        (queue->allocator, queue->nb_items * sizeof(struct sort_entry));
+    }
+    if(!queue->entry_list[0] || !queue->entry_list[1]) {
+      queue->max_entries = 0;
+      err = -1;
+      goto exit;
+    }
+    queue->max_entries = queue->nb_items;
+  }
+  for(i = 0; i < queue->nb_items; ++i) {
+    queue->entry_list[0][i].key = queue->item_list[i].key;
+    queue->entry_list[0][i].item = i;
+  }
+  entries = radix_sort
+    (queue->entry_list[0], queue->entry_list[1], queue->nb_items);
+
+  memset(&program, 0, sizeof(struct bound));
+  memset(&vertex_array, 0, sizeof(struct bound));
+  memset(&blend, 0, sizeof(struct bound));
+  memset(&depth_stencil, 0, sizeof(struct bound));
+  memset(&rasterizer, 0, sizeof(struct bound));
+  memset(tex, 0, sizeof(tex));
+  memset(sampler, 0, sizeof(sampler));
+
+  #define CALL(func) if(0 != rbi->func) err = -1
+  for(i = 0; i < queue->nb_items; ++i) {
+    const struct item* item = queue->item_list + entries[i].item;
+    const struct rbu_draw_item* desc = &item->desc;
+    unsigned int j = 0;
+
+    if(rebind(&program, desc->program)) {
+      CALL(bind_program(ctxt, desc->program));
+      ++stats->nb_program_binds;
+    }
+    if(rebind(&vertex_array, desc->vertex_array)) {
+      CALL(bind_vertex_array(ctxt, desc->vertex_array));
+      ++stats->nb_vertex_array_binds;
+    }
+    for(j = 0; j < desc->nb_textures; ++j) {
+      if(rebind(tex + j, desc->tex_list[j])) {
+        CALL(bind_tex2d(ctxt, desc->tex_list[j], j));
+        ++stats->nb_texture_binds;
+      }
+      if(rebind(sampler + j, desc->sampler_list[j])) {
+        CALL(bind_sampler(ctxt, desc->sampler_list[j], j));
+        ++stats->nb_texture_binds;
+      }
+    }
+    if(reset_state(&blend, desc->blend, sizeof(struct rb_blend_desc))) {
+      CALL(blend(ctxt, desc->blend));
+      ++stats->nb_state_changes;
+    }
+    if(reset_state(&depth_stencil, desc->depth_stencil,
+       sizeof(struct rb_depth_stencil_desc))) {
+      CALL(depth_stencil(ctxt, desc->depth_stencil));
+      ++stats->nb_state_changes;
+    }
+    if(reset_state(&rasterizer, desc->rasterizer,
+       sizeof(struct rb_rasterizer_desc))) {
+      CALL(rasterizer(ctxt, desc->rasterizer));
+      ++stats->nb_state_changes;
+    }
+    for(j = 0; j < desc->nb_uniforms; ++j) {
+      const struct uniform* uniform =
+        queue->uniform_list + item->first_uniform + j;
+      CALL(uniform_data
+        (uniform->uniform, uniform->count, queue->data + uniform->offset));
+    }
+    if(desc->is_indexed) {
+      CALL(draw_indexed(ctxt, desc->prim_type, desc->count));
+    } else {
+      CALL(draw(ctxt, desc->prim_type, desc->count));
+    }
+  }
+  #undef CALL
+
+exit:
+  rbu_render_queue_clear(queue);
+  return err;
+}
+
+int
+rbu_render_queue_clear(struct rbu_render_queue* queue)
+{
+  int i = 0;
+
+  if(!queue)
+    return -1;
+  queue->nb_items = 0;
+  queue->nb_uniforms = 0;
+  queue->data_size = 0;
+  for(i = 0; i < ID_TYPES_COUNT; ++i)
+    clear_id_map(queue->id_maps + i);
+  return 0;
+}
+
+int
+rbu_render_queue_get_stats
+  (struct rbu_render_queue* queue,
+   struct rbu_render_queue_stats* stats)
+{
+  if(!queue || !stats)
+    return -1;
+  *stats = queue->stats;
+  return 0;
+}
@@ -0,0 +1,118 @@
+#ifndef RBU_RENDER_QUEUE_H
+#define RBU_RENDER_QUEUE_H
+
+#include "rbu/rbu.h"
+#include <stddef.h>
+
+/*******************************************************************************
+ *
+ * Render queue. The draw items pushed into the queue are packed into a 64-bits
+ * sort key and are radix sorted on flush in order to group them by state. The
+ * binds are then emitted only when the state changes. From the most to the
+ * least significant bits, the key is made of:
+ *  - the layer of the item;
+ *  - its transparency;
+ *  - for the opaque items: the program, the render states, the textures, the
+ *    vertex array and the depth, front to back;
+ *  - for the transparent items: the depth, back to front, the program, the
+ *    render states and the textures.
+ * The program, the render states, the textures and the vertex array are keyed
+ * by an identifier assigned on their first push since the last flush. Beyond
+ * RBU_RENDER_QUEUE_MAX_IDS distinct values per field, the items share the
+ * last identifier and are thus less grouped.
+ *
+ ******************************************************************************/
+#define RBU_RENDER_QUEUE_MAX_TEXTURES 8 /* Texture units per item. */
+#define RBU_RENDER_QUEUE_MAX_IDS 1024
+
+struct mem_allocator;
+struct rbi;
+struct rbu_render_queue;
+
+/* Value of a uniform set before the draw of an item. The `size' bytes of
+ * data are copied on push. */
+struct rbu_uniform_value {
+  struct rb_uniform* uniform;
+  int count;
+  const void* data;
+  size_t size;
+};
+
+/* The objects and the descriptors are not referenced nor copied and must
+ * outlive the flush. A NULL descriptor keeps the current state. */
+struct rbu_draw_item {
+  struct rb_program* program;
+  struct rb_vertex_array* vertex_array;
+  /* Textures and samplers bound to the units 0 to nb_textures - 1. */
+  struct rb_tex2d* tex_list[RBU_RENDER_QUEUE_MAX_TEXTURES];
+  struct rb_sampler* sampler_list[RBU_RENDER_QUEUE_MAX_TEXTURES];
+  unsigned int nb_textures;
+  const struct rb_blend_desc* blend; /* May be NULL. */
+  const struct rb_depth_stencil_desc* depth_stencil; /* May be NULL. */
+  const struct rb_rasterizer_desc* rasterizer; /* May be NULL. */
+  const struct rbu_uniform_value* uniform_list;
+  unsigned int nb_uniforms;
+  enum rb_primitive_type prim_type;
+  unsigned int count; /* Number of vertices or indices. */
+  int is_indexed;
+  float depth; /* Distance to the viewer. */
+  unsigned char layer; /* The lower layers are drawn first. */
+  int is_transparent;
+};
+
+/* Number of items and of calls emitted by the last flush. */
+struct rbu_render_queue_stats {
+  size_t nb_items;
+  size_t nb_program_binds;
+  size_t nb_vertex_array_binds;
+  size_t nb_texture_binds; /* Textures and samplers. */
+  size_t nb_state_changes; /* Blend, depth stencil and rasterizer. */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The rbi functions are copied and are used to emit the calls. */
+RBU_API int
+rbu_create_render_queue
+  (struct mem_allocator* allocator, /* May be NULL. */
+   const struct rbi* rbi,
+   struct rbu_render_queue** out_queue);
+
+RBU_API int
+rbu_render_queue_ref_get
+  (struct rbu_render_queue* queue);
+
+RBU_API int
+rbu_render_queue_ref_put
+  (struct rbu_render_queue* queue);
+
+RBU_API int
+rbu_render_queue_push
+  (struct rbu_render_queue* queue,
+   const struct rbu_draw_item* item);
+
+/* Sort the pushed items, emit their binds and their draws onto `ctxt' and
+ * clear the queue. The bound state is assumed unknown on entry. An error is
+ * returned if a call fails, the remaining items being still drawn. */
+RBU_API int
+rbu_render_queue_flush
+  (struct rbu_render_queue* queue,
+   struct rb_context* ctxt);
+
+/* Remove the pushed items without drawing them. */
+RBU_API int
+rbu_render_queue_clear
+  (struct rbu_render_queue* queue);
+
+RBU_API int
+rbu_render_queue_get_stats
+  (struct rbu_render_queue* queue,
+   struct rbu_render_queue_stats* stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* RBU_RENDER_QUEUE_H */
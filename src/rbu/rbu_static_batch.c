@@ -0,0 +1,553 @@
+#include "rbi/rbi.h"
+#include "rbu/rbu_static_batch.h"
+#include <snlsys/math.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct mesh {
+  unsigned int group;
+  unsigned int nb_vertices;
+  unsigned int nb_indices;
+  size_t first_vertex; /* Into the vertices of the builder. */
+  size_t first_index; /* Into the indices of the builder. */
+};
+
+struct rbu_static_batch_builder {
+  struct ref ref;
+  struct mem_allocator* allocator;
+  struct rbu_static_batch_desc desc;
+  struct rb_buffer_attrib* attrib_list;
+  unsigned char* vertices;
+  size_t nb_vertices;
+  size_t max_vertices;
+  unsigned int* indices;
+  size_t nb_indices;
+  size_t max_indices;
+  struct mesh* mesh_list;
+  size_t nb_meshes;
+  size_t max_meshes;
+};
+
+/* Meshes of a group. Their ranges are contiguous in the batch. */
+struct group {
+  unsigned int group;
+  unsigned int first_range;
+  unsigned int nb_ranges;
+};
+
+struct rbu_static_batch {
+  struct ref ref;
+  struct mem_allocator* allocator;
+  struct rbi rbi;
+  struct rb_buffer* vertex_buffer;
+  struct rb_buffer* index_buffer;
+  struct rb_vertex_array* vertex_array;
+  struct rb_draw_range* mesh_range_list; /* Indexed by mesh identifier. */
+  struct rb_draw_range* group_range_list; /* Sorted by group. */
+  struct group* group_list; /* Sorted by group. */
+  unsigned int nb_meshes;
+  unsigned int nb_groups;
+  /* Scratch list of the drawn ranges. */
+  struct rb_draw_range* draw_range_list;
+  unsigned int max_draw_ranges;
+};
+
+/* Key of the merge order of the meshes. */
+struct sort_entry {
+  unsigned int group;
+  unsigned int mesh;
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+/* Ensure that the array `*buf' may store `count' elements of `size' bytes. */
+static int
+reserve
+  (struct mem_allocator* allocator,
+   void** buf,
+   size_t* capacity,
+   size_t count,
+   size_t size)
+{
+  void* mem = NULL;
+  size_t cap = 0;
+  ASSERT(allocator && buf && capacity && size);
+
+  if(count <= *capacity)
+    return 0;
+  cap = MAX(MAX(*capacity * 2, count), 16);
+  mem = MEM_REALLOC(allocator, *buf, cap * size);
+  if(!mem)
+    return -1;
+  *buf = mem;
+  *capacity = cap;
+  return 0;
+}
+
+static int
+cmp_sort_entry(const void* a, const void* b)
+{
+  const struct sort_entry* entry0 = a;
+  const struct sort_entry* entry1 = b;
+  ASSERT(a && b);
+
+  if(entry0->group != entry1->group)
+    return entry0->group < entry1->group ? -1 : 1;
+  return entry0->mesh < entry1->mesh ? -1 : (entry0->mesh > entry1->mesh);
+}
+
+static const struct group*
+find_group(const struct rbu_static_batch* batch, unsigned int group)
+{
+  unsigned int begin = 0;
+  unsigned int end = 0;
+  ASSERT(batch);
+
+  end = batch->nb_groups;
+  while(begin < end) {
+    const unsigned int mid = begin + (end - begin) / 2;
+    if(batch->group_list[mid].group < group)
+      begin = mid + 1;
+    else
+      end = mid;
+  }
+  if(begin < batch->nb_groups && batch->group_list[begin].group == group)
+    return batch->group_list + begin;
+  return NULL;
+}
+
+static int
+draw_ranges
+  (struct rbu_static_batch* batch,
+   struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int nb_ranges,
+   const struct rb_draw_range* range_list)
+{
+  ASSERT(batch && ctxt);
+  if(batch->rbi.bind_vertex_array(ctxt, batch->vertex_array) != 0)
+    return -1;
+  if(!nb_ranges)
+    return 0;
+  return batch->rbi.multi_draw_indexed(ctxt, prim_type, nb_ranges, range_list);
+}
+
+static void
+release_static_batch_builder(struct ref* ref)
+{
+  struct rbu_static_batch_builder* builder = NULL;
+  ASSERT(ref);
+
+  builder = CONTAINER_OF(ref, struct rbu_static_batch_builder, ref);
+  if(builder->attrib_list)
+    MEM_FREE(builder->allocator, builder->attrib_list);
+  if(builder->vertices)
+    MEM_FREE(builder->allocator, builder->vertices);
+  if(builder->indices)
+    MEM_FREE(builder->allocator, builder->indices);
+  if(builder->mesh_list)
+    MEM_FREE(builder->allocator, builder->mesh_list);
+  MEM_FREE(builder->allocator, builder);
+}
+
+static void
+release_static_batch(struct ref* ref)
+{
+  struct rbu_static_batch* batch = NULL;
+  ASSERT(ref);
+
+  batch = CONTAINER_OF(ref, struct rbu_static_batch, ref);
+  if(batch->vertex_array)
+    RBI(&batch->rbi, vertex_array_ref_put(batch->vertex_array));
+  if(batch->vertex_buffer)
+    RBI(&batch->rbi, buffer_ref_put(batch->vertex_buffer));
+  if(batch->index_buffer)
+    RBI(&batch->rbi, buffer_ref_put(batch->index_buffer));
+  if(batch->mesh_range_list)
+    MEM_FREE(batch->allocator, batch->mesh_range_list);
+  if(batch->group_range_list)
+    MEM_FREE(batch->allocator, batch->group_range_list);
+  if(batch->group_list)
+    MEM_FREE(batch->allocator, batch->group_list);
+  if(batch->draw_range_list)
+    MEM_FREE(batch->allocator, batch->draw_range_list);
+  MEM_FREE(batch->allocator, batch);
+}
+
+/*******************************************************************************
+ *
+ * Builder functions.
+ *
+ ******************************************************************************/
+int
+rbu_create_static_batch_builder
+  (struct mem_allocator* specific_allocator,
+   const struct rbu_static_batch_desc* desc,
+   struct rbu_static_batch_builder** out_builder)
+{
+  struct mem_allocator* allocator = NULL;
+  struct rbu_static_batch_builder* builder = NULL;
+  int i = 0;
+
+  if(!desc
+  || !out_builder
+  || desc->nb_attribs <= 0
+  || !desc->attrib_list
+  || !desc->vertex_size)
+    return -1;
+  allocator = specific_allocator ? specific_allocator : &mem_default_allocator;
+  builder = MEM_CALLOC(allocator, 1, sizeof(struct rbu_static_batch_builder));
+  if(!builder)
+    return -1;
+  ref_init(&builder->ref);
+  builder->allocator = allocator;
+  builder->desc = *desc;
+  builder->attrib_list = MEM_ALLOC
+    (allocator, (size_t)desc->nb_attribs * sizeof(struct rb_buffer_attrib));
+  if(!builder->attrib_list) {
+    rbu_static_batch_builder_ref_put(builder);
+    return -1;
+  }
+  for(i = 0; i < desc->nb_attribs; ++i) {
+    builder->attrib_list[i] = desc->attrib_list[i];
+    builder->attrib_list[i].stride = desc->vertex_size;
+  }
+  builder->desc.attrib_list = builder->attrib_list;
+  *out_builder = builder;
+  return 0;
+}
+
+int
+rbu_static_batch_builder_ref_get(struct rbu_static_batch_builder* builder)
+{
+  if(!builder)
+    return -1;
+  ref_get(&builder->ref);
+  return 0;
+}
+
+int
+rbu_static_batch_builder_ref_put(struct rbu_static_batch_builder* builder)
+{
+  if(!builder)
+    return -1;
+  ref_put(&builder->ref, release_static_batch_builder);
+  return 0;
+}
+
+int
+rbu_static_batch_builder_add
+  (struct rbu_static_batch_builder* builder,
+   const struct rbu_static_mesh* mesh,
+   unsigned int* out_mesh_id)
+{
+  struct mesh* dst = NULL;
+  const size_t vertex_size = builder ? builder->desc.vertex_size : 0;
+  unsigned int i = 0;
+
+  if(!builder
+  || !mesh
+  || !mesh->nb_vertices
+  || !mesh->nb_indices
+  || !mesh->vertices
+  || !mesh->indices
+  || builder->nb_meshes >= UINT_MAX)
+    return -1;
+  for(i = 0; i < mesh->nb_indices; ++i) {
+    if(mesh->indices[i] >= mesh->nb_vertices)
+      return -1;
+  }
+  if(reserve(builder->allocator, (void**)&builder->vertices,
+       &builder->max_vertices, builder->nb_vertices + mesh->nb_vertices,
+       vertex_size) != 0
+  || reserve(builder->allocator, (void**)&builder->indices,
+       &builder->max_indices, builder->nb_indices + mesh->nb_indices,
+       sizeof(unsigned int)) != 0
+  || reserve(builder->allocator, (void**)&builder->mesh_list,
+       &builder->max_meshes, builder->nb_meshes + 1,
+       sizeof(struct mesh)) != 0)
+    return -1;
+
+  dst = builder->mesh_list + builder->nb_meshes;
+  dst->group = mesh->group;
+  dst->nb_vertices = mesh->nb_vertices;
+  dst->nb_indices = mesh->nb_indices;
+  dst->first_vertex = builder->nb_vertices;
+  dst->first_index = builder->nb_indices;
+  memcpy(builder->vertices + builder->nb_vertices * vertex_size,
+    mesh->vertices, mesh->nb_vertices * vertex_size);
+  memcpy(builder->indices + builder->nb_indices, mesh->indices,
+    mesh->nb_indices * sizeof(unsigned int));
+  builder->nb_vertices += mesh->nb_vertices;
+  builder->nb_indices += mesh->nb_indices;
+  if(out_mesh_id)
+    *out_mesh_id = (unsigned int)builder->nb_meshes;
+  ++builder->nb_meshes;
+  return 0;
+}
+
+int
+rbu_static_batch_builder_build
+  (struct rbu_static_batch_builder* builder,
+   const struct rbi* rbi,
+   struct rb_context* ctxt,
+   struct rbu_static_batch** out_batch)
+{
+  struct rb_buffer_desc buf_desc;
+  struct mem_allocator* allocator = NULL;
+  struct rbu_static_batch* batch = NULL;
+  struct sort_entry* entries = NULL;
+  unsigned char* vertices = NULL;
+  unsigned int* indices = NULL;
+  size_t vertex_size = 0;
+  size_t nb_vertices = 0;
+  size_t nb_indices = 0;
+  size_t i = 0;
+  int err = 0;
+
+  if(!builder || !rbi || !ctxt || !out_batch || !builder->nb_meshes) {
+    err = -1;
+    goto error;
+  }
+  /* The base vertices and the first indices are unsigned integers. */
+  if(builder->nb_vertices > UINT_MAX || builder->nb_indices > UINT_MAX) {
+    err = -1;
+    goto error;
+  }
+  allocator = builder->allocator;
+  vertex_size = builder->desc.vertex_size;
+  batch = MEM_CALLOC(allocator, 1, sizeof(struct rbu_static_batch));
+  if(!batch) {
+    err = -1;
+    goto error;
+  }
+  ref_init(&batch->ref);
+  batch->allocator = allocator;
+  batch->rbi = *rbi;
+  batch->nb_meshes = (unsigned int)builder->nb_meshes;
+
+  entries = MEM_ALLOC(allocator, builder->nb_meshes*sizeof(struct sort_entry));
+  vertices = MEM_ALLOC(allocator, builder->nb_vertices * vertex_size);
+  indices = MEM_ALLOC(allocator, builder->nb_indices * sizeof(unsigned int));
+  batch->mesh_range_list = MEM_ALLOC
+    (allocator, builder->nb_meshes * sizeof(struct rb_draw_range));
+  batch->group_range_list = MEM_ALLOC
+    (allocator, builder->nb_meshes * sizeof(struct rb_draw_range));
+  batch->group_list = MEM_ALLOC
+    (allocator, builder->nb_meshes * sizeof(struct group));
+  if(!entries
+  || !vertices
+  || !indices
+  || !batch->mesh_range_list
+  || !batch->group_range_list
+  || !batch->group_list) {
+    err = -1;
+    goto error;
+  }
+
+  /* Merge the meshes ordered by group and then by identifier. */
+  for(i = 0; i < builder->nb_meshes; ++i) {
+    entries[i].group = builder->mesh_list[i].group;
+    entries[i].mesh = (unsigned int)i;
+  }
+  qsort(entries, builder->nb_meshes, sizeof(struct sort_entry),
+    cmp_sort_entry);
+  for(i = 0; i < builder->nb_meshes; ++i) {
+    const struct mesh* mesh = builder->mesh_list + entries[i].mesh;
+    struct rb_draw_range* range = batch->mesh_range_list + entries[i].mesh;
+    struct group* group = batch->group_list + batch->nb_groups;
+
+    memcpy(vertices + nb_vertices * vertex_size,
+      builder->vertices + mesh->first_vertex * vertex_size,
+      mesh->nb_vertices * vertex_size);
+    memcpy(indices + nb_indices, builder->indices + mesh->first_index,
+      mesh->nb_indices * sizeof(unsigned int));
+    range->first_index = (unsigned int)nb_indices;
+    range->count = mesh->nb_indices;
+    range->base_vertex = (unsigned int)nb_vertices;
+    batch->group_range_list[i] = *range;
+    nb_vertices += mesh->nb_vertices;
+    nb_indices += mesh->nb_indices;
+
+    if(!batch->nb_groups || group[-1].group != mesh->group) {
+      group->group = mesh->group;
+      group->first_range = (unsigned int)i;
+      group->nb_ranges = 0;
+      ++batch->nb_groups;
+    } else {
+      --group;
+    }
+    ++group->nb_ranges;
+  }
+
+  buf_desc.size = nb_vertices * vertex_size;
+  buf_desc.target = RB_BIND_VERTEX_BUFFER;
+  buf_desc.usage = RB_USAGE_IMMUTABLE;
+  err = rbi->create_buffer(ctxt, &buf_desc, vertices, &batch->vertex_buffer);
+  if(err != 0)
+    goto error;
+  buf_desc.size = nb_indices * sizeof(unsigned int);
+  buf_desc.target = RB_BIND_INDEX_BUFFER;
+  err = rbi->create_buffer(ctxt, &buf_desc, indices, &batch->index_buffer);
+  if(err != 0)
+    goto error;
+  err = rbi->create_vertex_array(ctxt, &batch->vertex_array);
+  if(err != 0)
+    goto error;
+  err = rbi->vertex_attrib_array(batch->vertex_array, batch->vertex_buffer,
+    builder->desc.nb_attribs, builder->attrib_list);
+  if(err != 0)
+    goto error;
+  err = rbi->vertex_index_array(batch->vertex_array, batch->index_buffer);
+  if(err != 0)
+    goto error;
+
+exit:
+  if(entries)
+    MEM_FREE(allocator, entries);
+  if(vertices)
+    MEM_FREE(allocator, vertices);
+  if(indices)
+    MEM_FREE(allocator, indices);
+  if(out_batch)
+    *out_batch = batch;
+  return err;
+error:
+  if(batch) {
+    rbu_static_batch_ref_put(batch);
+    batch = NULL;
+  }
+  goto exit;
+}
+
+int
+rbu_static_batch_builder_clear(struct rbu_static_batch_builder* builder)
+{
+  if(!builder)
+    return -1;
+  builder->nb_vertices = 0;
+  builder->nb_indices = 0;
+  builder->nb_meshes = 0;
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Batch functions.
+ *
+ ******************************************************************************/
+int
+rbu_static_batch_ref_get(struct rbu_static_batch* batch)
+{
+  if(!batch)
+    return -1;
+  ref_get(&batch->ref);
+  return 0;
+}
+
+int
+rbu_static_batch_ref_put(struct rbu_static_batch* batch)
+{
+  if(!batch)
+    return -1;
+  ref_put(&batch->ref, release_static_batch);
+  return 0;
+}
+
+int
+rbu_static_batch_get_vertex_array
+  (struct rbu_static_batch* batch,
+   struct rb_vertex_array** out_varray)
+{
+  if(!batch || !out_varray)
+    return -1;
+  *out_varray = batch->vertex_array;
+  return 0;
+}
+
+int
+rbu_static_batch_get_mesh_range
+  (struct rbu_static_batch* batch,
+   unsigned int mesh_id,
+   struct rb_draw_range* range)
+{
+  if(!batch || !range || mesh_id >= batch->nb_meshes)
+    return -1;
+  *range = batch->mesh_range_list[mesh_id];
+  return 0;
+}
+
+int
+rbu_static_batch_get_group_ranges
+  (struct rbu_static_batch* batch,
+   unsigned int group,
+   const struct rb_draw_range** out_range_list,
+   unsigned int* out_nb_ranges)
+{
+  const struct group* grp = NULL;
+
+  if(!batch || !out_range_list || !out_nb_ranges)
+    return -1;
+  grp = find_group(batch, group);
+  if(!grp) {
+    *out_range_list = NULL;
+    *out_nb_ranges = 0;
+  } else {
+    *out_range_list = batch->group_range_list + grp->first_range;
+    *out_nb_ranges = grp->nb_ranges;
+  }
+  return 0;
+}
+
+int
+rbu_static_batch_draw_group
+  (struct rbu_static_batch* batch,
+   struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int group)
+{
+  const struct rb_draw_range* range_list = NULL;
+  unsigned int nb_ranges = 0;
+
+  if(!batch || !ctxt)
+    return -1;
+  rbu_static_batch_get_group_ranges(batch, group, &range_list, &nb_ranges);
+  return draw_ranges(batch, ctxt, prim_type, nb_ranges, range_list);
+}
+
+int
+rbu_static_batch_draw_meshes
+  (struct rbu_static_batch* batch,
+   struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int nb_meshes,
+   const unsigned int* mesh_id_list)
+{
+  unsigned int i = 0;
+
+  if(!batch || !ctxt || (nb_meshes && !mesh_id_list))
+    return -1;
+  for(i = 0; i < nb_meshes; ++i) {
+    if(mesh_id_list[i] >= batch->nb_meshes)
+      return -1;
+  }
+  if(nb_meshes > batch->max_draw_ranges) {
+    struct rb_draw_range* list = MEM_REALLOC(batch->allocator,
+      batch->draw_range_list, nb_meshes * sizeof(struct rb_draw_range));
+    if(!list)
+      return -1;
+    batch->draw_range_list = list;
+    batch->max_draw_ranges = nb_meshes;
+  }
+  for(i = 0; i < nb_meshes; ++i)
+    batch->draw_range_list[i] = batch->mesh_range_list[mesh_id_list[i]];
+  return draw_ranges
+    (batch, ctxt, prim_type, nb_meshes, batch->draw_range_list);
+}
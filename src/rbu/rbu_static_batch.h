@@ -0,0 +1,142 @@
+#ifndef RBU_STATIC_BATCH_H
+#define RBU_STATIC_BATCH_H
+
+#include "rbu/rbu.h"
+#include <stddef.h>
+
+/*******************************************************************************
+ *
+ * Static batch. The static meshes of a same vertex layout are added to a
+ * builder with the identifier of their group, e.g. their material, and are
+ * merged on build into one immutable vertex buffer and one index buffer shared
+ * by one vertex array. The meshes of a group are stored contiguously in their
+ * order of addition. Their indices are kept relative to their first vertex and
+ * the range table of the batch gives the index range and the base vertex of
+ * each mesh. A group, or any subset of the meshes, is thus drawn with one
+ * rb_multi_draw_indexed call and without any vertex array switch.
+ *
+ ******************************************************************************/
+struct mem_allocator;
+struct rbi;
+struct rbu_static_batch;
+struct rbu_static_batch_builder;
+
+struct rbu_static_batch_desc {
+  /* Vertex layout of the meshes. The stride of the attributes is ignored and
+   * their offset is relative to the beginning of a vertex. */
+  const struct rb_buffer_attrib* attrib_list;
+  int nb_attribs;
+  size_t vertex_size; /* In bytes. */
+};
+
+struct rbu_static_mesh {
+  const void* vertices; /* nb_vertices * vertex_size bytes. */
+  unsigned int nb_vertices;
+  const unsigned int* indices; /* Lower than nb_vertices. */
+  unsigned int nb_indices;
+  unsigned int group;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*******************************************************************************
+ *
+ * Builder functions.
+ *
+ ******************************************************************************/
+RBU_API int
+rbu_create_static_batch_builder
+  (struct mem_allocator* allocator, /* May be NULL. */
+   const struct rbu_static_batch_desc* desc,
+   struct rbu_static_batch_builder** out_builder);
+
+RBU_API int
+rbu_static_batch_builder_ref_get
+  (struct rbu_static_batch_builder* builder);
+
+RBU_API int
+rbu_static_batch_builder_ref_put
+  (struct rbu_static_batch_builder* builder);
+
+/* Copy the mesh into the builder. Its identifier is the number of meshes
+ * added before it. */
+RBU_API int
+rbu_static_batch_builder_add
+  (struct rbu_static_batch_builder* builder,
+   const struct rbu_static_mesh* mesh,
+   unsigned int* out_mesh_id); /* May be NULL. */
+
+/* Merge the added meshes into a batch whose objects are created onto `ctxt'
+ * with the copied rbi functions. The builder is left unchanged. */
+RBU_API int
+rbu_static_batch_builder_build
+  (struct rbu_static_batch_builder* builder,
+   const struct rbi* rbi,
+   struct rb_context* ctxt,
+   struct rbu_static_batch** out_batch);
+
+/* Remove the added meshes. */
+RBU_API int
+rbu_static_batch_builder_clear
+  (struct rbu_static_batch_builder* builder);
+
+/*******************************************************************************
+ *
+ * Batch functions.
+ *
+ ******************************************************************************/
+RBU_API int
+rbu_static_batch_ref_get
+  (struct rbu_static_batch* batch);
+
+RBU_API int
+rbu_static_batch_ref_put
+  (struct rbu_static_batch* batch);
+
+/* The vertex array is not referenced. */
+RBU_API int
+rbu_static_batch_get_vertex_array
+  (struct rbu_static_batch* batch,
+   struct rb_vertex_array** out_varray);
+
+RBU_API int
+rbu_static_batch_get_mesh_range
+  (struct rbu_static_batch* batch,
+   unsigned int mesh_id,
+   struct rb_draw_range* range);
+
+/* Return the ranges of the meshes of the group, in their order of addition.
+ * The list is owned by the batch. An unknown group has no range. */
+RBU_API int
+rbu_static_batch_get_group_ranges
+  (struct rbu_static_batch* batch,
+   unsigned int group,
+   const struct rb_draw_range** out_range_list,
+   unsigned int* out_nb_ranges);
+
+/* Bind the vertex array of the batch and draw the meshes of the group. */
+RBU_API int
+rbu_static_batch_draw_group
+  (struct rbu_static_batch* batch,
+   struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int group);
+
+/* Bind the vertex array of the batch and draw the listed meshes, e.g. the
+ * visible ones. The ranges are gathered into a scratch list of the batch
+ * that must be thus drawn by one thread at a time. */
+RBU_API int
+rbu_static_batch_draw_meshes
+  (struct rbu_static_batch* batch,
+   struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int nb_meshes,
+   const unsigned int* mesh_id_list);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* RBU_STATIC_BATCH_H */
@@ -0,0 +1,348 @@
+#include "rbu/rbu_bvh.h"
+#include "rbu/rbu_cull.h"
+#include <snlsys/math.h>
+#include <snlsys/snlsys.h>
+#include <math.h>
+#include <string.h>
+
+#define NB_OBJECTS 20000
+#define NB_RAYS 200
+#define WORLD_SIZE 100.f
+#define EPSILON 1.e-2f /* Margin within which an object may go either way. */
+
+static float lower_list[NB_OBJECTS + 1][3];
+static float upper_list[NB_OBJECTS + 1][3];
+static unsigned int value_list[NB_OBJECTS + 1];
+static unsigned char mark_list[NB_OBJECTS + 1];
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+/* Deterministic pseudo random number in [min, max). */
+static float
+random_float(unsigned int* seed, float min, float max)
+{
+  *seed = *seed * 1103515245u + 12345u;
+  return min + (max - min) * (float)((*seed >> 8) & 0xFFFF) / 65536.f;
+}
+
+/* The object `i' has the value 3i+1. */
+static unsigned int
+object_value(size_t i)
+{
+  return (unsigned int)(3 * i + 1);
+}
+
+static void
+move_object(unsigned int* seed, size_t i, float distance)
+{
+  int k = 0;
+  for(k = 0; k < 3; ++k) {
+    const float offset = random_float(seed, -distance, distance);
+    lower_list[i][k] += offset;
+    upper_list[i][k] += offset;
+  }
+}
+
+/* Brute force classification of the object `i': 1 if it is inside the
+ * frustum, 0 if it is culled and -1 if it is too close to a plane. */
+static int
+classify_frustum(const struct rbu_frustum* frustum, size_t i)
+{
+  int is_close = 0;
+  int p = 0, k = 0;
+
+  for(p = 0; p < 6; ++p) {
+    const float* plane = frustum->plane_list[p];
+    float dst = plane[3];
+    for(k = 0; k < 3; ++k)
+      dst += plane[k] * (plane[k] > 0.f ? upper_list[i][k] : lower_list[i][k]);
+    if(dst < -EPSILON)
+      return 0;
+    if(dst < EPSILON)
+      is_close = 1;
+  }
+  return is_close ? -1 : 1;
+}
+
+static int
+classify_box(const float lower[3], const float upper[3], size_t i)
+{
+  int k = 0;
+  for(k = 0; k < 3; ++k) {
+    if(lower_list[i][k] > upper[k] || upper_list[i][k] < lower[k])
+      return 0;
+  }
+  return 1;
+}
+
+/* Check that the `nb_values' values found by a query are distinct and match
+ * the classification of the `nb_objects' first objects. */
+static void
+check_query
+  (const unsigned int* values,
+   unsigned int nb_values,
+   size_t nb_objects,
+   const struct rbu_frustum* frustum, /* NULL for a box query. */
+   const float lower[3],
+   const float upper[3])
+{
+  size_t i = 0;
+
+  memset(mark_list, 0, sizeof(mark_list));
+  for(i = 0; i < nb_values; ++i) {
+    const size_t id = (values[i] - 1) / 3;
+    CHECK(values[i], object_value(id));
+    CHECK(id < nb_objects, 1);
+    CHECK(mark_list[id], 0);
+    mark_list[id] = 1;
+  }
+  for(i = 0; i < nb_objects; ++i) {
+    const int status = frustum
+      ? classify_frustum(frustum, i)
+      : classify_box(lower, upper, i);
+    if(status >= 0)
+      CHECK(mark_list[i], status);
+  }
+}
+
+/* Filter out the objects of even index. */
+static float
+odd_filter
+  (unsigned int value,
+   const float org[3],
+   const float dir[3],
+   float distance,
+   void* data)
+{
+  (void)org, (void)dir;
+  ++*(int*)data;
+  return ((value - 1) / 3) % 2 ? distance : -1.f;
+}
+
+/* Brute force distance to the nearest box hit by the ray within
+ * [0, max_distance]. Return -1 if no box is hit. */
+static float
+pick_nearest
+  (size_t nb_objects,
+   const float org[3],
+   const float dir[3],
+   float max_distance,
+   int odd_only)
+{
+  float nearest = -1.f;
+  size_t i = 0;
+  int k = 0;
+
+  for(i = 0; i < nb_objects; ++i) {
+    float t_near = 0.f;
+    float t_far = max_distance;
+    if(odd_only && i % 2 == 0)
+      continue;
+    for(k = 0; k < 3; ++k) {
+      if(dir[k] == 0.f) {
+        if(org[k] < lower_list[i][k] || org[k] > upper_list[i][k])
+          break;
+      } else {
+        const float t0 = (lower_list[i][k] - org[k]) / dir[k];
+        const float t1 = (upper_list[i][k] - org[k]) / dir[k];
+        t_near = MAX(t_near, MIN(t0, t1));
+        t_far = MIN(t_far, MAX(t0, t1));
+      }
+    }
+    if(k == 3 && t_near <= t_far && (nearest < 0.f || t_near < nearest))
+      nearest = t_near;
+  }
+  return nearest;
+}
+
+static void
+check_picks(struct rbu_bvh* bvh, unsigned int* seed, size_t nb_objects)
+{
+  struct rbu_bvh_hit hit;
+  int nb_filtered = 0;
+  int nb_hits = 0;
+  int is_hit = 0;
+  int i = 0, k = 0;
+
+  for(i = 0; i < NB_RAYS; ++i) {
+    const int odd_only = i % 2;
+    float org[3], dir[3];
+    float nearest = 0.f;
+    for(k = 0; k < 3; ++k) {
+      org[k] = random_float(seed, -WORLD_SIZE, WORLD_SIZE);
+      dir[k] = random_float(seed, -1.f, 1.f);
+    }
+    /* Axis aligned rays. */
+    if(i % 10 == 0)
+      dir[(i / 10) % 3] = 0.f;
+    nearest = pick_nearest(nb_objects, org, dir, 4.f * WORLD_SIZE, odd_only);
+    CHECK(rbu_bvh_pick(bvh, org, dir, 4.f * WORLD_SIZE,
+      odd_only ? odd_filter : NULL, &nb_filtered, &hit, &is_hit), 0);
+    CHECK(is_hit, nearest >= 0.f);
+    if(is_hit) {
+      const size_t id = (hit.value - 1) / 3;
+      ++nb_hits;
+      CHECK(hit.value, object_value(id));
+      CHECK(id < nb_objects, 1);
+      CHECK(fabsf(hit.distance - nearest) <= EPSILON * MAX(1.f, nearest), 1);
+      if(odd_only)
+        CHECK(id % 2, 1);
+    }
+  }
+  /* Most rays hit an object of the dense scene. */
+  CHECK(nb_hits > NB_RAYS / 2, 1);
+  CHECK(nb_filtered > 0, 1);
+}
+
+static void
+check_queries
+  (struct rbu_bvh* bvh,
+   const struct rbu_frustum* frustum,
+   unsigned int* seed,
+   size_t nb_objects)
+{
+  const float lower[3] = { -30.f, -20.f, -60.f };
+  const float upper[3] = { 40.f, 25.f, -10.f };
+  unsigned int nb_values = 0;
+
+  CHECK(rbu_bvh_cull(bvh, frustum, value_list, &nb_values), 0);
+  check_query(value_list, nb_values, nb_objects, frustum, NULL, NULL);
+  CHECK(rbu_bvh_overlap(bvh, lower, upper, value_list, &nb_values), 0);
+  check_query(value_list, nb_values, nb_objects, NULL, lower, upper);
+  check_picks(bvh, seed, nb_objects);
+}
+
+/*******************************************************************************
+ *
+ * Bounding volume hierarchy test.
+ *
+ ******************************************************************************/
+int
+main(int argc, char** argv)
+{
+  /* Perspective projection of 60 degrees, aspect ratio 1, near 1 and far
+   * 1000, looking down -Z. */
+  const float proj[16] = {
+    1.732f, 0.f, 0.f, 0.f,
+    0.f, 1.732f, 0.f, 0.f,
+    0.f, 0.f, -1001.f / 999.f, -1.f,
+    0.f, 0.f, -2000.f / 999.f, 0.f
+  };
+  const struct rbu_bvh_desc desc = { 1.5f };
+  const float org[3] = { 0.5f, 0.5f, 0.f };
+  const float dir[3] = { 0.f, 0.f, -1.f };
+  struct rbu_frustum frustum;
+  struct rbu_bvh_hit hit;
+  struct rbu_bvh* bvh = NULL;
+  unsigned int nb_values = 0;
+  unsigned int seed = 7;
+  unsigned int id = 0;
+  int is_rebuilt = 0;
+  int is_hit = 0;
+  size_t i = 0;
+  int k = 0;
+  (void)argc, (void)argv;
+
+  CHECK(rbu_frustum_setup(&frustum, proj), 0);
+  CHECK(rbu_create_bvh(NULL, NULL, &bvh), -1);
+  CHECK(rbu_create_bvh(NULL, &desc, NULL), -1);
+  CHECK(rbu_create_bvh(NULL, &desc, &bvh), 0);
+
+  /* An empty tree has no result. */
+  CHECK(rbu_bvh_commit(bvh, &is_rebuilt), 0);
+  CHECK(rbu_bvh_cull(bvh, &frustum, value_list, &nb_values), 0);
+  CHECK(nb_values, 0);
+  CHECK(rbu_bvh_pick(bvh, org, dir, 100.f, NULL, NULL, &hit, &is_hit), 0);
+  CHECK(is_hit, 0);
+
+  for(i = 0; i < NB_OBJECTS; ++i) {
+    for(k = 0; k < 3; ++k) {
+      const float center = random_float(&seed, -WORLD_SIZE, WORLD_SIZE);
+      const float extent = random_float(&seed, 0.1f, 2.f);
+      lower_list[i][k] = center - extent;
+      upper_list[i][k] = center + extent;
+    }
+    CHECK(rbu_bvh_add
+      (bvh, lower_list[i], upper_list[i], object_value(i), &id), 0);
+    CHECK(id, (unsigned int)i);
+  }
+  CHECK(rbu_bvh_get_size(bvh, &id), 0);
+  CHECK(id, NB_OBJECTS);
+  /* The objects are ignored by the queries until they are committed. */
+  CHECK(rbu_bvh_cull(bvh, &frustum, value_list, &nb_values), 0);
+  CHECK(nb_values, 0);
+  CHECK(rbu_bvh_commit(bvh, &is_rebuilt), 0);
+  CHECK(is_rebuilt, 1);
+  CHECK(rbu_bvh_cull(bvh, NULL, value_list, &nb_values), -1);
+  CHECK(rbu_bvh_pick(bvh, org, dir, -1.f, NULL, NULL, &hit, &is_hit), -1);
+  check_queries(bvh, &frustum, &seed, NB_OBJECTS);
+
+  /* Small moves only refit the tree. */
+  for(i = 0; i < NB_OBJECTS; i += 100) {
+    move_object(&seed, i, 20.f);
+    CHECK(rbu_bvh_update
+      (bvh, (unsigned int)i, lower_list[i], upper_list[i]), 0);
+  }
+  CHECK(rbu_bvh_update
+    (bvh, NB_OBJECTS, lower_list[0], upper_list[0]), -1);
+  CHECK(rbu_bvh_commit(bvh, &is_rebuilt), 0);
+  CHECK(is_rebuilt, 0);
+  check_queries(bvh, &frustum, &seed, NB_OBJECTS);
+
+  /* Large moves degrade the refitted tree that is thus rebuilt. */
+  for(i = 0; i < NB_OBJECTS / 2; ++i) {
+    move_object(&seed, i, WORLD_SIZE / 2.f);
+    CHECK(rbu_bvh_update
+      (bvh, (unsigned int)i, lower_list[i], upper_list[i]), 0);
+  }
+  CHECK(rbu_bvh_commit(bvh, &is_rebuilt), 0);
+  CHECK(is_rebuilt, 1);
+  check_queries(bvh, &frustum, &seed, NB_OBJECTS);
+  CHECK(rbu_bvh_rebuild(bvh), 0);
+  check_queries(bvh, &frustum, &seed, NB_OBJECTS);
+
+  /* An added object rebuilds the tree on commit. */
+  for(k = 0; k < 3; ++k) {
+    lower_list[NB_OBJECTS][k] = org[k] - 0.25f;
+    upper_list[NB_OBJECTS][k] = org[k] + 0.25f;
+  }
+  lower_list[NB_OBJECTS][2] = -5.f;
+  upper_list[NB_OBJECTS][2] = -4.f;
+  CHECK(rbu_bvh_add(bvh, lower_list[NB_OBJECTS], upper_list[NB_OBJECTS],
+    object_value(NB_OBJECTS), &id), 0);
+  CHECK(id, NB_OBJECTS);
+  check_queries(bvh, &frustum, &seed, NB_OBJECTS);
+  CHECK(rbu_bvh_commit(bvh, &is_rebuilt), 0);
+  CHECK(is_rebuilt, 1);
+  check_queries(bvh, &frustum, &seed, NB_OBJECTS + 1);
+
+  /* A cleared tree is empty. */
+  CHECK(rbu_bvh_clear(bvh), 0);
+  CHECK(rbu_bvh_get_size(bvh, &id), 0);
+  CHECK(id, 0);
+  CHECK(rbu_bvh_commit(bvh, NULL), 0);
+  CHECK(rbu_bvh_cull(bvh, &frustum, value_list, &nb_values), 0);
+  CHECK(nb_values, 0);
+
+  /* Single object. */
+  CHECK(rbu_bvh_add(bvh, lower_list[NB_OBJECTS], upper_list[NB_OBJECTS], 9,
+    NULL), 0);
+  CHECK(rbu_bvh_commit(bvh, NULL), 0);
+  CHECK(rbu_bvh_cull(bvh, &frustum, value_list, &nb_values), 0);
+  CHECK(nb_values, 1);
+  CHECK(value_list[0], 9);
+  CHECK(rbu_bvh_pick(bvh, org, dir, 100.f, NULL, NULL, &hit, &is_hit), 0);
+  CHECK(is_hit, 1);
+  CHECK(hit.value, 9);
+  CHECK(hit.distance, 4.f);
+  CHECK(rbu_bvh_pick(bvh, org, dir, 3.f, NULL, NULL, &hit, &is_hit), 0);
+  CHECK(is_hit, 0);
+
+  CHECK(rbu_bvh_ref_get(bvh), 0);
+  CHECK(rbu_bvh_ref_put(bvh), 0);
+  CHECK(rbu_bvh_ref_put(bvh), 0);
+  return 0;
+}
@@ -0,0 +1,209 @@
+#include "rbu/rbu_cull.h"
+#include <snlsys/math.h>
+#include <snlsys/snlsys.h>
+#include <math.h>
+#include <string.h>
+
+/* Several chunks of a parallel cull and a tail that is not a multiple of the
+ * SIMD width. */
+#define NB_OBJECTS (3 * 8192 + 5)
+#define EPSILON 1.e-3 /* Margin within which an object may go either way. */
+
+static float lower_list[NB_OBJECTS][3];
+static float upper_list[NB_OBJECTS][3];
+static float radius_list[NB_OBJECTS];
+static unsigned int visible_list[NB_OBJECTS];
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+/* Deterministic pseudo random number in [0, 1). */
+static float
+random_float(unsigned int* seed)
+{
+  *seed = *seed * 1103515245u + 12345u;
+  return (float)((*seed >> 8) & 0xFFFF) / 65536.f;
+}
+
+/* Brute force classification of the object `id' against the frustum: 1 if it
+ * is visible, 0 if it is culled and -1 if it is too close to a plane to be
+ * decided at float precision. */
+static int
+classify(const struct rbu_frustum* frustum, size_t id)
+{
+  double radius = 0.0;
+  double extent[3];
+  double center[3];
+  int is_close = 0;
+  int i = 0, p = 0;
+
+  for(i = 0; i < 3; ++i) {
+    center[i] = ((double)lower_list[id][i] + upper_list[id][i]) * 0.5;
+    extent[i] = ((double)upper_list[id][i] - lower_list[id][i]) * 0.5;
+    radius += extent[i] * extent[i];
+  }
+  radius = radius_list[id] > 0.f ? radius_list[id] : sqrt(radius);
+  for(p = 0; p < 6; ++p) {
+    const float* plane = frustum->plane_list[p];
+    const double len = sqrt((double)plane[0] * plane[0]
+      + (double)plane[1] * plane[1] + (double)plane[2] * plane[2]);
+    double dst = plane[3];
+    double r = 0.0;
+    for(i = 0; i < 3; ++i) {
+      dst += plane[i] * center[i];
+      r += fabs(plane[i]) * extent[i];
+    }
+    /* Outside the plane if either the box or the sphere is. */
+    dst = (dst + MIN(r, radius * len)) / len;
+    if(dst < -EPSILON)
+      return 0;
+    if(dst < EPSILON)
+      is_close = 1;
+  }
+  return is_close ? -1 : 1;
+}
+
+/* Check the visible list of the set, whose object `i' has the value 2i+1,
+ * against the brute force classification of its objects. */
+static void
+check_cull
+  (struct rbu_cull_set* set,
+   const struct rbu_frustum* frustum,
+   size_t nb_objects)
+{
+  unsigned int nb_visible = 0;
+  unsigned int ivisible = 0;
+  size_t i = 0;
+
+  CHECK(rbu_cull_set_cull(set, frustum, visible_list, &nb_visible), 0);
+  /* The visible values are listed in their order of addition. */
+  for(i = 0; i < nb_objects; ++i) {
+    const int is_listed = ivisible < nb_visible
+      && visible_list[ivisible] == (unsigned int)(2 * i + 1);
+    const int status = classify(frustum, i);
+    if(status >= 0)
+      CHECK(is_listed, status);
+    ivisible += (unsigned int)is_listed;
+  }
+  CHECK(ivisible, nb_visible);
+}
+
+/*******************************************************************************
+ *
+ * Cull test.
+ *
+ ******************************************************************************/
+int
+main(int argc, char** argv)
+{
+  /* Perspective projection of 90 degrees, aspect ratio 1, near 1 and far
+   * 100, looking down -Z. */
+  const float proj[16] = {
+    1.f, 0.f, 0.f, 0.f,
+    0.f, 1.f, 0.f, 0.f,
+    0.f, 0.f, -101.f / 99.f, -1.f,
+    0.f, 0.f, -200.f / 99.f, 0.f
+  };
+  const float inside[3] = { 0.f, 0.f, -10.f };
+  const float behind[3] = { 0.f, 0.f, 10.f };
+  struct rbu_frustum frustum;
+  struct rbu_frustum scaled_frustum;
+  struct rbu_cull_set* set[2] = { NULL, NULL };
+  unsigned int nb_visible = 0;
+  unsigned int nb = 0;
+  unsigned int seed = 1;
+  size_t i = 0;
+  int j = 0, p = 0;
+  (void)argc, (void)argv;
+
+  CHECK(rbu_frustum_setup(NULL, proj), -1);
+  CHECK(rbu_frustum_setup(&frustum, NULL), -1);
+  CHECK(rbu_frustum_setup(&frustum, proj), 0);
+  /* Normalized planes, all of which contain a point in front of the viewer
+   * while a point behind it is outside at least one. */
+  nb = 0;
+  for(p = 0; p < 6; ++p) {
+    const float* plane = frustum.plane_list[p];
+    float dst[2];
+    CHECK(fabsf(plane[0]*plane[0] + plane[1]*plane[1] + plane[2]*plane[2]
+      - 1.f) < 1.e-5f, 1);
+    dst[0] = plane[0]*inside[0] + plane[1]*inside[1] + plane[2]*inside[2];
+    dst[1] = plane[0]*behind[0] + plane[1]*behind[1] + plane[2]*behind[2];
+    CHECK(dst[0] + plane[3] > 0.f, 1);
+    nb += dst[1] + plane[3] < 0.f;
+  }
+  CHECK(nb >= 1, 1);
+  /* The cull normalizes the planes. */
+  scaled_frustum = frustum;
+  for(p = 0; p < 6; ++p) {
+    for(j = 0; j < 4; ++j)
+      scaled_frustum.plane_list[p][j] *= (float)(p + 2);
+  }
+
+  /* Boxes of various sizes around the frustum, a third with an explicit
+   * radius smaller than their circumscribed sphere. */
+  for(i = 0; i < NB_OBJECTS; ++i) {
+    for(j = 0; j < 3; ++j) {
+      const float center = random_float(&seed) * 240.f - 120.f;
+      const float extent = random_float(&seed) * 4.f;
+      lower_list[i][j] = center - extent;
+      upper_list[i][j] = center + extent;
+    }
+    radius_list[i] = i % 3 == 0 ? random_float(&seed) * 2.f : 0.f;
+  }
+
+  CHECK(rbu_create_cull_set(NULL, 1, NULL), -1);
+  CHECK(rbu_create_cull_set(NULL, 1, &set[0]), 0);
+  CHECK(rbu_create_cull_set(NULL, 4, &set[1]), 0);
+  for(j = 0; j < 2; ++j) {
+    for(i = 0; i < NB_OBJECTS; ++i) {
+      CHECK(rbu_cull_set_add(set[j], lower_list[i], upper_list[i],
+        radius_list[i], (unsigned int)(2 * i + 1), &nb), 0);
+      CHECK(nb, (unsigned int)i);
+    }
+    CHECK(rbu_cull_set_get_size(set[j], &nb), 0);
+    CHECK(nb, NB_OBJECTS);
+  }
+  CHECK(rbu_cull_set_cull(set[0], NULL, visible_list, &nb_visible), -1);
+
+  for(j = 0; j < 2; ++j) {
+    check_cull(set[j], &frustum, NB_OBJECTS);
+    check_cull(set[j], &scaled_frustum, NB_OBJECTS);
+  }
+
+  /* Move the objects: each third one is moved into the view. */
+  for(i = 0; i < NB_OBJECTS; i += 3) {
+    for(j = 0; j < 3; ++j) {
+      lower_list[i][j] = inside[j] - 1.f;
+      upper_list[i][j] = inside[j] + 1.f;
+    }
+    radius_list[i] = 0.f;
+    for(j = 0; j < 2; ++j) {
+      CHECK(rbu_cull_set_update
+        (set[j], (unsigned int)i, lower_list[i], upper_list[i], 0.f), 0);
+    }
+  }
+  CHECK(rbu_cull_set_update
+    (set[0], NB_OBJECTS, lower_list[0], upper_list[0], 0.f), -1);
+  for(j = 0; j < 2; ++j)
+    check_cull(set[j], &frustum, NB_OBJECTS);
+
+  /* A cleared set has no visible object. */
+  CHECK(rbu_cull_set_clear(set[1]), 0);
+  CHECK(rbu_cull_set_cull(set[1], &frustum, visible_list, &nb_visible), 0);
+  CHECK(nb_visible, 0);
+  /* Less objects than the SIMD width. */
+  for(i = 0; i < 3; ++i) {
+    CHECK(rbu_cull_set_add(set[1], lower_list[i], upper_list[i],
+      radius_list[i], (unsigned int)(2 * i + 1), NULL), 0);
+  }
+  check_cull(set[1], &frustum, 3);
+
+  CHECK(rbu_cull_set_ref_get(set[0]), 0);
+  CHECK(rbu_cull_set_ref_put(set[0]), 0);
+  CHECK(rbu_cull_set_ref_put(set[0]), 0);
+  CHECK(rbu_cull_set_ref_put(set[1]), 0);
+  return 0;
+}
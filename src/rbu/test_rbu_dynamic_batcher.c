@@ -0,0 +1,364 @@
+#include "rbi/rbi.h"
+#include "rbu/rbu_dynamic_batcher.h"
+#include "rb.h"
+#include <snlsys/snlsys.h>
+#include <string.h>
+
+#define MAX_VERTICES 10
+#define MAX_INDICES 100
+#define VERTEX_SIZE (4 * sizeof(float)) /* Float3 position and instance id. */
+#define MAX_BUFFERS 16
+
+/*******************************************************************************
+ *
+ * Recording backend. The buffers keep their last uploaded data and the draws
+ * record the buffers of the vertex array they use.
+ *
+ ******************************************************************************/
+struct rb_buffer {
+  unsigned char data[MAX_VERTICES * VERTEX_SIZE + MAX_INDICES * 4];
+  int size;
+  int ref;
+};
+
+struct rb_vertex_array {
+  struct rb_buffer* vertex_buffer;
+  struct rb_buffer* index_buffer;
+  int ref;
+};
+
+static struct rb_buffer buffer_list[MAX_BUFFERS];
+static struct rb_vertex_array vertex_array_list[MAX_BUFFERS];
+static int nb_buffers = 0;
+static int nb_vertex_arrays = 0;
+static int context_ref = 0;
+
+static struct rb_vertex_array* bound_vertex_array = NULL;
+static struct rb_program* bound_program = NULL;
+static unsigned int nb_draw_indices = 0;
+static int nb_draws = 0;
+static int draw_error = 0;
+
+static int
+context_ref_get(struct rb_context* ctxt)
+{
+  (void)ctxt;
+  ++context_ref;
+  return 0;
+}
+
+static int
+context_ref_put(struct rb_context* ctxt)
+{
+  (void)ctxt;
+  --context_ref;
+  return 0;
+}
+
+static int
+create_buffer
+  (struct rb_context* ctxt,
+   const struct rb_buffer_desc* desc,
+   const void* init_data,
+   struct rb_buffer** out_buffer)
+{
+  struct rb_buffer* buffer = NULL;
+  (void)ctxt, (void)init_data;
+  if(nb_buffers == MAX_BUFFERS || desc->size > sizeof(buffer->data))
+    return -1;
+  buffer = buffer_list + nb_buffers++;
+  buffer->size = (int)desc->size;
+  buffer->ref = 1;
+  *out_buffer = buffer;
+  return 0;
+}
+
+static int
+buffer_ref_put(struct rb_buffer* buffer)
+{
+  --buffer->ref;
+  return 0;
+}
+
+static int
+buffer_data(struct rb_buffer* buffer, int offset, int size, const void* data)
+{
+  if(offset < 0 || size < 0 || offset + size > buffer->size)
+    return -1;
+  memcpy(buffer->data + offset, data, (size_t)size);
+  return 0;
+}
+
+static int
+create_vertex_array
+  (struct rb_context* ctxt,
+   struct rb_vertex_array** out_varray)
+{
+  (void)ctxt;
+  if(nb_vertex_arrays == MAX_BUFFERS)
+    return -1;
+  *out_varray = vertex_array_list + nb_vertex_arrays++;
+  (*out_varray)->ref = 1;
+  return 0;
+}
+
+static int
+vertex_array_ref_put(struct rb_vertex_array* varray)
+{
+  --varray->ref;
+  return 0;
+}
+
+static int
+vertex_attrib_array
+  (struct rb_vertex_array* varray,
+   struct rb_buffer* buffer,
+   int count,
+   const struct rb_buffer_attrib* attrib_list)
+{
+  int i = 0;
+  for(i = 0; i < count; ++i) {
+    if(attrib_list[i].stride != VERTEX_SIZE)
+      return -1;
+  }
+  varray->vertex_buffer = buffer;
+  return 0;
+}
+
+static int
+vertex_index_array(struct rb_vertex_array* varray, struct rb_buffer* buffer)
+{
+  varray->index_buffer = buffer;
+  return 0;
+}
+
+static int
+bind_program(struct rb_context* ctxt, struct rb_program* prog)
+{
+  (void)ctxt;
+  bound_program = prog;
+  return 0;
+}
+
+static int
+bind_vertex_array(struct rb_context* ctxt, struct rb_vertex_array* varray)
+{
+  (void)ctxt;
+  bound_vertex_array = varray;
+  return 0;
+}
+
+static int
+draw_indexed
+  (struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int count)
+{
+  (void)ctxt, (void)prim_type;
+  if(draw_error)
+    return -1;
+  nb_draw_indices = count;
+  ++nb_draws;
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+/* Fake object handles; the batcher only compares them. */
+#define HANDLE(type, i) ((struct type*)(size_t)(16 * ((i) + 1)))
+
+static const float quad[4 * 4] = {
+  0.f, 0.f, 0.f, 0.f,
+  1.f, 0.f, 0.f, 0.f,
+  1.f, 1.f, 0.f, 0.f,
+  0.f, 1.f, 0.f, 0.f
+};
+static const unsigned int quad_indices[6] = { 0, 1, 2, 0, 2, 3 };
+
+/* Translation of the quad `i'. */
+static void
+setup_transform(float matrix[16], int i)
+{
+  memset(matrix, 0, 16 * sizeof(float));
+  matrix[0] = matrix[5] = matrix[10] = matrix[15] = 1.f;
+  matrix[12] = (float)i;
+  matrix[13] = 2.f * (float)i;
+}
+
+/* Check the vertices and the indices of the last drawn batch of `nb_quads'
+ * quads, the first of which is the quad `first'. */
+static void
+check_batch(int first, int nb_quads)
+{
+  const float* vertices = NULL;
+  const unsigned int* indices = NULL;
+  int i = 0, j = 0;
+
+  CHECK(bound_vertex_array != NULL, 1);
+  CHECK(nb_draw_indices, (unsigned int)(6 * nb_quads));
+  vertices = (const float*)bound_vertex_array->vertex_buffer->data;
+  indices = (const unsigned int*)bound_vertex_array->index_buffer->data;
+  for(i = 0; i < nb_quads; ++i) {
+    for(j = 0; j < 4; ++j) {
+      const float* vertex = vertices + (4 * i + j) * 4;
+      CHECK(vertex[0], quad[j * 4 + 0] + (float)(first + i));
+      CHECK(vertex[1], quad[j * 4 + 1] + 2.f * (float)(first + i));
+      CHECK(vertex[2], 0.f);
+      CHECK(vertex[3], (float)(first + i));
+    }
+    for(j = 0; j < 6; ++j)
+      CHECK(indices[6 * i + j], quad_indices[j] + (unsigned int)(4 * i));
+  }
+}
+
+/*******************************************************************************
+ *
+ * Dynamic batcher test.
+ *
+ ******************************************************************************/
+int
+main(int argc, char** argv)
+{
+  struct rb_context* ctxt = HANDLE(rb_context, 0);
+  const struct rb_buffer_attrib attrib_list[2] = {
+    { 0, 0, 0, RB_FLOAT3 },
+    { 1, 0, 3 * sizeof(float), RB_FLOAT }
+  };
+  const unsigned int bad_indices[3] = { 0, 1, 4 };
+  struct rbu_dynamic_batcher_desc desc;
+  struct rbu_dynamic_batcher_stats stats;
+  struct rbu_batch_state state;
+  struct rbu_batch_state other_state;
+  struct rbu_batch_mesh mesh;
+  struct rbu_dynamic_batcher* batcher = NULL;
+  struct rbi rbi;
+  float matrix[16];
+  int frame = 0;
+  int i = 0;
+  (void)argc, (void)argv;
+
+  memset(&rbi, 0, sizeof(rbi));
+  rbi.context_ref_get = context_ref_get;
+  rbi.context_ref_put = context_ref_put;
+  rbi.create_buffer = create_buffer;
+  rbi.buffer_ref_put = buffer_ref_put;
+  rbi.buffer_data = buffer_data;
+  rbi.create_vertex_array = create_vertex_array;
+  rbi.vertex_array_ref_put = vertex_array_ref_put;
+  rbi.vertex_attrib_array = vertex_attrib_array;
+  rbi.vertex_index_array = vertex_index_array;
+  rbi.bind_program = bind_program;
+  rbi.bind_vertex_array = bind_vertex_array;
+  rbi.draw_indexed = draw_indexed;
+
+  memset(&desc, 0, sizeof(desc));
+  desc.attrib_list = attrib_list;
+  desc.nb_attribs = 2;
+  desc.vertex_size = VERTEX_SIZE;
+  desc.position_offset = 0;
+  desc.normal_offset = -1;
+  desc.instance_offset = 3 * sizeof(float);
+  desc.max_vertices = MAX_VERTICES;
+  desc.max_indices = MAX_INDICES;
+
+  /* Attributes out of the vertex are rejected. */
+  desc.instance_offset = 4 * sizeof(float);
+  CHECK(rbu_create_dynamic_batcher(NULL, &rbi, ctxt, &desc, &batcher), -1);
+  desc.instance_offset = 3 * sizeof(float);
+  CHECK(rbu_create_dynamic_batcher(NULL, NULL, ctxt, &desc, &batcher), -1);
+  CHECK(rbu_create_dynamic_batcher(NULL, &rbi, ctxt, &desc, &batcher), 0);
+  CHECK(context_ref, 1);
+
+  memset(&state, 0, sizeof(state));
+  state.program = HANDLE(rb_program, 0);
+  state.prim_type = RB_TRIANGLE_LIST;
+  other_state = state;
+  other_state.program = HANDLE(rb_program, 1);
+
+  /* Invalid meshes are rejected and nothing is drawn. */
+  memset(&mesh, 0, sizeof(mesh));
+  mesh.vertices = quad;
+  mesh.nb_vertices = 4;
+  mesh.indices = quad_indices;
+  mesh.nb_indices = 0;
+  CHECK(rbu_dynamic_batcher_add(batcher, &state, &mesh), -1);
+  mesh.nb_indices = 6;
+  mesh.nb_vertices = 0;
+  CHECK(rbu_dynamic_batcher_add(batcher, &state, &mesh), -1);
+  mesh.nb_vertices = MAX_VERTICES + 1;
+  CHECK(rbu_dynamic_batcher_add(batcher, &state, &mesh), -1);
+  mesh.nb_vertices = 4;
+  mesh.indices = bad_indices;
+  mesh.nb_indices = 3;
+  CHECK(rbu_dynamic_batcher_add(batcher, &state, &mesh), -1);
+  mesh.indices = quad_indices;
+  mesh.nb_indices = 6;
+  state.prim_type = RB_TRIANGLE_STRIP;
+  CHECK(rbu_dynamic_batcher_add(batcher, &state, &mesh), -1);
+  state.prim_type = RB_TRIANGLE_LIST;
+  CHECK(rbu_dynamic_batcher_flush(batcher), 0);
+  CHECK(nb_draws, 0);
+  CHECK(nb_buffers, 0);
+
+  for(frame = 0; frame < 2; ++frame) {
+    /* A batch stores at most 2 quads of 4 vertices. */
+    nb_draws = 0;
+    for(i = 0; i < 3; ++i) {
+      setup_transform(matrix, i);
+      mesh.transform = matrix;
+      mesh.instance_id = (float)i;
+      CHECK(rbu_dynamic_batcher_add(batcher, &state, &mesh), 0);
+    }
+    CHECK(nb_draws, 1);
+    CHECK(bound_program, state.program);
+    check_batch(0, 2);
+    /* A state change draws the pending batch. */
+    setup_transform(matrix, 3);
+    mesh.instance_id = 3.f;
+    CHECK(rbu_dynamic_batcher_add(batcher, &other_state, &mesh), 0);
+    CHECK(nb_draws, 2);
+    check_batch(2, 1);
+    CHECK(rbu_dynamic_batcher_flush(batcher), 0);
+    CHECK(nb_draws, 3);
+    CHECK(bound_program, other_state.program);
+    check_batch(3, 1);
+    CHECK(rbu_dynamic_batcher_flush(batcher), 0);
+    CHECK(nb_draws, 3);
+
+    CHECK(rbu_dynamic_batcher_get_stats(batcher, &stats), 0);
+    CHECK(stats.nb_meshes, 4);
+    CHECK(stats.nb_draws, 3);
+    CHECK(stats.nb_vertices, 16);
+    CHECK(stats.nb_indices, 24);
+    CHECK(rbu_dynamic_batcher_end_frame(batcher), 0);
+    CHECK(rbu_dynamic_batcher_get_stats(batcher, &stats), 0);
+    CHECK(stats.nb_meshes, 0);
+    /* One stream per batch of the frame, recycled on the next frame. */
+    CHECK(nb_buffers, 2 * 3);
+    CHECK(nb_vertex_arrays, 3);
+  }
+
+  /* A mesh is not appended if the pending batch fails to be drawn. */
+  CHECK(rbu_dynamic_batcher_add(batcher, &state, &mesh), 0);
+  draw_error = 1;
+  CHECK(rbu_dynamic_batcher_add(batcher, &other_state, &mesh), -1);
+  draw_error = 0;
+  nb_draws = 0;
+  CHECK(rbu_dynamic_batcher_flush(batcher), 0);
+  CHECK(nb_draws, 0);
+  CHECK(rbu_dynamic_batcher_get_stats(batcher, &stats), 0);
+  CHECK(stats.nb_meshes, 1);
+
+  CHECK(rbu_dynamic_batcher_ref_get(batcher), 0);
+  CHECK(rbu_dynamic_batcher_ref_put(batcher), 0);
+  CHECK(rbu_dynamic_batcher_ref_put(batcher), 0);
+  CHECK(context_ref, 0);
+  for(i = 0; i < nb_buffers; ++i)
+    CHECK(buffer_list[i].ref, 0);
+  for(i = 0; i < nb_vertex_arrays; ++i)
+    CHECK(vertex_array_list[i].ref, 0);
+  return 0;
+}
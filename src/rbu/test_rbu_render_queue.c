@@ -0,0 +1,226 @@
+#include "rbi/rbi.h"
+#include "rbu/rbu_render_queue.h"
+#include "rb.h"
+#include <snlsys/snlsys.h>
+#include <string.h>
+
+#define NB_ITEMS 64
+#define FIRST_TRANSPARENT 48
+#define TOP_ITEM 10 /* Opaque item of the upper layer. */
+#define NB_PROGRAMS 3
+#define NB_VERTEX_ARRAYS 5
+
+/*******************************************************************************
+ *
+ * Recording backend. The draws record the value of the last uniform set,
+ * i.e. the index of the drawn item.
+ *
+ ******************************************************************************/
+static int draw_list[4096];
+static int nb_draws = 0;
+static int uniform_value = -1;
+static int nb_program_binds = 0;
+static int nb_blends = 0;
+
+static int
+bind_program(struct rb_context* ctxt, struct rb_program* prog)
+{
+  (void)ctxt, (void)prog;
+  ++nb_program_binds;
+  return 0;
+}
+
+static int
+bind_vertex_array(struct rb_context* ctxt, struct rb_vertex_array* varray)
+{
+  (void)ctxt, (void)varray;
+  return 0;
+}
+
+static int
+blend(struct rb_context* ctxt, const struct rb_blend_desc* desc)
+{
+  (void)ctxt, (void)desc;
+  ++nb_blends;
+  return 0;
+}
+
+static int
+uniform_data(struct rb_uniform* uniform, int count, const void* data)
+{
+  (void)uniform, (void)count;
+  uniform_value = *(const int*)data;
+  return 0;
+}
+
+static int
+draw
+  (struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int count)
+{
+  (void)ctxt, (void)prim_type, (void)count;
+  if(nb_draws < (int)(sizeof(draw_list) / sizeof(draw_list[0])))
+    draw_list[nb_draws] = uniform_value;
+  ++nb_draws;
+  return 0;
+}
+
+static void
+reset_records(void)
+{
+  nb_draws = 0;
+  uniform_value = -1;
+  nb_program_binds = 0;
+  nb_blends = 0;
+}
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+/* Fake object handles; the queue only compares them. */
+#define HANDLE(type, i) ((struct type*)(size_t)(16 * ((i) + 1)))
+
+static float
+item_depth(int i)
+{
+  /* Mix of negative and positive depths pushed in no particular order. */
+  return (float)((i * 37) % NB_ITEMS) - 20.f;
+}
+
+/* Check that the opaque item `a' is correctly drawn before `b'. The state
+ * identifiers are assigned in the order of the first push. */
+static int
+is_opaque_ordered(int a, int b)
+{
+  const int key_a[3] = { a % NB_PROGRAMS, a & 1, a % NB_VERTEX_ARRAYS };
+  const int key_b[3] = { b % NB_PROGRAMS, b & 1, b % NB_VERTEX_ARRAYS };
+  int i = 0;
+
+  for(i = 0; i < 3; ++i) {
+    if(key_a[i] != key_b[i])
+      return key_a[i] < key_b[i];
+  }
+  return item_depth(a) <= item_depth(b);
+}
+
+/*******************************************************************************
+ *
+ * Render queue test.
+ *
+ ******************************************************************************/
+int
+main(int argc, char** argv)
+{
+  struct rb_context* ctxt = (struct rb_context*)(size_t)1;
+  struct rb_blend_desc blend_desc[2];
+  struct rbu_render_queue_stats stats;
+  struct rbu_uniform_value value;
+  struct rbu_draw_item item;
+  struct rbu_render_queue* queue = NULL;
+  struct rbi rbi;
+  int data = 0;
+  int i = 0;
+  (void)argc, (void)argv;
+
+  memset(&rbi, 0, sizeof(rbi));
+  rbi.bind_program = bind_program;
+  rbi.bind_vertex_array = bind_vertex_array;
+  rbi.blend = blend;
+  rbi.uniform_data = uniform_data;
+  rbi.draw = draw;
+  /* Equal descriptors at distinct addresses. */
+  memset(blend_desc, 0, sizeof(blend_desc));
+  memset(&item, 0, sizeof(item));
+
+  CHECK(rbu_create_render_queue(NULL, NULL, &queue), -1);
+  CHECK(rbu_create_render_queue(NULL, &rbi, NULL), -1);
+  CHECK(rbu_create_render_queue(NULL, &rbi, &queue), 0);
+  CHECK(rbu_render_queue_push(NULL, &item), -1);
+  CHECK(rbu_render_queue_push(queue, NULL), -1);
+  CHECK(rbu_render_queue_flush(queue, NULL), -1);
+
+  item.uniform_list = &value;
+  item.nb_uniforms = 1;
+  item.prim_type = RB_TRIANGLE_LIST;
+  item.count = 3;
+  value.uniform = HANDLE(rb_uniform, 0);
+  value.count = 1;
+  value.data = &data;
+  value.size = sizeof(int);
+  for(i = 0; i < NB_ITEMS; ++i) {
+    /* The uniform data is copied on push. */
+    data = i;
+    item.program = HANDLE(rb_program, i % NB_PROGRAMS);
+    item.vertex_array = HANDLE(rb_vertex_array, i % NB_VERTEX_ARRAYS);
+    item.blend = blend_desc + (i & 1);
+    item.depth = item_depth(i);
+    item.is_transparent = i >= FIRST_TRANSPARENT;
+    item.layer = i == TOP_ITEM ? 1 : 0;
+    CHECK(rbu_render_queue_push(queue, &item), 0);
+  }
+  reset_records();
+  CHECK(rbu_render_queue_flush(queue, ctxt), 0);
+  CHECK(rbu_render_queue_get_stats(queue, &stats), 0);
+  CHECK(nb_draws, NB_ITEMS);
+  CHECK(stats.nb_items, NB_ITEMS);
+  CHECK(stats.nb_program_binds, (size_t)nb_program_binds);
+  /* The blend descriptors are compared by content. */
+  CHECK(nb_blends, 1);
+  CHECK(stats.nb_state_changes, 1);
+
+  /* The opaque items of the lower layer come first, sorted by program, state
+   * and vertex array, i.e. in the order of their first push, then front to
+   * back. */
+  for(i = 0; i < FIRST_TRANSPARENT - 1; ++i) {
+    const int item_id = draw_list[i];
+    CHECK(item_id < FIRST_TRANSPARENT && item_id != TOP_ITEM, 1);
+    if(i > 0)
+      CHECK(is_opaque_ordered(draw_list[i - 1], item_id), 1);
+  }
+  /* Then the transparent items, back to front. */
+  for(i = FIRST_TRANSPARENT - 1; i < NB_ITEMS - 1; ++i) {
+    CHECK(draw_list[i] >= FIRST_TRANSPARENT, 1);
+    if(i > FIRST_TRANSPARENT - 1)
+      CHECK(item_depth(draw_list[i - 1]) >= item_depth(draw_list[i]), 1);
+  }
+  /* And finally the upper layer. */
+  CHECK(draw_list[NB_ITEMS - 1], TOP_ITEM);
+
+  /* The queue is empty after a flush and is reusable. */
+  reset_records();
+  CHECK(rbu_render_queue_flush(queue, ctxt), 0);
+  CHECK(nb_draws, 0);
+  data = 7;
+  CHECK(rbu_render_queue_push(queue, &item), 0);
+  CHECK(rbu_render_queue_flush(queue, ctxt), 0);
+  CHECK(nb_draws, 1);
+  CHECK(draw_list[0], 7);
+
+  /* Cleared items are not drawn. */
+  reset_records();
+  CHECK(rbu_render_queue_push(queue, &item), 0);
+  CHECK(rbu_render_queue_clear(queue), 0);
+  CHECK(rbu_render_queue_flush(queue, ctxt), 0);
+  CHECK(nb_draws, 0);
+
+  /* Beyond RBU_RENDER_QUEUE_MAX_IDS programs, the items share an identifier
+   * and are still all drawn. */
+  item.is_transparent = 0;
+  item.nb_uniforms = 0;
+  for(i = 0; i < 3 * RBU_RENDER_QUEUE_MAX_IDS; ++i) {
+    item.program = HANDLE(rb_program, i);
+    CHECK(rbu_render_queue_push(queue, &item), 0);
+  }
+  reset_records();
+  CHECK(rbu_render_queue_flush(queue, ctxt), 0);
+  CHECK(nb_draws, 3 * RBU_RENDER_QUEUE_MAX_IDS);
+  CHECK(nb_program_binds, 3 * RBU_RENDER_QUEUE_MAX_IDS);
+
+  CHECK(rbu_render_queue_ref_get(queue), 0);
+  CHECK(rbu_render_queue_ref_put(queue), 0);
+  CHECK(rbu_render_queue_ref_put(queue), 0);
+  return 0;
+}
@@ -0,0 +1,335 @@
+#include "rbi/rbi.h"
+#include "rbu/rbu_static_batch.h"
+#include "rb.h"
+#include <snlsys/snlsys.h>
+#include <string.h>
+
+#define NB_MESHES 12
+#define MAX_MESH_VERTICES 6
+#define MAX_MESH_INDICES (3 * (MAX_MESH_VERTICES - 2))
+#define MAX_BUFFER_SIZE (NB_MESHES * MAX_MESH_INDICES * sizeof(unsigned int))
+#define NB_GROUPS 3
+
+/*******************************************************************************
+ *
+ * Recording backend. The buffers keep their initial data and the multi draws
+ * record their ranges.
+ *
+ ******************************************************************************/
+struct rb_buffer {
+  unsigned char data[MAX_BUFFER_SIZE];
+  int ref;
+};
+
+struct rb_vertex_array {
+  struct rb_buffer* vertex_buffer;
+  struct rb_buffer* index_buffer;
+  int ref;
+};
+
+static struct rb_buffer buffer_list[4];
+static struct rb_vertex_array vertex_array_list[2];
+static int nb_buffers = 0;
+static int nb_vertex_arrays = 0;
+
+static struct rb_vertex_array* bound_vertex_array = NULL;
+static struct rb_draw_range draw_range_list[NB_MESHES];
+static unsigned int nb_draw_ranges = 0;
+static int nb_draws = 0;
+
+static int
+create_buffer
+  (struct rb_context* ctxt,
+   const struct rb_buffer_desc* desc,
+   const void* init_data,
+   struct rb_buffer** out_buffer)
+{
+  struct rb_buffer* buffer = NULL;
+  (void)ctxt;
+  if(nb_buffers == 4 || desc->size > MAX_BUFFER_SIZE || !init_data)
+    return -1;
+  buffer = buffer_list + nb_buffers++;
+  memcpy(buffer->data, init_data, desc->size);
+  buffer->ref = 1;
+  *out_buffer = buffer;
+  return 0;
+}
+
+static int
+buffer_ref_put(struct rb_buffer* buffer)
+{
+  --buffer->ref;
+  return 0;
+}
+
+static int
+create_vertex_array
+  (struct rb_context* ctxt,
+   struct rb_vertex_array** out_varray)
+{
+  (void)ctxt;
+  if(nb_vertex_arrays == 2)
+    return -1;
+  *out_varray = vertex_array_list + nb_vertex_arrays++;
+  (*out_varray)->ref = 1;
+  return 0;
+}
+
+static int
+vertex_array_ref_put(struct rb_vertex_array* varray)
+{
+  --varray->ref;
+  return 0;
+}
+
+static int
+vertex_attrib_array
+  (struct rb_vertex_array* varray,
+   struct rb_buffer* buffer,
+   int count,
+   const struct rb_buffer_attrib* attrib_list)
+{
+  (void)count, (void)attrib_list;
+  varray->vertex_buffer = buffer;
+  return 0;
+}
+
+static int
+vertex_index_array(struct rb_vertex_array* varray, struct rb_buffer* buffer)
+{
+  varray->index_buffer = buffer;
+  return 0;
+}
+
+static int
+bind_vertex_array(struct rb_context* ctxt, struct rb_vertex_array* varray)
+{
+  (void)ctxt;
+  bound_vertex_array = varray;
+  return 0;
+}
+
+static int
+multi_draw_indexed
+  (struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int nb_ranges,
+   const struct rb_draw_range* range_list)
+{
+  (void)ctxt, (void)prim_type;
+  if(nb_ranges > NB_MESHES)
+    return -1;
+  memcpy(draw_range_list, range_list, nb_ranges*sizeof(struct rb_draw_range));
+  nb_draw_ranges = nb_ranges;
+  ++nb_draws;
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+/* The meshes have a distinct number of vertices, in [3, MAX_MESH_VERTICES],
+ * and are spread in the groups in no particular order. */
+static unsigned int
+mesh_nb_vertices(unsigned int mesh)
+{
+  return 3 + mesh % (MAX_MESH_VERTICES - 2);
+}
+
+static unsigned int
+mesh_group(unsigned int mesh)
+{
+  return 10 * ((mesh * 5) % NB_GROUPS);
+}
+
+/* Vertices tagged by their mesh and their index, triangulated as a fan. */
+static void
+setup_mesh
+  (unsigned int mesh,
+   float vertices[MAX_MESH_VERTICES],
+   unsigned int indices[MAX_MESH_INDICES],
+   struct rbu_static_mesh* desc)
+{
+  unsigned int i = 0;
+
+  desc->nb_vertices = mesh_nb_vertices(mesh);
+  desc->nb_indices = 3 * (desc->nb_vertices - 2);
+  desc->vertices = vertices;
+  desc->indices = indices;
+  desc->group = mesh_group(mesh);
+  for(i = 0; i < desc->nb_vertices; ++i)
+    vertices[i] = (float)(100 * mesh + i);
+  for(i = 0; i < desc->nb_vertices - 2; ++i) {
+    indices[3 * i + 0] = 0;
+    indices[3 * i + 1] = i + 1;
+    indices[3 * i + 2] = i + 2;
+  }
+}
+
+/* Check that `range' addresses the vertices of the mesh in the batch. */
+static void
+check_range(unsigned int mesh, const struct rb_draw_range* range)
+{
+  float vertices[MAX_MESH_VERTICES];
+  unsigned int indices[MAX_MESH_INDICES];
+  struct rbu_static_mesh desc;
+  const float* batch_vertices = NULL;
+  const unsigned int* batch_indices = NULL;
+  unsigned int i = 0;
+
+  setup_mesh(mesh, vertices, indices, &desc);
+  CHECK(range->count, desc.nb_indices);
+  batch_vertices = (const float*)vertex_array_list[0].vertex_buffer->data;
+  batch_indices = (const unsigned int*)vertex_array_list[0].index_buffer->data;
+  for(i = 0; i < range->count; ++i) {
+    /* The indices are relative to the base vertex of the mesh. */
+    const unsigned int index = batch_indices[range->first_index + i];
+    CHECK(index, indices[i]);
+    CHECK(batch_vertices[range->base_vertex + index], vertices[index]);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Static batch test.
+ *
+ ******************************************************************************/
+int
+main(int argc, char** argv)
+{
+  struct rb_context* ctxt = (struct rb_context*)(size_t)16;
+  const struct rb_buffer_attrib attrib = { 0, 0, 0, RB_FLOAT };
+  const struct rbu_static_batch_desc desc = { &attrib, 1, sizeof(float) };
+  const unsigned int bad_indices[3] = { 0, 1, 3 };
+  float vertices[MAX_MESH_VERTICES];
+  unsigned int indices[MAX_MESH_INDICES];
+  unsigned int mesh_id_list[NB_MESHES];
+  struct rb_draw_range range_list[NB_MESHES];
+  struct rbu_static_mesh mesh;
+  const struct rb_draw_range* group_range_list = NULL;
+  struct rbu_static_batch_builder* builder = NULL;
+  struct rbu_static_batch* batch = NULL;
+  struct rbu_static_batch* batch2 = NULL;
+  struct rb_vertex_array* varray = NULL;
+  struct rbi rbi;
+  unsigned int nb_ranges = 0;
+  unsigned int group = 0;
+  unsigned int nb_indices = 0;
+  unsigned int i = 0, j = 0;
+  (void)argc, (void)argv;
+
+  memset(&rbi, 0, sizeof(rbi));
+  rbi.create_buffer = create_buffer;
+  rbi.buffer_ref_put = buffer_ref_put;
+  rbi.create_vertex_array = create_vertex_array;
+  rbi.vertex_array_ref_put = vertex_array_ref_put;
+  rbi.vertex_attrib_array = vertex_attrib_array;
+  rbi.vertex_index_array = vertex_index_array;
+  rbi.bind_vertex_array = bind_vertex_array;
+  rbi.multi_draw_indexed = multi_draw_indexed;
+
+  CHECK(rbu_create_static_batch_builder(NULL, NULL, &builder), -1);
+  CHECK(rbu_create_static_batch_builder(NULL, &desc, &builder), 0);
+  /* An empty builder is not built. */
+  CHECK(rbu_static_batch_builder_build(builder, &rbi, ctxt, &batch), -1);
+
+  /* Empty meshes and out of range indices are rejected. */
+  setup_mesh(0, vertices, indices, &mesh);
+  mesh.nb_indices = 0;
+  CHECK(rbu_static_batch_builder_add(builder, &mesh, NULL), -1);
+  mesh.nb_indices = 3;
+  mesh.nb_vertices = 0;
+  CHECK(rbu_static_batch_builder_add(builder, &mesh, NULL), -1);
+  mesh.nb_vertices = 3;
+  mesh.indices = bad_indices;
+  CHECK(rbu_static_batch_builder_add(builder, &mesh, NULL), -1);
+
+  for(i = 0; i < NB_MESHES; ++i) {
+    unsigned int id = 0;
+    setup_mesh(i, vertices, indices, &mesh);
+    CHECK(rbu_static_batch_builder_add(builder, &mesh, &id), 0);
+    CHECK(id, i);
+    nb_indices += mesh.nb_indices;
+  }
+  CHECK(rbu_static_batch_builder_build(builder, &rbi, ctxt, &batch), 0);
+  CHECK(rbu_static_batch_get_vertex_array(batch, &varray), 0);
+  CHECK(varray, vertex_array_list + 0);
+
+  /* Each mesh range addresses the mesh, and the ranges tile the indices. */
+  CHECK(rbu_static_batch_get_mesh_range(batch, NB_MESHES, range_list), -1);
+  for(i = 0; i < NB_MESHES; ++i) {
+    CHECK(rbu_static_batch_get_mesh_range(batch, i, range_list + i), 0);
+    check_range(i, range_list + i);
+  }
+  j = 0;
+  for(group = 0; group < 10 * NB_GROUPS; group += 10) {
+    unsigned int first_index = 0;
+    /* The meshes of a group are contiguous and in their order of addition. */
+    CHECK(rbu_static_batch_get_group_ranges
+      (batch, group, &group_range_list, &nb_ranges), 0);
+    for(i = 0; i < NB_MESHES; ++i) {
+      if(mesh_group(i) != group)
+        continue;
+      CHECK(nb_ranges != 0, 1);
+      if(first_index)
+        CHECK(group_range_list->first_index, first_index);
+      CHECK(memcmp(group_range_list, range_list + i,
+        sizeof(struct rb_draw_range)), 0);
+      first_index = group_range_list->first_index + group_range_list->count;
+      ++group_range_list;
+      --nb_ranges;
+      ++j;
+    }
+    CHECK(nb_ranges, 0);
+  }
+  CHECK(j, NB_MESHES);
+  CHECK(rbu_static_batch_get_group_ranges
+    (batch, 5, &group_range_list, &nb_ranges), 0);
+  CHECK(nb_ranges, 0);
+
+  /* A group is drawn with one call onto the vertex array of the batch. */
+  CHECK(rbu_static_batch_draw_group(batch, ctxt, RB_TRIANGLE_LIST, 10), 0);
+  CHECK(nb_draws, 1);
+  CHECK(bound_vertex_array, varray);
+  CHECK(rbu_static_batch_get_group_ranges
+    (batch, 10, &group_range_list, &nb_ranges), 0);
+  CHECK(nb_draw_ranges, nb_ranges);
+  CHECK(memcmp(draw_range_list, group_range_list,
+    nb_ranges * sizeof(struct rb_draw_range)), 0);
+
+  /* The listed meshes are drawn in the order of the list. */
+  for(i = 0; i < NB_MESHES; ++i)
+    mesh_id_list[i] = NB_MESHES - 1 - i;
+  CHECK(rbu_static_batch_draw_meshes
+    (batch, ctxt, RB_TRIANGLE_LIST, NB_MESHES, mesh_id_list), 0);
+  CHECK(nb_draw_ranges, NB_MESHES);
+  for(i = 0; i < NB_MESHES; ++i) {
+    CHECK(memcmp(draw_range_list + i, range_list + mesh_id_list[i],
+      sizeof(struct rb_draw_range)), 0);
+  }
+  mesh_id_list[0] = NB_MESHES;
+  CHECK(rbu_static_batch_draw_meshes
+    (batch, ctxt, RB_TRIANGLE_LIST, 1, mesh_id_list), -1);
+
+  /* The builder is left unchanged by a build and is empty once cleared. */
+  CHECK(rbu_static_batch_builder_build(builder, &rbi, ctxt, &batch2), 0);
+  CHECK(memcmp(buffer_list[0].data, buffer_list[2].data,
+    sizeof(buffer_list[0].data)), 0);
+  CHECK(memcmp(buffer_list[1].data, buffer_list[3].data,
+    nb_indices * sizeof(unsigned int)), 0);
+  CHECK(rbu_static_batch_ref_put(batch2), 0);
+  CHECK(rbu_static_batch_builder_clear(builder), 0);
+  CHECK(rbu_static_batch_builder_build(builder, &rbi, ctxt, &batch2), -1);
+
+  CHECK(rbu_static_batch_ref_get(batch), 0);
+  CHECK(rbu_static_batch_ref_put(batch), 0);
+  CHECK(rbu_static_batch_ref_put(batch), 0);
+  CHECK(rbu_static_batch_builder_ref_put(builder), 0);
+  for(i = 0; i < (unsigned int)nb_buffers; ++i)
+    CHECK(buffer_list[i].ref, 0);
+  for(i = 0; i < (unsigned int)nb_vertex_arrays; ++i)
+    CHECK(vertex_array_list[i].ref, 0);
+  return 0;
+}
@@ -0,0 +1,91 @@
+#ifndef RB_SOFT_H
+#define RB_SOFT_H
+
+#include "rb.h"
+#include <stddef.h>
+
+/* Limits of the software shaders. */
+#define RB_SOFT_MAX_ATTRIBS 16
+#define RB_SOFT_MAX_VARYINGS 32
+#define RB_SOFT_MAX_OUTPUTS 8
+#define RB_SOFT_MAX_TEXTURE_UNITS 16
+
+struct rb_soft_texture_unit;
+
+/* Execution environment of a shader invocation. */
+struct rb_soft_shader_env {
+  /* Pointers toward the value of the shader uniforms, in the order of their
+   * declaration. */
+  const void* const* uniforms;
+  /* For internal use only. */
+  const struct rb_soft_texture_unit* tex_units;
+};
+
+struct rb_soft_attrib_decl {
+  const char* name;
+  enum rb_type type; /* From RB_FLOAT to RB_FLOAT4. */
+  int location; /* Index of the vertex array attrib that feeds the attrib. */
+};
+
+/* The sampler uniforms are declared with the RB_UNKNOWN_TYPE, i.e. the type
+ * of the GLSL samplers reported by the ogl3 backend, and store the int index
+ * of the texture unit to sample. */
+struct rb_soft_uniform_decl {
+  const char* name;
+  enum rb_type type;
+  unsigned int count; /* Number of array elements. 0 <=> 1. */
+};
+
+/* A shader is defined by C functions in place of GLSL sources. The vertex
+ * function writes the clip space position and the varyings of a vertex. The
+ * attribs are 4 floats, completed with (0, 0, 0, 1). The fragment function
+ * receives the perspective correct varyings and writes one color per output.
+ * It returns 0 to discard the fragment. */
+struct rb_soft_shader_desc {
+  enum rb_shader_type type; /* Vertex or fragment shader. */
+  const struct rb_soft_uniform_decl* uniform_list;
+  size_t nb_uniforms;
+  const struct rb_soft_attrib_decl* attrib_list; /* Vertex shader only. */
+  size_t nb_attribs;
+  unsigned int nb_varyings;
+  unsigned int nb_outputs; /* Fragment shader only. */
+  void (*vertex)
+    (const struct rb_soft_shader_env* env,
+     const float* const attribs[],
+     float position[4],
+     float varyings[]);
+  int (*fragment)
+    (const struct rb_soft_shader_env* env,
+     const float varyings[],
+     float colors[][4]);
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Register the shader functions of the `name' shader. The shader is then
+ * created by the rb_create_shader or rb_shader_source functions whose source
+ * is this name, or by rb_create_shader_variant whose preprocessed source is
+ * this name. The lists and strings of the descriptor are not copied and
+ * must remain valid until the context is released. */
+RB_API int
+rb_soft_register_shader
+  (struct rb_context* ctxt,
+   const char* name,
+   const struct rb_soft_shader_desc* desc);
+
+/* Sample the mip level 0 of the texture bound to `tex_unit' with the filter
+ * and addressing modes of the bound sampler. Must be invoked by a shader. */
+RB_API void
+rb_soft_sample2d
+  (const struct rb_soft_shader_env* env,
+   unsigned int tex_unit,
+   const float uv[2],
+   float rgba[4]);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* RB_SOFT_H */
@@ -0,0 +1,179 @@
+#include "soft/rb_soft_context.h"
+#include "soft/rb_soft_program.h"
+#include "rb.h"
+#include <snlsys/mem_allocator.h>
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct rb_attrib {
+  struct ref ref;
+  struct rb_context* ctxt;
+  struct rb_program* program;
+  const struct rb_soft_attrib_decl* decl; /* Registered declaration. */
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static int
+create_attrib
+  (struct rb_context* ctxt,
+   struct rb_program* program,
+   const struct rb_soft_attrib_decl* decl,
+   struct rb_attrib** out_attrib)
+{
+  struct rb_attrib* attr = NULL;
+  ASSERT(ctxt && program && decl && out_attrib);
+
+  attr = rb_soft_alloc_object
+    (ctxt, RB_OBJECT_ATTRIB, sizeof(struct rb_attrib));
+  if(!attr)
+    return -1;
+  ref_init(&attr->ref);
+  RB(context_ref_get(ctxt));
+  attr->ctxt = ctxt;
+  RB(program_ref_get(program));
+  attr->program = program;
+  attr->decl = decl;
+  *out_attrib = attr;
+  return 0;
+}
+
+static void
+release_attrib(struct ref* ref)
+{
+  struct rb_attrib* attr = NULL;
+  struct rb_context* ctxt = NULL;
+  ASSERT(ref);
+
+  attr = CONTAINER_OF(ref, struct rb_attrib, ref);
+  ctxt = attr->ctxt;
+
+  RB(program_ref_put(attr->program));
+  rb_soft_free_object(ctxt, RB_OBJECT_ATTRIB, attr);
+  RB(context_ref_put(ctxt));
+}
+
+/*******************************************************************************
+ *
+ * Attrib implementation.
+ *
+ ******************************************************************************/
+int
+rb_get_attribs
+  (struct rb_context* ctxt,
+   struct rb_program* prog,
+   size_t* out_nb_attribs,
+   struct rb_attrib* dst_attrib_list[])
+{
+  size_t i = 0;
+
+  if(!ctxt || !prog || !out_nb_attribs)
+    return -1;
+
+  if(!prog->is_linked)
+    return -1;
+
+  if(dst_attrib_list) {
+    for(i = 0; i < prog->vertex->nb_attribs; ++i) {
+      const int err = create_attrib
+        (ctxt, prog, prog->vertex->attrib_list + i, dst_attrib_list + i);
+      if(err != 0)
+        break;
+    }
+    if(i < prog->vertex->nb_attribs) {
+      while(i) {
+        --i;
+        RB(attrib_ref_put(dst_attrib_list[i]));
+        dst_attrib_list[i] = NULL;
+      }
+      *out_nb_attribs = 0;
+      return -1;
+    }
+  }
+  *out_nb_attribs = prog->vertex->nb_attribs;
+  return 0;
+}
+
+int
+rb_get_named_attrib
+  (struct rb_context* ctxt,
+   struct rb_program* prog,
+   const char* name,
+   struct rb_attrib** out_attrib)
+{
+  size_t i = 0;
+
+  if(!ctxt || !prog || !name || !out_attrib)
+    return -1;
+
+  if(!prog->is_linked)
+    return -1;
+
+  for(i = 0; i < prog->vertex->nb_attribs; ++i) {
+    if(!strcmp(prog->vertex->attrib_list[i].name, name))
+      break;
+  }
+  if(i >= prog->vertex->nb_attribs)
+    return -1;
+  return create_attrib(ctxt, prog, prog->vertex->attrib_list + i, out_attrib);
+}
+
+int
+rb_attrib_ref_get(struct rb_attrib* attr)
+{
+  if(!attr)
+    return -1;
+  ref_get(&attr->ref);
+  return 0;
+}
+
+int
+rb_attrib_ref_put(struct rb_attrib* attr)
+{
+  if(!attr)
+    return -1;
+  ref_put(&attr->ref, release_attrib);
+  return 0;
+}
+
+/* As the OpenGL generic vertex attribs, the value is a state of the context
+ * that is used by the attribs that are not fed by the vertex array. */
+int
+rb_attrib_data(struct rb_attrib* attr, const void* data)
+{
+  float* dst = NULL;
+  const float* src = data;
+
+  if(!attr || !data)
+    return -1;
+
+  /* The missing components are set to (0, 0, 0, 1). */
+  dst = attr->ctxt->state.generic_attribs[attr->decl->location];
+  dst[0] = dst[1] = dst[2] = 0.f;
+  dst[3] = 1.f;
+  switch(attr->decl->type) {
+    case RB_FLOAT4: dst[3] = src[3]; /* Fallthrough. */
+    case RB_FLOAT3: dst[2] = src[2]; /* Fallthrough. */
+    case RB_FLOAT2: dst[1] = src[1]; /* Fallthrough. */
+    case RB_FLOAT: dst[0] = src[0]; break;
+    default: ASSERT(0); break;
+  }
+  return 0;
+}
+
+int
+rb_get_attrib_desc(const struct rb_attrib* attr, struct rb_attrib_desc* desc)
+{
+  if(!attr || !desc)
+    return -1;
+
+  desc->name = attr->decl->name;
+  desc->index = attr->decl->location;
+  desc->type = attr->decl->type;
+  return 0;
+}
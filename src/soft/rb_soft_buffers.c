@@ -0,0 +1,144 @@
+#include "soft/rb_soft_buffers.h"
+#include "soft/rb_soft_context.h"
+#include "rb.h"
+#include <snlsys/mem_allocator.h>
+#include <snlsys/snlsys.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static void
+release_buffer(struct ref* ref)
+{
+  struct rb_buffer* buffer = NULL;
+  struct rb_context* ctxt = NULL;
+  ASSERT(ref);
+
+  buffer = CONTAINER_OF(ref, struct rb_buffer, ref);
+  ctxt = buffer->ctxt;
+
+  /* The buffers of a loader context may be bound to the context it shares. */
+  if(ctxt->state.buffer_binding[buffer->target] == buffer)
+    ctxt->state.buffer_binding[buffer->target] = NULL;
+  if(ctxt->share->state.buffer_binding[buffer->target] == buffer)
+    ctxt->share->state.buffer_binding[buffer->target] = NULL;
+  if(buffer->data)
+    MEM_FREE(ctxt->allocator, buffer->data);
+  rb_soft_free_object(ctxt, RB_OBJECT_BUFFER, buffer);
+  RB(context_ref_put(ctxt));
+}
+
+/*******************************************************************************
+ *
+ * Buffer functions.
+ *
+ ******************************************************************************/
+int
+rb_create_buffer
+  (struct rb_context* ctxt,
+   const struct rb_buffer_desc* desc,
+   const void* init_data,
+   struct rb_buffer** out_buffer)
+{
+  struct rb_buffer* buffer = NULL;
+  int err = 0;
+
+  if(!ctxt
+  || !desc
+  || !out_buffer
+  || desc->size > INT_MAX
+  || (desc->target != RB_BIND_VERTEX_BUFFER
+   && desc->target != RB_BIND_INDEX_BUFFER)
+  || (desc->usage == RB_USAGE_IMMUTABLE && init_data == NULL))
+    goto error;
+
+  buffer = rb_soft_alloc_object
+    (ctxt, RB_OBJECT_BUFFER, sizeof(struct rb_buffer));
+  if(!buffer)
+    goto error;
+  ref_init(&buffer->ref);
+  RB(context_ref_get(ctxt));
+  buffer->ctxt = ctxt;
+  buffer->target = desc->target;
+  buffer->usage = desc->usage;
+  buffer->size = (int)desc->size;
+
+  if(desc->size) {
+    buffer->data = MEM_CALLOC(ctxt->allocator, 1, desc->size);
+    if(!buffer->data)
+      goto error;
+    if(init_data)
+      memcpy(buffer->data, init_data, desc->size);
+  }
+
+exit:
+  if(out_buffer)
+    *out_buffer = buffer;
+  return err;
+error:
+  if(buffer) {
+    RB(buffer_ref_put(buffer));
+    buffer = NULL;
+  }
+  err = -1;
+  goto exit;
+}
+
+int
+rb_buffer_ref_get(struct rb_buffer* buffer)
+{
+  if(!buffer)
+    return -1;
+  ref_get(&buffer->ref);
+  return 0;
+}
+
+int
+rb_buffer_ref_put(struct rb_buffer* buffer)
+{
+  if(!buffer)
+    return -1;
+  ref_put(&buffer->ref, release_buffer);
+  return 0;
+}
+
+int
+rb_bind_buffer
+  (struct rb_context* ctxt,
+   struct rb_buffer* buffer,
+   enum rb_buffer_target target)
+{
+  if(!ctxt
+  || (target != RB_BIND_VERTEX_BUFFER && target != RB_BIND_INDEX_BUFFER)
+  || (buffer && buffer->target != target))
+    return -1;
+  ctxt->state.buffer_binding[target] = buffer;
+  return 0;
+}
+
+int
+rb_buffer_data
+  (struct rb_buffer* buffer,
+   int offset,
+   int size,
+   const void* data)
+{
+  if(!buffer
+  || (offset < 0)
+  || (size < 0)
+  || (size != 0 && !data)
+  || (buffer->size < offset + size))
+    return -1;
+
+  if(size == 0)
+    return 0;
+  /* The draw calls are synchronous and thus the buffer can be updated in
+   * place. */
+  memcpy(buffer->data + offset, data, (size_t)size);
+  return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef RB_SOFT_BUFFERS_H
+#define RB_SOFT_BUFFERS_H
+
+#include "rb_types.h"
+#include <snlsys/ref_count.h>
+
+struct rb_context;
+
+struct rb_buffer {
+  struct ref ref;
+  struct rb_context* ctxt;
+  enum rb_buffer_target target;
+  enum rb_usage usage;
+  int size;
+  unsigned char* data;
+};
+
+#endif /* RB_SOFT_BUFFERS_H */
@@ -0,0 +1,283 @@
+#define _POSIX_C_SOURCE 200112L /* sysconf */
+
+#include "common/rb_thread_pool.h"
+#include "soft/rb_soft_context.h"
+#include "soft/rb_soft_raster.h"
+#include "rb.h"
+#include <snlsys/mem_allocator.h>
+#include <snlsys/snlsys.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_NB_THREADS 256
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+/* The number of rasterization threads is the number of online processors. It
+ * can be overridden by the RB_SOFT_NB_THREADS environment variable. */
+static unsigned int
+get_nb_threads(void)
+{
+  const char* str = getenv("RB_SOFT_NB_THREADS");
+  long nb = 0;
+
+  if(str)
+    nb = strtol(str, NULL, 10);
+  if(nb <= 0)
+    nb = sysconf(_SC_NPROCESSORS_ONLN);
+  if(nb <= 0)
+    nb = 1;
+  return nb > MAX_NB_THREADS ? MAX_NB_THREADS : (unsigned int)nb;
+}
+
+static void
+setup_default_state(struct rb_context* ctxt)
+{
+  const struct rb_stencil_op_desc stencil_op = {
+    .stencil_fail = RB_STENCIL_OP_KEEP,
+    .depth_fail = RB_STENCIL_OP_KEEP,
+    .depth_pass = RB_STENCIL_OP_KEEP,
+    .stencil_func = RB_COMPARISON_ALWAYS,
+    .write_mask = ~0u
+  };
+  int i = 0;
+  ASSERT(ctxt);
+
+  /* Default state of an OpenGL context. */
+  memset(&ctxt->state, 0, sizeof(struct state));
+  ctxt->state.viewport.max_depth = 1.f;
+  ctxt->state.blend.src_blend_RGB = RB_BLEND_ONE;
+  ctxt->state.blend.src_blend_Alpha = RB_BLEND_ONE;
+  ctxt->state.blend.dst_blend_RGB = RB_BLEND_ZERO;
+  ctxt->state.blend.dst_blend_Alpha = RB_BLEND_ZERO;
+  ctxt->state.blend.blend_op_RGB = RB_BLEND_OP_ADD;
+  ctxt->state.blend.blend_op_Alpha = RB_BLEND_OP_ADD;
+  ctxt->state.depth_stencil.enable_depth_write = 1;
+  ctxt->state.depth_stencil.depth_func = RB_COMPARISON_LESS;
+  ctxt->state.depth_stencil.front_face_op = stencil_op;
+  ctxt->state.depth_stencil.back_face_op = stencil_op;
+  ctxt->state.rasterizer.fill_mode = RB_FILL_SOLID;
+  ctxt->state.rasterizer.cull_mode = RB_CULL_NONE;
+  ctxt->state.rasterizer.front_facing = RB_ORIENTATION_CCW;
+  for(i = 0; i < RB_SOFT_MAX_ATTRIBS; ++i)
+    ctxt->state.generic_attribs[i][3] = 1.f;
+}
+
+static void
+release_context(struct ref* ref)
+{
+  struct list_node* node = NULL;
+  struct list_node* tmp = NULL;
+  struct rb_context* ctxt = NULL;
+  int i = 0;
+  ASSERT(ref);
+
+  ctxt = CONTAINER_OF(ref, struct rb_context, ref);
+  LIST_FOR_EACH_SAFE(node, tmp, &ctxt->shader_registry) {
+    struct rb_soft_registered_shader* shader = CONTAINER_OF
+      (node, struct rb_soft_registered_shader, node);
+    list_del(node);
+    MEM_FREE(ctxt->allocator, shader);
+  }
+  rb_release_variant_cache(&ctxt->variant_cache);
+  if(ctxt->raster)
+    rb_soft_release_raster(ctxt, ctxt->raster);
+  if(ctxt->pool)
+    rb_release_thread_pool(ctxt->pool);
+  rb_soft_release_surface(ctxt, &ctxt->default_color);
+  rb_soft_release_surface(ctxt, &ctxt->default_depth_stencil);
+  /* The objects reference their context and are thus already released. */
+  for(i = 0; i < RB_OBJECT_TYPES_COUNT; ++i)
+    rb_release_slab(ctxt->pool_list + i);
+  rb_release_string_arena(&ctxt->names);
+  rb_release_arena(&ctxt->frame);
+  if(ctxt->share != ctxt)
+    RB(context_ref_put(ctxt->share));
+  MEM_FREE(ctxt->allocator, ctxt);
+}
+
+static int
+create_context
+  (struct mem_allocator* specific_allocator,
+   unsigned int nb_threads,
+   struct rb_context** out_ctxt)
+{
+  struct mem_allocator* allocator = NULL;
+  struct rb_context* ctxt = NULL;
+  int err = 0;
+  ASSERT(nb_threads && out_ctxt);
+
+  allocator = specific_allocator ? specific_allocator : &mem_default_allocator;
+  ctxt = MEM_CALLOC(allocator, 1, sizeof(struct rb_context));
+  if(!ctxt)
+    goto error;
+  ctxt->allocator = allocator;
+  ctxt->share = ctxt;
+  ref_init(&ctxt->ref);
+  list_init(&ctxt->shader_registry);
+  rb_init_variant_cache(allocator, &ctxt->variant_cache);
+  rb_init_string_arena(allocator, &ctxt->names);
+  rb_init_arena(allocator, &ctxt->frame);
+
+  ctxt->config.max_tex_size = RB_SOFT_MAX_VIEWPORT_DIM;
+  /* The anisotropic filtering is accepted but not performed. */
+  ctxt->config.max_tex_max_anisotropy = 16;
+  ctxt->error_check.mode = RB_ERROR_CHECK_NONE;
+  setup_default_state(ctxt);
+
+  if(rb_create_thread_pool(allocator, nb_threads, &ctxt->pool) != 0)
+    goto error;
+  if(rb_soft_create_raster(ctxt, &ctxt->raster) != 0)
+    goto error;
+
+exit:
+  if(ctxt)
+    *out_ctxt = ctxt;
+  return err;
+
+error:
+  if(ctxt) {
+    RB(context_ref_put(ctxt));
+    ctxt = NULL;
+  }
+  err = -1;
+  goto exit;
+}
+
+/*******************************************************************************
+ *
+ * Render backend context functions.
+ *
+ ******************************************************************************/
+int
+rb_create_context
+  (struct mem_allocator* allocator,
+   struct rb_context** out_ctxt)
+{
+  if(!out_ctxt)
+    return -1;
+  return create_context(allocator, get_nb_threads(), out_ctxt);
+}
+
+int
+rb_create_headless_context
+  (struct mem_allocator* allocator,
+   const struct rb_headless_desc* desc,
+   struct rb_context** out_ctxt)
+{
+  struct rb_context* ctxt = NULL;
+  int err = 0;
+
+  if(!desc
+  || !desc->width
+  || !desc->height
+  || desc->width > RB_SOFT_MAX_VIEWPORT_DIM
+  || desc->height > RB_SOFT_MAX_VIEWPORT_DIM
+  || !out_ctxt)
+    goto error;
+
+  if(rb_create_context(allocator, &ctxt) != 0)
+    goto error;
+
+  /* The context owns its default framebuffer. */
+  err = rb_soft_init_surface
+    (ctxt, &ctxt->default_color, desc->width, desc->height, RB_RGBA);
+  if(err != 0)
+    goto error;
+  err = rb_soft_init_surface
+    (ctxt, &ctxt->default_depth_stencil, desc->width, desc->height,
+     RB_DEPTH_STENCIL);
+  if(err != 0)
+    goto error;
+  ctxt->state.viewport.width = (int)desc->width;
+  ctxt->state.viewport.height = (int)desc->height;
+
+exit:
+  if(ctxt)
+    *out_ctxt = ctxt;
+  return err;
+
+error:
+  if(ctxt) {
+    RB(context_ref_put(ctxt));
+    ctxt = NULL;
+  }
+  err = -1;
+  goto exit;
+}
+
+int
+rb_create_loader_context
+  (struct rb_context* ctxt,
+   struct rb_context** out_loader)
+{
+  struct rb_context* loader = NULL;
+
+  if(!ctxt || !out_loader)
+    return -1;
+  /* The loader is not expected to render and thus uses a single thread. */
+  if(create_context(ctxt->allocator, 1, &loader) != 0)
+    return -1;
+  /* The loader keeps alive the context whose objects it shares. */
+  RB(context_ref_get(ctxt->share));
+  loader->share = ctxt->share;
+  *out_loader = loader;
+  return 0;
+}
+
+int
+rb_context_ref_get(struct rb_context* ctxt)
+{
+  if(!ctxt)
+    return -1;
+  ref_get(&ctxt->ref);
+  return 0;
+}
+
+int
+rb_context_ref_put(struct rb_context* ctxt)
+{
+  if(!ctxt)
+    return -1;
+  ref_put(&ctxt->ref, release_context);
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+int
+rb_soft_set_log(struct rb_context* ctxt, char** log, const char* fmt, ...)
+{
+  va_list vargs;
+  char* str = NULL;
+  int len = 0;
+  ASSERT(ctxt && log && fmt);
+
+  va_start(vargs, fmt);
+  len = vsnprintf(NULL, 0, fmt, vargs);
+  va_end(vargs);
+  if(len < 0)
+    return -1;
+
+  str = MEM_REALLOC(ctxt->allocator, *log, (size_t)len + 1);
+  if(!str)
+    return -1;
+  *log = str;
+
+  va_start(vargs, fmt);
+  vsnprintf(*log, (size_t)len + 1, fmt, vargs);
+  va_end(vargs);
+#ifndef NDEBUG
+  fprintf(stderr, "%s\n", *log);
+#endif
+  return 0;
+}
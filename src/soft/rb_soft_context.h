@@ -0,0 +1,111 @@
+#ifndef RB_SOFT_CONTEXT_H
+#define RB_SOFT_CONTEXT_H
+
+#include "common/rb_pool.h"
+#include "common/rb_shader_variant.h"
+#include "soft/rb_soft.h"
+#include "soft/rb_soft_texture.h"
+#include <snlsys/list.h>
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+
+#define RB_SOFT_MAX_COLOR_ATTACHMENTS 8
+#define RB_SOFT_MAX_VIEWPORT_DIM 8192
+#define RB_SOFT_NB_BUFFER_TARGETS 2
+
+struct mem_allocator;
+struct rb_thread_pool;
+struct rb_soft_raster;
+
+struct rb_soft_texture_unit {
+  struct rb_tex2d* tex;
+  struct rb_sampler* sampler;
+};
+
+/* Shader functions registered against a source name. */
+struct rb_soft_registered_shader {
+  struct list_node node;
+  const char* name; /* Interned into the context. */
+  struct rb_soft_shader_desc desc;
+};
+
+struct rb_context {
+  struct ref ref;
+  struct mem_allocator* allocator;
+  /* Context whose buffers and textures are shared, i.e. the context from
+   * which a loader context is created, or the context itself. */
+  struct rb_context* share;
+  struct rb_config config;
+  struct rb_error_check_desc error_check;
+  struct rb_compile_desc compile;
+  struct list_node shader_registry;
+  struct rb_variant_cache variant_cache; /* Shared shader variants. */
+  /* Object slabs, initialised on the first allocation of their type. */
+  struct rb_slab pool_list[RB_OBJECT_TYPES_COUNT];
+  struct rb_string_arena names; /* Names of the registered shaders. */
+  /* Transient data released at the end of frame. The backend also allocates
+   * its scratch memory from it and rolls it back once done. */
+  struct rb_arena frame;
+  int is_in_frame;
+  /* Render targets of the default framebuffer. Their data is NULL if the
+   * context does not own a default framebuffer. */
+  struct rb_soft_surface default_color;
+  struct rb_soft_surface default_depth_stencil;
+  struct rb_thread_pool* pool;
+  struct rb_soft_raster* raster;
+  /* Pipeline state. The bound objects are not referenced: they are unbound
+   * on their release. */
+  struct state {
+    struct rb_viewport_desc viewport;
+    struct rb_blend_desc blend;
+    struct rb_depth_stencil_desc depth_stencil;
+    struct rb_rasterizer_desc rasterizer;
+    struct rb_program* program;
+    struct rb_vertex_array* vertex_array;
+    struct rb_framebuffer* framebuffer;
+    struct rb_buffer* buffer_binding[RB_SOFT_NB_BUFFER_TARGETS];
+    struct rb_soft_texture_unit tex_units[RB_SOFT_MAX_TEXTURE_UNITS];
+    float generic_attribs[RB_SOFT_MAX_ATTRIBS][4];
+  } state;
+};
+
+/* Return a zeroed object of `size' bytes allocated from the slab of `type'. */
+static FINLINE void*
+rb_soft_alloc_object
+  (struct rb_context* ctxt,
+   enum rb_object_type type,
+   size_t size)
+{
+  struct rb_slab* slab = NULL;
+  ASSERT(ctxt && type < RB_OBJECT_TYPES_COUNT && size);
+
+  slab = ctxt->pool_list + type;
+  if(!slab->slot_size)
+    rb_init_slab(ctxt->allocator, size, slab);
+  ASSERT(size <= slab->slot_size);
+  return rb_slab_alloc(slab);
+}
+
+static FINLINE void
+rb_soft_free_object
+  (struct rb_context* ctxt,
+   enum rb_object_type type,
+   void* object)
+{
+  ASSERT(ctxt && type < RB_OBJECT_TYPES_COUNT);
+  rb_slab_free(ctxt->pool_list + type, object);
+}
+
+/* Printf-like formatting of an object log. */
+LOCAL_SYM int
+rb_soft_set_log
+  (struct rb_context* ctxt,
+   char** log,
+   const char* fmt,
+   ...)
+#ifdef __GNUC__
+  __attribute__((format(printf, 3, 4)))
+#endif
+;
+
+#endif /* RB_SOFT_CONTEXT_H */
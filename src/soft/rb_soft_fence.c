@@ -0,0 +1,89 @@
+#include "soft/rb_soft_context.h"
+#include "rb.h"
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+
+/* The uploads and the draws complete before their function returns: a fence
+ * is thus signaled as soon as it is created. */
+struct rb_fence {
+  struct ref ref;
+  struct rb_context* ctxt;
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static void
+release_fence(struct ref* ref)
+{
+  struct rb_fence* fence = NULL;
+  struct rb_context* ctxt = NULL;
+  ASSERT(ref);
+
+  fence = CONTAINER_OF(ref, struct rb_fence, ref);
+  ctxt = fence->ctxt;
+  rb_soft_free_object(ctxt, RB_OBJECT_FENCE, fence);
+  RB(context_ref_put(ctxt));
+}
+
+/*******************************************************************************
+ *
+ * Fence functions.
+ *
+ ******************************************************************************/
+int
+rb_create_fence(struct rb_context* ctxt, struct rb_fence** out_fence)
+{
+  struct rb_fence* fence = NULL;
+
+  if(!ctxt || !out_fence)
+    return -1;
+  fence = rb_soft_alloc_object(ctxt, RB_OBJECT_FENCE, sizeof(struct rb_fence));
+  if(!fence)
+    return -1;
+  ref_init(&fence->ref);
+  RB(context_ref_get(ctxt));
+  fence->ctxt = ctxt;
+  *out_fence = fence;
+  return 0;
+}
+
+int
+rb_fence_ref_get(struct rb_fence* fence)
+{
+  if(!fence)
+    return -1;
+  ref_get(&fence->ref);
+  return 0;
+}
+
+int
+rb_fence_ref_put(struct rb_fence* fence)
+{
+  if(!fence)
+    return -1;
+  ref_put(&fence->ref, release_fence);
+  return 0;
+}
+
+int
+rb_wait_fence(struct rb_context* ctxt, struct rb_fence* fence)
+{
+  if(!ctxt || !fence || fence->ctxt->share != ctxt->share)
+    return -1;
+  return 0;
+}
+
+int
+rb_poll_fence
+  (struct rb_context* ctxt,
+   struct rb_fence* fence,
+   int* is_signaled)
+{
+  if(!ctxt || !fence || !is_signaled || fence->ctxt->share != ctxt->share)
+    return -1;
+  *is_signaled = 1;
+  return 0;
+}
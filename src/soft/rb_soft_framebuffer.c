@@ -0,0 +1,323 @@
+#include "soft/rb_soft_context.h"
+#include "soft/rb_soft_framebuffer.h"
+#include "soft/rb_soft_texture.h"
+#include "rb.h"
+#include <snlsys/math.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+#include <stdint.h>
+#include <string.h>
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+/* Release the render target resource if it exists. */
+static void
+release_render_target_resource(struct rb_render_target* rt)
+{
+  ASSERT(rt);
+  if(rt->resource == NULL)
+    return;
+  switch(rt->type) {
+    case RB_RENDER_TARGET_TEXTURE2D:
+      RB(tex2d_ref_put((struct rb_tex2d*)rt->resource));
+      break;
+    default: ASSERT(0); break;
+  }
+  memset(rt, 0, sizeof(struct rb_render_target));
+}
+
+static int
+is_render_target_valid
+  (const struct rb_framebuffer* buffer,
+   int attachment, /* < 0 <=> depth stencil. */
+   const struct rb_render_target* render_target)
+{
+  const struct rb_tex2d* tex2d = NULL;
+  unsigned int mip = 0;
+  ASSERT(buffer && render_target);
+
+  if(render_target->type != RB_RENDER_TARGET_TEXTURE2D)
+    return 0;
+  tex2d = render_target->resource;
+  if(!tex2d) /* Detach the render target. */
+    return 1;
+  mip = render_target->desc.tex2d.mip_level;
+  return mip < tex2d->mip_count
+      && tex2d->mip_list[mip].width == buffer->desc.width
+      && tex2d->mip_list[mip].height == buffer->desc.height
+      && (attachment < 0) == rb_soft_is_depth_format(tex2d->mip_list[0].format);
+}
+
+static void
+attach_render_target
+  (struct rb_framebuffer* buffer,
+   int attachment, /* < 0 <=> depth stencil. */
+   const struct rb_render_target* render_target)
+{
+  struct rb_render_target* rt = NULL;
+  ASSERT
+    (  buffer
+    && (attachment < 0 || (unsigned int)attachment < buffer->desc.buffer_count)
+    && render_target);
+
+  rt = attachment < 0
+    ? &buffer->depth_stencil : buffer->render_target_list + attachment;
+  if(render_target->resource)
+    RB(tex2d_ref_get((struct rb_tex2d*)render_target->resource));
+  release_render_target_resource(rt);
+  memcpy(rt, render_target, sizeof(struct rb_render_target));
+}
+
+static void
+release_framebuffer(struct ref* ref)
+{
+  struct rb_context* ctxt  = NULL;
+  struct rb_framebuffer* buffer = NULL;
+  unsigned int i = 0;
+  ASSERT(ref);
+
+  buffer = CONTAINER_OF(ref, struct rb_framebuffer, ref);
+  ctxt = buffer->ctxt;
+
+  if(ctxt->state.framebuffer == buffer)
+    RB(bind_framebuffer(ctxt, NULL));
+
+  release_render_target_resource(&buffer->depth_stencil);
+  for(i = 0; i < buffer->desc.buffer_count; ++i) {
+    release_render_target_resource(buffer->render_target_list + i);
+  }
+  rb_soft_free_object(ctxt, RB_OBJECT_FRAMEBUFFER, buffer);
+  RB(context_ref_put(ctxt));
+}
+
+/*******************************************************************************
+ *
+ * Framebuffer functions.
+ *
+ ******************************************************************************/
+int
+rb_create_framebuffer
+  (struct rb_context* ctxt,
+    const struct rb_framebuffer_desc* desc,
+    struct rb_framebuffer** out_buffer)
+{
+  struct rb_framebuffer* buffer = NULL;
+
+  if(UNLIKELY(!ctxt || !desc || !out_buffer))
+    return -1;
+  if(desc->buffer_count > RB_SOFT_MAX_COLOR_ATTACHMENTS)
+    return -1;
+  /* Multisampled framebuffer are not supported. */
+  if(desc->sample_count > 1)
+    return -1;
+
+  buffer = rb_soft_alloc_object
+    (ctxt, RB_OBJECT_FRAMEBUFFER, sizeof(struct rb_framebuffer));
+  if(!buffer)
+    return -1;
+  ref_init(&buffer->ref);
+  RB(context_ref_get(ctxt));
+  buffer->ctxt = ctxt;
+  memcpy(&buffer->desc, desc, sizeof(struct rb_framebuffer_desc));
+  *out_buffer = buffer;
+  return 0;
+}
+
+int
+rb_framebuffer_ref_get(struct rb_framebuffer* buffer)
+{
+  if(UNLIKELY(!buffer))
+    return -1;
+  ref_get(&buffer->ref);
+  return 0;
+}
+
+int
+rb_framebuffer_ref_put(struct rb_framebuffer* buffer)
+{
+  if(UNLIKELY(!buffer))
+    return -1;
+  ref_put(&buffer->ref, release_framebuffer);
+  return 0;
+}
+
+int
+rb_bind_framebuffer
+  (struct rb_context* ctxt,
+   struct rb_framebuffer* buffer)
+{
+  if(UNLIKELY(!ctxt))
+    return -1;
+  ctxt->state.framebuffer = buffer;
+  return 0;
+}
+
+int
+rb_framebuffer_render_targets
+  (struct rb_framebuffer* buffer,
+   unsigned int count,
+   const struct rb_render_target render_target_list[],
+   const struct rb_render_target* depth_stencil)
+{
+  unsigned int i = 0;
+
+  if(UNLIKELY
+  (  !buffer
+  || (count && !render_target_list)
+  || count > buffer->desc.buffer_count))
+    return -1;
+
+  /* Validate the render targets before their attachment in order to keep the
+   * framebuffer unchanged on error. */
+  if(depth_stencil && !is_render_target_valid(buffer, -1, depth_stencil))
+    return -1;
+  for(i = 0; i < count; ++i) {
+    if(!is_render_target_valid(buffer, (int)i, render_target_list + i))
+      return -1;
+  }
+
+  if(depth_stencil)
+    attach_render_target(buffer, -1, depth_stencil);
+  for(i = 0; i < count; ++i)
+    attach_render_target(buffer, (int)i, render_target_list + i);
+  return 0;
+}
+
+int
+rb_read_back_framebuffer
+  (struct rb_framebuffer* buffer,
+   int rt_id,
+   size_t x,
+   size_t y,
+   size_t width,
+   size_t height,
+   size_t* read_size,
+   void* read_data)
+{
+  const struct rb_soft_surface* surface = NULL;
+  size_t row_size = 0;
+  size_t nb_rows = 0;
+  size_t i = 0;
+
+  if(UNLIKELY
+  (  !buffer
+  || (rt_id >= 0 && (unsigned int)rt_id >= buffer->desc.buffer_count)))
+    return -1;
+
+  surface = rb_soft_render_target_surface
+    (rt_id >= 0 ? buffer->render_target_list + rt_id : &buffer->depth_stencil);
+  if(!surface)
+    return -1;
+
+  /* Map the (x, y) coordinates of the upper left corner of the read region
+   * from 'upper left' origin to OpenGL convention (bottom left) */
+  y = buffer->desc.height < y + height ? 0 : buffer->desc.height - y - height;
+
+  if(read_size)
+    *read_size = width * height * surface->pixel_size;
+  if(read_data && x < surface->width) {
+    /* The pixels out of the render target are not written. */
+    row_size = MIN(width, surface->width - x) * surface->pixel_size;
+    nb_rows = y < surface->height ? MIN(height, surface->height - y) : 0;
+    for(i = 0; i < nb_rows; ++i) {
+      memcpy
+        ((unsigned char*)read_data + i * width * surface->pixel_size,
+         surface->data + ((y+i) * surface->width + x) * surface->pixel_size,
+         row_size);
+    }
+  }
+  return 0;
+}
+
+int
+rb_clear_framebuffer_render_targets
+  (struct rb_framebuffer* buffer,
+   int clear_flag,
+   unsigned int count,
+   const struct rb_clear_framebuffer_color_desc* color_vals,
+   float depth_val,
+   char stencil_val)
+{
+  struct rb_soft_surface* surface = NULL;
+  unsigned char pixel[16];
+  int depth_stencil_flag = 0;
+  unsigned int i = 0;
+
+  if(UNLIKELY(!buffer))
+    return -1;
+
+  /* Clear the color render targets. */
+  if((clear_flag & RB_CLEAR_COLOR_BIT) != 0) {
+    if(UNLIKELY(count && !color_vals))
+      return -1;
+    for(i = 0; i < count; ++i) {
+      if(UNLIKELY(color_vals[i].index >= buffer->desc.buffer_count))
+        return -1;
+      surface = rb_soft_render_target_surface
+        (buffer->render_target_list + color_vals[i].index);
+      if(!surface)
+        continue;
+      if(rb_soft_is_uint_format(surface->format)) {
+        memcpy(pixel, color_vals[i].val.rgba_ui32, surface->pixel_size);
+      } else {
+        rb_soft_encode_color(surface->format, color_vals[i].val.rgba_f, pixel);
+      }
+      rb_soft_fill_surface(surface, pixel);
+    }
+  }
+
+  /* Clear the depth stencil render target. */
+  depth_stencil_flag = clear_flag & (RB_CLEAR_DEPTH_BIT | RB_CLEAR_STENCIL_BIT);
+  if(depth_stencil_flag != 0) {
+    surface = rb_soft_render_target_surface(&buffer->depth_stencil);
+    if(!surface)
+      return -1;
+
+    if(depth_stencil_flag == RB_CLEAR_DEPTH_BIT) {
+      if(UNLIKELY(surface->format != RB_DEPTH_COMPONENT))
+        return -1;
+      rb_soft_fill_surface(surface, &depth_val);
+    } else if(depth_stencil_flag == RB_CLEAR_STENCIL_BIT) {
+      uint32_t* data = (uint32_t*)surface->data;
+      const size_t nb = (size_t)surface->width * surface->height;
+      size_t j = 0;
+      if(UNLIKELY(surface->format != RB_DEPTH_STENCIL))
+        return -1;
+      for(j = 0; j < nb; ++j)
+        data[j] = (data[j] & ~0xFFu) | (uint32_t)(unsigned char)stencil_val;
+    } else { /* depth_stencil_flag == RB_CLEAR_DEPTH_BIT|RB_CLEAR_STENCIL_BIT */
+      uint32_t val = 0;
+      if(UNLIKELY(surface->format != RB_DEPTH_STENCIL))
+        return -1;
+      val = rb_soft_encode_depth24(depth_val)
+          | (uint32_t)(unsigned char)stencil_val;
+      rb_soft_fill_surface(surface, &val);
+    }
+  }
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+struct rb_soft_surface*
+rb_soft_render_target_surface(const struct rb_render_target* rt)
+{
+  struct rb_tex2d* tex2d = NULL;
+  ASSERT(rt);
+
+  if(!rt->resource)
+    return NULL;
+  switch(rt->type) {
+    case RB_RENDER_TARGET_TEXTURE2D:
+      tex2d = rt->resource;
+      return tex2d->mip_list + rt->desc.tex2d.mip_level;
+    default: ASSERT(0); return NULL;
+  }
+}
@@ -0,0 +1,27 @@
+#ifndef RB_SOFT_FRAMEBUFFER_H
+#define RB_SOFT_FRAMEBUFFER_H
+
+#include "soft/rb_soft_context.h"
+#include "rb_types.h"
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+
+struct rb_context;
+struct rb_soft_surface;
+
+struct rb_framebuffer {
+  struct ref ref;
+  struct rb_framebuffer_desc desc;
+  struct rb_context* ctxt;
+  struct rb_render_target depth_stencil;
+  /* Fixed size in order to allocate the framebuffers from a slab. */
+  struct rb_render_target render_target_list[RB_SOFT_MAX_COLOR_ATTACHMENTS];
+};
+
+/* Return the surface of the render target or NULL if no resource is
+ * attached. */
+LOCAL_SYM struct rb_soft_surface*
+rb_soft_render_target_surface
+  (const struct rb_render_target* rt);
+
+#endif /* RB_SOFT_FRAMEBUFFER_H */
@@ -0,0 +1,281 @@
+#include "soft/rb_soft_context.h"
+#include "soft/rb_soft_framebuffer.h"
+#include "soft/rb_soft_raster.h"
+#include "soft/rb_soft_texture.h"
+#include "rb.h"
+#include <snlsys/math.h>
+#include <snlsys/snlsys.h>
+#include <stdint.h>
+#include <string.h>
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static void
+clear_depth_stencil
+  (struct rb_soft_surface* surface,
+   int flag,
+   float depth,
+   char stencil)
+{
+  uint32_t* data = NULL;
+  uint32_t mask = 0;
+  uint32_t val = 0;
+  size_t nb = 0;
+  size_t i = 0;
+  ASSERT(surface);
+
+  if(surface->format == RB_DEPTH_COMPONENT) {
+    if((flag & RB_CLEAR_DEPTH_BIT) != 0)
+      rb_soft_fill_surface(surface, &depth);
+    return;
+  }
+  ASSERT(surface->format == RB_DEPTH_STENCIL);
+  if((flag & RB_CLEAR_DEPTH_BIT) != 0) {
+    mask |= ~0xFFu;
+    val |= rb_soft_encode_depth24(depth);
+  }
+  if((flag & RB_CLEAR_STENCIL_BIT) != 0) {
+    mask |= 0xFFu;
+    val |= (uint32_t)(unsigned char)stencil;
+  }
+  if(mask == ~0u) {
+    rb_soft_fill_surface(surface, &val);
+  } else if(mask) {
+    data = (uint32_t*)surface->data;
+    nb = (size_t)surface->width * surface->height;
+    for(i = 0; i < nb; ++i)
+      data[i] = (data[i] & ~mask) | val;
+  }
+}
+
+/*******************************************************************************
+ *
+ * Miscellaneous functions.
+ *
+ ******************************************************************************/
+int
+rb_draw_indexed
+  (struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int count)
+{
+  struct rb_draw_range range;
+
+  if(!ctxt)
+    return -1;
+  range.first_index = 0;
+  range.count = count;
+  range.base_vertex = 0;
+  return rb_soft_draw(ctxt, prim_type, &range, 1);
+}
+
+int
+rb_multi_draw_indexed
+  (struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int nb_ranges,
+   const struct rb_draw_range* range_list)
+{
+  unsigned int i = 0;
+  int err = 0;
+
+  if(!ctxt || (nb_ranges && !range_list))
+    return -1;
+  for(i = 0; i < nb_ranges; ++i) {
+    if(rb_soft_draw(ctxt, prim_type, range_list + i, 1) != 0)
+      err = -1;
+  }
+  return err;
+}
+
+int
+rb_draw
+  (struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int count)
+{
+  struct rb_draw_range range;
+
+  if(!ctxt)
+    return -1;
+  range.first_index = 0;
+  range.count = count;
+  range.base_vertex = 0;
+  return rb_soft_draw(ctxt, prim_type, &range, 0);
+}
+
+/* Clear the render targets of the bound framebuffer. */
+int
+rb_clear
+  (struct rb_context* ctxt,
+   int flag,
+   const float color[4],
+   float depth,
+   char stencil)
+{
+  struct rb_framebuffer* buffer = NULL;
+  struct rb_soft_surface* surface = NULL;
+  unsigned char pixel[16];
+  unsigned int i = 0;
+
+  if(!ctxt)
+    return -1;
+  if((flag & RB_CLEAR_COLOR_BIT) != 0 && !color)
+    return -1;
+
+  buffer = ctxt->state.framebuffer;
+  if((flag & RB_CLEAR_COLOR_BIT) != 0) {
+    const unsigned int count = buffer ? buffer->desc.buffer_count : 1;
+    for(i = 0; i < count; ++i) {
+      surface = buffer
+        ? rb_soft_render_target_surface(buffer->render_target_list + i)
+        : &ctxt->default_color;
+      if(!surface || !surface->data)
+        continue;
+      rb_soft_encode_color(surface->format, color, pixel);
+      rb_soft_fill_surface(surface, pixel);
+    }
+  }
+  if((flag & (RB_CLEAR_DEPTH_BIT | RB_CLEAR_STENCIL_BIT)) != 0) {
+    surface = buffer
+      ? rb_soft_render_target_surface(&buffer->depth_stencil)
+      : &ctxt->default_depth_stencil;
+    if(surface && surface->data)
+      clear_depth_stencil(surface, flag, depth, stencil);
+  }
+  return 0;
+}
+
+/* The draw calls are synchronous and thus there is nothing to flush. */
+int
+rb_flush(struct rb_context* ctxt)
+{
+  if(!ctxt)
+    return -1;
+  return 0;
+}
+
+int
+rb_begin_frame(struct rb_context* ctxt)
+{
+  if(!ctxt || ctxt->is_in_frame)
+    return -1;
+  ctxt->is_in_frame = 1;
+  return 0;
+}
+
+int
+rb_end_frame(struct rb_context* ctxt)
+{
+  if(!ctxt || !ctxt->is_in_frame)
+    return -1;
+  rb_reset_arena(&ctxt->frame);
+  ctxt->is_in_frame = 0;
+  return 0;
+}
+
+int
+rb_frame_alloc(struct rb_context* ctxt, size_t size, void** out_mem)
+{
+  void* mem = NULL;
+
+  if(!ctxt || !size || !out_mem || !ctxt->is_in_frame)
+    return -1;
+  mem = rb_arena_alloc(&ctxt->frame, size);
+  if(!mem)
+    return -1;
+  *out_mem = mem;
+  return 0;
+}
+
+int
+rb_viewport(struct rb_context* ctxt, const struct rb_viewport_desc* vp)
+{
+  if(!ctxt || !vp || vp->width < 0 || vp->height < 0)
+    return -1;
+
+  /* Clamp the viewport as the OpenGL implementations do with their maximum
+   * viewport dimensions. */
+  ctxt->state.viewport.x = MIN(MAX(vp->x, -RB_SOFT_MAX_VIEWPORT_DIM),
+    RB_SOFT_MAX_VIEWPORT_DIM);
+  ctxt->state.viewport.y = MIN(MAX(vp->y, -RB_SOFT_MAX_VIEWPORT_DIM),
+    RB_SOFT_MAX_VIEWPORT_DIM);
+  ctxt->state.viewport.width = MIN(vp->width, RB_SOFT_MAX_VIEWPORT_DIM);
+  ctxt->state.viewport.height = MIN(vp->height, RB_SOFT_MAX_VIEWPORT_DIM);
+  ctxt->state.viewport.min_depth = MIN(MAX(vp->min_depth, 0.f), 1.f);
+  ctxt->state.viewport.max_depth = MIN(MAX(vp->max_depth, 0.f), 1.f);
+  return 0;
+}
+
+int
+rb_blend(struct rb_context* ctxt, const struct rb_blend_desc* blend)
+{
+  if(!ctxt || !blend)
+    return -1;
+  ctxt->state.blend = *blend;
+  return 0;
+}
+
+int
+rb_depth_stencil
+  (struct rb_context* ctxt, const struct rb_depth_stencil_desc* desc)
+{
+  if(!ctxt || !desc)
+    return -1;
+  ctxt->state.depth_stencil = *desc;
+  return 0;
+}
+
+int
+rb_rasterizer(struct rb_context* ctxt, const struct rb_rasterizer_desc* desc)
+{
+  if(!ctxt || !desc)
+    return -1;
+  ctxt->state.rasterizer = *desc;
+  return 0;
+}
+
+int
+rb_get_config(struct rb_context* ctxt, struct rb_config* config)
+{
+  if(!ctxt || !config)
+    return -1;
+  memcpy(config, &ctxt->config, sizeof(struct rb_config));
+  return 0;
+}
+
+int
+rb_get_pool_stats(struct rb_context* ctxt, struct rb_pool_stats* stats)
+{
+  int i = 0;
+
+  if(!ctxt || !stats)
+    return -1;
+  for(i = 0; i < RB_OBJECT_TYPES_COUNT; ++i)
+    rb_slab_stats(ctxt->pool_list + i, stats->object_list + i);
+  stats->nb_strings = ctxt->names.nb_strings;
+  stats->string_size = ctxt->names.size;
+  stats->frame_size = ctxt->frame.size;
+  return 0;
+}
+
+/* There is no underlying API whose errors are checked. */
+int
+rb_error_check(struct rb_context* ctxt, const struct rb_error_check_desc* desc)
+{
+  if(!ctxt || !desc)
+    return -1;
+  switch(desc->mode) {
+    case RB_ERROR_CHECK_NONE:
+    case RB_ERROR_CHECK_SAMPLED:
+    case RB_ERROR_CHECK_CALLBACK:
+    case RB_ERROR_CHECK_STRICT:
+      ctxt->error_check = *desc;
+      return 0;
+    default:
+      return -1;
+  }
+}
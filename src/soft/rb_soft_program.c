@@ -0,0 +1,395 @@
+#include "soft/rb_soft_context.h"
+#include "soft/rb_soft_program.h"
+#include "rb.h"
+#include <snlsys/list.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/snlsys.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static FINLINE size_t
+sizeof_uniform(enum rb_type type)
+{
+  size_t size = 0;
+  switch(type) {
+    case RB_UNKNOWN_TYPE: size = sizeof(int); break; /* Sampler. */
+    case RB_FLOAT: size = sizeof(float); break;
+    case RB_FLOAT2: size = 2 * sizeof(float); break;
+    case RB_FLOAT3: size = 3 * sizeof(float); break;
+    case RB_FLOAT4: size = 4 * sizeof(float); break;
+    case RB_FLOAT4x4: size = 16 * sizeof(float); break;
+    default: ASSERT(0); break;
+  }
+  return size;
+}
+
+static void
+clear_linked_data(struct rb_program* prog)
+{
+  struct mem_allocator* allocator = NULL;
+  ASSERT(prog);
+
+  allocator = prog->ctxt->allocator;
+  if(prog->uniform_list)
+    MEM_FREE(allocator, prog->uniform_list);
+  if(prog->vertex_uniforms)
+    MEM_FREE(allocator, prog->vertex_uniforms);
+  if(prog->fragment_uniforms)
+    MEM_FREE(allocator, prog->fragment_uniforms);
+  if(prog->uniform_data)
+    MEM_FREE(allocator, prog->uniform_data);
+  prog->uniform_list = NULL;
+  prog->vertex_uniforms = NULL;
+  prog->fragment_uniforms = NULL;
+  prog->uniform_data = NULL;
+  prog->nb_uniforms = 0;
+  prog->vertex = NULL;
+  prog->fragment = NULL;
+  prog->is_linked = 0;
+}
+
+/* Add the uniforms of the shader to the uniforms of the program. Define the
+ * index of each shader uniform into the program uniforms. */
+static int
+merge_uniforms
+  (struct rb_program* prog,
+   const struct rb_soft_shader_desc* shader,
+   size_t* slot_ids)
+{
+  size_t i = 0;
+  size_t j = 0;
+  ASSERT(prog && shader && (!shader->nb_uniforms || slot_ids));
+
+  for(i = 0; i < shader->nb_uniforms; ++i) {
+    const struct rb_soft_uniform_decl* decl = shader->uniform_list + i;
+    const unsigned int count = decl->count ? decl->count : 1;
+
+    for(j = 0; j < prog->nb_uniforms; ++j) {
+      if(!strcmp(prog->uniform_list[j].name, decl->name))
+        break;
+    }
+    if(j < prog->nb_uniforms) {
+      if(prog->uniform_list[j].type != decl->type
+      || prog->uniform_list[j].count != count) {
+        rb_soft_set_log(prog->ctxt, &prog->log,
+          "the uniform `%s' is differently declared by the shaders",
+          decl->name);
+        return -1;
+      }
+    } else {
+      prog->uniform_list[j].name = decl->name;
+      prog->uniform_list[j].type = decl->type;
+      prog->uniform_list[j].count = count;
+      prog->uniform_list[j].sizeof_elmt = sizeof_uniform(decl->type);
+      ++prog->nb_uniforms;
+    }
+    slot_ids[i] = j;
+  }
+  return 0;
+}
+
+static int
+setup_uniforms(struct rb_program* prog)
+{
+  struct mem_allocator* allocator = NULL;
+  struct rb_arena_mark mark;
+  const struct rb_soft_shader_desc* vs = NULL;
+  const struct rb_soft_shader_desc* fs = NULL;
+  size_t* slot_ids = NULL;
+  size_t size = 0;
+  size_t i = 0;
+  int err = 0;
+  ASSERT(prog && prog->vertex && prog->fragment);
+
+  allocator = prog->ctxt->allocator;
+  vs = prog->vertex;
+  fs = prog->fragment;
+  rb_arena_mark(&prog->ctxt->frame, &mark);
+
+  if(vs->nb_uniforms + fs->nb_uniforms) {
+    prog->uniform_list = MEM_CALLOC(allocator,
+      vs->nb_uniforms + fs->nb_uniforms, sizeof(struct rb_soft_uniform_slot));
+    /* The ids of the merged slots are transient. */
+    slot_ids = rb_arena_alloc
+      (&prog->ctxt->frame, (vs->nb_uniforms + fs->nb_uniforms)*sizeof(size_t));
+    if(!prog->uniform_list || !slot_ids)
+      goto error;
+  }
+  if(vs->nb_uniforms) {
+    prog->vertex_uniforms = MEM_CALLOC
+      (allocator, vs->nb_uniforms, sizeof(const void*));
+    if(!prog->vertex_uniforms)
+      goto error;
+  }
+  if(fs->nb_uniforms) {
+    prog->fragment_uniforms = MEM_CALLOC
+      (allocator, fs->nb_uniforms, sizeof(const void*));
+    if(!prog->fragment_uniforms)
+      goto error;
+  }
+  if(merge_uniforms(prog, vs, slot_ids) != 0
+  || merge_uniforms(prog, fs, slot_ids + vs->nb_uniforms) != 0)
+    goto error;
+
+  /* Allocate the uniform values. All the uniform components are 4 bytes
+   * long and thus the values are packed. */
+  for(i = 0; i < prog->nb_uniforms; ++i)
+    size += prog->uniform_list[i].sizeof_elmt * prog->uniform_list[i].count;
+  if(size) {
+    prog->uniform_data = MEM_CALLOC(allocator, 1, size);
+    if(!prog->uniform_data)
+      goto error;
+  }
+  for(i = 0, size = 0; i < prog->nb_uniforms; ++i) {
+    prog->uniform_list[i].value = (char*)prog->uniform_data + size;
+    size += prog->uniform_list[i].sizeof_elmt * prog->uniform_list[i].count;
+  }
+  for(i = 0; i < vs->nb_uniforms; ++i)
+    prog->vertex_uniforms[i] = prog->uniform_list[slot_ids[i]].value;
+  for(i = 0; i < fs->nb_uniforms; ++i) {
+    prog->fragment_uniforms[i] =
+      prog->uniform_list[slot_ids[vs->nb_uniforms + i]].value;
+  }
+
+exit:
+  rb_arena_restore(&prog->ctxt->frame, &mark);
+  return err;
+error:
+  err = -1;
+  goto exit;
+}
+
+static int
+link(struct rb_program* prog)
+{
+  struct list_node* node = NULL;
+  ASSERT(prog);
+
+  LIST_FOR_EACH(node, &prog->attached_shader_list) {
+    struct rb_shader* shader = CONTAINER_OF
+      (node, struct rb_soft_attachment, node)->shader;
+    const struct rb_soft_shader_desc** dst = NULL;
+
+    if(!shader->desc) {
+      rb_soft_set_log(prog->ctxt, &prog->log,
+        "a shader is not successfully compiled");
+      return -1;
+    }
+    dst = shader->type == RB_VERTEX_SHADER ? &prog->vertex : &prog->fragment;
+    if(*dst) {
+      rb_soft_set_log(prog->ctxt, &prog->log,
+        "several shaders of the same type are attached");
+      return -1;
+    }
+    *dst = shader->desc;
+  }
+  if(!prog->vertex || !prog->fragment) {
+    rb_soft_set_log(prog->ctxt, &prog->log,
+      "a vertex and a fragment shader must be attached");
+    return -1;
+  }
+  if(prog->fragment->nb_varyings > prog->vertex->nb_varyings) {
+    rb_soft_set_log(prog->ctxt, &prog->log,
+      "the fragment shader reads more varyings than the vertex shader writes");
+    return -1;
+  }
+  if(setup_uniforms(prog) != 0) {
+    if(!prog->log)
+      rb_soft_set_log(prog->ctxt, &prog->log, "out of memory");
+    return -1;
+  }
+  return 0;
+}
+
+static struct rb_soft_attachment*
+find_attachment(struct rb_program* program, struct rb_shader* shader)
+{
+  struct list_node* node = NULL;
+  ASSERT(program && shader);
+
+  LIST_FOR_EACH(node, &program->attached_shader_list) {
+    struct rb_soft_attachment* attachment = CONTAINER_OF
+      (node, struct rb_soft_attachment, node);
+    if(attachment->shader == shader)
+      return attachment;
+  }
+  return NULL;
+}
+
+static void
+release_program(struct ref* ref)
+{
+  struct list_node* node = NULL;
+  struct list_node* tmp = NULL;
+  struct rb_context* ctxt = NULL;
+  struct rb_program* prog = NULL;
+  ASSERT(ref);
+
+  prog = CONTAINER_OF(ref, struct rb_program, ref);
+  ctxt = prog->ctxt;
+
+  if(ctxt->state.program == prog)
+    RB(bind_program(ctxt, NULL));
+
+  LIST_FOR_EACH_SAFE(node, tmp, &prog->attached_shader_list) {
+    struct rb_soft_attachment* attachment = CONTAINER_OF
+      (node, struct rb_soft_attachment, node);
+    RB(detach_shader(prog, attachment->shader));
+  }
+  clear_linked_data(prog);
+  if(prog->log)
+    MEM_FREE(ctxt->allocator, prog->log);
+  rb_soft_free_object(ctxt, RB_OBJECT_PROGRAM, prog);
+  RB(context_ref_put(ctxt));
+}
+
+/*******************************************************************************
+ *
+ * Program functions.
+ *
+ ******************************************************************************/
+int
+rb_create_program(struct rb_context* ctxt, struct rb_program** out_program)
+{
+  struct rb_program* program = NULL;
+
+  if(!ctxt || !out_program)
+    return -1;
+
+  program = rb_soft_alloc_object
+    (ctxt, RB_OBJECT_PROGRAM, sizeof(struct rb_program));
+  if(!program)
+    return -1;
+  ref_init(&program->ref);
+  list_init(&program->attached_shader_list);
+  RB(context_ref_get(ctxt));
+  program->ctxt = ctxt;
+  *out_program = program;
+  return 0;
+}
+
+int
+rb_program_ref_get(struct rb_program* program)
+{
+  if(!program)
+    return -1;
+  ref_get(&program->ref);
+  return 0;
+}
+
+int
+rb_program_ref_put(struct rb_program* program)
+{
+  if(!program)
+    return -1;
+  ref_put(&program->ref, release_program);
+  return 0;
+}
+
+int
+rb_attach_shader(struct rb_program* program, struct rb_shader* shader)
+{
+  struct rb_soft_attachment* attachment = NULL;
+
+  if(!program || !shader || find_attachment(program, shader))
+    return -1;
+
+  attachment = MEM_ALLOC
+    (program->ctxt->allocator, sizeof(struct rb_soft_attachment));
+  if(!attachment)
+    return -1;
+  attachment->shader = shader;
+  list_add(&program->attached_shader_list, &attachment->node);
+  ++shader->nb_attachments;
+  RB(shader_ref_get(shader));
+  return 0;
+}
+
+int
+rb_detach_shader(struct rb_program* program, struct rb_shader* shader)
+{
+  struct rb_soft_attachment* attachment = NULL;
+
+  if(!program || !shader || !(attachment = find_attachment(program, shader)))
+    return -1;
+
+  list_del(&attachment->node);
+  MEM_FREE(program->ctxt->allocator, attachment);
+  ASSERT(shader->nb_attachments);
+  --shader->nb_attachments;
+  RB(shader_ref_put(shader));
+  return 0;
+}
+
+int
+rb_link_program(struct rb_program* program)
+{
+  if(!program)
+    return -1;
+
+  clear_linked_data(program);
+  if(link(program) != 0) {
+    clear_linked_data(program);
+    if(program->ctxt->state.program == program)
+      RB(bind_program(program->ctxt, NULL));
+    return -1;
+  }
+  program->is_linked = 1;
+  if(program->log) {
+    MEM_FREE(program->ctxt->allocator, program->log);
+    program->log = NULL;
+  }
+  return 0;
+}
+
+/* The software shaders are linked before rb_link_program returns. */
+int
+rb_program_is_ready(struct rb_program* program, int* out_is_ready)
+{
+  if(!program || !out_is_ready)
+    return -1;
+  *out_is_ready = 1;
+  return program->is_linked ? 0 : -1;
+}
+
+int
+rb_compile_mode(struct rb_context* ctxt, const struct rb_compile_desc* desc)
+{
+  if(!ctxt || !desc)
+    return -1;
+  switch(desc->mode) {
+    case RB_COMPILE_SYNC:
+    case RB_COMPILE_ASYNC:
+      ctxt->compile = *desc;
+      return 0;
+    default:
+      return -1;
+  }
+}
+
+int
+rb_get_program_log(struct rb_program* program, const char** out_log)
+{
+  if(!program || !out_log)
+    return -1;
+  *out_log = program->log;
+  return 0;
+}
+
+int
+rb_bind_program(struct rb_context* ctxt, struct rb_program* program)
+{
+  if(!ctxt)
+    return -1;
+
+  if(program && !program->is_linked)
+    return -1;
+
+  ctxt->state.program = program;
+  return 0;
+}
@@ -0,0 +1,69 @@
+#ifndef RB_SOFT_PROGRAM_H
+#define RB_SOFT_PROGRAM_H
+
+#include "soft/rb_soft.h"
+#include <snlsys/list.h>
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct rb_context;
+struct rb_uniform;
+
+struct rb_shader {
+  struct ref ref;
+  struct rb_context* ctxt;
+  enum rb_shader_type type;
+  unsigned int nb_attachments; /* Number of programs it is attached to. */
+  /* Registered functions of the shader source. NULL if the source is not
+   * registered. */
+  const struct rb_soft_shader_desc* desc;
+  char* log;
+  uint64_t variant_key; /* Key into the variant cache if it is shared. */
+  int is_variant;
+};
+
+/* Link between a program and one of its shaders that may be attached to
+ * several programs. */
+struct rb_soft_attachment {
+  struct list_node node;
+  struct rb_shader* shader;
+};
+
+/* Uniform of a linked program. Its name points toward the string of the
+ * registered declaration. */
+struct rb_soft_uniform_slot {
+  const char* name;
+  enum rb_type type;
+  unsigned int count;
+  size_t sizeof_elmt;
+  void* value;
+};
+
+struct rb_program {
+  struct ref ref;
+  struct list_node attached_shader_list;
+  struct rb_context* ctxt;
+  int is_linked;
+  char* log;
+  /* Linked data. */
+  const struct rb_soft_shader_desc* vertex;
+  const struct rb_soft_shader_desc* fragment;
+  struct rb_soft_uniform_slot* uniform_list;
+  size_t nb_uniforms;
+  /* Per stage uniform values, in the declaration order of the shader. */
+  const void** vertex_uniforms;
+  const void** fragment_uniforms;
+  void* uniform_data;
+};
+
+/* Size in bytes of the `count' first values of the uniform as read by
+ * rb_uniform_data. Return 0 if the program was linked again without the
+ * uniform. The uniform is not updated and may be thus shared by threads. */
+LOCAL_SYM size_t
+rb_soft_sizeof_uniform_data
+  (const struct rb_uniform* uniform,
+   int count);
+
+#endif /* RB_SOFT_PROGRAM_H */
@@ -0,0 +1,1291 @@
+#include "common/rb_thread_pool.h"
+#include "soft/rb_soft_buffers.h"
+#include "soft/rb_soft_context.h"
+#include "soft/rb_soft_framebuffer.h"
+#include "soft/rb_soft_program.h"
+#include "soft/rb_soft_raster.h"
+#include "soft/rb_soft_texture.h"
+#include "soft/rb_soft_vertex_array.h"
+#include <snlsys/math.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/snlsys.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+  #include <emmintrin.h>
+#endif
+
+/* The primitives are binned into square tiles of 2^TILE_SIZE_LOG2 pixels. */
+#define TILE_SIZE_LOG2 6
+#define TILE_SIZE (1 << TILE_SIZE_LOG2)
+/* The vertex positions are snapped to 1/2^SUBPIXEL_BITS pixel. */
+#define SUBPIXEL_BITS 4
+#define SUBPIXEL_SCALE (1 << SUBPIXEL_BITS)
+/* Bound of the screen coordinates, in pixels. It ensures that the edge
+ * functions of a primitive partially covering a tile fit in 32 bits. */
+#define GUARD_BAND 16384.f
+/* Number of vertices shaded per task. */
+#define VERTEX_BATCH 256
+#define MAX_CLIP_VERTICES 16
+#define CLIP_VERTEX_SIZE (4 + RB_SOFT_MAX_VARYINGS)
+#define NB_CLIP_PLANES 7
+
+/* Setup of a triangle. Its edge functions are evaluated at the center of the
+ * pixel (x, y) as a*x + b*y + c, in fixed point. The edge i is opposite to the
+ * vertex i. */
+struct prim {
+  int64_t a[3];
+  int64_t b[3];
+  int64_t c[3];
+  int x0, y0, x1, y1; /* Inclusive pixel bounds clamped to the clip rect. */
+  float inv_area; /* Inverse of the sum of the edge functions. */
+  float z[3]; /* Window space depth. */
+  float inv_w[3];
+  size_t varyings; /* Offset toward the varyings divided by w. */
+  int is_front;
+};
+
+struct tile {
+  uint32_t* prim_list; /* Ids of the primitives in submission order. */
+  size_t nb_prims;
+  size_t max_nb_prims;
+};
+
+struct rb_soft_raster {
+  struct mem_allocator* allocator;
+  float* vertex_list; /* Clip space position + varyings. */
+  size_t max_vertex_list;
+  struct prim* prim_list;
+  size_t nb_prims;
+  size_t max_nb_prims;
+  float* prim_data; /* Varyings of the primitives. */
+  size_t prim_data_size;
+  size_t max_prim_data;
+  struct tile* tile_list;
+  size_t max_nb_tiles;
+  uint32_t* active_tile_list; /* Tiles that own at least one primitive. */
+  size_t nb_active_tiles;
+  size_t max_nb_active_tiles;
+};
+
+/* Vertex in window space. Its varyings are divided by w. */
+struct screen_vertex {
+  float x, y, z, inv_w;
+  const float* varyings;
+};
+
+struct draw {
+  struct rb_context* ctxt;
+  struct rb_soft_raster* raster;
+  const struct rb_program* program;
+  const struct rb_vertex_array* varray;
+  const uint32_t* index_list; /* NULL <=> the vertices are not indexed. */
+  size_t count; /* Number of vertices of the draw call. */
+  /* Shaded vertex i is the vertex first_vertex + i or, if `per_index' is not
+   * null, the vertex index_list[i], both offset by base_vertex. */
+  int per_index;
+  size_t first_vertex;
+  size_t base_vertex;
+  size_t nb_vertices;
+  size_t vertex_size; /* In floats. */
+  unsigned int nb_varyings; /* Varyings read by the fragment shader. */
+  struct rb_soft_shader_env vertex_env;
+  struct rb_soft_shader_env fragment_env;
+  /* Viewport transform. */
+  float scale[3];
+  float offset[3];
+  float clip_planes[NB_CLIP_PLANES][5];
+  /* Render targets. */
+  struct rb_soft_surface* color_list[RB_SOFT_MAX_COLOR_ATTACHMENTS];
+  unsigned int nb_colors;
+  struct rb_soft_surface* depth_stencil;
+  int clip_rect[4]; /* Inclusive pixel bounds. */
+  unsigned int nb_tiles_x;
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+/* Return a buffer of at least `size' elements. The returned pointer is NULL
+ * on allocation error and `data' is then still valid. */
+static void*
+reserve
+  (struct mem_allocator* allocator,
+   void* data,
+   size_t* capacity,
+   size_t size,
+   size_t sizeof_elmt)
+{
+  size_t new_capacity = 0;
+  ASSERT(allocator && capacity && sizeof_elmt);
+
+  if(size <= *capacity)
+    return data;
+  new_capacity = MAX(*capacity * 2, size);
+  data = MEM_REALLOC(allocator, data, new_capacity * sizeof_elmt);
+  if(data)
+    *capacity = new_capacity;
+  return data;
+}
+
+static FINLINE int64_t
+floor_div(int64_t a, int64_t b)
+{
+  ASSERT(b > 0);
+  return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static FINLINE int
+compare_uint(enum rb_comparison func, uint32_t a, uint32_t b)
+{
+  switch(func) {
+    case RB_COMPARISON_NEVER: return 0;
+    case RB_COMPARISON_ALWAYS: return 1;
+    case RB_COMPARISON_LESS: return a < b;
+    case RB_COMPARISON_EQUAL: return a == b;
+    case RB_COMPARISON_NOT_EQUAL: return a != b;
+    case RB_COMPARISON_LESS_EQUAL: return a <= b;
+    case RB_COMPARISON_GREATER: return a > b;
+    case RB_COMPARISON_GREATER_EQUAL: return a >= b;
+    default: ASSERT(0); return 0;
+  }
+}
+
+static FINLINE int
+compare_float(enum rb_comparison func, float a, float b)
+{
+  switch(func) {
+    case RB_COMPARISON_NEVER: return 0;
+    case RB_COMPARISON_ALWAYS: return 1;
+    case RB_COMPARISON_LESS: return a < b;
+    case RB_COMPARISON_EQUAL: return a == b;
+    case RB_COMPARISON_NOT_EQUAL: return a != b;
+    case RB_COMPARISON_LESS_EQUAL: return a <= b;
+    case RB_COMPARISON_GREATER: return a > b;
+    case RB_COMPARISON_GREATER_EQUAL: return a >= b;
+    default: ASSERT(0); return 0;
+  }
+}
+
+static FINLINE uint32_t
+stencil_op(enum rb_stencil_op op, uint32_t val, uint32_t ref)
+{
+  switch(op) {
+    case RB_STENCIL_OP_KEEP: return val;
+    case RB_STENCIL_OP_ZERO: return 0;
+    case RB_STENCIL_OP_REPLACE: return ref;
+    case RB_STENCIL_OP_INCR_SAT: return val < 0xFF ? val + 1 : val;
+    case RB_STENCIL_OP_DECR_SAT: return val > 0 ? val - 1 : val;
+    case RB_STENCIL_OP_INCR: return (val + 1) & 0xFF;
+    case RB_STENCIL_OP_DECR: return (val - 1) & 0xFF;
+    case RB_STENCIL_OP_INVERT: return ~val & 0xFF;
+    default: ASSERT(0); return val;
+  }
+}
+
+static FINLINE float
+blend_factor
+  (enum rb_blend_func func,
+   const float src[4],
+   const float dst[4],
+   int channel)
+{
+  switch(func) {
+    case RB_BLEND_ZERO: return 0.f;
+    case RB_BLEND_ONE: return 1.f;
+    case RB_BLEND_SRC_COLOR: return src[channel];
+    case RB_BLEND_ONE_MINUS_SRC_COLOR: return 1.f - src[channel];
+    case RB_BLEND_DST_COLOR: return dst[channel];
+    case RB_BLEND_ONE_MINUS_DST_COLOR: return 1.f - dst[channel];
+    case RB_BLEND_SRC_ALPHA: return src[3];
+    case RB_BLEND_ONE_MINUS_SRC_ALPHA: return 1.f - src[3];
+    case RB_BLEND_DST_ALPHA: return dst[3];
+    case RB_BLEND_ONE_MINUS_DST_ALPHA: return 1.f - dst[3];
+    /* The constant color is the OpenGL default blend color, i.e. 0. */
+    case RB_BLEND_CONSTANT: return 0.f;
+    default: ASSERT(0); return 0.f;
+  }
+}
+
+static FINLINE float
+blend_op(enum rb_blend_op op, float src, float sf, float dst, float df)
+{
+  switch(op) {
+    case RB_BLEND_OP_ADD: return src * sf + dst * df;
+    case RB_BLEND_OP_SUB: return src * sf - dst * df;
+    case RB_BLEND_OP_REVERSE_SUB: return dst * df - src * sf;
+    case RB_BLEND_OP_MIN: return MIN(src, dst);
+    case RB_BLEND_OP_MAX: return MAX(src, dst);
+    default: ASSERT(0); return src;
+  }
+}
+
+static void
+blend
+  (const struct rb_blend_desc* desc,
+   const float src_color[4],
+   const float dst[4],
+   float color[4])
+{
+  float src[4];
+  float sf = 0.f;
+  float df = 0.f;
+  int i = 0;
+  ASSERT(desc && src_color && dst && color);
+
+  /* The fixed point render targets clamp the source color. */
+  for(i = 0; i < 4; ++i)
+    src[i] = MIN(MAX(src_color[i], 0.f), 1.f);
+  for(i = 0; i < 3; ++i) {
+    sf = blend_factor(desc->src_blend_RGB, src, dst, i);
+    df = blend_factor(desc->dst_blend_RGB, src, dst, i);
+    color[i] = blend_op(desc->blend_op_RGB, src[i], sf, dst[i], df);
+  }
+  sf = blend_factor(desc->src_blend_Alpha, src, dst, 3);
+  df = blend_factor(desc->dst_blend_Alpha, src, dst, 3);
+  color[3] = blend_op(desc->blend_op_Alpha, src[3], sf, dst[3], df);
+}
+
+/*******************************************************************************
+ *
+ * Vertex processing.
+ *
+ ******************************************************************************/
+static size_t
+vertex_id(const struct draw* draw, size_t i)
+{
+  ASSERT(draw && i < draw->nb_vertices);
+  return draw->base_vertex
+    + (draw->per_index ? draw->index_list[i] : draw->first_vertex + i);
+}
+
+/* Fetch the 4 components of the attrib of the vertex `id'. The attribs out of
+ * their buffer are set to (0, 0, 0, 1). */
+static void
+fetch_attrib
+  (const struct draw* draw,
+   const struct rb_soft_attrib_decl* decl,
+   size_t id,
+   float attrib[4])
+{
+  const struct rb_soft_vertex_attrib* src = NULL;
+  size_t offset = 0;
+  size_t size = 0;
+  ASSERT(draw && decl && attrib);
+  ASSERT(decl->location >= 0 && decl->location < RB_SOFT_MAX_ATTRIBS);
+
+  if(draw->varray)
+    src = draw->varray->attrib_list + decl->location;
+  if(!src || !src->buffer) {
+    memcpy(attrib, draw->ctxt->state.generic_attribs[decl->location],
+      4 * sizeof(float));
+    return;
+  }
+  attrib[0] = attrib[1] = attrib[2] = 0.f;
+  attrib[3] = 1.f;
+  offset = src->offset + src->stride * id;
+  size = src->nb_components * sizeof(float);
+  if(offset + size <= (size_t)src->buffer->size)
+    memcpy(attrib, src->buffer->data + offset, size);
+}
+
+static void
+shade_vertices(void* data, size_t task, unsigned int thread_id)
+{
+  float attrib_data[RB_SOFT_MAX_ATTRIBS][4];
+  const float* attrib_list[RB_SOFT_MAX_ATTRIBS];
+  const struct draw* draw = data;
+  const struct rb_soft_shader_desc* vs = NULL;
+  float* vertex = NULL;
+  size_t begin = 0;
+  size_t end = 0;
+  size_t i = 0;
+  size_t j = 0;
+  ASSERT(data);
+  (void)thread_id;
+
+  vs = draw->program->vertex;
+  begin = task * VERTEX_BATCH;
+  end = MIN(begin + VERTEX_BATCH, draw->nb_vertices);
+  for(j = 0; j < vs->nb_attribs; ++j)
+    attrib_list[j] = attrib_data[j];
+
+  for(i = begin; i < end; ++i) {
+    const size_t id = vertex_id(draw, i);
+    for(j = 0; j < vs->nb_attribs; ++j)
+      fetch_attrib(draw, vs->attrib_list + j, id, attrib_data[j]);
+    vertex = draw->raster->vertex_list + i * draw->vertex_size;
+    vertex[0] = vertex[1] = vertex[2] = 0.f;
+    vertex[3] = 1.f;
+    vs->vertex(&draw->vertex_env, attrib_list, vertex, vertex + 4);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Clipping.
+ *
+ ******************************************************************************/
+static FINLINE float
+plane_distance(const float plane[5], const float* vertex)
+{
+  return plane[0] * vertex[0] + plane[1] * vertex[1]
+       + plane[2] * vertex[2] + plane[3] * vertex[3] + plane[4];
+}
+
+static int
+outcode(const struct draw* draw, const float* vertex)
+{
+  int code = 0;
+  int i = 0;
+  for(i = 0; i < NB_CLIP_PLANES; ++i) {
+    if(plane_distance(draw->clip_planes[i], vertex) < 0.f)
+      code |= BIT(i);
+  }
+  return code;
+}
+
+static void
+lerp_vertex
+  (const float* a,
+   const float* b,
+   float t,
+   size_t size,
+   float* dst)
+{
+  size_t i = 0;
+  for(i = 0; i < size; ++i)
+    dst[i] = a[i] + t * (b[i] - a[i]);
+}
+
+/* Clip the polygon against the clip planes with the Sutherland-Hodgman
+ * algorithm. Return the number of vertices of the clipped polygon stored in
+ * `poly'. */
+static size_t
+clip_polygon
+  (const struct draw* draw,
+   int code,
+   float poly[MAX_CLIP_VERTICES][CLIP_VERTEX_SIZE],
+   size_t nb_vertices)
+{
+  float tmp[MAX_CLIP_VERTICES][CLIP_VERTEX_SIZE];
+  const size_t size = 4 + draw->nb_varyings;
+  float (*src)[CLIP_VERTEX_SIZE] = poly;
+  float (*dst)[CLIP_VERTEX_SIZE] = tmp;
+  float (*swap)[CLIP_VERTEX_SIZE] = NULL;
+  size_t nb = nb_vertices;
+  size_t i = 0;
+  int iplane = 0;
+  ASSERT(draw && poly && nb_vertices <= 3);
+
+  for(iplane = 0; iplane < NB_CLIP_PLANES && nb >= 3; ++iplane) {
+    const float* plane = draw->clip_planes[iplane];
+    size_t nb_dst = 0;
+    float d0 = 0.f;
+
+    if(!(code & BIT(iplane)))
+      continue;
+    d0 = plane_distance(plane, src[nb - 1]);
+    for(i = 0; i < nb; ++i) {
+      const float* v0 = src[(i + nb - 1) % nb];
+      const float* v1 = src[i];
+      const float d1 = plane_distance(plane, v1);
+      if((d0 >= 0.f) != (d1 >= 0.f))
+        lerp_vertex(v0, v1, d0 / (d0 - d1), size, dst[nb_dst++]);
+      if(d1 >= 0.f)
+        memcpy(dst[nb_dst++], v1, size * sizeof(float));
+      d0 = d1;
+    }
+    ASSERT(nb_dst <= MAX_CLIP_VERTICES);
+    nb = nb_dst;
+    swap = src, src = dst, dst = swap;
+  }
+  if(src != poly) {
+    for(i = 0; i < nb; ++i)
+      memcpy(poly[i], src[i], size * sizeof(float));
+  }
+  return nb < 3 ? 0 : nb;
+}
+
+/* Parametric clipping of a segment. Return 0 if the segment is culled. */
+static int
+clip_segment
+  (const struct draw* draw,
+   int code,
+   float seg[2][CLIP_VERTEX_SIZE])
+{
+  float v0[CLIP_VERTEX_SIZE];
+  const size_t size = 4 + draw->nb_varyings;
+  float t0 = 0.f;
+  float t1 = 1.f;
+  int iplane = 0;
+  ASSERT(draw && seg);
+
+  for(iplane = 0; iplane < NB_CLIP_PLANES; ++iplane) {
+    const float* plane = draw->clip_planes[iplane];
+    float d0 = 0.f;
+    float d1 = 0.f;
+
+    if(!(code & BIT(iplane)))
+      continue;
+    d0 = plane_distance(plane, seg[0]);
+    d1 = plane_distance(plane, seg[1]);
+    if(d0 < 0.f && d1 < 0.f)
+      return 0;
+    if(d0 < 0.f)
+      t0 = MAX(t0, d0 / (d0 - d1));
+    else if(d1 < 0.f)
+      t1 = MIN(t1, d0 / (d0 - d1));
+  }
+  if(t0 >= t1)
+    return 0;
+  memcpy(v0, seg[0], size * sizeof(float));
+  lerp_vertex(v0, seg[1], t0, size, seg[0]);
+  lerp_vertex(v0, seg[1], t1, size, seg[1]);
+  return 1;
+}
+
+static void
+to_screen
+  (const struct draw* draw,
+   float* vertex, /* The varyings are divided by w in place. */
+   struct screen_vertex* dst)
+{
+  unsigned int i = 0;
+  float inv_w = 0.f;
+  ASSERT(draw && vertex && dst && vertex[3] > 0.f);
+
+  inv_w = 1.f / vertex[3];
+  dst->x = vertex[0] * inv_w * draw->scale[0] + draw->offset[0];
+  dst->y = vertex[1] * inv_w * draw->scale[1] + draw->offset[1];
+  dst->z = vertex[2] * inv_w * draw->scale[2] + draw->offset[2];
+  dst->inv_w = inv_w;
+  for(i = 0; i < draw->nb_varyings; ++i)
+    vertex[4 + i] *= inv_w;
+  dst->varyings = vertex + 4;
+}
+
+/*******************************************************************************
+ *
+ * Triangle setup and binning.
+ *
+ ******************************************************************************/
+static void
+bin_prim(const struct draw* draw, uint32_t prim_id, int* err)
+{
+  struct rb_soft_raster* raster = draw->raster;
+  const struct prim* prim = raster->prim_list + prim_id;
+  const int tx0 = prim->x0 >> TILE_SIZE_LOG2;
+  const int ty0 = prim->y0 >> TILE_SIZE_LOG2;
+  const int tx1 = prim->x1 >> TILE_SIZE_LOG2;
+  const int ty1 = prim->y1 >> TILE_SIZE_LOG2;
+  int tx = 0;
+  int ty = 0;
+  int i = 0;
+
+  for(ty = ty0; ty <= ty1; ++ty) {
+    for(tx = tx0; tx <= tx1; ++tx) {
+      const int x0 = MAX(tx << TILE_SIZE_LOG2, prim->x0);
+      const int y0 = MAX(ty << TILE_SIZE_LOG2, prim->y0);
+      const int x1 = MIN((tx << TILE_SIZE_LOG2) + TILE_SIZE - 1, prim->x1);
+      const int y1 = MIN((ty << TILE_SIZE_LOG2) + TILE_SIZE - 1, prim->y1);
+      const size_t itile = (size_t)ty * draw->nb_tiles_x + (size_t)tx;
+      struct tile* tile = raster->tile_list + itile;
+      void* mem = NULL;
+
+      /* Reject the tile if it is fully outside of an edge. */
+      for(i = 0; i < 3; ++i) {
+        const int64_t x = prim->a[i] > 0 ? x1 : x0;
+        const int64_t y = prim->b[i] > 0 ? y1 : y0;
+        if(prim->a[i] * x + prim->b[i] * y + prim->c[i] < 0)
+          break;
+      }
+      if(i < 3)
+        continue;
+
+      if(tile->nb_prims == 0) {
+        mem = reserve(raster->allocator, raster->active_tile_list,
+          &raster->max_nb_active_tiles, raster->nb_active_tiles + 1,
+          sizeof(uint32_t));
+        if(!mem) {
+          *err = -1;
+          return;
+        }
+        raster->active_tile_list = mem;
+        raster->active_tile_list[raster->nb_active_tiles++] = (uint32_t)itile;
+      }
+      mem = reserve(raster->allocator, tile->prim_list, &tile->max_nb_prims,
+        tile->nb_prims + 1, sizeof(uint32_t));
+      if(!mem) {
+        *err = -1;
+        return;
+      }
+      tile->prim_list = mem;
+      tile->prim_list[tile->nb_prims++] = prim_id;
+    }
+  }
+}
+
+/* Setup and bin the triangle. The triangle is discarded if it is degenerated
+ * once snapped to the sub-pixel grid. */
+static int
+setup_triangle
+  (const struct draw* draw,
+   const struct screen_vertex* v0,
+   const struct screen_vertex* v1,
+   const struct screen_vertex* v2,
+   int is_front)
+{
+  const struct screen_vertex* v[3];
+  struct rb_soft_raster* raster = draw->raster;
+  struct prim* prim = NULL;
+  int64_t X[3], Y[3];
+  int64_t area = 0;
+  int64_t xmin, ymin, xmax, ymax;
+  float* varyings = NULL;
+  void* mem = NULL;
+  int err = 0;
+  int i = 0;
+  ASSERT(draw && v0 && v1 && v2);
+
+  v[0] = v0, v[1] = v1, v[2] = v2;
+  for(i = 0; i < 3; ++i) {
+    X[i] = (int64_t)floorf(v[i]->x * (float)SUBPIXEL_SCALE + 0.5f);
+    Y[i] = (int64_t)floorf(v[i]->y * (float)SUBPIXEL_SCALE + 0.5f);
+  }
+  area = (X[1] - X[0]) * (Y[2] - Y[0]) - (Y[1] - Y[0]) * (X[2] - X[0]);
+  if(area == 0)
+    return 0;
+  if(area < 0) { /* Ensure a counter clockwise order. */
+    const struct screen_vertex* tmpv = v[1];
+    int64_t tmp = 0;
+    v[1] = v[2], v[2] = tmpv;
+    tmp = X[1], X[1] = X[2], X[2] = tmp;
+    tmp = Y[1], Y[1] = Y[2], Y[2] = tmp;
+    area = -area;
+  }
+
+  /* Pixel bounds of the pixel centers covered by the triangle. */
+  xmin = floor_div(MIN(MIN(X[0], X[1]), X[2]) + SUBPIXEL_SCALE/2 - 1,
+    SUBPIXEL_SCALE);
+  ymin = floor_div(MIN(MIN(Y[0], Y[1]), Y[2]) + SUBPIXEL_SCALE/2 - 1,
+    SUBPIXEL_SCALE);
+  xmax = floor_div(MAX(MAX(X[0], X[1]), X[2]) - SUBPIXEL_SCALE/2,
+    SUBPIXEL_SCALE);
+  ymax = floor_div(MAX(MAX(Y[0], Y[1]), Y[2]) - SUBPIXEL_SCALE/2,
+    SUBPIXEL_SCALE);
+  xmin = MAX(xmin, draw->clip_rect[0]);
+  ymin = MAX(ymin, draw->clip_rect[1]);
+  xmax = MIN(xmax, draw->clip_rect[2]);
+  ymax = MIN(ymax, draw->clip_rect[3]);
+  if(xmin > xmax || ymin > ymax)
+    return 0;
+
+  mem = reserve(raster->allocator, raster->prim_list, &raster->max_nb_prims,
+    raster->nb_prims + 1, sizeof(struct prim));
+  if(!mem)
+    return -1;
+  raster->prim_list = mem;
+  mem = reserve(raster->allocator, raster->prim_data, &raster->max_prim_data,
+    raster->prim_data_size + 3 * draw->nb_varyings, sizeof(float));
+  if(!mem)
+    return -1;
+  raster->prim_data = mem;
+
+  prim = raster->prim_list + raster->nb_prims;
+  for(i = 0; i < 3; ++i) {
+    const int j = (i + 1) % 3;
+    const int k = (i + 2) % 3;
+    const int64_t a = Y[j] - Y[k];
+    const int64_t b = X[k] - X[j];
+    /* Edge function at the center of the pixel (0, 0). */
+    int64_t c = X[j] * Y[k] - X[k] * Y[j]
+      + a * (SUBPIXEL_SCALE/2) + b * (SUBPIXEL_SCALE/2);
+    /* Top-left fill convention: the pixels lying on an edge belong to only one
+     * of the two triangles that share it. */
+    if(!(a > 0 || (a == 0 && b < 0)))
+      c -= 1;
+    prim->a[i] = a * SUBPIXEL_SCALE;
+    prim->b[i] = b * SUBPIXEL_SCALE;
+    prim->c[i] = c;
+    prim->z[i] = v[i]->z;
+    prim->inv_w[i] = v[i]->inv_w;
+  }
+  prim->x0 = (int)xmin;
+  prim->y0 = (int)ymin;
+  prim->x1 = (int)xmax;
+  prim->y1 = (int)ymax;
+  prim->inv_area = (float)(1.0 / (double)area);
+  prim->is_front = is_front;
+  prim->varyings = raster->prim_data_size;
+  varyings = raster->prim_data + raster->prim_data_size;
+  for(i = 0; i < 3; ++i) {
+    memcpy(varyings + (size_t)i * draw->nb_varyings, v[i]->varyings,
+      draw->nb_varyings * sizeof(float));
+  }
+  if(raster->nb_prims >= UINT32_MAX)
+    return -1;
+
+  bin_prim(draw, (uint32_t)raster->nb_prims, &err);
+  if(err != 0)
+    return -1;
+  raster->nb_prims += 1;
+  raster->prim_data_size += 3 * draw->nb_varyings;
+  return 0;
+}
+
+/* Rasterize the line as a one pixel wide quad. */
+static int
+setup_line
+  (const struct draw* draw,
+   const struct screen_vertex* v0,
+   const struct screen_vertex* v1)
+{
+  struct screen_vertex quad[4];
+  const float dx = v1->x - v0->x;
+  const float dy = v1->y - v0->y;
+  float ox = 0.f;
+  float oy = 0.f;
+  int err = 0;
+  ASSERT(draw && v0 && v1);
+
+  if(fabsf(dx) >= fabsf(dy))
+    oy = 0.5f;
+  else
+    ox = 0.5f;
+  quad[0] = *v0, quad[0].x -= ox, quad[0].y -= oy;
+  quad[1] = *v1, quad[1].x -= ox, quad[1].y -= oy;
+  quad[2] = *v1, quad[2].x += ox, quad[2].y += oy;
+  quad[3] = *v0, quad[3].x += ox, quad[3].y += oy;
+  err = setup_triangle(draw, quad + 0, quad + 1, quad + 2, 1);
+  if(err == 0)
+    err = setup_triangle(draw, quad + 0, quad + 2, quad + 3, 1);
+  return err;
+}
+
+static int
+process_triangle(const struct draw* draw, size_t i0, size_t i1, size_t i2)
+{
+  float poly[MAX_CLIP_VERTICES][CLIP_VERTEX_SIZE];
+  float varyings[MAX_CLIP_VERTICES][RB_SOFT_MAX_VARYINGS];
+  struct screen_vertex screen[MAX_CLIP_VERTICES];
+  const struct rb_rasterizer_desc* rasterizer = NULL;
+  const size_t ids[3] = { i0, i1, i2 };
+  const size_t size = (4 + draw->nb_varyings) * sizeof(float);
+  size_t nb = 3;
+  size_t i = 0;
+  float area = 0.f;
+  int code_or = 0;
+  int code_and = ~0;
+  int is_front = 0;
+  int err = 0;
+  ASSERT(draw);
+
+  for(i = 0; i < 3; ++i) {
+    const float* vertex = draw->raster->vertex_list + ids[i]*draw->vertex_size;
+    const int code = outcode(draw, vertex);
+    code_or |= code;
+    code_and &= code;
+    memcpy(poly[i], vertex, size);
+  }
+  if(code_and)
+    return 0;
+  if(code_or)
+    nb = clip_polygon(draw, code_or, poly, nb);
+
+  for(i = 0; i < nb; ++i) {
+    to_screen(draw, poly[i], screen + i);
+    memcpy(varyings[i], screen[i].varyings, draw->nb_varyings*sizeof(float));
+    screen[i].varyings = varyings[i];
+  }
+  /* Signed area of the polygon in window space. */
+  for(i = 0; i < nb; ++i) {
+    const struct screen_vertex* a = screen + i;
+    const struct screen_vertex* b = screen + (i + 1) % nb;
+    area += a->x * b->y - b->x * a->y;
+  }
+  if(area == 0.f)
+    return 0;
+
+  rasterizer = &draw->ctxt->state.rasterizer;
+  is_front = (area > 0.f) == (rasterizer->front_facing == RB_ORIENTATION_CCW);
+  if((rasterizer->cull_mode == RB_CULL_FRONT && is_front)
+  || (rasterizer->cull_mode == RB_CULL_BACK && !is_front))
+    return 0;
+
+  if(rasterizer->fill_mode == RB_FILL_WIREFRAME) {
+    /* The clipped edges are not drawn. */
+    for(i = 0; i < nb && !err; ++i)
+      err = setup_line(draw, screen + i, screen + (i + 1) % nb);
+  } else {
+    for(i = 1; i + 1 < nb && !err; ++i)
+      err = setup_triangle(draw, screen, screen + i, screen + i + 1, is_front);
+  }
+  return err;
+}
+
+static int
+process_line(const struct draw* draw, size_t i0, size_t i1)
+{
+  float seg[2][CLIP_VERTEX_SIZE];
+  struct screen_vertex screen[2];
+  const size_t size = (4 + draw->nb_varyings) * sizeof(float);
+  const float* v0 = draw->raster->vertex_list + i0 * draw->vertex_size;
+  const float* v1 = draw->raster->vertex_list + i1 * draw->vertex_size;
+  const int code0 = outcode(draw, v0);
+  const int code1 = outcode(draw, v1);
+  ASSERT(draw);
+
+  if(code0 & code1)
+    return 0;
+  memcpy(seg[0], v0, size);
+  memcpy(seg[1], v1, size);
+  if((code0 | code1) && !clip_segment(draw, code0 | code1, seg))
+    return 0;
+  to_screen(draw, seg[0], screen + 0);
+  to_screen(draw, seg[1], screen + 1);
+  return setup_line(draw, screen + 0, screen + 1);
+}
+
+static int
+assemble_primitives(const struct draw* draw, enum rb_primitive_type prim_type)
+{
+  const size_t nb = draw->count;
+  size_t i = 0;
+  int err = 0;
+  ASSERT(draw);
+
+  /* Map the draw vertex to its shaded vertex. */
+  #define VERTEX(Id) \
+    (draw->index_list && !draw->per_index \
+     ? draw->index_list[Id] - draw->first_vertex : (Id))
+
+  switch(prim_type) {
+    case RB_LINES:
+      for(i = 0; i + 1 < nb && !err; i += 2)
+        err = process_line(draw, VERTEX(i), VERTEX(i + 1));
+      break;
+    case RB_LINE_LOOP:
+      for(i = 0; nb > 1 && i < nb && !err; ++i)
+        err = process_line(draw, VERTEX(i), VERTEX((i + 1) % nb));
+      break;
+    case RB_TRIANGLE_LIST:
+      for(i = 0; i + 2 < nb && !err; i += 3)
+        err = process_triangle(draw, VERTEX(i), VERTEX(i+1), VERTEX(i+2));
+      break;
+    case RB_TRIANGLE_STRIP:
+      for(i = 0; i + 2 < nb && !err; ++i) {
+        if(i % 2) /* Keep the orientation of the odd triangles. */
+          err = process_triangle(draw, VERTEX(i+1), VERTEX(i), VERTEX(i+2));
+        else
+          err = process_triangle(draw, VERTEX(i), VERTEX(i+1), VERTEX(i+2));
+      }
+      break;
+    default: ASSERT(0); break;
+  }
+  #undef VERTEX
+  return err;
+}
+
+/*******************************************************************************
+ *
+ * Fragment processing.
+ *
+ ******************************************************************************/
+static void
+write_colors
+  (const struct draw* draw,
+   int x,
+   int y,
+   float colors[RB_SOFT_MAX_OUTPUTS][4])
+{
+  const struct rb_blend_desc* blend_desc = &draw->ctxt->state.blend;
+  unsigned int i = 0;
+
+  for(i = 0; i < draw->nb_colors; ++i) {
+    struct rb_soft_surface* surface = draw->color_list[i];
+    unsigned char* pixel = NULL;
+    unsigned char encoded[16];
+    float dst[4];
+    float color[4];
+
+    if(!surface)
+      continue;
+    pixel = surface->data
+      + ((size_t)y * surface->width + (size_t)x) * surface->pixel_size;
+    /* Blending is not applied to the integer render targets. */
+    if(blend_desc->enable && !rb_soft_is_uint_format(surface->format)) {
+      rb_soft_decode_color(surface->format, pixel, dst);
+      blend(blend_desc, colors[i], dst, color);
+      rb_soft_encode_color(surface->format, color, encoded);
+    } else {
+      rb_soft_encode_color(surface->format, colors[i], encoded);
+    }
+    memcpy(pixel, encoded, surface->pixel_size);
+  }
+}
+
+static void
+shade_fragment
+  (const struct draw* draw,
+   const struct prim* prim,
+   int x,
+   int y)
+{
+  float varyings[RB_SOFT_MAX_VARYINGS];
+  float colors[RB_SOFT_MAX_OUTPUTS][4];
+  const struct rb_depth_stencil_desc* ds = &draw->ctxt->state.depth_stencil;
+  const struct rb_stencil_op_desc* op = NULL;
+  const float* vary = draw->raster->prim_data + prim->varyings;
+  struct rb_soft_surface* depth_stencil = draw->depth_stencil;
+  size_t id = 0;
+  uint32_t* packed = NULL;
+  uint32_t stencil = 0;
+  uint32_t ref = 0;
+  uint32_t new_stencil = 0;
+  uint32_t depth24 = 0;
+  float l[3];
+  float z = 0.f;
+  float w = 0.f;
+  unsigned int i = 0;
+  int has_depth = 0;
+  int has_stencil = 0;
+  int stencil_pass = 1;
+  int depth_pass = 1;
+
+  /* Barycentric coordinates of the pixel center. */
+  for(i = 1; i < 3; ++i) {
+    l[i] = (float)(prim->a[i] * x + prim->b[i] * y + prim->c[i])
+      * prim->inv_area;
+  }
+  l[0] = 1.f - l[1] - l[2];
+  z = l[0] * prim->z[0] + l[1] * prim->z[1] + l[2] * prim->z[2];
+  z = MIN(MAX(z, 0.f), 1.f);
+
+  if(depth_stencil) {
+    id = (size_t)y * depth_stencil->width + (size_t)x;
+    has_depth = ds->enable_depth_test;
+    has_stencil = ds->enable_stencil_test
+      && depth_stencil->format == RB_DEPTH_STENCIL;
+  }
+
+  /* Depth and stencil tests. */
+  if(has_stencil) {
+    packed = (uint32_t*)depth_stencil->data + id;
+    op = prim->is_front ? &ds->front_face_op : &ds->back_face_op;
+    ref = (uint32_t)MIN(MAX(ds->stencil_ref, 0), 0xFF);
+    stencil = *packed & 0xFF;
+    stencil_pass = compare_uint(op->stencil_func, ref, stencil);
+  }
+  if(has_depth && stencil_pass) {
+    if(depth_stencil->format == RB_DEPTH_STENCIL) {
+      depth24 = rb_soft_encode_depth24(z);
+      depth_pass = compare_uint(ds->depth_func, depth24 >> 8,
+        ((uint32_t*)depth_stencil->data)[id] >> 8);
+    } else {
+      depth_pass = compare_float(ds->depth_func, z,
+        ((float*)depth_stencil->data)[id]);
+    }
+  }
+  if(!stencil_pass || !depth_pass) {
+    /* The fragment is shaded only if it may update the stencil, i.e. if it
+     * is not discarded by the fragment shader. */
+    const enum rb_stencil_op sop = has_stencil
+      ? (!stencil_pass ? op->stencil_fail : op->depth_fail)
+      : RB_STENCIL_OP_KEEP;
+    if(sop == RB_STENCIL_OP_KEEP)
+      return;
+  }
+
+  /* Perspective correct interpolation of the varyings. */
+  w = 1.f / (l[0]*prim->inv_w[0] + l[1]*prim->inv_w[1] + l[2]*prim->inv_w[2]);
+  for(i = 0; i < draw->nb_varyings; ++i) {
+    varyings[i] = w *
+      ( l[0] * vary[i]
+      + l[1] * vary[draw->nb_varyings + i]
+      + l[2] * vary[2 * draw->nb_varyings + i]);
+  }
+  if(!draw->program->fragment->fragment(&draw->fragment_env, varyings, colors))
+    return;
+
+  if(has_stencil) {
+    const uint32_t mask = op->write_mask & 0xFF;
+    const enum rb_stencil_op sop = !stencil_pass ? op->stencil_fail
+      : !depth_pass ? op->depth_fail : op->depth_pass;
+    new_stencil = stencil_op(sop, stencil, ref);
+    *packed = (*packed & ~mask) | (new_stencil & mask);
+  }
+  if(!stencil_pass || !depth_pass)
+    return;
+
+  if(has_depth && ds->enable_depth_write) {
+    if(depth_stencil->format == RB_DEPTH_STENCIL) {
+      packed = (uint32_t*)depth_stencil->data + id;
+      *packed = (*packed & 0xFF) | depth24;
+    } else {
+      ((float*)depth_stencil->data)[id] = z;
+    }
+  }
+  write_colors(draw, x, y, colors);
+}
+
+/*******************************************************************************
+ *
+ * Tile rasterization.
+ *
+ ******************************************************************************/
+static void
+raster_prim(const struct draw* draw, const struct prim* prim, int tx, int ty)
+{
+  const int x0 = MAX(tx, prim->x0);
+  const int y0 = MAX(ty, prim->y0);
+  const int x1 = MIN(tx + TILE_SIZE - 1, prim->x1);
+  const int y1 = MIN(ty + TILE_SIZE - 1, prim->y1);
+  int32_t step[3] = { 0, 0, 0 };
+  int32_t row[3] = { 0, 0, 0 };
+  int is_partial[3] = { 0, 0, 0 };
+  int nb_partials = 0;
+  int x = 0;
+  int y = 0;
+  int i = 0;
+  ASSERT(draw && prim);
+
+  if(x0 > x1 || y0 > y1)
+    return;
+
+  /* Classify the edges against the pixels of the prim into the tile. */
+  for(i = 0; i < 3; ++i) {
+    const int64_t emax = prim->a[i] * (prim->a[i] > 0 ? x1 : x0)
+      + prim->b[i] * (prim->b[i] > 0 ? y1 : y0) + prim->c[i];
+    const int64_t emin = prim->a[i] * (prim->a[i] > 0 ? x0 : x1)
+      + prim->b[i] * (prim->b[i] > 0 ? y0 : y1) + prim->c[i];
+    if(emax < 0)
+      return;
+    is_partial[i] = emin < 0;
+    nb_partials += is_partial[i];
+  }
+
+  if(!nb_partials) { /* The pixels are fully covered. */
+    for(y = y0; y <= y1; ++y) {
+      for(x = x0; x <= x1; ++x)
+        shade_fragment(draw, prim, x, y);
+    }
+    return;
+  }
+
+  /* The edge functions of the partial edges are stepped in 32 bits since
+   * their range into the tile is bounded by the guard band. The sign bit of
+   * the edge functions is set for the uncovered pixels. */
+  for(i = 0; i < 3; ++i) {
+    if(is_partial[i])
+      step[i] = (int32_t)prim->a[i];
+  }
+  for(y = y0; y <= y1; ++y) {
+    for(i = 0; i < 3; ++i) {
+      if(is_partial[i])
+        row[i] = (int32_t)(prim->a[i]*x0 + prim->b[i]*y + prim->c[i]);
+    }
+#ifdef __SSE2__
+    {
+      __m128i e[3];
+      __m128i inc[3];
+      for(i = 0; i < 3; ++i) {
+        e[i] = _mm_add_epi32(_mm_set1_epi32(row[i]),
+          _mm_set_epi32(3 * step[i], 2 * step[i], step[i], 0));
+        inc[i] = _mm_set1_epi32(4 * step[i]);
+      }
+      for(x = x0; x <= x1; x += 4) {
+        const __m128i m = _mm_or_si128(_mm_or_si128(e[0], e[1]), e[2]);
+        int mask = ~_mm_movemask_ps(_mm_castsi128_ps(m)) & 0xF;
+        if(x1 - x < 3)
+          mask &= (1 << (x1 - x + 1)) - 1;
+        for(i = 0; mask; ++i, mask >>= 1) {
+          if(mask & 1)
+            shade_fragment(draw, prim, x + i, y);
+        }
+        for(i = 0; i < 3; ++i)
+          e[i] = _mm_add_epi32(e[i], inc[i]);
+      }
+    }
+#else
+    for(x = x0; x <= x1; ++x) {
+      if((row[0] | row[1] | row[2]) >= 0)
+        shade_fragment(draw, prim, x, y);
+      for(i = 0; i < 3; ++i)
+        row[i] += step[i];
+    }
+#endif
+  }
+}
+
+static void
+raster_tile(void* data, size_t task, unsigned int thread_id)
+{
+  const struct draw* draw = data;
+  const struct tile* tile = NULL;
+  uint32_t itile = 0;
+  size_t i = 0;
+  int tx = 0;
+  int ty = 0;
+  ASSERT(data);
+  (void)thread_id;
+
+  itile = draw->raster->active_tile_list[task];
+  tile = draw->raster->tile_list + itile;
+  tx = (int)(itile % draw->nb_tiles_x) << TILE_SIZE_LOG2;
+  ty = (int)(itile / draw->nb_tiles_x) << TILE_SIZE_LOG2;
+  for(i = 0; i < tile->nb_prims; ++i)
+    raster_prim(draw, draw->raster->prim_list + tile->prim_list[i], tx, ty);
+}
+
+/*******************************************************************************
+ *
+ * Draw setup.
+ *
+ ******************************************************************************/
+static int
+setup_render_targets(struct rb_context* ctxt, struct draw* draw)
+{
+  const struct rb_framebuffer* buffer = ctxt->state.framebuffer;
+  const struct rb_viewport_desc* vp = &ctxt->state.viewport;
+  const unsigned int nb_outputs = draw->program->fragment->nb_outputs;
+  unsigned int width = 0;
+  unsigned int height = 0;
+  unsigned int i = 0;
+  ASSERT(ctxt && draw);
+
+  if(buffer) {
+    width = buffer->desc.width;
+    height = buffer->desc.height;
+    draw->nb_colors = MIN(nb_outputs, buffer->desc.buffer_count);
+    for(i = 0; i < draw->nb_colors; ++i) {
+      draw->color_list[i] =
+        rb_soft_render_target_surface(buffer->render_target_list + i);
+    }
+    draw->depth_stencil = rb_soft_render_target_surface(&buffer->depth_stencil);
+  } else {
+    /* The context has no default framebuffer. */
+    if(!ctxt->default_color.data)
+      return 0;
+    width = ctxt->default_color.width;
+    height = ctxt->default_color.height;
+    draw->nb_colors = MIN(nb_outputs, 1);
+    draw->color_list[0] = &ctxt->default_color;
+    if(ctxt->default_depth_stencil.data)
+      draw->depth_stencil = &ctxt->default_depth_stencil;
+  }
+
+  /* The fragments are clipped to the viewport. */
+  draw->clip_rect[0] = MAX(vp->x, 0);
+  draw->clip_rect[1] = MAX(vp->y, 0);
+  draw->clip_rect[2] = MIN(vp->x + vp->width, (int)width) - 1;
+  draw->clip_rect[3] = MIN(vp->y + vp->height, (int)height) - 1;
+  if(draw->clip_rect[0] > draw->clip_rect[2]
+  || draw->clip_rect[1] > draw->clip_rect[3])
+    return 0;
+  draw->nb_tiles_x = (width + TILE_SIZE - 1) >> TILE_SIZE_LOG2;
+  return (int)(draw->nb_tiles_x * ((height+TILE_SIZE-1) >> TILE_SIZE_LOG2));
+}
+
+static void
+setup_transform(const struct rb_viewport_desc* vp, struct draw* draw)
+{
+  float guard_x = 0.f;
+  float guard_y = 0.f;
+  int i = 0;
+  ASSERT(vp && draw && vp->width > 0 && vp->height > 0);
+
+  draw->scale[0] = (float)vp->width * 0.5f;
+  draw->scale[1] = (float)vp->height * 0.5f;
+  draw->scale[2] = (vp->max_depth - vp->min_depth) * 0.5f;
+  draw->offset[0] = (float)vp->x + draw->scale[0];
+  draw->offset[1] = (float)vp->y + draw->scale[1];
+  draw->offset[2] = (vp->max_depth + vp->min_depth) * 0.5f;
+
+  /* Guard band in normalized device coordinates. */
+  guard_x = (GUARD_BAND - fabsf(draw->offset[0])) / draw->scale[0];
+  guard_y = (GUARD_BAND - fabsf(draw->offset[1])) / draw->scale[1];
+
+  memset(draw->clip_planes, 0, sizeof(draw->clip_planes));
+  i = 0;
+  /* Near and far planes. */
+  draw->clip_planes[i][2] = 1.f, draw->clip_planes[i++][3] = 1.f;
+  draw->clip_planes[i][2] =-1.f, draw->clip_planes[i++][3] = 1.f;
+  /* Guard band. */
+  draw->clip_planes[i][0] =-1.f, draw->clip_planes[i++][3] = guard_x;
+  draw->clip_planes[i][0] = 1.f, draw->clip_planes[i++][3] = guard_x;
+  draw->clip_planes[i][1] =-1.f, draw->clip_planes[i++][3] = guard_y;
+  draw->clip_planes[i][1] = 1.f, draw->clip_planes[i++][3] = guard_y;
+  /* Positive w. */
+  draw->clip_planes[i][3] = 1.f, draw->clip_planes[i++][4] = -1.e-6f;
+  ASSERT(i == NB_CLIP_PLANES);
+}
+
+static int
+setup_vertices
+  (struct draw* draw,
+   const struct rb_draw_range* range,
+   int indexed)
+{
+  const struct rb_buffer* index_buffer = NULL;
+  const unsigned int count = range->count;
+  uint32_t imin = UINT32_MAX;
+  uint32_t imax = 0;
+  size_t i = 0;
+  ASSERT(draw && range && range->count);
+
+  draw->count = count;
+  draw->base_vertex = range->base_vertex;
+  if(!indexed) {
+    draw->first_vertex = range->first_index;
+    draw->nb_vertices = count;
+    return 0;
+  }
+  if(!draw->varray || !draw->varray->index_buffer)
+    return -1;
+  index_buffer = draw->varray->index_buffer;
+  if(((size_t)range->first_index + count) * sizeof(uint32_t)
+     > (size_t)index_buffer->size)
+    return -1;
+  draw->index_list = (const uint32_t*)index_buffer->data + range->first_index;
+
+  /* Shade the range of the referenced vertices if it is compact. Otherwise
+   * each index is shaded. */
+  for(i = 0; i < count; ++i) {
+    imin = MIN(imin, draw->index_list[i]);
+    imax = MAX(imax, draw->index_list[i]);
+  }
+  if((size_t)(imax - imin) < (size_t)count * 4) {
+    draw->first_vertex = imin;
+    draw->nb_vertices = (size_t)(imax - imin) + 1;
+  } else {
+    draw->per_index = 1;
+    draw->nb_vertices = count;
+  }
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+int
+rb_soft_create_raster
+  (struct rb_context* ctxt,
+   struct rb_soft_raster** out_raster)
+{
+  struct rb_soft_raster* raster = NULL;
+  ASSERT(ctxt && out_raster);
+
+  raster = MEM_CALLOC(ctxt->allocator, 1, sizeof(struct rb_soft_raster));
+  if(!raster)
+    return -1;
+  raster->allocator = ctxt->allocator;
+  *out_raster = raster;
+  return 0;
+}
+
+void
+rb_soft_release_raster(struct rb_context* ctxt, struct rb_soft_raster* raster)
+{
+  size_t i = 0;
+  ASSERT(ctxt && raster);
+
+  for(i = 0; i < raster->max_nb_tiles; ++i) {
+    if(raster->tile_list[i].prim_list)
+      MEM_FREE(ctxt->allocator, raster->tile_list[i].prim_list);
+  }
+  if(raster->tile_list)
+    MEM_FREE(ctxt->allocator, raster->tile_list);
+  if(raster->active_tile_list)
+    MEM_FREE(ctxt->allocator, raster->active_tile_list);
+  if(raster->prim_data)
+    MEM_FREE(ctxt->allocator, raster->prim_data);
+  if(raster->prim_list)
+    MEM_FREE(ctxt->allocator, raster->prim_list);
+  if(raster->vertex_list)
+    MEM_FREE(ctxt->allocator, raster->vertex_list);
+  MEM_FREE(ctxt->allocator, raster);
+}
+
+int
+rb_soft_draw
+  (struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   const struct rb_draw_range* range,
+   int indexed)
+{
+  struct draw draw;
+  struct rb_soft_raster* raster = NULL;
+  const struct rb_viewport_desc* vp = NULL;
+  void* mem = NULL;
+  size_t nb_tiles = 0;
+  size_t i = 0;
+  int err = 0;
+  ASSERT(ctxt && range);
+
+  if((unsigned int)prim_type > RB_TRIANGLE_STRIP)
+    return -1;
+
+  memset(&draw, 0, sizeof(struct draw));
+  draw.ctxt = ctxt;
+  draw.raster = raster = ctxt->raster;
+  draw.program = ctxt->state.program;
+  draw.varray = ctxt->state.vertex_array;
+  vp = &ctxt->state.viewport;
+  if(indexed && (!draw.varray || !draw.varray->index_buffer))
+    return -1;
+  if(!draw.program || !range->count || vp->width <= 0 || vp->height <= 0)
+    return 0;
+
+  nb_tiles = (size_t)setup_render_targets(ctxt, &draw);
+  if(!nb_tiles) /* Nothing to render. */
+    return 0;
+  setup_transform(vp, &draw);
+  if(setup_vertices(&draw, range, indexed) != 0)
+    return -1;
+  draw.nb_varyings = draw.program->fragment->nb_varyings;
+  draw.vertex_size = 4 + draw.program->vertex->nb_varyings;
+  draw.vertex_env.uniforms = draw.program->vertex_uniforms;
+  draw.vertex_env.tex_units = ctxt->state.tex_units;
+  draw.fragment_env.uniforms = draw.program->fragment_uniforms;
+  draw.fragment_env.tex_units = ctxt->state.tex_units;
+
+  /* Allocate the working data. The new tiles are empty. */
+  mem = reserve(raster->allocator, raster->vertex_list,
+    &raster->max_vertex_list, draw.nb_vertices * draw.vertex_size,
+    sizeof(float));
+  if(!mem)
+    return -1;
+  raster->vertex_list = mem;
+  if(nb_tiles > raster->max_nb_tiles) {
+    const size_t nb_old_tiles = raster->max_nb_tiles;
+    mem = reserve(raster->allocator, raster->tile_list, &raster->max_nb_tiles,
+      nb_tiles, sizeof(struct tile));
+    if(!mem)
+      return -1;
+    raster->tile_list = mem;
+    memset(raster->tile_list + nb_old_tiles, 0,
+      (raster->max_nb_tiles - nb_old_tiles) * sizeof(struct tile));
+  }
+
+  /* Shade the vertices, bin the primitives in submission order and then
+   * rasterize the tiles in parallel. */
+  rb_thread_pool_run(ctxt->pool, (draw.nb_vertices+VERTEX_BATCH-1)/VERTEX_BATCH,
+    shade_vertices, &draw);
+  err = assemble_primitives(&draw, prim_type);
+  if(!err)
+    rb_thread_pool_run(ctxt->pool, raster->nb_active_tiles, raster_tile, &draw);
+
+  for(i = 0; i < raster->nb_active_tiles; ++i)
+    raster->tile_list[raster->active_tile_list[i]].nb_prims = 0;
+  raster->nb_active_tiles = 0;
+  raster->nb_prims = 0;
+  raster->prim_data_size = 0;
+  return err;
+}
@@ -0,0 +1,30 @@
+#ifndef RB_SOFT_RASTER_H
+#define RB_SOFT_RASTER_H
+
+#include "rb_types.h"
+#include <snlsys/snlsys.h>
+
+struct rb_context;
+struct rb_soft_raster;
+
+LOCAL_SYM int
+rb_soft_create_raster
+  (struct rb_context* ctxt,
+   struct rb_soft_raster** out_raster);
+
+LOCAL_SYM void
+rb_soft_release_raster
+  (struct rb_context* ctxt,
+   struct rb_soft_raster* raster);
+
+/* Render the range of vertices of the bound vertex array with the current
+ * state. The vertices are indexed by the range of the bound index buffer if
+ * `indexed' is not null. The draw is complete when the function returns. */
+LOCAL_SYM int
+rb_soft_draw
+  (struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   const struct rb_draw_range* range,
+   int indexed);
+
+#endif /* RB_SOFT_RASTER_H */
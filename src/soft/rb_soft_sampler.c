@@ -0,0 +1,248 @@
+#include "soft/rb_soft_context.h"
+#include "soft/rb_soft_texture.h"
+#include "rb.h"
+#include <snlsys/mem_allocator.h>
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+#include <math.h>
+#include <string.h>
+
+struct rb_sampler {
+  struct ref ref;
+  struct rb_context* ctxt;
+  struct rb_sampler_desc desc;
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+/* Only the mip level 0 is sampled and thus the magnification filter is the
+ * only filter that is used. */
+static FINLINE int
+is_mag_linear(enum rb_tex_filter filter)
+{
+  switch(filter) {
+    case RB_MIN_POINT_MAG_LINEAR_MIP_POINT:
+    case RB_MIN_LINEAR_MAG_LINEAR_MIP_POINT:
+    case RB_MIN_POINT_MAG_LINEAR_MIP_LINEAR:
+    case RB_MIN_LINEAR_MAG_LINEAR_MIP_LINEAR:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+static FINLINE unsigned int
+address(enum rb_tex_address mode, long i, unsigned int size)
+{
+  const long n = (long)size;
+  switch(mode) {
+    case RB_ADDRESS_CLAMP:
+      i = i < 0 ? 0 : (i >= n ? n - 1 : i);
+      break;
+    case RB_ADDRESS_WRAP:
+      i %= n;
+      if(i < 0)
+        i += n;
+      break;
+    default: ASSERT(0); break;
+  }
+  return (unsigned int)i;
+}
+
+static FINLINE float
+srgb_to_linear(float c)
+{
+  return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static FINLINE void
+fetch
+  (const struct rb_soft_surface* surface,
+   unsigned int x,
+   unsigned int y,
+   float rgba[4])
+{
+  const size_t offset = ((size_t)y * surface->width + x) * surface->pixel_size;
+  rb_soft_decode_color(surface->format, surface->data + offset, rgba);
+  if(surface->format == RB_SRGB || surface->format == RB_SRGBA) {
+    rgba[0] = srgb_to_linear(rgba[0]);
+    rgba[1] = srgb_to_linear(rgba[1]);
+    rgba[2] = srgb_to_linear(rgba[2]);
+  }
+}
+
+static void
+release_sampler(struct ref* ref)
+{
+  struct rb_context* ctxt = NULL;
+  struct rb_sampler* sampler = NULL;
+  unsigned int i = 0;
+  ASSERT(ref);
+
+  sampler = CONTAINER_OF(ref, struct rb_sampler, ref);
+  ctxt = sampler->ctxt;
+
+  for(i = 0; i < RB_SOFT_MAX_TEXTURE_UNITS; ++i) {
+    if(ctxt->state.tex_units[i].sampler == sampler)
+      RB(bind_sampler(ctxt, NULL, i));
+  }
+  rb_soft_free_object(ctxt, RB_OBJECT_SAMPLER, sampler);
+  RB(context_ref_put(ctxt));
+}
+
+/*******************************************************************************
+ *
+ * Sampler functions.
+ *
+ ******************************************************************************/
+int
+rb_create_sampler
+  (struct rb_context* ctxt,
+   const struct rb_sampler_desc* desc,
+   struct rb_sampler** out_sampler)
+{
+  struct rb_sampler* sampler = NULL;
+  int err = 0;
+
+  if(!ctxt || !desc || !out_sampler)
+    goto error;
+
+  sampler = rb_soft_alloc_object
+    (ctxt, RB_OBJECT_SAMPLER, sizeof(struct rb_sampler));
+  if(!sampler)
+    goto error;
+  ref_init(&sampler->ref);
+  RB(context_ref_get(ctxt));
+  sampler->ctxt = ctxt;
+
+  err = rb_sampler_parameters(sampler, desc);
+  if(0 != err)
+    goto error;
+
+exit:
+  if(out_sampler)
+    *out_sampler = sampler;
+  return err;
+error:
+  if(sampler) {
+    RB(sampler_ref_put(sampler));
+    sampler = NULL;
+  }
+  err = -1;
+  goto exit;
+}
+
+int
+rb_sampler_ref_get(struct rb_sampler* sampler)
+{
+  if(!sampler)
+    return -1;
+  ref_get(&sampler->ref);
+  return 0;
+}
+
+int
+rb_sampler_ref_put(struct rb_sampler* sampler)
+{
+  if(!sampler)
+    return -1;
+  ref_put(&sampler->ref, release_sampler);
+  return 0;
+}
+
+int
+rb_sampler_parameters
+  (struct rb_sampler* sampler,
+   const struct rb_sampler_desc* desc)
+{
+  if(!sampler
+  || !desc
+  || desc->min_lod > desc->max_lod
+  || desc->max_anisotropy > sampler->ctxt->config.max_tex_max_anisotropy)
+    return -1;
+  memcpy(&sampler->desc, desc, sizeof(struct rb_sampler_desc));
+  return 0;
+}
+
+int
+rb_bind_sampler
+  (struct rb_context* ctxt,
+   struct rb_sampler* sampler,
+   unsigned int tex_unit)
+{
+  if(!ctxt || tex_unit >= RB_SOFT_MAX_TEXTURE_UNITS)
+    return -1;
+  ctxt->state.tex_units[tex_unit].sampler = sampler;
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Software shader functions.
+ *
+ ******************************************************************************/
+void
+rb_soft_sample2d
+  (const struct rb_soft_shader_env* env,
+   unsigned int tex_unit,
+   const float uv[2],
+   float rgba[4])
+{
+  /* Default parameters of the OpenGL texture objects. */
+  enum rb_tex_filter filter = RB_MIN_LINEAR_MAG_LINEAR_MIP_LINEAR;
+  enum rb_tex_address address_u = RB_ADDRESS_WRAP;
+  enum rb_tex_address address_v = RB_ADDRESS_WRAP;
+  const struct rb_soft_texture_unit* unit = NULL;
+  const struct rb_soft_surface* surface = NULL;
+  ASSERT(env && uv && rgba);
+
+  if(tex_unit >= RB_SOFT_MAX_TEXTURE_UNITS
+  || !env->tex_units[tex_unit].tex) {
+    rgba[0] = rgba[1] = rgba[2] = 0.f;
+    rgba[3] = 1.f;
+    return;
+  }
+  unit = env->tex_units + tex_unit;
+  surface = unit->tex->mip_list;
+  if(unit->sampler) {
+    filter = unit->sampler->desc.filter;
+    address_u = unit->sampler->desc.address_u;
+    address_v = unit->sampler->desc.address_v;
+  }
+
+  if(!is_mag_linear(filter)) {
+    const long x = (long)floorf(uv[0] * (float)surface->width);
+    const long y = (long)floorf(uv[1] * (float)surface->height);
+    fetch
+      (surface,
+       address(address_u, x, surface->width),
+       address(address_v, y, surface->height),
+       rgba);
+  } else {
+    const float u = uv[0] * (float)surface->width - 0.5f;
+    const float v = uv[1] * (float)surface->height - 0.5f;
+    const float fu = floorf(u);
+    const float fv = floorf(v);
+    const float du = u - fu;
+    const float dv = v - fv;
+    const unsigned int x0 = address(address_u, (long)fu, surface->width);
+    const unsigned int x1 = address(address_u, (long)fu + 1, surface->width);
+    const unsigned int y0 = address(address_v, (long)fv, surface->height);
+    const unsigned int y1 = address(address_v, (long)fv + 1, surface->height);
+    float texels[4][4];
+    int i = 0;
+
+    fetch(surface, x0, y0, texels[0]);
+    fetch(surface, x1, y0, texels[1]);
+    fetch(surface, x0, y1, texels[2]);
+    fetch(surface, x1, y1, texels[3]);
+    for(i = 0; i < 4; ++i) {
+      const float bottom = texels[0][i] + du * (texels[1][i] - texels[0][i]);
+      const float top = texels[2][i] + du * (texels[3][i] - texels[2][i]);
+      rgba[i] = bottom + dv * (top - bottom);
+    }
+  }
+}
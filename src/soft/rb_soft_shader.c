@@ -0,0 +1,295 @@
+#include "soft/rb_soft_context.h"
+#include "soft/rb_soft_program.h"
+#include "rb.h"
+#include <snlsys/list.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/snlsys.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static struct rb_soft_registered_shader*
+find_registered_shader
+  (struct rb_context* ctxt,
+   const char* name,
+   size_t length)
+{
+  struct list_node* node = NULL;
+  ASSERT(ctxt && (name || !length));
+
+  LIST_FOR_EACH(node, &ctxt->shader_registry) {
+    struct rb_soft_registered_shader* shader = CONTAINER_OF
+      (node, struct rb_soft_registered_shader, node);
+    if(strlen(shader->name) == length && !strncmp(shader->name, name, length))
+      return shader;
+  }
+  return NULL;
+}
+
+static int
+is_shader_desc_valid(const struct rb_soft_shader_desc* desc)
+{
+  size_t i = 0;
+  ASSERT(desc);
+
+  if(desc->nb_varyings > RB_SOFT_MAX_VARYINGS
+  || (desc->nb_uniforms && !desc->uniform_list))
+    return 0;
+  for(i = 0; i < desc->nb_uniforms; ++i) {
+    if(!desc->uniform_list[i].name
+    || (unsigned int)desc->uniform_list[i].type > RB_FLOAT4x4)
+      return 0;
+  }
+
+  switch(desc->type) {
+    case RB_VERTEX_SHADER:
+      if(!desc->vertex
+      || desc->nb_attribs > RB_SOFT_MAX_ATTRIBS
+      || (desc->nb_attribs && !desc->attrib_list))
+        return 0;
+      for(i = 0; i < desc->nb_attribs; ++i) {
+        if(!desc->attrib_list[i].name
+        || desc->attrib_list[i].type < RB_FLOAT
+        || desc->attrib_list[i].type > RB_FLOAT4
+        || desc->attrib_list[i].location < 0
+        || desc->attrib_list[i].location >= RB_SOFT_MAX_ATTRIBS)
+          return 0;
+      }
+      break;
+    case RB_FRAGMENT_SHADER:
+      if(!desc->fragment || desc->nb_outputs > RB_SOFT_MAX_OUTPUTS)
+        return 0;
+      break;
+    default: /* The geometry shaders are not supported. */
+      return 0;
+  }
+  return 1;
+}
+
+static void
+release_shader(struct ref* ref)
+{
+  struct rb_context* ctxt = NULL;
+  struct rb_shader* shader = NULL;
+  ASSERT(ref);
+
+  shader = CONTAINER_OF(ref, struct rb_shader, ref);
+  ctxt = shader->ctxt;
+
+  if(shader->is_variant)
+    rb_remove_shader_variant(&ctxt->variant_cache, shader->variant_key, shader);
+  if(shader->log)
+    MEM_FREE(ctxt->allocator, shader->log);
+  rb_soft_free_object(ctxt, RB_OBJECT_SHADER, shader);
+  RB(context_ref_put(ctxt));
+}
+
+/*******************************************************************************
+ *
+ * Shader functions.
+ *
+ ******************************************************************************/
+int
+rb_create_shader
+  (struct rb_context* ctxt,
+   enum rb_shader_type type,
+   const char* source,
+   size_t length,
+   struct rb_shader** out_shader)
+{
+  int err = 0;
+  struct rb_shader* shader = NULL;
+
+  if(!ctxt || !out_shader)
+    goto error;
+
+  shader = rb_soft_alloc_object
+    (ctxt, RB_OBJECT_SHADER, sizeof(struct rb_shader));
+  if(!shader)
+    goto error;
+  ref_init(&shader->ref);
+  RB(context_ref_get(ctxt));
+  shader->ctxt = ctxt;
+  shader->type = type;
+
+  err = rb_shader_source(shader, source, length);
+
+exit:
+  if(out_shader)
+    *out_shader = shader;
+  return err;
+
+error:
+  if(shader) {
+    RB(shader_ref_put(shader));
+    shader = NULL;
+  }
+  err = -1;
+  goto exit;
+}
+
+int
+rb_shader_source(struct rb_shader* shader, const char* source, size_t length)
+{
+  struct rb_soft_registered_shader* registered = NULL;
+  int err = 0;
+
+  if(!shader || (length > 0 && !source))
+    return -1;
+
+  /* The variant no longer matches its preprocessed source. */
+  if(shader->is_variant) {
+    rb_remove_shader_variant
+      (&shader->ctxt->variant_cache, shader->variant_key, shader);
+    shader->is_variant = 0;
+  }
+
+  /* The source is the name of registered shader functions. */
+  shader->desc = NULL;
+  registered = find_registered_shader(shader->ctxt, source, length);
+  if(!registered) {
+    rb_soft_set_log(shader->ctxt, &shader->log,
+      "unregistered software shader `%.*s'", (int)length, source ? source:"");
+    err = -1;
+  } else if(registered->desc.type != shader->type) {
+    rb_soft_set_log(shader->ctxt, &shader->log,
+      "the software shader `%s' has not the expected type", registered->name);
+    err = -1;
+  } else {
+    shader->desc = &registered->desc;
+    if(shader->log) {
+      MEM_FREE(shader->ctxt->allocator, shader->log);
+      shader->log = NULL;
+    }
+  }
+  return err;
+}
+
+int
+rb_create_shader_variant
+  (struct rb_context* ctxt,
+   const struct rb_shader_variant_desc* desc,
+   struct rb_shader** out_shader)
+{
+  struct rb_shader* shader = NULL;
+  char* source = NULL;
+  size_t length = 0;
+  uint64_t key = 0;
+  int err = 0;
+
+  if(!ctxt || !desc || !out_shader)
+    goto error;
+  if(rb_preprocess_shader_variant(ctxt->allocator, desc, &source, &length))
+    goto error;
+
+  key = rb_shader_variant_key(desc->type, source, length);
+  shader = rb_find_shader_variant
+    (&ctxt->variant_cache, key, desc->type, source, length);
+  if(shader) {
+    RB(shader_ref_get(shader));
+  } else {
+    err = rb_create_shader(ctxt, desc->type, source, length, &shader);
+    /* A shader whose source is not registered is returned for its log but is
+     * not shared. The variant is simply not shared if it cannot be cached. */
+    if(!err && rb_add_shader_variant
+       (&ctxt->variant_cache, key, desc->type, source, length, shader) == 0) {
+      shader->variant_key = key;
+      shader->is_variant = 1;
+    }
+  }
+
+exit:
+  if(source)
+    MEM_FREE(ctxt->allocator, source);
+  if(out_shader)
+    *out_shader = shader;
+  return err;
+
+error:
+  err = -1;
+  goto exit;
+}
+
+int
+rb_shader_ref_get(struct rb_shader* shader)
+{
+  if(!shader)
+    return -1;
+  ref_get(&shader->ref);
+  return 0;
+}
+
+int
+rb_shader_ref_put(struct rb_shader* shader)
+{
+  if(!shader)
+    return -1;
+  ref_put(&shader->ref, release_shader);
+  return 0;
+}
+
+int
+rb_get_shader_log(struct rb_shader* shader, const char** out_log)
+{
+  if(!shader || !out_log)
+    return -1;
+  *out_log = shader->log;
+  return 0;
+}
+
+int
+rb_is_shader_attached(struct rb_shader* shader, int* out_is_attached)
+{
+  if(!shader || !out_is_attached)
+    return -1;
+  *out_is_attached = shader->nb_attachments != 0;
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Software shader functions.
+ *
+ ******************************************************************************/
+int
+rb_soft_register_shader
+  (struct rb_context* ctxt,
+   const char* name,
+   const struct rb_soft_shader_desc* desc)
+{
+  struct rb_soft_registered_shader* shader = NULL;
+  size_t len = 0;
+  int err = 0;
+
+  if(!ctxt || !name || !desc || !is_shader_desc_valid(desc))
+    goto error;
+
+  /* The shaders refer to the registered descriptors that thus cannot be
+   * overwritten. */
+  len = strlen(name);
+  if(find_registered_shader(ctxt, name, len))
+    goto error;
+
+  shader = MEM_CALLOC
+    (ctxt->allocator, 1, sizeof(struct rb_soft_registered_shader));
+  if(!shader)
+    goto error;
+  list_init(&shader->node);
+  shader->desc = *desc;
+  shader->name = rb_intern_string(&ctxt->names, name, len);
+  if(!shader->name)
+    goto error;
+  list_add(&ctxt->shader_registry, &shader->node);
+
+exit:
+  return err;
+error:
+  if(shader)
+    MEM_FREE(ctxt->allocator, shader);
+  err = -1;
+  goto exit;
+}
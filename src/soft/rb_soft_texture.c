@@ -0,0 +1,367 @@
+#include "soft/rb_soft_context.h"
+#include "soft/rb_soft_texture.h"
+#include "rb.h"
+#include <snlsys/math.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/snlsys.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static FINLINE int
+is_format_compressible(enum rb_tex_format fmt)
+{
+  return
+     fmt == RB_R
+  || fmt == RB_RGB
+  || fmt == RB_RGBA
+  || fmt == RB_SRGB
+  || fmt == RB_SRGBA;
+}
+
+static FINLINE unsigned int
+nb_components(enum rb_tex_format fmt)
+{
+  unsigned int nb = 0;
+  switch(fmt) {
+    case RB_R:
+    case RB_R_UINT16:
+    case RB_R_UINT32:
+    case RB_DEPTH_COMPONENT:
+    case RB_DEPTH_STENCIL:
+      nb = 1;
+      break;
+    case RB_RG_UINT16:
+    case RB_RG_UINT32:
+      nb = 2;
+      break;
+    case RB_RGB:
+    case RB_SRGB:
+    case RB_RGB_UINT16:
+    case RB_RGB_UINT32:
+      nb = 3;
+      break;
+    case RB_RGBA:
+    case RB_SRGBA:
+    case RB_RGBA_UINT16:
+    case RB_RGBA_UINT32:
+      nb = 4;
+      break;
+    default: ASSERT(0); break;
+  }
+  return nb;
+}
+
+static FINLINE uint32_t
+max_uint_value(enum rb_tex_format fmt)
+{
+  switch(fmt) {
+    case RB_R_UINT16:
+    case RB_RG_UINT16:
+    case RB_RGB_UINT16:
+    case RB_RGBA_UINT16:
+      return UINT16_MAX;
+    default:
+      return UINT32_MAX;
+  }
+}
+
+static void
+unbind_tex2d(struct rb_context* ctxt, struct rb_tex2d* tex)
+{
+  unsigned int i = 0;
+  ASSERT(ctxt && tex);
+
+  for(i = 0; i < RB_SOFT_MAX_TEXTURE_UNITS; ++i) {
+    if(ctxt->state.tex_units[i].tex == tex)
+      RB(bind_tex2d(ctxt, NULL, i));
+  }
+}
+
+static void
+release_tex2d(struct ref* ref)
+{
+  struct rb_context* ctxt = NULL;
+  struct rb_tex2d* tex = NULL;
+  ASSERT(ref);
+
+  tex = CONTAINER_OF(ref, struct rb_tex2d, ref);
+  ctxt = tex->ctxt;
+
+  /* The textures of a loader context may be bound to the context it shares. */
+  unbind_tex2d(ctxt, tex);
+  if(ctxt->share != ctxt)
+    unbind_tex2d(ctxt->share, tex);
+
+  if(tex->mip_list)
+    MEM_FREE(ctxt->allocator, tex->mip_list);
+  if(tex->data)
+    MEM_FREE(ctxt->allocator, tex->data);
+  rb_soft_free_object(ctxt, RB_OBJECT_TEX2D, tex);
+  RB(context_ref_put(ctxt));
+}
+
+/*******************************************************************************
+ *
+ * Texture 2D functions.
+ *
+ ******************************************************************************/
+int
+rb_create_tex2d
+  (struct rb_context* ctxt,
+   const struct rb_tex2d_desc* desc,
+   const void* init_data[],
+   struct rb_tex2d** out_tex)
+{
+  struct rb_tex2d* tex = NULL;
+  size_t pixel_size = 0;
+  size_t size = 0;
+  unsigned int i = 0;
+  int err = 0;
+
+  if(!ctxt
+  || !desc
+  || !init_data
+  || !out_tex
+  || !desc->mip_count
+  || !desc->width
+  || !desc->height
+  || desc->width > ctxt->config.max_tex_size
+  || desc->height > ctxt->config.max_tex_size
+  || (desc->compress && !is_format_compressible(desc->format)))
+    goto error;
+
+  tex = rb_soft_alloc_object(ctxt, RB_OBJECT_TEX2D, sizeof(struct rb_tex2d));
+  if(!tex)
+    goto error;
+  ref_init(&tex->ref);
+  RB(context_ref_get(ctxt));
+  tex->ctxt = ctxt;
+
+  tex->mip_count = desc->mip_count;
+  tex->mip_list = MEM_CALLOC
+    (ctxt->allocator, tex->mip_count, sizeof(struct rb_soft_surface));
+  if(!tex->mip_list)
+    goto error;
+
+  /* The compression is a storage hint that is ignored. All the mip levels are
+   * stored in the same memory block. */
+  pixel_size = rb_soft_sizeof_pixel(desc->format);
+  for(i = 0, size = 0; i < desc->mip_count; ++i) {
+    tex->mip_list[i].width = MAX(desc->width / (1u<<i), 1u);
+    tex->mip_list[i].height = MAX(desc->height / (1u<<i), 1u);
+    tex->mip_list[i].format = desc->format;
+    tex->mip_list[i].pixel_size = pixel_size;
+    size += tex->mip_list[i].width * tex->mip_list[i].height * pixel_size;
+  }
+  tex->data = MEM_CALLOC(ctxt->allocator, 1, size);
+  if(!tex->data)
+    goto error;
+  for(i = 0, size = 0; i < desc->mip_count; ++i) {
+    tex->mip_list[i].data = tex->data + size;
+    size += tex->mip_list[i].width * tex->mip_list[i].height * pixel_size;
+    RB(tex2d_data(tex, i, init_data[i]));
+  }
+
+exit:
+  if(out_tex)
+    *out_tex = tex;
+  return err;
+error:
+  if(tex) {
+    RB(tex2d_ref_put(tex));
+    tex = NULL;
+  }
+  err = -1;
+  goto exit;
+}
+
+int
+rb_tex2d_ref_get(struct rb_tex2d* tex)
+{
+  if(!tex)
+    return -1;
+  ref_get(&tex->ref);
+  return 0;
+}
+
+int
+rb_tex2d_ref_put(struct rb_tex2d* tex)
+{
+  if(!tex)
+    return -1;
+  ref_put(&tex->ref, release_tex2d);
+  return 0;
+}
+
+int
+rb_bind_tex2d
+  (struct rb_context* ctxt,
+   struct rb_tex2d* tex,
+   unsigned int tex_unit)
+{
+  if(!ctxt || tex_unit >= RB_SOFT_MAX_TEXTURE_UNITS)
+    return -1;
+  ctxt->state.tex_units[tex_unit].tex = tex;
+  return 0;
+}
+
+int
+rb_tex2d_data(struct rb_tex2d* tex, unsigned int level, const void* data)
+{
+  struct rb_soft_surface* mip = NULL;
+
+  if(!tex || level >= tex->mip_count)
+    return -1;
+
+  /* A NULL data keeps the content of the mip level unchanged. */
+  if(data) {
+    mip = tex->mip_list + level;
+    memcpy(mip->data, data, mip->width * mip->height * mip->pixel_size);
+  }
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+size_t
+rb_soft_sizeof_pixel(enum rb_tex_format fmt)
+{
+  size_t sizeof_component = 0;
+  switch(fmt) {
+    case RB_R:
+    case RB_RGB:
+    case RB_RGBA:
+    case RB_SRGB:
+    case RB_SRGBA:
+      sizeof_component = sizeof(unsigned char);
+      break;
+    case RB_DEPTH_COMPONENT:
+      sizeof_component = sizeof(float);
+      break;
+    default: /* The integer pixels are stored as unsigned int. */
+      sizeof_component = sizeof(uint32_t);
+      break;
+  }
+  return sizeof_component * nb_components(fmt);
+}
+
+int
+rb_soft_is_uint_format(enum rb_tex_format fmt)
+{
+  return fmt >= RB_R_UINT16 && fmt <= RB_RGBA_UINT32;
+}
+
+int
+rb_soft_is_depth_format(enum rb_tex_format fmt)
+{
+  return fmt == RB_DEPTH_COMPONENT || fmt == RB_DEPTH_STENCIL;
+}
+
+int
+rb_soft_init_surface
+  (struct rb_context* ctxt,
+   struct rb_soft_surface* surface,
+   unsigned int width,
+   unsigned int height,
+   enum rb_tex_format format)
+{
+  ASSERT(ctxt && surface);
+  surface->width = width;
+  surface->height = height;
+  surface->format = format;
+  surface->pixel_size = rb_soft_sizeof_pixel(format);
+  surface->data = MEM_CALLOC
+    (ctxt->allocator, (size_t)width * height, surface->pixel_size);
+  return surface->data ? 0 : -1;
+}
+
+void
+rb_soft_release_surface
+  (struct rb_context* ctxt,
+   struct rb_soft_surface* surface)
+{
+  ASSERT(ctxt && surface);
+  if(surface->data)
+    MEM_FREE(ctxt->allocator, surface->data);
+  memset(surface, 0, sizeof(struct rb_soft_surface));
+}
+
+void
+rb_soft_encode_color
+  (enum rb_tex_format fmt,
+   const float rgba[4],
+   void* pixel)
+{
+  const unsigned int nb = nb_components(fmt);
+  unsigned int i = 0;
+  ASSERT(rgba && pixel);
+
+  if(rb_soft_is_uint_format(fmt)) {
+    const double max_val = (double)max_uint_value(fmt);
+    uint32_t* dst = pixel;
+    for(i = 0; i < nb; ++i)
+      dst[i] = (uint32_t)MIN(MAX((double)rgba[i], 0.0), max_val);
+  } else {
+    unsigned char* dst = pixel;
+    ASSERT(!rb_soft_is_depth_format(fmt));
+    for(i = 0; i < nb; ++i)
+      dst[i] = (unsigned char)(MIN(MAX(rgba[i], 0.f), 1.f) * 255.f + 0.5f);
+  }
+}
+
+void
+rb_soft_decode_color
+  (enum rb_tex_format fmt,
+   const void* pixel,
+   float rgba[4])
+{
+  const unsigned int nb = nb_components(fmt);
+  unsigned int i = 0;
+  ASSERT(pixel && rgba);
+
+  rgba[0] = rgba[1] = rgba[2] = 0.f;
+  rgba[3] = 1.f;
+  switch(fmt) {
+    case RB_DEPTH_COMPONENT:
+      rgba[0] = rgba[1] = rgba[2] = ((const float*)pixel)[0];
+      break;
+    case RB_DEPTH_STENCIL:
+      rgba[0] = rgba[1] = rgba[2] =
+        (float)(((const uint32_t*)pixel)[0] >> 8) / 16777215.f;
+      break;
+    default:
+      if(rb_soft_is_uint_format(fmt)) {
+        for(i = 0; i < nb; ++i)
+          rgba[i] = (float)((const uint32_t*)pixel)[i];
+      } else {
+        for(i = 0; i < nb; ++i)
+          rgba[i] = (float)((const unsigned char*)pixel)[i] / 255.f;
+      }
+      break;
+  }
+}
+
+void
+rb_soft_fill_surface(struct rb_soft_surface* surface, const void* pixel)
+{
+  size_t size = 0;
+  size_t i = 0;
+  ASSERT(surface && pixel);
+
+  size = (size_t)surface->width * surface->height * surface->pixel_size;
+  if(!size)
+    return;
+  /* Copy the first pixel and then double the filled area. */
+  memcpy(surface->data, pixel, surface->pixel_size);
+  for(i = surface->pixel_size; i < size; i *= 2)
+    memcpy(surface->data + i, surface->data, MIN(i, size - i));
+}
@@ -0,0 +1,84 @@
+#ifndef RB_SOFT_TEXTURE_H
+#define RB_SOFT_TEXTURE_H
+
+#include "rb_types.h"
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct rb_context;
+
+/* 2D array of pixels stored with the layout of the OpenGL client memory, i.e.
+ * the row 0 is the bottom row and the rows are not padded. */
+struct rb_soft_surface {
+  unsigned char* data;
+  unsigned int width;
+  unsigned int height;
+  enum rb_tex_format format;
+  size_t pixel_size;
+};
+
+struct rb_tex2d {
+  struct ref ref;
+  struct rb_context* ctxt;
+  struct rb_soft_surface* mip_list;
+  unsigned int mip_count;
+  unsigned char* data;
+};
+
+/* The depth of the RB_DEPTH_STENCIL pixels is stored in their 24 most
+ * significant bits while the stencil is stored in the 8 remaining bits. */
+static FINLINE uint32_t
+rb_soft_encode_depth24(float depth)
+{
+  depth = depth < 0.f ? 0.f : (depth > 1.f ? 1.f : depth);
+  return (uint32_t)((double)depth * 16777215.0 + 0.5) << 8;
+}
+
+LOCAL_SYM size_t
+rb_soft_sizeof_pixel
+  (enum rb_tex_format format);
+
+LOCAL_SYM int
+rb_soft_is_uint_format
+  (enum rb_tex_format format);
+
+LOCAL_SYM int
+rb_soft_is_depth_format
+  (enum rb_tex_format format);
+
+LOCAL_SYM int
+rb_soft_init_surface
+  (struct rb_context* ctxt,
+   struct rb_soft_surface* surface,
+   unsigned int width,
+   unsigned int height,
+   enum rb_tex_format format);
+
+LOCAL_SYM void
+rb_soft_release_surface
+  (struct rb_context* ctxt,
+   struct rb_soft_surface* surface);
+
+/* Convert the color to the pixel format of the surface. */
+LOCAL_SYM void
+rb_soft_encode_color
+  (enum rb_tex_format format,
+   const float rgba[4],
+   void* pixel);
+
+/* Convert a pixel of the surface to a floating point color. */
+LOCAL_SYM void
+rb_soft_decode_color
+  (enum rb_tex_format format,
+   const void* pixel,
+   float rgba[4]);
+
+/* Set all the pixels of the surface to `pixel'. */
+LOCAL_SYM void
+rb_soft_fill_surface
+  (struct rb_soft_surface* surface,
+   const void* pixel);
+
+#endif /* RB_SOFT_TEXTURE_H */
@@ -0,0 +1,222 @@
+#include "soft/rb_soft_context.h"
+#include "soft/rb_soft_program.h"
+#include "rb.h"
+#include <snlsys/math.h>
+#include <snlsys/mem_allocator.h>
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct rb_uniform {
+  struct ref ref;
+  struct rb_context* ctxt;
+  struct rb_program* program;
+  const char* name; /* String of the registered uniform declaration. */
+  size_t slot; /* Index of the uniform in the program uniforms. */
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static int
+create_uniform
+  (struct rb_context* ctxt,
+   struct rb_program* program,
+   size_t slot,
+   struct rb_uniform** out_uniform)
+{
+  struct rb_uniform* uniform = NULL;
+  ASSERT(ctxt && program && slot < program->nb_uniforms && out_uniform);
+
+  uniform = rb_soft_alloc_object
+    (ctxt, RB_OBJECT_UNIFORM, sizeof(struct rb_uniform));
+  if(!uniform)
+    return -1;
+  ref_init(&uniform->ref);
+  RB(context_ref_get(ctxt));
+  uniform->ctxt = ctxt;
+  RB(program_ref_get(program));
+  uniform->program = program;
+  uniform->name = program->uniform_list[slot].name;
+  uniform->slot = slot;
+  *out_uniform = uniform;
+  return 0;
+}
+
+/* Return the slot of the uniform into its program. Its index may be updated
+ * since the program may be linked again. */
+static struct rb_soft_uniform_slot*
+get_uniform_slot(struct rb_uniform* uniform)
+{
+  struct rb_program* prog = NULL;
+  size_t i = 0;
+  ASSERT(uniform);
+
+  prog = uniform->program;
+  if(uniform->slot < prog->nb_uniforms
+  && prog->uniform_list[uniform->slot].name == uniform->name)
+    return prog->uniform_list + uniform->slot;
+
+  for(i = 0; i < prog->nb_uniforms; ++i) {
+    if(!strcmp(prog->uniform_list[i].name, uniform->name)) {
+      uniform->slot = i;
+      return prog->uniform_list + i;
+    }
+  }
+  return NULL;
+}
+
+static void
+release_uniform(struct ref* ref)
+{
+  struct rb_context* ctxt = NULL;
+  struct rb_uniform* uniform = NULL;
+  ASSERT(ref);
+
+  uniform = CONTAINER_OF(ref, struct rb_uniform, ref);
+  ctxt = uniform->ctxt;
+
+  RB(program_ref_put(uniform->program));
+  rb_soft_free_object(ctxt, RB_OBJECT_UNIFORM, uniform);
+  RB(context_ref_put(ctxt));
+}
+
+/*******************************************************************************
+ *
+ * Uniform implementation.
+ *
+ ******************************************************************************/
+int
+rb_get_named_uniform
+  (struct rb_context* ctxt,
+   struct rb_program* program,
+   const char* name,
+   struct rb_uniform** out_uniform)
+{
+  size_t i = 0;
+
+  if(!ctxt || !program || !name || !out_uniform)
+    return -1;
+
+  if(!program->is_linked)
+    return -1;
+
+  for(i = 0; i < program->nb_uniforms; ++i) {
+    if(!strcmp(program->uniform_list[i].name, name))
+      break;
+  }
+  if(i >= program->nb_uniforms)
+    return -1;
+  return create_uniform(ctxt, program, i, out_uniform);
+}
+
+int
+rb_get_uniforms
+  (struct rb_context* ctxt,
+   struct rb_program* prog,
+   size_t* out_nb_uniforms,
+   struct rb_uniform* dst_uniform_list[])
+{
+  size_t i = 0;
+
+  if(!ctxt || !prog || !out_nb_uniforms)
+    return -1;
+
+  if(!prog->is_linked)
+    return -1;
+
+  if(dst_uniform_list) {
+    for(i = 0; i < prog->nb_uniforms; ++i) {
+      if(create_uniform(ctxt, prog, i, dst_uniform_list + i) != 0)
+        break;
+    }
+    if(i < prog->nb_uniforms) {
+      while(i) {
+        --i;
+        RB(uniform_ref_put(dst_uniform_list[i]));
+        dst_uniform_list[i] = NULL;
+      }
+      *out_nb_uniforms = 0;
+      return -1;
+    }
+  }
+  *out_nb_uniforms = prog->nb_uniforms;
+  return 0;
+}
+
+int
+rb_uniform_ref_get(struct rb_uniform* uniform)
+{
+  if(!uniform)
+    return -1;
+  ref_get(&uniform->ref);
+  return 0;
+}
+
+int
+rb_uniform_ref_put(struct rb_uniform* uniform)
+{
+  if(!uniform)
+    return -1;
+  ref_put(&uniform->ref, release_uniform);
+  return 0;
+}
+
+int
+rb_uniform_data(struct rb_uniform* uniform, int nb, const void* data)
+{
+  struct rb_soft_uniform_slot* slot = NULL;
+
+  if(!uniform || !data)
+    return -1;
+  if(nb <= 0)
+    return -1;
+
+  slot = get_uniform_slot(uniform);
+  if(!slot)
+    return -1;
+  /* The values out of the uniform array are ignored. */
+  if((unsigned int)nb > slot->count)
+    nb = (int)slot->count;
+  memcpy(slot->value, data, slot->sizeof_elmt * (size_t)nb);
+  return 0;
+}
+
+int
+rb_get_uniform_desc(struct rb_uniform* uniform, struct rb_uniform_desc* desc)
+{
+  struct rb_soft_uniform_slot* slot = NULL;
+
+  if(!uniform || !desc)
+    return -1;
+  slot = get_uniform_slot(uniform);
+  desc->name = uniform->name;
+  desc->type = slot ? slot->type : RB_UNKNOWN_TYPE;
+  return 0;
+}
+
+/*******************************************************************************
+ *
+ * Private functions.
+ *
+ ******************************************************************************/
+size_t
+rb_soft_sizeof_uniform_data(const struct rb_uniform* uniform, int count)
+{
+  const struct rb_program* prog = NULL;
+  size_t i = 0;
+  ASSERT(uniform && count > 0);
+
+  prog = uniform->program;
+  for(i = 0; i < prog->nb_uniforms; ++i) {
+    if(!strcmp(prog->uniform_list[i].name, uniform->name)) {
+      const struct rb_soft_uniform_slot* slot = prog->uniform_list + i;
+      /* The values out of the uniform array are ignored. */
+      return slot->sizeof_elmt * MIN((unsigned int)count, slot->count);
+    }
+  }
+  return 0;
+}
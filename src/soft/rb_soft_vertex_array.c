@@ -0,0 +1,192 @@
+#include "soft/rb_soft_buffers.h"
+#include "soft/rb_soft_context.h"
+#include "soft/rb_soft_vertex_array.h"
+#include "rb.h"
+#include <snlsys/mem_allocator.h>
+#include <snlsys/ref_count.h>
+#include <snlsys/snlsys.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static FINLINE unsigned int
+attrib_nb_components(enum rb_type type)
+{
+  unsigned int nb = 0;
+  switch(type) {
+    case RB_FLOAT: nb = 1; break;
+    case RB_FLOAT2: nb = 2; break;
+    case RB_FLOAT3: nb = 3; break;
+    case RB_FLOAT4: nb = 4; break;
+    default: nb = 0; break;
+  }
+  return nb;
+}
+
+static void
+disable_attrib(struct rb_soft_vertex_attrib* attrib)
+{
+  ASSERT(attrib);
+  if(attrib->buffer)
+    RB(buffer_ref_put(attrib->buffer));
+  memset(attrib, 0, sizeof(struct rb_soft_vertex_attrib));
+}
+
+static void
+release_vertex_array(struct ref* ref)
+{
+  struct rb_context* ctxt = NULL;
+  struct rb_vertex_array* varray = NULL;
+  int i = 0;
+  ASSERT(ref);
+
+  varray = CONTAINER_OF(ref, struct rb_vertex_array, ref);
+  ctxt = varray->ctxt;
+
+  if(ctxt->state.vertex_array == varray)
+    RB(bind_vertex_array(ctxt, NULL));
+
+  for(i = 0; i < RB_SOFT_MAX_ATTRIBS; ++i)
+    disable_attrib(varray->attrib_list + i);
+  if(varray->index_buffer)
+    RB(buffer_ref_put(varray->index_buffer));
+  rb_soft_free_object(ctxt, RB_OBJECT_VERTEX_ARRAY, varray);
+  RB(context_ref_put(ctxt));
+}
+
+/*******************************************************************************
+ *
+ * Vertex array functions.
+ *
+ ******************************************************************************/
+int
+rb_create_vertex_array
+  (struct rb_context* ctxt,
+   struct rb_vertex_array** out_array)
+{
+  struct rb_vertex_array* array = NULL;
+
+  if(!ctxt || !out_array)
+    return -1;
+
+  array = rb_soft_alloc_object
+    (ctxt, RB_OBJECT_VERTEX_ARRAY, sizeof(struct rb_vertex_array));
+  if(!array)
+    return -1;
+  ref_init(&array->ref);
+  RB(context_ref_get(ctxt));
+  array->ctxt = ctxt;
+  *out_array = array;
+  return 0;
+}
+
+int
+rb_vertex_array_ref_get(struct rb_vertex_array* array)
+{
+  if(!array)
+    return -1;
+  ref_get(&array->ref);
+  return 0;
+}
+
+int
+rb_vertex_array_ref_put(struct rb_vertex_array* array)
+{
+  if(!array)
+    return -1;
+  ref_put(&array->ref, release_vertex_array);
+  return 0;
+}
+
+int
+rb_bind_vertex_array
+  (struct rb_context* ctxt,
+   struct rb_vertex_array* array)
+{
+  if(!ctxt)
+    return -1;
+  ctxt->state.vertex_array = array;
+  return 0;
+}
+
+int
+rb_vertex_attrib_array
+  (struct rb_vertex_array* array,
+   struct rb_buffer* buffer,
+   int count,
+   const struct rb_buffer_attrib* attrib)
+{
+  int i = 0;
+
+  if(!array
+  || !buffer
+  || !attrib
+  || count < 0
+  || buffer->target != RB_BIND_VERTEX_BUFFER)
+    return -1;
+
+  for(i = 0; i < count; ++i) {
+    struct rb_soft_vertex_attrib* dst = NULL;
+    const unsigned int nb_components = attrib_nb_components(attrib[i].type);
+
+    /* As the ogl3 backend, the attribs preceding an invalid one are set. */
+    if(!nb_components
+    || attrib[i].index < 0
+    || attrib[i].index >= RB_SOFT_MAX_ATTRIBS)
+      return -1;
+
+    dst = array->attrib_list + attrib[i].index;
+    RB(buffer_ref_get(buffer));
+    disable_attrib(dst);
+    dst->buffer = buffer;
+    dst->nb_components = nb_components;
+    dst->offset = attrib[i].offset;
+    /* A null stride means that the attribs are tightly packed. */
+    dst->stride = attrib[i].stride
+      ? attrib[i].stride : nb_components * sizeof(float);
+  }
+  return 0;
+}
+
+int
+rb_remove_vertex_attrib
+  (struct rb_vertex_array* array,
+   int count,
+   const int* list_of_attrib_indices)
+{
+  int i = 0;
+  int err = 0;
+
+  if(!array
+  || count < 0
+  || (count > 0 && !list_of_attrib_indices))
+    return -1;
+
+  for(i = 0; i < count; ++i) {
+    const int current_attrib = list_of_attrib_indices[i];
+    if(current_attrib < 0 || current_attrib >= RB_SOFT_MAX_ATTRIBS) {
+      err = -1;
+    } else {
+      disable_attrib(array->attrib_list + current_attrib);
+    }
+  }
+  return err;
+}
+
+int
+rb_vertex_index_array(struct rb_vertex_array* array, struct rb_buffer* buffer)
+{
+  if(!array || (buffer && buffer->target != RB_BIND_INDEX_BUFFER))
+    return -1;
+
+  if(buffer)
+    RB(buffer_ref_get(buffer));
+  if(array->index_buffer)
+    RB(buffer_ref_put(array->index_buffer));
+  array->index_buffer = buffer;
+  return 0;
+}
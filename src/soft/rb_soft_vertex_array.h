@@ -0,0 +1,28 @@
+#ifndef RB_SOFT_VERTEX_ARRAY_H
+#define RB_SOFT_VERTEX_ARRAY_H
+
+#include "soft/rb_soft.h"
+#include <snlsys/ref_count.h>
+#include <stddef.h>
+
+struct rb_buffer;
+struct rb_context;
+
+/* Vertex array attrib. Disabled if its buffer is NULL. */
+struct rb_soft_vertex_attrib {
+  struct rb_buffer* buffer;
+  size_t stride;
+  size_t offset;
+  unsigned int nb_components;
+};
+
+/* The vertex array references its buffers as the OpenGL vertex array objects
+ * keep alive their buffers. */
+struct rb_vertex_array {
+  struct ref ref;
+  struct rb_context* ctxt;
+  struct rb_soft_vertex_attrib attrib_list[RB_SOFT_MAX_ATTRIBS];
+  struct rb_buffer* index_buffer;
+};
+
+#endif /* RB_SOFT_VERTEX_ARRAY_H */
@@ -0,0 +1,246 @@
+#include "soft/rb_soft.h"
+#include "rb.h"
+#include <snlsys/snlsys.h>
+#include <string.h>
+
+#define WIDTH 32
+#define HEIGHT 32
+
+/*******************************************************************************
+ *
+ * Software shaders.
+ *
+ ******************************************************************************/
+static const struct rb_soft_attrib_decl vs_attrib_list[] = {
+  { "pos", RB_FLOAT3, 0 },
+  { "color", RB_FLOAT4, 1 }
+};
+
+static const struct rb_soft_uniform_decl fs_uniform_list[] = {
+  { "scale", RB_FLOAT, 0 }
+};
+
+static void
+vs_main
+  (const struct rb_soft_shader_env* env,
+   const float* const attribs[],
+   float position[4],
+   float varyings[])
+{
+  (void)env;
+  position[0] = attribs[0][0];
+  position[1] = attribs[0][1];
+  position[2] = attribs[0][2];
+  position[3] = 1.f;
+  memcpy(varyings, attribs[1], 4 * sizeof(float));
+}
+
+static int
+fs_main
+  (const struct rb_soft_shader_env* env,
+   const float varyings[],
+   float colors[][4])
+{
+  const float scale = *(const float*)env->uniforms[0];
+  colors[0][0] = varyings[0] * scale;
+  colors[0][1] = varyings[1] * scale;
+  colors[0][2] = varyings[2] * scale;
+  colors[0][3] = varyings[3];
+  return 1;
+}
+
+static const struct rb_soft_shader_desc vs_desc = {
+  RB_VERTEX_SHADER, NULL, 0, vs_attrib_list, 2, 4, 0, vs_main, NULL
+};
+
+static const struct rb_soft_shader_desc fs_desc = {
+  RB_FRAGMENT_SHADER, fs_uniform_list, 1, NULL, 0, 4, 1, NULL, fs_main
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+/* Return the number of pixels of the image whose color is `rgba'. */
+static size_t
+count_pixels(const unsigned char* img, const unsigned char rgba[4])
+{
+  size_t i = 0;
+  size_t n = 0;
+  for(i = 0; i < WIDTH * HEIGHT; ++i)
+    n += memcmp(img + i * 4, rgba, 4) == 0;
+  return n;
+}
+
+/* Fill the 6 vertices of the [x0, x1] x [-1, 1] quad at the depth `z'. */
+static void
+setup_quad(float x0, float x1, float z, const float color[4], float* vertices)
+{
+  const float pos[6][2] = {
+    { x0, -1.f }, { x1, -1.f }, { x1, 1.f },
+    { x0, -1.f }, { x1, 1.f }, { x0, 1.f }
+  };
+  int i = 0;
+  for(i = 0; i < 6; ++i) {
+    vertices[i * 7 + 0] = pos[i][0];
+    vertices[i * 7 + 1] = pos[i][1];
+    vertices[i * 7 + 2] = z;
+    memcpy(vertices + i * 7 + 3, color, 4 * sizeof(float));
+  }
+}
+
+/*******************************************************************************
+ *
+ * Render and read back test.
+ *
+ ******************************************************************************/
+int
+main(int argc, char** argv)
+{
+  const struct rb_headless_desc headless_desc = { WIDTH, HEIGHT };
+  const struct rb_tex2d_desc color_desc =
+    { WIDTH, HEIGHT, 1, RB_RGBA, RB_USAGE_DEFAULT, 0 };
+  const struct rb_tex2d_desc depth_desc =
+    { WIDTH, HEIGHT, 1, RB_DEPTH_STENCIL, RB_USAGE_DEFAULT, 0 };
+  const struct rb_framebuffer_desc fb_desc = { WIDTH, HEIGHT, 1, 1 };
+  const struct rb_buffer_attrib attrib_list[2] = {
+    { 0, 7 * sizeof(float), 0, RB_FLOAT3 },
+    { 1, 7 * sizeof(float), 3 * sizeof(float), RB_FLOAT4 }
+  };
+  const float black[4] = { 0.f, 0.f, 0.f, 0.f };
+  const float orange[4] = { 1.f, 0.5f, 0.f, 1.f };
+  const float blue[4] = { 0.f, 0.f, 1.f, 1.f };
+  const unsigned char black8[4] = { 0, 0, 0, 0 };
+  const unsigned char orange8[4] = { 255, 128, 0, 255 };
+  const unsigned char dim_orange8[4] = { 128, 64, 0, 255 };
+  const unsigned char blue8[4] = { 0, 0, 255, 255 };
+  const void* init_data[1] = { NULL };
+  static unsigned char img[WIDTH * HEIGHT * 4];
+  float vertices[2][6 * 7];
+  struct rb_buffer_desc buffer_desc;
+  struct rb_depth_stencil_desc depth_stencil;
+  struct rb_render_target color_rt;
+  struct rb_render_target depth_rt;
+  struct rb_context* ctxt = NULL;
+  struct rb_shader* vs = NULL;
+  struct rb_shader* fs = NULL;
+  struct rb_shader* shader = NULL;
+  struct rb_program* prog = NULL;
+  struct rb_uniform* scale = NULL;
+  struct rb_buffer* vbuf[2] = { NULL, NULL };
+  struct rb_vertex_array* varray[2] = { NULL, NULL };
+  struct rb_tex2d* color_tex = NULL;
+  struct rb_tex2d* depth_tex = NULL;
+  struct rb_framebuffer* fb = NULL;
+  const char* log = NULL;
+  size_t size = 0;
+  float f = 0.f;
+  int i = 0;
+  (void)argc, (void)argv;
+
+  CHECK(rb_create_headless_context(NULL, &headless_desc, &ctxt), 0);
+  CHECK(rb_soft_register_shader(ctxt, "vs", &vs_desc), 0);
+  CHECK(rb_soft_register_shader(ctxt, "fs", &fs_desc), 0);
+
+  /* The source of a software shader is the name of its functions. */
+  CHECK(rb_create_shader(ctxt, RB_VERTEX_SHADER, "none", 4, &shader), -1);
+  CHECK(rb_get_shader_log(shader, &log), 0);
+  CHECK(log != NULL, 1);
+  CHECK(rb_shader_ref_put(shader), 0);
+  CHECK(rb_create_shader(ctxt, RB_VERTEX_SHADER, "fs", 2, &shader), -1);
+  CHECK(rb_shader_ref_put(shader), 0);
+
+  CHECK(rb_create_shader(ctxt, RB_VERTEX_SHADER, "vs", 2, &vs), 0);
+  CHECK(rb_create_shader(ctxt, RB_FRAGMENT_SHADER, "fs", 2, &fs), 0);
+  CHECK(rb_create_program(ctxt, &prog), 0);
+  CHECK(rb_attach_shader(prog, vs), 0);
+  CHECK(rb_attach_shader(prog, fs), 0);
+  CHECK(rb_link_program(prog), 0);
+  CHECK(rb_get_named_uniform(ctxt, prog, "scale", &scale), 0);
+
+  /* Full screen orange quad and closer blue quad over the left half. */
+  setup_quad(-1.f, 1.f, 0.5f, orange, vertices[0]);
+  setup_quad(-1.f, 0.f, 0.f, blue, vertices[1]);
+  buffer_desc.size = sizeof(vertices[0]);
+  buffer_desc.target = RB_BIND_VERTEX_BUFFER;
+  buffer_desc.usage = RB_USAGE_DEFAULT;
+  for(i = 0; i < 2; ++i) {
+    CHECK(rb_create_buffer(ctxt, &buffer_desc, vertices[i], &vbuf[i]), 0);
+    CHECK(rb_create_vertex_array(ctxt, &varray[i]), 0);
+    CHECK(rb_vertex_attrib_array(varray[i], vbuf[i], 2, attrib_list), 0);
+  }
+
+  CHECK(rb_create_tex2d(ctxt, &color_desc, init_data, &color_tex), 0);
+  CHECK(rb_create_tex2d(ctxt, &depth_desc, init_data, &depth_tex), 0);
+  CHECK(rb_create_framebuffer(ctxt, &fb_desc, &fb), 0);
+  memset(&color_rt, 0, sizeof(color_rt));
+  color_rt.type = RB_RENDER_TARGET_TEXTURE2D;
+  color_rt.resource = color_tex;
+  depth_rt = color_rt;
+  depth_rt.resource = depth_tex;
+  CHECK(rb_framebuffer_render_targets(fb, 1, &color_rt, &depth_rt), 0);
+
+  CHECK(rb_bind_framebuffer(ctxt, fb), 0);
+  CHECK(rb_bind_program(ctxt, prog), 0);
+  CHECK(rb_bind_vertex_array(ctxt, varray[0]), 0);
+
+  /* Full screen quad. */
+  f = 1.f;
+  CHECK(rb_uniform_data(scale, 1, &f), 0);
+  CHECK(rb_clear(ctxt, RB_CLEAR_COLOR_BIT|RB_CLEAR_DEPTH_BIT, black, 1.f,0),0);
+  CHECK(rb_draw(ctxt, RB_TRIANGLE_LIST, 6), 0);
+  CHECK(rb_read_back_framebuffer(fb, 0, 0, 0, WIDTH, HEIGHT, &size, img), 0);
+  CHECK(size, sizeof(img));
+  CHECK(count_pixels(img, orange8), WIDTH * HEIGHT);
+
+  /* The uniforms are read by the fragment function. */
+  f = 0.5f;
+  CHECK(rb_uniform_data(scale, 1, &f), 0);
+  CHECK(rb_clear(ctxt, RB_CLEAR_COLOR_BIT|RB_CLEAR_DEPTH_BIT, black, 1.f,0),0);
+  CHECK(rb_draw(ctxt, RB_TRIANGLE_LIST, 6), 0);
+  CHECK(rb_read_back_framebuffer(fb, 0, 0, 0, WIDTH, HEIGHT, &size, img), 0);
+  CHECK(count_pixels(img, dim_orange8), WIDTH * HEIGHT);
+
+  /* The left half quad covers exactly the left half of the pixels. */
+  f = 1.f;
+  CHECK(rb_uniform_data(scale, 1, &f), 0);
+  CHECK(rb_clear(ctxt, RB_CLEAR_COLOR_BIT|RB_CLEAR_DEPTH_BIT, black, 1.f,0),0);
+  CHECK(rb_bind_vertex_array(ctxt, varray[1]), 0);
+  CHECK(rb_draw(ctxt, RB_TRIANGLE_LIST, 6), 0);
+  CHECK(rb_read_back_framebuffer(fb, 0, 0, 0, WIDTH, HEIGHT, &size, img), 0);
+  CHECK(count_pixels(img, blue8), WIDTH * HEIGHT / 2);
+  CHECK(count_pixels(img, black8), WIDTH * HEIGHT / 2);
+  CHECK(memcmp(img, blue8, 4), 0);
+
+  /* The closer blue quad hides the left half of the orange one. */
+  memset(&depth_stencil, 0, sizeof(depth_stencil));
+  depth_stencil.enable_depth_test = 1;
+  depth_stencil.enable_depth_write = 1;
+  depth_stencil.depth_func = RB_COMPARISON_LESS;
+  CHECK(rb_depth_stencil(ctxt, &depth_stencil), 0);
+  CHECK(rb_clear(ctxt, RB_CLEAR_COLOR_BIT|RB_CLEAR_DEPTH_BIT, black, 1.f,0),0);
+  CHECK(rb_draw(ctxt, RB_TRIANGLE_LIST, 6), 0);
+  CHECK(rb_bind_vertex_array(ctxt, varray[0]), 0);
+  CHECK(rb_draw(ctxt, RB_TRIANGLE_LIST, 6), 0);
+  CHECK(rb_read_back_framebuffer(fb, 0, 0, 0, WIDTH, HEIGHT, &size, img), 0);
+  CHECK(count_pixels(img, blue8), WIDTH * HEIGHT / 2);
+  CHECK(count_pixels(img, orange8), WIDTH * HEIGHT / 2);
+
+  CHECK(rb_bind_framebuffer(ctxt, NULL), 0);
+  CHECK(rb_bind_program(ctxt, NULL), 0);
+  CHECK(rb_bind_vertex_array(ctxt, NULL), 0);
+  CHECK(rb_framebuffer_ref_put(fb), 0);
+  CHECK(rb_tex2d_ref_put(color_tex), 0);
+  CHECK(rb_tex2d_ref_put(depth_tex), 0);
+  for(i = 0; i < 2; ++i) {
+    CHECK(rb_vertex_array_ref_put(varray[i]), 0);
+    CHECK(rb_buffer_ref_put(vbuf[i]), 0);
+  }
+  CHECK(rb_uniform_ref_put(scale), 0);
+  CHECK(rb_program_ref_put(prog), 0);
+  CHECK(rb_shader_ref_put(vs), 0);
+  CHECK(rb_shader_ref_put(fs), 0);
+  CHECK(rb_context_ref_put(ctxt), 0);
+  return 0;
+}
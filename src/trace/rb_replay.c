@@ -0,0 +1,1119 @@
+#define _POSIX_C_SOURCE 200112L /* clock_gettime, mmap. */
+
+#include "rbi/rbi.h"
+#include "trace/rb_trace.h"
+#include <snlsys/math.h>
+#include <snlsys/snlsys.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef RB_TRACE_USE_ZLIB
+  #include <zlib.h>
+#endif
+
+/* Size of the default framebuffer of the replayed context. */
+#define REPLAY_WIDTH 1280
+#define REPLAY_HEIGHT 720
+
+struct reader {
+  const unsigned char* cur;
+  const unsigned char* end;
+  int error;
+};
+
+struct replay {
+  struct rbi rbi;
+  void** handles; /* Map a trace id to its replayed handle. */
+  size_t handles_count;
+  unsigned char* scratch; /* Memory of the replayed read back. */
+  size_t scratch_size;
+  size_t nb_mismatches; /* Number of calls whose returned value differs. */
+  int has_context; /* Define whether a context was already created. */
+  size_t nb_calls;
+};
+
+static const char* func_names[] = {
+  #define RB_FUNC(func_name, ...) STR(func_name),
+  #include "rb_func.h"
+  #undef RB_FUNC
+};
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static FINLINE double
+elapsed_ms(const struct timespec* t0, const struct timespec* t1)
+{
+  return (double)(t1->tv_sec - t0->tv_sec) * 1.0e3
+       + (double)(t1->tv_nsec - t0->tv_nsec) * 1.0e-6;
+}
+
+static uint64_t
+get_u64(struct reader* rd)
+{
+  uint64_t val = 0;
+  if(UNLIKELY(rd->cur + sizeof(uint64_t) > rd->end)) {
+    rd->error = 1;
+    return 0;
+  }
+  memcpy(&val, rd->cur, sizeof(uint64_t));
+  rd->cur += sizeof(uint64_t);
+  return val;
+}
+
+static FINLINE int64_t
+get_i64(struct reader* rd)
+{
+  return (int64_t)get_u64(rd);
+}
+
+static FINLINE double
+get_f64(struct reader* rd)
+{
+  const uint64_t u64 = get_u64(rd);
+  double val = 0;
+  memcpy(&val, &u64, sizeof(double));
+  return val;
+}
+
+static const void*
+get_blob(struct reader* rd, size_t* out_size)
+{
+  const void* data = NULL;
+  const uint64_t size = get_u64(rd);
+
+  if(size == RB_TRACE_NULL_BLOB) {
+    if(out_size)
+      *out_size = 0;
+    return NULL;
+  }
+  if(UNLIKELY(size > (uint64_t)(rd->end - rd->cur))) {
+    rd->error = 1;
+    return NULL;
+  }
+  data = rd->cur;
+  rd->cur += rb_trace_align((size_t)size);
+  if(out_size)
+    *out_size = (size_t)size;
+  return data;
+}
+
+/* Get a blob whose size must be `size' bytes. */
+static const void*
+get_sized_blob(struct reader* rd, size_t size)
+{
+  size_t blob_size = 0;
+  const void* data = get_blob(rd, &blob_size);
+  if(data && blob_size != size) {
+    rd->error = 1;
+    return NULL;
+  }
+  return data;
+}
+
+static void*
+get_handle(struct replay* replay, struct reader* rd)
+{
+  const uint64_t id = get_u64(rd);
+  if(id == 0 || id >= replay->handles_count)
+    return NULL;
+  return replay->handles[id];
+}
+
+static void
+set_handle(struct replay* replay, struct reader* rd, void* handle)
+{
+  const uint64_t id = get_u64(rd);
+  if(id == 0)
+    return;
+  if(id >= replay->handles_count) {
+    const size_t count = MAX((size_t)id + 1, replay->handles_count * 2);
+    void** handles = realloc(replay->handles, count * sizeof(void*));
+    if(!handles) {
+      rd->error = 1;
+      return;
+    }
+    memset(handles + replay->handles_count, 0,
+      (count - replay->handles_count) * sizeof(void*));
+    replay->handles = handles;
+    replay->handles_count = count;
+  }
+  replay->handles[id] = handle;
+}
+
+static void
+get_render_target
+  (struct replay* replay,
+   struct reader* rd,
+   struct rb_render_target* rt)
+{
+  ASSERT(rt);
+  memset(rt, 0, sizeof(struct rb_render_target));
+  rt->type = (enum rb_render_target_type)get_u64(rd);
+  rt->resource = get_handle(replay, rd);
+  switch(rt->type) {
+    case RB_RENDER_TARGET_TEXTURE2D:
+      rt->desc.tex2d.mip_level = (unsigned int)get_u64(rd);
+      break;
+    default: rd->error = 1; break;
+  }
+}
+
+/* Serve the includes recorded by a create_shader_variant call. They follow
+ * its arguments as (1, path, source) lists terminated by 0. */
+static int
+replay_include
+  (void* data,
+   const char* path,
+   const char** out_source,
+   size_t* out_length)
+{
+  struct reader rd = *(const struct reader*)data;
+  ASSERT(path && out_source && out_length);
+
+  while(get_u64(&rd) == 1) {
+    const char* recorded_path = get_blob(&rd, NULL);
+    const char* source = get_blob(&rd, out_length);
+    if(rd.error)
+      break;
+    if(recorded_path && !strcmp(recorded_path, path)) {
+      *out_source = source;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+static void*
+scratch(struct replay* replay, size_t size)
+{
+  if(size > replay->scratch_size) {
+    unsigned char* mem = realloc(replay->scratch, size);
+    if(!mem)
+      return NULL;
+    replay->scratch = mem;
+    replay->scratch_size = size;
+  }
+  return replay->scratch;
+}
+
+/* Replay the call `func' whose arguments are read from `rd'. Return the value
+ * returned by the replayed call. */
+static int
+replay_call(struct replay* replay, enum rb_trace_func func, struct reader* rd)
+{
+  const struct rbi* rbi = &replay->rbi;
+  int err = 0;
+
+  switch(func) {
+    /* Context. */
+    case RB_TRACE_create_context: {
+      struct rb_context* ctxt = NULL;
+      const uint64_t has_out = get_u64(rd);
+      /* The driver context of the recorded application is not available. The
+       * first context thus owns its own offscreen driver context. */
+      if(!replay->has_context && has_out) {
+        const struct rb_headless_desc desc = { REPLAY_WIDTH, REPLAY_HEIGHT };
+        err = rbi->create_headless_context(NULL, &desc, &ctxt);
+      } else {
+        err = rbi->create_context(NULL, has_out ? &ctxt : NULL);
+      }
+      replay->has_context = replay->has_context || ctxt != NULL;
+      set_handle(replay, rd, ctxt);
+    } break;
+    case RB_TRACE_create_headless_context: {
+      struct rb_context* ctxt = NULL;
+      const struct rb_headless_desc* desc =
+        get_sized_blob(rd, sizeof(struct rb_headless_desc));
+      err = rbi->create_headless_context
+        (NULL, desc, get_u64(rd) ? &ctxt : NULL);
+      replay->has_context = replay->has_context || ctxt != NULL;
+      set_handle(replay, rd, ctxt);
+    } break;
+    case RB_TRACE_create_loader_context: {
+      /* The calls of all the contexts are replayed by one thread. Since a
+       * loader shares the objects of its context, its calls are replayed onto
+       * this context rather than onto a new driver context that would be made
+       * current in place of it. */
+      struct rb_context* ctxt = get_handle(replay, rd);
+      const int has_out = get_u64(rd) != 0;
+      err = has_out ? rbi->context_ref_get(ctxt) : -1;
+      set_handle(replay, rd, err == 0 ? ctxt : NULL);
+    } break;
+    case RB_TRACE_context_ref_get:
+      err = rbi->context_ref_get(get_handle(replay, rd));
+      break;
+    case RB_TRACE_context_ref_put:
+      err = rbi->context_ref_put(get_handle(replay, rd));
+      break;
+    /* Texture 2d. */
+    case RB_TRACE_bind_tex2d: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      struct rb_tex2d* tex = get_handle(replay, rd);
+      const unsigned int unit = (unsigned int)get_u64(rd);
+      err = rbi->bind_tex2d(ctxt, tex, unit);
+    } break;
+    case RB_TRACE_create_tex2d: {
+      const void** init_data = NULL;
+      struct rb_tex2d* tex = NULL;
+      struct rb_context* ctxt = get_handle(replay, rd);
+      const struct rb_tex2d_desc* desc =
+        get_sized_blob(rd, sizeof(struct rb_tex2d_desc));
+      unsigned int i = 0;
+      if(get_u64(rd)) {
+        init_data = calloc(desc ? MAX(desc->mip_count, 1u) : 1, sizeof(void*));
+        if(!init_data) {
+          rd->error = 1;
+          break;
+        }
+        for(i = 0; desc && i < desc->mip_count; ++i)
+          init_data[i] = get_blob(rd, NULL);
+      }
+      err = rbi->create_tex2d
+        (ctxt, desc, init_data, get_u64(rd) ? &tex : NULL);
+      set_handle(replay, rd, tex);
+      free(init_data);
+    } break;
+    case RB_TRACE_tex2d_ref_get:
+      err = rbi->tex2d_ref_get(get_handle(replay, rd));
+      break;
+    case RB_TRACE_tex2d_ref_put:
+      err = rbi->tex2d_ref_put(get_handle(replay, rd));
+      break;
+    case RB_TRACE_tex2d_data: {
+      struct rb_tex2d* tex = get_handle(replay, rd);
+      const unsigned int level = (unsigned int)get_u64(rd);
+      const void* data = get_blob(rd, NULL);
+      err = rbi->tex2d_data(tex, level, data);
+    } break;
+    /* Sampler. */
+    case RB_TRACE_create_sampler: {
+      struct rb_sampler* sampler = NULL;
+      struct rb_context* ctxt = get_handle(replay, rd);
+      const struct rb_sampler_desc* desc =
+        get_sized_blob(rd, sizeof(struct rb_sampler_desc));
+      err = rbi->create_sampler(ctxt, desc, get_u64(rd) ? &sampler : NULL);
+      set_handle(replay, rd, sampler);
+    } break;
+    case RB_TRACE_sampler_ref_get:
+      err = rbi->sampler_ref_get(get_handle(replay, rd));
+      break;
+    case RB_TRACE_sampler_ref_put:
+      err = rbi->sampler_ref_put(get_handle(replay, rd));
+      break;
+    case RB_TRACE_sampler_parameters: {
+      struct rb_sampler* sampler = get_handle(replay, rd);
+      const struct rb_sampler_desc* desc =
+        get_sized_blob(rd, sizeof(struct rb_sampler_desc));
+      err = rbi->sampler_parameters(sampler, desc);
+    } break;
+    case RB_TRACE_bind_sampler: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      struct rb_sampler* sampler = get_handle(replay, rd);
+      const unsigned int unit = (unsigned int)get_u64(rd);
+      err = rbi->bind_sampler(ctxt, sampler, unit);
+    } break;
+    /* Buffers. */
+    case RB_TRACE_bind_buffer: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      struct rb_buffer* buf = get_handle(replay, rd);
+      const enum rb_buffer_target target = (enum rb_buffer_target)get_u64(rd);
+      err = rbi->bind_buffer(ctxt, buf, target);
+    } break;
+    case RB_TRACE_buffer_data: {
+      struct rb_buffer* buf = get_handle(replay, rd);
+      const int offset = (int)get_i64(rd);
+      const int size = (int)get_i64(rd);
+      const void* data = get_blob(rd, NULL);
+      err = rbi->buffer_data(buf, offset, size, data);
+    } break;
+    case RB_TRACE_create_buffer: {
+      struct rb_buffer* buf = NULL;
+      struct rb_context* ctxt = get_handle(replay, rd);
+      const struct rb_buffer_desc* desc =
+        get_sized_blob(rd, sizeof(struct rb_buffer_desc));
+      const void* data = get_blob(rd, NULL);
+      err = rbi->create_buffer(ctxt, desc, data, get_u64(rd) ? &buf : NULL);
+      set_handle(replay, rd, buf);
+    } break;
+    case RB_TRACE_buffer_ref_get:
+      err = rbi->buffer_ref_get(get_handle(replay, rd));
+      break;
+    case RB_TRACE_buffer_ref_put:
+      err = rbi->buffer_ref_put(get_handle(replay, rd));
+      break;
+    /* Vertex array. */
+    case RB_TRACE_bind_vertex_array: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      struct rb_vertex_array* varray = get_handle(replay, rd);
+      err = rbi->bind_vertex_array(ctxt, varray);
+    } break;
+    case RB_TRACE_create_vertex_array: {
+      struct rb_vertex_array* varray = NULL;
+      struct rb_context* ctxt = get_handle(replay, rd);
+      err = rbi->create_vertex_array(ctxt, get_u64(rd) ? &varray : NULL);
+      set_handle(replay, rd, varray);
+    } break;
+    case RB_TRACE_vertex_array_ref_get:
+      err = rbi->vertex_array_ref_get(get_handle(replay, rd));
+      break;
+    case RB_TRACE_vertex_array_ref_put:
+      err = rbi->vertex_array_ref_put(get_handle(replay, rd));
+      break;
+    case RB_TRACE_remove_vertex_attrib: {
+      struct rb_vertex_array* varray = get_handle(replay, rd);
+      const int count = (int)get_i64(rd);
+      const int* indices = get_blob(rd, NULL);
+      err = rbi->remove_vertex_attrib(varray, count, indices);
+    } break;
+    case RB_TRACE_vertex_attrib_array: {
+      struct rb_vertex_array* varray = get_handle(replay, rd);
+      struct rb_buffer* buf = get_handle(replay, rd);
+      const int count = (int)get_i64(rd);
+      const struct rb_buffer_attrib* attr = get_blob(rd, NULL);
+      err = rbi->vertex_attrib_array(varray, buf, count, attr);
+    } break;
+    case RB_TRACE_vertex_index_array: {
+      struct rb_vertex_array* varray = get_handle(replay, rd);
+      struct rb_buffer* buf = get_handle(replay, rd);
+      err = rbi->vertex_index_array(varray, buf);
+    } break;
+    /* Shaders. */
+    case RB_TRACE_create_shader: {
+      struct rb_shader* shader = NULL;
+      struct rb_context* ctxt = get_handle(replay, rd);
+      const enum rb_shader_type type = (enum rb_shader_type)get_u64(rd);
+      size_t length = 0;
+      const char* source = get_blob(rd, &length);
+      err = rbi->create_shader
+        (ctxt, type, source, length, get_u64(rd) ? &shader : NULL);
+      set_handle(replay, rd, shader);
+    } break;
+    case RB_TRACE_create_shader_variant: {
+      struct rb_shader_variant_desc desc;
+      struct rb_shader_define* defines = NULL;
+      struct rb_shader* shader = NULL;
+      struct reader includes;
+      struct rb_context* ctxt = get_handle(replay, rd);
+      const uint64_t has_desc = get_u64(rd);
+      uint64_t has_shader = 0;
+      size_t i = 0;
+      memset(&desc, 0, sizeof(struct rb_shader_variant_desc));
+      if(has_desc) {
+        desc.type = (enum rb_shader_type)get_u64(rd);
+        desc.source = get_blob(rd, &desc.length);
+        desc.nb_defines = (size_t)get_u64(rd);
+        if(get_u64(rd) && desc.nb_defines) {
+          /* Each define is stored in 2 blobs of at least 8 bytes. */
+          if(desc.nb_defines > (size_t)(rd->end - rd->cur) / 16
+          || !(defines = scratch
+               (replay, desc.nb_defines * sizeof(struct rb_shader_define)))) {
+            rd->error = 1;
+            break;
+          }
+          for(i = 0; i < desc.nb_defines; ++i) {
+            defines[i].name = get_blob(rd, NULL);
+            defines[i].value = get_blob(rd, NULL);
+          }
+          desc.define_list = defines;
+        }
+        if(get_u64(rd)) {
+          desc.include = replay_include;
+          desc.include_data = &includes;
+        }
+      }
+      has_shader = get_u64(rd);
+      includes = *rd;
+      while(get_u64(rd) == 1) { /* Skip the includes. */
+        get_blob(rd, NULL);
+        get_blob(rd, NULL);
+      }
+      err = rbi->create_shader_variant
+        (ctxt, has_desc ? &desc : NULL, has_shader ? &shader : NULL);
+      set_handle(replay, rd, shader);
+    } break;
+    case RB_TRACE_shader_ref_get:
+      err = rbi->shader_ref_get(get_handle(replay, rd));
+      break;
+    case RB_TRACE_shader_ref_put:
+      err = rbi->shader_ref_put(get_handle(replay, rd));
+      break;
+    case RB_TRACE_get_shader_log: {
+      const char* log = NULL;
+      struct rb_shader* shader = get_handle(replay, rd);
+      err = rbi->get_shader_log(shader, get_u64(rd) ? &log : NULL);
+    } break;
+    case RB_TRACE_is_shader_attached: {
+      int is_attached = 0;
+      struct rb_shader* shader = get_handle(replay, rd);
+      err = rbi->is_shader_attached(shader, get_u64(rd) ? &is_attached : NULL);
+    } break;
+    case RB_TRACE_shader_source: {
+      struct rb_shader* shader = get_handle(replay, rd);
+      size_t length = 0;
+      const char* source = get_blob(rd, &length);
+      err = rbi->shader_source(shader, source, length);
+    } break;
+    /* Programs. */
+    case RB_TRACE_attach_shader: {
+      struct rb_program* prog = get_handle(replay, rd);
+      struct rb_shader* shader = get_handle(replay, rd);
+      err = rbi->attach_shader(prog, shader);
+    } break;
+    case RB_TRACE_bind_program: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      struct rb_program* prog = get_handle(replay, rd);
+      err = rbi->bind_program(ctxt, prog);
+    } break;
+    case RB_TRACE_create_program: {
+      struct rb_program* prog = NULL;
+      struct rb_context* ctxt = get_handle(replay, rd);
+      err = rbi->create_program(ctxt, get_u64(rd) ? &prog : NULL);
+      set_handle(replay, rd, prog);
+    } break;
+    case RB_TRACE_detach_shader: {
+      struct rb_program* prog = get_handle(replay, rd);
+      struct rb_shader* shader = get_handle(replay, rd);
+      err = rbi->detach_shader(prog, shader);
+    } break;
+    case RB_TRACE_program_ref_get:
+      err = rbi->program_ref_get(get_handle(replay, rd));
+      break;
+    case RB_TRACE_program_ref_put:
+      err = rbi->program_ref_put(get_handle(replay, rd));
+      break;
+    case RB_TRACE_get_program_log: {
+      const char* log = NULL;
+      struct rb_program* prog = get_handle(replay, rd);
+      err = rbi->get_program_log(prog, get_u64(rd) ? &log : NULL);
+    } break;
+    case RB_TRACE_link_program:
+      err = rbi->link_program(get_handle(replay, rd));
+      break;
+    case RB_TRACE_program_is_ready: {
+      int is_ready = 0;
+      struct rb_program* prog = get_handle(replay, rd);
+      err = rbi->program_is_ready(prog, get_u64(rd) ? &is_ready : NULL);
+    } break;
+    case RB_TRACE_compile_mode: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      err = rbi->compile_mode
+        (ctxt, get_sized_blob(rd, sizeof(struct rb_compile_desc)));
+    } break;
+    /* Uniforms. */
+    case RB_TRACE_get_named_uniform: {
+      struct rb_uniform* uniform = NULL;
+      struct rb_context* ctxt = get_handle(replay, rd);
+      struct rb_program* prog = get_handle(replay, rd);
+      const char* name = get_blob(rd, NULL);
+      err = rbi->get_named_uniform
+        (ctxt, prog, name, get_u64(rd) ? &uniform : NULL);
+      set_handle(replay, rd, uniform);
+    } break;
+    case RB_TRACE_get_uniforms: {
+      struct rb_uniform** list = NULL;
+      struct rb_context* ctxt = get_handle(replay, rd);
+      struct rb_program* prog = get_handle(replay, rd);
+      const uint64_t has_nb = get_u64(rd);
+      const uint64_t has_list = get_u64(rd);
+      size_t nb = 0;
+      size_t i = 0;
+      if(has_nb && has_list) {
+        /* Query the number of uniforms to allocate the list. */
+        if(rbi->get_uniforms(ctxt, prog, &nb, NULL) == 0 && nb != 0) {
+          list = calloc(nb, sizeof(struct rb_uniform*));
+          if(!list) {
+            rd->error = 1;
+            break;
+          }
+        }
+      }
+      err = rbi->get_uniforms(ctxt, prog, has_nb ? &nb : NULL, list);
+      if(get_u64(rd) != (list ? nb : 0)) {
+        rd->error = 1;
+      } else {
+        for(i = 0; list && i < nb; ++i)
+          set_handle(replay, rd, list[i]);
+      }
+      free(list);
+    } break;
+    case RB_TRACE_get_uniform_desc: {
+      struct rb_uniform_desc desc;
+      struct rb_uniform* uniform = get_handle(replay, rd);
+      err = rbi->get_uniform_desc(uniform, get_u64(rd) ? &desc : NULL);
+    } break;
+    case RB_TRACE_uniform_data: {
+      struct rb_uniform* uniform = get_handle(replay, rd);
+      const int count = (int)get_i64(rd);
+      const void* data = get_blob(rd, NULL);
+      err = rbi->uniform_data(uniform, count, data);
+    } break;
+    case RB_TRACE_uniform_ref_get:
+      err = rbi->uniform_ref_get(get_handle(replay, rd));
+      break;
+    case RB_TRACE_uniform_ref_put:
+      err = rbi->uniform_ref_put(get_handle(replay, rd));
+      break;
+    /* Attributes. */
+    case RB_TRACE_get_attribs: {
+      struct rb_attrib** list = NULL;
+      struct rb_context* ctxt = get_handle(replay, rd);
+      struct rb_program* prog = get_handle(replay, rd);
+      const uint64_t has_nb = get_u64(rd);
+      const uint64_t has_list = get_u64(rd);
+      size_t nb = 0;
+      size_t i = 0;
+      if(has_nb && has_list) {
+        if(rbi->get_attribs(ctxt, prog, &nb, NULL) == 0 && nb != 0) {
+          list = calloc(nb, sizeof(struct rb_attrib*));
+          if(!list) {
+            rd->error = 1;
+            break;
+          }
+        }
+      }
+      err = rbi->get_attribs(ctxt, prog, has_nb ? &nb : NULL, list);
+      if(get_u64(rd) != (list ? nb : 0)) {
+        rd->error = 1;
+      } else {
+        for(i = 0; list && i < nb; ++i)
+          set_handle(replay, rd, list[i]);
+      }
+      free(list);
+    } break;
+    case RB_TRACE_get_named_attrib: {
+      struct rb_attrib* attr = NULL;
+      struct rb_context* ctxt = get_handle(replay, rd);
+      struct rb_program* prog = get_handle(replay, rd);
+      const char* name = get_blob(rd, NULL);
+      err = rbi->get_named_attrib(ctxt, prog, name, get_u64(rd) ? &attr : NULL);
+      set_handle(replay, rd, attr);
+    } break;
+    case RB_TRACE_attrib_data: {
+      struct rb_attrib* attr = get_handle(replay, rd);
+      const void* data = get_blob(rd, NULL);
+      err = rbi->attrib_data(attr, data);
+    } break;
+    case RB_TRACE_get_attrib_desc: {
+      struct rb_attrib_desc desc;
+      struct rb_attrib* attr = get_handle(replay, rd);
+      err = rbi->get_attrib_desc(attr, get_u64(rd) ? &desc : NULL);
+    } break;
+    case RB_TRACE_attrib_ref_get:
+      err = rbi->attrib_ref_get(get_handle(replay, rd));
+      break;
+    case RB_TRACE_attrib_ref_put:
+      err = rbi->attrib_ref_put(get_handle(replay, rd));
+      break;
+    /* Framebuffer. */
+    case RB_TRACE_create_framebuffer: {
+      struct rb_framebuffer* buffer = NULL;
+      struct rb_context* ctxt = get_handle(replay, rd);
+      const struct rb_framebuffer_desc* desc =
+        get_sized_blob(rd, sizeof(struct rb_framebuffer_desc));
+      err = rbi->create_framebuffer(ctxt, desc, get_u64(rd) ? &buffer : NULL);
+      set_handle(replay, rd, buffer);
+    } break;
+    case RB_TRACE_framebuffer_ref_get:
+      err = rbi->framebuffer_ref_get(get_handle(replay, rd));
+      break;
+    case RB_TRACE_framebuffer_ref_put:
+      err = rbi->framebuffer_ref_put(get_handle(replay, rd));
+      break;
+    case RB_TRACE_bind_framebuffer: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      struct rb_framebuffer* buffer = get_handle(replay, rd);
+      err = rbi->bind_framebuffer(ctxt, buffer);
+    } break;
+    case RB_TRACE_framebuffer_render_targets: {
+      struct rb_render_target* list = NULL;
+      struct rb_render_target depth_stencil;
+      struct rb_framebuffer* buffer = get_handle(replay, rd);
+      const unsigned int count = (unsigned int)get_u64(rd);
+      int has_depth_stencil = 0;
+      unsigned int i = 0;
+      if(get_u64(rd)) {
+        list = calloc(MAX(count, 1u), sizeof(struct rb_render_target));
+        if(!list) {
+          rd->error = 1;
+          break;
+        }
+        for(i = 0; i < count; ++i)
+          get_render_target(replay, rd, list + i);
+      }
+      has_depth_stencil = get_u64(rd) != 0;
+      if(has_depth_stencil)
+        get_render_target(replay, rd, &depth_stencil);
+      err = rbi->framebuffer_render_targets
+        (buffer, count, list, has_depth_stencil ? &depth_stencil : NULL);
+      free(list);
+    } break;
+    case RB_TRACE_clear_framebuffer_render_targets: {
+      struct rb_framebuffer* buffer = get_handle(replay, rd);
+      const int flag = (int)get_i64(rd);
+      const unsigned int count = (unsigned int)get_u64(rd);
+      const struct rb_clear_framebuffer_color_desc* vals = get_blob(rd, NULL);
+      const float depth = (float)get_f64(rd);
+      const char stencil = (char)get_i64(rd);
+      err = rbi->clear_framebuffer_render_targets
+        (buffer, flag, count, vals, depth, stencil);
+    } break;
+    case RB_TRACE_read_back_framebuffer: {
+      struct rb_framebuffer* buffer = get_handle(replay, rd);
+      const int rt_id = (int)get_i64(rd);
+      const size_t x = (size_t)get_u64(rd);
+      const size_t y = (size_t)get_u64(rd);
+      const size_t width = (size_t)get_u64(rd);
+      const size_t height = (size_t)get_u64(rd);
+      const uint64_t has_size = get_u64(rd);
+      const uint64_t has_data = get_u64(rd);
+      const size_t size = (size_t)get_u64(rd);
+      size_t read_size = 0;
+      void* data = has_data ? scratch(replay, MAX(size, 1)) : NULL;
+      if(has_data && !data) {
+        rd->error = 1;
+        break;
+      }
+      err = rbi->read_back_framebuffer
+        (buffer, rt_id, x, y, width, height, has_size ? &read_size : NULL,data);
+    } break;
+    /* Command buffers. */
+    case RB_TRACE_create_command_buffer: {
+      struct rb_command_buffer* cmd = NULL;
+      struct rb_context* ctxt = get_handle(replay, rd);
+      err = rbi->create_command_buffer(ctxt, get_u64(rd) ? &cmd : NULL);
+      set_handle(replay, rd, cmd);
+    } break;
+    case RB_TRACE_command_buffer_ref_get:
+      err = rbi->command_buffer_ref_get(get_handle(replay, rd));
+      break;
+    case RB_TRACE_command_buffer_ref_put:
+      err = rbi->command_buffer_ref_put(get_handle(replay, rd));
+      break;
+    case RB_TRACE_reset_command_buffer:
+      err = rbi->reset_command_buffer(get_handle(replay, rd));
+      break;
+    case RB_TRACE_cmd_bind_program: {
+      struct rb_command_buffer* cmd = get_handle(replay, rd);
+      struct rb_program* prog = get_handle(replay, rd);
+      err = rbi->cmd_bind_program(cmd, prog);
+    } break;
+    case RB_TRACE_cmd_bind_vertex_array: {
+      struct rb_command_buffer* cmd = get_handle(replay, rd);
+      struct rb_vertex_array* varray = get_handle(replay, rd);
+      err = rbi->cmd_bind_vertex_array(cmd, varray);
+    } break;
+    case RB_TRACE_cmd_bind_tex2d: {
+      struct rb_command_buffer* cmd = get_handle(replay, rd);
+      struct rb_tex2d* tex = get_handle(replay, rd);
+      const unsigned int unit = (unsigned int)get_u64(rd);
+      err = rbi->cmd_bind_tex2d(cmd, tex, unit);
+    } break;
+    case RB_TRACE_cmd_bind_sampler: {
+      struct rb_command_buffer* cmd = get_handle(replay, rd);
+      struct rb_sampler* sampler = get_handle(replay, rd);
+      const unsigned int unit = (unsigned int)get_u64(rd);
+      err = rbi->cmd_bind_sampler(cmd, sampler, unit);
+    } break;
+    case RB_TRACE_cmd_bind_framebuffer: {
+      struct rb_command_buffer* cmd = get_handle(replay, rd);
+      struct rb_framebuffer* buffer = get_handle(replay, rd);
+      err = rbi->cmd_bind_framebuffer(cmd, buffer);
+    } break;
+    case RB_TRACE_cmd_blend: {
+      struct rb_command_buffer* cmd = get_handle(replay, rd);
+      err = rbi->cmd_blend
+        (cmd, get_sized_blob(rd, sizeof(struct rb_blend_desc)));
+    } break;
+    case RB_TRACE_cmd_depth_stencil: {
+      struct rb_command_buffer* cmd = get_handle(replay, rd);
+      err = rbi->cmd_depth_stencil
+        (cmd, get_sized_blob(rd, sizeof(struct rb_depth_stencil_desc)));
+    } break;
+    case RB_TRACE_cmd_rasterizer: {
+      struct rb_command_buffer* cmd = get_handle(replay, rd);
+      err = rbi->cmd_rasterizer
+        (cmd, get_sized_blob(rd, sizeof(struct rb_rasterizer_desc)));
+    } break;
+    case RB_TRACE_cmd_viewport: {
+      struct rb_command_buffer* cmd = get_handle(replay, rd);
+      err = rbi->cmd_viewport
+        (cmd, get_sized_blob(rd, sizeof(struct rb_viewport_desc)));
+    } break;
+    case RB_TRACE_cmd_clear: {
+      struct rb_command_buffer* cmd = get_handle(replay, rd);
+      const int flag = (int)get_i64(rd);
+      const float* color = get_sized_blob(rd, 4 * sizeof(float));
+      const float depth = (float)get_f64(rd);
+      const char stencil = (char)get_i64(rd);
+      err = rbi->cmd_clear(cmd, flag, color, depth, stencil);
+    } break;
+    case RB_TRACE_cmd_uniform_data: {
+      struct rb_command_buffer* cmd = get_handle(replay, rd);
+      struct rb_uniform* uniform = get_handle(replay, rd);
+      const int count = (int)get_i64(rd);
+      const void* data = get_blob(rd, NULL);
+      err = rbi->cmd_uniform_data(cmd, uniform, count, data);
+    } break;
+    case RB_TRACE_cmd_buffer_data: {
+      struct rb_command_buffer* cmd = get_handle(replay, rd);
+      struct rb_buffer* buf = get_handle(replay, rd);
+      const int offset = (int)get_i64(rd);
+      const int size = (int)get_i64(rd);
+      const void* data = get_blob(rd, NULL);
+      err = rbi->cmd_buffer_data(cmd, buf, offset, size, data);
+    } break;
+    case RB_TRACE_cmd_draw: {
+      struct rb_command_buffer* cmd = get_handle(replay, rd);
+      const enum rb_primitive_type prim = (enum rb_primitive_type)get_u64(rd);
+      const unsigned int count = (unsigned int)get_u64(rd);
+      err = rbi->cmd_draw(cmd, prim, count);
+    } break;
+    case RB_TRACE_cmd_draw_indexed: {
+      struct rb_command_buffer* cmd = get_handle(replay, rd);
+      const enum rb_primitive_type prim = (enum rb_primitive_type)get_u64(rd);
+      const unsigned int count = (unsigned int)get_u64(rd);
+      err = rbi->cmd_draw_indexed(cmd, prim, count);
+    } break;
+    case RB_TRACE_submit_command_buffers: {
+      struct rb_command_buffer** list = NULL;
+      struct rb_context* ctxt = get_handle(replay, rd);
+      const uint64_t has_list = get_u64(rd);
+      const size_t count = (size_t)get_u64(rd);
+      size_t i = 0;
+      if(has_list && count) {
+        if(count > (size_t)(rd->end - rd->cur) / sizeof(uint64_t)
+        || !(list = scratch(replay, count * sizeof(void*)))) {
+          rd->error = 1;
+          break;
+        }
+        for(i = 0; i < count; ++i)
+          list[i] = get_handle(replay, rd);
+      }
+      err = rbi->submit_command_buffers(ctxt, count, list);
+    } break;
+    /* Bundles. */
+    case RB_TRACE_create_bundle: {
+      struct rb_bundle* bundle = NULL;
+      struct rb_context* ctxt = get_handle(replay, rd);
+      struct rb_command_buffer* cmd = get_handle(replay, rd);
+      err = rbi->create_bundle(ctxt, cmd, get_u64(rd) ? &bundle : NULL);
+      set_handle(replay, rd, bundle);
+    } break;
+    case RB_TRACE_bundle_ref_get:
+      err = rbi->bundle_ref_get(get_handle(replay, rd));
+      break;
+    case RB_TRACE_bundle_ref_put:
+      err = rbi->bundle_ref_put(get_handle(replay, rd));
+      break;
+    case RB_TRACE_bundle_uniform_data: {
+      struct rb_bundle* bundle = get_handle(replay, rd);
+      struct rb_uniform* uniform = get_handle(replay, rd);
+      const int count = (int)get_i64(rd);
+      const void* data = get_blob(rd, NULL);
+      err = rbi->bundle_uniform_data(bundle, uniform, count, data);
+    } break;
+    case RB_TRACE_execute_bundle: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      err = rbi->execute_bundle(ctxt, get_handle(replay, rd));
+    } break;
+    /* Fences. */
+    case RB_TRACE_create_fence: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      struct rb_fence* fence = NULL;
+      err = rbi->create_fence(ctxt, get_u64(rd) ? &fence : NULL);
+      set_handle(replay, rd, fence);
+    } break;
+    case RB_TRACE_fence_ref_get:
+      err = rbi->fence_ref_get(get_handle(replay, rd));
+      break;
+    case RB_TRACE_fence_ref_put:
+      err = rbi->fence_ref_put(get_handle(replay, rd));
+      break;
+    case RB_TRACE_wait_fence: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      err = rbi->wait_fence(ctxt, get_handle(replay, rd));
+    } break;
+    case RB_TRACE_poll_fence: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      struct rb_fence* fence = get_handle(replay, rd);
+      int is_signaled = 0;
+      err = rbi->poll_fence(ctxt, fence, get_u64(rd) ? &is_signaled : NULL);
+    } break;
+    /* Miscellaneous. */
+    case RB_TRACE_blend: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      err = rbi->blend(ctxt, get_sized_blob(rd, sizeof(struct rb_blend_desc)));
+    } break;
+    case RB_TRACE_clear: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      const int flag = (int)get_i64(rd);
+      const float* color = get_sized_blob(rd, 4 * sizeof(float));
+      const float depth = (float)get_f64(rd);
+      const char stencil = (char)get_i64(rd);
+      err = rbi->clear(ctxt, flag, color, depth, stencil);
+    } break;
+    case RB_TRACE_depth_stencil: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      err = rbi->depth_stencil
+        (ctxt, get_sized_blob(rd, sizeof(struct rb_depth_stencil_desc)));
+    } break;
+    case RB_TRACE_draw: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      const enum rb_primitive_type prim = (enum rb_primitive_type)get_u64(rd);
+      const unsigned int count = (unsigned int)get_u64(rd);
+      err = rbi->draw(ctxt, prim, count);
+    } break;
+    case RB_TRACE_draw_indexed: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      const enum rb_primitive_type prim = (enum rb_primitive_type)get_u64(rd);
+      const unsigned int count = (unsigned int)get_u64(rd);
+      err = rbi->draw_indexed(ctxt, prim, count);
+    } break;
+    case RB_TRACE_multi_draw_indexed: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      const enum rb_primitive_type prim = (enum rb_primitive_type)get_u64(rd);
+      const unsigned int nb_ranges = (unsigned int)get_u64(rd);
+      const struct rb_draw_range* ranges = get_blob(rd, NULL);
+      err = rbi->multi_draw_indexed(ctxt, prim, nb_ranges, ranges);
+    } break;
+    case RB_TRACE_error_check: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      err = rbi->error_check
+        (ctxt, get_sized_blob(rd, sizeof(struct rb_error_check_desc)));
+    } break;
+    case RB_TRACE_flush:
+      err = rbi->flush(get_handle(replay, rd));
+      break;
+    case RB_TRACE_begin_frame:
+      err = rbi->begin_frame(get_handle(replay, rd));
+      break;
+    case RB_TRACE_end_frame:
+      err = rbi->end_frame(get_handle(replay, rd));
+      break;
+    case RB_TRACE_frame_alloc: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      const size_t size = (size_t)get_u64(rd);
+      void* mem = NULL;
+      err = rbi->frame_alloc(ctxt, size, get_u64(rd) ? &mem : NULL);
+    } break;
+    case RB_TRACE_rasterizer: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      err = rbi->rasterizer
+        (ctxt, get_sized_blob(rd, sizeof(struct rb_rasterizer_desc)));
+    } break;
+    case RB_TRACE_viewport: {
+      struct rb_context* ctxt = get_handle(replay, rd);
+      err = rbi->viewport
+        (ctxt, get_sized_blob(rd, sizeof(struct rb_viewport_desc)));
+    } break;
+    case RB_TRACE_get_config: {
+      struct rb_config cfg;
+      struct rb_context* ctxt = get_handle(replay, rd);
+      err = rbi->get_config(ctxt, get_u64(rd) ? &cfg : NULL);
+    } break;
+    case RB_TRACE_get_pool_stats: {
+      struct rb_pool_stats stats;
+      struct rb_context* ctxt = get_handle(replay, rd);
+      err = rbi->get_pool_stats(ctxt, get_u64(rd) ? &stats : NULL);
+    } break;
+    case RB_TRACE_FUNCS_COUNT:
+      rd->error = 1;
+      break;
+  }
+  return err;
+}
+
+/*******************************************************************************
+ *
+ * Program entry point.
+ *
+ ******************************************************************************/
+int
+main(int argc, char** argv)
+{
+  struct replay replay;
+  struct timespec frame_t0, t0, t1;
+  const struct rb_trace_header* header = NULL;
+  const unsigned char* file = NULL;
+  const unsigned char* cur = NULL;
+  const unsigned char* end = NULL;
+  unsigned char* inflated = NULL;
+  size_t inflated_size = 0;
+  size_t file_size = 0;
+  double frame_time = 0.0;
+  double excluded_time = 0.0; /* Decompression time of the current frame. */
+  double min_time = 0.0;
+  double max_time = 0.0;
+  double total_time = 0.0;
+  size_t nb_frames = 0;
+  size_t frame_calls = 0;
+  struct stat st;
+  int fd = -1;
+  int quiet = 0;
+  int has_frame_ends = 0; /* Are the frames delimited by rb_end_frame? */
+  int is_rbi_init = 0;
+  int err = 0;
+
+  memset(&replay, 0, sizeof(replay));
+
+  if(argc == 4 && !strcmp(argv[1], "-q")) {
+    quiet = 1;
+    --argc;
+    ++argv;
+  }
+  if(argc != 3) {
+    printf("usage: rb_replay [-q] RB_DRIVER TRACE\n");
+    return -1;
+  }
+
+  fd = open(argv[2], O_RDONLY);
+  if(fd < 0 || fstat(fd, &st) != 0) {
+    fprintf(stderr, "Cannot open the trace `%s'.\n", argv[2]);
+    goto error;
+  }
+  file_size = (size_t)st.st_size;
+  if(file_size < sizeof(struct rb_trace_header)) {
+    fprintf(stderr, "Invalid trace file.\n");
+    goto error;
+  }
+  file = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if(file == MAP_FAILED) {
+    file = NULL;
+    fprintf(stderr, "Cannot map the trace file.\n");
+    goto error;
+  }
+  header = (const struct rb_trace_header*)file;
+  if(memcmp(header->magic, RB_TRACE_MAGIC, sizeof(RB_TRACE_MAGIC))
+  || header->version != RB_TRACE_VERSION
+  || header->funcs_count != RB_TRACE_FUNCS_COUNT) {
+    fprintf(stderr, "Incompatible trace file.\n");
+    goto error;
+  }
+
+  if(rbi_init(argv[1], &replay.rbi) != 0)
+    goto error;
+  is_rbi_init = 1;
+
+  cur = file + sizeof(struct rb_trace_header);
+  end = file + file_size;
+  clock_gettime(CLOCK_MONOTONIC, &frame_t0);
+  while(cur + sizeof(struct rb_trace_chunk) <= end) {
+    const struct rb_trace_chunk* chunk = (const struct rb_trace_chunk*)cur;
+    struct reader calls;
+
+    cur += sizeof(struct rb_trace_chunk);
+    if(chunk->stored_size > (size_t)(end - cur)) {
+      fprintf(stderr, "Truncated trace file.\n");
+      goto error;
+    }
+    calls.cur = cur;
+    calls.end = cur + chunk->size;
+    calls.error = 0;
+
+    if(chunk->flags & RB_TRACE_CHUNK_COMPRESSED) {
+#ifdef RB_TRACE_USE_ZLIB
+      uLongf size = chunk->size;
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+      if(chunk->size > inflated_size) {
+        unsigned char* mem = realloc(inflated, chunk->size);
+        if(!mem)
+          goto error;
+        inflated = mem;
+        inflated_size = chunk->size;
+      }
+      if(Z_OK != uncompress(inflated, &size, cur, chunk->stored_size)
+      || size != chunk->size) {
+        fprintf(stderr, "Invalid compressed chunk.\n");
+        goto error;
+      }
+      calls.cur = inflated;
+      calls.end = inflated + chunk->size;
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      excluded_time += elapsed_ms(&t0, &t1);
+#else
+      fprintf(stderr, "Compressed traces are not supported.\n");
+      goto error;
+#endif
+    }
+    cur += rb_trace_align(chunk->stored_size);
+
+    while(calls.cur + sizeof(struct rb_trace_call) <= calls.end) {
+      const struct rb_trace_call* call = (const struct rb_trace_call*)calls.cur;
+      struct reader args;
+
+      args.cur = calls.cur + sizeof(struct rb_trace_call);
+      args.end = args.cur + call->size;
+      args.error = 0;
+      if(args.end > calls.end || call->func >= RB_TRACE_FUNCS_COUNT) {
+        fprintf(stderr, "Invalid trace call.\n");
+        goto error;
+      }
+      calls.cur = args.end;
+
+      if(replay_call(&replay, call->func, &args) != call->err)
+        ++replay.nb_mismatches;
+      if(args.error) {
+        fprintf(stderr, "Invalid arguments of %s.\n", func_names[call->func]);
+        goto error;
+      }
+      ++replay.nb_calls;
+      ++frame_calls;
+
+      /* A flush ends the frame unless the frames are explicitly delimited. */
+      if(call->func == RB_TRACE_end_frame && call->err == 0)
+        has_frame_ends = 1;
+      if((call->func == RB_TRACE_end_frame && call->err == 0)
+      || (call->func == RB_TRACE_flush && !has_frame_ends)) {
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        frame_time = elapsed_ms(&frame_t0, &t1) - excluded_time;
+        if(!quiet) {
+          printf("frame %lu: %.3f ms (%lu calls)\n",
+            (unsigned long)nb_frames, frame_time, (unsigned long)frame_calls);
+        }
+        min_time = nb_frames ? MIN(min_time, frame_time) : frame_time;
+        max_time = nb_frames ? MAX(max_time, frame_time) : frame_time;
+        total_time += frame_time;
+        ++nb_frames;
+        frame_calls = 0;
+        excluded_time = 0.0;
+        clock_gettime(CLOCK_MONOTONIC, &frame_t0);
+      }
+    }
+  }
+
+  printf("%lu calls, %lu frames",
+    (unsigned long)replay.nb_calls, (unsigned long)nb_frames);
+  if(nb_frames) {
+    printf(": %.3f ms total, %.3f ms avg, %.3f ms min, %.3f ms max",
+      total_time, total_time / (double)nb_frames, min_time, max_time);
+  }
+  printf("\n");
+  if(replay.nb_mismatches) {
+    printf("%lu calls do not return their recorded value\n",
+      (unsigned long)replay.nb_mismatches);
+  }
+
+exit:
+  if(is_rbi_init)
+    rbi_shutdown(&replay.rbi);
+  if(file)
+    munmap((void*)file, file_size);
+  if(fd >= 0)
+    close(fd);
+  free(inflated);
+  free(replay.handles);
+  free(replay.scratch);
+  return err;
+error:
+  err = -1;
+  goto exit;
+}
@@ -0,0 +1,1596 @@
+#include "rbi/rbi.h"
+#include "trace/rb_trace.h"
+#include "rb.h"
+#include <snlsys/math.h>
+#include <snlsys/snlsys.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef RB_TRACE_USE_ZLIB
+  #include <zlib.h>
+#endif
+
+/* Size from which the current chunk is written into the trace file. */
+#define CHUNK_SIZE (1024 * 1024)
+
+/* Entry of the table that maps the backend handles to their trace id. */
+struct handle {
+  const void* ptr;
+  uint32_t id;
+  /* Layout of the texture handles. Used to define the size of the data
+   * submitted through tex2d_data. */
+  struct rb_tex2d_desc tex2d_desc;
+};
+
+/* The recorder is a process wide state since several rb functions are not
+ * bound to a context. The traced calls are serialized by the trace mutex since
+ * the command buffers may be recorded by several threads. */
+static struct trace {
+  struct rbi rbi; /* Traced backend. */
+  int is_layer; /* The traced functions are those of the next rbi layer. */
+  FILE* stream;
+  /* Chunk under construction. */
+  unsigned char* chunk;
+  size_t chunk_size;
+  size_t chunk_capacity;
+  size_t call_offset; /* Offset of the header of the current call. */
+  unsigned char* zbuf; /* Compressed chunk. */
+  size_t zbuf_capacity;
+  int compress;
+  /* Open addressing hash table of the handles. */
+  struct handle* handles;
+  size_t handles_capacity;
+  size_t handles_count;
+  uint32_t next_id;
+  int is_init;
+} trace;
+
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *
+ * Helper functions.
+ *
+ ******************************************************************************/
+static void
+stop_recording(const char* msg)
+{
+  fprintf(stderr, "rb-trace: %s. Stop the recording.\n", msg);
+  if(trace.stream) {
+    fclose(trace.stream);
+    trace.stream = NULL;
+  }
+}
+
+static int
+reserve(size_t size)
+{
+  unsigned char* chunk = NULL;
+  size_t capacity = 0;
+
+  if(trace.chunk_size + size <= trace.chunk_capacity)
+    return 0;
+
+  capacity = MAX(trace.chunk_capacity * 2, trace.chunk_size + size);
+  chunk = realloc(trace.chunk, capacity);
+  if(!chunk)
+    return -1;
+  trace.chunk = chunk;
+  trace.chunk_capacity = capacity;
+  return 0;
+}
+
+static void
+write_chunk(void)
+{
+  struct rb_trace_chunk header;
+  const void* data = trace.chunk;
+  size_t padding_size = 0;
+  static const char padding[RB_TRACE_ALIGNMENT];
+
+  if(!trace.stream || !trace.chunk_size)
+    goto exit;
+
+  memset(&header, 0, sizeof(header));
+  header.size = (uint32_t)trace.chunk_size;
+  header.stored_size = (uint32_t)trace.chunk_size;
+
+#ifdef RB_TRACE_USE_ZLIB
+  if(trace.compress) {
+    uLongf zsize = compressBound((uLong)trace.chunk_size);
+    if(zsize > trace.zbuf_capacity) {
+      unsigned char* zbuf = realloc(trace.zbuf, zsize);
+      if(!zbuf) {
+        stop_recording("cannot allocate the compression buffer");
+        goto exit;
+      }
+      trace.zbuf = zbuf;
+      trace.zbuf_capacity = zsize;
+    }
+    if(Z_OK == compress2
+       (trace.zbuf, &zsize, trace.chunk, (uLong)trace.chunk_size, 1)
+    && zsize < trace.chunk_size) {
+      header.stored_size = (uint32_t)zsize;
+      header.flags = RB_TRACE_CHUNK_COMPRESSED;
+      data = trace.zbuf;
+    }
+  }
+#endif
+
+  padding_size = rb_trace_align(header.stored_size) - header.stored_size;
+  if(1 != fwrite(&header, sizeof(header), 1, trace.stream)
+  || 1 != fwrite(data, header.stored_size, 1, trace.stream)
+  || (padding_size && 1 != fwrite(padding, padding_size, 1, trace.stream))) {
+    stop_recording("cannot write the trace file");
+  }
+
+exit:
+  trace.chunk_size = 0;
+}
+
+static struct handle*
+find_handle(const void* ptr)
+{
+  size_t i = 0;
+  ASSERT(ptr && trace.handles_capacity);
+
+  i = (size_t)(((uintptr_t)ptr >> 4) * 0x9E3779B97F4A7C15ull);
+  for(i &= trace.handles_capacity - 1;
+      trace.handles[i].ptr && trace.handles[i].ptr != ptr;
+      i = (i + 1) & (trace.handles_capacity - 1));
+  return trace.handles + i;
+}
+
+static struct handle*
+register_handle(const void* ptr)
+{
+  struct handle* handle = NULL;
+  ASSERT(ptr);
+
+  if((trace.handles_count + 1) * 2 > trace.handles_capacity) {
+    struct handle* old_handles = trace.handles;
+    const size_t old_capacity = trace.handles_capacity;
+    size_t i = 0;
+
+    trace.handles_capacity = MAX(old_capacity * 2, 256);
+    trace.handles = calloc(trace.handles_capacity, sizeof(struct handle));
+    if(!trace.handles) {
+      trace.handles = old_handles;
+      trace.handles_capacity = old_capacity;
+      return NULL;
+    }
+    for(i = 0; i < old_capacity; ++i) {
+      if(old_handles[i].ptr)
+        *find_handle(old_handles[i].ptr) = old_handles[i];
+    }
+    free(old_handles);
+  }
+  handle = find_handle(ptr);
+  if(!handle->ptr)
+    ++trace.handles_count;
+  /* A released object may share the address of a new one. Its entry is thus
+   * simply overwritten. */
+  memset(handle, 0, sizeof(struct handle));
+  handle->ptr = ptr;
+  handle->id = ++trace.next_id;
+  return handle;
+}
+
+static uint32_t
+handle_id(const void* ptr)
+{
+  struct handle* handle = NULL;
+  if(!ptr || !trace.handles_capacity)
+    return 0;
+  handle = find_handle(ptr);
+  return handle->ptr ? handle->id : 0;
+}
+
+static void
+begin_call(void)
+{
+  trace.call_offset = trace.chunk_size;
+  if(reserve(sizeof(struct rb_trace_call)) != 0) {
+    stop_recording("cannot allocate the trace chunk");
+    trace.chunk_size = 0;
+    return;
+  }
+  trace.chunk_size += sizeof(struct rb_trace_call);
+}
+
+static void
+end_call(enum rb_trace_func func, int err)
+{
+  struct rb_trace_call* call = NULL;
+
+  /* The call header was not allocated. */
+  if(trace.chunk_size < trace.call_offset + sizeof(struct rb_trace_call))
+    return;
+
+  call = (struct rb_trace_call*)(trace.chunk + trace.call_offset);
+  call->func = (uint16_t)func;
+  call->err = (int16_t)err;
+  call->size = (uint32_t)
+    (trace.chunk_size - trace.call_offset - sizeof(struct rb_trace_call));
+  if(trace.chunk_size >= CHUNK_SIZE)
+    write_chunk();
+}
+
+static void
+put_u64(uint64_t val)
+{
+  if(reserve(sizeof(uint64_t)) != 0) {
+    stop_recording("cannot allocate the trace chunk");
+    return;
+  }
+  memcpy(trace.chunk + trace.chunk_size, &val, sizeof(uint64_t));
+  trace.chunk_size += sizeof(uint64_t);
+}
+
+static FINLINE void
+put_i64(int64_t val)
+{
+  put_u64((uint64_t)val);
+}
+
+static FINLINE void
+put_f64(double val)
+{
+  uint64_t u64 = 0;
+  memcpy(&u64, &val, sizeof(double));
+  put_u64(u64);
+}
+
+static FINLINE void
+put_handle(const void* ptr)
+{
+  put_u64(handle_id(ptr));
+}
+
+/* Register and put the handle returned by a successful call. */
+static struct handle*
+put_new_handle(int err, const void* ptr)
+{
+  struct handle* handle = NULL;
+  if(err == 0 && ptr) {
+    handle = register_handle(ptr);
+    if(!handle)
+      stop_recording("cannot register the handle");
+  }
+  put_u64(handle ? handle->id : 0);
+  return handle;
+}
+
+static void
+put_blob(const void* data, size_t size)
+{
+  if(!data) {
+    put_u64(RB_TRACE_NULL_BLOB);
+    return;
+  }
+  put_u64(size);
+  if(reserve(rb_trace_align(size)) != 0) {
+    stop_recording("cannot allocate the trace chunk");
+    return;
+  }
+  memcpy(trace.chunk + trace.chunk_size, data, size);
+  memset(trace.chunk + trace.chunk_size+size, 0, rb_trace_align(size)-size);
+  trace.chunk_size += rb_trace_align(size);
+}
+
+static FINLINE void
+put_string(const char* str)
+{
+  put_blob(str, str ? strlen(str) + 1 : 0);
+}
+
+static void
+put_render_target(const struct rb_render_target* rt)
+{
+  ASSERT(rt);
+  put_u64(rt->type);
+  put_handle(rt->resource);
+  switch(rt->type) {
+    case RB_RENDER_TARGET_TEXTURE2D: put_u64(rt->desc.tex2d.mip_level); break;
+    default: ASSERT(0); break;
+  }
+}
+
+static size_t
+sizeof_type(enum rb_type type)
+{
+  switch(type) {
+    case RB_FLOAT: return sizeof(float);
+    case RB_FLOAT2: return 2 * sizeof(float);
+    case RB_FLOAT3: return 3 * sizeof(float);
+    case RB_FLOAT4: return 4 * sizeof(float);
+    case RB_FLOAT4x4: return 16 * sizeof(float);
+    /* Samplers and scalar integers are the most common unknown types. */
+    default: return sizeof(int32_t);
+  }
+}
+
+/* Size of a pixel as read by the backends. Note that the integer formats
+ * store each component on 32-bits. */
+static size_t
+sizeof_pixel(enum rb_tex_format fmt)
+{
+  switch(fmt) {
+    case RB_R: return 1;
+    case RB_RGB: case RB_SRGB: return 3;
+    case RB_RGBA: case RB_SRGBA: return 4;
+    case RB_R_UINT16: case RB_R_UINT32: return 4;
+    case RB_RG_UINT16: case RB_RG_UINT32: return 8;
+    case RB_RGB_UINT16: case RB_RGB_UINT32: return 12;
+    case RB_RGBA_UINT16: case RB_RGBA_UINT32: return 16;
+    case RB_DEPTH_COMPONENT: case RB_DEPTH_STENCIL: return 4;
+    default: ASSERT(0); return 0;
+  }
+}
+
+static size_t
+sizeof_mip_level(const struct rb_tex2d_desc* desc, unsigned int level)
+{
+  ASSERT(desc && level < 32);
+  return
+    MAX(desc->width >> level, 1u)
+  * MAX(desc->height >> level, 1u)
+  * sizeof_pixel(desc->format);
+}
+
+static int
+init_trace(void)
+{
+  struct rb_trace_header header;
+  const char* backend = getenv("RB_TRACE_BACKEND");
+  const char* filename = getenv("RB_TRACE_FILE");
+  const char* compress = getenv("RB_TRACE_COMPRESS");
+
+  if(!trace.is_layer) {
+    if(!backend) {
+      fprintf(stderr,
+        "rb-trace: the RB_TRACE_BACKEND variable is not set.\n");
+      return -1;
+    }
+    /* The layers of RBI_LAYERS are already applied by the outer loader. */
+    if(rbi_init_layers(backend, NULL, &trace.rbi) != 0)
+      return -1;
+  }
+
+  trace.stream = fopen(filename ? filename : "rb.trace", "wb");
+  if(!trace.stream) {
+    fprintf(stderr, "rb-trace: cannot open the trace file.\n");
+    if(!trace.is_layer)
+      rbi_shutdown(&trace.rbi);
+    return -1;
+  }
+  trace.compress = compress && strcmp(compress, "0");
+#ifndef RB_TRACE_USE_ZLIB
+  if(trace.compress) {
+    fprintf(stderr, "rb-trace: compression is not supported.\n");
+    trace.compress = 0;
+  }
+#endif
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, RB_TRACE_MAGIC, sizeof(RB_TRACE_MAGIC));
+  header.version = RB_TRACE_VERSION;
+  header.funcs_count = RB_TRACE_FUNCS_COUNT;
+  if(1 != fwrite(&header, sizeof(header), 1, trace.stream))
+    stop_recording("cannot write the trace header");
+
+  trace.is_init = 1;
+  return 0;
+}
+
+/* Lazily initialize the recorder on the creation of the first context. The
+ * contexts may be created concurrently, e.g. one per thread: the check and the
+ * initialization are thus done under the trace mutex. */
+static int
+setup_trace(void)
+{
+  int err = 0;
+  pthread_mutex_lock(&trace_mutex);
+  if(!trace.is_init)
+    err = init_trace();
+  pthread_mutex_unlock(&trace_mutex);
+  return err;
+}
+
+static void __attribute__((destructor))
+shutdown_trace(void)
+{
+  if(!trace.is_init)
+    return;
+  write_chunk();
+  if(trace.stream)
+    fclose(trace.stream);
+  free(trace.chunk);
+  free(trace.zbuf);
+  free(trace.handles);
+  memset(&trace, 0, sizeof(trace));
+}
+
+/*******************************************************************************
+ *
+ * rbi layer entry point.
+ *
+ ******************************************************************************/
+/* Loaded as a rbi layer, the recorder traces the functions of the next layer
+ * rather than those of the RB_TRACE_BACKEND library. */
+EXPORT_SYM int rbi_layer_next(const struct rbi* next);
+
+int
+rbi_layer_next(const struct rbi* next)
+{
+  if(!next || trace.is_init || trace.is_layer)
+    return -1;
+  trace.rbi = *next;
+  trace.is_layer = 1;
+  return 0;
+}
+
+/* Define the prologue/epilogue of the traced functions. */
+#define BEGIN_CALL()                                                           \
+  if(UNLIKELY(!trace.is_init))                                                 \
+    return -1;                                                                 \
+  pthread_mutex_lock(&trace_mutex);                                            \
+  begin_call()
+
+#define END_CALL(func, err)                                                    \
+  end_call(RB_TRACE_##func, err);                                              \
+  pthread_mutex_unlock(&trace_mutex);                                          \
+  return err
+
+/* Generic recorder of the functions whose arguments are handles. */
+#define TRACE_FUNC_1H(func, type0)                                             \
+  int                                                                          \
+  rb_##func(type0 a0)                                                          \
+  {                                                                            \
+    int err = 0;                                                               \
+    BEGIN_CALL();                                                              \
+    put_handle(a0);                                                            \
+    err = trace.rbi.func(a0);                                                  \
+    END_CALL(func, err);                                                       \
+  }
+
+#define TRACE_FUNC_2H(func, type0, type1)                                      \
+  int                                                                          \
+  rb_##func(type0 a0, type1 a1)                                                \
+  {                                                                            \
+    int err = 0;                                                               \
+    BEGIN_CALL();                                                              \
+    put_handle(a0);                                                            \
+    put_handle(a1);                                                            \
+    err = trace.rbi.func(a0, a1);                                              \
+    END_CALL(func, err);                                                       \
+  }
+
+/* Recorder of the functions that submit a descriptor to a context. */
+#define TRACE_FUNC_DESC(func, desc_type)                                       \
+  int                                                                          \
+  rb_##func(struct rb_context* ctxt, const desc_type* desc)                    \
+  {                                                                            \
+    int err = 0;                                                               \
+    BEGIN_CALL();                                                              \
+    put_handle(ctxt);                                                          \
+    put_blob(desc, sizeof(desc_type));                                         \
+    err = trace.rbi.func(ctxt, desc);                                          \
+    END_CALL(func, err);                                                       \
+  }
+
+/* Recorder of the functions that record a descriptor into a command buffer. */
+#define TRACE_CMD_DESC(func, desc_type)                                        \
+  int                                                                          \
+  rb_##func(struct rb_command_buffer* cmd, const desc_type* desc)              \
+  {                                                                            \
+    int err = 0;                                                               \
+    BEGIN_CALL();                                                              \
+    put_handle(cmd);                                                           \
+    put_blob(desc, sizeof(desc_type));                                         \
+    err = trace.rbi.func(cmd, desc);                                           \
+    END_CALL(func, err);                                                       \
+  }
+
+/*******************************************************************************
+ *
+ * Render backend context.
+ *
+ ******************************************************************************/
+int
+rb_create_context(struct mem_allocator* allocator, struct rb_context** out)
+{
+  int err = 0;
+
+  if(setup_trace() != 0)
+    return -1;
+
+  BEGIN_CALL();
+  put_u64(out != NULL);
+  err = trace.rbi.create_context(allocator, out);
+  put_new_handle(err, out ? *out : NULL);
+  END_CALL(create_context, err);
+}
+
+int
+rb_create_headless_context
+  (struct mem_allocator* allocator,
+   const struct rb_headless_desc* desc,
+   struct rb_context** out)
+{
+  int err = 0;
+
+  if(setup_trace() != 0)
+    return -1;
+
+  BEGIN_CALL();
+  put_blob(desc, sizeof(struct rb_headless_desc));
+  put_u64(out != NULL);
+  err = trace.rbi.create_headless_context(allocator, desc, out);
+  put_new_handle(err, out ? *out : NULL);
+  END_CALL(create_headless_context, err);
+}
+
+int
+rb_create_loader_context
+  (struct rb_context* ctxt,
+   struct rb_context** out_loader)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_u64(out_loader != NULL);
+  err = trace.rbi.create_loader_context(ctxt, out_loader);
+  put_new_handle(err, out_loader ? *out_loader : NULL);
+  END_CALL(create_loader_context, err);
+}
+
+TRACE_FUNC_1H(context_ref_get, struct rb_context*)
+TRACE_FUNC_1H(context_ref_put, struct rb_context*)
+
+/*******************************************************************************
+ *
+ * Texture 2d.
+ *
+ ******************************************************************************/
+int
+rb_bind_tex2d
+  (struct rb_context* ctxt,
+   struct rb_tex2d* tex,
+   unsigned int tex_unit)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_handle(tex);
+  put_u64(tex_unit);
+  err = trace.rbi.bind_tex2d(ctxt, tex, tex_unit);
+  END_CALL(bind_tex2d, err);
+}
+
+int
+rb_create_tex2d
+  (struct rb_context* ctxt,
+   const struct rb_tex2d_desc* desc,
+   const void* init_data[],
+   struct rb_tex2d** out_tex)
+{
+  struct handle* handle = NULL;
+  unsigned int i = 0;
+  int err = 0;
+
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_blob(desc, sizeof(struct rb_tex2d_desc));
+  put_u64(init_data != NULL);
+  if(desc && init_data) {
+    for(i = 0; i < desc->mip_count; ++i)
+      put_blob(init_data[i], sizeof_mip_level(desc, i));
+  }
+  put_u64(out_tex != NULL);
+  err = trace.rbi.create_tex2d(ctxt, desc, init_data, out_tex);
+  handle = put_new_handle(err, out_tex ? *out_tex : NULL);
+  if(handle)
+    handle->tex2d_desc = *desc;
+  END_CALL(create_tex2d, err);
+}
+
+TRACE_FUNC_1H(tex2d_ref_get, struct rb_tex2d*)
+TRACE_FUNC_1H(tex2d_ref_put, struct rb_tex2d*)
+
+int
+rb_tex2d_data(struct rb_tex2d* tex, unsigned int level, const void* data)
+{
+  struct handle* handle = NULL;
+  size_t size = 0;
+  int err = 0;
+
+  BEGIN_CALL();
+  if(tex) {
+    handle = find_handle(tex);
+    if(handle->ptr && level < handle->tex2d_desc.mip_count)
+      size = sizeof_mip_level(&handle->tex2d_desc, level);
+  }
+  put_handle(tex);
+  put_u64(level);
+  put_blob(data, size);
+  err = trace.rbi.tex2d_data(tex, level, data);
+  END_CALL(tex2d_data, err);
+}
+
+/*******************************************************************************
+ *
+ * Sampler.
+ *
+ ******************************************************************************/
+int
+rb_create_sampler
+  (struct rb_context* ctxt,
+   const struct rb_sampler_desc* desc,
+   struct rb_sampler** out_sampler)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_blob(desc, sizeof(struct rb_sampler_desc));
+  put_u64(out_sampler != NULL);
+  err = trace.rbi.create_sampler(ctxt, desc, out_sampler);
+  put_new_handle(err, out_sampler ? *out_sampler : NULL);
+  END_CALL(create_sampler, err);
+}
+
+TRACE_FUNC_1H(sampler_ref_get, struct rb_sampler*)
+TRACE_FUNC_1H(sampler_ref_put, struct rb_sampler*)
+
+int
+rb_sampler_parameters
+  (struct rb_sampler* sampler,
+   const struct rb_sampler_desc* desc)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(sampler);
+  put_blob(desc, sizeof(struct rb_sampler_desc));
+  err = trace.rbi.sampler_parameters(sampler, desc);
+  END_CALL(sampler_parameters, err);
+}
+
+int
+rb_bind_sampler
+  (struct rb_context* ctxt,
+   struct rb_sampler* sampler,
+   unsigned int tex_unit)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_handle(sampler);
+  put_u64(tex_unit);
+  err = trace.rbi.bind_sampler(ctxt, sampler, tex_unit);
+  END_CALL(bind_sampler, err);
+}
+
+/*******************************************************************************
+ *
+ * Buffers.
+ *
+ ******************************************************************************/
+int
+rb_bind_buffer
+  (struct rb_context* ctxt,
+   struct rb_buffer* buf,
+   enum rb_buffer_target target)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_handle(buf);
+  put_u64(target);
+  err = trace.rbi.bind_buffer(ctxt, buf, target);
+  END_CALL(bind_buffer, err);
+}
+
+int
+rb_buffer_data(struct rb_buffer* buf, int offset, int size, const void* data)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(buf);
+  put_i64(offset);
+  put_i64(size);
+  put_blob(data, size > 0 ? (size_t)size : 0);
+  err = trace.rbi.buffer_data(buf, offset, size, data);
+  END_CALL(buffer_data, err);
+}
+
+int
+rb_create_buffer
+  (struct rb_context* ctxt,
+   const struct rb_buffer_desc* desc,
+   const void* init_data,
+   struct rb_buffer** out_buf)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_blob(desc, sizeof(struct rb_buffer_desc));
+  put_blob(init_data, desc ? desc->size : 0);
+  put_u64(out_buf != NULL);
+  err = trace.rbi.create_buffer(ctxt, desc, init_data, out_buf);
+  put_new_handle(err, out_buf ? *out_buf : NULL);
+  END_CALL(create_buffer, err);
+}
+
+TRACE_FUNC_1H(buffer_ref_get, struct rb_buffer*)
+TRACE_FUNC_1H(buffer_ref_put, struct rb_buffer*)
+
+/*******************************************************************************
+ *
+ * Vertex array.
+ *
+ ******************************************************************************/
+TRACE_FUNC_2H(bind_vertex_array, struct rb_context*, struct rb_vertex_array*)
+
+int
+rb_create_vertex_array
+  (struct rb_context* ctxt,
+   struct rb_vertex_array** out_varray)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_u64(out_varray != NULL);
+  err = trace.rbi.create_vertex_array(ctxt, out_varray);
+  put_new_handle(err, out_varray ? *out_varray : NULL);
+  END_CALL(create_vertex_array, err);
+}
+
+TRACE_FUNC_1H(vertex_array_ref_get, struct rb_vertex_array*)
+TRACE_FUNC_1H(vertex_array_ref_put, struct rb_vertex_array*)
+
+int
+rb_remove_vertex_attrib
+  (struct rb_vertex_array* varray,
+   int count,
+   const int* list_of_attrib_indices)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(varray);
+  put_i64(count);
+  put_blob
+    (list_of_attrib_indices, count > 0 ? (size_t)count * sizeof(int) : 0);
+  err = trace.rbi.remove_vertex_attrib(varray, count, list_of_attrib_indices);
+  END_CALL(remove_vertex_attrib, err);
+}
+
+int
+rb_vertex_attrib_array
+  (struct rb_vertex_array* varray,
+   struct rb_buffer* buf,
+   int count,
+   const struct rb_buffer_attrib* attr)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(varray);
+  put_handle(buf);
+  put_i64(count);
+  put_blob(attr, count > 0 ? (size_t)count*sizeof(struct rb_buffer_attrib) : 0);
+  err = trace.rbi.vertex_attrib_array(varray, buf, count, attr);
+  END_CALL(vertex_attrib_array, err);
+}
+
+TRACE_FUNC_2H(vertex_index_array, struct rb_vertex_array*, struct rb_buffer*)
+
+/*******************************************************************************
+ *
+ * Shaders.
+ *
+ ******************************************************************************/
+int
+rb_create_shader
+  (struct rb_context* ctxt,
+   enum rb_shader_type type,
+   const char* source,
+   size_t length,
+   struct rb_shader** out_shader)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_u64(type);
+  put_blob(source, length);
+  put_u64(out_shader != NULL);
+  err = trace.rbi.create_shader(ctxt, type, source, length, out_shader);
+  /* A shader that fails to compile is still returned to get its log. */
+  put_new_handle(0, out_shader ? *out_shader : NULL);
+  END_CALL(create_shader, err);
+}
+
+/* Forward the include resolution to the caller resolver and record the
+ * resolved sources that are served to the replayed call. */
+static int
+record_include
+  (void* data,
+   const char* path,
+   const char** out_source,
+   size_t* out_length)
+{
+  const struct rb_shader_variant_desc* desc = data;
+  int err = 0;
+  ASSERT(desc && desc->include);
+
+  err = desc->include(desc->include_data, path, out_source, out_length);
+  if(!err) {
+    put_u64(1);
+    put_string(path);
+    put_blob(*out_source, *out_length);
+  }
+  return err;
+}
+
+int
+rb_create_shader_variant
+  (struct rb_context* ctxt,
+   const struct rb_shader_variant_desc* desc,
+   struct rb_shader** out_shader)
+{
+  struct rb_shader_variant_desc traced_desc;
+  size_t i = 0;
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_u64(desc != NULL);
+  if(desc) {
+    traced_desc = *desc;
+    put_u64(desc->type);
+    put_blob(desc->source, desc->length);
+    put_u64(desc->nb_defines);
+    put_u64(desc->define_list != NULL);
+    for(i = 0; desc->define_list && i < desc->nb_defines; ++i) {
+      put_string(desc->define_list[i].name);
+      put_string(desc->define_list[i].value);
+    }
+    put_u64(desc->include != NULL);
+    if(desc->include) {
+      traced_desc.include = record_include;
+      traced_desc.include_data = (void*)desc;
+    }
+  }
+  put_u64(out_shader != NULL);
+  err = trace.rbi.create_shader_variant
+    (ctxt, desc ? &traced_desc : NULL, out_shader);
+  put_u64(0); /* End of the resolved includes. */
+  /* A shader that fails to compile is still returned to get its log. */
+  put_new_handle(0, out_shader ? *out_shader : NULL);
+  END_CALL(create_shader_variant, err);
+}
+
+TRACE_FUNC_1H(shader_ref_get, struct rb_shader*)
+TRACE_FUNC_1H(shader_ref_put, struct rb_shader*)
+
+int
+rb_get_shader_log(struct rb_shader* shader, const char** out_log)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(shader);
+  put_u64(out_log != NULL);
+  err = trace.rbi.get_shader_log(shader, out_log);
+  END_CALL(get_shader_log, err);
+}
+
+int
+rb_is_shader_attached(struct rb_shader* shader, int* out_is_attached)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(shader);
+  put_u64(out_is_attached != NULL);
+  err = trace.rbi.is_shader_attached(shader, out_is_attached);
+  END_CALL(is_shader_attached, err);
+}
+
+int
+rb_shader_source(struct rb_shader* shader, const char* source, size_t length)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(shader);
+  put_blob(source, length);
+  err = trace.rbi.shader_source(shader, source, length);
+  END_CALL(shader_source, err);
+}
+
+/*******************************************************************************
+ *
+ * Programs.
+ *
+ ******************************************************************************/
+TRACE_FUNC_2H(attach_shader, struct rb_program*, struct rb_shader*)
+TRACE_FUNC_2H(bind_program, struct rb_context*, struct rb_program*)
+
+int
+rb_create_program(struct rb_context* ctxt, struct rb_program** out_prog)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_u64(out_prog != NULL);
+  err = trace.rbi.create_program(ctxt, out_prog);
+  put_new_handle(err, out_prog ? *out_prog : NULL);
+  END_CALL(create_program, err);
+}
+
+TRACE_FUNC_2H(detach_shader, struct rb_program*, struct rb_shader*)
+TRACE_FUNC_1H(program_ref_get, struct rb_program*)
+TRACE_FUNC_1H(program_ref_put, struct rb_program*)
+
+int
+rb_get_program_log(struct rb_program* prog, const char** out_log)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(prog);
+  put_u64(out_log != NULL);
+  err = trace.rbi.get_program_log(prog, out_log);
+  END_CALL(get_program_log, err);
+}
+
+TRACE_FUNC_1H(link_program, struct rb_program*)
+
+int
+rb_program_is_ready(struct rb_program* prog, int* out_is_ready)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(prog);
+  put_u64(out_is_ready != NULL);
+  err = trace.rbi.program_is_ready(prog, out_is_ready);
+  END_CALL(program_is_ready, err);
+}
+
+TRACE_FUNC_DESC(compile_mode, struct rb_compile_desc)
+
+/*******************************************************************************
+ *
+ * Program uniforms.
+ *
+ ******************************************************************************/
+int
+rb_get_named_uniform
+  (struct rb_context* ctxt,
+   struct rb_program* prog,
+   const char* name,
+   struct rb_uniform** out_uniform)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_handle(prog);
+  put_string(name);
+  put_u64(out_uniform != NULL);
+  err = trace.rbi.get_named_uniform(ctxt, prog, name, out_uniform);
+  put_new_handle(err, out_uniform ? *out_uniform : NULL);
+  END_CALL(get_named_uniform, err);
+}
+
+int
+rb_get_uniforms
+  (struct rb_context* ctxt,
+   struct rb_program* prog,
+   size_t* out_nb_uniforms,
+   struct rb_uniform* out_uniform_list[])
+{
+  size_t i = 0;
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_handle(prog);
+  put_u64(out_nb_uniforms != NULL);
+  put_u64(out_uniform_list != NULL);
+  err = trace.rbi.get_uniforms(ctxt, prog, out_nb_uniforms, out_uniform_list);
+  if(err == 0 && out_nb_uniforms && out_uniform_list) {
+    put_u64(*out_nb_uniforms);
+    for(i = 0; i < *out_nb_uniforms; ++i)
+      put_new_handle(err, out_uniform_list[i]);
+  } else {
+    put_u64(0);
+  }
+  END_CALL(get_uniforms, err);
+}
+
+int
+rb_get_uniform_desc(struct rb_uniform* uniform, struct rb_uniform_desc* desc)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(uniform);
+  put_u64(desc != NULL);
+  err = trace.rbi.get_uniform_desc(uniform, desc);
+  END_CALL(get_uniform_desc, err);
+}
+
+int
+rb_uniform_data(struct rb_uniform* uniform, int count, const void* data)
+{
+  struct rb_uniform_desc desc;
+  size_t size = 0;
+  int err = 0;
+
+  BEGIN_CALL();
+  if(uniform && count > 0 && trace.rbi.get_uniform_desc(uniform, &desc) == 0)
+    size = (size_t)count * sizeof_type(desc.type);
+  put_handle(uniform);
+  put_i64(count);
+  put_blob(data, size);
+  err = trace.rbi.uniform_data(uniform, count, data);
+  END_CALL(uniform_data, err);
+}
+
+TRACE_FUNC_1H(uniform_ref_get, struct rb_uniform*)
+TRACE_FUNC_1H(uniform_ref_put, struct rb_uniform*)
+
+/*******************************************************************************
+ *
+ * Program attributes.
+ *
+ ******************************************************************************/
+int
+rb_get_attribs
+  (struct rb_context* ctxt,
+   struct rb_program* prog,
+   size_t* out_nb_attribs,
+   struct rb_attrib* out_attrib_list[])
+{
+  size_t i = 0;
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_handle(prog);
+  put_u64(out_nb_attribs != NULL);
+  put_u64(out_attrib_list != NULL);
+  err = trace.rbi.get_attribs(ctxt, prog, out_nb_attribs, out_attrib_list);
+  if(err == 0 && out_nb_attribs && out_attrib_list) {
+    put_u64(*out_nb_attribs);
+    for(i = 0; i < *out_nb_attribs; ++i)
+      put_new_handle(err, out_attrib_list[i]);
+  } else {
+    put_u64(0);
+  }
+  END_CALL(get_attribs, err);
+}
+
+int
+rb_get_named_attrib
+  (struct rb_context* ctxt,
+   struct rb_program* prog,
+   const char* name,
+   struct rb_attrib** out_attrib)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_handle(prog);
+  put_string(name);
+  put_u64(out_attrib != NULL);
+  err = trace.rbi.get_named_attrib(ctxt, prog, name, out_attrib);
+  put_new_handle(err, out_attrib ? *out_attrib : NULL);
+  END_CALL(get_named_attrib, err);
+}
+
+int
+rb_attrib_data(struct rb_attrib* attr, const void* data)
+{
+  struct rb_attrib_desc desc;
+  size_t size = 0;
+  int err = 0;
+
+  BEGIN_CALL();
+  if(attr && trace.rbi.get_attrib_desc(attr, &desc) == 0)
+    size = sizeof_type(desc.type);
+  put_handle(attr);
+  put_blob(data, size);
+  err = trace.rbi.attrib_data(attr, data);
+  END_CALL(attrib_data, err);
+}
+
+int
+rb_get_attrib_desc(const struct rb_attrib* attr, struct rb_attrib_desc* desc)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(attr);
+  put_u64(desc != NULL);
+  err = trace.rbi.get_attrib_desc(attr, desc);
+  END_CALL(get_attrib_desc, err);
+}
+
+TRACE_FUNC_1H(attrib_ref_get, struct rb_attrib*)
+TRACE_FUNC_1H(attrib_ref_put, struct rb_attrib*)
+
+/*******************************************************************************
+ *
+ * Framebuffer.
+ *
+ ******************************************************************************/
+int
+rb_create_framebuffer
+  (struct rb_context* ctxt,
+   const struct rb_framebuffer_desc* desc,
+   struct rb_framebuffer** out_buffer)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_blob(desc, sizeof(struct rb_framebuffer_desc));
+  put_u64(out_buffer != NULL);
+  err = trace.rbi.create_framebuffer(ctxt, desc, out_buffer);
+  put_new_handle(err, out_buffer ? *out_buffer : NULL);
+  END_CALL(create_framebuffer, err);
+}
+
+TRACE_FUNC_1H(framebuffer_ref_get, struct rb_framebuffer*)
+TRACE_FUNC_1H(framebuffer_ref_put, struct rb_framebuffer*)
+TRACE_FUNC_2H(bind_framebuffer, struct rb_context*, struct rb_framebuffer*)
+
+int
+rb_framebuffer_render_targets
+  (struct rb_framebuffer* buffer,
+   unsigned int count,
+   const struct rb_render_target render_target_list[],
+   const struct rb_render_target* depth_stencil)
+{
+  unsigned int i = 0;
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(buffer);
+  put_u64(count);
+  put_u64(render_target_list != NULL);
+  if(render_target_list) {
+    for(i = 0; i < count; ++i)
+      put_render_target(render_target_list + i);
+  }
+  put_u64(depth_stencil != NULL);
+  if(depth_stencil)
+    put_render_target(depth_stencil);
+  err = trace.rbi.framebuffer_render_targets
+    (buffer, count, render_target_list, depth_stencil);
+  END_CALL(framebuffer_render_targets, err);
+}
+
+int
+rb_clear_framebuffer_render_targets
+  (struct rb_framebuffer* buffer,
+   int clear_flag,
+   unsigned int count,
+   const struct rb_clear_framebuffer_color_desc* color_vals,
+   float depth_val,
+   char stencil_val)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(buffer);
+  put_i64(clear_flag);
+  put_u64(count);
+  put_blob
+    (color_vals, count * sizeof(struct rb_clear_framebuffer_color_desc));
+  put_f64(depth_val);
+  put_i64(stencil_val);
+  err = trace.rbi.clear_framebuffer_render_targets
+    (buffer, clear_flag, count, color_vals, depth_val, stencil_val);
+  END_CALL(clear_framebuffer_render_targets, err);
+}
+
+int
+rb_read_back_framebuffer
+  (struct rb_framebuffer* buffer,
+   int rt_id,
+   size_t x,
+   size_t y,
+   size_t width,
+   size_t height,
+   size_t* read_size,
+   void* read_data)
+{
+  size_t size = 0;
+  int err = 0;
+
+  BEGIN_CALL();
+  /* Save the size of the read data in order to allocate the replayed read
+   * buffer. */
+  if(read_data) {
+    if(trace.rbi.read_back_framebuffer
+       (buffer, rt_id, x, y, width, height, &size, NULL) != 0)
+      size = 0;
+  }
+  put_handle(buffer);
+  put_i64(rt_id);
+  put_u64(x);
+  put_u64(y);
+  put_u64(width);
+  put_u64(height);
+  put_u64(read_size != NULL);
+  put_u64(read_data != NULL);
+  put_u64(size);
+  err = trace.rbi.read_back_framebuffer
+    (buffer, rt_id, x, y, width, height, read_size, read_data);
+  END_CALL(read_back_framebuffer, err);
+}
+
+/*******************************************************************************
+ *
+ * Command buffers.
+ *
+ ******************************************************************************/
+int
+rb_create_command_buffer
+  (struct rb_context* ctxt,
+   struct rb_command_buffer** out_cmd)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_u64(out_cmd != NULL);
+  err = trace.rbi.create_command_buffer(ctxt, out_cmd);
+  put_new_handle(err, out_cmd ? *out_cmd : NULL);
+  END_CALL(create_command_buffer, err);
+}
+
+TRACE_FUNC_1H(command_buffer_ref_get, struct rb_command_buffer*)
+TRACE_FUNC_1H(command_buffer_ref_put, struct rb_command_buffer*)
+TRACE_FUNC_1H(reset_command_buffer, struct rb_command_buffer*)
+TRACE_FUNC_2H(cmd_bind_program, struct rb_command_buffer*, struct rb_program*)
+TRACE_FUNC_2H
+  (cmd_bind_vertex_array, struct rb_command_buffer*, struct rb_vertex_array*)
+
+int
+rb_cmd_bind_tex2d
+  (struct rb_command_buffer* cmd,
+   struct rb_tex2d* tex,
+   unsigned int tex_unit)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(cmd);
+  put_handle(tex);
+  put_u64(tex_unit);
+  err = trace.rbi.cmd_bind_tex2d(cmd, tex, tex_unit);
+  END_CALL(cmd_bind_tex2d, err);
+}
+
+int
+rb_cmd_bind_sampler
+  (struct rb_command_buffer* cmd,
+   struct rb_sampler* sampler,
+   unsigned int tex_unit)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(cmd);
+  put_handle(sampler);
+  put_u64(tex_unit);
+  err = trace.rbi.cmd_bind_sampler(cmd, sampler, tex_unit);
+  END_CALL(cmd_bind_sampler, err);
+}
+
+TRACE_FUNC_2H
+  (cmd_bind_framebuffer, struct rb_command_buffer*, struct rb_framebuffer*)
+TRACE_CMD_DESC(cmd_blend, struct rb_blend_desc)
+TRACE_CMD_DESC(cmd_depth_stencil, struct rb_depth_stencil_desc)
+TRACE_CMD_DESC(cmd_rasterizer, struct rb_rasterizer_desc)
+TRACE_CMD_DESC(cmd_viewport, struct rb_viewport_desc)
+
+int
+rb_cmd_clear
+  (struct rb_command_buffer* cmd,
+   int clear_flag,
+   const float color_val[4],
+   float depth_val,
+   char stencil_val)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(cmd);
+  put_i64(clear_flag);
+  put_blob(color_val, 4 * sizeof(float));
+  put_f64(depth_val);
+  put_i64(stencil_val);
+  err = trace.rbi.cmd_clear(cmd, clear_flag, color_val, depth_val,stencil_val);
+  END_CALL(cmd_clear, err);
+}
+
+int
+rb_cmd_uniform_data
+  (struct rb_command_buffer* cmd,
+   struct rb_uniform* uniform,
+   int count,
+   const void* data)
+{
+  struct rb_uniform_desc desc;
+  size_t size = 0;
+  int err = 0;
+
+  BEGIN_CALL();
+  if(uniform && count > 0 && trace.rbi.get_uniform_desc(uniform, &desc) == 0)
+    size = (size_t)count * sizeof_type(desc.type);
+  put_handle(cmd);
+  put_handle(uniform);
+  put_i64(count);
+  put_blob(data, size);
+  err = trace.rbi.cmd_uniform_data(cmd, uniform, count, data);
+  END_CALL(cmd_uniform_data, err);
+}
+
+int
+rb_cmd_buffer_data
+  (struct rb_command_buffer* cmd,
+   struct rb_buffer* buf,
+   int offset,
+   int size,
+   const void* data)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(cmd);
+  put_handle(buf);
+  put_i64(offset);
+  put_i64(size);
+  put_blob(data, size > 0 ? (size_t)size : 0);
+  err = trace.rbi.cmd_buffer_data(cmd, buf, offset, size, data);
+  END_CALL(cmd_buffer_data, err);
+}
+
+int
+rb_cmd_draw
+  (struct rb_command_buffer* cmd,
+   enum rb_primitive_type prim_type,
+   unsigned int count)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(cmd);
+  put_u64(prim_type);
+  put_u64(count);
+  err = trace.rbi.cmd_draw(cmd, prim_type, count);
+  END_CALL(cmd_draw, err);
+}
+
+int
+rb_cmd_draw_indexed
+  (struct rb_command_buffer* cmd,
+   enum rb_primitive_type prim_type,
+   unsigned int count)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(cmd);
+  put_u64(prim_type);
+  put_u64(count);
+  err = trace.rbi.cmd_draw_indexed(cmd, prim_type, count);
+  END_CALL(cmd_draw_indexed, err);
+}
+
+int
+rb_submit_command_buffers
+  (struct rb_context* ctxt,
+   size_t count,
+   struct rb_command_buffer* const cmd_list[])
+{
+  size_t i = 0;
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_u64(cmd_list != NULL);
+  put_u64(count);
+  for(i = 0; cmd_list && i < count; ++i)
+    put_handle(cmd_list[i]);
+  err = trace.rbi.submit_command_buffers(ctxt, count, cmd_list);
+  END_CALL(submit_command_buffers, err);
+}
+
+/*******************************************************************************
+ *
+ * Bundles.
+ *
+ ******************************************************************************/
+int
+rb_create_bundle
+  (struct rb_context* ctxt,
+   struct rb_command_buffer* cmd,
+   struct rb_bundle** out_bundle)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_handle(cmd);
+  put_u64(out_bundle != NULL);
+  err = trace.rbi.create_bundle(ctxt, cmd, out_bundle);
+  put_new_handle(err, out_bundle ? *out_bundle : NULL);
+  END_CALL(create_bundle, err);
+}
+
+TRACE_FUNC_1H(bundle_ref_get, struct rb_bundle*)
+TRACE_FUNC_1H(bundle_ref_put, struct rb_bundle*)
+
+int
+rb_bundle_uniform_data
+  (struct rb_bundle* bundle,
+   struct rb_uniform* uniform,
+   int count,
+   const void* data)
+{
+  struct rb_uniform_desc desc;
+  size_t size = 0;
+  int err = 0;
+
+  BEGIN_CALL();
+  if(uniform && count > 0 && trace.rbi.get_uniform_desc(uniform, &desc) == 0)
+    size = (size_t)count * sizeof_type(desc.type);
+  put_handle(bundle);
+  put_handle(uniform);
+  put_i64(count);
+  put_blob(data, size);
+  err = trace.rbi.bundle_uniform_data(bundle, uniform, count, data);
+  END_CALL(bundle_uniform_data, err);
+}
+
+TRACE_FUNC_2H(execute_bundle, struct rb_context*, struct rb_bundle*)
+
+/*******************************************************************************
+ *
+ * Fences.
+ *
+ ******************************************************************************/
+int
+rb_create_fence(struct rb_context* ctxt, struct rb_fence** out_fence)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_u64(out_fence != NULL);
+  err = trace.rbi.create_fence(ctxt, out_fence);
+  put_new_handle(err, out_fence ? *out_fence : NULL);
+  END_CALL(create_fence, err);
+}
+
+TRACE_FUNC_1H(fence_ref_get, struct rb_fence*)
+TRACE_FUNC_1H(fence_ref_put, struct rb_fence*)
+TRACE_FUNC_2H(wait_fence, struct rb_context*, struct rb_fence*)
+
+int
+rb_poll_fence
+  (struct rb_context* ctxt,
+   struct rb_fence* fence,
+   int* is_signaled)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_handle(fence);
+  put_u64(is_signaled != NULL);
+  err = trace.rbi.poll_fence(ctxt, fence, is_signaled);
+  END_CALL(poll_fence, err);
+}
+
+/*******************************************************************************
+ *
+ * Miscellaneous functions.
+ *
+ ******************************************************************************/
+TRACE_FUNC_DESC(blend, struct rb_blend_desc)
+
+int
+rb_clear
+  (struct rb_context* ctxt,
+   int clear_flag,
+   const float color_val[4],
+   float depth_val,
+   char stencil_val)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_i64(clear_flag);
+  put_blob(color_val, 4 * sizeof(float));
+  put_f64(depth_val);
+  put_i64(stencil_val);
+  err = trace.rbi.clear(ctxt, clear_flag, color_val, depth_val, stencil_val);
+  END_CALL(clear, err);
+}
+
+TRACE_FUNC_DESC(depth_stencil, struct rb_depth_stencil_desc)
+
+int
+rb_draw
+  (struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int count)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_u64(prim_type);
+  put_u64(count);
+  err = trace.rbi.draw(ctxt, prim_type, count);
+  END_CALL(draw, err);
+}
+
+int
+rb_draw_indexed
+  (struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int count)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_u64(prim_type);
+  put_u64(count);
+  err = trace.rbi.draw_indexed(ctxt, prim_type, count);
+  END_CALL(draw_indexed, err);
+}
+
+int
+rb_multi_draw_indexed
+  (struct rb_context* ctxt,
+   enum rb_primitive_type prim_type,
+   unsigned int nb_ranges,
+   const struct rb_draw_range* range_list)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_u64(prim_type);
+  put_u64(nb_ranges);
+  put_blob(range_list, range_list ? nb_ranges*sizeof(struct rb_draw_range) : 0);
+  err = trace.rbi.multi_draw_indexed(ctxt, prim_type, nb_ranges, range_list);
+  END_CALL(multi_draw_indexed, err);
+}
+
+TRACE_FUNC_DESC(error_check, struct rb_error_check_desc)
+TRACE_FUNC_1H(flush, struct rb_context*)
+TRACE_FUNC_1H(begin_frame, struct rb_context*)
+TRACE_FUNC_1H(end_frame, struct rb_context*)
+TRACE_FUNC_DESC(rasterizer, struct rb_rasterizer_desc)
+TRACE_FUNC_DESC(viewport, struct rb_viewport_desc)
+
+int
+rb_get_config(struct rb_context* ctxt, struct rb_config* cfg)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_u64(cfg != NULL);
+  err = trace.rbi.get_config(ctxt, cfg);
+  END_CALL(get_config, err);
+}
+
+int
+rb_get_pool_stats(struct rb_context* ctxt, struct rb_pool_stats* stats)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_u64(stats != NULL);
+  err = trace.rbi.get_pool_stats(ctxt, stats);
+  END_CALL(get_pool_stats, err);
+}
+
+/* The content of the transient memory is not traced. */
+int
+rb_frame_alloc(struct rb_context* ctxt, size_t size, void** out_mem)
+{
+  int err = 0;
+  BEGIN_CALL();
+  put_handle(ctxt);
+  put_u64(size);
+  put_u64(out_mem != NULL);
+  err = trace.rbi.frame_alloc(ctxt, size, out_mem);
+  END_CALL(frame_alloc, err);
+}
+
+#undef CHUNK_SIZE
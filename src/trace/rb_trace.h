@@ -0,0 +1,61 @@
+#ifndef RB_TRACE_H
+#define RB_TRACE_H
+
+#include <snlsys/snlsys.h>
+#include <stdint.h>
+
+/*******************************************************************************
+ *
+ * Binary trace format shared by the rb-trace recorder and the rb_replay tool.
+ *
+ * A trace is an header followed by a list of chunks. Each chunk stores a
+ * list of calls that may be compressed as a whole. A call is a fixed size
+ * header followed by its arguments encoded as 64-bits words or as blobs, i.e.
+ * a 64-bits size followed by the blob bytes. Every element is padded to 8
+ * bytes in order to be directly read from a memory mapped trace.
+ *
+ ******************************************************************************/
+#define RB_TRACE_MAGIC "RBTRACE"
+#define RB_TRACE_VERSION 1
+#define RB_TRACE_ALIGNMENT 8
+#define RB_TRACE_NULL_BLOB UINT64_MAX /* Size of a NULL blob. */
+
+/* Identifier of the traced functions. It depends on the rb_func.h content and
+ * consequently the number of functions is saved into the trace header. */
+enum rb_trace_func {
+  #define RB_FUNC(func_name, ...) RB_TRACE_##func_name,
+  #include "rb_func.h"
+  #undef RB_FUNC
+  RB_TRACE_FUNCS_COUNT
+};
+
+enum {
+  RB_TRACE_CHUNK_COMPRESSED = BIT(0)
+};
+
+struct rb_trace_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t funcs_count;
+};
+
+struct rb_trace_chunk {
+  uint32_t size; /* Size in bytes of the uncompressed calls. */
+  uint32_t stored_size; /* Size in bytes of the chunk data into the file. */
+  uint32_t flags;
+  uint32_t padding;
+};
+
+struct rb_trace_call {
+  uint16_t func;
+  int16_t err; /* Returned value of the traced call. */
+  uint32_t size; /* Size in bytes of the encoded arguments. */
+};
+
+static FINLINE size_t
+rb_trace_align(size_t size)
+{
+  return (size + RB_TRACE_ALIGNMENT - 1) & ~((size_t)RB_TRACE_ALIGNMENT - 1);
+}
+
+#endif /* RB_TRACE_H */